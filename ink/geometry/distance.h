@@ -15,10 +15,9 @@
 #ifndef INK_GEOMETRY_DISTANCE_H_
 #define INK_GEOMETRY_DISTANCE_H_
 
-#include <algorithm>
-#include <optional>
-
-#include "ink/geometry/intersects.h"
+#include "ink/geometry/affine_transform.h"
+#include "ink/geometry/internal/distance_internal.h"
+#include "ink/geometry/partitioned_mesh.h"
 #include "ink/geometry/point.h"
 #include "ink/geometry/quad.h"
 #include "ink/geometry/rect.h"
@@ -32,82 +31,117 @@ namespace ink {
 // to the interior of that shape, meaning distance will be zero if that shape
 // contains the other object. The return value will always be greater than or
 // equal to zero, and Distance(a, b) == Distance(b, a).
+//
+// Note that, because it is expensive to apply a transform to a mesh, overloads
+// that operate on a PartitionedMesh also take a transform; this transform maps
+// from the PartitionedMesh's coordinate space to the coordinate space that the
+// distance should be measured in. These overloads use the PartitionedMesh's
+// spatial index (initializing it if necessary), and return infinity if the
+// PartitionedMesh is empty.
 
 float Distance(Point a, Point b);
 float Distance(Point point, const Segment& segment);
 float Distance(Point point, const Triangle& triangle);
 float Distance(Point point, const Rect& rect);
 float Distance(Point point, const Quad& quad);
+float Distance(Point point, const PartitionedMesh& mesh,
+               const AffineTransform& mesh_to_point_transform);
 
 float Distance(const Segment& segment, Point point);
 float Distance(const Segment& a, const Segment& b);
 float Distance(const Segment& segment, const Triangle& triangle);
 float Distance(const Segment& segment, const Rect& rect);
 float Distance(const Segment& segment, const Quad& quad);
+float Distance(const Segment& segment, const PartitionedMesh& mesh,
+               const AffineTransform& mesh_to_segment_transform);
 
 float Distance(const Triangle& triangle, Point point);
 float Distance(const Triangle& triangle, const Segment& segment);
 float Distance(const Triangle& a, const Triangle& b);
 float Distance(const Triangle& triangle, const Rect& rect);
 float Distance(const Triangle& triangle, const Quad& quad);
+float Distance(const Triangle& triangle, const PartitionedMesh& mesh,
+               const AffineTransform& mesh_to_triangle_transform);
 
 float Distance(const Rect& rect, Point point);
 float Distance(const Rect& rect, const Segment& segment);
 float Distance(const Rect& rect, const Triangle& triangle);
 float Distance(const Rect& a, const Rect& b);
 float Distance(const Rect& rect, const Quad& quad);
+float Distance(const Rect& rect, const PartitionedMesh& mesh,
+               const AffineTransform& mesh_to_rect_transform);
 
 float Distance(const Quad& quad, Point point);
 float Distance(const Quad& quad, const Segment& segment);
 float Distance(const Quad& quad, const Triangle& triangle);
 float Distance(const Quad& quad, const Rect& rect);
 float Distance(const Quad& a, const Quad& b);
+float Distance(const Quad& quad, const PartitionedMesh& mesh,
+               const AffineTransform& mesh_to_quad_transform);
+
+float Distance(const PartitionedMesh& mesh,
+               const AffineTransform& mesh_to_point_transform, Point point);
+float Distance(const PartitionedMesh& mesh,
+               const AffineTransform& mesh_to_segment_transform,
+               const Segment& segment);
+float Distance(const PartitionedMesh& mesh,
+               const AffineTransform& mesh_to_triangle_transform,
+               const Triangle& triangle);
+float Distance(const PartitionedMesh& mesh,
+               const AffineTransform& mesh_to_rect_transform,
+               const Rect& rect);
+float Distance(const PartitionedMesh& mesh,
+               const AffineTransform& mesh_to_quad_transform,
+               const Quad& quad);
 
 ////////////////////////////////////////////////////////////////////////////////
 // Inline function definitions
 ////////////////////////////////////////////////////////////////////////////////
 
-inline float Distance(Point a, Point b) { return (a - b).Magnitude(); }
+inline float Distance(Point a, Point b) {
+  return geometry_internal::DistanceInternal(a, b);
+}
 inline float Distance(Point point, const Segment& segment) {
-  // Reroute to a simpler function when the segment is point-like.
-  if (segment.start == segment.end) {
-    return Distance(segment.start, point);
-  }
-
-  std::optional<float> point_projection = segment.Project(point);
-  if (!point_projection.has_value()) {
-    // If we can't determine the projection (which can happen for very small
-    // segments where the endpoints are not equal but computation of magnitude
-    // squared underflows), just take the min distance from the endpoints.
-    return std::min(Distance(segment.start, point),
-                    Distance(segment.end, point));
-  }
-  if (*point_projection >= 1.0f) {
-    return Distance(point, segment.end);
-  }
-  if (*point_projection <= 0.0f) {
-    return Distance(point, segment.start);
-  }
-
-  // Closest point on the segment to the point: segment.Lerp(point_projection)
-  return Distance(point, segment.Lerp(*point_projection));
+  return geometry_internal::DistanceInternal(point, segment);
+}
+inline float Distance(Point point, const Triangle& triangle) {
+  return geometry_internal::DistanceInternal(point, triangle);
+}
+inline float Distance(Point point, const Rect& rect) {
+  return geometry_internal::DistanceInternal(point, rect);
+}
+inline float Distance(Point point, const Quad& quad) {
+  return geometry_internal::DistanceInternal(point, quad);
 }
-
 inline float Distance(const Segment& a, const Segment& b) {
-  // Reroute to a simpler function when the segment is point-like.
-  if (a.start == a.end) return Distance(a.start, b);
-  // Reroute to a simpler function when the segment is point-like.
-  if (b.start == b.end) return Distance(b.start, a);
-
-  // If the segments intersect then the distance between them is 0.
-  if (Intersects(a, b)) {
-    return 0.0f;
-  }
-
-  // If the segments do not intersect then the minimum distance will be the
-  // shortest distance from one of the endpoints to the other segment.
-  return std::min({Distance(a.start, b), Distance(a.end, b),
-                   Distance(b.start, a), Distance(b.end, a)});
+  return geometry_internal::DistanceInternal(a, b);
+}
+inline float Distance(const Segment& segment, const Triangle& triangle) {
+  return geometry_internal::DistanceInternal(segment, triangle);
+}
+inline float Distance(const Segment& segment, const Rect& rect) {
+  return geometry_internal::DistanceInternal(segment, rect);
+}
+inline float Distance(const Segment& segment, const Quad& quad) {
+  return geometry_internal::DistanceInternal(segment, quad);
+}
+inline float Distance(const Triangle& a, const Triangle& b) {
+  return geometry_internal::DistanceInternal(a, b);
+}
+inline float Distance(const Triangle& triangle, const Rect& rect) {
+  return geometry_internal::DistanceInternal(triangle, rect);
+}
+inline float Distance(const Triangle& triangle, const Quad& quad) {
+  return geometry_internal::DistanceInternal(triangle, quad);
+}
+inline float Distance(const Rect& a, const Rect& b) {
+  return geometry_internal::DistanceInternal(a, b);
+}
+inline float Distance(const Rect& rect, const Quad& quad) {
+  return geometry_internal::DistanceInternal(rect, quad);
+}
+inline float Distance(const Quad& a, const Quad& b) {
+  return geometry_internal::DistanceInternal(a, b);
 }
 
 // Convenience overloads for order-independent function calls.
@@ -141,6 +175,26 @@ inline float Distance(const Quad& quad, const Triangle& triangle) {
 inline float Distance(const Quad& quad, const Rect& rect) {
   return Distance(rect, quad);
 }
+inline float Distance(Point point, const PartitionedMesh& mesh,
+                      const AffineTransform& mesh_to_point_transform) {
+  return Distance(mesh, mesh_to_point_transform, point);
+}
+inline float Distance(const Segment& segment, const PartitionedMesh& mesh,
+                      const AffineTransform& mesh_to_segment_transform) {
+  return Distance(mesh, mesh_to_segment_transform, segment);
+}
+inline float Distance(const Triangle& triangle, const PartitionedMesh& mesh,
+                      const AffineTransform& mesh_to_triangle_transform) {
+  return Distance(mesh, mesh_to_triangle_transform, triangle);
+}
+inline float Distance(const Rect& rect, const PartitionedMesh& mesh,
+                      const AffineTransform& mesh_to_rect_transform) {
+  return Distance(mesh, mesh_to_rect_transform, rect);
+}
+inline float Distance(const Quad& quad, const PartitionedMesh& mesh,
+                      const AffineTransform& mesh_to_quad_transform) {
+  return Distance(mesh, mesh_to_quad_transform, quad);
+}
 
 }  // namespace ink
 
@@ -15,9 +15,13 @@
 #include "ink/geometry/distance.h"
 
 #include <cmath>
+#include <limits>
 
 #include "gtest/gtest.h"
+#include "ink/geometry/affine_transform.h"
 #include "ink/geometry/angle.h"
+#include "ink/geometry/mesh_test_helpers.h"
+#include "ink/geometry/partitioned_mesh.h"
 #include "ink/geometry/point.h"
 #include "ink/geometry/quad.h"
 #include "ink/geometry/rect.h"
@@ -1416,5 +1420,65 @@ TEST(DistanceTest,
       0.0f);
 }
 
+TEST(DistanceTest, PointToPartitionedMesh) {
+  // The triangles of this mesh are (0, 0), (1, -1), (2, 0); (1, -1), (3, -1),
+  // (2, 0); and (2, 0), (3, -1), (4, 0).
+  PartitionedMesh mesh = MakeStraightLinePartitionedMesh(3);
+
+  EXPECT_FLOAT_EQ(Distance(Point{6, -1}, mesh, AffineTransform()),
+                  std::sqrt(5.0f));
+  EXPECT_FLOAT_EQ(Distance(Point{0, 3}, mesh, AffineTransform()), 3.0f);
+  EXPECT_FLOAT_EQ(Distance(Point{2, -0.5f}, mesh, AffineTransform()), 0.0f);
+  // Arguments are flipped to verify order independence.
+  EXPECT_FLOAT_EQ(Distance(mesh, AffineTransform(), Point{6, -1}),
+                  std::sqrt(5.0f));
+}
+
+TEST(DistanceTest, PartitionedMeshWithTransform) {
+  PartitionedMesh mesh = MakeStraightLinePartitionedMesh(3);
+
+  // Scaled up, the mesh covers the point.
+  EXPECT_FLOAT_EQ(Distance(Point{6, -1}, mesh, AffineTransform::Scale(2)),
+                  0.0f);
+  EXPECT_FLOAT_EQ(Distance(Point{12, -2}, mesh, AffineTransform::Scale(2)),
+                  2.0f * std::sqrt(5.0f));
+  // This transform is not invertible; it collapses the mesh to the segment
+  // from (1, 4) to (5, 4).
+  EXPECT_FLOAT_EQ(
+      Distance(Point{3, 6}, mesh, AffineTransform(1, 0, 1, 0, 0, 4)), 2.0f);
+}
+
+TEST(DistanceTest, PrimitivesToPartitionedMesh) {
+  PartitionedMesh mesh = MakeStraightLinePartitionedMesh(3);
+
+  EXPECT_FLOAT_EQ(Distance(Segment{{5, -3}, {5, 3}}, mesh, AffineTransform()),
+                  1.0f);
+  EXPECT_FLOAT_EQ(
+      Distance(Triangle{{5, 1}, {6, 1}, {6, 2}}, mesh, AffineTransform()),
+      std::sqrt(2.0f));
+  EXPECT_FLOAT_EQ(Distance(Rect::FromTwoPoints({6, 1}, {7, 2}), mesh,
+                           AffineTransform()),
+                  std::sqrt(5.0f));
+  EXPECT_FLOAT_EQ(Distance(Quad::FromCenterAndDimensions({7, 1}, 2, 2), mesh,
+                           AffineTransform()),
+                  2.0f);
+  // Arguments are flipped to verify order independence.
+  EXPECT_FLOAT_EQ(Distance(mesh, AffineTransform(), Segment{{5, -3}, {5, 3}}),
+                  1.0f);
+  EXPECT_FLOAT_EQ(Distance(mesh, AffineTransform(),
+                           Rect::FromTwoPoints({6, 1}, {7, 2})),
+                  std::sqrt(5.0f));
+}
+
+TEST(DistanceTest, EmptyPartitionedMeshIsInfinitelyFarAway) {
+  PartitionedMesh mesh;
+
+  EXPECT_EQ(Distance(Point{0, 0}, mesh, AffineTransform()),
+            std::numeric_limits<float>::infinity());
+  EXPECT_EQ(Distance(mesh, AffineTransform(),
+                     Rect::FromTwoPoints({-1, -1}, {1, 1})),
+            std::numeric_limits<float>::infinity());
+}
+
 }  // namespace
 }  // namespace ink
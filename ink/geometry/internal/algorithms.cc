@@ -20,6 +20,7 @@
 #include <limits>
 #include <optional>
 #include <utility>
+#include <vector>
 
 #include "absl/log/absl_check.h"
 #include "absl/types/span.h"
@@ -258,13 +259,16 @@ Segment CalculateCollapsedSegment(
   // repeated queries.
   float min_value = std::numeric_limits<float>::infinity();
   float max_value = -std::numeric_limits<float>::infinity();
+  std::vector<Point> positions;
   for (const Mesh& mesh : meshes) {
     ABSL_DCHECK(mesh.Bounds().IsEmpty() ||
                 bounds.Contains(*mesh.Bounds().AsRect()));
+    positions.resize(mesh.VertexCount());
+    mesh.DecodePositions(absl::MakeSpan(positions));
     for (uint32_t t_idx = 0; t_idx < mesh.TriangleCount(); ++t_idx) {
       for (uint32_t v_idx : mesh.TriangleIndices(t_idx)) {
         Point transformed_vertex =
-            non_invertible_transform.Apply(mesh.VertexPosition(v_idx));
+            non_invertible_transform.Apply(positions[v_idx]);
         std::optional<float> projection =
             transformed_diagonal.Project(transformed_vertex);
         if (projection.has_value()) {
@@ -0,0 +1,314 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "ink/geometry/internal/distance_internal.h"
+
+#include <algorithm>
+
+#include "ink/geometry/internal/intersects_internal.h"
+#include "ink/geometry/point.h"
+#include "ink/geometry/quad.h"
+#include "ink/geometry/rect.h"
+#include "ink/geometry/segment.h"
+#include "ink/geometry/triangle.h"
+
+namespace ink {
+namespace geometry_internal {
+
+
+float DistanceInternal(Point point, const Triangle& triangle) {
+  // NOMUTANTS -- Reroute to a simpler function when the triangle is point-like.
+  if (triangle.p0 == triangle.p1 && triangle.p1 == triangle.p2) {
+    return DistanceInternal(triangle.p0, point);
+  }
+
+  // If the point and the triangle intersect, the distance between them is 0.
+  if (IntersectsInternal(point, triangle)) {
+    return 0.0f;
+  }
+
+  // If the point and triangle do not intersect then the minimum distance will
+  // be the shortest distance from the point to one of the triangle's edges.
+  return std::min({DistanceInternal(point, triangle.GetEdge(0)),
+                   DistanceInternal(point, triangle.GetEdge(1)),
+                   DistanceInternal(point, triangle.GetEdge(2))});
+}
+
+float DistanceInternal(Point point, const Rect& rect) {
+  // NOMUTANTS -- Reroute to a simpler function when the rect is point-like.
+  if (rect.Width() == 0 && rect.Height() == 0) {
+    return DistanceInternal(rect.Center(), point);
+  }
+
+  // If the point and the rect intersect then the distance between them is 0.
+  if (IntersectsInternal(point, rect)) {
+    return 0.0f;
+  }
+
+  // If the point and rect do not intersect then the minimum distance will be
+  // the shortest distance from the point to one of the rect's edges.
+  return std::min(
+      {DistanceInternal(point, rect.GetEdge(0)),
+       DistanceInternal(point, rect.GetEdge(1)),
+       DistanceInternal(point, rect.GetEdge(2)),
+       DistanceInternal(point, rect.GetEdge(3))});
+}
+
+float DistanceInternal(Point point, const Quad& quad) {
+  // NOMUTANTS -- Reroute to a simpler function when the quad is point-like.
+  if (quad.Width() == 0 && quad.Height() == 0)
+    return DistanceInternal(quad.Center(), point);
+
+  // If the point and the quad intersect then the distance between them is 0.
+  if (IntersectsInternal(point, quad)) {
+    return 0.0f;
+  }
+
+  // If the point and quad do not intersect then the minimum distance will be
+  // the shortest distance from the point to one of the quad's edges.
+  return std::min(
+      {DistanceInternal(point, quad.GetEdge(0)),
+       DistanceInternal(point, quad.GetEdge(1)),
+       DistanceInternal(point, quad.GetEdge(2)),
+       DistanceInternal(point, quad.GetEdge(3))});
+}
+
+float DistanceInternal(const Segment& segment, const Triangle& triangle) {
+  // If the Segment is point-like, defer to Point-to-Triangle distance.
+  // NOMUTANTS -- This produces the same result, but is slightly faster.
+  if (segment.start == segment.end) {
+    return DistanceInternal(segment.start, triangle);
+  }
+
+  // If the Triangle is point-like, defer to Point-to-Segment distance.
+  // NOMUTANTS -- This produces the same result, but is slightly faster.
+  if (triangle.p0 == triangle.p1 && triangle.p1 == triangle.p2) {
+    return DistanceInternal(triangle.p0, segment);
+  }
+
+  // If the Segment and Triangle intersect then the distance between them is 0.
+  if (IntersectsInternal(segment, triangle)) {
+    return 0.0f;
+  }
+
+  // If the Segment and Triangle do not intersect then the distance will be the
+  // minimum distance from the Segment to any of the Triangle's edges.
+  return std::min({DistanceInternal(segment, triangle.GetEdge(0)),
+                   DistanceInternal(segment, triangle.GetEdge(1)),
+                   DistanceInternal(segment, triangle.GetEdge(2))});
+}
+
+float DistanceInternal(const Segment& segment, const Rect& rect) {
+  // If the Segment is point-like, defer to Point-to-Rect distance.
+  // NOMUTANTS -- This produces the same result, but is slightly faster.
+  if (segment.start == segment.end) {
+    return DistanceInternal(segment.start, rect);
+  }
+
+  // If the Rect is point-like, defer to Point-to-Segment distance.
+  // NOMUTANTS -- This produces the same result, but is slightly faster.
+  if (rect.Width() == 0 && rect.Height() == 0) {
+    return DistanceInternal(rect.Center(), segment);
+  }
+
+  // If the Segment and Rect intersect then the distance between them is 0.
+  if (IntersectsInternal(segment, rect)) {
+    return 0.0f;
+  }
+
+  // If the Segment and Rect do not intersect then the distance will be the
+  // minimum distance from the Segment to any of the Rect's edges.
+  return std::min(
+      {DistanceInternal(segment, rect.GetEdge(0)),
+       DistanceInternal(segment, rect.GetEdge(1)),
+       DistanceInternal(segment, rect.GetEdge(2)),
+       DistanceInternal(segment, rect.GetEdge(3))});
+}
+
+float DistanceInternal(const Segment& segment, const Quad& quad) {
+  // If the Segment is point-like, defer to Point-to-Quad distance.
+  // NOMUTANTS -- This produces the same result, but is slightly faster.
+  if (segment.start == segment.end) {
+    return DistanceInternal(segment.start, quad);
+  }
+
+  // If the Quad is point-like, defer to Point-to-Segment distance.
+  // NOMUTANTS -- This produces the same result, but is slightly faster.
+  if (quad.Width() == 0 && quad.Height() == 0) {
+    return DistanceInternal(quad.Center(), segment);
+  }
+
+  // If the Segment and Quad intersect then the distance between them is 0.
+  if (IntersectsInternal(segment, quad)) {
+    return 0.0f;
+  }
+
+  // If the Segment and Quad do not intersect then the distance will be the
+  // minimum distance from the Segment to any of the Quad's edges.
+  return std::min(
+      {DistanceInternal(segment, quad.GetEdge(0)),
+       DistanceInternal(segment, quad.GetEdge(1)),
+       DistanceInternal(segment, quad.GetEdge(2)),
+       DistanceInternal(segment, quad.GetEdge(3))});
+}
+
+float DistanceInternal(const Triangle& a, const Triangle& b) {
+  // If either Triangle is point-like, defer to Point-to-Triangle distance.
+  // NOMUTANTS -- This produces the same result, but is slightly faster.
+  if (a.p0 == a.p1 && a.p1 == a.p2) {
+    return DistanceInternal(a.p0, b);
+  }
+  // NOMUTANTS -- This produces the same result, but is slightly faster.
+  if (b.p0 == b.p1 && b.p1 == b.p2) {
+    return DistanceInternal(b.p0, a);
+  }
+
+  // If the Triangles intersect then the distance between them is 0.
+  if (IntersectsInternal(a, b)) {
+    return 0.0f;
+  }
+
+  // If the Triangles do not intersect then the distance will be the minimum
+  // distance from one of the edges of one Triangle to the other Triangle.
+  return std::min({DistanceInternal(b.GetEdge(0), a),
+                   DistanceInternal(b.GetEdge(1), a),
+                   DistanceInternal(b.GetEdge(2), a)});
+}
+
+float DistanceInternal(const Triangle& triangle, const Rect& rect) {
+  // If the Triangle is point-like, defer to Point-to-Rect distance.
+  // NOMUTANTS -- This produces the same result, but is slightly faster.
+  if (triangle.p0 == triangle.p1 && triangle.p1 == triangle.p2) {
+    return DistanceInternal(triangle.p0, rect);
+  }
+
+  // If the Rect is point-like, defer to Point-to-Triangle distance.
+  // NOMUTANTS -- This produces the same result, but is slightly faster.
+  if (rect.Width() == 0 && rect.Height() == 0) {
+    return DistanceInternal(rect.Center(), triangle);
+  }
+
+  // If the Triangle and Rect intersect then the distance between them is 0.
+  if (IntersectsInternal(triangle, rect)) {
+    return 0.0f;
+  }
+
+  // If the Triangle and Rect do not intersect then the distance will be the
+  // minimum distance from one of the edges of the Triangle to the Rect.
+  return std::min({DistanceInternal(triangle.GetEdge(0), rect),
+                   DistanceInternal(triangle.GetEdge(1), rect),
+                   DistanceInternal(triangle.GetEdge(2), rect)});
+}
+
+float DistanceInternal(const Triangle& triangle, const Quad& quad) {
+  // If the Triangle is point-like, defer to Point-to-Quad distance.
+  // NOMUTANTS -- This produces the same result, but is slightly faster.
+  if (triangle.p0 == triangle.p1 && triangle.p1 == triangle.p2) {
+    return DistanceInternal(triangle.p0, quad);
+  }
+
+  // If the Quad is point-like, defer to Point-to-Triangle distance.
+  // NOMUTANTS -- This produces the same result, but is slightly faster.
+  if (quad.Width() == 0 && quad.Height() == 0) {
+    return DistanceInternal(quad.Center(), triangle);
+  }
+
+  // If the Triangle and Quad intersect then the distance between them is 0.
+  if (IntersectsInternal(triangle, quad)) {
+    return 0.0f;
+  }
+
+  // If the Triangle and Quad do not intersect then the distance will be the
+  // minimum distance from one of the edges of the Triangle to the Quad.
+  return std::min({DistanceInternal(triangle.GetEdge(0), quad),
+                   DistanceInternal(triangle.GetEdge(1), quad),
+                   DistanceInternal(triangle.GetEdge(2), quad)});
+}
+
+float DistanceInternal(const Rect& a, const Rect& b) {
+  // If either Rect is point-like, defer to Point-to-Rect distance.
+  // NOMUTANTS -- This produces the same result, but is slightly faster.
+  if (a.Width() == 0 && a.Height() == 0) {
+    return DistanceInternal(a.Center(), b);
+  }
+  // NOMUTANTS -- This produces the same result, but is slightly faster.
+  if (b.Width() == 0 && b.Height() == 0) {
+    return DistanceInternal(b.Center(), a);
+  }
+
+  // If the Rects intersect then the distance between them is 0.
+  if (IntersectsInternal(a, b)) {
+    return 0.0f;
+  }
+
+  // If the Rects do not intersect then the distance will be the minimum
+  // distance from one of the edges of one Rect to the other Rect.
+  return std::min(
+      {DistanceInternal(a.GetEdge(0), b), DistanceInternal(a.GetEdge(1), b),
+       DistanceInternal(a.GetEdge(2), b), DistanceInternal(a.GetEdge(3), b)});
+}
+
+float DistanceInternal(const Rect& rect, const Quad& quad) {
+  // If the Rect is point-like, defer to Point-to-Quad distance.
+  // NOMUTANTS -- This produces the same result, but is slightly faster.
+  if (rect.Width() == 0 && rect.Height() == 0) {
+    return DistanceInternal(rect.Center(), quad);
+  }
+
+  // If the Quad is point-like, defer to Point-to-Rect distance.
+  // NOMUTANTS -- This produces the same result, but is slightly faster.
+  if (quad.Width() == 0 && quad.Height() == 0) {
+    return DistanceInternal(quad.Center(), rect);
+  }
+
+  // If the Rect and Quad intersect then the distance between them is 0.
+  if (IntersectsInternal(rect, quad)) {
+    return 0.0f;
+  }
+
+  // If the Rect and Quad do not intersect then the distance will be the
+  // minimum distance from one of the edges of the Rect to the Quad.
+  return std::min(
+      {DistanceInternal(rect.GetEdge(0), quad),
+       DistanceInternal(rect.GetEdge(1), quad),
+       DistanceInternal(rect.GetEdge(2), quad),
+       DistanceInternal(rect.GetEdge(3), quad)});
+}
+
+float DistanceInternal(const Quad& a, const Quad& b) {
+  // If either Quad is point-like, defer to Point-to-Quad distance.
+  // NOMUTANTS -- This produces the same result, but is slightly faster.
+  if (a.Width() == 0 && a.Height() == 0) {
+    return DistanceInternal(a.Center(), b);
+  }
+  // NOMUTANTS -- This produces the same result, but is slightly faster.
+  if (b.Width() == 0 && b.Height() == 0) {
+    return DistanceInternal(b.Center(), a);
+  }
+
+  // If the Quads intersect then the distance between them is 0.
+  if (IntersectsInternal(a, b)) {
+    return 0.0f;
+  }
+
+  // If the Quads do not intersect then the distance will be the minimum
+  // distance from one of the edges of one Quad to the other Quad.
+  return std::min(
+      {DistanceInternal(a.GetEdge(0), b), DistanceInternal(a.GetEdge(1), b),
+       DistanceInternal(a.GetEdge(2), b), DistanceInternal(a.GetEdge(3), b)});
+}
+
+}  // namespace geometry_internal
+}  // namespace ink
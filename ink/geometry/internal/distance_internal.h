@@ -0,0 +1,152 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef INK_GEOMETRY_INTERNAL_DISTANCE_INTERNAL_H_
+#define INK_GEOMETRY_INTERNAL_DISTANCE_INTERNAL_H_
+
+#include <algorithm>
+#include <optional>
+
+#include "ink/geometry/internal/intersects_internal.h"
+#include "ink/geometry/point.h"
+#include "ink/geometry/quad.h"
+#include "ink/geometry/rect.h"
+#include "ink/geometry/segment.h"
+#include "ink/geometry/triangle.h"
+
+namespace ink {
+namespace geometry_internal {
+
+// These functions contain the logic for the public `Distance` functions. The
+// logic has been extracted here to avoid a circular dependency between the
+// public `Distance` functions and `PartitionedMesh`, as
+// `PartitionedMesh::VisitNearestTriangles` requires distance, but we also have
+// `Distance` functions that operate on `PartitionedMesh`.
+
+float DistanceInternal(Point a, Point b);
+float DistanceInternal(Point point, const Segment& segment);
+float DistanceInternal(Point point, const Triangle& triangle);
+float DistanceInternal(Point point, const Rect& rect);
+float DistanceInternal(Point point, const Quad& quad);
+
+float DistanceInternal(const Segment& segment, Point point);
+float DistanceInternal(const Segment& a, const Segment& b);
+float DistanceInternal(const Segment& segment, const Triangle& triangle);
+float DistanceInternal(const Segment& segment, const Rect& rect);
+float DistanceInternal(const Segment& segment, const Quad& quad);
+
+float DistanceInternal(const Triangle& triangle, Point point);
+float DistanceInternal(const Triangle& triangle, const Segment& segment);
+float DistanceInternal(const Triangle& a, const Triangle& b);
+float DistanceInternal(const Triangle& triangle, const Rect& rect);
+float DistanceInternal(const Triangle& triangle, const Quad& quad);
+
+float DistanceInternal(const Rect& rect, Point point);
+float DistanceInternal(const Rect& rect, const Segment& segment);
+float DistanceInternal(const Rect& rect, const Triangle& triangle);
+float DistanceInternal(const Rect& a, const Rect& b);
+float DistanceInternal(const Rect& rect, const Quad& quad);
+
+float DistanceInternal(const Quad& quad, Point point);
+float DistanceInternal(const Quad& quad, const Segment& segment);
+float DistanceInternal(const Quad& quad, const Triangle& triangle);
+float DistanceInternal(const Quad& quad, const Rect& rect);
+float DistanceInternal(const Quad& a, const Quad& b);
+
+////////////////////////////////////////////////////////////////////////////////
+// Inline function definitions
+////////////////////////////////////////////////////////////////////////////////
+
+inline float DistanceInternal(Point a, Point b) {
+  return (a - b).Magnitude();
+}
+inline float DistanceInternal(Point point, const Segment& segment) {
+  // Reroute to a simpler function when the segment is point-like.
+  if (segment.start == segment.end) {
+    return DistanceInternal(segment.start, point);
+  }
+
+  std::optional<float> point_projection = segment.Project(point);
+  if (!point_projection.has_value()) {
+    // If we can't determine the projection (which can happen for very small
+    // segments where the endpoints are not equal but computation of magnitude
+    // squared underflows), just take the min distance from the endpoints.
+    return std::min(DistanceInternal(segment.start, point),
+                    DistanceInternal(segment.end, point));
+  }
+  if (*point_projection >= 1.0f) {
+    return DistanceInternal(point, segment.end);
+  }
+  if (*point_projection <= 0.0f) {
+    return DistanceInternal(point, segment.start);
+  }
+
+  // Closest point on the segment to the point: segment.Lerp(point_projection)
+  return DistanceInternal(point, segment.Lerp(*point_projection));
+}
+
+inline float DistanceInternal(const Segment& a, const Segment& b) {
+  // Reroute to a simpler function when the segment is point-like.
+  if (a.start == a.end) return DistanceInternal(a.start, b);
+  // Reroute to a simpler function when the segment is point-like.
+  if (b.start == b.end) return DistanceInternal(b.start, a);
+
+  // If the segments intersect then the distance between them is 0.
+  if (IntersectsInternal(a, b)) {
+    return 0.0f;
+  }
+
+  // If the segments do not intersect then the minimum distance will be the
+  // shortest distance from one of the endpoints to the other segment.
+  return std::min({DistanceInternal(a.start, b), DistanceInternal(a.end, b),
+                   DistanceInternal(b.start, a), DistanceInternal(b.end, a)});
+}
+
+// Convenience overloads for order-independent function calls.
+inline float DistanceInternal(const Segment& segment, Point point) {
+  return DistanceInternal(point, segment);
+}
+inline float DistanceInternal(const Triangle& triangle, Point point) {
+  return DistanceInternal(point, triangle);
+}
+inline float DistanceInternal(const Triangle& triangle,
+                              const Segment& segment) {
+  return DistanceInternal(segment, triangle);
+}
+inline float DistanceInternal(const Rect& rect, Point point) {
+  return DistanceInternal(point, rect);
+}
+inline float DistanceInternal(const Rect& rect, const Segment& segment) {
+  return DistanceInternal(segment, rect);
+}
+inline float DistanceInternal(const Rect& rect, const Triangle& triangle) {
+  return DistanceInternal(triangle, rect);
+}
+inline float DistanceInternal(const Quad& quad, Point point) {
+  return DistanceInternal(point, quad);
+}
+inline float DistanceInternal(const Quad& quad, const Segment& segment) {
+  return DistanceInternal(segment, quad);
+}
+inline float DistanceInternal(const Quad& quad, const Triangle& triangle) {
+  return DistanceInternal(triangle, quad);
+}
+inline float DistanceInternal(const Quad& quad, const Rect& rect) {
+  return DistanceInternal(rect, quad);
+}
+
+}  // namespace geometry_internal
+}  // namespace ink
+
+#endif  // INK_GEOMETRY_INTERNAL_DISTANCE_INTERNAL_H_
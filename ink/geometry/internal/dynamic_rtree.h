@@ -0,0 +1,587 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef INK_GEOMETRY_INTERNAL_DYNAMIC_RTREE_H_
+#define INK_GEOMETRY_INTERNAL_DYNAMIC_RTREE_H_
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "absl/algorithm/container.h"
+#include "absl/container/inlined_vector.h"
+#include "absl/functional/function_ref.h"
+#include "absl/log/absl_check.h"
+#include "ink/geometry/internal/intersects_internal.h"
+#include "ink/geometry/rect.h"
+
+namespace ink::geometry_internal {
+
+// An R-Tree whose elements can be inserted, removed, and updated after
+// construction, in O(log(N)) time. This uses the insertion and deletion
+// algorithms of the original R-Tree paper, with the quadratic node split
+// (http://www-db.deis.unibo.it/courses/SI-LS/papers/Gut84.pdf).
+//
+// This is intended for collections that change frequently, e.g. the set of
+// strokes in a document, which are added and erased one at a time. If the set
+// of elements does not change after it is created, prefer `StaticRTree`, which
+// has a more compact layout, and is faster to both build and query.
+//
+// Template parameter `T` is the type of the data elements that are stored in
+// the tree. As with `StaticRTree`, this doesn't need to be the data itself,
+// e.g. it could be an index or identifier for data that is stored elsewhere.
+//
+// Template parameter `kMaxChildren` determines the maximum number of children
+// of each node. It is exposed to facilitate testing of the structure, but you
+// should generally just use the default value.
+//
+// Implementation note: like `StaticRTree`, nodes and elements are stored in
+// contiguous vectors and refer to each other by index. Slots that are freed by
+// removal are kept on free lists and reused by subsequent insertions, so that
+// the storage does not grow under a steady stream of edits.
+template <typename T, uint32_t kMaxChildren = 16>
+class DynamicRTree {
+ public:
+  static_assert(kMaxChildren >= 4,
+                "kMaxChildren must be at least 4 for nodes to be split evenly");
+
+  // Identifies an element in the tree. An `ElementId` remains valid until the
+  // element is removed, after which it may be reused for another element.
+  using ElementId = uint32_t;
+
+  // Constructs an empty `DynamicRTree`, using `bounds_func` to compute the
+  // bounding rectangle of each element. `bounds_func` will be moved into the
+  // `DynamicRTree`; if it references data owned by another object, it is the
+  // responsibility of the caller to ensure that that data remains valid for
+  // the lifetime of the `DynamicRTree`.
+  //
+  // This CHECK-fails if `bounds_func` == nullptr.
+  explicit DynamicRTree(std::function<Rect(const T&)> bounds_func);
+
+  DynamicRTree(const DynamicRTree&) = default;
+  DynamicRTree(DynamicRTree&&) = default;
+  DynamicRTree& operator=(const DynamicRTree&) = default;
+  DynamicRTree& operator=(DynamicRTree&&) = default;
+
+  // Adds `element` to the tree, and returns the ID by which it can be
+  // referred to later.
+  ElementId Insert(T element);
+
+  // Removes the element with the given ID from the tree. This CHECK-fails if
+  // `Contains(id)` is false.
+  void Remove(ElementId id);
+
+  // Replaces the element with the given ID with `element`, moving it within
+  // the tree if its bounds have changed. The ID remains the same. This
+  // CHECK-fails if `Contains(id)` is false.
+  void Update(ElementId id, T element);
+
+  // Returns true if `id` refers to an element that is currently in the tree.
+  bool Contains(ElementId id) const;
+
+  // Returns the element with the given ID. This CHECK-fails if `Contains(id)`
+  // is false.
+  const T& Get(ElementId id) const;
+
+  // Returns the number of elements in the tree.
+  uint32_t Size() const { return size_; }
+  bool IsEmpty() const { return size_ == 0; }
+
+  // Removes all elements from the tree.
+  void Clear();
+
+  // Visits the elements whose bounding box intersects `bounds`, (per the
+  // `Intersects` function). The traversal continues until `visitor` returns
+  // false, at which point no more elements will be visited. The visitation
+  // order depends on the structure of the tree, which should be assumed to be
+  // arbitrary.
+  void VisitIntersectedElements(
+      const Rect& bounds, absl::FunctionRef<bool(const T&)> visitor) const;
+
+  // Returns the number of levels of nodes in the tree, or zero if it is empty.
+  // This is exposed only for testing.
+  uint32_t Height() const;
+
+ private:
+  // Nodes may not have fewer than this many children, except for the root.
+  static constexpr uint32_t kMinChildren = kMaxChildren * 2 / 5;
+  static constexpr uint32_t kNoIndex = std::numeric_limits<uint32_t>::max();
+
+  struct Node {
+    // The minimum bounding rectangle of all descendants of this node.
+    Rect bounds;
+    uint32_t parent = kNoIndex;
+    // The distance from this node to the elements; nodes with height zero are
+    // leaf nodes, whose children are indices into `slots_`, while the children
+    // of other nodes are indices into `nodes_`.
+    uint32_t height = 0;
+    // This has room for one extra child, so that a node can briefly overflow
+    // before it is split.
+    absl::InlinedVector<uint32_t, kMaxChildren + 1> children;
+  };
+
+  struct ElementSlot {
+    // This is `std::nullopt` if the slot is on the free list.
+    std::optional<T> element;
+    Rect bounds;
+    // The index of the leaf node containing this element.
+    uint32_t leaf = kNoIndex;
+  };
+
+  uint32_t AllocateNode(uint32_t height);
+  void FreeNode(uint32_t node_idx);
+
+  // Returns the bounds of the child at `child_idx` of a node with `height`.
+  const Rect& ChildBounds(uint32_t height, uint32_t child_idx) const;
+  void SetParent(uint32_t height, uint32_t child_idx, uint32_t parent_idx);
+
+  // Recomputes the bounds of `node_idx` from its children.
+  void RecomputeBounds(uint32_t node_idx);
+  // Recomputes the bounds of `node_idx` and its ancestors, stopping early once
+  // a node's bounds are unchanged.
+  void RecomputeBoundsUpward(uint32_t node_idx);
+
+  // Adds the child at `child_idx`, with bounds `bounds`, to a node at
+  // `height`, splitting nodes and growing the tree as needed.
+  void InsertChild(uint32_t child_idx, const Rect& bounds, uint32_t height);
+  // Returns the node at `height` that needs the least enlargement to contain
+  // `bounds`.
+  uint32_t ChooseNode(const Rect& bounds, uint32_t height) const;
+  // Splits the overflowing node at `node_idx` into two, and returns the index
+  // of the new sibling node.
+  uint32_t SplitNode(uint32_t node_idx);
+
+  // Removes the element in `slot_idx` from its leaf, re-balancing the tree as
+  // needed, but leaves the slot itself intact.
+  void DetachElement(uint32_t slot_idx);
+
+  bool VisitIntersectedElementsInSubTree(
+      uint32_t node_idx, const Rect& bounds,
+      absl::FunctionRef<bool(const T&)> visitor) const;
+
+  std::vector<Node> nodes_;
+  std::vector<uint32_t> free_nodes_;
+  std::vector<ElementSlot> slots_;
+  std::vector<uint32_t> free_slots_;
+  uint32_t root_ = kNoIndex;
+  uint32_t size_ = 0;
+  std::function<Rect(const T&)> bounds_func_;
+};
+
+// -----------------------------------------------------------------------------
+//                     Implementation details below
+
+template <typename T, uint32_t kMaxChildren>
+DynamicRTree<T, kMaxChildren>::DynamicRTree(
+    std::function<Rect(const T&)> bounds_func)
+    : bounds_func_(std::move(bounds_func)) {
+  ABSL_CHECK(bounds_func_ != nullptr) << "bounds_func must be non-null";
+}
+
+template <typename T, uint32_t kMaxChildren>
+typename DynamicRTree<T, kMaxChildren>::ElementId
+DynamicRTree<T, kMaxChildren>::Insert(T element) {
+  uint32_t slot_idx;
+  if (free_slots_.empty()) {
+    slot_idx = slots_.size();
+    slots_.emplace_back();
+  } else {
+    slot_idx = free_slots_.back();
+    free_slots_.pop_back();
+  }
+  ElementSlot& slot = slots_[slot_idx];
+  slot.bounds = bounds_func_(element);
+  slot.element.emplace(std::move(element));
+  ++size_;
+  InsertChild(slot_idx, slot.bounds, 0);
+  return slot_idx;
+}
+
+template <typename T, uint32_t kMaxChildren>
+void DynamicRTree<T, kMaxChildren>::Remove(ElementId id) {
+  ABSL_CHECK(Contains(id)) << "No element with ID " << id;
+  DetachElement(id);
+  slots_[id].element.reset();
+  free_slots_.push_back(id);
+  --size_;
+}
+
+template <typename T, uint32_t kMaxChildren>
+void DynamicRTree<T, kMaxChildren>::Update(ElementId id, T element) {
+  ABSL_CHECK(Contains(id)) << "No element with ID " << id;
+  Rect new_bounds = bounds_func_(element);
+  ElementSlot& slot = slots_[id];
+  *slot.element = std::move(element);
+  // If the element still fits in its leaf, we can leave it where it is, and
+  // just tighten the bounds; this is the common case for small edits.
+  if (nodes_[slot.leaf].bounds.Contains(new_bounds)) {
+    slot.bounds = new_bounds;
+    RecomputeBoundsUpward(slot.leaf);
+    return;
+  }
+  DetachElement(id);
+  slots_[id].bounds = new_bounds;
+  InsertChild(id, new_bounds, 0);
+}
+
+template <typename T, uint32_t kMaxChildren>
+bool DynamicRTree<T, kMaxChildren>::Contains(ElementId id) const {
+  return id < slots_.size() && slots_[id].element.has_value();
+}
+
+template <typename T, uint32_t kMaxChildren>
+const T& DynamicRTree<T, kMaxChildren>::Get(ElementId id) const {
+  ABSL_CHECK(Contains(id)) << "No element with ID " << id;
+  return *slots_[id].element;
+}
+
+template <typename T, uint32_t kMaxChildren>
+void DynamicRTree<T, kMaxChildren>::Clear() {
+  nodes_.clear();
+  free_nodes_.clear();
+  slots_.clear();
+  free_slots_.clear();
+  root_ = kNoIndex;
+  size_ = 0;
+}
+
+template <typename T, uint32_t kMaxChildren>
+void DynamicRTree<T, kMaxChildren>::VisitIntersectedElements(
+    const Rect& bounds, absl::FunctionRef<bool(const T&)> visitor) const {
+  if (root_ == kNoIndex || !IntersectsInternal(nodes_[root_].bounds, bounds)) {
+    return;
+  }
+  VisitIntersectedElementsInSubTree(root_, bounds, visitor);
+}
+
+template <typename T, uint32_t kMaxChildren>
+uint32_t DynamicRTree<T, kMaxChildren>::Height() const {
+  return root_ == kNoIndex ? 0 : nodes_[root_].height + 1;
+}
+
+template <typename T, uint32_t kMaxChildren>
+uint32_t DynamicRTree<T, kMaxChildren>::AllocateNode(uint32_t height) {
+  uint32_t node_idx;
+  if (free_nodes_.empty()) {
+    node_idx = nodes_.size();
+    nodes_.emplace_back();
+  } else {
+    node_idx = free_nodes_.back();
+    free_nodes_.pop_back();
+    nodes_[node_idx] = Node();
+  }
+  nodes_[node_idx].height = height;
+  return node_idx;
+}
+
+template <typename T, uint32_t kMaxChildren>
+void DynamicRTree<T, kMaxChildren>::FreeNode(uint32_t node_idx) {
+  nodes_[node_idx].children.clear();
+  free_nodes_.push_back(node_idx);
+}
+
+template <typename T, uint32_t kMaxChildren>
+const Rect& DynamicRTree<T, kMaxChildren>::ChildBounds(
+    uint32_t height, uint32_t child_idx) const {
+  return height == 0 ? slots_[child_idx].bounds : nodes_[child_idx].bounds;
+}
+
+template <typename T, uint32_t kMaxChildren>
+void DynamicRTree<T, kMaxChildren>::SetParent(uint32_t height,
+                                              uint32_t child_idx,
+                                              uint32_t parent_idx) {
+  if (height == 0) {
+    slots_[child_idx].leaf = parent_idx;
+  } else {
+    nodes_[child_idx].parent = parent_idx;
+  }
+}
+
+template <typename T, uint32_t kMaxChildren>
+void DynamicRTree<T, kMaxChildren>::RecomputeBounds(uint32_t node_idx) {
+  Node& node = nodes_[node_idx];
+  ABSL_DCHECK(!node.children.empty());
+  node.bounds = ChildBounds(node.height, node.children.front());
+  for (uint32_t child_idx : node.children) {
+    node.bounds.Join(ChildBounds(node.height, child_idx));
+  }
+}
+
+template <typename T, uint32_t kMaxChildren>
+void DynamicRTree<T, kMaxChildren>::RecomputeBoundsUpward(uint32_t node_idx) {
+  while (node_idx != kNoIndex) {
+    Rect old_bounds = nodes_[node_idx].bounds;
+    RecomputeBounds(node_idx);
+    const Rect& new_bounds = nodes_[node_idx].bounds;
+    if (new_bounds.XMin() == old_bounds.XMin() &&
+        new_bounds.YMin() == old_bounds.YMin() &&
+        new_bounds.XMax() == old_bounds.XMax() &&
+        new_bounds.YMax() == old_bounds.YMax()) {
+      return;
+    }
+    node_idx = nodes_[node_idx].parent;
+  }
+}
+
+template <typename T, uint32_t kMaxChildren>
+void DynamicRTree<T, kMaxChildren>::InsertChild(uint32_t child_idx,
+                                                const Rect& bounds,
+                                                uint32_t height) {
+  if (root_ == kNoIndex) {
+    ABSL_DCHECK_EQ(height, 0u);
+    root_ = AllocateNode(0);
+  }
+
+  uint32_t node_idx = ChooseNode(bounds, height);
+  nodes_[node_idx].children.push_back(child_idx);
+  SetParent(height, child_idx, node_idx);
+
+  // Walk back up to the root, splitting any nodes that overflowed. Note that
+  // `AllocateNode` may reallocate `nodes_`, so we don't hold on to references
+  // to nodes across calls to it.
+  while (nodes_[node_idx].children.size() > kMaxChildren) {
+    uint32_t sibling_idx = SplitNode(node_idx);
+    uint32_t parent_idx = nodes_[node_idx].parent;
+    if (parent_idx == kNoIndex) {
+      // We've split the root, so the tree gets taller.
+      parent_idx = AllocateNode(nodes_[node_idx].height + 1);
+      nodes_[parent_idx].children.push_back(node_idx);
+      nodes_[node_idx].parent = parent_idx;
+      root_ = parent_idx;
+    }
+    nodes_[parent_idx].children.push_back(sibling_idx);
+    nodes_[sibling_idx].parent = parent_idx;
+    node_idx = parent_idx;
+  }
+  RecomputeBoundsUpward(node_idx);
+}
+
+template <typename T, uint32_t kMaxChildren>
+uint32_t DynamicRTree<T, kMaxChildren>::ChooseNode(const Rect& bounds,
+                                                   uint32_t height) const {
+  uint32_t node_idx = root_;
+  while (nodes_[node_idx].height > height) {
+    const Node& node = nodes_[node_idx];
+    uint32_t best_child = node.children.front();
+    float best_enlargement = std::numeric_limits<float>::infinity();
+    float best_area = std::numeric_limits<float>::infinity();
+    for (uint32_t child_idx : node.children) {
+      const Rect& child_bounds = nodes_[child_idx].bounds;
+      Rect joined = child_bounds;
+      joined.Join(bounds);
+      float area = child_bounds.Area();
+      float enlargement = joined.Area() - area;
+      if (enlargement < best_enlargement ||
+          (enlargement == best_enlargement && area < best_area)) {
+        best_child = child_idx;
+        best_enlargement = enlargement;
+        best_area = area;
+      }
+    }
+    node_idx = best_child;
+  }
+  return node_idx;
+}
+
+template <typename T, uint32_t kMaxChildren>
+uint32_t DynamicRTree<T, kMaxChildren>::SplitNode(uint32_t node_idx) {
+  uint32_t height = nodes_[node_idx].height;
+  uint32_t sibling_idx = AllocateNode(height);
+  Node& node = nodes_[node_idx];
+  Node& sibling = nodes_[sibling_idx];
+  sibling.parent = node.parent;
+
+  absl::InlinedVector<uint32_t, kMaxChildren + 1> remaining =
+      std::move(node.children);
+  node.children.clear();
+
+  // Pick the pair of children that would waste the most area if they were put
+  // in the same node as the seeds of the two groups.
+  auto joined_area = [](Rect a, const Rect& b) {
+    a.Join(b);
+    return a.Area();
+  };
+  size_t seed_a = 0;
+  size_t seed_b = 1;
+  float worst_waste = -std::numeric_limits<float>::infinity();
+  for (size_t i = 0; i < remaining.size(); ++i) {
+    const Rect& bounds_i = ChildBounds(height, remaining[i]);
+    for (size_t j = i + 1; j < remaining.size(); ++j) {
+      const Rect& bounds_j = ChildBounds(height, remaining[j]);
+      float waste = joined_area(bounds_i, bounds_j) - bounds_i.Area() -
+                    bounds_j.Area();
+      if (waste > worst_waste) {
+        worst_waste = waste;
+        seed_a = i;
+        seed_b = j;
+      }
+    }
+  }
+  node.children.push_back(remaining[seed_a]);
+  sibling.children.push_back(remaining[seed_b]);
+  Rect node_bounds = ChildBounds(height, remaining[seed_a]);
+  Rect sibling_bounds = ChildBounds(height, remaining[seed_b]);
+  // `seed_b` > `seed_a`, so erasing it first doesn't change `seed_a`.
+  remaining.erase(remaining.begin() + seed_b);
+  remaining.erase(remaining.begin() + seed_a);
+
+  while (!remaining.empty()) {
+    // If one group needs all of the remaining children to reach the minimum
+    // size, give them to it.
+    if (node.children.size() + remaining.size() == kMinChildren) {
+      for (uint32_t child_idx : remaining) {
+        node.children.push_back(child_idx);
+        node_bounds.Join(ChildBounds(height, child_idx));
+      }
+      break;
+    }
+    if (sibling.children.size() + remaining.size() == kMinChildren) {
+      for (uint32_t child_idx : remaining) {
+        sibling.children.push_back(child_idx);
+        sibling_bounds.Join(ChildBounds(height, child_idx));
+      }
+      break;
+    }
+
+    // Otherwise, assign the child that has the strongest preference for one
+    // group over the other.
+    size_t best = 0;
+    float best_preference = -1;
+    float best_node_cost = 0;
+    float best_sibling_cost = 0;
+    for (size_t i = 0; i < remaining.size(); ++i) {
+      const Rect& bounds = ChildBounds(height, remaining[i]);
+      float node_cost = joined_area(node_bounds, bounds) - node_bounds.Area();
+      float sibling_cost =
+          joined_area(sibling_bounds, bounds) - sibling_bounds.Area();
+      float preference = std::abs(node_cost - sibling_cost);
+      if (preference > best_preference) {
+        best = i;
+        best_preference = preference;
+        best_node_cost = node_cost;
+        best_sibling_cost = sibling_cost;
+      }
+    }
+    bool add_to_node =
+        best_node_cost != best_sibling_cost
+            ? best_node_cost < best_sibling_cost
+        : node_bounds.Area() != sibling_bounds.Area()
+            ? node_bounds.Area() < sibling_bounds.Area()
+            : node.children.size() <= sibling.children.size();
+    uint32_t child_idx = remaining[best];
+    if (add_to_node) {
+      node.children.push_back(child_idx);
+      node_bounds.Join(ChildBounds(height, child_idx));
+    } else {
+      sibling.children.push_back(child_idx);
+      sibling_bounds.Join(ChildBounds(height, child_idx));
+    }
+    remaining.erase(remaining.begin() + best);
+  }
+
+  node.bounds = node_bounds;
+  sibling.bounds = sibling_bounds;
+  for (uint32_t child_idx : sibling.children) {
+    SetParent(height, child_idx, sibling_idx);
+  }
+  return sibling_idx;
+}
+
+template <typename T, uint32_t kMaxChildren>
+void DynamicRTree<T, kMaxChildren>::DetachElement(uint32_t slot_idx) {
+  uint32_t node_idx = slots_[slot_idx].leaf;
+  {
+    auto& children = nodes_[node_idx].children;
+    children.erase(absl::c_find(children, slot_idx));
+  }
+  slots_[slot_idx].leaf = kNoIndex;
+
+  // Walk up to the root, removing any nodes that have too few children; their
+  // children are set aside to be re-inserted below.
+  absl::InlinedVector<uint32_t, 8> orphaned_nodes;
+  while (node_idx != root_) {
+    uint32_t parent_idx = nodes_[node_idx].parent;
+    if (nodes_[node_idx].children.size() < kMinChildren) {
+      auto& siblings = nodes_[parent_idx].children;
+      siblings.erase(absl::c_find(siblings, node_idx));
+      orphaned_nodes.push_back(node_idx);
+    } else {
+      RecomputeBounds(node_idx);
+    }
+    node_idx = parent_idx;
+  }
+
+  if (nodes_[root_].children.empty()) {
+    // This can only happen when the root is a leaf, since a branch root
+    // always has at least two children, and we remove at most one of them.
+    ABSL_DCHECK(orphaned_nodes.empty());
+    FreeNode(root_);
+    root_ = kNoIndex;
+    return;
+  }
+  RecomputeBounds(root_);
+
+  for (uint32_t orphan_idx : orphaned_nodes) {
+    uint32_t height = nodes_[orphan_idx].height;
+    absl::InlinedVector<uint32_t, kMaxChildren + 1> children =
+        std::move(nodes_[orphan_idx].children);
+    FreeNode(orphan_idx);
+    for (uint32_t child_idx : children) {
+      // Copy the bounds, since inserting may reallocate `nodes_`.
+      Rect bounds = ChildBounds(height, child_idx);
+      InsertChild(child_idx, bounds, height);
+    }
+  }
+
+  // If the root has been left with only one child, that child becomes the new
+  // root.
+  while (nodes_[root_].height > 0 && nodes_[root_].children.size() == 1) {
+    uint32_t old_root = root_;
+    root_ = nodes_[old_root].children.front();
+    nodes_[root_].parent = kNoIndex;
+    FreeNode(old_root);
+  }
+}
+
+template <typename T, uint32_t kMaxChildren>
+bool DynamicRTree<T, kMaxChildren>::VisitIntersectedElementsInSubTree(
+    uint32_t node_idx, const Rect& bounds,
+    absl::FunctionRef<bool(const T&)> visitor) const {
+  const Node& node = nodes_[node_idx];
+  if (node.height == 0) {
+    for (uint32_t slot_idx : node.children) {
+      const ElementSlot& slot = slots_[slot_idx];
+      if (IntersectsInternal(slot.bounds, bounds) && !visitor(*slot.element)) {
+        return false;
+      }
+    }
+  } else {
+    for (uint32_t child_idx : node.children) {
+      if (IntersectsInternal(nodes_[child_idx].bounds, bounds) &&
+          !VisitIntersectedElementsInSubTree(child_idx, bounds, visitor)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+}  // namespace ink::geometry_internal
+
+#endif  // INK_GEOMETRY_INTERNAL_DYNAMIC_RTREE_H_
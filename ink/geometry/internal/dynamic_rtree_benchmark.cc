@@ -0,0 +1,133 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "ink/geometry/internal/dynamic_rtree.h"
+#include "ink/geometry/internal/static_rtree.h"
+#include "ink/geometry/rect.h"
+
+namespace ink::geometry_internal {
+namespace {
+
+// Bounds computation functor for an R-Tree of `Rect`s
+auto rect_bounds = [](const Rect& r) { return r; };
+
+// Returns a pseudo-randomly generated `Rect`, with its center uniformly
+// distributed in the rect from {-1000, -1000} to {1000, 1000}, and its width
+// and height uniformly distributed in the interval [1, 50]; this roughly
+// approximates the bounds of the strokes in a large document.
+Rect MakeRandomRect(std::mt19937_64& rng) {
+  auto rand_between = [&rng](float a, float b) {
+    return std::uniform_real_distribution<float>(a, b)(rng);
+  };
+  return Rect::FromCenterAndDimensions(
+      {rand_between(-1000, 1000), rand_between(-1000, 1000)},
+      rand_between(1, 50), rand_between(1, 50));
+}
+
+// Each iteration erases one element and adds a new one, updating the
+// `DynamicRTree` in place.
+void BM_DynamicRTreeEraseAndAdd(benchmark::State& state) {
+  std::mt19937_64 rng(0);
+  DynamicRTree<Rect> rtree(rect_bounds);
+  std::vector<DynamicRTree<Rect>::ElementId> ids;
+  for (int i = 0; i < state.range(0); ++i) {
+    ids.push_back(rtree.Insert(MakeRandomRect(rng)));
+  }
+  for (auto s : state) {
+    uint32_t i =
+        std::uniform_int_distribution<uint32_t>(0, ids.size() - 1)(rng);
+    rtree.Remove(ids[i]);
+    ids[i] = rtree.Insert(MakeRandomRect(rng));
+  }
+}
+BENCHMARK(BM_DynamicRTreeEraseAndAdd)->Range(1024, 65536);
+
+// Each iteration moves one element, updating the `DynamicRTree` in place.
+void BM_DynamicRTreeUpdate(benchmark::State& state) {
+  std::mt19937_64 rng(0);
+  DynamicRTree<Rect> rtree(rect_bounds);
+  std::vector<DynamicRTree<Rect>::ElementId> ids;
+  for (int i = 0; i < state.range(0); ++i) {
+    ids.push_back(rtree.Insert(MakeRandomRect(rng)));
+  }
+  for (auto s : state) {
+    uint32_t i =
+        std::uniform_int_distribution<uint32_t>(0, ids.size() - 1)(rng);
+    rtree.Update(ids[i], MakeRandomRect(rng));
+  }
+}
+BENCHMARK(BM_DynamicRTreeUpdate)->Range(1024, 65536);
+
+// Each iteration replaces one element and rebuilds a `StaticRTree` from
+// scratch, which is the only way to edit one.
+void BM_StaticRTreeRebuildOnEdit(benchmark::State& state) {
+  std::mt19937_64 rng(0);
+  std::vector<Rect> rects;
+  for (int i = 0; i < state.range(0); ++i) {
+    rects.push_back(MakeRandomRect(rng));
+  }
+  for (auto s : state) {
+    uint32_t i =
+        std::uniform_int_distribution<uint32_t>(0, rects.size() - 1)(rng);
+    rects[i] = MakeRandomRect(rng);
+    StaticRTree<Rect> rtree(rects, rect_bounds);
+    benchmark::DoNotOptimize(rtree);
+  }
+}
+BENCHMARK(BM_StaticRTreeRebuildOnEdit)->Range(1024, 65536);
+
+// Queries with a viewport-sized rect, to compare the query cost of the two
+// trees.
+void BM_DynamicRTreeQuery(benchmark::State& state) {
+  std::mt19937_64 rng(0);
+  DynamicRTree<Rect> rtree(rect_bounds);
+  for (int i = 0; i < state.range(0); ++i) rtree.Insert(MakeRandomRect(rng));
+  Rect viewport = Rect::FromTwoPoints({-100, -100}, {100, 100});
+  int n_hits = 0;
+  for (auto s : state) {
+    rtree.VisitIntersectedElements(viewport, [&n_hits](const Rect&) {
+      ++n_hits;
+      return true;
+    });
+    benchmark::DoNotOptimize(n_hits);
+  }
+}
+BENCHMARK(BM_DynamicRTreeQuery)->Range(1024, 65536);
+
+void BM_StaticRTreeQuery(benchmark::State& state) {
+  std::mt19937_64 rng(0);
+  std::vector<Rect> rects;
+  for (int i = 0; i < state.range(0); ++i) {
+    rects.push_back(MakeRandomRect(rng));
+  }
+  StaticRTree<Rect> rtree(rects, rect_bounds);
+  Rect viewport = Rect::FromTwoPoints({-100, -100}, {100, 100});
+  int n_hits = 0;
+  for (auto s : state) {
+    rtree.VisitIntersectedElements(viewport, [&n_hits](const Rect&) {
+      ++n_hits;
+      return true;
+    });
+    benchmark::DoNotOptimize(n_hits);
+  }
+}
+BENCHMARK(BM_StaticRTreeQuery)->Range(1024, 65536);
+
+}  // namespace
+}  // namespace ink::geometry_internal
@@ -0,0 +1,245 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ink/geometry/internal/dynamic_rtree.h"
+
+#include <cstdint>
+#include <iterator>
+#include <random>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/container/flat_hash_map.h"
+#include "ink/geometry/internal/intersects_internal.h"
+#include "ink/geometry/point.h"
+#include "ink/geometry/rect.h"
+#include "ink/geometry/type_matchers.h"
+
+namespace ink::geometry_internal {
+namespace {
+
+using ::testing::IsEmpty;
+using ::testing::Matcher;
+using ::testing::UnorderedElementsAre;
+using ::testing::UnorderedElementsAreArray;
+
+// Convenience alias for a `DynamicRTree` of `Points`. We use a small value for
+// `kMaxChildren` so that we can test trees of different heights without
+// needing thousands of elements.
+using PointRTree = DynamicRTree<Point, 4>;
+
+// Bounds computation functor for a `DynamicRTree` of `Point`s
+auto point_bounds = [](const Point& p) {
+  return Rect::FromCenterAndDimensions(p, 0, 0);
+};
+
+// Returns all the elements in `rtree` that intersect `r`.
+template <typename RTree>
+std::vector<Point> GetIntersectedPoints(const RTree& rtree, const Rect& r) {
+  std::vector<Point> intersected_points;
+  rtree.VisitIntersectedElements(r, [&intersected_points](const Point& p) {
+    intersected_points.push_back(p);
+    return true;
+  });
+  return intersected_points;
+}
+
+TEST(DynamicRTreeTest, EmptyTree) {
+  PointRTree rtree(point_bounds);
+
+  EXPECT_TRUE(rtree.IsEmpty());
+  EXPECT_EQ(rtree.Size(), 0);
+  EXPECT_EQ(rtree.Height(), 0);
+  EXPECT_FALSE(rtree.Contains(0));
+  EXPECT_THAT(
+      GetIntersectedPoints(rtree, Rect::FromTwoPoints({-10, -10}, {10, 10})),
+      IsEmpty());
+}
+
+TEST(DynamicRTreeTest, InsertAndQuery) {
+  PointRTree rtree(point_bounds);
+  std::vector<Point> points{{1, 2}, {7, 8}, {0, 5}, {8, 4}, {2, 6},
+                            {8, 6}, {9, 1}, {6, 4}, {9, 0}, {8, 2},
+                            {7, 4}, {5, 1}, {7, 7}, {6, 8}, {3, 1},
+                            {3, 3}, {4, 6}, {6, 0}, {9, 5}, {9, 8}};
+  for (Point p : points) rtree.Insert(p);
+
+  EXPECT_EQ(rtree.Size(), 20);
+  EXPECT_GT(rtree.Height(), 1);
+  EXPECT_THAT(
+      GetIntersectedPoints(rtree, Rect::FromTwoPoints({20, 20}, {25, 25})),
+      IsEmpty());
+  EXPECT_THAT(GetIntersectedPoints(rtree, Rect::FromTwoPoints({2, 4}, {3, 5})),
+              IsEmpty());
+  EXPECT_THAT(
+      GetIntersectedPoints(rtree, Rect::FromTwoPoints({-10, -10}, {30, 30})),
+      UnorderedElementsAreArray(points));
+  EXPECT_THAT(GetIntersectedPoints(rtree, Rect::FromTwoPoints({2, 0}, {6, 5})),
+              UnorderedElementsAre(Point{3, 1}, Point{3, 3}, Point{5, 1},
+                                   Point{6, 0}, Point{6, 4}));
+}
+
+TEST(DynamicRTreeTest, RemoveAndUpdate) {
+  PointRTree rtree(point_bounds);
+  PointRTree::ElementId a = rtree.Insert({1, 1});
+  PointRTree::ElementId b = rtree.Insert({2, 2});
+  PointRTree::ElementId c = rtree.Insert({3, 3});
+  Rect everything = Rect::FromTwoPoints({-10, -10}, {10, 10});
+
+  rtree.Remove(b);
+  EXPECT_FALSE(rtree.Contains(b));
+  EXPECT_EQ(rtree.Size(), 2);
+  EXPECT_THAT(GetIntersectedPoints(rtree, everything),
+              UnorderedElementsAre(Point{1, 1}, Point{3, 3}));
+
+  rtree.Update(c, {-5, -5});
+  EXPECT_TRUE(rtree.Contains(c));
+  EXPECT_EQ(rtree.Get(c), (Point{-5, -5}));
+  EXPECT_THAT(GetIntersectedPoints(rtree, everything),
+              UnorderedElementsAre(Point{1, 1}, Point{-5, -5}));
+  EXPECT_THAT(GetIntersectedPoints(rtree, Rect::FromTwoPoints({2, 2}, {4, 4})),
+              IsEmpty());
+
+  rtree.Remove(a);
+  rtree.Remove(c);
+  EXPECT_TRUE(rtree.IsEmpty());
+  EXPECT_EQ(rtree.Height(), 0);
+  EXPECT_THAT(GetIntersectedPoints(rtree, everything), IsEmpty());
+}
+
+TEST(DynamicRTreeTest, VisitIntersectedElementsStopEarly) {
+  PointRTree rtree(point_bounds);
+  for (Point p : {Point{0, 0}, Point{2, 0}, Point{1, 1}, Point{4, 1},
+                  Point{3, 2}, Point{1, 3}, Point{2, 4}}) {
+    rtree.Insert(p);
+  }
+
+  std::vector<Point> visited;
+  rtree.VisitIntersectedElements(Rect::FromTwoPoints({1, 1}, {4, 4}),
+                                 [&visited](const Point& p) {
+                                   visited.push_back(p);
+                                   return visited.size() < 3;
+                                 });
+
+  EXPECT_EQ(visited.size(), 3);
+}
+
+TEST(DynamicRTreeTest, RandomEditsMatchBruteForce) {
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<float> coord(-100, 100);
+  std::uniform_real_distribution<float> size(0, 10);
+  auto random_rect = [&]() {
+    return Rect::FromCenterAndDimensions({coord(rng), coord(rng)}, size(rng),
+                                         size(rng));
+  };
+  DynamicRTree<Rect, 6> rtree([](const Rect& r) { return r; });
+  absl::flat_hash_map<uint32_t, Rect> expected;
+
+  for (int i = 0; i < 5000; ++i) {
+    int op = std::uniform_int_distribution<int>(0, 9)(rng);
+    if (expected.empty() || op < 5) {
+      Rect r = random_rect();
+      uint32_t id = rtree.Insert(r);
+      ASSERT_FALSE(expected.contains(id));
+      expected[id] = r;
+    } else {
+      auto it = std::next(expected.begin(),
+                          std::uniform_int_distribution<int>(
+                              0, expected.size() - 1)(rng));
+      if (op < 8) {
+        rtree.Remove(it->first);
+        expected.erase(it);
+      } else {
+        Rect r = random_rect();
+        rtree.Update(it->first, r);
+        it->second = r;
+      }
+    }
+    ASSERT_EQ(rtree.Size(), expected.size());
+
+    if (i % 100 == 0) {
+      Rect query = Rect::FromCenterAndDimensions({coord(rng), coord(rng)}, 60,
+                                                 60);
+      std::vector<Rect> actual;
+      rtree.VisitIntersectedElements(query, [&actual](const Rect& r) {
+        actual.push_back(r);
+        return true;
+      });
+      std::vector<Matcher<Rect>> brute_force;
+      for (const auto& [id, r] : expected) {
+        EXPECT_TRUE(rtree.Contains(id));
+        if (IntersectsInternal(r, query)) brute_force.push_back(RectEq(r));
+      }
+      ASSERT_THAT(actual, UnorderedElementsAreArray(brute_force))
+          << "at step " << i;
+    }
+  }
+}
+
+TEST(DynamicRTreeTest, HeightIsLogarithmic) {
+  DynamicRTree<Point> rtree(point_bounds);
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<float> coord(-100, 100);
+  std::vector<DynamicRTree<Point>::ElementId> ids;
+  for (int i = 0; i < 10000; ++i) {
+    ids.push_back(rtree.Insert({coord(rng), coord(rng)}));
+  }
+  // With at least 6 children per non-root node, 10000 elements need no more
+  // than ceil(log_6(10000)) + 1 = 7 levels.
+  EXPECT_LE(rtree.Height(), 7);
+
+  for (int i = 0; i < 9990; ++i) rtree.Remove(ids[i]);
+  EXPECT_EQ(rtree.Size(), 10);
+  EXPECT_LE(rtree.Height(), 2);
+}
+
+TEST(DynamicRTreeTest, ReusesIdsOfRemovedElements) {
+  PointRTree rtree(point_bounds);
+  PointRTree::ElementId a = rtree.Insert({1, 1});
+  rtree.Insert({2, 2});
+  rtree.Remove(a);
+
+  EXPECT_EQ(rtree.Insert({3, 3}), a);
+  EXPECT_EQ(rtree.Get(a), (Point{3, 3}));
+}
+
+TEST(DynamicRTreeTest, Clear) {
+  PointRTree rtree(point_bounds);
+  for (int i = 0; i < 20; ++i) rtree.Insert({static_cast<float>(i), 0});
+
+  rtree.Clear();
+
+  EXPECT_TRUE(rtree.IsEmpty());
+  EXPECT_THAT(
+      GetIntersectedPoints(rtree, Rect::FromTwoPoints({-10, -10}, {30, 30})),
+      IsEmpty());
+}
+
+TEST(DynamicRTreeDeathTest, CannotConstructWithNullBoundsFunction) {
+  EXPECT_DEATH_IF_SUPPORTED(PointRTree(nullptr), "bounds_func");
+}
+
+TEST(DynamicRTreeDeathTest, CannotRemoveMissingElement) {
+  PointRTree rtree(point_bounds);
+  PointRTree::ElementId id = rtree.Insert({1, 1});
+  rtree.Remove(id);
+
+  EXPECT_DEATH_IF_SUPPORTED(rtree.Remove(id), "No element");
+  EXPECT_DEATH_IF_SUPPORTED(rtree.Update(id, {2, 2}), "No element");
+  EXPECT_DEATH_IF_SUPPORTED(rtree.Get(id), "No element");
+}
+
+}  // namespace
+}  // namespace ink::geometry_internal
@@ -90,7 +90,9 @@ JNI_METHOD(geometry, MeshNative, jint, getVertexCount)
 JNI_METHOD(geometry, MeshNative, jobject, createRawTriangleIndexBuffer)
 (JNIEnv* env, jclass clazz, jlong raw_ptr_to_mesh) {
   const Mesh* mesh = GetMesh(raw_ptr_to_mesh);
-  // `Mesh`'s indices should always be two bytes each.
+  // Meshes exposed to Kotlin never use
+  // `MeshFormat::IndexFormat::k32BitUnpacked32BitPacked`, so their indices are
+  // always two bytes each.
   ABSL_CHECK_EQ(mesh->IndexStride(), 2);
   const absl::Span<const std::byte> raw_triangle_index_data =
       mesh->RawIndexData();
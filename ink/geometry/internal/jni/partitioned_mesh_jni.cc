@@ -116,8 +116,9 @@ JNI_METHOD(geometry, PartitionedMeshNative, void,
   absl::Span<const PartitionedMesh::VertexIndexPair> outline =
       partitioned_mesh->Outline(group_index, outline_index);
   PartitionedMesh::VertexIndexPair index_pair = outline[outline_vertex_index];
-  jint mesh_index_and_mesh_vertex_index[] = {index_pair.mesh_index,
-                                             index_pair.vertex_index};
+  jint mesh_index_and_mesh_vertex_index[] = {
+      static_cast<jint>(index_pair.mesh_index),
+      static_cast<jint>(index_pair.vertex_index)};
   env->SetIntArrayRegion(out_mesh_index_and_mesh_vertex_index, 0, 2,
                          mesh_index_and_mesh_vertex_index);
 }
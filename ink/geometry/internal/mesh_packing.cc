@@ -14,6 +14,7 @@
 
 #include "ink/geometry/internal/mesh_packing.h"
 
+#include <algorithm>
 #include <array>
 #include <cmath>
 #include <cstddef>
@@ -62,18 +63,6 @@ bool PackedFloatValuesAreFinite(MeshFormat::AttributeType type,
   return absl::c_all_of(packed_floats.Values(), ink_internal::IsFinite);
 }
 
-bool IsValidCodingParams(MeshFormat::AttributeType type,
-                         const MeshAttributeCodingParams& coding_params) {
-  // Offset and scale are ignored for unpacked types.
-  if (MeshFormat::IsUnpackedType(type)) return true;
-  if (coding_params.components.Size() != MeshFormat::ComponentCount(type))
-    return false;
-  return absl::c_all_of(
-      coding_params.components.Values(), [](const ComponentCodingParams& c) {
-        return std::isfinite(c.offset) && std::isfinite(c.scale) && c.scale > 0;
-      });
-}
-
 bool UnpackedFloatValuesAreRepresentable(
     MeshFormat::AttributeType type,
     const MeshAttributeCodingParams& packing_params,
@@ -97,202 +86,200 @@ bool UnpackedFloatValuesAreRepresentable(
   return true;
 }
 
-void PackFloat1PackedIn1UnsignedByte(
-    const MeshAttributeCodingParams& packing_params,
-    const SmallArray<float, 4>& unpacked_value,
-    absl::Span<std::byte> packed_bytes) {
+// The integers packed into an attribute value, one per component. Only the
+// first `MeshFormat::ComponentCount(type)` elements are used.
+using PackedIntegers = std::array<uint32_t, 4>;
+
+// The functions below write the integers of a packed attribute value to
+// `packed_bytes`, per the packing scheme of the attribute type in their name.
+// See `MeshFormat::AttributeType` for more details.
+
+void WriteFloat1PackedIn1UnsignedByte(const PackedIntegers& packed,
+                                      absl::Span<std::byte> packed_bytes) {
   ABSL_DCHECK(MeshFormat::PackedBitsPerComponent(
                   MeshFormat::AttributeType::kFloat1PackedIn1UnsignedByte)
                   .value_or(SmallArray<uint8_t, 4>({0})) ==
               (SmallArray<uint8_t, 4>({8})));
-  packed_bytes[0] = static_cast<std::byte>(
-      PackSingleFloat(packing_params.components[0], unpacked_value[0]));
+  packed_bytes[0] = static_cast<std::byte>(packed[0]);
 }
 
-void PackFloat2PackedIn1Float(const MeshAttributeCodingParams& packing_params,
-                              const SmallArray<float, 4>& unpacked_value,
-                              absl::Span<std::byte> packed_bytes) {
-  uint32_t packed0 =
-      PackSingleFloat(packing_params.components[0], unpacked_value[0]);
-  uint32_t packed1 =
-      PackSingleFloat(packing_params.components[1], unpacked_value[1]);
+void WriteFloat2PackedIn1Float(const PackedIntegers& packed,
+                               absl::Span<std::byte> packed_bytes) {
   ABSL_DCHECK(MeshFormat::PackedBitsPerComponent(
                   MeshFormat::AttributeType::kFloat2PackedIn1Float)
                   .value_or(SmallArray<uint8_t, 4>({0, 0})) ==
               (SmallArray<uint8_t, 4>({12, 12})));
-  float packed_float = {static_cast<float>(packed0 << 12 | packed1)};
+  float packed_float = {static_cast<float>(packed[0] << 12 | packed[1])};
   ABSL_DCHECK_EQ(packed_bytes.size(), sizeof(float));
   std::memcpy(packed_bytes.data(), &packed_float, sizeof(float));
 }
 
-void PackFloat2PackedIn3UnsignedBytes_XY12(
-    const MeshAttributeCodingParams& packing_params,
-    const SmallArray<float, 4>& unpacked_value,
-    absl::Span<std::byte> packed_bytes) {
-  uint32_t packed0 =
-      PackSingleFloat(packing_params.components[0], unpacked_value[0]);
-  uint32_t packed1 =
-      PackSingleFloat(packing_params.components[1], unpacked_value[1]);
+void WriteFloat2PackedIn3UnsignedBytes_XY12(
+    const PackedIntegers& packed, absl::Span<std::byte> packed_bytes) {
   ABSL_DCHECK(MeshFormat::PackedBitsPerComponent(
                   MeshFormat::AttributeType::kFloat2PackedIn3UnsignedBytes_XY12)
                   .value_or(SmallArray<uint8_t, 4>({0, 0})) ==
               (SmallArray<uint8_t, 4>({12, 12})));
-  packed_bytes[0] = static_cast<std::byte>(packed0 >> 4);
+  packed_bytes[0] = static_cast<std::byte>(packed[0] >> 4);
   packed_bytes[1] =
-      static_cast<std::byte>(((packed0 & 0xF) << 4) + (packed1 >> 8));
-  packed_bytes[2] = static_cast<std::byte>(packed1 & 0xFF);
+      static_cast<std::byte>(((packed[0] & 0xF) << 4) + (packed[1] >> 8));
+  packed_bytes[2] = static_cast<std::byte>(packed[1] & 0xFF);
 }
 
-void PackFloat3PackedIn4UnsignedBytes_XYZ10(
-    const MeshAttributeCodingParams& packing_params,
-    const SmallArray<float, 4>& unpacked_value,
-    absl::Span<std::byte> packed_bytes) {
-  uint32_t packed0 =
-      PackSingleFloat(packing_params.components[0], unpacked_value[0]);
-  uint32_t packed1 =
-      PackSingleFloat(packing_params.components[1], unpacked_value[1]);
-  uint32_t packed2 =
-      PackSingleFloat(packing_params.components[2], unpacked_value[2]);
+void WriteFloat3PackedIn4UnsignedBytes_XYZ10(
+    const PackedIntegers& packed, absl::Span<std::byte> packed_bytes) {
   ABSL_DCHECK(
       MeshFormat::PackedBitsPerComponent(
           MeshFormat::AttributeType::kFloat3PackedIn4UnsignedBytes_XYZ10)
           .value_or(SmallArray<uint8_t, 4>({0, 0, 0})) ==
       (SmallArray<uint8_t, 4>({10, 10, 10})));
-  packed_bytes[0] = static_cast<std::byte>(packed0 >> 2);
+  packed_bytes[0] = static_cast<std::byte>(packed[0] >> 2);
   packed_bytes[1] =
-      static_cast<std::byte>(((packed0 & 0x03) << 6) + (packed1 >> 4));
+      static_cast<std::byte>(((packed[0] & 0x03) << 6) + (packed[1] >> 4));
   packed_bytes[2] =
-      static_cast<std::byte>(((packed1 & 0x0F) << 4) + (packed2 >> 6));
-  packed_bytes[3] = static_cast<std::byte>((packed2 & 0x3F) << 2);
+      static_cast<std::byte>(((packed[1] & 0x0F) << 4) + (packed[2] >> 6));
+  packed_bytes[3] = static_cast<std::byte>((packed[2] & 0x3F) << 2);
 }
 
-void PackFloat2PackedIn4UnsignedBytes_X12_Y20(
-    const MeshAttributeCodingParams& packing_params,
-    const SmallArray<float, 4>& unpacked_value,
-    absl::Span<std::byte> packed_bytes) {
-  uint32_t packed0 =
-      PackSingleFloat(packing_params.components[0], unpacked_value[0]);
-  uint32_t packed1 =
-      PackSingleFloat(packing_params.components[1], unpacked_value[1]);
+void WriteFloat2PackedIn4UnsignedBytes_X12_Y20(
+    const PackedIntegers& packed, absl::Span<std::byte> packed_bytes) {
   ABSL_DCHECK(
       MeshFormat::PackedBitsPerComponent(
           MeshFormat::AttributeType::kFloat2PackedIn4UnsignedBytes_X12_Y20)
           .value_or(SmallArray<uint8_t, 4>({0, 0})) ==
       (SmallArray<uint8_t, 4>({12, 20})));
-  packed_bytes[0] = static_cast<std::byte>(packed0 >> 4);
+  packed_bytes[0] = static_cast<std::byte>(packed[0] >> 4);
   packed_bytes[1] =
-      static_cast<std::byte>(((packed0 & 0xF) << 4) + (packed1 >> 16));
-  packed_bytes[2] = static_cast<std::byte>((packed1 & 0xFF00) >> 8);
-  packed_bytes[3] = static_cast<std::byte>(packed1 & 0xFF);
+      static_cast<std::byte>(((packed[0] & 0xF) << 4) + (packed[1] >> 16));
+  packed_bytes[2] = static_cast<std::byte>((packed[1] & 0xFF00) >> 8);
+  packed_bytes[3] = static_cast<std::byte>(packed[1] & 0xFF);
 }
 
-void PackFloat3PackedIn1Float(const MeshAttributeCodingParams& packing_params,
-                              const SmallArray<float, 4>& unpacked_value,
-                              absl::Span<std::byte> packed_bytes) {
-  uint32_t packed0 =
-      PackSingleFloat(packing_params.components[0], unpacked_value[0]);
-  uint32_t packed1 =
-      PackSingleFloat(packing_params.components[1], unpacked_value[1]);
-  uint32_t packed2 =
-      PackSingleFloat(packing_params.components[2], unpacked_value[2]);
+void WriteFloat3PackedIn1Float(const PackedIntegers& packed,
+                               absl::Span<std::byte> packed_bytes) {
   ABSL_DCHECK(MeshFormat::PackedBitsPerComponent(
                   MeshFormat::AttributeType::kFloat3PackedIn1Float)
                   .value_or(SmallArray<uint8_t, 4>({0, 0, 0})) ==
               (SmallArray<uint8_t, 4>({8, 8, 8})));
   float packed_float = {
-      static_cast<float>(packed0 << 16 | packed1 << 8 | packed2)};
+      static_cast<float>(packed[0] << 16 | packed[1] << 8 | packed[2])};
   ABSL_DCHECK_EQ(packed_bytes.size(), sizeof(float));
   std::memcpy(packed_bytes.data(), &packed_float, sizeof(float));
 }
 
-void PackFloat3PackedIn2Floats(const MeshAttributeCodingParams& packing_params,
-                               const SmallArray<float, 4>& unpacked_value,
-                               absl::Span<std::byte> packed_bytes) {
-  uint32_t packed0 =
-      PackSingleFloat(packing_params.components[0], unpacked_value[0]);
-  uint32_t packed1 =
-      PackSingleFloat(packing_params.components[1], unpacked_value[1]);
-  uint32_t packed2 =
-      PackSingleFloat(packing_params.components[2], unpacked_value[2]);
+void WriteFloat3PackedIn2Floats(const PackedIntegers& packed,
+                                absl::Span<std::byte> packed_bytes) {
   ABSL_DCHECK(MeshFormat::PackedBitsPerComponent(
                   MeshFormat::AttributeType::kFloat3PackedIn2Floats)
                   .value_or(SmallArray<uint8_t, 4>({0, 0, 0})) ==
               (SmallArray<uint8_t, 4>({16, 16, 16})));
   std::array<float, 2> floats = {
-      static_cast<float>(packed0 << 8 | packed1 >> 8),
-      static_cast<float>((packed1 & 0x000000FF) << 16 | packed2)};
+      static_cast<float>(packed[0] << 8 | packed[1] >> 8),
+      static_cast<float>((packed[1] & 0x000000FF) << 16 | packed[2])};
   ABSL_DCHECK_EQ(packed_bytes.size(), sizeof(float) * 2);
   std::memcpy(packed_bytes.data(), floats.data(), sizeof(float) * 2);
 }
 
-void PackFloat4PackedIn1Float(const MeshAttributeCodingParams& packing_params,
-                              const SmallArray<float, 4>& unpacked_value,
-                              absl::Span<std::byte> packed_bytes) {
-  uint32_t packed0 =
-      PackSingleFloat(packing_params.components[0], unpacked_value[0]);
-  uint32_t packed1 =
-      PackSingleFloat(packing_params.components[1], unpacked_value[1]);
-  uint32_t packed2 =
-      PackSingleFloat(packing_params.components[2], unpacked_value[2]);
-  uint32_t packed3 =
-      PackSingleFloat(packing_params.components[3], unpacked_value[3]);
+void WriteFloat4PackedIn1Float(const PackedIntegers& packed,
+                               absl::Span<std::byte> packed_bytes) {
   ABSL_DCHECK(MeshFormat::PackedBitsPerComponent(
                   MeshFormat::AttributeType::kFloat4PackedIn1Float)
                   .value_or(SmallArray<uint8_t, 4>({0, 0, 0, 0})) ==
               (SmallArray<uint8_t, 4>({6, 6, 6, 6})));
-  float packed_float = {static_cast<float>(packed0 << 18 | packed1 << 12 |
-                                           packed2 << 6 | packed3)};
+  float packed_float = {static_cast<float>(packed[0] << 18 | packed[1] << 12 |
+                                           packed[2] << 6 | packed[3])};
   ABSL_DCHECK_EQ(packed_bytes.size(), sizeof(float));
   std::memcpy(packed_bytes.data(), &packed_float, sizeof(float));
 }
 
-void PackFloat4PackedIn2Floats(const MeshAttributeCodingParams& packing_params,
-                               const SmallArray<float, 4>& unpacked_value,
-                               absl::Span<std::byte> packed_bytes) {
-  uint32_t packed0 =
-      PackSingleFloat(packing_params.components[0], unpacked_value[0]);
-  uint32_t packed1 =
-      PackSingleFloat(packing_params.components[1], unpacked_value[1]);
-  uint32_t packed2 =
-      PackSingleFloat(packing_params.components[2], unpacked_value[2]);
-  uint32_t packed3 =
-      PackSingleFloat(packing_params.components[3], unpacked_value[3]);
+void WriteFloat4PackedIn2Floats(const PackedIntegers& packed,
+                                absl::Span<std::byte> packed_bytes) {
   ABSL_DCHECK(MeshFormat::PackedBitsPerComponent(
                   MeshFormat::AttributeType::kFloat4PackedIn2Floats)
                   .value_or(SmallArray<uint8_t, 4>({0, 0, 0, 0})) ==
               (SmallArray<uint8_t, 4>({12, 12, 12, 12})));
-  std::array<float, 2> floats = {static_cast<float>(packed0 << 12 | packed1),
-                                 static_cast<float>(packed2 << 12 | packed3)};
+  std::array<float, 2> floats = {
+      static_cast<float>(packed[0] << 12 | packed[1]),
+      static_cast<float>(packed[2] << 12 | packed[3])};
   ABSL_DCHECK_EQ(packed_bytes.size(), sizeof(float) * 2);
   std::memcpy(packed_bytes.data(), floats.data(), sizeof(float) * 2);
 }
 
-void PackFloat4PackedIn3Floats(const MeshAttributeCodingParams& packing_params,
-                               const SmallArray<float, 4>& unpacked_value,
-                               absl::Span<std::byte> packed_bytes) {
-  uint32_t packed0 =
-      PackSingleFloat(packing_params.components[0], unpacked_value[0]);
-  uint32_t packed1 =
-      PackSingleFloat(packing_params.components[1], unpacked_value[1]);
-  uint32_t packed2 =
-      PackSingleFloat(packing_params.components[2], unpacked_value[2]);
-  uint32_t packed3 =
-      PackSingleFloat(packing_params.components[3], unpacked_value[3]);
+void WriteFloat4PackedIn3Floats(const PackedIntegers& packed,
+                                absl::Span<std::byte> packed_bytes) {
   ABSL_DCHECK(MeshFormat::PackedBitsPerComponent(
                   MeshFormat::AttributeType::kFloat4PackedIn3Floats)
                   .value_or(SmallArray<uint8_t, 4>({0, 0, 0, 0})) ==
               (SmallArray<uint8_t, 4>({18, 18, 18, 18})));
   std::array<float, 3> floats = {
-      static_cast<float>(packed0 << 6 | packed1 >> 12),
-      static_cast<float>((packed1 & 0x00000FFF) << 12 | packed2 >> 6),
-      static_cast<float>((packed2 & 0x0000003F) << 18 | packed3),
+      static_cast<float>(packed[0] << 6 | packed[1] >> 12),
+      static_cast<float>((packed[1] & 0x00000FFF) << 12 | packed[2] >> 6),
+      static_cast<float>((packed[2] & 0x0000003F) << 18 | packed[3]),
   };
   ABSL_DCHECK_EQ(packed_bytes.size(), sizeof(float) * 3);
   std::memcpy(packed_bytes.data(), floats.data(), sizeof(float) * 3);
 }
 
+// Calls `write_packed_integers` with the writer function for `type`, which must
+// be a packed type. This is used to dispatch on the type once per attribute,
+// rather than once per vertex, when packing many vertices.
+template <typename WritePackedIntegersVisitor>
+void VisitPackedIntegerWriter(
+    MeshFormat::AttributeType type,
+    WritePackedIntegersVisitor&& write_packed_integers) {
+  switch (type) {
+    case MeshFormat::AttributeType::kFloat1Unpacked:
+    case MeshFormat::AttributeType::kFloat2Unpacked:
+    case MeshFormat::AttributeType::kFloat3Unpacked:
+    case MeshFormat::AttributeType::kFloat4Unpacked:
+      break;
+    case MeshFormat::AttributeType::kFloat1PackedIn1UnsignedByte:
+      write_packed_integers(WriteFloat1PackedIn1UnsignedByte);
+      return;
+    case MeshFormat::AttributeType::kFloat2PackedIn1Float:
+      write_packed_integers(WriteFloat2PackedIn1Float);
+      return;
+    case MeshFormat::AttributeType::kFloat2PackedIn3UnsignedBytes_XY12:
+      write_packed_integers(WriteFloat2PackedIn3UnsignedBytes_XY12);
+      return;
+    case MeshFormat::AttributeType::kFloat2PackedIn4UnsignedBytes_X12_Y20:
+      write_packed_integers(WriteFloat2PackedIn4UnsignedBytes_X12_Y20);
+      return;
+    case MeshFormat::AttributeType::kFloat3PackedIn1Float:
+      write_packed_integers(WriteFloat3PackedIn1Float);
+      return;
+    case MeshFormat::AttributeType::kFloat3PackedIn2Floats:
+      write_packed_integers(WriteFloat3PackedIn2Floats);
+      return;
+    case MeshFormat::AttributeType::kFloat3PackedIn4UnsignedBytes_XYZ10:
+      write_packed_integers(WriteFloat3PackedIn4UnsignedBytes_XYZ10);
+      return;
+    case MeshFormat::AttributeType::kFloat4PackedIn1Float:
+      write_packed_integers(WriteFloat4PackedIn1Float);
+      return;
+    case MeshFormat::AttributeType::kFloat4PackedIn2Floats:
+      write_packed_integers(WriteFloat4PackedIn2Floats);
+      return;
+    case MeshFormat::AttributeType::kFloat4PackedIn3Floats:
+      write_packed_integers(WriteFloat4PackedIn3Floats);
+      return;
+  }
+  ABSL_LOG(FATAL) << "Not a packed AttributeType: " << type;
+}
 }  // namespace
 
+bool IsValidCodingParams(MeshFormat::AttributeType type,
+                         const MeshAttributeCodingParams& coding_params) {
+  // Offset and scale are ignored for unpacked types.
+  if (MeshFormat::IsUnpackedType(type)) return true;
+  if (coding_params.components.Size() != MeshFormat::ComponentCount(type))
+    return false;
+  return absl::c_all_of(
+      coding_params.components.Values(), [](const ComponentCodingParams& c) {
+        return std::isfinite(c.offset) && std::isfinite(c.scale) && c.scale > 0;
+      });
+}
+
 uint32_t PackSingleFloat(const ComponentCodingParams& packing_params,
                          float value) {
   return std::round((value - packing_params.offset) / packing_params.scale);
@@ -308,51 +295,20 @@ void PackAttribute(MeshFormat::AttributeType type,
   ABSL_DCHECK(ValuesAreFinite(unpacked_value));
   ABSL_DCHECK(UnpackedFloatValuesAreRepresentable(type, packing_params,
                                                   unpacked_value));
-  switch (type) {
-    case MeshFormat::AttributeType::kFloat1Unpacked:
-    case MeshFormat::AttributeType::kFloat2Unpacked:
-    case MeshFormat::AttributeType::kFloat3Unpacked:
-    case MeshFormat::AttributeType::kFloat4Unpacked:
-      ABSL_DCHECK_EQ(packed_bytes.size(),
-                     sizeof(float) * unpacked_value.Size());
-      std::memcpy(packed_bytes.data(), unpacked_value.Values().data(),
-                  sizeof(float) * unpacked_value.Size());
-      break;
-    case MeshFormat::AttributeType::kFloat1PackedIn1UnsignedByte:
-      PackFloat1PackedIn1UnsignedByte(packing_params, unpacked_value,
-                                      packed_bytes);
-      break;
-    case MeshFormat::AttributeType::kFloat2PackedIn1Float:
-      PackFloat2PackedIn1Float(packing_params, unpacked_value, packed_bytes);
-      break;
-    case MeshFormat::AttributeType::kFloat2PackedIn3UnsignedBytes_XY12:
-      PackFloat2PackedIn3UnsignedBytes_XY12(packing_params, unpacked_value,
-                                            packed_bytes);
-      break;
-    case MeshFormat::AttributeType::kFloat2PackedIn4UnsignedBytes_X12_Y20:
-      PackFloat2PackedIn4UnsignedBytes_X12_Y20(packing_params, unpacked_value,
-                                               packed_bytes);
-      break;
-    case MeshFormat::AttributeType::kFloat3PackedIn1Float:
-      PackFloat3PackedIn1Float(packing_params, unpacked_value, packed_bytes);
-      break;
-    case MeshFormat::AttributeType::kFloat3PackedIn2Floats:
-      PackFloat3PackedIn2Floats(packing_params, unpacked_value, packed_bytes);
-      break;
-    case MeshFormat::AttributeType::kFloat3PackedIn4UnsignedBytes_XYZ10:
-      PackFloat3PackedIn4UnsignedBytes_XYZ10(packing_params, unpacked_value,
-                                             packed_bytes);
-      break;
-    case MeshFormat::AttributeType::kFloat4PackedIn1Float:
-      PackFloat4PackedIn1Float(packing_params, unpacked_value, packed_bytes);
-      break;
-    case MeshFormat::AttributeType::kFloat4PackedIn2Floats:
-      PackFloat4PackedIn2Floats(packing_params, unpacked_value, packed_bytes);
-      break;
-    case MeshFormat::AttributeType::kFloat4PackedIn3Floats:
-      PackFloat4PackedIn3Floats(packing_params, unpacked_value, packed_bytes);
-      break;
+  if (MeshFormat::IsUnpackedType(type)) {
+    ABSL_DCHECK_EQ(packed_bytes.size(), sizeof(float) * unpacked_value.Size());
+    std::memcpy(packed_bytes.data(), unpacked_value.Values().data(),
+                sizeof(float) * unpacked_value.Size());
+    return;
+  }
+  PackedIntegers packed = {};
+  for (int i = 0; i < unpacked_value.Size(); ++i) {
+    packed[i] =
+        PackSingleFloat(packing_params.components[i], unpacked_value[i]);
   }
+  VisitPackedIntegerWriter(type, [&packed, packed_bytes](auto write) {
+    write(packed, packed_bytes);
+  });
 }
 
 namespace {
@@ -418,7 +374,7 @@ SmallArray<float, 4> UnpackFloatsFromFloat4Unpacked(
   return unpacked_floats;
 }
 
-SmallArray<uint32_t, 4> UnpackIntegersFromFloat1PackedIn1UnsignedByte(
+PackedIntegers UnpackIntegersFromFloat1PackedIn1UnsignedByte(
     absl::Span<const std::byte> packed_value) {
   ABSL_DCHECK_EQ(packed_value.size(),
                  MeshFormat::PackedAttributeSize(
@@ -431,7 +387,7 @@ SmallArray<uint32_t, 4> UnpackIntegersFromFloat1PackedIn1UnsignedByte(
   return {static_cast<uint32_t>(packed_value[0])};
 }
 
-SmallArray<uint32_t, 4> UnpackIntegersFromFloat2PackedIn1Float(
+PackedIntegers UnpackIntegersFromFloat2PackedIn1Float(
     absl::Span<const std::byte> packed_value) {
   ABSL_DCHECK_EQ(packed_value.size(), sizeof(float));
   float packed_float;
@@ -447,7 +403,7 @@ SmallArray<uint32_t, 4> UnpackIntegersFromFloat2PackedIn1Float(
   return {packed0, packed1};
 }
 
-SmallArray<uint32_t, 4> UnpackIntegersFromFloat2PackedIn3UnsignedBytes_XY12(
+PackedIntegers UnpackIntegersFromFloat2PackedIn3UnsignedBytes_XY12(
     absl::Span<const std::byte> packed_value) {
   ABSL_DCHECK_EQ(
       packed_value.size(),
@@ -467,7 +423,7 @@ SmallArray<uint32_t, 4> UnpackIntegersFromFloat2PackedIn3UnsignedBytes_XY12(
   return {packed0, packed1};
 }
 
-SmallArray<uint32_t, 4> UnpackIntegersFromFloat3PackedIn4UnsignedBytes_XYZ10(
+PackedIntegers UnpackIntegersFromFloat3PackedIn4UnsignedBytes_XYZ10(
     absl::Span<const std::byte> packed_value) {
   ABSL_DCHECK_EQ(
       packed_value.size(),
@@ -491,7 +447,7 @@ SmallArray<uint32_t, 4> UnpackIntegersFromFloat3PackedIn4UnsignedBytes_XYZ10(
   return {packed0, packed1, packed2};
 }
 
-SmallArray<uint32_t, 4> UnpackIntegersFromFloat2PackedIn4UnsignedBytes_X12_Y20(
+PackedIntegers UnpackIntegersFromFloat2PackedIn4UnsignedBytes_X12_Y20(
     absl::Span<const std::byte> packed_value) {
   ABSL_DCHECK_EQ(
       packed_value.size(),
@@ -513,7 +469,7 @@ SmallArray<uint32_t, 4> UnpackIntegersFromFloat2PackedIn4UnsignedBytes_X12_Y20(
   return {packed0, packed1};
 }
 
-SmallArray<uint32_t, 4> UnpackIntegersFromFloat3PackedIn1Float(
+PackedIntegers UnpackIntegersFromFloat3PackedIn1Float(
     absl::Span<const std::byte> packed_value) {
   ABSL_DCHECK_EQ(packed_value.size(), sizeof(float));
   float packed_float;
@@ -530,7 +486,7 @@ SmallArray<uint32_t, 4> UnpackIntegersFromFloat3PackedIn1Float(
   return {packed0, packed1, packed2};
 }
 
-SmallArray<uint32_t, 4> UnpackIntegersFromFloat3PackedIn2Floats(
+PackedIntegers UnpackIntegersFromFloat3PackedIn2Floats(
     absl::Span<const std::byte> packed_value) {
   ABSL_DCHECK_EQ(packed_value.size(), sizeof(float) * 2);
   std::array<float, 2> packed_floats;
@@ -547,7 +503,7 @@ SmallArray<uint32_t, 4> UnpackIntegersFromFloat3PackedIn2Floats(
   return {packed0, packed1, packed2};
 }
 
-SmallArray<uint32_t, 4> UnpackIntegersFromFloat4PackedIn1Float(
+PackedIntegers UnpackIntegersFromFloat4PackedIn1Float(
     absl::Span<const std::byte> packed_value) {
   ABSL_DCHECK_EQ(packed_value.size(), sizeof(float));
   float packed_float;
@@ -564,7 +520,7 @@ SmallArray<uint32_t, 4> UnpackIntegersFromFloat4PackedIn1Float(
   return {packed0, packed1, packed2, packed3};
 }
 
-SmallArray<uint32_t, 4> UnpackIntegersFromFloat4PackedIn2Floats(
+PackedIntegers UnpackIntegersFromFloat4PackedIn2Floats(
     absl::Span<const std::byte> packed_value) {
   ABSL_DCHECK_EQ(packed_value.size(), sizeof(float) * 2);
   std::array<float, 2> packed_floats;
@@ -581,7 +537,7 @@ SmallArray<uint32_t, 4> UnpackIntegersFromFloat4PackedIn2Floats(
   return {packed0, packed1, packed2, packed3};
 }
 
-SmallArray<uint32_t, 4> UnpackIntegersFromFloat4PackedIn3Floats(
+PackedIntegers UnpackIntegersFromFloat4PackedIn3Floats(
     absl::Span<const std::byte> packed_value) {
   ABSL_DCHECK_EQ(packed_value.size(), sizeof(float) * 3);
   std::array<float, 3> packed_floats;
@@ -601,8 +557,105 @@ SmallArray<uint32_t, 4> UnpackIntegersFromFloat4PackedIn3Floats(
   return {packed0, packed1, packed2, packed3};
 }
 
+// Calls `read_packed_integers` with the reader function for `type`, which must
+// be a packed type. This is the counterpart of `VisitPackedIntegerWriter`, used
+// to dispatch on the type once per attribute when unpacking many vertices.
+template <typename ReadPackedIntegersVisitor>
+void VisitPackedIntegerReader(
+    MeshFormat::AttributeType type,
+    ReadPackedIntegersVisitor&& read_packed_integers) {
+  switch (type) {
+    case MeshFormat::AttributeType::kFloat1Unpacked:
+    case MeshFormat::AttributeType::kFloat2Unpacked:
+    case MeshFormat::AttributeType::kFloat3Unpacked:
+    case MeshFormat::AttributeType::kFloat4Unpacked:
+      break;
+    case MeshFormat::AttributeType::kFloat1PackedIn1UnsignedByte:
+      read_packed_integers(UnpackIntegersFromFloat1PackedIn1UnsignedByte);
+      return;
+    case MeshFormat::AttributeType::kFloat2PackedIn1Float:
+      read_packed_integers(UnpackIntegersFromFloat2PackedIn1Float);
+      return;
+    case MeshFormat::AttributeType::kFloat2PackedIn3UnsignedBytes_XY12:
+      read_packed_integers(UnpackIntegersFromFloat2PackedIn3UnsignedBytes_XY12);
+      return;
+    case MeshFormat::AttributeType::kFloat2PackedIn4UnsignedBytes_X12_Y20:
+      read_packed_integers(
+          UnpackIntegersFromFloat2PackedIn4UnsignedBytes_X12_Y20);
+      return;
+    case MeshFormat::AttributeType::kFloat3PackedIn1Float:
+      read_packed_integers(UnpackIntegersFromFloat3PackedIn1Float);
+      return;
+    case MeshFormat::AttributeType::kFloat3PackedIn2Floats:
+      read_packed_integers(UnpackIntegersFromFloat3PackedIn2Floats);
+      return;
+    case MeshFormat::AttributeType::kFloat3PackedIn4UnsignedBytes_XYZ10:
+      read_packed_integers(
+          UnpackIntegersFromFloat3PackedIn4UnsignedBytes_XYZ10);
+      return;
+    case MeshFormat::AttributeType::kFloat4PackedIn1Float:
+      read_packed_integers(UnpackIntegersFromFloat4PackedIn1Float);
+      return;
+    case MeshFormat::AttributeType::kFloat4PackedIn2Floats:
+      read_packed_integers(UnpackIntegersFromFloat4PackedIn2Floats);
+      return;
+    case MeshFormat::AttributeType::kFloat4PackedIn3Floats:
+      read_packed_integers(UnpackIntegersFromFloat4PackedIn3Floats);
+      return;
+  }
+  ABSL_LOG(FATAL) << "Non-packed AttributeType: " << static_cast<uint8_t>(type);
+}
+
+// Helper for `UnpackAttributeOfAllVertices`, for an attribute type with
+// `kComponents` components.
+template <int kComponents>
+void UnpackAttributeOfAllVertices(
+    MeshFormat::AttributeType type,
+    const MeshAttributeCodingParams& unpacking_params,
+    absl::Span<const std::byte> packed_vertex_data, size_t packed_vertex_stride,
+    uint16_t packed_offset, absl::Span<float> unpacked_values) {
+  ABSL_DCHECK_EQ(MeshFormat::ComponentCount(type), kComponents);
+  size_t n_vertices = unpacked_values.size() / kComponents;
+  size_t packed_width = MeshFormat::PackedAttributeSize(type);
+  if (MeshFormat::IsUnpackedType(type)) {
+    for (size_t i = 0; i < n_vertices; ++i) {
+      std::memcpy(&unpacked_values[i * kComponents],
+                  &packed_vertex_data[i * packed_vertex_stride + packed_offset],
+                  kComponents * sizeof(float));
+    }
+    return;
+  }
+
+  std::array<ComponentCodingParams, kComponents> params;
+  for (int component = 0; component < kComponents; ++component) {
+    params[component] = unpacking_params.components[component];
+  }
+  VisitPackedIntegerReader(type, [&](auto read) {
+    for (size_t i = 0; i < n_vertices; ++i) {
+      PackedIntegers packed = read(packed_vertex_data.subspan(
+          i * packed_vertex_stride + packed_offset, packed_width));
+      for (int component = 0; component < kComponents; ++component) {
+        unpacked_values[i * kComponents + component] =
+            UnpackSingleFloat(params[component], packed[component]);
+      }
+    }
+  });
+}
+
 }  // namespace
 
+bool IsValidPackedAttributeValue(MeshFormat::AttributeType type,
+                                 absl::Span<const std::byte> packed_value) {
+  if (packed_value.size() != MeshFormat::PackedAttributeSize(type)) {
+    return false;
+  }
+  if (MeshFormat::IsUnpackedType(type)) {
+    return ValuesAreFinite(ReadFloatsFromUnpackedAttribute(type, packed_value));
+  }
+  return PackedFloatValuesAreFinite(type, packed_value) &&
+         PackedFloatValuesAreRepresentable(type, packed_value);
+}
+
 SmallArray<float, 4> UnpackAttribute(
     MeshFormat::AttributeType type,
     const MeshAttributeCodingParams& unpacking_params,
@@ -636,35 +689,51 @@ SmallArray<uint32_t, 4> UnpackIntegersFromPackedAttribute(
   ABSL_DCHECK(PackedFloatValuesAreFinite(type, packed_value));
   ABSL_DCHECK(PackedFloatValuesAreRepresentable(type, packed_value))
       << "Cannot unpack: Unrepresentable value found";
-  switch (type) {
-    case MeshFormat::AttributeType::kFloat1PackedIn1UnsignedByte:
-      return UnpackIntegersFromFloat1PackedIn1UnsignedByte(packed_value);
-    case MeshFormat::AttributeType::kFloat2PackedIn1Float:
-      return UnpackIntegersFromFloat2PackedIn1Float(packed_value);
-    case MeshFormat::AttributeType::kFloat2PackedIn3UnsignedBytes_XY12:
-      return UnpackIntegersFromFloat2PackedIn3UnsignedBytes_XY12(packed_value);
-    case MeshFormat::AttributeType::kFloat2PackedIn4UnsignedBytes_X12_Y20:
-      return UnpackIntegersFromFloat2PackedIn4UnsignedBytes_X12_Y20(
-          packed_value);
-    case MeshFormat::AttributeType::kFloat3PackedIn1Float:
-      return UnpackIntegersFromFloat3PackedIn1Float(packed_value);
-    case MeshFormat::AttributeType::kFloat3PackedIn2Floats:
-      return UnpackIntegersFromFloat3PackedIn2Floats(packed_value);
-    case MeshFormat::AttributeType::kFloat3PackedIn4UnsignedBytes_XYZ10:
-      return UnpackIntegersFromFloat3PackedIn4UnsignedBytes_XYZ10(packed_value);
-    case MeshFormat::AttributeType::kFloat4PackedIn1Float:
-      return UnpackIntegersFromFloat4PackedIn1Float(packed_value);
-    case MeshFormat::AttributeType::kFloat4PackedIn2Floats:
-      return UnpackIntegersFromFloat4PackedIn2Floats(packed_value);
-    case MeshFormat::AttributeType::kFloat4PackedIn3Floats:
-      return UnpackIntegersFromFloat4PackedIn3Floats(packed_value);
-    case MeshFormat::AttributeType::kFloat1Unpacked:
-    case MeshFormat::AttributeType::kFloat2Unpacked:
-    case MeshFormat::AttributeType::kFloat3Unpacked:
-    case MeshFormat::AttributeType::kFloat4Unpacked:
-      break;
+  SmallArray<uint32_t, 4> unpacked(MeshFormat::ComponentCount(type));
+  VisitPackedIntegerReader(type, [&unpacked, packed_value](auto read) {
+    PackedIntegers packed = read(packed_value);
+    std::copy_n(packed.begin(), unpacked.Size(), unpacked.Values().begin());
+  });
+  return unpacked;
+}
+
+void UnpackAttributeOfAllVertices(
+    MeshFormat::AttributeType type,
+    const MeshAttributeCodingParams& unpacking_params,
+    absl::Span<const std::byte> packed_vertex_data, size_t packed_vertex_stride,
+    uint16_t packed_offset, absl::Span<float> unpacked_values) {
+  ABSL_DCHECK(IsValidCodingParams(type, unpacking_params))
+      << "Invalid unpacking params";
+  ABSL_DCHECK_GT(packed_vertex_stride, 0u);
+  ABSL_DCHECK_EQ(packed_vertex_data.size() % packed_vertex_stride, 0u);
+  ABSL_DCHECK_LE(packed_offset + MeshFormat::PackedAttributeSize(type),
+                 packed_vertex_stride);
+  ABSL_DCHECK_EQ(unpacked_values.size(),
+                 MeshFormat::ComponentCount(type) *
+                     (packed_vertex_data.size() / packed_vertex_stride));
+  switch (MeshFormat::ComponentCount(type)) {
+    case 1:
+      UnpackAttributeOfAllVertices<1>(type, unpacking_params,
+                                      packed_vertex_data, packed_vertex_stride,
+                                      packed_offset, unpacked_values);
+      return;
+    case 2:
+      UnpackAttributeOfAllVertices<2>(type, unpacking_params,
+                                      packed_vertex_data, packed_vertex_stride,
+                                      packed_offset, unpacked_values);
+      return;
+    case 3:
+      UnpackAttributeOfAllVertices<3>(type, unpacking_params,
+                                      packed_vertex_data, packed_vertex_stride,
+                                      packed_offset, unpacked_values);
+      return;
+    case 4:
+      UnpackAttributeOfAllVertices<4>(type, unpacking_params,
+                                      packed_vertex_data, packed_vertex_stride,
+                                      packed_offset, unpacked_values);
+      return;
   }
-  ABSL_LOG(FATAL) << "Non-packed AttributeType: " << static_cast<uint8_t>(type);
+  ABSL_LOG(FATAL) << "Unrecognized AttributeType: " << type;
 }
 
 SmallArray<float, 4> ReadFloatsFromUnpackedAttribute(
@@ -948,85 +1017,271 @@ absl::StatusOr<CodingParamsArray> ComputeCodingParamsArray(
   return coding_params_array;
 }
 
-std::vector<std::byte> CopyAndPackPartitionVertices(
-    absl::Span<const std::byte> unpacked_vertex_data,
-    absl::Span<const uint32_t> partition_vertex_indices,
+VertexPackingPlan MakeVertexPackingPlan(
     const MeshFormat& original_format,
     const absl::flat_hash_set<MeshFormat::AttributeId>& omit_set,
-    const CodingParamsArray& packing_params_array,
-    const absl::flat_hash_map<uint32_t, Point>& override_vertex_positions) {
-  // These should all be guaranteed by logic in `MutableMesh`.
-  ABSL_CHECK(!unpacked_vertex_data.empty()) << "Vertex data is empty";
-  ABSL_CHECK(!partition_vertex_indices.empty()) << "Partition is empty";
-  ABSL_CHECK_EQ(
-      unpacked_vertex_data.size() % original_format.UnpackedVertexStride(), 0u)
-      << "Vertex data is not divisible by vertex stride";
-
-  uint32_t n_original_vertices =
-      unpacked_vertex_data.size() / original_format.UnpackedVertexStride();
+    const CodingParamsArray& packing_params_array) {
   absl::Span<const MeshFormat::Attribute> original_attrs =
       original_format.Attributes();
 
-  // These should also be guaranteed by logic in `MutableMesh`.
+  // These should be guaranteed by logic in `MutableMesh`.
   size_t n_original_attrs = original_attrs.size();
   ABSL_CHECK_GT(n_original_attrs, omit_set.size());
   size_t n_packed_attrs = n_original_attrs - omit_set.size();
   ABSL_CHECK_EQ(packing_params_array.Size(), n_packed_attrs)
       << "Wrong number of packing params";
-  // This one we only DCHECK, for performance reasons.
-  ABSL_DCHECK_LT(*absl::c_max_element(partition_vertex_indices),
-                 n_original_vertices)
-      << "Partition refers to non-existent vertex";
 
-  size_t packed_vertex_stride = 0;
-  std::vector<size_t> packed_attribute_offsets;
-  packed_attribute_offsets.reserve(n_packed_attrs);
-  for (MeshFormat::Attribute original_attr : original_attrs) {
+  VertexPackingPlan plan = {
+      .unpacked_vertex_stride = original_format.UnpackedVertexStride(),
+      .packed_vertex_stride = 0,
+  };
+  for (size_t original_attr_idx = 0; original_attr_idx < n_original_attrs;
+       ++original_attr_idx) {
+    MeshFormat::Attribute original_attr = original_attrs[original_attr_idx];
     if (omit_set.contains(original_attr.id)) continue;
-    packed_attribute_offsets.push_back(packed_vertex_stride);
-    packed_vertex_stride += original_attr.packed_width;
+    plan.attributes.push_back({
+        .type = original_attr.type,
+        .unpacked_offset = original_attr.unpacked_offset,
+        .packed_offset = static_cast<uint16_t>(plan.packed_vertex_stride),
+        .packed_width = original_attr.packed_width,
+        .is_position =
+            original_attr_idx == original_format.PositionAttributeIndex(),
+        .packing_params = packing_params_array[plan.attributes.size()],
+    });
+    plan.packed_vertex_stride += original_attr.packed_width;
   }
+  return plan;
+}
 
-  // Returns the unpacked attribute value read from `unpacked_vertex_data` or
-  // the override position, if applicable.
-  auto get_unpacked_attribute_value =
-      [&](uint32_t original_vertex_index,
-          int original_attribute_index) -> SmallArray<float, 4> {
-    if (original_attribute_index == original_format.PositionAttributeIndex()) {
-      auto override_it = override_vertex_positions.find(original_vertex_index);
-      if (override_it != override_vertex_positions.end()) {
-        return {override_it->second.x, override_it->second.y};
+namespace {
+
+// Copies the attribute at `unpacked_offset`, which has `kComponents`
+// components, of each of the vertices in `vertex_indices` to `column`. The
+// values are stored one component at a time, i.e. the first components of all
+// of the vertices, then the second components, etc., so that each component can
+// be processed by a simple loop.
+template <int kComponents>
+void GatherUnpackedAttributeColumn(
+    absl::Span<const std::byte> unpacked_vertex_data,
+    uint16_t unpacked_vertex_stride, uint16_t unpacked_offset,
+    absl::Span<const uint32_t> vertex_indices, absl::Span<float> column) {
+  size_t n_vertices = vertex_indices.size();
+  ABSL_DCHECK_EQ(column.size(), kComponents * n_vertices);
+  for (size_t i = 0; i < n_vertices; ++i) {
+    const std::byte* src =
+        &unpacked_vertex_data[vertex_indices[i] * unpacked_vertex_stride +
+                              unpacked_offset];
+    for (int component = 0; component < kComponents; ++component) {
+      column[component * n_vertices + i] =
+          UnalignedLoadFloat(src + component * sizeof(float));
+    }
+  }
+}
+
+// Replaces the positions in `position_column`, as laid out by
+// `GatherUnpackedAttributeColumn`, of the vertices in `vertex_indices` that
+// have a value in `override_vertex_positions`.
+void OverridePositionColumn(
+    absl::Span<const uint32_t> vertex_indices,
+    absl::Span<const std::optional<Point>> override_vertex_positions,
+    absl::Span<float> position_column) {
+  size_t n_vertices = vertex_indices.size();
+  ABSL_DCHECK_EQ(position_column.size(), 2 * n_vertices);
+  for (size_t i = 0; i < n_vertices; ++i) {
+    const std::optional<Point>& position =
+        override_vertex_positions[vertex_indices[i]];
+    if (!position.has_value()) continue;
+    position_column[i] = position->x;
+    position_column[n_vertices + i] = position->y;
+  }
+}
+
+// Returns the same value as `PackSingleFloat` for a `value` of
+// `(unpacked_value - offset) / scale`, i.e. `std::round(value)`, for `value` in
+// (-0.5, 2^24). Unlike `std::round`, this does not call into the math library,
+// so that loops over it can be vectorized.
+uint32_t RoundToPackedInteger(float value) {
+  int32_t truncated = static_cast<int32_t>(value);
+  // Since `value` and `truncated` are within a factor of two of each other (or
+  // `truncated` is zero), this subtraction is exact.
+  return truncated + (value - static_cast<float>(truncated) >= 0.5f ? 1 : 0);
+}
+
+// Quantizes each value in `unpacked_column`, as laid out by
+// `GatherUnpackedAttributeColumn`, to the integer in the same position in
+// `packed_column`, in the same way as `PackSingleFloat`. The inner loop has no
+// branches or calls, so that it can be vectorized.
+void QuantizeAttributeColumn(MeshFormat::AttributeType type,
+                             const MeshAttributeCodingParams& packing_params,
+                             absl::Span<const float> unpacked_column,
+                             absl::Span<uint32_t> packed_column) {
+  int n_components = packing_params.components.Size();
+  size_t n_vertices = unpacked_column.size() / n_components;
+  ABSL_DCHECK_EQ(packed_column.size(), unpacked_column.size());
+  ABSL_DCHECK(IsValidCodingParams(type, packing_params))
+      << "Invalid packing params";
+  for (int component = 0; component < n_components; ++component) {
+    const ComponentCodingParams& params =
+        packing_params.components[component];
+    const float offset = params.offset;
+    const float scale = params.scale;
+    const float* src = &unpacked_column[component * n_vertices];
+    uint32_t* dst = &packed_column[component * n_vertices];
+    for (size_t i = 0; i < n_vertices; ++i) {
+      dst[i] = RoundToPackedInteger((src[i] - offset) / scale);
+    }
+    ABSL_DCHECK(std::all_of(
+        dst, dst + n_vertices,
+        [max_value = MaxValueForBits(
+             MeshFormat::PackedBitsPerComponent(type).value()[component])](
+            uint32_t packed) { return packed <= max_value; }))
+        << "Attribute value is not representable by packing params";
+  }
+}
+
+// The number of vertices that `CopyAndPackPartitionVertices` packs at a time.
+// Each attribute of a block is packed in turn, so this is chosen so that the
+// unpacked and packed data of a block of vertices stays in the L1 cache, while
+// the loops over each attribute are still long.
+constexpr size_t kVerticesPerPackingBlock = 256;
+
+// Packs `attr` of each of the vertices in `vertex_indices`, of which there are
+// at most `kVerticesPerPackingBlock`, into the vertices starting at the
+// beginning of `packed_vertex_data`.
+template <int kComponents>
+void PackAttributeBlock(
+    absl::Span<const std::byte> unpacked_vertex_data,
+    absl::Span<const uint32_t> vertex_indices, const VertexPackingPlan& plan,
+    const VertexPackingPlan::Attribute& attr,
+    absl::Span<const std::optional<Point>> override_vertex_positions,
+    absl::Span<std::byte> packed_vertex_data) {
+  ABSL_DCHECK_EQ(MeshFormat::ComponentCount(attr.type), kComponents);
+  ABSL_DCHECK_LE(vertex_indices.size(), kVerticesPerPackingBlock);
+  std::array<float, kComponents * kVerticesPerPackingBlock>
+      unpacked_column_storage;
+  std::array<uint32_t, kComponents * kVerticesPerPackingBlock>
+      packed_column_storage;
+
+  size_t n_vertices = vertex_indices.size();
+  absl::Span<float> unpacked_column = absl::MakeSpan(
+      unpacked_column_storage.data(), kComponents * n_vertices);
+  GatherUnpackedAttributeColumn<kComponents>(
+      unpacked_vertex_data, plan.unpacked_vertex_stride, attr.unpacked_offset,
+      vertex_indices, unpacked_column);
+  if (attr.is_position && !override_vertex_positions.empty()) {
+    OverridePositionColumn(vertex_indices, override_vertex_positions,
+                           unpacked_column);
+  }
+
+  if (MeshFormat::IsUnpackedType(attr.type)) {
+    for (size_t i = 0; i < n_vertices; ++i) {
+      std::byte* dst = &packed_vertex_data[i * plan.packed_vertex_stride +
+                                           attr.packed_offset];
+      for (int component = 0; component < kComponents; ++component) {
+        std::memcpy(dst + component * sizeof(float),
+                    &unpacked_column[component * n_vertices + i],
+                    sizeof(float));
       }
     }
-    return ReadUnpackedFloatAttributeFromByteArray(
-        original_vertex_index, original_attribute_index, unpacked_vertex_data,
-        original_format);
-  };
+    return;
+  }
+
+  absl::Span<uint32_t> packed_column = absl::MakeSpan(
+      packed_column_storage.data(), kComponents * n_vertices);
+  QuantizeAttributeColumn(attr.type, attr.packing_params, unpacked_column,
+                          packed_column);
+  VisitPackedIntegerWriter(attr.type, [&](auto write) {
+    for (size_t i = 0; i < n_vertices; ++i) {
+      PackedIntegers packed = {};
+      for (int component = 0; component < kComponents; ++component) {
+        packed[component] = packed_column[component * n_vertices + i];
+      }
+      write(packed, packed_vertex_data.subspan(
+                        i * plan.packed_vertex_stride + attr.packed_offset,
+                        attr.packed_width));
+    }
+  });
+}
 
-  std::vector<std::byte> partition_vertex_data(partition_vertex_indices.size() *
-                                               packed_vertex_stride);
-  for (uint32_t partition_vertex_idx = 0;
-       partition_vertex_idx < partition_vertex_indices.size();
-       ++partition_vertex_idx) {
-    uint32_t original_vertex_idx =
-        partition_vertex_indices[partition_vertex_idx];
-    for (size_t original_attr_idx = 0, packed_attr_idx = 0;
-         original_attr_idx < n_original_attrs; ++original_attr_idx) {
-      MeshFormat::Attribute original_attr = original_attrs[original_attr_idx];
-      if (omit_set.contains(original_attr.id)) continue;
-      absl::Span<std::byte> packed_value = absl::MakeSpan(
-          &partition_vertex_data[partition_vertex_idx * packed_vertex_stride +
-                                 packed_attribute_offsets[packed_attr_idx]],
-          original_attr.packed_width);
-      mesh_internal::PackAttribute(
-          original_attr.type, packing_params_array[packed_attr_idx],
-          get_unpacked_attribute_value(original_vertex_idx, original_attr_idx),
-          packed_value);
-      ++packed_attr_idx;
+// Calls `PackAttributeBlock` with the number of components of `attr`.
+void PackAttributeBlock(
+    absl::Span<const std::byte> unpacked_vertex_data,
+    absl::Span<const uint32_t> vertex_indices, const VertexPackingPlan& plan,
+    const VertexPackingPlan::Attribute& attr,
+    absl::Span<const std::optional<Point>> override_vertex_positions,
+    absl::Span<std::byte> packed_vertex_data) {
+  switch (MeshFormat::ComponentCount(attr.type)) {
+    case 1:
+      PackAttributeBlock<1>(unpacked_vertex_data, vertex_indices, plan, attr,
+                            override_vertex_positions, packed_vertex_data);
+      return;
+    case 2:
+      PackAttributeBlock<2>(unpacked_vertex_data, vertex_indices, plan, attr,
+                            override_vertex_positions, packed_vertex_data);
+      return;
+    case 3:
+      PackAttributeBlock<3>(unpacked_vertex_data, vertex_indices, plan, attr,
+                            override_vertex_positions, packed_vertex_data);
+      return;
+    case 4:
+      PackAttributeBlock<4>(unpacked_vertex_data, vertex_indices, plan, attr,
+                            override_vertex_positions, packed_vertex_data);
+      return;
+  }
+  ABSL_LOG(FATAL) << "Unrecognized AttributeType: " << attr.type;
+}
+
+}  // namespace
+
+std::vector<std::byte> CopyAndPackPartitionVertices(
+    absl::Span<const std::byte> unpacked_vertex_data,
+    absl::Span<const uint32_t> partition_vertex_indices,
+    const VertexPackingPlan& plan,
+    absl::Span<const std::optional<Point>> override_vertex_positions) {
+  // These should all be guaranteed by logic in `MutableMesh`.
+  ABSL_CHECK(!unpacked_vertex_data.empty()) << "Vertex data is empty";
+  ABSL_CHECK(!partition_vertex_indices.empty()) << "Partition is empty";
+  ABSL_CHECK_EQ(unpacked_vertex_data.size() % plan.unpacked_vertex_stride, 0u)
+      << "Vertex data is not divisible by vertex stride";
+  ABSL_CHECK(override_vertex_positions.empty() ||
+             override_vertex_positions.size() ==
+                 unpacked_vertex_data.size() / plan.unpacked_vertex_stride)
+      << "Override vertex positions do not match the vertex data";
+
+  // This one we only DCHECK, for performance reasons.
+  ABSL_DCHECK_LT(*absl::c_max_element(partition_vertex_indices),
+                 unpacked_vertex_data.size() / plan.unpacked_vertex_stride)
+      << "Partition refers to non-existent vertex";
+
+  std::vector<std::byte> partition_vertex_data(
+      partition_vertex_indices.size() * plan.packed_vertex_stride);
+  for (size_t block_start = 0; block_start < partition_vertex_indices.size();
+       block_start += kVerticesPerPackingBlock) {
+    absl::Span<const uint32_t> block_vertex_indices =
+        partition_vertex_indices.subspan(block_start, kVerticesPerPackingBlock);
+    absl::Span<std::byte> block_vertex_data = absl::MakeSpan(
+        &partition_vertex_data[block_start * plan.packed_vertex_stride],
+        block_vertex_indices.size() * plan.packed_vertex_stride);
+    for (const VertexPackingPlan::Attribute& attr : plan.attributes) {
+      PackAttributeBlock(unpacked_vertex_data, block_vertex_indices, plan,
+                         attr, override_vertex_positions, block_vertex_data);
     }
   }
 
   return partition_vertex_data;
 }
 
+std::vector<std::byte> CopyAndPackPartitionVertices(
+    absl::Span<const std::byte> unpacked_vertex_data,
+    absl::Span<const uint32_t> partition_vertex_indices,
+    const MeshFormat& original_format,
+    const absl::flat_hash_set<MeshFormat::AttributeId>& omit_set,
+    const CodingParamsArray& packing_params_array,
+    absl::Span<const std::optional<Point>> override_vertex_positions) {
+  return CopyAndPackPartitionVertices(
+      unpacked_vertex_data, partition_vertex_indices,
+      MakeVertexPackingPlan(original_format, omit_set, packing_params_array),
+      override_vertex_positions);
+}
+
 }  // namespace ink::mesh_internal
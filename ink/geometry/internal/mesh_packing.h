@@ -22,7 +22,6 @@
 #include <optional>
 #include <vector>
 
-#include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/container/inlined_vector.h"
 #include "absl/status/statusor.h"
@@ -111,6 +110,39 @@ SmallArray<float, 4> UnpackAttribute(
     const MeshAttributeCodingParams& unpacking_params,
     absl::Span<const std::byte> packed_value);
 
+// Unpacks the value of an attribute of type `type` on every vertex in
+// `packed_vertex_data`, which holds vertices of `packed_vertex_stride` bytes
+// each, with the attribute stored at `packed_offset` bytes into each vertex.
+// The values are written to `unpacked_values` one vertex after another, i.e.
+// component `j` of vertex `i` is written to `unpacked_values[i * n + j]`, where
+// `n` is `MeshFormat::ComponentCount(type)`.
+//
+// This yields the same values as calling `UnpackAttribute` on each vertex, but
+// looks up the packing scheme once for all of the vertices. All the same
+// restrictions apply; in addition, this DCHECK-fails if `packed_vertex_data` is
+// not a whole number of vertices, or if `unpacked_values` does not have exactly
+// `n` elements per vertex.
+void UnpackAttributeOfAllVertices(
+    MeshFormat::AttributeType type,
+    const MeshAttributeCodingParams& unpacking_params,
+    absl::Span<const std::byte> packed_vertex_data, size_t packed_vertex_stride,
+    uint16_t packed_offset, absl::Span<float> unpacked_values);
+
+// Returns true if `coding_params` are valid for packing or unpacking an
+// attribute of type `type`, i.e. if they have the right number of components,
+// and each offset and scale is finite, with scale > 0. Any coding params are
+// valid for unpacked types, since they are ignored.
+bool IsValidCodingParams(MeshFormat::AttributeType type,
+                         const MeshAttributeCodingParams& coding_params);
+
+// Returns true if `packed_value` holds a value that may be passed to
+// `UnpackAttribute` for an attribute of type `type`: it must be the right size,
+// the values of unpacked types must be finite, and the floats that integers
+// are packed into must lie in the interval [0, 2^24 - 1]. This is meant for
+// validating packed data that comes from outside of `Mesh`, e.g. from storage.
+bool IsValidPackedAttributeValue(MeshFormat::AttributeType type,
+                                 absl::Span<const std::byte> packed_value);
+
 // Returns the integer value that should be packed into a float.  The packing
 // transform must be valid, and the unpacked value must be in range for that
 // transform.
@@ -209,40 +241,86 @@ absl::StatusOr<CodingParamsArray> ComputeCodingParamsArray(
     absl::Span<const std::optional<MeshAttributeCodingParams>>
         custom_coding_params_array = {});
 
+// A precomputed plan for packing the vertices of a mesh with a given format,
+// minus a set of omitted attributes, using a given array of packing params.
+// Packing with a plan handles one attribute of all the vertices at a time, so
+// the omitted attributes, packed offsets and packing scheme of each attribute
+// are looked up once per attribute, rather than once per vertex.
+struct VertexPackingPlan {
+  struct Attribute {
+    MeshFormat::AttributeType type;
+    // The offsets in bytes from the start of the vertex to the start of the
+    // attribute, for the unpacked and packed vertices, respectively.
+    uint16_t unpacked_offset;
+    uint16_t packed_offset;
+    // The number of bytes used to store the attribute in a packed vertex.
+    uint8_t packed_width;
+    // Whether this is the position attribute, which may be overridden when
+    // packing.
+    bool is_position;
+    MeshAttributeCodingParams packing_params;
+  };
+
+  uint16_t unpacked_vertex_stride;
+  size_t packed_vertex_stride;
+  // The attributes that are not omitted, in the order they are packed.
+  absl::InlinedVector<Attribute, kMaxVertexAttributes> attributes;
+};
+
+// Returns the plan for packing vertices of `original_format`, omitting the
+// attributes in `omit_set` and packing the others with `packing_params_array`,
+// which is expected to be the result of calling `ComputeCodingParamsArray`.
+//
+// This CHECK-fails if:
+// - `omit_set.size() >= format.Attributes.size()`
+// - `packing_params_array.Size() != format.Attributes.size() - omit_set.size()`
+VertexPackingPlan MakeVertexPackingPlan(
+    const MeshFormat& original_format,
+    const absl::flat_hash_set<MeshFormat::AttributeId>& omit_set,
+    const CodingParamsArray& packing_params_array);
+
 // Returns a vector of bytes containing a packed copy of a subset of the
-// vertices and attributes stored in `unpacked_vertex_data`.
+// vertices stored in `unpacked_vertex_data`, packed per `plan`.
 // `unpacked_vertex_data` is expected to contain vertices in unpacked form, in
-// the format specified by `format`.  `partition_vertex_indices` specifies the
+// the format that `plan` was made for. `partition_vertex_indices` specifies the
 // desired subset, and its order, by indices of the vertices in
-// `unpacked_vertex_data`. `omit_set` indicates attributes that should be
-// omitted from the packed data. `packing_params_array` is used to perform the
-// packing of the non-omitted attributes, and is expected to be the result of
-// calling `ComputePackingParams`.
+// `unpacked_vertex_data`.
 //
-// `override_vertex_positions` should contain a map from vertex indices to a
-// position to be used instead of the one contained in `unpacked_vertex_data`,
-// e.g. for corrections to prevent triangles being flipped by quantization.
+// `override_vertex_positions` should either be empty, or contain an element
+// for each vertex in `unpacked_vertex_data`, indexed the same way. Where an
+// element has a value, that position is used instead of the one contained in
+// `unpacked_vertex_data`, e.g. for corrections to prevent triangles being
+// flipped by quantization.
 //
 // This CHECK-fails if:
 // - `unpacked_vertex_data` or `partition_vertex_indices` is empty
 // - `unpacked_vertex_data.size()` is not divisible by
-//   `format.UnpackedVertexStride()`
-// - `omit_set.size() >= format.Attributes.size()`
-// - `packing_params_array.Size() != format.Attributes.size() - omit_set.size()`
+//   `plan.unpacked_vertex_stride`
+// - `override_vertex_positions` is neither empty nor the same size as the
+//   number of vertices in `unpacked_vertex_data`
 //
 // This also DCHECK-fails (for performance reasons) if
 // `partition_vertex_indices` contains any element >=
-// `unpacked_vertex_data.size()` / `format.UnpackedVertexStride()`.
+// `unpacked_vertex_data.size()` / `plan.unpacked_vertex_stride`.
 //
 // These conditions are all expected to be guaranteed by the logic in
 // `MutableMesh`.
+std::vector<std::byte> CopyAndPackPartitionVertices(
+    absl::Span<const std::byte> unpacked_vertex_data,
+    absl::Span<const uint32_t> partition_vertex_indices,
+    const VertexPackingPlan& plan,
+    absl::Span<const std::optional<Point>> override_vertex_positions);
+
+// Same as above, but makes the plan from `original_format`, `omit_set` and
+// `packing_params_array`, per `MakeVertexPackingPlan`. Prefer making the plan
+// once when packing several partitions of the same mesh.
 std::vector<std::byte> CopyAndPackPartitionVertices(
     absl::Span<const std::byte> unpacked_vertex_data,
     absl::Span<const uint32_t> partition_vertex_indices,
     const MeshFormat& original_format,
     const absl::flat_hash_set<MeshFormat::AttributeId>& omit_set,
     const CodingParamsArray& packing_params_array,
-    const absl::flat_hash_map<uint32_t, Point>& override_vertex_positions);
+    absl::Span<const std::optional<Point>> override_vertex_positions);
 
 }  // namespace ink::mesh_internal
 
@@ -14,6 +14,7 @@
 
 #include "ink/geometry/internal/mesh_packing.h"
 
+#include <algorithm>
 #include <cmath>
 #include <cstddef>
 #include <cstdint>
@@ -24,10 +25,11 @@
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
-#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/container/inlined_vector.h"
 #include "absl/log/absl_check.h"
 #include "absl/status/status.h"
+#include "absl/status/statusor.h"
 #include "absl/types/span.h"
 #include "ink/geometry/mesh_format.h"
 #include "ink/geometry/mesh_packing_types.h"
@@ -710,6 +712,55 @@ TEST(MeshPackingTest, UnpackedFormatsIgnoreOffsetAndScale) {
               ElementsAre(15, 30, 45, 60));
 }
 
+TEST(MeshPackingTest, UnpackAttributeOfAllVerticesMatchesUnpackAttribute) {
+  for (AttrType type : {AttrType::kFloat1Unpacked,
+                        AttrType::kFloat2Unpacked,
+                        AttrType::kFloat3Unpacked,
+                        AttrType::kFloat4Unpacked,
+                        AttrType::kFloat1PackedIn1UnsignedByte,
+                        AttrType::kFloat2PackedIn1Float,
+                        AttrType::kFloat2PackedIn3UnsignedBytes_XY12,
+                        AttrType::kFloat2PackedIn4UnsignedBytes_X12_Y20,
+                        AttrType::kFloat3PackedIn1Float,
+                        AttrType::kFloat3PackedIn2Floats,
+                        AttrType::kFloat3PackedIn4UnsignedBytes_XYZ10,
+                        AttrType::kFloat4PackedIn1Float,
+                        AttrType::kFloat4PackedIn2Floats,
+                        AttrType::kFloat4PackedIn3Floats}) {
+    SCOPED_TRACE(ToFormattedString(type));
+    int n_components = MeshFormat::ComponentCount(type);
+    MeshAttributeCodingParams coding_params;
+    coding_params.components.Resize(n_components);
+    for (int i = 0; i < n_components; ++i) {
+      coding_params.components[i] = {.offset = -1.f * i, .scale = 1.f / 8};
+    }
+    // Store the attribute between two bytes of padding in each vertex, to
+    // check that the stride and offset are respected.
+    constexpr uint16_t kOffset = 1;
+    size_t stride = MeshFormat::PackedAttributeSize(type) + 2;
+    constexpr int kNumVertices = 5;
+    std::vector<std::byte> vertex_data(kNumVertices * stride);
+    std::vector<float> expected;
+    for (int v = 0; v < kNumVertices; ++v) {
+      SmallArray<float, 4> value(n_components);
+      for (int i = 0; i < n_components; ++i) value[i] = v - 0.25f * i;
+      absl::Span<std::byte> packed_value = absl::MakeSpan(vertex_data).subspan(
+          v * stride + kOffset, MeshFormat::PackedAttributeSize(type));
+      PackAttribute(type, coding_params, value, packed_value);
+      SmallArray<float, 4> unpacked =
+          UnpackAttribute(type, coding_params, packed_value);
+      expected.insert(expected.end(), unpacked.Values().begin(),
+                      unpacked.Values().end());
+    }
+
+    std::vector<float> unpacked_values(kNumVertices * n_components);
+    UnpackAttributeOfAllVertices(type, coding_params, vertex_data, stride,
+                                 kOffset, absl::MakeSpan(unpacked_values));
+
+    EXPECT_THAT(unpacked_values, ElementsAreArray(expected));
+  }
+}
+
 TEST(MeshPackingTest, MinimumRepresentableValues) {
   std::vector<std::byte> byte_vector_1 =
       PackAttributeAndGetAsByteVector(AttrType::kFloat1PackedIn1UnsignedByte,
@@ -2283,8 +2334,9 @@ TEST(MeshPackingTest,
                           {.minimum = {-4, 5}, .maximum = {16, 30}});
   ASSERT_EQ(unpacking_params.status(), absl::OkStatus());
   unpacking_params_array[0] = *unpacking_params;
-  absl::flat_hash_map<uint32_t, Point> corrected_positions = {{1, {100, 200}},
-                                                              {3, {30, 50}}};
+  std::vector<std::optional<Point>> corrected_positions(6);
+  corrected_positions[1] = Point{100, 200};
+  corrected_positions[3] = Point{30, 50};
 
   EXPECT_THAT(
       CopyAndPackPartitionVertices(bytes, {0, 1, 3, 5}, format, {},
@@ -2337,8 +2389,9 @@ TEST(MeshPackingTest,
     unpacking_params_array[2] = *unpacking_params;
   }
 
-  absl::flat_hash_map<uint32_t, Point> corrected_positions = {{0, {100, 20}},
-                                                              {3, {-10, 45}}};
+  std::vector<std::optional<Point>> corrected_positions(4);
+  corrected_positions[0] = Point{100, 20};
+  corrected_positions[3] = Point{-10, 45};
 
   EXPECT_THAT(
       CopyAndPackPartitionVertices(bytes, {0, 1, 3}, *format, {},
@@ -2354,6 +2407,120 @@ TEST(MeshPackingTest,
                                             0})));     // color
 }
 
+TEST(MeshPackingTest,
+     CopyAndPackPartitionVerticesWithPlanMatchesPackingEachVertex) {
+  // Use enough vertices that the plan packs several blocks of vertices, with a
+  // partial last block, and omit some attributes from the middle and the end
+  // of the format.
+  constexpr uint32_t kVertexCount = 600;
+  absl::StatusOr<MeshFormat> mixed_format = MeshFormat::Create(
+      {{AttrType::kFloat2PackedIn3UnsignedBytes_XY12, AttrId::kPosition},
+       {AttrType::kFloat1PackedIn1UnsignedByte, AttrId::kOpacityShift},
+       {AttrType::kFloat3PackedIn4UnsignedBytes_XYZ10, AttrId::kColorShiftHsl},
+       {AttrType::kFloat2PackedIn3UnsignedBytes_XY12, AttrId::kSideDerivative},
+       {AttrType::kFloat1PackedIn1UnsignedByte, AttrId::kSideLabel},
+       {AttrType::kFloat2PackedIn1Float, AttrId::kCustom0},
+       {AttrType::kFloat1Unpacked, AttrId::kCustom1},
+       {AttrType::kFloat2PackedIn4UnsignedBytes_X12_Y20, AttrId::kSurfaceUv}},
+      MeshFormat::IndexFormat::k32BitUnpacked16BitPacked);
+  ASSERT_EQ(mixed_format.status(), absl::OkStatus());
+  const MeshFormat& format = *mixed_format;
+  const absl::flat_hash_set<AttrId> omit_set = {AttrId::kSideDerivative,
+                                                AttrId::kSurfaceUv};
+  absl::StatusOr<MeshFormat> packed_format = format.WithoutAttributes(
+      {AttrId::kSideDerivative, AttrId::kSurfaceUv});
+  ASSERT_EQ(packed_format.status(), absl::OkStatus());
+
+  // Every unpacked attribute component is a float, so fill the vertices with
+  // pseudo-random floats in [-10, 10].
+  uint32_t seed = 1;
+  auto next_value = [&seed]() {
+    seed = seed * 1664525 + 1013904223;
+    return 20 * static_cast<float>(seed >> 8) / (1 << 24) - 10;
+  };
+  std::vector<float> unpacked_floats(kVertexCount *
+                                     format.UnpackedVertexStride() / 4);
+  for (float& value : unpacked_floats) value = next_value();
+  std::vector<std::byte> vertex_data = AsByteVector<float>(unpacked_floats);
+  std::vector<std::optional<Point>> overrides(kVertexCount);
+  for (uint32_t i = 0; i < kVertexCount; i += 7) {
+    overrides[i] = Point{next_value(), next_value()};
+  }
+
+  // Pack a subset of the vertices, out of order.
+  std::vector<uint32_t> partition_vertex_indices;
+  for (uint32_t i = 0; i < kVertexCount; i += 2) {
+    partition_vertex_indices.push_back((i * 7) % kVertexCount);
+    partition_vertex_indices.push_back(kVertexCount - 1 - i);
+  }
+
+  // Returns the value of the attribute at `attribute_index` in `format` of the
+  // vertex at `vertex_index`, taking the overrides into account.
+  auto get_value = [&](uint32_t vertex_index, uint32_t attribute_index) {
+    if (attribute_index == format.PositionAttributeIndex() &&
+        overrides[vertex_index].has_value()) {
+      return SmallArray<float, 4>(
+          {overrides[vertex_index]->x, overrides[vertex_index]->y});
+    }
+    return ReadUnpackedFloatAttributeFromByteArray(vertex_index,
+                                                   attribute_index,
+                                                   vertex_data, format);
+  };
+
+  std::vector<uint32_t> kept_attribute_indices;
+  for (uint32_t i = 0; i < format.Attributes().size(); ++i) {
+    if (!omit_set.contains(format.Attributes()[i].id)) {
+      kept_attribute_indices.push_back(i);
+    }
+  }
+  AttributeBoundsArray bounds(kept_attribute_indices.size());
+  for (uint32_t i = 0; i < kept_attribute_indices.size(); ++i) {
+    bounds[i] = {.minimum = get_value(0, kept_attribute_indices[i]),
+                 .maximum = get_value(0, kept_attribute_indices[i])};
+    for (uint32_t v = 1; v < kVertexCount; ++v) {
+      SmallArray<float, 4> value = get_value(v, kept_attribute_indices[i]);
+      for (int c = 0; c < value.Size(); ++c) {
+        bounds[i].minimum[c] = std::min(bounds[i].minimum[c], value[c]);
+        bounds[i].maximum[c] = std::max(bounds[i].maximum[c], value[c]);
+      }
+    }
+  }
+  absl::StatusOr<CodingParamsArray> packing_params =
+      ComputeCodingParamsArray(*packed_format, bounds);
+  ASSERT_EQ(packing_params.status(), absl::OkStatus());
+
+  std::vector<std::byte> expected(partition_vertex_indices.size() *
+                                  packed_format->PackedVertexStride());
+  for (uint32_t p = 0; p < partition_vertex_indices.size(); ++p) {
+    size_t packed_offset = p * packed_format->PackedVertexStride();
+    for (uint32_t i = 0; i < kept_attribute_indices.size(); ++i) {
+      MeshFormat::AttributeType type = packed_format->Attributes()[i].type;
+      uint8_t packed_size = MeshFormat::PackedAttributeSize(type);
+      PackAttribute(
+          type, (*packing_params)[i],
+          get_value(partition_vertex_indices[p], kept_attribute_indices[i]),
+          absl::MakeSpan(expected).subspan(packed_offset, packed_size));
+      packed_offset += packed_size;
+    }
+    ASSERT_EQ(packed_offset, (p + 1) * packed_format->PackedVertexStride());
+  }
+
+  VertexPackingPlan plan =
+      MakeVertexPackingPlan(format, omit_set, *packing_params);
+  EXPECT_EQ(plan.packed_vertex_stride, packed_format->PackedVertexStride());
+  EXPECT_EQ(plan.attributes.size(), kept_attribute_indices.size());
+  EXPECT_THAT(CopyAndPackPartitionVertices(vertex_data,
+                                           partition_vertex_indices, plan,
+                                           overrides),
+              ElementsAreArray(expected));
+  // Without overrides, only the positions should differ.
+  std::vector<std::byte> packed_without_overrides =
+      CopyAndPackPartitionVertices(vertex_data, partition_vertex_indices, plan,
+                                   {});
+  EXPECT_EQ(packed_without_overrides.size(), expected.size());
+  EXPECT_NE(packed_without_overrides, expected);
+}
+
 TEST(MeshPackingDeathTest, WriteTriangleIndicesWrongNumberOfIndices) {
 // There is no EXPECT_DEBUG_DEATH_IF_SUPPORTED, so we only run these when
 // compiled in debug mode.
@@ -15,9 +15,15 @@
 #ifndef INK_GEOMETRY_INTERNAL_STATIC_RTREE_H_
 #define INK_GEOMETRY_INTERNAL_STATIC_RTREE_H_
 
+#include <algorithm>
 #include <cmath>
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <functional>
+#include <limits>
+#include <queue>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
@@ -25,11 +31,14 @@
 #include "absl/container/inlined_vector.h"
 #include "absl/functional/function_ref.h"
 #include "absl/log/absl_check.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
 #include "absl/strings/substitute.h"
 #include "absl/types/span.h"
-#include "ink/geometry/envelope.h"
 #include "ink/geometry/internal/intersects_internal.h"
+#include "ink/geometry/point.h"
 #include "ink/geometry/rect.h"
+#include "ink/types/parallel_for.h"
 #include "ink/types/small_array.h"
 
 namespace ink::geometry_internal {
@@ -55,6 +64,13 @@ namespace ink::geometry_internal {
 // position in the storage vectors (a `uint32_t`, 4 bytes), instead of using
 // pointers (8 bytes). This reduces allocations, improves cache locality, and
 // reduces memory footprint.
+//
+// In addition, the bounds of each branch node's children (both branch nodes
+// and elements) are stored alongside it in a structure-of-arrays layout, with
+// separate arrays for each coordinate. This allows the traversal to test a
+// query against all of a node's children in one fixed-length loop that the
+// compiler can vectorize, and means that the bounds of the elements are
+// computed only once, at construction, instead of on every query.
 template <typename T, uint32_t kBranchingFactor = 16>
 class StaticRTree {
  public:
@@ -82,31 +98,34 @@ class StaticRTree {
   StaticRTree() = default;
 
   // Constructs a `StaticRTree` containing `elements`, using `bounds_func` to
-  // compute the bounding rectangle of each element. `bounds_func` will be moved
-  // into the `StaticRTree`; if it references data owned by another object, it
-  // is the responsibility of the caller to ensure that that data remains valid
-  // for the lifetime of the `StaticRTree`.
+  // compute the bounding rectangle of each element. `bounds_func` is only
+  // called during construction, and is not retained.
+  //
+  // If `parallel_for` is given, the construction of large trees is split into
+  // tasks that are run with it; in that case, `bounds_func` may be called
+  // concurrently from multiple threads.
   //
   // This CHECK-fails if `elements` contains more than 2^32 (4294967296)
   // elements, or if `bounds_func` == nullptr.
   StaticRTree(absl::Span<const T> elements,
-              std::function<Rect(const T&)> bounds_func);
+              std::function<Rect(const T&)> bounds_func,
+              ParallelFor parallel_for = RunSerially);
 
   // Constructs a `StaticRTree` containing `n_elements` objects, which are
   // generated by repeatedly calling `generator`. `bounds_func` is used to
-  // compute the bounding rectangle of each element, and will be moved into the
-  // `StaticRTree`; if it references data owned by another object, it is the
-  // responsibility of the caller to ensure that that data remains valid for the
-  // lifetime of the `StaticRTree`.
+  // compute the bounding rectangle of each element; it is only called during
+  // construction, and is not retained.
   //
   // Template parameter `Generator` must have a zero-argument function call
   // operator that returns an object that is convertible to `T`, and it must be
-  // valid to call `generator()` at least `n_elements` times.
+  // valid to call `generator()` at least `n_elements` times. `generator` is
+  // always called serially; `parallel_for` behaves as in the other ctor.
   //
   // This CHECK-fails if `bounds_func` == nullptr.
   template <typename Generator>
   StaticRTree(uint32_t n_elements, Generator generator,
-              std::function<Rect(const T&)> bounds_func);
+              std::function<Rect(const T&)> bounds_func,
+              ParallelFor parallel_for = RunSerially);
 
   StaticRTree(const StaticRTree&) = default;
   StaticRTree(StaticRTree&&) = default;
@@ -131,14 +150,111 @@ class StaticRTree {
   void VisitIntersectedElements(
       const Rect& bounds, absl::FunctionRef<bool(const T&)> visitor) const;
 
+  // Visits the elements whose bounding box intersects each of the `queries`,
+  // as if `VisitIntersectedElements` were called once for each of them.
+  // `visitor` is passed the index of the query in `queries` and the element.
+  // If `visitor` returns false, no more elements will be visited for that
+  // query, but the traversal continues for the others. The visitation order is
+  // arbitrary, both across and within queries.
+  //
+  // This is much faster than making one call per query when there are many
+  // queries that are close to each other (e.g. the samples of an eraser
+  // gesture): the queries are sorted spatially, and the tree is descended only
+  // once, carrying along the subset of queries that overlap each node. This
+  // means that each node is only loaded once, regardless of the number of
+  // queries.
+  void VisitIntersectedElementsBatch(
+      absl::Span<const Rect> queries,
+      absl::FunctionRef<bool(uint32_t, const T&)> visitor) const;
+
+  // Visits the elements in order of increasing distance from some query
+  // object, as measured by `element_distance`, skipping any elements whose
+  // distance is greater than `max_distance`. The traversal continues until
+  // `visitor` returns false, at which point no more elements will be visited.
+  // `visitor` is passed both the element and its distance. Elements that are
+  // equidistant are visited in an arbitrary order.
+  //
+  // This performs a best-first branch-and-bound search (see
+  // https://dl.acm.org/doi/10.1145/320248.320255), so that only the nodes
+  // that may contain an element closer than the ones already visited are
+  // expanded. To do so, `bounds_distance` must return a lower bound on the
+  // distance to any element whose bounding box (per the bounds function given
+  // at construction) is contained in the given `Rect`; i.e. for any element
+  // `e` such that `bounds_func(e)` lies within `r`, it must be true that
+  // `bounds_distance(r) <= element_distance(e)`. If this is not satisfied,
+  // elements may be visited out of order.
+  //
+  // For example, if you have a `StaticRTree` containing `Segment`s, and wanted
+  // to find the three segments closest to a `Point`, you could say:
+  //   Point p;
+  //   std::vector<Segment> output;
+  //   rtree.VisitNearestElements(
+  //       [p](const Rect& r) { return Distance(p, r); },
+  //       [p](const Segment& s) { return Distance(p, s); },
+  //       std::numeric_limits<float>::infinity(),
+  //       [&output](const Segment& s, float distance) {
+  //         output.push_back(s);
+  //         return output.size() < 3;
+  //       });
+  void VisitNearestElements(
+      absl::FunctionRef<float(const Rect&)> bounds_distance,
+      absl::FunctionRef<float(const T&)> element_distance, float max_distance,
+      absl::FunctionRef<bool(const T&, float)> visitor) const;
+
+  // Serializes the tree into a flat byte buffer, which may be stored and later
+  // passed to `FromSerialized` to reconstruct the tree without rebuilding it.
+  // The buffer contains no pointers, so it can be relocated freely, but it
+  // uses the host's byte order and in-memory representation of `T`, so it is
+  // only meant to be read back on a similar host.
+  //
+  // This may only be used if `T` is trivially copyable.
+  std::vector<std::byte> Serialize() const;
+
+  // Reconstructs a `StaticRTree` from the output of `Serialize`, copying the
+  // branch nodes and elements as-is; no sorting or bounds computation is done.
+  //
+  // Returns an error if `serialized` does not describe a well-formed tree with
+  // the same branching factor: each level must have the number of nodes that a
+  // built tree would have, every branch node (other than the root) and every
+  // element must be the child of exactly one node on the level above, and the
+  // bounds of each node must contain the bounds of its children.
+  // `validate_element` is called with each element and its stored bounds; if
+  // it returns an error, that error is returned. Use it to check that the
+  // elements and their bounds match the data being indexed.
+  static absl::StatusOr<StaticRTree> FromSerialized(
+      absl::Span<const std::byte> serialized,
+      absl::FunctionRef<absl::Status(const T&, const Rect&)> validate_element);
+
   absl::Span<const BranchNode> BranchNodes() const { return branch_nodes_; }
   absl::Span<const T> Elements() const { return elements_; }
 
  private:
-  // Initializes the structure of the tree, populating `branch_nodes_`. If
-  // `elements_` is empty, this is a no-op, as there is nothing to put in the
-  // tree. CHECK-fails if `bounds_func_` == nullptr.
-  void InitializeTree();
+  // The bounds of the children of a branch node, stored as one array per
+  // coordinate. Slots past the number of children hold inverted bounds (i.e.
+  // minimum of +infinity and maximum of -infinity), which never intersect
+  // anything, so that the slots can always be tested all at once.
+  struct PackedChildBounds {
+    alignas(16) float x_min[kBranchingFactor];
+    alignas(16) float y_min[kBranchingFactor];
+    alignas(16) float x_max[kBranchingFactor];
+    alignas(16) float y_max[kBranchingFactor];
+  };
+
+  // Initializes the structure of the tree, populating `branch_nodes_` and
+  // `packed_child_bounds_`. If `elements_` is empty, this is a no-op, as there
+  // is nothing to put in the tree. CHECK-fails if `bounds_func` == nullptr.
+  void InitializeTree(const std::function<Rect(const T&)>& bounds_func,
+                      ParallelFor parallel_for);
+
+  // Sets `hits[i]` to whether the bounds of the i-th child of the branch node
+  // at `node_idx` intersect `query`. This is a fixed-length, branch-free loop
+  // over the packed coordinates, which compilers vectorize to test 4 (SSE,
+  // NEON) or 8 (AVX) children at a time.
+  void ComputeIntersectedChildren(uint32_t node_idx, const Rect& query,
+                                  bool (&hits)[kBranchingFactor]) const;
+
+  // Returns the bounds of the i-th child of the branch node at `node_idx`.
+  Rect ChildBounds(uint32_t node_idx, uint32_t i) const;
 
   // This is a helper method for `VisitIntersectedElements`, which visits the
   // sub-tree whose root is the branch node at index `sub_tree_root_index`. This
@@ -148,17 +264,44 @@ class StaticRTree {
       uint32_t sub_tree_root_idx, const Rect& bounds,
       absl::FunctionRef<bool(const T&)> visitor) const;
 
+  // The state of a call to `VisitIntersectedElementsBatch`.
+  struct BatchTraversal {
+    absl::Span<const Rect> queries;
+    absl::FunctionRef<bool(uint32_t, const T&)> visitor;
+    // The indices of the queries that overlap the nodes on the current path
+    // from the root. The queries for each node are appended to the end of the
+    // queries for its parent, and removed again when the traversal leaves the
+    // node, so this is only ever as large as the sum of the sizes of the
+    // subsets along one path.
+    std::vector<uint32_t> active_queries;
+    // Whether the visitor has returned false for each query.
+    std::vector<bool> finished;
+    uint32_t n_unfinished;
+  };
+
+  // This is a helper method for `VisitIntersectedElementsBatch`, which visits
+  // the sub-tree whose root is the branch node at index `sub_tree_root_index`
+  // for the queries at indices [`active_begin`, `active_end`) in
+  // `traversal.active_queries`. This returns `true` if the traversal should
+  // continue, or `false` if every query has finished.
+  bool VisitIntersectedElementsBatchInSubTree(uint32_t sub_tree_root_idx,
+                                              uint32_t active_begin,
+                                              uint32_t active_end,
+                                              BatchTraversal& traversal) const;
+
   // The branch nodes are stored such that each node has a depth at least as
   // great as the previous one. This means that the root will always be the
   // first element, and that all branch nodes of a particular depth occupy a
   // contiguous span of `branch_nodes`.
   std::vector<BranchNode> branch_nodes_;
 
+  // The bounds of the children of each branch node, such that
+  // `packed_child_bounds_[i]` belongs to `branch_nodes_[i]`.
+  std::vector<PackedChildBounds> packed_child_bounds_;
+
   // The data elements in the R-Tree, which are also the leaf nodes (since they
   // contain no other information).
   std::vector<T> elements_;
-
-  std::function<Rect(const T&)> bounds_func_;
 };
 
 // -----------------------------------------------------------------------------
@@ -189,6 +332,76 @@ absl::InlinedVector<uint32_t, kMaxExpectedRTreeBranchDepth>
 ComputeRTreeBranchDepthOffsets(
     absl::Span<const uint32_t> n_branch_nodes_at_depth);
 
+// A serialized `StaticRTree` begins with this header, which is followed by one
+// fixed-size record per branch node, and then the raw bytes of the elements.
+// Each branch node record contains, in order:
+// - the number of children, as a `uint32_t`
+// - whether the children are elements, as a `uint32_t` that is either 0 or 1
+// - the node's bounds, as four `float`s: x-min, y-min, x-max, y-max
+// - the indices of the children, as `kBranchingFactor` `uint32_t`s (unused
+//   slots are zero)
+// - the bounds of the children, as four arrays of `kBranchingFactor` `float`s:
+//   x-mins, y-mins, x-maxes, y-maxes (unused slots hold inverted infinities)
+// All values are stored in host byte order.
+struct RTreeSerializedHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t branching_factor;
+  uint32_t element_size;
+  uint32_t n_elements;
+  uint32_t n_branch_nodes;
+};
+
+// The value of `RTreeSerializedHeader::magic`. A buffer that was serialized on
+// a host with a different byte order will not match this.
+inline constexpr uint32_t kRTreeSerializedMagic = 0x494e4b52;  // "INKR"
+inline constexpr uint32_t kRTreeSerializedVersion = 1;
+
+// Returns the size of the record for one branch node in a serialized
+// `StaticRTree`.
+constexpr size_t RTreeSerializedBranchNodeSize(uint32_t branching_factor) {
+  return 2 * sizeof(uint32_t) + 4 * sizeof(float) +
+         branching_factor * (sizeof(uint32_t) + 4 * sizeof(float));
+}
+
+// Reads consecutive values from a serialized `StaticRTree`. The caller is
+// responsible for checking that the buffer is large enough.
+class RTreeSerializedReader {
+ public:
+  explicit RTreeSerializedReader(absl::Span<const std::byte> bytes)
+      : bytes_(bytes) {}
+
+  template <typename V>
+  V Read() {
+    V value;
+    ReadInto(&value, sizeof(V));
+    return value;
+  }
+
+  void ReadInto(void* dst, size_t size) {
+    ABSL_DCHECK_LE(size, bytes_.size());
+    std::memcpy(dst, bytes_.data(), size);
+    bytes_.remove_prefix(size);
+  }
+
+ private:
+  absl::Span<const std::byte> bytes_;
+};
+
+// An entry in the scratch buffer that is used to sort the nodes of one level of
+// a `StaticRTree` while bulk-loading it. The bounds are stored inline, so that
+// sorting doesn't need to look them up on every comparison.
+struct RTreeBulkLoadEntry {
+  Rect bounds;
+  uint32_t index;
+};
+
+// When bulk-loading a `StaticRTree` with a `ParallelFor`, each level is split
+// into tasks of roughly this many nodes. Levels with fewer nodes than this are
+// always loaded serially, since the cost of distributing the work would
+// outweigh the benefit.
+inline constexpr uint32_t kRTreeBulkLoadTaskSize = 4096;
+
 // Helper function for the `StaticRTree` ctor, bulk-loads one level of the
 // R-Tree using the Sort-Tile-Recursive algorithm
 // (www.cs.odu.edu/~mln/ltrs-pdfs/icase-1997-14.pdf),
@@ -201,15 +414,24 @@ ComputeRTreeBranchDepthOffsets(
 //
 // Template parameter `ChildBoundsGetter` should be a functor of the form:
 //   Rect Foo(uint32_t child_index)
-// which returns the bounding rectangle for the child node at `child_index`.
+// which returns the bounding rectangle for the child node at `child_index`. It
+// is called exactly once per child node.
 //
 // Template parameter `ParentAssigner` should be a functor of the form:
 //   void Bar(uint32_t parent_index, const Rect& child_bounds,
-//            absl::Span<const uint32_t> child_indices)
+//            absl::Span<const RTreeBulkLoadEntry> children)
 // which sets any fields necessary to make the parent node at `parent_index` the
-// parent of the child nodes at `child_indices`. `child_bounds` will be the
-// rectangle that contains all of the child nodes referred to by
-// `child_indices`.
+// parent of the child nodes in `children`. `child_bounds` will be the
+// rectangle that contains all of the child nodes in `children`.
+//
+// `scratch` must have room for at least `n_child_nodes` entries; it is used to
+// sort the child nodes, so that the same buffer can be reused for every level.
+//
+// If the level is large enough, the child bounds are computed, and the slices
+// of the level are sorted and assigned to their parents, in parallel using
+// `parallel_for`. In that case, `get_child_bounds` and
+// `assign_children_to_parent` may be called concurrently, but never for the
+// same child or parent.
 template <typename ChildBoundsGetter, typename ParentAssigner>
 void BulkLoadOneLevelOfNodes(uint32_t index_of_first_parent_node,
                              uint32_t n_parent_nodes,
@@ -217,11 +439,37 @@ void BulkLoadOneLevelOfNodes(uint32_t index_of_first_parent_node,
                              uint32_t n_child_nodes,
                              ChildBoundsGetter get_child_bounds,
                              ParentAssigner assign_children_to_parent,
-                             int branching_factor) {
+                             int branching_factor,
+                             absl::Span<RTreeBulkLoadEntry> scratch,
+                             ParallelFor parallel_for) {
   // These should be guaranteed by the logic in the ctor.
   ABSL_DCHECK_GT(n_child_nodes, 0u);
   ABSL_DCHECK_EQ(n_parent_nodes, std::ceil(static_cast<double>(n_child_nodes) /
                                            branching_factor));
+  ABSL_DCHECK_GE(scratch.size(), n_child_nodes);
+
+  bool use_parallel_for = n_child_nodes >= kRTreeBulkLoadTaskSize;
+
+  // Instead of sorting the nodes themselves, which would invalidate any
+  // references to them by index, we make a list of their bounds and indices,
+  // and sort those.
+  absl::Span<RTreeBulkLoadEntry> entries = scratch.subspan(0, n_child_nodes);
+  auto fill_entries = [&entries, &get_child_bounds, index_of_first_child_node,
+                       n_child_nodes](uint32_t task_idx) {
+    uint32_t end =
+        std::min(n_child_nodes, (task_idx + 1) * kRTreeBulkLoadTaskSize);
+    for (uint32_t i = task_idx * kRTreeBulkLoadTaskSize; i < end; ++i) {
+      uint32_t child_idx = index_of_first_child_node + i;
+      entries[i] = {.bounds = get_child_bounds(child_idx), .index = child_idx};
+    }
+  };
+  uint32_t n_fill_tasks =
+      (n_child_nodes + kRTreeBulkLoadTaskSize - 1) / kRTreeBulkLoadTaskSize;
+  if (use_parallel_for) {
+    parallel_for(n_fill_tasks, fill_entries);
+  } else {
+    RunSerially(n_fill_tasks, fill_entries);
+  }
 
   // We bulk-load each level using the Sort-Tile-Recursive algorithm
   // (www.cs.odu.edu/~mln/ltrs-pdfs/icase-1997-14.pdf),
@@ -230,33 +478,24 @@ void BulkLoadOneLevelOfNodes(uint32_t index_of_first_parent_node,
   // many parent nodes are needed, then attempts to group the child nodes such
   // that groups approximate a k-by-k grid, s.t. k = ceil(sqrt(N / B)), N =
   // `n_child_nodes`, and B = `branching_factor`.
-
-  auto compare_child_nodes_by_x = [&get_child_bounds](uint32_t lhs_idx,
-                                                      uint32_t rhs_idx) {
-    return get_child_bounds(lhs_idx).XMin() < get_child_bounds(rhs_idx).XMin();
-  };
-  auto compare_child_nodes_by_y = [&get_child_bounds](uint32_t lhs_idx,
-                                                      uint32_t rhs_idx) {
-    return get_child_bounds(lhs_idx).YMin() < get_child_bounds(rhs_idx).YMin();
-  };
-
-  // Instead of sorting the nodes themselves, which would invalidate any
-  // references to them by index, we make a list of the indices, and sort those.
-  std::vector<uint32_t> sortable_child_indices(n_child_nodes);
-  absl::c_iota(sortable_child_indices, index_of_first_child_node);
-
   uint32_t n_tiles =
       std::ceil(static_cast<double>(n_child_nodes) / branching_factor);
   uint32_t base_slice_size =
       std::ceil(std::sqrt(static_cast<double>(n_tiles))) * branching_factor;
   uint32_t n_slices =
       std::ceil(static_cast<double>(n_child_nodes) / base_slice_size);
+  // Every slice but the last contains exactly this many tiles, which lets each
+  // slice compute the indices of its parent nodes independently.
+  uint32_t n_tiles_per_full_slice = base_slice_size / branching_factor;
 
   // Sort the child nodes by x-coordinate, so that they can be divided
   // vertically to form slices.
-  absl::c_sort(sortable_child_indices, compare_child_nodes_by_x);
-  uint32_t parent_idx = index_of_first_parent_node;
-  for (uint32_t slice_idx = 0; slice_idx < n_slices; ++slice_idx) {
+  absl::c_sort(entries, [](const RTreeBulkLoadEntry& lhs,
+                           const RTreeBulkLoadEntry& rhs) {
+    return lhs.bounds.XMin() < rhs.bounds.XMin();
+  });
+
+  auto load_slice = [&](uint32_t slice_idx) {
     uint32_t first_child_in_slice = slice_idx * base_slice_size;
     // The last slice will have fewer children if `n_child_nodes` is not a
     // multiple of `base_slice_size`.
@@ -268,64 +507,73 @@ void BulkLoadOneLevelOfNodes(uint32_t index_of_first_parent_node,
 
     // Sort the child nodes in this slice by y-coordinate, so that they can be
     // divided horizontally to form tiles.
-    auto slice_child_indices = absl::MakeSpan(
-        &sortable_child_indices[first_child_in_slice], n_children_in_slice);
-    absl::c_sort(slice_child_indices, compare_child_nodes_by_y);
+    absl::Span<RTreeBulkLoadEntry> slice_entries =
+        entries.subspan(first_child_in_slice, n_children_in_slice);
+    absl::c_sort(slice_entries, [](const RTreeBulkLoadEntry& lhs,
+                                   const RTreeBulkLoadEntry& rhs) {
+      return lhs.bounds.YMin() < rhs.bounds.YMin();
+    });
     for (uint32_t tile_idx = 0; tile_idx < n_tiles_in_slice; ++tile_idx) {
       uint32_t first_child_in_tile = tile_idx * branching_factor;
       // The last tile will have fewer children if `n_children_in_slice` is not
       // a multiple of `branching_factor`.
       uint32_t n_children_in_tile =
-          tile_idx == n_tiles - 1 ? n_children_in_slice - first_child_in_tile
-                                  : branching_factor;
-
-      absl::Span<const uint32_t> tile_child_indices =
-          slice_child_indices.subspan(first_child_in_tile, n_children_in_tile);
-      Envelope envelope;
-      for (uint32_t child_idx : tile_child_indices) {
-        envelope.Add(get_child_bounds(child_idx));
+          std::min<uint32_t>(branching_factor,
+                             n_children_in_slice - first_child_in_tile);
+
+      absl::Span<const RTreeBulkLoadEntry> tile_entries =
+          slice_entries.subspan(first_child_in_tile, n_children_in_tile);
+      Rect tile_bounds = tile_entries.front().bounds;
+      for (const RTreeBulkLoadEntry& entry : tile_entries) {
+        tile_bounds.Join(entry.bounds);
       }
 
+      uint32_t parent_idx = index_of_first_parent_node +
+                            slice_idx * n_tiles_per_full_slice + tile_idx;
       // This should be guaranteed by the logic in the ctor.
       ABSL_DCHECK_LT(parent_idx, index_of_first_parent_node + n_parent_nodes);
-      assign_children_to_parent(parent_idx, *envelope.AsRect(),
-                                tile_child_indices);
-      ++parent_idx;
+      assign_children_to_parent(parent_idx, tile_bounds, tile_entries);
     }
+  };
+  if (use_parallel_for) {
+    parallel_for(n_slices, load_slice);
+  } else {
+    RunSerially(n_slices, load_slice);
   }
 }
 
 template <typename T, uint32_t kBranchingFactor>
 StaticRTree<T, kBranchingFactor>::StaticRTree(
-    absl::Span<const T> elements, std::function<Rect(const T&)> bounds_func)
-    : elements_(elements.begin(), elements.end()),
-      bounds_func_(std::move(bounds_func)) {
+    absl::Span<const T> elements, std::function<Rect(const T&)> bounds_func,
+    ParallelFor parallel_for)
+    : elements_(elements.begin(), elements.end()) {
   ABSL_CHECK_LE(elements.size(), uint64_t{1} << 32) << absl::Substitute(
       "StaticRTree supports a maximum of 2^32 (4294967296) elements; $0 were "
       "given",
       elements.size());
-  InitializeTree();
+  InitializeTree(bounds_func, parallel_for);
 }
 
 template <typename T, uint32_t kBranchingFactor>
 template <typename Generator>
 StaticRTree<T, kBranchingFactor>::StaticRTree(
     uint32_t n_elements, Generator generator,
-    std::function<Rect(const T&)> bounds_func)
-    : bounds_func_(std::move(bounds_func)) {
+    std::function<Rect(const T&)> bounds_func, ParallelFor parallel_for) {
   elements_.resize(n_elements);
   absl::c_generate(elements_, generator);
-  InitializeTree();
+  InitializeTree(bounds_func, parallel_for);
 }
 
 template <typename T, uint32_t kBranchingFactor>
-void StaticRTree<T, kBranchingFactor>::InitializeTree() {
+void StaticRTree<T, kBranchingFactor>::InitializeTree(
+    const std::function<Rect(const T&)>& bounds_func,
+    ParallelFor parallel_for) {
   if (elements_.empty()) {
     // This is an empty R-Tree, there is nothing to initialize.
     return;
   }
 
-  ABSL_CHECK(bounds_func_ != nullptr) << "bounds_func must be non-null";
+  ABSL_CHECK(bounds_func != nullptr) << "bounds_func must be non-null";
 
   absl::InlinedVector<uint32_t, kMaxExpectedRTreeBranchDepth>
       n_branch_nodes_at_depth = ComputeNumberOfRTreeBranchNodesAtDepth(
@@ -336,49 +584,356 @@ void StaticRTree<T, kBranchingFactor>::InitializeTree() {
 
   branch_nodes_.resize(branch_depth_offsets.back() +
                        n_branch_nodes_at_depth.back());
+  packed_child_bounds_.resize(branch_nodes_.size());
 
-  std::vector<Rect> leaf_bounds(elements_.size());
-  absl::c_transform(elements_, leaf_bounds.begin(), bounds_func_);
+  // The leaf level is the largest, so this is big enough for every level.
+  std::vector<RTreeBulkLoadEntry> scratch(elements_.size());
 
-  auto get_leaf_bounds = [bounds = std::move(leaf_bounds)](uint32_t idx) {
-    return bounds[idx];
+  auto get_leaf_bounds = [this, &bounds_func](uint32_t idx) {
+    return bounds_func(elements_[idx]);
   };
   auto get_branch_bounds = [this](uint32_t idx) {
     return branch_nodes_[idx].bounds;
   };
 
-  auto assign_leaf_children_to_parent =
-      [this](uint32_t parent_idx, const Rect& child_bounds,
-             absl::Span<const uint32_t> child_indices) {
+  auto assign_children_to_parent =
+      [this](uint32_t parent_idx, const Rect& child_bounds, bool is_leaf_parent,
+             absl::Span<const RTreeBulkLoadEntry> children) {
         BranchNode& parent = branch_nodes_[parent_idx];
         parent.bounds = child_bounds;
-        parent.is_leaf_parent = true;
-        parent.child_indices =
-            SmallArray<uint32_t, kBranchingFactor>(child_indices);
+        parent.is_leaf_parent = is_leaf_parent;
+        parent.child_indices.Resize(children.size());
+        PackedChildBounds& packed = packed_child_bounds_[parent_idx];
+        for (uint32_t i = 0; i < kBranchingFactor; ++i) {
+          if (i < children.size()) {
+            parent.child_indices[i] = children[i].index;
+            packed.x_min[i] = children[i].bounds.XMin();
+            packed.y_min[i] = children[i].bounds.YMin();
+            packed.x_max[i] = children[i].bounds.XMax();
+            packed.y_max[i] = children[i].bounds.YMax();
+          } else {
+            packed.x_min[i] = std::numeric_limits<float>::infinity();
+            packed.y_min[i] = std::numeric_limits<float>::infinity();
+            packed.x_max[i] = -std::numeric_limits<float>::infinity();
+            packed.y_max[i] = -std::numeric_limits<float>::infinity();
+          }
+        }
+      };
+  auto assign_leaf_children_to_parent =
+      [&assign_children_to_parent](
+          uint32_t parent_idx, const Rect& child_bounds,
+          absl::Span<const RTreeBulkLoadEntry> children) {
+        assign_children_to_parent(parent_idx, child_bounds,
+                                  /* is_leaf_parent = */ true, children);
       };
   auto assign_branch_children_to_parent =
-      [this](uint32_t parent_idx, const Rect& child_bounds,
-             absl::Span<const uint32_t> child_indices) {
-        BranchNode& parent = branch_nodes_[parent_idx];
-        parent.bounds = child_bounds;
-        parent.is_leaf_parent = false;
-        parent.child_indices =
-            SmallArray<uint32_t, kBranchingFactor>(child_indices);
+      [&assign_children_to_parent](
+          uint32_t parent_idx, const Rect& child_bounds,
+          absl::Span<const RTreeBulkLoadEntry> children) {
+        assign_children_to_parent(parent_idx, child_bounds,
+                                  /* is_leaf_parent = */ false, children);
       };
 
   BulkLoadOneLevelOfNodes(
       branch_depth_offsets.back(), n_branch_nodes_at_depth.back(),
       /* index_of_first_child_node = */ 0, elements_.size(), get_leaf_bounds,
-      assign_leaf_children_to_parent, kBranchingFactor);
+      assign_leaf_children_to_parent, kBranchingFactor,
+      absl::MakeSpan(scratch), parallel_for);
 
   for (int depth = n_branch_nodes_at_depth.size() - 2; depth >= 0; --depth) {
     BulkLoadOneLevelOfNodes(
         branch_depth_offsets[depth], n_branch_nodes_at_depth[depth],
         branch_depth_offsets[depth + 1], n_branch_nodes_at_depth[depth + 1],
-        get_branch_bounds, assign_branch_children_to_parent, kBranchingFactor);
+        get_branch_bounds, assign_branch_children_to_parent, kBranchingFactor,
+        absl::MakeSpan(scratch), parallel_for);
   }
 }
 
+template <typename T, uint32_t kBranchingFactor>
+std::vector<std::byte> StaticRTree<T, kBranchingFactor>::Serialize() const {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "Only a StaticRTree of trivially copyable elements can be "
+                "serialized");
+
+  std::vector<std::byte> serialized;
+  serialized.reserve(sizeof(RTreeSerializedHeader) +
+                     branch_nodes_.size() *
+                         RTreeSerializedBranchNodeSize(kBranchingFactor) +
+                     elements_.size() * sizeof(T));
+  auto append = [&serialized](const void* src, size_t size) {
+    const std::byte* bytes = static_cast<const std::byte*>(src);
+    serialized.insert(serialized.end(), bytes, bytes + size);
+  };
+  auto append_value = [&append](const auto& value) {
+    append(&value, sizeof(value));
+  };
+
+  append_value(kRTreeSerializedMagic);
+  append_value(kRTreeSerializedVersion);
+  append_value(kBranchingFactor);
+  append_value(static_cast<uint32_t>(sizeof(T)));
+  append_value(static_cast<uint32_t>(elements_.size()));
+  append_value(static_cast<uint32_t>(branch_nodes_.size()));
+  for (uint32_t node_idx = 0; node_idx < branch_nodes_.size(); ++node_idx) {
+    const BranchNode& node = branch_nodes_[node_idx];
+    append_value(static_cast<uint32_t>(node.child_indices.Size()));
+    append_value(static_cast<uint32_t>(node.is_leaf_parent));
+    append_value(node.bounds.XMin());
+    append_value(node.bounds.YMin());
+    append_value(node.bounds.XMax());
+    append_value(node.bounds.YMax());
+    for (uint32_t i = 0; i < kBranchingFactor; ++i) {
+      append_value(i < node.child_indices.Size() ? node.child_indices[i] : 0u);
+    }
+    const PackedChildBounds& packed = packed_child_bounds_[node_idx];
+    append_value(packed.x_min);
+    append_value(packed.y_min);
+    append_value(packed.x_max);
+    append_value(packed.y_max);
+  }
+  append(elements_.data(), elements_.size() * sizeof(T));
+  return serialized;
+}
+
+template <typename T, uint32_t kBranchingFactor>
+absl::StatusOr<StaticRTree<T, kBranchingFactor>>
+StaticRTree<T, kBranchingFactor>::FromSerialized(
+    absl::Span<const std::byte> serialized,
+    absl::FunctionRef<absl::Status(const T&, const Rect&)> validate_element) {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "Only a StaticRTree of trivially copyable elements can be "
+                "serialized");
+
+  if (serialized.size() < sizeof(RTreeSerializedHeader)) {
+    return absl::InvalidArgumentError(
+        absl::Substitute("Serialized StaticRTree is too small to contain a "
+                         "header: $0 bytes",
+                         serialized.size()));
+  }
+  RTreeSerializedReader reader(serialized);
+  RTreeSerializedHeader header;
+  header.magic = reader.Read<uint32_t>();
+  header.version = reader.Read<uint32_t>();
+  header.branching_factor = reader.Read<uint32_t>();
+  header.element_size = reader.Read<uint32_t>();
+  header.n_elements = reader.Read<uint32_t>();
+  header.n_branch_nodes = reader.Read<uint32_t>();
+  if (header.magic != kRTreeSerializedMagic) {
+    return absl::InvalidArgumentError(
+        "Buffer is not a serialized StaticRTree, or was serialized on a host "
+        "with a different byte order");
+  }
+  if (header.version != kRTreeSerializedVersion) {
+    return absl::InvalidArgumentError(absl::Substitute(
+        "Unsupported serialized StaticRTree version: $0", header.version));
+  }
+  if (header.branching_factor != kBranchingFactor ||
+      header.element_size != sizeof(T)) {
+    return absl::InvalidArgumentError(absl::Substitute(
+        "Serialized StaticRTree has branching factor $0 and element size $1, "
+        "expected $2 and $3",
+        header.branching_factor, header.element_size, kBranchingFactor,
+        sizeof(T)));
+  }
+  uint64_t expected_size =
+      sizeof(RTreeSerializedHeader) +
+      static_cast<uint64_t>(header.n_branch_nodes) *
+          RTreeSerializedBranchNodeSize(kBranchingFactor) +
+      static_cast<uint64_t>(header.n_elements) * sizeof(T);
+  if (serialized.size() != expected_size) {
+    return absl::InvalidArgumentError(absl::Substitute(
+        "Serialized StaticRTree with $0 branch nodes and $1 elements should "
+        "be $2 bytes, but is $3 bytes",
+        header.n_branch_nodes, header.n_elements, expected_size,
+        serialized.size()));
+  }
+
+  StaticRTree rtree;
+  if (header.n_elements == 0) {
+    if (header.n_branch_nodes != 0) {
+      return absl::InvalidArgumentError(
+          "Serialized StaticRTree has branch nodes but no elements");
+    }
+    return rtree;
+  }
+
+  // We require the same level structure as `InitializeTree` produces, which
+  // bounds the depth of the tree, and makes it easy to check that each node is
+  // only referenced from the level above it.
+  absl::InlinedVector<uint32_t, kMaxExpectedRTreeBranchDepth>
+      n_branch_nodes_at_depth = ComputeNumberOfRTreeBranchNodesAtDepth(
+          header.n_elements, kBranchingFactor);
+  absl::InlinedVector<uint32_t, kMaxExpectedRTreeBranchDepth>
+      branch_depth_offsets =
+          ComputeRTreeBranchDepthOffsets(n_branch_nodes_at_depth);
+  if (header.n_branch_nodes !=
+      branch_depth_offsets.back() + n_branch_nodes_at_depth.back()) {
+    return absl::InvalidArgumentError(absl::Substitute(
+        "Serialized StaticRTree with $0 elements should have $1 branch nodes, "
+        "but has $2",
+        header.n_elements,
+        branch_depth_offsets.back() + n_branch_nodes_at_depth.back(),
+        header.n_branch_nodes));
+  }
+
+  constexpr float kInf = std::numeric_limits<float>::infinity();
+  rtree.branch_nodes_.resize(header.n_branch_nodes);
+  rtree.packed_child_bounds_.resize(header.n_branch_nodes);
+  uint32_t depth = 0;
+  for (uint32_t node_idx = 0; node_idx < header.n_branch_nodes; ++node_idx) {
+    if (depth + 1 < branch_depth_offsets.size() &&
+        node_idx == branch_depth_offsets[depth + 1]) {
+      ++depth;
+    }
+    bool is_last_level = depth + 1 == branch_depth_offsets.size();
+    BranchNode& node = rtree.branch_nodes_[node_idx];
+    PackedChildBounds& packed = rtree.packed_child_bounds_[node_idx];
+
+    uint32_t n_children = reader.Read<uint32_t>();
+    uint32_t is_leaf_parent = reader.Read<uint32_t>();
+    float x_min = reader.Read<float>();
+    float y_min = reader.Read<float>();
+    float x_max = reader.Read<float>();
+    float y_max = reader.Read<float>();
+    uint32_t child_indices[kBranchingFactor];
+    reader.ReadInto(child_indices, sizeof(child_indices));
+    reader.ReadInto(packed.x_min, sizeof(packed.x_min));
+    reader.ReadInto(packed.y_min, sizeof(packed.y_min));
+    reader.ReadInto(packed.x_max, sizeof(packed.x_max));
+    reader.ReadInto(packed.y_max, sizeof(packed.y_max));
+
+    if (n_children == 0 || n_children > kBranchingFactor) {
+      return absl::InvalidArgumentError(absl::Substitute(
+          "Branch node $0 has $1 children", node_idx, n_children));
+    }
+    if (is_leaf_parent != static_cast<uint32_t>(is_last_level)) {
+      return absl::InvalidArgumentError(absl::Substitute(
+          "Branch node $0 has `is_leaf_parent` = $1, expected $2", node_idx,
+          is_leaf_parent, is_last_level));
+    }
+    // Note that these comparisons are false if any value is NaN.
+    if (!(x_min <= x_max && y_min <= y_max)) {
+      return absl::InvalidArgumentError(
+          absl::Substitute("Branch node $0 has invalid bounds", node_idx));
+    }
+    uint32_t first_valid_child =
+        is_last_level ? 0 : branch_depth_offsets[depth + 1];
+    uint32_t end_valid_child = is_last_level
+                                   ? header.n_elements
+                                   : first_valid_child +
+                                         n_branch_nodes_at_depth[depth + 1];
+    for (uint32_t i = 0; i < kBranchingFactor; ++i) {
+      if (i >= n_children) {
+        if (packed.x_min[i] != kInf || packed.y_min[i] != kInf ||
+            packed.x_max[i] != -kInf || packed.y_max[i] != -kInf) {
+          return absl::InvalidArgumentError(absl::Substitute(
+              "Branch node $0 has non-empty bounds for unused child slot $1",
+              node_idx, i));
+        }
+        continue;
+      }
+      if (child_indices[i] < first_valid_child ||
+          child_indices[i] >= end_valid_child) {
+        return absl::InvalidArgumentError(absl::Substitute(
+            "Branch node $0 has out-of-range child index $1", node_idx,
+            child_indices[i]));
+      }
+      if (!(x_min <= packed.x_min[i] && packed.x_min[i] <= packed.x_max[i] &&
+            packed.x_max[i] <= x_max && y_min <= packed.y_min[i] &&
+            packed.y_min[i] <= packed.y_max[i] && packed.y_max[i] <= y_max)) {
+        return absl::InvalidArgumentError(absl::Substitute(
+            "Branch node $0 has invalid bounds for child $1", node_idx, i));
+      }
+    }
+
+    node.bounds = Rect::FromTwoPoints({x_min, y_min}, {x_max, y_max});
+    node.is_leaf_parent = is_last_level;
+    node.child_indices.Resize(n_children);
+    for (uint32_t i = 0; i < n_children; ++i) {
+      node.child_indices[i] = child_indices[i];
+    }
+  }
+
+  rtree.elements_.resize(header.n_elements);
+  reader.ReadInto(rtree.elements_.data(), header.n_elements * sizeof(T));
+
+  // Now that every node has been read, check that each node is referenced
+  // exactly once, and that the stored bounds of each child match the child.
+  // Since every child index was checked to be on the level below its parent,
+  // and the number of nodes on each level is fixed, this means that every node
+  // and element is reachable from the root.
+  std::vector<bool> is_referenced_branch(header.n_branch_nodes, false);
+  std::vector<bool> is_referenced_element(header.n_elements, false);
+  for (uint32_t node_idx = 0; node_idx < header.n_branch_nodes; ++node_idx) {
+    const BranchNode& node = rtree.branch_nodes_[node_idx];
+    std::vector<bool>& is_referenced =
+        node.is_leaf_parent ? is_referenced_element : is_referenced_branch;
+    for (uint32_t i = 0; i < node.child_indices.Size(); ++i) {
+      uint32_t child_idx = node.child_indices[i];
+      if (is_referenced[child_idx]) {
+        return absl::InvalidArgumentError(absl::Substitute(
+            "$0 $1 is the child of more than one branch node",
+            node.is_leaf_parent ? "Element" : "Branch node", child_idx));
+      }
+      is_referenced[child_idx] = true;
+      Rect child_bounds = rtree.ChildBounds(node_idx, i);
+      if (node.is_leaf_parent) {
+        if (absl::Status status =
+                validate_element(rtree.elements_[child_idx], child_bounds);
+            !status.ok()) {
+          return status;
+        }
+      } else {
+        const Rect& bounds = rtree.branch_nodes_[child_idx].bounds;
+        if (child_bounds.XMin() != bounds.XMin() ||
+            child_bounds.YMin() != bounds.YMin() ||
+            child_bounds.XMax() != bounds.XMax() ||
+            child_bounds.YMax() != bounds.YMax()) {
+          return absl::InvalidArgumentError(absl::Substitute(
+              "Branch node $0 has stored bounds for child $1 that do not "
+              "match the child's bounds",
+              node_idx, child_idx));
+        }
+      }
+    }
+  }
+  if (absl::c_count(is_referenced_element, false) != 0 ||
+      absl::c_count(is_referenced_branch, false) != 1) {
+    return absl::InvalidArgumentError(
+        "Serialized StaticRTree has unreferenced nodes");
+  }
+
+  return rtree;
+}
+
+template <typename T, uint32_t kBranchingFactor>
+void StaticRTree<T, kBranchingFactor>::ComputeIntersectedChildren(
+    uint32_t node_idx, const Rect& query,
+    bool (&hits)[kBranchingFactor]) const {
+  const PackedChildBounds& packed = packed_child_bounds_[node_idx];
+  float query_x_min = query.XMin();
+  float query_y_min = query.YMin();
+  float query_x_max = query.XMax();
+  float query_y_max = query.YMax();
+  // This is equivalent to `IntersectsInternal(const Rect&, const Rect&)`.
+  // Note the use of bitwise rather than logical "and", which avoids the
+  // short-circuiting branches that would prevent vectorization.
+  for (uint32_t i = 0; i < kBranchingFactor; ++i) {
+    hits[i] = (packed.x_min[i] <= query_x_max) &
+              (packed.x_max[i] >= query_x_min) &
+              (packed.y_min[i] <= query_y_max) &
+              (packed.y_max[i] >= query_y_min);
+  }
+}
+
+template <typename T, uint32_t kBranchingFactor>
+Rect StaticRTree<T, kBranchingFactor>::ChildBounds(uint32_t node_idx,
+                                                   uint32_t i) const {
+  const PackedChildBounds& packed = packed_child_bounds_[node_idx];
+  return Rect::FromTwoPoints({packed.x_min[i], packed.y_min[i]},
+                             {packed.x_max[i], packed.y_max[i]});
+}
+
 template <typename T, uint32_t kBranchingFactor>
 void StaticRTree<T, kBranchingFactor>::VisitIntersectedElements(
     const Rect& bounds, absl::FunctionRef<bool(const T&)> visitor) const {
@@ -386,22 +941,125 @@ void StaticRTree<T, kBranchingFactor>::VisitIntersectedElements(
   VisitIntersectedElementsInSubTree(0, bounds, visitor);
 }
 
+template <typename T, uint32_t kBranchingFactor>
+void StaticRTree<T, kBranchingFactor>::VisitIntersectedElementsBatch(
+    absl::Span<const Rect> queries,
+    absl::FunctionRef<bool(uint32_t, const T&)> visitor) const {
+  if (branch_nodes_.empty() || queries.empty()) return;
+
+  BatchTraversal traversal = {
+      .queries = queries,
+      .visitor = visitor,
+      .finished = std::vector<bool>(queries.size(), false),
+      .n_unfinished = static_cast<uint32_t>(queries.size())};
+  traversal.active_queries.reserve(2 * queries.size());
+  const Rect& root_bounds = branch_nodes_.front().bounds;
+  for (uint32_t i = 0; i < queries.size(); ++i) {
+    if (IntersectsInternal(root_bounds, queries[i])) {
+      traversal.active_queries.push_back(i);
+    }
+  }
+  // Sorting the queries spatially means that the subsets of queries carried
+  // into each child node tend to be contiguous runs, which keeps the
+  // per-element loops over them coherent.
+  absl::c_sort(traversal.active_queries, [&queries](uint32_t a, uint32_t b) {
+    Point a_center = queries[a].Center();
+    Point b_center = queries[b].Center();
+    if (a_center.x != b_center.x) return a_center.x < b_center.x;
+    return a_center.y < b_center.y;
+  });
+  uint32_t n_active = traversal.active_queries.size();
+  if (n_active == 0) return;
+  VisitIntersectedElementsBatchInSubTree(0, 0, n_active, traversal);
+}
+
+template <typename T, uint32_t kBranchingFactor>
+void StaticRTree<T, kBranchingFactor>::VisitNearestElements(
+    absl::FunctionRef<float(const Rect&)> bounds_distance,
+    absl::FunctionRef<float(const T&)> element_distance, float max_distance,
+    absl::FunctionRef<bool(const T&, float)> visitor) const {
+  if (branch_nodes_.empty()) return;
+
+  // An entry in the search queue. The distance of a branch node or unresolved
+  // leaf is a lower bound computed from its bounding box; the distance of a
+  // resolved leaf is the exact distance to the element.
+  enum class EntryType : uint8_t { kResolvedLeaf, kUnresolvedLeaf, kBranch };
+  struct QueueEntry {
+    float distance;
+    EntryType type;
+    uint32_t index;
+  };
+  // `std::priority_queue` is a max-heap, so this orders the entries such that
+  // the top of the queue is the entry with the smallest distance. On ties,
+  // resolved leaves come first, so that they can be visited without expanding
+  // any more nodes.
+  auto greater = [](const QueueEntry& lhs, const QueueEntry& rhs) {
+    if (lhs.distance != rhs.distance) return lhs.distance > rhs.distance;
+    return lhs.type > rhs.type;
+  };
+  std::priority_queue<QueueEntry, std::vector<QueueEntry>, decltype(greater)>
+      queue(greater);
+
+  float root_distance = bounds_distance(branch_nodes_.front().bounds);
+  if (root_distance > max_distance) return;
+  queue.push({root_distance, EntryType::kBranch, 0});
+
+  while (!queue.empty()) {
+    QueueEntry entry = queue.top();
+    queue.pop();
+    // Every remaining entry is at least as far as this one, so if this one is
+    // out of range, then we're done.
+    if (entry.distance > max_distance) return;
+
+    switch (entry.type) {
+      case EntryType::kResolvedLeaf:
+        if (!visitor(elements_[entry.index], entry.distance)) return;
+        break;
+      case EntryType::kUnresolvedLeaf: {
+        // We defer computing the exact distance until the element reaches the
+        // front of the queue, since that's typically much more expensive than
+        // the bounds check, and most elements never get there.
+        float distance = element_distance(elements_[entry.index]);
+        if (distance <= max_distance) {
+          queue.push({distance, EntryType::kResolvedLeaf, entry.index});
+        }
+        break;
+      }
+      case EntryType::kBranch: {
+        const BranchNode& node = branch_nodes_[entry.index];
+        absl::Span<const uint32_t> child_indices = node.child_indices.Values();
+        for (uint32_t i = 0; i < child_indices.size(); ++i) {
+          uint32_t child_idx = child_indices[i];
+          float distance = bounds_distance(ChildBounds(entry.index, i));
+          if (distance <= max_distance) {
+            queue.push({distance,
+                        node.is_leaf_parent ? EntryType::kUnresolvedLeaf
+                                            : EntryType::kBranch,
+                        child_idx});
+          }
+        }
+        break;
+      }
+    }
+  }
+}
+
 template <typename T, uint32_t kBranchingFactor>
 bool StaticRTree<T, kBranchingFactor>::VisitIntersectedElementsInSubTree(
     uint32_t sub_tree_root_idx, const Rect& bounds,
     absl::FunctionRef<bool(const T&)> visitor) const {
   const BranchNode& node = branch_nodes_[sub_tree_root_idx];
+  bool hits[kBranchingFactor];
+  ComputeIntersectedChildren(sub_tree_root_idx, bounds, hits);
+  absl::Span<const uint32_t> child_indices = node.child_indices.Values();
   if (node.is_leaf_parent) {
-    for (uint32_t leaf_idx : node.child_indices.Values()) {
-      if (IntersectsInternal(bounds_func_(elements_[leaf_idx]), bounds) &&
-          !visitor(elements_[leaf_idx])) {
-        return false;
-      }
+    for (uint32_t i = 0; i < child_indices.size(); ++i) {
+      if (hits[i] && !visitor(elements_[child_indices[i]])) return false;
     }
   } else {
-    for (uint32_t branch_idx : node.child_indices.Values()) {
-      if (IntersectsInternal(branch_nodes_[branch_idx].bounds, bounds) &&
-          !VisitIntersectedElementsInSubTree(branch_idx, bounds, visitor)) {
+    for (uint32_t i = 0; i < child_indices.size(); ++i) {
+      if (hits[i] && !VisitIntersectedElementsInSubTree(child_indices[i],
+                                                        bounds, visitor)) {
         return false;
       }
     }
@@ -409,6 +1067,55 @@ bool StaticRTree<T, kBranchingFactor>::VisitIntersectedElementsInSubTree(
   return true;
 }
 
+template <typename T, uint32_t kBranchingFactor>
+bool StaticRTree<T, kBranchingFactor>::VisitIntersectedElementsBatchInSubTree(
+    uint32_t sub_tree_root_idx, uint32_t active_begin, uint32_t active_end,
+    BatchTraversal& traversal) const {
+  const BranchNode& node = branch_nodes_[sub_tree_root_idx];
+  absl::Span<const uint32_t> child_indices = node.child_indices.Values();
+  if (node.is_leaf_parent) {
+    for (uint32_t child = 0; child < child_indices.size(); ++child) {
+      const T& element = elements_[child_indices[child]];
+      Rect element_bounds = ChildBounds(sub_tree_root_idx, child);
+      for (uint32_t i = active_begin; i < active_end; ++i) {
+        uint32_t query_idx = traversal.active_queries[i];
+        if (traversal.finished[query_idx] ||
+            !IntersectsInternal(element_bounds,
+                                traversal.queries[query_idx])) {
+          continue;
+        }
+        if (!traversal.visitor(query_idx, element)) {
+          traversal.finished[query_idx] = true;
+          if (--traversal.n_unfinished == 0) return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  for (uint32_t branch_idx : child_indices) {
+    const Rect& branch_bounds = branch_nodes_[branch_idx].bounds;
+    // Note that we refer to the active queries by index rather than by
+    // iterator, since appending the child's queries may reallocate.
+    uint32_t child_begin = traversal.active_queries.size();
+    for (uint32_t i = active_begin; i < active_end; ++i) {
+      uint32_t query_idx = traversal.active_queries[i];
+      if (!traversal.finished[query_idx] &&
+          IntersectsInternal(branch_bounds, traversal.queries[query_idx])) {
+        traversal.active_queries.push_back(query_idx);
+      }
+    }
+    uint32_t child_end = traversal.active_queries.size();
+    bool should_continue =
+        child_begin == child_end ||
+        VisitIntersectedElementsBatchInSubTree(branch_idx, child_begin,
+                                               child_end, traversal);
+    traversal.active_queries.resize(child_begin);
+    if (!should_continue) return false;
+  }
+  return true;
+}
+
 }  // namespace ink::geometry_internal
 
 #endif  // INK_GEOMETRY_INTERNAL_STATIC_RTREE_H_
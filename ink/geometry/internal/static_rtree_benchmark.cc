@@ -12,13 +12,17 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <cstddef>
+#include <cstdint>
 #include <random>
 #include <vector>
 
 #include "absl/types/span.h"
 #include "benchmark/benchmark.h"
 #include "ink/geometry/internal/static_rtree.h"
+#include "ink/geometry/point.h"
 #include "ink/geometry/rect.h"
+#include "ink/geometry/vec.h"
 
 namespace ink::geometry_internal {
 namespace {
@@ -79,5 +83,83 @@ void BM_VisitAllIntersectingRects(benchmark::State& state) {
 }
 BENCHMARK(BM_VisitAllIntersectingRects)->Range(8, 16384);
 
+// Simulates hit-testing a large, dense tree (e.g. the triangles of a long
+// stroke) with many small queries; at this size the traversal cost is dominated
+// by testing the bounds of child nodes and elements.
+void BM_VisitSmallQueriesInLargeTree(benchmark::State& state) {
+  std::vector<Rect> rects = MakeVectorOfRandomRects(state.range(0));
+  StaticRTree<Rect> rtree(rects, rect_bounds);
+  std::mt19937_64 rng(1);
+  std::uniform_real_distribution<float> coord(-100, 100);
+  std::vector<Rect> queries(256);
+  for (Rect& query : queries) {
+    query = Rect::FromCenterAndDimensions({coord(rng), coord(rng)}, 1, 1);
+  }
+  int n_hits = 0;
+  for (auto s : state) {
+    for (const Rect& query : queries) {
+      rtree.VisitIntersectedElements(query, [&n_hits](const Rect&) {
+        ++n_hits;
+        return true;
+      });
+    }
+    benchmark::DoNotOptimize(n_hits);
+  }
+  state.SetItemsProcessed(state.iterations() * queries.size());
+}
+BENCHMARK(BM_VisitSmallQueriesInLargeTree)->Range(16384, 262144);
+
+// Returns a vector of `n_queries` small `Rect`s whose centers follow a
+// pseudo-random walk starting at the origin, approximating the samples of an
+// eraser gesture.
+std::vector<Rect> MakeEraserLikeQueries(int n_queries) {
+  std::mt19937_64 rng_(1);
+  std::uniform_real_distribution<float> step(-2, 2);
+  std::vector<Rect> queries(n_queries);
+  Point center = {0, 0};
+  for (size_t i = 0; i < queries.size(); ++i) {
+    center += Vec{step(rng_), step(rng_)};
+    queries[i] = Rect::FromCenterAndDimensions(center, 1, 1);
+  }
+  return queries;
+}
+
+constexpr int kEraserBenchmarkTreeSize = 16384;
+
+void BM_VisitIntersectingRectsOneQueryAtATime(benchmark::State& state) {
+  std::vector<Rect> rects = MakeVectorOfRandomRects(kEraserBenchmarkTreeSize);
+  StaticRTree<Rect> rtree(rects, rect_bounds);
+  std::vector<Rect> queries = MakeEraserLikeQueries(state.range(0));
+  int n_hits = 0;
+  for (auto s : state) {
+    for (const Rect& query : queries) {
+      rtree.VisitIntersectedElements(query, [&n_hits](const Rect&) {
+        ++n_hits;
+        return true;
+      });
+    }
+    benchmark::DoNotOptimize(n_hits);
+  }
+  state.SetItemsProcessed(state.iterations() * queries.size());
+}
+BENCHMARK(BM_VisitIntersectingRectsOneQueryAtATime)->Range(1, 1024);
+
+void BM_VisitIntersectingRectsBatch(benchmark::State& state) {
+  std::vector<Rect> rects = MakeVectorOfRandomRects(kEraserBenchmarkTreeSize);
+  StaticRTree<Rect> rtree(rects, rect_bounds);
+  std::vector<Rect> queries = MakeEraserLikeQueries(state.range(0));
+  int n_hits = 0;
+  for (auto s : state) {
+    rtree.VisitIntersectedElementsBatch(queries,
+                                        [&n_hits](uint32_t, const Rect&) {
+                                          ++n_hits;
+                                          return true;
+                                        });
+    benchmark::DoNotOptimize(n_hits);
+  }
+  state.SetItemsProcessed(state.iterations() * queries.size());
+}
+BENCHMARK(BM_VisitIntersectingRectsBatch)->Range(1, 1024);
+
 }  // namespace
 }  // namespace ink::geometry_internal
@@ -14,12 +14,22 @@
 
 #include "ink/geometry/internal/static_rtree.h"
 
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <thread>  // NOLINT(build/c++11)
 #include <vector>
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include "absl/algorithm/container.h"
+#include "absl/functional/function_ref.h"
 #include "absl/log/absl_check.h"
+#include "absl/status/status.h"
+#include "absl/status/status_matchers.h"
+#include "absl/status/statusor.h"
 #include "absl/types/span.h"
 #include "ink/geometry/distance.h"
 #include "ink/geometry/point.h"
@@ -30,10 +40,14 @@
 namespace ink::geometry_internal {
 namespace {
 
+using ::absl_testing::IsOk;
+using ::absl_testing::StatusIs;
 using ::testing::AllOf;
 using ::testing::Contains;
 using ::testing::ElementsAre;
 using ::testing::ElementsAreArray;
+using ::testing::FloatEq;
+using ::testing::HasSubstr;
 using ::testing::Field;
 using ::testing::IsEmpty;
 using ::testing::Matcher;
@@ -311,6 +325,46 @@ TEST(StaticRTreeTest, CreateWithNormalBranchingFactor) {
   }
 }
 
+TEST(StaticRTreeTest, ParallelConstructionMatchesSerialConstruction) {
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<float> coord(-1000, 1000);
+  std::vector<Point> points(100'000);
+  for (Point& p : points) p = {coord(rng), coord(rng)};
+
+  // Runs each task on its own thread, in reverse order of starting.
+  uint32_t n_parallel_for_calls = 0;
+  auto run_on_threads = [&n_parallel_for_calls](
+                            uint32_t n_tasks,
+                            absl::FunctionRef<void(uint32_t)> task) {
+    ++n_parallel_for_calls;
+    std::vector<std::thread> threads;
+    threads.reserve(n_tasks);
+    for (uint32_t i = n_tasks; i > 0; --i) {
+      threads.emplace_back([&task, i]() { task(i - 1); });
+    }
+    for (std::thread& t : threads) t.join();
+  };
+
+  StaticRTree<Point> serial_rtree(points, point_bounds);
+  StaticRTree<Point> parallel_rtree(points, point_bounds, run_on_threads);
+
+  EXPECT_GT(n_parallel_for_calls, 0);
+  EXPECT_THAT(parallel_rtree.Elements(),
+              ElementsAreArray(serial_rtree.Elements()));
+  absl::Span<const StaticRTree<Point>::BranchNode> serial_nodes =
+      serial_rtree.BranchNodes();
+  absl::Span<const StaticRTree<Point>::BranchNode> parallel_nodes =
+      parallel_rtree.BranchNodes();
+  ASSERT_EQ(parallel_nodes.size(), serial_nodes.size());
+  for (size_t i = 0; i < serial_nodes.size(); ++i) {
+    EXPECT_THAT(parallel_nodes[i].bounds, RectEq(serial_nodes[i].bounds));
+    EXPECT_EQ(parallel_nodes[i].is_leaf_parent,
+              serial_nodes[i].is_leaf_parent);
+    EXPECT_THAT(parallel_nodes[i].child_indices.Values(),
+                ElementsAreArray(serial_nodes[i].child_indices.Values()));
+  }
+}
+
 TEST(StaticRTree, VisitIntersectedElementsPointsWithRectQuery) {
   // There are 20 points, laid out on an integer grid like so:
   //
@@ -437,6 +491,337 @@ TEST(StaticRTree, VisitIntersectedElementsStopEarly) {
   EXPECT_THAT(visited, Not(Contains(Point{2, 0})));
 }
 
+TEST(StaticRTree, VisitIntersectedElementsBatchMatchesIndividualQueries) {
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<float> coord(-100, 100);
+  std::uniform_real_distribution<float> size(0, 20);
+  std::vector<Point> points(1000);
+  for (Point& p : points) p = {coord(rng), coord(rng)};
+  StaticRTree<Point> rtree(points, point_bounds);
+
+  std::vector<Rect> queries(50);
+  for (Rect& r : queries) {
+    r = Rect::FromCenterAndDimensions({coord(rng), coord(rng)}, size(rng),
+                                      size(rng));
+  }
+  // One of the queries misses the tree entirely.
+  queries[10] = Rect::FromTwoPoints({200, 200}, {210, 210});
+
+  std::vector<std::vector<Point>> batch_results(queries.size());
+  rtree.VisitIntersectedElementsBatch(
+      queries, [&batch_results](uint32_t query_index, const Point& p) {
+        batch_results[query_index].push_back(p);
+        return true;
+      });
+
+  for (uint32_t i = 0; i < queries.size(); ++i) {
+    std::vector<Point> expected;
+    rtree.VisitIntersectedElements(queries[i], [&expected](const Point& p) {
+      expected.push_back(p);
+      return true;
+    });
+    EXPECT_THAT(batch_results[i], UnorderedElementsAreArray(expected))
+        << "query index " << i;
+  }
+  EXPECT_THAT(batch_results[10], IsEmpty());
+}
+
+TEST(StaticRTree, VisitIntersectedElementsBatchStopEarlyForOneQuery) {
+  std::vector<Point> points{{0, 0}, {2, 0}, {1, 1}, {4, 1},
+                            {3, 2}, {1, 3}, {2, 4}};
+  PointRTree rtree(points, point_bounds);
+
+  // Both queries contain the same five points, but the visitor stops visiting
+  // the first query after two elements.
+  std::vector<Rect> queries{Rect::FromTwoPoints({1, 1}, {4, 4}),
+                            Rect::FromTwoPoints({1, 1}, {4, 4})};
+  std::vector<Point> visited[2];
+  rtree.VisitIntersectedElementsBatch(
+      queries, [&visited](uint32_t query_index, const Point& p) {
+        visited[query_index].push_back(p);
+        return query_index != 0 || visited[0].size() < 2;
+      });
+
+  EXPECT_EQ(visited[0].size(), 2);
+  EXPECT_THAT(visited[1],
+              UnorderedElementsAre(Point{1, 1}, Point{4, 1}, Point{3, 2},
+                                   Point{1, 3}, Point{2, 4}));
+}
+
+TEST(StaticRTree, VisitIntersectedElementsBatchStopEarlyForAllQueries) {
+  std::vector<Point> points(100);
+  for (size_t i = 0; i < points.size(); ++i) {
+    points[i] = {static_cast<float>(i % 10), static_cast<float>(i / 10)};
+  }
+  PointRTree rtree(points, point_bounds);
+
+  std::vector<Rect> queries{Rect::FromTwoPoints({0, 0}, {9, 9}),
+                            Rect::FromTwoPoints({2, 2}, {5, 5}),
+                            Rect::FromTwoPoints({7, 1}, {8, 8})};
+  int n_visits = 0;
+  rtree.VisitIntersectedElementsBatch(
+      queries, [&n_visits](uint32_t, const Point&) {
+        ++n_visits;
+        return false;
+      });
+
+  // Each query is visited exactly once before the traversal ends.
+  EXPECT_EQ(n_visits, 3);
+}
+
+TEST(StaticRTree, VisitIntersectedElementsBatchOnEmptyTreeAndEmptyBatch) {
+  bool visited = false;
+  auto visitor = [&visited](uint32_t, const Point&) {
+    visited = true;
+    return true;
+  };
+  std::vector<Rect> queries{Rect::FromTwoPoints({0, 0}, {1, 1})};
+
+  PointRTree().VisitIntersectedElementsBatch(queries, visitor);
+  PointRTree(std::vector<Point>{{0, 0}}, point_bounds)
+      .VisitIntersectedElementsBatch({}, visitor);
+
+  EXPECT_FALSE(visited);
+}
+
+TEST(StaticRTree, VisitNearestElementsVisitsInOrderOfDistance) {
+  std::vector<Point> points{{0, 0}, {2, 0}, {1, 1}, {4, 1},
+                            {3, 2}, {1, 3}, {2, 4}};
+  PointRTree rtree(points, point_bounds);
+
+  Point query{3.5, 1.9};
+  std::vector<Point> visited;
+  std::vector<float> distances;
+  rtree.VisitNearestElements(
+      [query](const Rect& r) { return Distance(query, r); },
+      [query](const Point& p) { return Distance(query, p); },
+      std::numeric_limits<float>::infinity(),
+      [&visited, &distances](const Point& p, float distance) {
+        visited.push_back(p);
+        distances.push_back(distance);
+        return true;
+      });
+
+  EXPECT_THAT(visited, ElementsAre(PointEq({3, 2}), PointEq({4, 1}),
+                                   PointEq({2, 0}), PointEq({2, 4}),
+                                   PointEq({1, 1}), PointEq({1, 3}),
+                                   PointEq({0, 0})));
+  EXPECT_THAT(distances,
+              ElementsAre(FloatEq(Distance(query, Point{3, 2})),
+                          FloatEq(Distance(query, Point{4, 1})),
+                          FloatEq(Distance(query, Point{2, 0})),
+                          FloatEq(Distance(query, Point{2, 4})),
+                          FloatEq(Distance(query, Point{1, 1})),
+                          FloatEq(Distance(query, Point{1, 3})),
+                          FloatEq(Distance(query, Point{0, 0}))));
+}
+
+TEST(StaticRTree, VisitNearestElementsRespectsMaxDistance) {
+  std::vector<Point> points{{0, 0}, {2, 0}, {1, 1}, {4, 1},
+                            {3, 2}, {1, 3}, {2, 4}};
+  PointRTree rtree(points, point_bounds);
+
+  Point query{1, 2};
+  std::vector<Point> visited;
+  rtree.VisitNearestElements(
+      [query](const Rect& r) { return Distance(query, r); },
+      [query](const Point& p) { return Distance(query, p); },
+      /* max_distance = */ 1.5, [&visited](const Point& p, float) {
+        visited.push_back(p);
+        return true;
+      });
+
+  EXPECT_THAT(visited,
+              UnorderedElementsAre(PointEq({1, 1}), PointEq({1, 3})));
+
+  // Nothing is within range of this query.
+  visited.clear();
+  rtree.VisitNearestElements(
+      [](const Rect& r) { return Distance(Point{10, 10}, r); },
+      [](const Point& p) { return Distance(Point{10, 10}, p); },
+      /* max_distance = */ 5, [&visited](const Point& p, float) {
+        visited.push_back(p);
+        return true;
+      });
+  EXPECT_THAT(visited, IsEmpty());
+}
+
+TEST(StaticRTree, VisitNearestElementsStopEarly) {
+  std::vector<Point> points{{0, 0}, {2, 0}, {1, 1}, {4, 1},
+                            {3, 2}, {1, 3}, {2, 4}};
+  PointRTree rtree(points, point_bounds);
+
+  Point query{0, 4};
+  std::vector<Point> visited;
+  rtree.VisitNearestElements(
+      [query](const Rect& r) { return Distance(query, r); },
+      [query](const Point& p) { return Distance(query, p); },
+      std::numeric_limits<float>::infinity(),
+      [&visited](const Point& p, float) {
+        visited.push_back(p);
+        return visited.size() < 2;
+      });
+
+  EXPECT_THAT(visited, ElementsAre(PointEq({1, 3}), PointEq({2, 4})));
+}
+
+TEST(StaticRTree, VisitNearestElementsMatchesBruteForce) {
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<float> coord(-100, 100);
+  std::vector<Point> points(1000);
+  for (Point& p : points) p = {coord(rng), coord(rng)};
+  StaticRTree<Point> rtree(points, point_bounds);
+
+  for (int i = 0; i < 20; ++i) {
+    Point query{coord(rng), coord(rng)};
+    std::vector<float> expected_distances;
+    expected_distances.reserve(points.size());
+    for (Point p : points) expected_distances.push_back(Distance(query, p));
+    absl::c_sort(expected_distances);
+    expected_distances.resize(10);
+
+    std::vector<float> distances;
+    rtree.VisitNearestElements(
+        [query](const Rect& r) { return Distance(query, r); },
+        [query](const Point& p) { return Distance(query, p); },
+        std::numeric_limits<float>::infinity(),
+        [&distances](const Point&, float distance) {
+          distances.push_back(distance);
+          return distances.size() < 10;
+        });
+    EXPECT_THAT(distances, ElementsAreArray(expected_distances));
+  }
+}
+
+TEST(StaticRTree, VisitNearestElementsOnEmptyTree) {
+  PointRTree rtree;
+  bool visited = false;
+  rtree.VisitNearestElements(
+      [](const Rect&) { return 0.f; }, [](const Point&) { return 0.f; },
+      std::numeric_limits<float>::infinity(),
+      [&visited](const Point&, float) {
+        visited = true;
+        return true;
+      });
+  EXPECT_FALSE(visited);
+}
+
+// Returns an OK status if `bounds` are the bounds of `p`.
+absl::Status ValidatePointBounds(const Point& p, const Rect& bounds) {
+  if (bounds.XMin() != p.x || bounds.XMax() != p.x || bounds.YMin() != p.y ||
+      bounds.YMax() != p.y) {
+    return absl::InvalidArgumentError("Bounds don't match point");
+  }
+  return absl::OkStatus();
+}
+
+TEST(StaticRTree, SerializeRoundTrip) {
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<float> coord(-100, 100);
+  std::vector<Point> points(1000);
+  for (Point& p : points) p = {coord(rng), coord(rng)};
+  StaticRTree<Point> rtree(points, point_bounds);
+
+  absl::StatusOr<StaticRTree<Point>> deserialized =
+      StaticRTree<Point>::FromSerialized(rtree.Serialize(),
+                                         ValidatePointBounds);
+  ASSERT_THAT(deserialized, IsOk());
+
+  EXPECT_THAT(deserialized->Elements(), ElementsAreArray(rtree.Elements()));
+  ASSERT_EQ(deserialized->BranchNodes().size(), rtree.BranchNodes().size());
+  for (size_t i = 0; i < rtree.BranchNodes().size(); ++i) {
+    const StaticRTree<Point>::BranchNode& expected = rtree.BranchNodes()[i];
+    const StaticRTree<Point>::BranchNode& actual =
+        deserialized->BranchNodes()[i];
+    EXPECT_THAT(actual.bounds, RectEq(expected.bounds));
+    EXPECT_EQ(actual.is_leaf_parent, expected.is_leaf_parent);
+    EXPECT_THAT(actual.child_indices.Values(),
+                ElementsAreArray(expected.child_indices.Values()));
+  }
+  std::vector<Point> expected_points;
+  rtree.VisitIntersectedElements(Rect::FromTwoPoints({-20, -30}, {10, 15}),
+                                 [&expected_points](const Point& p) {
+                                   expected_points.push_back(p);
+                                   return true;
+                                 });
+  std::vector<Point> actual_points;
+  deserialized->VisitIntersectedElements(
+      Rect::FromTwoPoints({-20, -30}, {10, 15}),
+      [&actual_points](const Point& p) {
+        actual_points.push_back(p);
+        return true;
+      });
+  EXPECT_THAT(actual_points, UnorderedElementsAreArray(expected_points));
+}
+
+TEST(StaticRTree, SerializeRoundTripEmptyTree) {
+  PointRTree rtree;
+
+  absl::StatusOr<PointRTree> deserialized =
+      PointRTree::FromSerialized(rtree.Serialize(), ValidatePointBounds);
+  ASSERT_THAT(deserialized, IsOk());
+
+  EXPECT_THAT(deserialized->BranchNodes(), IsEmpty());
+  EXPECT_THAT(deserialized->Elements(), IsEmpty());
+}
+
+TEST(StaticRTree, FromSerializedRejectsMalformedBuffers) {
+  std::vector<Point> points;
+  for (int i = 0; i < 20; ++i) points.push_back({1.f * i, 2.f * i});
+  PointRTree rtree(points, point_bounds);
+  std::vector<std::byte> serialized = rtree.Serialize();
+  ASSERT_THAT(PointRTree::FromSerialized(serialized, ValidatePointBounds),
+              IsOk());
+
+  // The root's record starts right after the header; its child indices come
+  // after its child count, leaf flag and bounds.
+  size_t root_child_indices_offset = sizeof(RTreeSerializedHeader) +
+                                     2 * sizeof(uint32_t) + 4 * sizeof(float);
+  auto with_root_child_index = [&](uint32_t i, uint32_t value) {
+    std::vector<std::byte> modified = serialized;
+    std::memcpy(&modified[root_child_indices_offset + i * sizeof(uint32_t)],
+                &value, sizeof(value));
+    return modified;
+  };
+
+  EXPECT_THAT(PointRTree::FromSerialized({}, ValidatePointBounds),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("too small")));
+  EXPECT_THAT(
+      PointRTree::FromSerialized(
+          absl::MakeSpan(serialized).subspan(0, serialized.size() - 1),
+          ValidatePointBounds),
+      StatusIs(absl::StatusCode::kInvalidArgument, HasSubstr("should be")));
+  {
+    std::vector<std::byte> modified = serialized;
+    modified[0] = std::byte(0);
+    EXPECT_THAT(PointRTree::FromSerialized(modified, ValidatePointBounds),
+                StatusIs(absl::StatusCode::kInvalidArgument,
+                         HasSubstr("not a serialized StaticRTree")));
+  }
+  EXPECT_THAT(
+      StaticRTree<Point>::FromSerialized(serialized, ValidatePointBounds),
+      StatusIs(absl::StatusCode::kInvalidArgument,
+               HasSubstr("branching factor")));
+  EXPECT_THAT(PointRTree::FromSerialized(with_root_child_index(0, 0),
+                                         ValidatePointBounds),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("out-of-range child index")));
+  EXPECT_THAT(
+      PointRTree::FromSerialized(
+          with_root_child_index(1, rtree.BranchNodes()[0].child_indices[0]),
+          ValidatePointBounds),
+      StatusIs(absl::StatusCode::kInvalidArgument,
+               HasSubstr("more than one")));
+  EXPECT_THAT(PointRTree::FromSerialized(
+                  serialized,
+                  [](const Point&, const Rect&) {
+                    return absl::InvalidArgumentError("rejected element");
+                  }),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("rejected element")));
+}
+
 TEST(StaticRTreeDeathTest, CannotConstructWithNullBoundsFunction) {
   EXPECT_DEATH_IF_SUPPORTED(PointRTree({{0, 0}, {1, 1}}, nullptr),
                             "must be non-null");
@@ -0,0 +1,213 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ink/geometry/internal/vertex_cache_optimization.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "absl/algorithm/container.h"
+#include "absl/log/absl_check.h"
+#include "absl/types/span.h"
+
+namespace ink::mesh_internal {
+namespace {
+
+// The size of the simulated cache, and the scoring parameters, as suggested in
+// Forsyth's article. The simulated cache doesn't need to match the actual GPU
+// cache; the algorithm is not very sensitive to it.
+constexpr int kCacheSize = 32;
+constexpr float kCacheDecayPower = 1.5f;
+constexpr float kLastTriangleScore = 0.75f;
+constexpr float kValenceBoostScale = 2.0f;
+constexpr float kValenceBoostPower = 0.5f;
+
+// Vertices with more remaining triangles than this all get the same valence
+// score, which is small by then anyway.
+constexpr uint32_t kMaxScoredValence = 32;
+
+// Precomputed scores for each cache position and each remaining valence.
+struct ScoreTables {
+  std::array<float, kCacheSize> cache_position;
+  std::array<float, kMaxScoredValence + 1> valence;
+};
+
+const ScoreTables& GetScoreTables() {
+  static const ScoreTables* tables = []() {
+    auto* tables = new ScoreTables;
+    for (int i = 0; i < kCacheSize; ++i) {
+      if (i < 3) {
+        // The vertices of the last triangle get a fixed score, so that the
+        // algorithm doesn't favor strips over fans.
+        tables->cache_position[i] = kLastTriangleScore;
+      } else {
+        tables->cache_position[i] =
+            std::pow(1.f - static_cast<float>(i - 3) / (kCacheSize - 3),
+                     kCacheDecayPower);
+      }
+    }
+    tables->valence[0] = 0;
+    for (uint32_t i = 1; i <= kMaxScoredValence; ++i) {
+      tables->valence[i] =
+          kValenceBoostScale *
+          std::pow(static_cast<float>(i), -kValenceBoostPower);
+    }
+    return tables;
+  }();
+  return *tables;
+}
+
+// Returns the score of a vertex at `cache_position` (or -1 if it is not in the
+// cache) that is still used by `remaining_valence` unvisited triangles.
+float VertexScore(const ScoreTables& tables, int cache_position,
+                  uint32_t remaining_valence) {
+  // A vertex with no remaining triangles will never be looked at again.
+  if (remaining_valence == 0) return -1;
+  float score = cache_position < 0 ? 0 : tables.cache_position[cache_position];
+  return score +
+         tables.valence[std::min(remaining_valence, kMaxScoredValence)];
+}
+
+}  // namespace
+
+std::vector<uint32_t> OptimizeTriangleOrderForVertexCache(
+    absl::Span<const std::array<uint32_t, 3>> triangles,
+    uint32_t vertex_count) {
+  const ScoreTables& tables = GetScoreTables();
+  uint32_t n_triangles = triangles.size();
+
+  // Build the vertex-to-triangle adjacency lists, stored contiguously. The
+  // first `remaining_valence[v]` entries of vertex `v`'s list are the triangles
+  // that have not been emitted yet.
+  std::vector<uint32_t> adjacency_offsets(vertex_count + 1, 0);
+  for (const std::array<uint32_t, 3>& triangle : triangles) {
+    for (uint32_t v : triangle) {
+      ABSL_DCHECK_LT(v, vertex_count);
+      ++adjacency_offsets[v + 1];
+    }
+  }
+  for (uint32_t v = 0; v < vertex_count; ++v) {
+    adjacency_offsets[v + 1] += adjacency_offsets[v];
+  }
+  std::vector<uint32_t> remaining_valence(vertex_count, 0);
+  std::vector<uint32_t> adjacency(adjacency_offsets.back());
+  for (uint32_t t = 0; t < n_triangles; ++t) {
+    for (uint32_t v : triangles[t]) {
+      adjacency[adjacency_offsets[v] + remaining_valence[v]++] = t;
+    }
+  }
+
+  std::vector<int> cache_position(vertex_count, -1);
+  std::vector<float> vertex_score(vertex_count);
+  for (uint32_t v = 0; v < vertex_count; ++v) {
+    vertex_score[v] = VertexScore(tables, -1, remaining_valence[v]);
+  }
+  std::vector<bool> emitted(n_triangles, false);
+
+  // The simulated LRU cache, which may temporarily hold up to three extra
+  // vertices while it's being updated.
+  std::vector<uint32_t> cache;
+  cache.reserve(kCacheSize + 3);
+  std::vector<uint32_t> new_cache;
+  new_cache.reserve(kCacheSize + 3);
+
+  std::vector<uint32_t> order;
+  order.reserve(n_triangles);
+  // When no triangle in the cache has any unvisited neighbors, we continue
+  // from the first unvisited triangle in the original order. This keeps the
+  // algorithm linear, and for stroke meshes, which are generated by walking
+  // along the stroke, it is usually a triangle close to the last one anyway.
+  uint32_t next_unvisited = 0;
+  int64_t best_triangle = -1;
+  while (order.size() < n_triangles) {
+    if (best_triangle < 0) {
+      while (emitted[next_unvisited]) ++next_unvisited;
+      best_triangle = next_unvisited;
+    }
+    uint32_t t = best_triangle;
+    emitted[t] = true;
+    order.push_back(t);
+
+    // Remove the triangle from the unvisited lists of its vertices, and move
+    // them to the front of the cache.
+    new_cache.clear();
+    for (uint32_t v : triangles[t]) {
+      uint32_t* first = &adjacency[adjacency_offsets[v]];
+      uint32_t* last = first + remaining_valence[v];
+      std::iter_swap(std::find(first, last, t), last - 1);
+      --remaining_valence[v];
+      if (!absl::c_linear_search(new_cache, v)) new_cache.push_back(v);
+    }
+    for (uint32_t v : cache) {
+      if (!absl::c_linear_search(triangles[t], v)) new_cache.push_back(v);
+    }
+    std::swap(cache, new_cache);
+
+    // Update the scores of the vertices in the cache, including any that just
+    // got pushed out of it, and pick the best triangle that uses one of them.
+    float best_score = -1;
+    best_triangle = -1;
+    for (uint32_t i = 0; i < cache.size(); ++i) {
+      uint32_t v = cache[i];
+      cache_position[v] = i < kCacheSize ? static_cast<int>(i) : -1;
+      vertex_score[v] = VertexScore(tables, cache_position[v],
+                                    remaining_valence[v]);
+    }
+    for (uint32_t i = 0; i < cache.size() && i < kCacheSize; ++i) {
+      uint32_t v = cache[i];
+      for (uint32_t j = 0; j < remaining_valence[v]; ++j) {
+        uint32_t candidate = adjacency[adjacency_offsets[v] + j];
+        const std::array<uint32_t, 3>& triangle = triangles[candidate];
+        float score = vertex_score[triangle[0]] + vertex_score[triangle[1]] +
+                      vertex_score[triangle[2]];
+        if (score > best_score) {
+          best_score = score;
+          best_triangle = candidate;
+        }
+      }
+    }
+    if (cache.size() > kCacheSize) cache.resize(kCacheSize);
+  }
+  return order;
+}
+
+float AverageCacheMissRatio(absl::Span<const std::array<uint32_t, 3>> triangles,
+                            uint32_t cache_size) {
+  if (triangles.empty()) return 0;
+  // The cache is a ring buffer, in which `next_slot` is the slot that will be
+  // overwritten by the next miss.
+  std::vector<uint32_t> cache;
+  cache.reserve(cache_size);
+  uint32_t next_slot = 0;
+  uint32_t misses = 0;
+  for (const std::array<uint32_t, 3>& triangle : triangles) {
+    for (uint32_t v : triangle) {
+      if (absl::c_linear_search(cache, v)) continue;
+      ++misses;
+      if (cache_size == 0) continue;
+      if (cache.size() < cache_size) {
+        cache.push_back(v);
+      } else {
+        cache[next_slot] = v;
+        next_slot = (next_slot + 1) % cache_size;
+      }
+    }
+  }
+  return static_cast<float>(misses) / triangles.size();
+}
+
+}  // namespace ink::mesh_internal
@@ -0,0 +1,52 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef INK_GEOMETRY_INTERNAL_VERTEX_CACHE_OPTIMIZATION_H_
+#define INK_GEOMETRY_INTERNAL_VERTEX_CACHE_OPTIMIZATION_H_
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "absl/types/span.h"
+
+namespace ink::mesh_internal {
+
+// Returns a permutation of the indices of `triangles`, such that drawing the
+// triangles in that order makes good use of a GPU's post-transform vertex
+// cache. The i-th element of the result is the index in `triangles` of the
+// triangle that should be placed at position i.
+//
+// This uses Tom Forsyth's "Linear-Speed Vertex Cache Optimisation" algorithm,
+// which greedily picks the next triangle based on how recently its vertices
+// were used and how many unvisited triangles still refer to them. Because
+// neighboring triangles are emitted together, the result also has good spatial
+// locality, so vertices that are renumbered in order of first use (as
+// `PartitionTriangles` does) end up close together in memory.
+//
+// Each element of `triangles` must be less than `vertex_count`; this
+// DCHECK-fails otherwise.
+std::vector<uint32_t> OptimizeTriangleOrderForVertexCache(
+    absl::Span<const std::array<uint32_t, 3>> triangles, uint32_t vertex_count);
+
+// Returns the average number of vertex cache misses per triangle (a.k.a. the
+// ACMR) incurred when drawing `triangles` in order with a FIFO vertex cache
+// that holds `cache_size` vertices. The result is at most 3, and approaches 0.5
+// for large, regular meshes in a good order. Returns 0 if `triangles` is empty.
+float AverageCacheMissRatio(absl::Span<const std::array<uint32_t, 3>> triangles,
+                            uint32_t cache_size);
+
+}  // namespace ink::mesh_internal
+
+#endif  // INK_GEOMETRY_INTERNAL_VERTEX_CACHE_OPTIMIZATION_H_
@@ -0,0 +1,129 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ink/geometry/internal/vertex_cache_optimization.h"
+
+#include <array>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace ink::mesh_internal {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::FloatEq;
+using ::testing::IsEmpty;
+using ::testing::UnorderedElementsAreArray;
+
+// Returns the triangles of a grid of `n_rows` x `n_columns` quads, each split
+// into two triangles, in row-major order. The vertex index of the corner at
+// row `r` and column `c` is `r * (n_columns + 1) + c`.
+std::vector<std::array<uint32_t, 3>> MakeGridTriangles(uint32_t n_rows,
+                                                       uint32_t n_columns) {
+  std::vector<std::array<uint32_t, 3>> triangles;
+  for (uint32_t row = 0; row < n_rows; ++row) {
+    for (uint32_t column = 0; column < n_columns; ++column) {
+      uint32_t v00 = row * (n_columns + 1) + column;
+      uint32_t v10 = v00 + 1;
+      uint32_t v01 = v00 + n_columns + 1;
+      uint32_t v11 = v01 + 1;
+      triangles.push_back({v00, v10, v11});
+      triangles.push_back({v00, v11, v01});
+    }
+  }
+  return triangles;
+}
+
+std::vector<std::array<uint32_t, 3>> Reorder(
+    const std::vector<std::array<uint32_t, 3>>& triangles,
+    const std::vector<uint32_t>& order) {
+  std::vector<std::array<uint32_t, 3>> result;
+  result.reserve(order.size());
+  for (uint32_t i : order) result.push_back(triangles[i]);
+  return result;
+}
+
+TEST(VertexCacheOptimizationTest, OptimizeEmptyTriangles) {
+  EXPECT_THAT(OptimizeTriangleOrderForVertexCache({}, 0), IsEmpty());
+  EXPECT_THAT(OptimizeTriangleOrderForVertexCache({}, 5), IsEmpty());
+}
+
+TEST(VertexCacheOptimizationTest, OptimizeSingleTriangle) {
+  EXPECT_THAT(OptimizeTriangleOrderForVertexCache({{{2, 0, 1}}}, 3),
+              ElementsAre(0));
+}
+
+TEST(VertexCacheOptimizationTest, OptimizeReturnsPermutation) {
+  std::vector<std::array<uint32_t, 3>> triangles = MakeGridTriangles(20, 30);
+  std::vector<uint32_t> all_indices(triangles.size());
+  std::iota(all_indices.begin(), all_indices.end(), 0);
+
+  EXPECT_THAT(OptimizeTriangleOrderForVertexCache(triangles, 21 * 31),
+              UnorderedElementsAreArray(all_indices));
+}
+
+TEST(VertexCacheOptimizationTest, OptimizeHandlesDisconnectedAndDegenerate) {
+  std::vector<std::array<uint32_t, 3>> triangles = {
+      {0, 1, 2}, {7, 8, 9}, {3, 3, 4}, {1, 2, 3}, {5, 5, 5}, {8, 9, 6}};
+  std::vector<uint32_t> all_indices(triangles.size());
+  std::iota(all_indices.begin(), all_indices.end(), 0);
+
+  // Vertex 10 is not used by any triangle.
+  EXPECT_THAT(OptimizeTriangleOrderForVertexCache(triangles, 11),
+              UnorderedElementsAreArray(all_indices));
+}
+
+TEST(VertexCacheOptimizationTest, OptimizeImprovesCacheMissRatioOfWideGrid) {
+  // In row-major order, the rows of this grid are too long for the vertices of
+  // one row to still be in the cache when the next row reuses them.
+  std::vector<std::array<uint32_t, 3>> triangles = MakeGridTriangles(40, 100);
+  std::vector<uint32_t> order =
+      OptimizeTriangleOrderForVertexCache(triangles, 41 * 101);
+
+  float original_acmr = AverageCacheMissRatio(triangles, 32);
+  float optimized_acmr = AverageCacheMissRatio(Reorder(triangles, order), 32);
+  EXPECT_GT(original_acmr, 0.95f);
+  EXPECT_LT(optimized_acmr, 0.8f);
+}
+
+TEST(VertexCacheOptimizationTest, CacheMissRatioOfEmptyTriangles) {
+  EXPECT_EQ(AverageCacheMissRatio({}, 16), 0);
+}
+
+TEST(VertexCacheOptimizationTest, CacheMissRatioOfSeparateTriangles) {
+  EXPECT_THAT(AverageCacheMissRatio({{{0, 1, 2}}}, 16), FloatEq(3));
+  EXPECT_THAT(AverageCacheMissRatio({{{0, 1, 2}, {3, 4, 5}}}, 16), FloatEq(3));
+}
+
+TEST(VertexCacheOptimizationTest, CacheMissRatioOfSharedVertices) {
+  // The second triangle only misses vertex 3, and the third one hits entirely.
+  EXPECT_THAT(
+      AverageCacheMissRatio({{{0, 1, 2}, {2, 1, 3}, {1, 2, 3}}}, 16),
+      FloatEq(4.f / 3));
+}
+
+TEST(VertexCacheOptimizationTest, CacheMissRatioEvictsInFifoOrder) {
+  // With room for only three vertices, vertex 0 is evicted by vertex 3, so the
+  // last triangle misses vertex 0, which then evicts vertex 1.
+  EXPECT_THAT(AverageCacheMissRatio({{{0, 1, 2}, {1, 2, 3}, {0, 2, 3}}}, 3),
+              FloatEq(5.f / 3));
+  EXPECT_THAT(AverageCacheMissRatio({{{0, 1, 2}, {0, 1, 2}}}, 0), FloatEq(3));
+}
+
+}  // namespace
+}  // namespace ink::mesh_internal
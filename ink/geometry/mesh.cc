@@ -14,10 +14,12 @@
 
 #include "ink/geometry/mesh.h"
 
+#include <algorithm>
 #include <array>
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
+#include <memory>
 #include <optional>
 #include <utility>
 #include <vector>
@@ -30,6 +32,7 @@
 #include "ink/geometry/internal/mesh_packing.h"
 #include "ink/geometry/mesh_format.h"
 #include "ink/geometry/mesh_packing_types.h"
+#include "ink/geometry/point.h"
 #include "ink/geometry/triangle.h"
 #include "ink/types/internal/float.h"
 #include "ink/types/small_array.h"
@@ -101,13 +104,14 @@ absl::StatusOr<Mesh> Mesh::Create(
   // The check above should ensure that `vertex_attributes` is not empty.
   ABSL_DCHECK_GT(vertex_attributes.size(), 0);
 
-  constexpr int kMaxVertices = 1 << (8 * kBytesPerIndex);
+  uint32_t max_vertices =
+      MeshFormat::MaxPackedVertexCount(format.GetIndexFormat());
   size_t n_vertices = vertex_attributes[0].size();
-  if (n_vertices > kMaxVertices) {
+  if (n_vertices > max_vertices) {
     return absl::InvalidArgumentError(
         absl::Substitute("Given more vertices than can be represented by the "
                          "index; vertices = $0, max = $1",
-                         n_vertices, kMaxVertices));
+                         n_vertices, max_vertices));
   }
   for (size_t i = 1; i < vertex_attributes.size(); ++i) {
     if (vertex_attributes[i].size() != n_vertices) {
@@ -152,12 +156,13 @@ absl::StatusOr<Mesh> Mesh::Create(
   std::vector<std::byte> vertex_data =
       PackVertexByteData(format, vertex_attributes, coding_params_array);
 
+  uint8_t index_stride = format.PackedIndexStride();
   std::vector<std::byte> index_data;
-  index_data.resize(kBytesPerIndex * triangle_indices.size());
+  index_data.resize(index_stride * triangle_indices.size());
   size_t n_triangles = triangle_indices.size() / 3;
   for (size_t i = 0; i < n_triangles; ++i) {
     mesh_internal::WriteTriangleIndicesToByteArray(
-        i, kBytesPerIndex, triangle_indices.subspan(3 * i, 3), index_data);
+        i, index_stride, triangle_indices.subspan(3 * i, 3), index_data);
   }
 
   return Mesh(format, std::move(coding_params_array),
@@ -165,6 +170,145 @@ absl::StatusOr<Mesh> Mesh::Create(
               std::move(index_data));
 }
 
+absl::StatusOr<Mesh> Mesh::CreateFromPackedData(
+    const MeshFormat& format,
+    absl::Span<const MeshAttributeCodingParams> unpacking_params,
+    absl::Span<const MeshAttributeBounds> attribute_bounds,
+    absl::Span<const std::byte> vertex_data,
+    absl::Span<const std::byte> index_data,
+    std::shared_ptr<const void> storage) {
+  absl::Span<const MeshFormat::Attribute> attributes = format.Attributes();
+  if (unpacking_params.size() != attributes.size()) {
+    return absl::InvalidArgumentError(
+        absl::Substitute("Wrong number of unpacking params for format; "
+                         "attributes = $0, unpacking params = $1",
+                         attributes.size(), unpacking_params.size()));
+  }
+  for (size_t i = 0; i < attributes.size(); ++i) {
+    if (unpacking_params[i].components.Size() !=
+            MeshFormat::ComponentCount(attributes[i].type) ||
+        !mesh_internal::IsValidCodingParams(attributes[i].type,
+                                            unpacking_params[i])) {
+      return absl::InvalidArgumentError(absl::Substitute(
+          "Unpacking params at index $0 is not valid for format", i));
+    }
+  }
+
+  if (vertex_data.size() % format.PackedVertexStride() != 0) {
+    return absl::InvalidArgumentError(absl::Substitute(
+        "Vertex data size ($0) is not a multiple of the vertex stride ($1)",
+        vertex_data.size(), format.PackedVertexStride()));
+  }
+  uint32_t max_vertices =
+      MeshFormat::MaxPackedVertexCount(format.GetIndexFormat());
+  size_t n_vertices = vertex_data.size() / format.PackedVertexStride();
+  if (n_vertices > max_vertices) {
+    return absl::InvalidArgumentError(
+        absl::Substitute("Given more vertices than can be represented by the "
+                         "index; vertices = $0, max = $1",
+                         n_vertices, max_vertices));
+  }
+
+  if (attribute_bounds.empty() != (n_vertices == 0)) {
+    return absl::InvalidArgumentError(absl::Substitute(
+        "Attribute bounds must be given iff there are vertices; vertices = "
+        "$0, attribute bounds = $1",
+        n_vertices, attribute_bounds.size()));
+  }
+  std::optional<mesh_internal::AttributeBoundsArray> bounds_array;
+  if (!attribute_bounds.empty()) {
+    if (attribute_bounds.size() != attributes.size()) {
+      return absl::InvalidArgumentError(
+          absl::Substitute("Wrong number of attribute bounds for format; "
+                           "attributes = $0, attribute bounds = $1",
+                           attributes.size(), attribute_bounds.size()));
+    }
+    bounds_array.emplace(attributes.size());
+    for (size_t i = 0; i < attributes.size(); ++i) {
+      const MeshAttributeBounds& b = attribute_bounds[i];
+      uint8_t n_components = MeshFormat::ComponentCount(attributes[i].type);
+      bool is_valid = b.minimum.Size() == n_components &&
+                      b.maximum.Size() == n_components;
+      for (uint8_t c = 0; is_valid && c < n_components; ++c) {
+        is_valid = ink_internal::IsFinite(b.minimum[c]) &&
+                   ink_internal::IsFinite(b.maximum[c]) &&
+                   b.minimum[c] <= b.maximum[c];
+      }
+      if (!is_valid) {
+        return absl::InvalidArgumentError(absl::Substitute(
+            "Attribute bounds at index $0 is not valid for format", i));
+      }
+      (*bounds_array)[i] = b;
+    }
+  }
+
+  for (size_t vertex_idx = 0; vertex_idx < n_vertices; ++vertex_idx) {
+    for (size_t attr_idx = 0; attr_idx < attributes.size(); ++attr_idx) {
+      const MeshFormat::Attribute& attr = attributes[attr_idx];
+      if (!mesh_internal::IsValidPackedAttributeValue(
+              attr.type,
+              vertex_data.subspan(
+                  vertex_idx * format.PackedVertexStride() + attr.packed_offset,
+                  attr.packed_width))) {
+        return absl::InvalidArgumentError(absl::Substitute(
+            "Invalid packed value for attribute $0 of vertex $1", attr_idx,
+            vertex_idx));
+      }
+    }
+  }
+
+  uint8_t index_stride = format.PackedIndexStride();
+  if (index_data.size() % (3 * index_stride) != 0) {
+    return absl::InvalidArgumentError(absl::Substitute(
+        "Index data size ($0) is not a multiple of the triangle size ($1)",
+        index_data.size(), 3 * index_stride));
+  }
+  size_t n_triangles = index_data.size() / (3 * index_stride);
+  for (size_t i = 0; i < n_triangles; ++i) {
+    std::array<uint32_t, 3> triangle =
+        mesh_internal::ReadTriangleIndicesFromByteArray(i, index_stride,
+                                                        index_data);
+    if (!absl::c_all_of(triangle,
+                        [n_vertices](uint32_t v) { return v < n_vertices; })) {
+      return absl::InvalidArgumentError(
+          absl::Substitute("Found a triangle index that references a "
+                           "non-existent vertex; vertices = $0",
+                           n_vertices));
+    }
+  }
+
+  mesh_internal::CodingParamsArray params_array(attributes.size());
+  for (size_t i = 0; i < attributes.size(); ++i) {
+    params_array[i] = unpacking_params[i];
+  }
+  if (storage == nullptr) {
+    return Mesh(format, std::move(params_array), std::move(bounds_array),
+                std::vector<std::byte>(vertex_data.begin(), vertex_data.end()),
+                std::vector<std::byte>(index_data.begin(), index_data.end()));
+  }
+  return Mesh(format, std::move(params_array), std::move(bounds_array),
+              vertex_data, index_data, std::move(storage));
+}
+
+Mesh::Mesh(const MeshFormat& format,
+           mesh_internal::CodingParamsArray unpacking_transforms,
+           std::optional<mesh_internal::AttributeBoundsArray> attribute_bounds,
+           absl::Span<const std::byte> vertex_data,
+           absl::Span<const std::byte> index_data,
+           absl::Nonnull<std::shared_ptr<const void>> storage)
+    : data_(std::make_shared<const Data>(Data{
+          .format = format,
+          .unpacking_params = std::move(unpacking_transforms),
+          .attribute_bounds = std::move(attribute_bounds),
+          .vertex_data = vertex_data,
+          .index_data = index_data,
+          .external_storage = std::move(storage),
+          .vertex_count = static_cast<uint32_t>(vertex_data.size() /
+                                                format.PackedVertexStride()),
+          .triangle_count = static_cast<uint32_t>(
+              index_data.size() / (3 * format.PackedIndexStride())),
+      })) {}
+
 SmallArray<float, 4> Mesh::FloatVertexAttribute(
     uint32_t vertex_index, uint32_t attribute_index) const {
   ABSL_DCHECK_LT(attribute_index, Format().Attributes().size());
@@ -185,6 +329,42 @@ SmallArray<uint32_t, 4> Mesh::PackedIntegersForFloatVertexAttribute(
       Format().Attributes()[attribute_index].type, packed_value);
 }
 
+void Mesh::DecodePositions(absl::Span<Point> positions) const {
+  ABSL_CHECK_EQ(positions.size(), VertexCount());
+  uint32_t attribute_index = VertexPositionAttributeIndex();
+  const MeshFormat::Attribute attr = Format().Attributes()[attribute_index];
+  ABSL_DCHECK_EQ(MeshFormat::ComponentCount(attr.type), 2);
+  // The positions are unpacked into a buffer of floats a block of vertices at
+  // a time, and then copied into `positions`.
+  constexpr uint32_t kVerticesPerBlock = 256;
+  std::array<float, 2 * kVerticesPerBlock> unpacked;
+  for (uint32_t block_start = 0; block_start < VertexCount();
+       block_start += kVerticesPerBlock) {
+    uint32_t n_vertices =
+        std::min(kVerticesPerBlock, VertexCount() - block_start);
+    mesh_internal::UnpackAttributeOfAllVertices(
+        attr.type, data_->unpacking_params[attribute_index],
+        data_->vertex_data.subspan(block_start * VertexStride(),
+                                   n_vertices * VertexStride()),
+        VertexStride(), attr.packed_offset,
+        absl::MakeSpan(unpacked.data(), 2 * n_vertices));
+    for (uint32_t i = 0; i < n_vertices; ++i) {
+      positions[block_start + i] = {unpacked[2 * i], unpacked[2 * i + 1]};
+    }
+  }
+}
+
+void Mesh::DecodeAttribute(uint32_t attribute_index,
+                           absl::Span<float> values) const {
+  ABSL_CHECK_LT(attribute_index, Format().Attributes().size());
+  const MeshFormat::Attribute attr = Format().Attributes()[attribute_index];
+  ABSL_CHECK_EQ(values.size(),
+                size_t{MeshFormat::ComponentCount(attr.type)} * VertexCount());
+  mesh_internal::UnpackAttributeOfAllVertices(
+      attr.type, data_->unpacking_params[attribute_index], data_->vertex_data,
+      VertexStride(), attr.packed_offset, values);
+}
+
 absl::Span<const std::byte> Mesh::PackedVertexAttribute(
     uint32_t vertex_index, uint32_t attribute_index) const {
   ABSL_DCHECK_LT(vertex_index, VertexCount());
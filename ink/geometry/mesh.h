@@ -74,7 +74,9 @@ class Mesh {
   // - Any attribute value is non-finite
   // - The range of values for any attribute (i.e. max - min) is larger than
   //   std::numeric_limits<float>::max()
-  // - More than 2^16 (65536) vertices are given
+  // - More vertices are given than `format`'s packed indices can refer to,
+  //   i.e. `MeshFormat::MaxPackedVertexCount(format.GetIndexFormat())` (2^16
+  //   for 16-bit indices)
   // - `triangle_indices.size()` is not divisible by 3
   // - `triangle_indices` contains any element >=
   //   `vertex_attributes[0].size`
@@ -96,6 +98,46 @@ class Mesh {
       absl::Span<const std::optional<MeshAttributeCodingParams>>
           packing_params = {});
 
+  // Constructs a mesh from data that has already been packed, e.g. a mesh that
+  // was previously stored: `vertex_data` and `index_data` are as returned by
+  // `RawVertexData()` and `RawIndexData()`, and `unpacking_params` and
+  // `attribute_bounds` contain the `VertexAttributeUnpackingParams()` and
+  // `AttributeBounds()` of each attribute (`attribute_bounds` must be empty iff
+  // there are no vertices).
+  //
+  // If `storage` is null, the data is copied into the mesh. Otherwise, the mesh
+  // refers to the bytes of `vertex_data` and `index_data` in place, e.g. in a
+  // memory-mapped file, and keeps `storage` alive for as long as the mesh (or a
+  // copy of it) exists; `storage` must keep those bytes valid and unchanged
+  // until it is destroyed.
+  //
+  // Returns an error if:
+  // - `unpacking_params.size()` != `format.Attributes().size()`, or any element
+  //   has the wrong number of components, or any element for a packed
+  //   attribute has a non-finite offset or scale, or a scale <= 0
+  // - `attribute_bounds` is not empty and `attribute_bounds.size()` !=
+  //   `format.Attributes().size()`, or any element has the wrong number of
+  //   components, or any non-finite value, or a minimum > maximum
+  // - `attribute_bounds` is empty and there are vertices, or vice versa
+  // - `vertex_data.size()` is not divisible by `format.PackedVertexStride()`
+  // - More vertices are given than `format`'s packed indices can refer to
+  // - Any packed attribute value is invalid, i.e. a value of an unpacked type
+  //   is non-finite, or a float holding packed integers is not in the range
+  //   [0, 2^24 - 1]
+  // - `index_data.size()` is not divisible by 3 * `IndexStride()`
+  // - `index_data` contains any index >= the number of vertices
+  //
+  // Note that the attribute values are not checked against `attribute_bounds`;
+  // as with `Mesh::Create`, it is the caller's responsibility to provide bounds
+  // that actually contain the values.
+  static absl::StatusOr<Mesh> CreateFromPackedData(
+      const MeshFormat& format,
+      absl::Span<const MeshAttributeCodingParams> unpacking_params,
+      absl::Span<const MeshAttributeBounds> attribute_bounds,
+      absl::Span<const std::byte> vertex_data,
+      absl::Span<const std::byte> index_data,
+      std::shared_ptr<const void> storage = nullptr);
+
   // Constructs an empty mesh, with a default-constructed `MeshFormat`. Note
   // that, since `Mesh` is read-only, you can't do much with an empty mesh. See
   // `Mesh::Create` and `MutableMesh::ConvertToMeshes` for creating non-empty
@@ -139,6 +181,24 @@ class Mesh {
   SmallArray<float, 4> FloatVertexAttribute(uint32_t vertex_index,
                                             uint32_t attribute_index) const;
 
+  // Writes the position of every vertex in the mesh to `positions`, such that
+  // `positions[i]` is equal to `VertexPosition(i)`. This is much faster than
+  // calling `VertexPosition()` on each vertex when scanning the whole mesh.
+  // CHECK-fails if `positions.size()` != `VertexCount()`.
+  void DecodePositions(absl::Span<Point> positions) const;
+
+  // Writes the (unpacked) value of the attribute at index `attribute_index` on
+  // every vertex in the mesh to `values`, one vertex after another: element
+  // `i * n + j` of `values` is equal to element `j` of
+  // `FloatVertexAttribute(i, attribute_index)`, where `n` is the number of
+  // components of the attribute. This is much faster than calling
+  // `FloatVertexAttribute()` on each vertex when scanning the whole mesh.
+  // CHECK-fails if:
+  // - `attribute_index` >= `Format().Attributes().size()`
+  // - `values.size()` != `n` * `VertexCount()`
+  void DecodeAttribute(uint32_t attribute_index,
+                       absl::Span<float> values) const;
+
   // Returns the packed integer values for the attribute at index
   // `attribute_index` on the vertex at `vertex_index`.
   //
@@ -150,8 +210,8 @@ class Mesh {
 
   // Returns the number of triangles in the mesh.
   uint32_t TriangleCount() const {
-    ABSL_DCHECK_EQ(data_->index_data.size() % (3 * kBytesPerIndex), 0u);
-    ABSL_DCHECK_EQ(data_->index_data.size() / (3 * kBytesPerIndex),
+    ABSL_DCHECK_EQ(data_->index_data.size() % (3 * IndexStride()), 0u);
+    ABSL_DCHECK_EQ(data_->index_data.size() / (3 * IndexStride()),
                    data_->triangle_count);
     return data_->triangle_count;
   }
@@ -160,7 +220,7 @@ class Mesh {
   // index. This DCHECK-fails if `index` >= `TriangleCount()`.
   std::array<uint32_t, 3> TriangleIndices(uint32_t index) const {
     return mesh_internal::ReadTriangleIndicesFromByteArray(
-        index, kBytesPerIndex, data_->index_data);
+        index, IndexStride(), data_->index_data);
   }
 
   // Returns the (position-only) triangle at the given index. This DCHECK-fails
@@ -211,20 +271,30 @@ class Mesh {
   uint32_t VertexStride() const { return Format().PackedVertexStride(); }
 
   // Returns the raw data of the mesh's triangle indices. These are stored
-  // unsigned using 2 bytes per index (i.e. as uint16_t).
+  // unsigned using `IndexStride()` bytes per index (i.e. as uint16_t or
+  // uint32_t).
   absl::Span<const std::byte> RawIndexData() const { return data_->index_data; }
 
   // Returns the number of bytes used to represent a triangle index in this
-  // mesh, which is always two bytes (i.e. sizeof(uint16_t)).
-  uint32_t IndexStride() const { return kBytesPerIndex; }
+  // mesh. This is equivalent to:
+  //   mesh.Format().PackedIndexStride();
+  // which is two bytes (i.e. sizeof(uint16_t)) unless the mesh was created with
+  // `MeshFormat::IndexFormat::k32BitUnpacked32BitPacked`.
+  uint32_t IndexStride() const { return Format().PackedIndexStride(); }
 
  private:
   struct Data {
     MeshFormat format;
     mesh_internal::CodingParamsArray unpacking_params;
     std::optional<mesh_internal::AttributeBoundsArray> attribute_bounds;
-    std::vector<std::byte> vertex_data;
-    std::vector<std::byte> index_data;
+    // The packed vertex and index data. These refer either to
+    // `owned_vertex_data` and `owned_index_data`, or to memory that is kept
+    // alive by `external_storage`.
+    absl::Span<const std::byte> vertex_data;
+    absl::Span<const std::byte> index_data;
+    std::vector<std::byte> owned_vertex_data;
+    std::vector<std::byte> owned_index_data;
+    std::shared_ptr<const void> external_storage;
     uint32_t vertex_count = 0;
     uint32_t triangle_count = 0;
   };
@@ -234,9 +304,6 @@ class Mesh {
   // partition.
   friend class MutableMesh;
 
-  // `Mesh` always uses 16-bit indices.
-  static constexpr uint8_t kBytesPerIndex = sizeof(uint16_t);
-
   Mesh(const MeshFormat& format,
        mesh_internal::CodingParamsArray unpacking_transforms,
        std::optional<mesh_internal::AttributeBoundsArray> attribute_bounds,
@@ -252,6 +319,15 @@ class Mesh {
       absl::Span<const absl::Span<const float>> vertex_attributes,
       const mesh_internal::CodingParamsArray& packing_params_array);
 
+  // Constructor used by `CreateFromPackedData` for data that is not owned by
+  // the mesh.
+  Mesh(const MeshFormat& format,
+       mesh_internal::CodingParamsArray unpacking_transforms,
+       std::optional<mesh_internal::AttributeBoundsArray> attribute_bounds,
+       absl::Span<const std::byte> vertex_data,
+       absl::Span<const std::byte> index_data,
+       absl::Nonnull<std::shared_ptr<const void>> storage);
+
   // Helper function for the private Mesh constructor. Creates a new Data struct
   // while avoiding field initialization order issues.
   static std::shared_ptr<const Data> CreateMeshData(
@@ -260,16 +336,22 @@ class Mesh {
       std::optional<mesh_internal::AttributeBoundsArray> attribute_bounds,
       std::vector<std::byte> vertex_data, std::vector<std::byte> index_data) {
     uint32_t vertex_count = vertex_data.size() / format.PackedVertexStride();
-    uint32_t triangle_count = index_data.size() / (3 * kBytesPerIndex);
-    return std::make_shared<const Data>(Data{
+    uint32_t triangle_count =
+        index_data.size() / (3 * format.PackedIndexStride());
+    auto data = std::make_shared<Data>(Data{
         .format = format,
         .unpacking_params = std::move(unpacking_transforms),
         .attribute_bounds = std::move(attribute_bounds),
-        .vertex_data = std::move(vertex_data),
-        .index_data = std::move(index_data),
+        .owned_vertex_data = std::move(vertex_data),
+        .owned_index_data = std::move(index_data),
         .vertex_count = vertex_count,
         .triangle_count = triangle_count,
     });
+    // The spans must be set after the vectors have reached their final
+    // location.
+    data->vertex_data = data->owned_vertex_data;
+    data->index_data = data->owned_index_data;
+    return data;
   }
 
   // Returns a span into the vector that contains the bytes of the packed floats
@@ -0,0 +1,104 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdint>
+#include <vector>
+
+#include "absl/container/inlined_vector.h"
+#include "absl/log/absl_check.h"
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "benchmark/benchmark.h"
+#include "ink/geometry/mesh.h"
+#include "ink/geometry/mesh_format.h"
+#include "ink/geometry/mesh_test_helpers.h"
+#include "ink/geometry/mutable_mesh.h"
+#include "ink/geometry/point.h"
+#include "ink/types/small_array.h"
+
+namespace ink {
+namespace {
+
+// Returns a `Mesh` in the shape of a straight line with `n_triangles`
+// triangles, with packed positions and a packed color attribute.
+Mesh MakePackedLineMesh(uint32_t n_triangles) {
+  absl::StatusOr<MeshFormat> format = MeshFormat::Create(
+      {{MeshFormat::AttributeType::kFloat2PackedIn3UnsignedBytes_XY12,
+        MeshFormat::AttributeId::kPosition},
+       {MeshFormat::AttributeType::kFloat4PackedIn1Float,
+        MeshFormat::AttributeId::kColorShiftHsl}},
+      MeshFormat::IndexFormat::k32BitUnpacked16BitPacked);
+  ABSL_CHECK_OK(format);
+  MutableMesh mutable_mesh = MakeStraightLineMutableMesh(n_triangles, *format);
+  for (uint32_t i = 0; i < mutable_mesh.VertexCount(); ++i) {
+    mutable_mesh.SetFloatVertexAttribute(i, 1, {0.1f * (i % 10), 0, 0.5f, 1});
+  }
+  absl::StatusOr<absl::InlinedVector<Mesh, 1>> meshes =
+      mutable_mesh.AsMeshes();
+  ABSL_CHECK_OK(meshes);
+  ABSL_CHECK_EQ(meshes->size(), 1u);
+  return meshes->front();
+}
+
+void BM_VertexPosition(benchmark::State& state) {
+  Mesh mesh = MakePackedLineMesh(state.range(0));
+  std::vector<Point> positions(mesh.VertexCount());
+  for (auto s : state) {
+    for (uint32_t i = 0; i < mesh.VertexCount(); ++i) {
+      positions[i] = mesh.VertexPosition(i);
+    }
+    benchmark::DoNotOptimize(positions);
+  }
+  state.SetItemsProcessed(state.iterations() * mesh.VertexCount());
+}
+BENCHMARK(BM_VertexPosition)->Range(1024, 65000);
+
+void BM_DecodePositions(benchmark::State& state) {
+  Mesh mesh = MakePackedLineMesh(state.range(0));
+  std::vector<Point> positions(mesh.VertexCount());
+  for (auto s : state) {
+    mesh.DecodePositions(absl::MakeSpan(positions));
+    benchmark::DoNotOptimize(positions);
+  }
+  state.SetItemsProcessed(state.iterations() * mesh.VertexCount());
+}
+BENCHMARK(BM_DecodePositions)->Range(1024, 65000);
+
+void BM_FloatVertexAttribute(benchmark::State& state) {
+  Mesh mesh = MakePackedLineMesh(state.range(0));
+  std::vector<float> values(4 * mesh.VertexCount());
+  for (auto s : state) {
+    for (uint32_t i = 0; i < mesh.VertexCount(); ++i) {
+      SmallArray<float, 4> value = mesh.FloatVertexAttribute(i, 1);
+      for (int j = 0; j < 4; ++j) values[4 * i + j] = value[j];
+    }
+    benchmark::DoNotOptimize(values);
+  }
+  state.SetItemsProcessed(state.iterations() * mesh.VertexCount());
+}
+BENCHMARK(BM_FloatVertexAttribute)->Range(1024, 65000);
+
+void BM_DecodeAttribute(benchmark::State& state) {
+  Mesh mesh = MakePackedLineMesh(state.range(0));
+  std::vector<float> values(4 * mesh.VertexCount());
+  for (auto s : state) {
+    mesh.DecodeAttribute(1, absl::MakeSpan(values));
+    benchmark::DoNotOptimize(values);
+  }
+  state.SetItemsProcessed(state.iterations() * mesh.VertexCount());
+}
+BENCHMARK(BM_DecodeAttribute)->Range(1024, 65000);
+
+}  // namespace
+}  // namespace ink
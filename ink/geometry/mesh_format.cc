@@ -17,6 +17,7 @@
 #include <bitset>
 #include <cstddef>
 #include <cstdint>
+#include <limits>
 #include <optional>
 #include <string>
 #include <utility>
@@ -293,12 +294,32 @@ uint8_t MeshFormat::UnpackedIndexSize(IndexFormat index_format) {
     case IndexFormat::k16BitUnpacked16BitPacked:
       return 2;
     case IndexFormat::k32BitUnpacked16BitPacked:
+    case IndexFormat::k32BitUnpacked32BitPacked:
       return 4;
   }
   ABSL_LOG(FATAL) << "Unrecognized IndexFormat "
                   << static_cast<int>(index_format);
 }
 
+uint8_t MeshFormat::PackedIndexSize(IndexFormat index_format) {
+  switch (index_format) {
+    case IndexFormat::k16BitUnpacked16BitPacked:
+    case IndexFormat::k32BitUnpacked16BitPacked:
+      return 2;
+    case IndexFormat::k32BitUnpacked32BitPacked:
+      return 4;
+  }
+  ABSL_LOG(FATAL) << "Unrecognized IndexFormat "
+                  << static_cast<int>(index_format);
+}
+
+uint32_t MeshFormat::MaxPackedVertexCount(IndexFormat index_format) {
+  if (PackedIndexSize(index_format) == sizeof(uint16_t)) {
+    return uint32_t{std::numeric_limits<uint16_t>::max()} + 1;
+  }
+  return std::numeric_limits<uint32_t>::max();
+}
+
 void MeshFormat::PopulateOffsetWidthAndStride() {
   uint16_t current_unpacked_offset = 0;
   uint16_t current_packed_offset = 0;
@@ -313,6 +334,7 @@ void MeshFormat::PopulateOffsetWidthAndStride() {
   unpacked_vertex_stride_ = current_unpacked_offset;
   packed_vertex_stride_ = current_packed_offset;
   unpacked_index_stride_ = UnpackedIndexSize(index_format_);
+  packed_index_stride_ = PackedIndexSize(index_format_);
 }
 
 bool MeshFormat::IsPackedEquivalent(const MeshFormat& first,
@@ -471,6 +493,8 @@ std::string ToFormattedString(MeshFormat::IndexFormat index_format) {
       return "k16BitUnpacked16BitPacked";
     case MeshFormat::IndexFormat::k32BitUnpacked16BitPacked:
       return "k32BitUnpacked16BitPacked";
+    case MeshFormat::IndexFormat::k32BitUnpacked32BitPacked:
+      return "k32BitUnpacked32BitPacked";
   }
   return absl::StrCat("Invalid(", static_cast<int>(index_format), ")");
 }
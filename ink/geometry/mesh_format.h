@@ -202,11 +202,19 @@ class MeshFormat {
   // Indicates how the triangle index is stored, in `MutableMesh` and `Mesh`,
   // e.g. `k32BitUnpacked16BitPacked` means that `MutableMesh` uses 32-bit
   // indices and `Mesh` uses 16-bit indices.
+  //
+  // A `Mesh` with 16-bit indices can hold at most 2^16 vertices, so
+  // `MutableMesh::AsMeshes` splits larger meshes into several partitions,
+  // duplicating the vertices that they share. `k32BitUnpacked32BitPacked` is
+  // an opt-in format for clients that draw or hit-test large meshes, e.g. on
+  // desktop or server, where the larger indices are cheaper than the
+  // duplicated vertices and extra partitions.
   // TODO: b/295166196 - Delete this once `MutableMesh` uses 16-bit indices.
   // LINT.IfChange(index_formats)
   enum class IndexFormat : uint8_t {
     k16BitUnpacked16BitPacked,
     k32BitUnpacked16BitPacked,
+    k32BitUnpacked32BitPacked,
   };
   // LINT.ThenChange(fuzz_domains.cc:index_formats)
 
@@ -257,6 +265,10 @@ class MeshFormat {
   // TODO: b/295166196 - Delete this once `MutableMesh` uses 16-bit indices.
   uint8_t UnpackedIndexStride() const { return unpacked_index_stride_; }
 
+  // Returns the number of bytes used to represent a single triangle index for
+  // a packed mesh.
+  uint8_t PackedIndexStride() const { return packed_index_stride_; }
+
   // Returns whether two mesh formats have the same packed representation
   // and same packing scheme such that they can be passed to the same shader
   // that accepts packed attribute values.
@@ -296,6 +308,14 @@ class MeshFormat {
   // TODO: b/295166196 - Delete this once `MutableMesh` uses 16-bit indices.
   static uint8_t UnpackedIndexSize(IndexFormat index_format);
 
+  // Returns the size in bytes of a single vertex index in a packed mesh.
+  static uint8_t PackedIndexSize(IndexFormat index_format);
+
+  // Returns the maximum number of vertices in a packed mesh, i.e. the number of
+  // distinct values of its vertex indices: 2^16 for 16-bit indices, and
+  // 2^32 - 1 for 32-bit indices, so that the count fits in a `uint32_t`.
+  static uint32_t MaxPackedVertexCount(IndexFormat index_format);
+
   // Returns the maximum supported number of vertex attributes.
   static uint8_t MaxAttributes() { return mesh_internal::kMaxVertexAttributes; }
 
@@ -320,6 +340,7 @@ class MeshFormat {
   uint16_t packed_vertex_stride_;
   // TODO: b/295166196 - Delete this once `MutableMesh` uses 16-bit indices.
   uint8_t unpacked_index_stride_;
+  uint8_t packed_index_stride_;
 };
 
 bool operator==(const MeshFormat& a, const MeshFormat& b);
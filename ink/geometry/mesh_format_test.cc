@@ -14,6 +14,8 @@
 
 #include "ink/geometry/mesh_format.h"
 
+#include <cstdint>
+#include <limits>
 #include <optional>
 #include <utility>
 #include <vector>
@@ -86,6 +88,8 @@ TEST(MeshFormatTest, StringifyIndexFormat) {
             "k16BitUnpacked16BitPacked");
   EXPECT_EQ(absl::StrCat(MeshFormat::IndexFormat::k32BitUnpacked16BitPacked),
             "k32BitUnpacked16BitPacked");
+  EXPECT_EQ(absl::StrCat(MeshFormat::IndexFormat::k32BitUnpacked32BitPacked),
+            "k32BitUnpacked32BitPacked");
   EXPECT_EQ(absl::StrCat(static_cast<MeshFormat::IndexFormat>(91)),
             "Invalid(91)");
 }
@@ -120,6 +124,7 @@ TEST(MeshFormatTest, DefaultCtor) {
   EXPECT_EQ(format.GetIndexFormat(),
             MeshFormat::IndexFormat::k32BitUnpacked16BitPacked);
   EXPECT_EQ(format.UnpackedIndexStride(), 4);
+  EXPECT_EQ(format.PackedIndexStride(), 2);
 }
 
 TEST(MeshFormatTest, ConstructWithOneAttribute) {
@@ -137,6 +142,19 @@ TEST(MeshFormatTest, ConstructWithOneAttribute) {
   EXPECT_EQ(format->GetIndexFormat(),
             MeshFormat::IndexFormat::k16BitUnpacked16BitPacked);
   EXPECT_EQ(format->UnpackedIndexStride(), 2);
+  EXPECT_EQ(format->PackedIndexStride(), 2);
+}
+
+TEST(MeshFormatTest, ConstructWith32BitPackedIndices) {
+  absl::StatusOr<MeshFormat> format =
+      MeshFormat::Create({{AttrType::kFloat2PackedIn1Float, AttrId::kPosition}},
+                         MeshFormat::IndexFormat::k32BitUnpacked32BitPacked);
+  ASSERT_EQ(format.status(), absl::OkStatus());
+
+  EXPECT_EQ(format->GetIndexFormat(),
+            MeshFormat::IndexFormat::k32BitUnpacked32BitPacked);
+  EXPECT_EQ(format->UnpackedIndexStride(), 4);
+  EXPECT_EQ(format->PackedIndexStride(), 4);
 }
 
 TEST(MeshFormatTest, ConstructWithMultipleAttributes) {
@@ -423,6 +441,33 @@ TEST(MeshFormatTest, UnpackedIndexSize) {
   EXPECT_EQ(MeshFormat::UnpackedIndexSize(
                 MeshFormat::IndexFormat::k32BitUnpacked16BitPacked),
             4);
+  EXPECT_EQ(MeshFormat::UnpackedIndexSize(
+                MeshFormat::IndexFormat::k32BitUnpacked32BitPacked),
+            4);
+}
+
+TEST(MeshFormatTest, PackedIndexSize) {
+  EXPECT_EQ(MeshFormat::PackedIndexSize(
+                MeshFormat::IndexFormat::k16BitUnpacked16BitPacked),
+            2);
+  EXPECT_EQ(MeshFormat::PackedIndexSize(
+                MeshFormat::IndexFormat::k32BitUnpacked16BitPacked),
+            2);
+  EXPECT_EQ(MeshFormat::PackedIndexSize(
+                MeshFormat::IndexFormat::k32BitUnpacked32BitPacked),
+            4);
+}
+
+TEST(MeshFormatTest, MaxPackedVertexCount) {
+  EXPECT_EQ(MeshFormat::MaxPackedVertexCount(
+                MeshFormat::IndexFormat::k16BitUnpacked16BitPacked),
+            65536);
+  EXPECT_EQ(MeshFormat::MaxPackedVertexCount(
+                MeshFormat::IndexFormat::k32BitUnpacked16BitPacked),
+            65536);
+  EXPECT_EQ(MeshFormat::MaxPackedVertexCount(
+                MeshFormat::IndexFormat::k32BitUnpacked32BitPacked),
+            std::numeric_limits<uint32_t>::max());
 }
 
 TEST(MeshFormatTest, MaxAttributes) {
@@ -444,6 +489,9 @@ TEST(MeshFormatDeathTest, BadEnumValues) {
   EXPECT_DEATH_IF_SUPPORTED(
       MeshFormat::UnpackedIndexSize(static_cast<MeshFormat::IndexFormat>(12)),
       "Unrecognized");
+  EXPECT_DEATH_IF_SUPPORTED(
+      MeshFormat::PackedIndexSize(static_cast<MeshFormat::IndexFormat>(12)),
+      "Unrecognized");
 }
 
 TEST(MeshFormatTest, IsPackedEquivalent) {
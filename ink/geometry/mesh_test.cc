@@ -19,11 +19,14 @@
 #include <cstdint>
 #include <cstring>
 #include <limits>
+#include <memory>
 #include <optional>
+#include <utility>
 #include <vector>
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include "absl/log/absl_check.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/types/span.h"
@@ -502,6 +505,36 @@ TEST(MeshTest, RawIndexData) {
                                                        0, 4, 1})));
 }
 
+TEST(MeshTest, CreateWith32BitPackedIndices) {
+  absl::StatusOr<MeshFormat> format = MeshFormat::Create(
+      {{MeshFormat::AttributeType::kFloat2Unpacked,
+        MeshFormat::AttributeId::kPosition}},
+      MeshFormat::IndexFormat::k32BitUnpacked32BitPacked);
+  ASSERT_EQ(format.status(), absl::OkStatus());
+  // More vertices than a 16-bit index can refer to.
+  constexpr uint32_t kVertexCount = 70010;
+  std::vector<float> position_x(kVertexCount);
+  std::vector<float> position_y(kVertexCount);
+  for (uint32_t i = 0; i < kVertexCount; ++i) {
+    position_x[i] = i;
+    position_y[i] = i % 3;
+  }
+  absl::StatusOr<Mesh> m =
+      Mesh::Create(*format, {position_x, position_y},
+                   {0, 1, 2, 70000, 70001, 65536, kVertexCount - 1, 0, 1});
+  ASSERT_EQ(m.status(), absl::OkStatus());
+
+  EXPECT_EQ(m->VertexCount(), kVertexCount);
+  EXPECT_EQ(m->TriangleCount(), 3);
+  EXPECT_EQ(m->IndexStride(), 4);
+  EXPECT_THAT(m->TriangleIndices(1), ElementsAre(70000, 70001, 65536));
+  EXPECT_THAT(m->TriangleIndices(2), ElementsAre(kVertexCount - 1, 0, 1));
+  EXPECT_THAT(m->VertexPosition(70001), PointEq({70001, 2}));
+  EXPECT_THAT(m->RawIndexData(),
+              ElementsAreArray(AsByteVector<uint32_t>(
+                  {0, 1, 2, 70000, 70001, 65536, kVertexCount - 1, 0, 1})));
+}
+
 TEST(MeshTest, CreateErrorWhenPositionMissingComponent) {
   absl::Status position_missing_component =
       Mesh::Create(MeshFormat(),
@@ -739,6 +772,71 @@ TEST(MeshTest, CreationErrorPackingParamsCanNotRepresentAllValues) {
               HasSubstr("cannot represent all values"));
 }
 
+// Returns a mesh with `n_vertices` vertices, with a packed position, a packed
+// custom attribute and an unpacked custom attribute that all vary from vertex
+// to vertex.
+Mesh MakeMeshForDecoding(uint32_t n_vertices) {
+  absl::StatusOr<MeshFormat> format = MeshFormat::Create(
+      {{AttrType::kFloat3PackedIn2Floats, AttrId::kCustom0},
+       {AttrType::kFloat2PackedIn3UnsignedBytes_XY12, AttrId::kPosition},
+       {AttrType::kFloat1Unpacked, AttrId::kCustom1}},
+      MeshFormat::IndexFormat::k32BitUnpacked16BitPacked);
+  ABSL_CHECK_OK(format);
+  std::vector<std::vector<float>> values(6);
+  for (uint32_t i = 0; i < n_vertices; ++i) {
+    values[0].push_back(std::sin(0.1f * i));
+    values[1].push_back(0.5f * i);
+    values[2].push_back(-3.f * (i % 7));
+    values[3].push_back(2.f * i);
+    values[4].push_back(std::cos(0.3f * i));
+    values[5].push_back(0.25f * i - 10);
+  }
+  std::vector<absl::Span<const float>> value_spans(values.begin(),
+                                                    values.end());
+  absl::StatusOr<Mesh> mesh = Mesh::Create(*format, value_spans, {});
+  ABSL_CHECK_OK(mesh);
+  return *mesh;
+}
+
+TEST(MeshTest, DecodePositionsMatchesVertexPosition) {
+  // Use enough vertices that the positions are decoded in several blocks.
+  Mesh mesh = MakeMeshForDecoding(600);
+
+  std::vector<Point> positions(mesh.VertexCount());
+  mesh.DecodePositions(absl::MakeSpan(positions));
+
+  for (uint32_t i = 0; i < mesh.VertexCount(); ++i) {
+    EXPECT_THAT(positions[i], PointEq(mesh.VertexPosition(i))) << i;
+  }
+}
+
+TEST(MeshTest, DecodeAttributeMatchesFloatVertexAttribute) {
+  Mesh mesh = MakeMeshForDecoding(600);
+
+  for (uint32_t attr_idx = 0; attr_idx < mesh.Format().Attributes().size();
+       ++attr_idx) {
+    int n_components =
+        MeshFormat::ComponentCount(mesh.Format().Attributes()[attr_idx].type);
+    std::vector<float> values(n_components * mesh.VertexCount());
+    mesh.DecodeAttribute(attr_idx, absl::MakeSpan(values));
+
+    for (uint32_t i = 0; i < mesh.VertexCount(); ++i) {
+      EXPECT_THAT(absl::MakeSpan(values).subspan(i * n_components,
+                                                 n_components),
+                  Pointwise(FloatEq(),
+                            mesh.FloatVertexAttribute(i, attr_idx).Values()))
+          << "attribute " << attr_idx << ", vertex " << i;
+    }
+  }
+}
+
+TEST(MeshTest, DecodeEmptyMesh) {
+  Mesh mesh;
+
+  mesh.DecodePositions({});
+  mesh.DecodeAttribute(0, {});
+}
+
 TEST(MeshTest, CloneDefaultConstructedMesh) {
   Mesh original;
 
@@ -875,6 +973,168 @@ TEST(MeshTest, CloneNonEmptyMesh) {
               ElementsAreArray(original->TriangleIndices(0)));
 }
 
+// Returns the unpacking params of each attribute of `mesh`.
+std::vector<MeshAttributeCodingParams> GetUnpackingParams(const Mesh& mesh) {
+  std::vector<MeshAttributeCodingParams> params;
+  for (uint32_t i = 0; i < mesh.Format().Attributes().size(); ++i) {
+    params.push_back(mesh.VertexAttributeUnpackingParams(i));
+  }
+  return params;
+}
+
+// Returns the bounds of each attribute of `mesh`, or an empty vector if it has
+// no vertices.
+std::vector<MeshAttributeBounds> GetAttributeBounds(const Mesh& mesh) {
+  std::vector<MeshAttributeBounds> bounds;
+  for (uint32_t i = 0; i < mesh.Format().Attributes().size(); ++i) {
+    if (std::optional<MeshAttributeBounds> b = mesh.AttributeBounds(i)) {
+      bounds.push_back(*b);
+    }
+  }
+  return bounds;
+}
+
+// Returns a non-empty mesh with a mix of packed and unpacked attributes.
+Mesh MakeMeshForCreateFromPackedData() {
+  absl::StatusOr<MeshFormat> format =
+      MeshFormat::Create({{MeshFormat::AttributeType::kFloat3Unpacked,
+                           MeshFormat::AttributeId::kCustom0},
+                          {MeshFormat::AttributeType::kFloat2PackedIn1Float,
+                           MeshFormat::AttributeId::kPosition}},
+                         MeshFormat::IndexFormat::k32BitUnpacked16BitPacked);
+  ABSL_CHECK_OK(format);
+  absl::StatusOr<Mesh> mesh = Mesh::Create(*format,
+                                           {// Custom attribute
+                                            {-200, 100, 500, 3},
+                                            {4, 5, 6, 7},
+                                            {.1, 25, -5, 0},
+                                            // Position
+                                            {17, -12, 5, 0},
+                                            {123, 456, 789, 0}},
+                                           // Triangles
+                                           {0, 1, 2, 1, 2, 3});
+  ABSL_CHECK_OK(mesh);
+  return *mesh;
+}
+
+TEST(MeshTest, CreateFromPackedDataCopiesData) {
+  Mesh original = MakeMeshForCreateFromPackedData();
+
+  absl::StatusOr<Mesh> mesh = Mesh::CreateFromPackedData(
+      original.Format(), GetUnpackingParams(original),
+      GetAttributeBounds(original), original.RawVertexData(),
+      original.RawIndexData());
+  ASSERT_EQ(mesh.status(), absl::OkStatus());
+
+  EXPECT_THAT(*mesh, MeshEq(original));
+  EXPECT_NE(mesh->RawVertexData().data(), original.RawVertexData().data());
+  EXPECT_NE(mesh->RawIndexData().data(), original.RawIndexData().data());
+}
+
+TEST(MeshTest, CreateFromPackedDataWithStorageReferencesData) {
+  Mesh original = MakeMeshForCreateFromPackedData();
+  auto storage = std::make_shared<std::vector<std::byte>>(
+      original.RawVertexData().begin(), original.RawVertexData().end());
+  storage->insert(storage->end(), original.RawIndexData().begin(),
+                  original.RawIndexData().end());
+  absl::Span<const std::byte> bytes = *storage;
+  std::weak_ptr<std::vector<std::byte>> weak_storage = storage;
+
+  absl::StatusOr<Mesh> mesh = Mesh::CreateFromPackedData(
+      original.Format(), GetUnpackingParams(original),
+      GetAttributeBounds(original),
+      bytes.subspan(0, original.RawVertexData().size()),
+      bytes.subspan(original.RawVertexData().size()), std::move(storage));
+  ASSERT_EQ(mesh.status(), absl::OkStatus());
+
+  EXPECT_THAT(*mesh, MeshEq(original));
+  EXPECT_EQ(mesh->RawVertexData().data(), bytes.data());
+  EXPECT_FALSE(weak_storage.expired());
+  *mesh = Mesh();
+  EXPECT_TRUE(weak_storage.expired());
+}
+
+TEST(MeshTest, CreateFromPackedDataEmptyMesh) {
+  Mesh original;
+
+  absl::StatusOr<Mesh> mesh = Mesh::CreateFromPackedData(
+      original.Format(), GetUnpackingParams(original), {}, {}, {});
+  ASSERT_EQ(mesh.status(), absl::OkStatus());
+
+  EXPECT_THAT(*mesh, MeshEq(original));
+}
+
+TEST(MeshTest, CreateFromPackedDataErrors) {
+  Mesh original = MakeMeshForCreateFromPackedData();
+  std::vector<MeshAttributeCodingParams> params = GetUnpackingParams(original);
+  std::vector<MeshAttributeBounds> bounds = GetAttributeBounds(original);
+  absl::Span<const std::byte> vertex_data = original.RawVertexData();
+  absl::Span<const std::byte> index_data = original.RawIndexData();
+
+  EXPECT_THAT(
+      Mesh::CreateFromPackedData(original.Format(),
+                                 absl::MakeSpan(params).subspan(1), bounds,
+                                 vertex_data, index_data)
+          .status()
+          .message(),
+      HasSubstr("Wrong number of unpacking params"));
+  {
+    std::vector<MeshAttributeCodingParams> bad_params = params;
+    bad_params[1].components[0].scale = 0;
+    EXPECT_THAT(Mesh::CreateFromPackedData(original.Format(), bad_params,
+                                           bounds, vertex_data, index_data)
+                    .status()
+                    .message(),
+                HasSubstr("Unpacking params at index 1"));
+  }
+  EXPECT_THAT(Mesh::CreateFromPackedData(original.Format(), params, {},
+                                         vertex_data, index_data)
+                  .status()
+                  .message(),
+              HasSubstr("Attribute bounds must be given"));
+  {
+    std::vector<MeshAttributeBounds> bad_bounds = bounds;
+    bad_bounds[0].minimum[0] = std::numeric_limits<float>::quiet_NaN();
+    EXPECT_THAT(Mesh::CreateFromPackedData(original.Format(), params,
+                                           bad_bounds, vertex_data, index_data)
+                    .status()
+                    .message(),
+                HasSubstr("Attribute bounds at index 0"));
+  }
+  EXPECT_THAT(
+      Mesh::CreateFromPackedData(original.Format(), params, bounds,
+                                 vertex_data.subspan(1), index_data)
+          .status()
+          .message(),
+      HasSubstr("not a multiple of the vertex stride"));
+  {
+    // The position is packed into the float after the 3 unpacked floats.
+    std::vector<std::byte> bad_vertex_data(vertex_data.begin(),
+                                           vertex_data.end());
+    float out_of_range = -1;
+    std::memcpy(&bad_vertex_data[3 * sizeof(float)], &out_of_range,
+                sizeof(float));
+    EXPECT_THAT(Mesh::CreateFromPackedData(original.Format(), params, bounds,
+                                           bad_vertex_data, index_data)
+                    .status()
+                    .message(),
+                HasSubstr("Invalid packed value for attribute 1 of vertex 0"));
+  }
+  EXPECT_THAT(
+      Mesh::CreateFromPackedData(original.Format(), params, bounds,
+                                 vertex_data, index_data.subspan(2))
+          .status()
+          .message(),
+      HasSubstr("not a multiple of the triangle size"));
+  EXPECT_THAT(Mesh::CreateFromPackedData(
+                  original.Format(), params, bounds,
+                  vertex_data.subspan(0, 2 * original.VertexStride()),
+                  index_data)
+                  .status()
+                  .message(),
+              HasSubstr("non-existent vertex"));
+}
+
 TEST(MeshDeathTest, VertexIndexOutOfBounds) {
   // There is no EXPECT_DEBUG_DEATH_IF_SUPPORTED, so we only run these when
   // compiled in debug mode.
@@ -934,5 +1194,18 @@ TEST(MeshDeathTest, TriangleIndexOutOfBounds) {
 #endif
 }
 
+TEST(MeshDeathTest, DecodeWithWrongSize) {
+  Mesh mesh = MakeMeshForDecoding(3);
+  std::vector<Point> positions(2);
+  std::vector<float> values(8);
+
+  EXPECT_DEATH_IF_SUPPORTED(mesh.DecodePositions(absl::MakeSpan(positions)),
+                            "");
+  EXPECT_DEATH_IF_SUPPORTED(mesh.DecodeAttribute(0, absl::MakeSpan(values)),
+                            "");
+  EXPECT_DEATH_IF_SUPPORTED(mesh.DecodeAttribute(3, absl::MakeSpan(values)),
+                            "");
+}
+
 }  // namespace
 }  // namespace ink
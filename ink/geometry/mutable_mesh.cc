@@ -29,7 +29,6 @@
 
 #include "absl/algorithm/container.h"
 #include "absl/base/nullability.h"
-#include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/container/inlined_vector.h"
 #include "absl/log/absl_check.h"
@@ -48,6 +47,7 @@
 #include "ink/geometry/triangle.h"
 #include "ink/geometry/vec.h"
 #include "ink/types/internal/float.h"
+#include "ink/types/parallel_for.h"
 #include "ink/types/small_array.h"
 
 namespace ink {
@@ -72,12 +72,12 @@ MutableMesh MutableMesh::FromMesh(const Mesh& mesh) {
           mesh.FloatVertexAttribute(vertex_idx, attr_idx));
     }
   }
-  if (mesh.Format().GetIndexFormat() ==
-      MeshFormat::IndexFormat::k16BitUnpacked16BitPacked) {
+  if (MeshFormat::UnpackedIndexSize(mesh.Format().GetIndexFormat()) ==
+      mesh.IndexStride()) {
     // The indices are stored in the same format in both meshes, we can just
     // copy them over directly, which is much faster.
     std::memcpy(mutable_mesh.index_data_.data(), mesh.RawIndexData().data(),
-                3 * Mesh::kBytesPerIndex * mesh.TriangleCount());
+                3 * mesh.IndexStride() * mesh.TriangleCount());
   } else {
     for (uint32_t tri_idx = 0; tri_idx < mesh.TriangleCount(); ++tri_idx) {
       mutable_mesh.SetTriangleIndices(tri_idx, mesh.TriangleIndices(tri_idx));
@@ -277,15 +277,31 @@ struct FlippedTriangleCorrectionData {
   std::deque<uint32_t> flipped_tri_queue;
   // The states of each triangle in the mesh as the algorithm progresses.
   std::vector<TriFlipState> tri_flip_states;
-  // The set of adjacent triangles for each triangle in the mesh, where
-  // "adjacent" means that they share one or more vertices.
-  std::vector<absl::flat_hash_set<uint32_t>> adjacent_triangles;
+  // The triangles that use each vertex, in compressed sparse row form: the
+  // triangles that use vertex `i` are the elements of `vertex_triangles` from
+  // `vertex_triangle_offsets[i]` up to `vertex_triangle_offsets[i + 1]`, in
+  // increasing order.
+  std::vector<uint32_t> vertex_triangle_offsets;
+  std::vector<uint32_t> vertex_triangles;
   // The bounds of the representable quantized values.
   Rect quantization_bounds;
-  // The corrected vertices, in the mesh's coordinate space.
-  absl::flat_hash_map<uint32_t, Point> corrected_vertices;
+  // The corrected position, in the mesh's coordinate space, of each vertex
+  // that has been corrected, indexed by vertex. This is empty until the first
+  // correction is recorded.
+  std::vector<std::optional<Point>> corrected_vertices;
 };
 
+// The number of vertices or triangles that are handled by each task of the
+// passes over the whole mesh that are run with a `ParallelFor`.
+constexpr uint32_t kElementsPerParallelTask = 4096;
+
+// Returns the number of tasks needed to cover `n_elements` vertices or
+// triangles, `kElementsPerParallelTask` at a time.
+uint32_t NumParallelTasks(uint32_t n_elements) {
+  return (n_elements + kElementsPerParallelTask - 1) /
+         kElementsPerParallelTask;
+}
+
 Point QuantizePoint(Point p, const MeshAttributeCodingParams& packing_params) {
   auto quantize = [](MeshAttributeCodingParams::ComponentCodingParams params,
                      float value) {
@@ -297,56 +313,106 @@ Point QuantizePoint(Point p, const MeshAttributeCodingParams& packing_params) {
           quantize(packing_params.components[1], p.y)};
 }
 
-void PopulateQuantizedVertexPositions(FlippedTriangleCorrectionData& data) {
+void PopulateQuantizedVertexPositions(FlippedTriangleCorrectionData& data,
+                                      ParallelFor parallel_for) {
   uint32_t n_vertices = data.mesh->VertexCount();
   data.quantized_vertex_positions.resize(n_vertices);
-  for (uint32_t i = 0; i < n_vertices; ++i) {
-    data.quantized_vertex_positions[i] =
-        QuantizePoint(data.mesh->VertexPosition(i), *data.packing_params);
-  }
+  parallel_for(NumParallelTasks(n_vertices), [&data,
+                                               n_vertices](uint32_t task) {
+    uint32_t begin = task * kElementsPerParallelTask;
+    uint32_t end = std::min(begin + kElementsPerParallelTask, n_vertices);
+    for (uint32_t i = begin; i < end; ++i) {
+      data.quantized_vertex_positions[i] =
+          QuantizePoint(data.mesh->VertexPosition(i), *data.packing_params);
+    }
+  });
 }
 
-void PopulateFlippedTris(FlippedTriangleCorrectionData& data) {
+// Classifies each triangle as flipped by quantization or not, and queues the
+// flipped triangles in order of index. Returns false if any triangle already
+// has negative area before quantization, in which case we don't attempt to
+// correct quantization errors, and the classification is incomplete.
+bool PopulateFlippedTris(FlippedTriangleCorrectionData& data,
+                         ParallelFor parallel_for) {
   uint32_t n_triangles = data.mesh->TriangleCount();
   data.tri_flip_states.resize(n_triangles);
+  uint32_t n_tasks = NumParallelTasks(n_triangles);
+  // This is a vector of `uint8_t` rather than `bool`, so that tasks can write
+  // their own elements concurrently.
+  std::vector<uint8_t> task_found_negative_area(n_tasks, false);
+  parallel_for(n_tasks, [&data, &task_found_negative_area,
+                         n_triangles](uint32_t task) {
+    uint32_t begin = task * kElementsPerParallelTask;
+    uint32_t end = std::min(begin + kElementsPerParallelTask, n_triangles);
+    for (uint32_t i = begin; i < end; ++i) {
+      if (data.mesh->GetTriangle(i).SignedArea() < 0) {
+        task_found_negative_area[task] = true;
+        return;
+      }
+      std::array<uint32_t, 3> indices = data.mesh->TriangleIndices(i);
+      Triangle t{data.quantized_vertex_positions[indices[0]],
+                 data.quantized_vertex_positions[indices[1]],
+                 data.quantized_vertex_positions[indices[2]]};
+      data.tri_flip_states[i] = t.SignedArea() < 0 ? TriFlipState::kFlipped
+                                                   : TriFlipState::kNotFlipped;
+    }
+  });
+  if (absl::c_linear_search(task_found_negative_area, true)) return false;
+
   for (uint32_t i = 0; i < n_triangles; ++i) {
-    std::array<uint32_t, 3> indices = data.mesh->TriangleIndices(i);
-    Triangle t{data.quantized_vertex_positions[indices[0]],
-               data.quantized_vertex_positions[indices[1]],
-               data.quantized_vertex_positions[indices[2]]};
-    // Because `MutableMesh::AsMeshes` has already checked that the
-    // pre-quantization triangles all has non-negative area, we only need to
-    // check the post-quantization triangles here.
-    if (t.SignedArea() < 0) {
+    if (data.tri_flip_states[i] == TriFlipState::kFlipped) {
       data.flipped_tri_queue.push_back(i);
-      data.tri_flip_states[i] = TriFlipState::kFlipped;
-    } else {
-      data.tri_flip_states[i] = TriFlipState::kNotFlipped;
     }
   }
+  return true;
 }
 
-void PopulateAdjacentTriangleMap(FlippedTriangleCorrectionData& data) {
+void PopulateVertexTriangles(FlippedTriangleCorrectionData& data) {
   uint32_t n_vertices = data.mesh->VertexCount();
   uint32_t n_triangles = data.mesh->TriangleCount();
-  std::vector<absl::InlinedVector<uint32_t, 3>> vertex_to_tris;
-  vertex_to_tris.resize(n_vertices);
+  // Count the triangles that use each vertex, offset by one, and accumulate
+  // them to get the offset of each vertex's triangles.
+  data.vertex_triangle_offsets.assign(n_vertices + 1, 0);
   for (uint32_t tri_idx = 0; tri_idx < n_triangles; ++tri_idx) {
     for (uint32_t vtx_idx : data.mesh->TriangleIndices(tri_idx)) {
-      vertex_to_tris[vtx_idx].push_back(tri_idx);
+      ++data.vertex_triangle_offsets[vtx_idx + 1];
     }
   }
-  data.adjacent_triangles.resize(n_triangles);
+  for (uint32_t vtx_idx = 0; vtx_idx < n_vertices; ++vtx_idx) {
+    data.vertex_triangle_offsets[vtx_idx + 1] +=
+        data.vertex_triangle_offsets[vtx_idx];
+  }
+  // Fill in the triangles; since they're visited in order of index, each
+  // vertex's triangles end up sorted.
+  data.vertex_triangles.resize(3 * n_triangles);
+  std::vector<uint32_t> next_offsets(data.vertex_triangle_offsets.begin(),
+                                     data.vertex_triangle_offsets.end() - 1);
   for (uint32_t tri_idx = 0; tri_idx < n_triangles; ++tri_idx) {
-    auto inserter = std::inserter(data.adjacent_triangles[tri_idx],
-                                  data.adjacent_triangles[tri_idx].end());
     for (uint32_t vtx_idx : data.mesh->TriangleIndices(tri_idx)) {
-      absl::c_copy(vertex_to_tris[vtx_idx], inserter);
+      data.vertex_triangles[next_offsets[vtx_idx]++] = tri_idx;
     }
+  }
+}
 
-    // We don't consider a triangle to be adjacent to itself.
-    data.adjacent_triangles[tri_idx].erase(tri_idx);
+// Replaces the contents of `adjacent_tris` with the triangles that are
+// adjacent to the triangle at `tri_idx`, in increasing order, where "adjacent"
+// means that they share one or more vertices. We don't consider a triangle to
+// be adjacent to itself.
+void GetAdjacentTriangles(const FlippedTriangleCorrectionData& data,
+                          uint32_t tri_idx,
+                          std::vector<uint32_t>& adjacent_tris) {
+  adjacent_tris.clear();
+  for (uint32_t vtx_idx : data.mesh->TriangleIndices(tri_idx)) {
+    adjacent_tris.insert(
+        adjacent_tris.end(),
+        data.vertex_triangles.begin() + data.vertex_triangle_offsets[vtx_idx],
+        data.vertex_triangles.begin() +
+            data.vertex_triangle_offsets[vtx_idx + 1]);
   }
+  absl::c_sort(adjacent_tris);
+  adjacent_tris.erase(std::unique(adjacent_tris.begin(), adjacent_tris.end()),
+                      adjacent_tris.end());
+  adjacent_tris.erase(absl::c_find(adjacent_tris, tri_idx));
 }
 
 Rect CalculateQuantizationBounds(const FlippedTriangleCorrectionData& data,
@@ -378,9 +444,10 @@ Triangle GetQuantizedTriangle(const FlippedTriangleCorrectionData& data,
 uint16_t GetBitmaskOfAlreadyCorrectedVertices(
     const FlippedTriangleCorrectionData& data,
     const std::array<uint32_t, 3>& vertex_indices) {
+  if (data.corrected_vertices.empty()) return 0;
   uint16_t bitmask = 0;
   for (int i = 0; i < 3; ++i) {
-    if (data.corrected_vertices.contains(vertex_indices[i]))
+    if (data.corrected_vertices[vertex_indices[i]].has_value())
       bitmask |= kNudgeVertexBitmasks[i];
   }
   return bitmask;
@@ -441,10 +508,12 @@ Triangle GetNudgedTriangle(const Triangle& quantized_triangle,
 struct NudgeCandidate {
   // The nudge bitmask, see `kNudgeDeltaBitMasks` for details.
   uint16_t bitmask;
-  // The adjacent triangles that are also fixed by this candidate.
-  absl::flat_hash_set<uint32_t> newly_fixed_adjacent_tris;
-  // The adjacent triangles that are newly broken by this candidate.
-  absl::flat_hash_set<uint32_t> newly_flipped_adjacent_tris;
+  // The adjacent triangles that are also fixed by this candidate, in
+  // increasing order.
+  absl::InlinedVector<uint32_t, 8> newly_fixed_adjacent_tris;
+  // The adjacent triangles that are newly broken by this candidate, in
+  // increasing order.
+  absl::InlinedVector<uint32_t, 8> newly_flipped_adjacent_tris;
 
   // Returns true if `this` is a better nudge that `other`.
   bool IsBetterThan(const NudgeCandidate& other) const {
@@ -478,7 +547,8 @@ struct NudgeCandidate {
 // - It moves a vertex outside of the representable bounds
 // - It re-flips a triangle that has already been corrected.
 std::optional<NudgeCandidate> MaybeMakeNudgeCandidate(
-    uint32_t tri_idx, const std::array<uint32_t, 3>& indices,
+    absl::Span<const uint32_t> adjacent_tris,
+    const std::array<uint32_t, 3>& indices,
     const Triangle& quantized_triangle, uint16_t nudge_bitmask,
     uint16_t already_corrected_bitmask, const std::array<Vec, 3>& nudge_vectors,
     const FlippedTriangleCorrectionData& data) {
@@ -512,7 +582,7 @@ std::optional<NudgeCandidate> MaybeMakeNudgeCandidate(
   };
 
   NudgeCandidate candidate{.bitmask = nudge_bitmask};
-  for (uint32_t adj_tri_idx : data.adjacent_triangles[tri_idx]) {
+  for (uint32_t adj_tri_idx : adjacent_tris) {
     std::array<uint32_t, 3> adj_indices =
         data.mesh->TriangleIndices(adj_tri_idx);
     std::optional<Point> corrected_p0 = maybe_get_nudged_vertex(adj_indices[0]);
@@ -536,13 +606,13 @@ std::optional<NudgeCandidate> MaybeMakeNudgeCandidate(
     // triangle.
     if (adj_tri.SignedArea() < 0) {
       if (state == TriFlipState::kNotFlipped) {
-        candidate.newly_flipped_adjacent_tris.insert(adj_tri_idx);
+        candidate.newly_flipped_adjacent_tris.push_back(adj_tri_idx);
       } else if (state == TriFlipState::kFixed) {
         // Don't consider candidates that re-flip an already fixed triangle.
         return std::nullopt;
       }
     } else if (state == TriFlipState::kFlipped) {
-      candidate.newly_fixed_adjacent_tris.insert(adj_tri_idx);
+      candidate.newly_fixed_adjacent_tris.push_back(adj_tri_idx);
     }
   }
   return candidate;
@@ -552,9 +622,12 @@ void RecordCorrectionAndAddNewFlippedTrisToQueue(
     uint32_t tri_idx, const std::array<uint32_t, 3>& indices,
     const Triangle& quantized_triangle, const std::array<Vec, 3>& nudge_vectors,
     const NudgeCandidate& candidate, FlippedTriangleCorrectionData& data) {
+  if (data.corrected_vertices.empty()) {
+    data.corrected_vertices.resize(data.mesh->VertexCount());
+  }
   auto record_vertex = [&data](uint32_t idx, Point p) {
     data.quantized_vertex_positions[idx] = p;
-    data.corrected_vertices.insert({idx, p});
+    data.corrected_vertices[idx] = p;
   };
   Triangle nudged_triangle =
       GetNudgedTriangle(quantized_triangle, nudge_vectors, candidate.bitmask,
@@ -577,25 +650,25 @@ void RecordCorrectionAndAddNewFlippedTrisToQueue(
     data.tri_flip_states[adj_tri_idx] = TriFlipState::kFlipped;
   }
 
-  if (!candidate.newly_flipped_adjacent_tris.empty()) {
-    // Sort the newly added triangles before adding them to the queue to be
-    // fixed -- this keeps the algorithm deterministic.
-    std::vector<uint32_t> newly_flipped_tris;
-    newly_flipped_tris.reserve(candidate.newly_fixed_adjacent_tris.size());
-    absl::c_copy(candidate.newly_flipped_adjacent_tris,
-                 std::back_inserter(newly_flipped_tris));
-    absl::c_sort(newly_flipped_tris);
-    absl::c_copy(newly_flipped_tris,
-                 std::back_inserter(data.flipped_tri_queue));
-  }
+  // The newly flipped triangles are already in increasing order, which keeps
+  // the algorithm deterministic.
+  absl::c_copy(candidate.newly_flipped_adjacent_tris,
+               std::back_inserter(data.flipped_tri_queue));
 }
 
-// Returns a map from vertex indices to positions for those vertices that need
-// be changed to preserve triangle winding post-quantization. In the event that
-// no correction can be found, this will return an empty map, allowing
+// Returns the positions, indexed by vertex, of those vertices that need be
+// changed to preserve triangle winding post-quantization; the other elements
+// are std::nullopt. If no vertices need to be changed, or in the event that no
+// correction can be found, this will return an empty vector, allowing
 // `MutableMesh::AsMeshes` to continue.
-absl::flat_hash_map<uint32_t, Point> GetCorrectedPackedVertexPositions(
-    const MutableMesh& mesh, const MeshAttributeCodingParams packing_params) {
+//
+// This runs in time linear in the size of the mesh, plus the size of the
+// neighborhoods of the flipped triangles. The initial passes over all of the
+// vertices and triangles are split into tasks that are run with
+// `parallel_for`.
+std::vector<std::optional<Point>> GetCorrectedPackedVertexPositions(
+    const MutableMesh& mesh, const MeshAttributeCodingParams packing_params,
+    ParallelFor parallel_for) {
   std::optional<SmallArray<uint8_t, 4>> bits_per_component =
       MeshFormat::PackedBitsPerComponent(
           mesh.Format().Attributes()[mesh.VertexPositionAttributeIndex()].type);
@@ -603,30 +676,25 @@ absl::flat_hash_map<uint32_t, Point> GetCorrectedPackedVertexPositions(
   // any triangles.
   if (!bits_per_component.has_value()) return {};
 
-  // If the mesh already has triangles with negative area, we don't attempt to
-  // correct quantization errors.
-  for (uint32_t tri_idx = 0; tri_idx < mesh.TriangleCount(); ++tri_idx) {
-    if (mesh.GetTriangle(tri_idx).SignedArea() < 0) {
-      return {};
-    }
-  }
-
   FlippedTriangleCorrectionData data = {
       .mesh = &mesh,
       .packing_params = &packing_params,
   };
-  PopulateQuantizedVertexPositions(data);
-  PopulateFlippedTris(data);
+  PopulateQuantizedVertexPositions(data, parallel_for);
+  // If the mesh already has triangles with negative area, we don't attempt to
+  // correct quantization errors.
+  if (!PopulateFlippedTris(data, parallel_for)) return {};
 
   // If no triangles were flipped, then we don't need to correct any vertices.
   if (data.flipped_tri_queue.empty()) return {};
 
-  PopulateAdjacentTriangleMap(data);
+  PopulateVertexTriangles(data);
   data.quantization_bounds =
       CalculateQuantizationBounds(data, *bits_per_component);
 
   // Iterator through the flipped triangles, nudging the vertices to try to
   // un-flip them.
+  std::vector<uint32_t> adjacent_tris;
   while (!data.flipped_tri_queue.empty()) {
     uint32_t tri_idx = data.flipped_tri_queue.front();
     data.flipped_tri_queue.pop_front();
@@ -643,10 +711,10 @@ absl::flat_hash_map<uint32_t, Point> GetCorrectedPackedVertexPositions(
       return {};
     }
 
-    size_t n_adjacent_flipped_tris = absl::c_count_if(
-        data.adjacent_triangles[tri_idx], [tri_idx, &data](uint32_t t) {
-          return t != tri_idx &&
-                 data.tri_flip_states[t] == TriFlipState::kFlipped;
+    GetAdjacentTriangles(data, tri_idx, adjacent_tris);
+    size_t n_adjacent_flipped_tris =
+        absl::c_count_if(adjacent_tris, [&data](uint32_t t) {
+          return data.tri_flip_states[t] == TriFlipState::kFlipped;
         });
 
     // Try to find the best change to correct this triangle.
@@ -655,7 +723,7 @@ absl::flat_hash_map<uint32_t, Point> GetCorrectedPackedVertexPositions(
     std::optional<NudgeCandidate> best_nudge;
     for (uint16_t nudge_bitmask : kNudgeDeltaBitMasks) {
       std::optional<NudgeCandidate> candidate = MaybeMakeNudgeCandidate(
-          tri_idx, indices, quantized_triangle, nudge_bitmask,
+          adjacent_tris, indices, quantized_triangle, nudge_bitmask,
           already_corrected_bitmask, nudge_vectors, data);
       if (!candidate.has_value()) {
         // Failed to make the candidate, likely because it flipped an
@@ -689,7 +757,8 @@ absl::flat_hash_map<uint32_t, Point> GetCorrectedPackedVertexPositions(
 
 absl::StatusOr<absl::InlinedVector<Mesh, 1>> MutableMesh::AsMeshes(
     absl::Span<const std::optional<MeshAttributeCodingParams>> packing_params,
-    absl::Span<const MeshFormat::AttributeId> omit_attributes) const {
+    absl::Span<const MeshFormat::AttributeId> omit_attributes,
+    ParallelFor parallel_for) const {
   uint32_t n_triangles = TriangleCount();
   if (n_triangles == 0) {
     // There's nothing to partition, just return an empty list.
@@ -725,10 +794,10 @@ absl::StatusOr<absl::InlinedVector<Mesh, 1>> MutableMesh::AsMeshes(
   // we have vertices.
   ABSL_DCHECK_GT(n_vertices, 0);
 
-  constexpr uint32_t kMaxVerticesPerPartition = 1 << 8 * Mesh::kBytesPerIndex;
   absl::InlinedVector<mesh_internal::PartitionInfo, 1> partitions =
-      mesh_internal::PartitionTriangles(index_data_, format_.GetIndexFormat(),
-                                        kMaxVerticesPerPartition);
+      mesh_internal::PartitionTriangles(
+          index_data_, format_.GetIndexFormat(),
+          MeshFormat::MaxPackedVertexCount(format_.GetIndexFormat()));
   absl::InlinedVector<mesh_internal::AttributeBoundsArray, 1>
       partition_attribute_bounds(partitions.size());
   for (size_t i = 0; i < partitions.size(); ++i) {
@@ -749,25 +818,30 @@ absl::StatusOr<absl::InlinedVector<Mesh, 1>> MutableMesh::AsMeshes(
 
   // TODO: b/283825926 - Try mitigating cases in which we cannot find a solution
   // for flipped triangles by retrying with a different scaling factor.
-  absl::flat_hash_map<uint32_t, Point> corrected_vertex_positions =
+  std::vector<std::optional<Point>> corrected_vertex_positions =
       GetCorrectedPackedVertexPositions(
-          *this, (*packing_params_array)[new_format->PositionAttributeIndex()]);
+          *this, (*packing_params_array)[new_format->PositionAttributeIndex()],
+          parallel_for);
 
+  mesh_internal::VertexPackingPlan packing_plan =
+      mesh_internal::MakeVertexPackingPlan(format_, omit_set,
+                                           *packing_params_array);
   absl::InlinedVector<Mesh, 1> meshes;
   for (size_t partition_idx = 0; partition_idx < partitions.size();
        ++partition_idx) {
     const mesh_internal::PartitionInfo& partition = partitions[partition_idx];
     std::vector<std::byte> partition_vertex_data =
         mesh_internal::CopyAndPackPartitionVertices(
-            vertex_data_, partition.vertex_indices, format_, omit_set,
-            *packing_params_array, corrected_vertex_positions);
+            vertex_data_, partition.vertex_indices, packing_plan,
+            corrected_vertex_positions);
 
+    uint8_t index_stride = new_format->PackedIndexStride();
     std::vector<std::byte> partition_index_data(3 * partition.triangles.size() *
-                                                Mesh::kBytesPerIndex);
+                                                index_stride);
     for (uint32_t tri_idx = 0; tri_idx < partition.triangles.size();
          ++tri_idx) {
       mesh_internal::WriteTriangleIndicesToByteArray(
-          tri_idx, Mesh::kBytesPerIndex, partition.triangles[tri_idx],
+          tri_idx, index_stride, partition.triangles[tri_idx],
           partition_index_data);
     }
 
@@ -32,6 +32,7 @@
 #include "ink/geometry/mesh_packing_types.h"
 #include "ink/geometry/point.h"
 #include "ink/geometry/triangle.h"
+#include "ink/types/parallel_for.h"
 #include "ink/types/small_array.h"
 
 namespace ink {
@@ -261,7 +262,8 @@ class MutableMesh {
   //
   // Depending on the format, this may be a lossy copy. The returned mesh may be
   // partitioned into multiple sub-meshes if this mesh is larger than can be
-  // represented by the index format. Vertices that are not referenced by any
+  // represented by the index format's packed indices (more than 2^16 vertices
+  // for `k32BitUnpacked16BitPacked`). Vertices that are not referenced by any
   // triangle will be stripped from the returned meshes.
   //
   // If the format is lossy, and if all triangles have non-negative area before
@@ -273,6 +275,10 @@ class MutableMesh {
   // `MeshFormat::AttributeType`). Note that this does not always succeed, so
   // the result may still contain triangles with negative area.
   //
+  // Optional argument `parallel_for` is used to distribute the passes over all
+  // of the vertices and triangles that detect such triangles; see
+  // `ParallelFor` for details.
+  //
   // Returns an error if:
   // - `ValidateTriangleIndices` fails
   // - Any attribute value is non-finite
@@ -288,7 +294,8 @@ class MutableMesh {
   absl::StatusOr<absl::InlinedVector<Mesh, 1>> AsMeshes(
       absl::Span<const std::optional<MeshAttributeCodingParams>>
           packing_params = {},
-      absl::Span<const MeshFormat::AttributeId> omit_attributes = {}) const;
+      absl::Span<const MeshFormat::AttributeId> omit_attributes = {},
+      ParallelFor parallel_for = RunSerially) const;
 
   // Returns the format of the mesh.
   const MeshFormat& Format() const { return format_; }
@@ -0,0 +1,184 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "absl/container/inlined_vector.h"
+#include "absl/functional/function_ref.h"
+#include "absl/log/absl_check.h"
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "benchmark/benchmark.h"
+#include "ink/geometry/mesh.h"
+#include "ink/geometry/mesh_format.h"
+#include "ink/geometry/mesh_packing_types.h"
+#include "ink/geometry/mutable_mesh.h"
+#include "ink/geometry/point.h"
+#include "ink/geometry/triangle.h"
+#include "ink/types/parallel_for.h"
+
+namespace ink {
+namespace {
+
+constexpr uint32_t kColumnCount = 256;
+
+// Returns a mesh of `n_rows` x `kColumnCount` long, thin quads, each split
+// into two triangles, on a rotated grid with randomly jittered vertices. The
+// mesh also has one large triangle that stretches the bounds to [0, 4095] in
+// each dimension, so that with `kFloat2PackedIn1Float` positions, which have
+// 12 bits per component, the quantization step is 1. The quads are 4 steps
+// long and 0.4 steps wide, so quantization flips about 7% of the triangles,
+// all of which can be corrected.
+MutableMesh MakeDenseSliverMesh(uint32_t n_rows) {
+  absl::StatusOr<MeshFormat> format = MeshFormat::Create(
+      {{MeshFormat::AttributeType::kFloat2PackedIn1Float,
+        MeshFormat::AttributeId::kPosition}},
+      MeshFormat::IndexFormat::k32BitUnpacked16BitPacked);
+  ABSL_CHECK_OK(format);
+  MutableMesh mesh(*format);
+  mesh.AppendVertex({0, 0});
+  mesh.AppendVertex({4095, 0});
+  mesh.AppendVertex({4095, 4095});
+  mesh.AppendTriangleIndices({0, 1, 2});
+
+  // A simple linear congruential generator keeps the mesh the same across runs
+  // and standard library implementations. The jitter is small enough that none
+  // of the triangles have negative area before quantization.
+  uint32_t seed = 1;
+  auto jitter = [&seed]() {
+    seed = seed * 1664525 + 1013904223;
+    return 0.2f * (2 * static_cast<float>(seed >> 8) / (1 << 24) - 1);
+  };
+  constexpr float kLength = 4;
+  constexpr float kWidth = 0.4;
+  const float cos_angle = std::cos(0.3f);
+  const float sin_angle = std::sin(0.3f);
+  uint32_t first_vertex = mesh.VertexCount();
+  for (uint32_t row = 0; row <= n_rows; ++row) {
+    for (uint32_t column = 0; column <= kColumnCount; ++column) {
+      float u = kLength * (column + jitter());
+      float v = kWidth * (row + jitter());
+      mesh.AppendVertex({100 + u * cos_angle - v * sin_angle,
+                         100 + u * sin_angle + v * cos_angle});
+    }
+  }
+  for (uint32_t row = 0; row < n_rows; ++row) {
+    for (uint32_t column = 0; column < kColumnCount; ++column) {
+      uint32_t v00 = first_vertex + row * (kColumnCount + 1) + column;
+      uint32_t v10 = v00 + 1;
+      uint32_t v01 = v00 + kColumnCount + 1;
+      uint32_t v11 = v01 + 1;
+      mesh.AppendTriangleIndices({v00, v10, v11});
+      mesh.AppendTriangleIndices({v00, v11, v01});
+    }
+  }
+  return mesh;
+}
+
+// Returns the number of triangles of `mesh` that would have negative area if
+// their vertex positions were quantized with `packing_params`, without any
+// correction.
+int CountTrianglesFlippedByQuantization(
+    const MutableMesh& mesh, const MeshAttributeCodingParams& packing_params) {
+  auto quantize = [&packing_params](Point p) {
+    return Point{std::round((p.x - packing_params.components[0].offset) /
+                            packing_params.components[0].scale),
+                 std::round((p.y - packing_params.components[1].offset) /
+                            packing_params.components[1].scale)};
+  };
+  int count = 0;
+  for (uint32_t i = 0; i < mesh.TriangleCount(); ++i) {
+    Triangle triangle = mesh.GetTriangle(i);
+    if (Triangle{quantize(triangle.p0), quantize(triangle.p1),
+                 quantize(triangle.p2)}
+            .SignedArea() < 0) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+// Returns the number of triangles in `meshes` that have negative area.
+int CountNegativeAreaTriangles(absl::Span<const Mesh> meshes) {
+  int count = 0;
+  for (const Mesh& mesh : meshes) {
+    for (uint32_t i = 0; i < mesh.TriangleCount(); ++i) {
+      if (mesh.GetTriangle(i).SignedArea() < 0) ++count;
+    }
+  }
+  return count;
+}
+
+// Runs the tasks on `num_threads` threads (including the calling one), each of
+// which repeatedly claims the next unclaimed task.
+class ThreadsParallelFor {
+ public:
+  explicit ThreadsParallelFor(int num_threads) : num_threads_(num_threads) {}
+
+  void operator()(uint32_t n_tasks,
+                  absl::FunctionRef<void(uint32_t)> task) const {
+    std::atomic<uint32_t> next_task = 0;
+    auto run_tasks = [&next_task, n_tasks, task]() {
+      for (uint32_t i = next_task++; i < n_tasks; i = next_task++) task(i);
+    };
+    std::vector<std::thread> threads;
+    for (int i = 1; i < num_threads_; ++i) threads.emplace_back(run_tasks);
+    run_tasks();
+    for (std::thread& thread : threads) thread.join();
+  }
+
+ private:
+  int num_threads_;
+};
+
+// Packs a dense mesh of `state.range(0)` rows in which quantization flips many
+// triangles, reporting how many triangles needed correction and how many were
+// left uncorrected as counters.
+void RunAsMeshesWithFlippedTrianglesBenchmark(benchmark::State& state,
+                                              ParallelFor parallel_for) {
+  MutableMesh mesh = MakeDenseSliverMesh(state.range(0));
+  for (auto s : state) {
+    benchmark::DoNotOptimize(mesh.AsMeshes({}, {}, parallel_for));
+  }
+  state.SetItemsProcessed(state.iterations() * mesh.TriangleCount());
+
+  absl::StatusOr<absl::InlinedVector<Mesh, 1>> meshes =
+      mesh.AsMeshes({}, {}, parallel_for);
+  ABSL_CHECK_OK(meshes);
+  state.counters["flipped_triangles"] = CountTrianglesFlippedByQuantization(
+      mesh, meshes->front().VertexAttributeUnpackingParams(
+                mesh.VertexPositionAttributeIndex()));
+  state.counters["uncorrected_triangles"] = CountNegativeAreaTriangles(*meshes);
+}
+
+void BM_AsMeshesWithFlippedTriangles(benchmark::State& state) {
+  RunAsMeshesWithFlippedTrianglesBenchmark(state, RunSerially);
+}
+BENCHMARK(BM_AsMeshesWithFlippedTriangles)->Arg(16)->Arg(64)->Arg(255);
+
+void BM_AsMeshesWithFlippedTrianglesWithThreads(benchmark::State& state) {
+  RunAsMeshesWithFlippedTrianglesBenchmark(state, ThreadsParallelFor(4));
+}
+BENCHMARK(BM_AsMeshesWithFlippedTrianglesWithThreads)
+    ->Arg(16)
+    ->Arg(64)
+    ->Arg(255)
+    ->UseRealTime();
+
+}  // namespace
+}  // namespace ink
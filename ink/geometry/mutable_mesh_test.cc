@@ -21,12 +21,14 @@
 #include <cstring>
 #include <limits>
 #include <optional>
+#include <thread>  // NOLINT(build/c++11)
 #include <vector>
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "fuzztest/fuzztest.h"
 #include "absl/container/inlined_vector.h"
+#include "absl/functional/function_ref.h"
 #include "absl/status/status.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/substitute.h"
@@ -979,6 +981,27 @@ TEST(MutableMeshTest, FromMeshCopiesAllIndexBytes) {
   EXPECT_THAT(mutable_mesh.TriangleIndices(0), ElementsAre(0, 1, 0x0101));
 }
 
+TEST(MutableMeshTest, FromMeshWith32BitPackedIndices) {
+  // The smallest index with a `1` in each of its four bytes is 0x01010101,
+  // which would need too many vertices, so this checks the upper two bytes
+  // with 0x010101 instead.
+  std::vector<float> position_placeholder(0x010102, 0);
+  absl::StatusOr<Mesh> mesh = Mesh::Create(
+      *MeshFormat::Create({{MeshFormat::AttributeType::kFloat2Unpacked,
+                            MeshFormat::AttributeId::kPosition}},
+                          MeshFormat::IndexFormat::k32BitUnpacked32BitPacked),
+      {// Position
+       position_placeholder, position_placeholder},
+      // Triangles
+      {0, 0x0101, 0x010101});
+  ASSERT_EQ(mesh.status(), absl::OkStatus());
+
+  MutableMesh mutable_mesh = MutableMesh::FromMesh(*mesh);
+
+  EXPECT_THAT(mutable_mesh.TriangleIndices(0),
+              ElementsAre(0, 0x0101, 0x010101));
+}
+
 TEST(MutableMeshTest, AsMeshesEmpty) {
   auto empty_meshes = MutableMesh().AsMeshes();
   ASSERT_EQ(empty_meshes.status(), absl::OkStatus());
@@ -1172,6 +1195,28 @@ TEST(MutableMeshTest, AsMeshes16BitReturnsMultiplePartitionsForLargeMesh) {
               EnvelopeEq(Rect::FromTwoPoints({65534, -1}, {100001, 0})));
 }
 
+TEST(MutableMeshTest, AsMeshes32BitPackedReturnsSingleMeshForLargeMesh) {
+  absl::StatusOr<MeshFormat> format =
+      MeshFormat::Create({{MeshFormat::AttributeType::kFloat2Unpacked,
+                           MeshFormat::AttributeId::kPosition}},
+                         MeshFormat::IndexFormat::k32BitUnpacked32BitPacked);
+  ASSERT_EQ(format.status(), absl::OkStatus());
+  MutableMesh m = MakeStraightLineMutableMesh(1e5, *format);
+
+  absl::StatusOr<absl::InlinedVector<Mesh, 1>> meshes = m.AsMeshes();
+  ASSERT_EQ(meshes.status(), absl::OkStatus());
+
+  ASSERT_EQ(meshes->size(), 1);
+  EXPECT_THAT((*meshes)[0].Format(), MeshFormatEq(*format));
+  EXPECT_EQ((*meshes)[0].IndexStride(), 4);
+  EXPECT_EQ((*meshes)[0].VertexCount(), 100002);
+  EXPECT_EQ((*meshes)[0].TriangleCount(), 100000);
+  EXPECT_THAT((*meshes)[0].GetTriangle(99999),
+              TriangleEq(m.GetTriangle(99999)));
+  EXPECT_THAT((*meshes)[0].Bounds(),
+              EnvelopeEq(Rect::FromTwoPoints({0, -1}, {100001, 0})));
+}
+
 TEST(MutableMeshTest, AsMeshesPartitionsUseSameUnpackingParams) {
   MutableMesh m =
       MakeStraightLineMutableMesh(1e5, MakeSinglePackedPositionFormat());
@@ -1880,6 +1925,90 @@ TEST(MutableMeshTest,
   EXPECT_THAT(*meshes, Not(Each(MeshTrianglesHaveNonNegativeArea())));
 }
 
+// Returns a mesh with enough triangles to be split across several tasks of a
+// `ParallelFor`, many of which are flipped by quantization. If
+// `negative_area_triangle` is given, the triangle at that index is replaced by
+// one that already has negative area before quantization.
+MutableMesh MakeLargeMeshWithFlippedTriangles(
+    std::optional<uint32_t> negative_area_triangle = std::nullopt) {
+  constexpr uint32_t kTriangleCount = 10'000;
+  MutableMesh m(MakeSinglePackedPositionFormat());
+  m.AppendVertex({0, 0});
+  m.AppendVertex({4095, 0});
+  m.AppendVertex({4095, 4095});
+  m.AppendTriangleIndices({0, 1, 2});
+  for (uint32_t i = 1; i < kTriangleCount; ++i) {
+    // Shifting by a whole number doesn't change how the vertices are
+    // quantized, so every third triangle is flipped, as in
+    // AsMeshesCorrectsSingleFlippedTriangle.
+    float shift = i % 97;
+    uint32_t first_vertex = m.VertexCount();
+    if (negative_area_triangle == i) {
+      m.AppendVertex({shift, 0});
+      m.AppendVertex({shift, 10});
+      m.AppendVertex({shift + 10, 0});
+    } else if (i % 3 == 0) {
+      m.AppendVertex({shift + 0.4f, 0.6f});
+      m.AppendVertex({shift + 3967.4f, 4094.6f});
+      m.AppendVertex({shift + 793.73f, 819.47f});
+    } else {
+      m.AppendVertex({shift, 0});
+      m.AppendVertex({shift + 10, 0});
+      m.AppendVertex({shift, 10});
+    }
+    m.AppendTriangleIndices({first_vertex, first_vertex + 1, first_vertex + 2});
+  }
+  return m;
+}
+
+// Runs each task on its own thread, in reverse order of starting.
+void RunOnThreadsInReverse(uint32_t n_tasks,
+                           absl::FunctionRef<void(uint32_t)> task) {
+  std::vector<std::thread> threads;
+  threads.reserve(n_tasks);
+  for (uint32_t i = n_tasks; i > 0; --i) {
+    threads.emplace_back([&task, i]() { task(i - 1); });
+  }
+  for (std::thread& t : threads) t.join();
+}
+
+TEST(MutableMeshTest, AsMeshesWithParallelForMatchesRunSerially) {
+  MutableMesh m = MakeLargeMeshWithFlippedTriangles();
+
+  absl::StatusOr<absl::InlinedVector<Mesh, 1>> serial_meshes = m.AsMeshes();
+  ASSERT_EQ(serial_meshes.status(), absl::OkStatus());
+  absl::StatusOr<absl::InlinedVector<Mesh, 1>> parallel_meshes =
+      m.AsMeshes({}, {}, RunOnThreadsInReverse);
+  ASSERT_EQ(parallel_meshes.status(), absl::OkStatus());
+
+  EXPECT_THAT(*serial_meshes, Each(MeshTrianglesHaveNonNegativeArea()));
+  ASSERT_EQ(parallel_meshes->size(), serial_meshes->size());
+  for (size_t i = 0; i < serial_meshes->size(); ++i) {
+    EXPECT_THAT((*parallel_meshes)[i], MeshEq((*serial_meshes)[i]));
+  }
+}
+
+TEST(MutableMeshTest,
+     AsMeshesWithParallelForMatchesRunSeriallyWithNegativeAreaTriangle) {
+  // The negative-area triangle is in the third task, so the tasks before it
+  // have already classified their triangles when it is found, and those
+  // classifications must be discarded.
+  MutableMesh m = MakeLargeMeshWithFlippedTriangles(9'001);
+
+  absl::StatusOr<absl::InlinedVector<Mesh, 1>> serial_meshes = m.AsMeshes();
+  ASSERT_EQ(serial_meshes.status(), absl::OkStatus());
+  absl::StatusOr<absl::InlinedVector<Mesh, 1>> parallel_meshes =
+      m.AsMeshes({}, {}, RunOnThreadsInReverse);
+  ASSERT_EQ(parallel_meshes.status(), absl::OkStatus());
+
+  // No correction is attempted, so the flipped triangles are left as they are.
+  EXPECT_THAT(*serial_meshes, Not(Each(MeshTrianglesHaveNonNegativeArea())));
+  ASSERT_EQ(parallel_meshes->size(), serial_meshes->size());
+  for (size_t i = 0; i < serial_meshes->size(); ++i) {
+    EXPECT_THAT((*parallel_meshes)[i], MeshEq((*serial_meshes)[i]));
+  }
+}
+
 TEST(MutableMeshTest, AsMeshesOmitAttribute) {
   absl::StatusOr<MeshFormat> original_format =
       MeshFormat::Create({{MeshFormat::AttributeType::kFloat3PackedIn2Floats,
@@ -14,6 +14,7 @@
 
 #include "ink/geometry/partitioned_mesh.h"
 
+#include <array>
 #include <cstddef>
 #include <cstdint>
 #include <cstdlib>
@@ -23,6 +24,7 @@
 #include <utility>
 #include <vector>
 
+#include "absl/algorithm/container.h"
 #include "absl/base/nullability.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/inlined_vector.h"
@@ -36,9 +38,11 @@
 #include "ink/geometry/affine_transform.h"
 #include "ink/geometry/envelope.h"
 #include "ink/geometry/internal/algorithms.h"
+#include "ink/geometry/internal/distance_internal.h"
 #include "ink/geometry/internal/intersects_internal.h"
 #include "ink/geometry/internal/mesh_packing.h"
 #include "ink/geometry/internal/static_rtree.h"
+#include "ink/geometry/internal/vertex_cache_optimization.h"
 #include "ink/geometry/mesh.h"
 #include "ink/geometry/mesh_format.h"
 #include "ink/geometry/mesh_packing_types.h"
@@ -48,12 +52,77 @@
 #include "ink/geometry/rect.h"
 #include "ink/geometry/segment.h"
 #include "ink/geometry/triangle.h"
+#include "ink/types/parallel_for.h"
 
 namespace ink {
 
-// Convenience alias for the R-Tree.
-using RTree =
-    geometry_internal::StaticRTree<PartitionedMesh::TriangleIndexPair>;
+// Convenience alias for the R-Tree. Its elements are the indices of the
+// triangles among all of the triangles of all of the meshes, rather than
+// `TriangleIndexPair`s, so that each element is 4 bytes; see
+// `ToTriangleIndexPair`.
+using RTree = geometry_internal::StaticRTree<uint32_t>;
+
+namespace {
+
+// Returns the `TriangleIndexPair` for `element` of the R-Tree, using the index
+// of the first triangle of each mesh, as returned by
+// `Data::MeshFirstTriangleIndices`.
+PartitionedMesh::TriangleIndexPair ToTriangleIndexPair(
+    absl::Span<const uint32_t> mesh_first_triangle_indices, uint32_t element) {
+  // Most `PartitionedMesh`es only have a single mesh.
+  if (mesh_first_triangle_indices.size() == 1) {
+    return {.mesh_index = 0, .triangle_index = element};
+  }
+  // Every mesh has at least one triangle, so the first triangle indices are
+  // strictly increasing.
+  auto mesh = absl::c_upper_bound(mesh_first_triangle_indices, element) - 1;
+  return {.mesh_index = static_cast<uint16_t>(
+              mesh - mesh_first_triangle_indices.begin()),
+          .triangle_index = element - *mesh};
+}
+
+// Returns the positions of the vertices of each of `meshes`, decoded in bulk,
+// for use by scans over every triangle of the meshes.
+std::vector<std::vector<Point>> DecodeVertexPositions(
+    absl::Span<const Mesh> meshes) {
+  std::vector<std::vector<Point>> positions(meshes.size());
+  for (size_t i = 0; i < meshes.size(); ++i) {
+    positions[i].resize(meshes[i].VertexCount());
+    meshes[i].DecodePositions(absl::MakeSpan(positions[i]));
+  }
+  return positions;
+}
+
+// Returns the triangle at `triangle_index` in `mesh`, using the decoded vertex
+// `positions` of the mesh. This is equivalent to
+// `mesh.GetTriangle(triangle_index)`.
+Triangle GetDecodedTriangle(const Mesh& mesh, absl::Span<const Point> positions,
+                            uint32_t triangle_index) {
+  std::array<uint32_t, 3> vertex_indices = mesh.TriangleIndices(triangle_index);
+  return {.p0 = positions[vertex_indices[0]],
+          .p1 = positions[vertex_indices[1]],
+          .p2 = positions[vertex_indices[2]]};
+}
+
+// Returns a copy of `mesh` with its triangles in the order given by
+// `mesh_internal::OptimizeTriangleOrderForVertexCache`. The vertices are left
+// as-is; `MutableMesh::AsMeshes` renumbers them in order of first use.
+MutableMesh WithOptimizedTriangleOrder(const MutableMesh& mesh) {
+  std::vector<std::array<uint32_t, 3>> triangles(mesh.TriangleCount());
+  for (uint32_t i = 0; i < triangles.size(); ++i) {
+    triangles[i] = mesh.TriangleIndices(i);
+  }
+  std::vector<uint32_t> order =
+      mesh_internal::OptimizeTriangleOrderForVertexCache(triangles,
+                                                         mesh.VertexCount());
+  MutableMesh reordered = mesh.Clone();
+  for (uint32_t i = 0; i < order.size(); ++i) {
+    reordered.SetTriangleIndices(i, triangles[order[i]]);
+  }
+  return reordered;
+}
+
+}  // namespace
 
 PartitionedMesh PartitionedMesh::WithEmptyGroups(uint32_t num_groups) {
   return *PartitionedMesh::FromMeshGroups(std::vector<MeshGroup>(num_groups));
@@ -90,7 +159,12 @@ absl::StatusOr<PartitionedMesh> PartitionedMesh::FromMutableMeshGroups(
   mesh_groups.reserve(groups.size());
 
   for (const MutableMeshGroup& group : groups) {
-    const MutableMesh& mesh = *group.mesh;
+    std::optional<MutableMesh> reordered_mesh;
+    if (group.optimize_triangle_order) {
+      reordered_mesh = WithOptimizedTriangleOrder(*group.mesh);
+    }
+    const MutableMesh& mesh =
+        reordered_mesh.has_value() ? *reordered_mesh : *group.mesh;
     absl::Span<const absl::Span<const uint32_t>> outlines = group.outlines;
 
     all_partitioned_outlines.emplace_back();
@@ -127,11 +201,11 @@ absl::StatusOr<PartitionedMesh> PartitionedMesh::FromMutableMeshGroups(
     // `MutableMesh` is changed to always use 16-bit indices (b/295166196),
     // there will be no need to do partitioning, and this code can be deleted.
     if (!outlines.empty()) {
-      constexpr uint32_t kMaxVerticesPerPartition = 1 << (8 * sizeof(uint16_t));
+      // This must match the partitioning done by `MutableMesh::AsMeshes`.
       absl::InlinedVector<mesh_internal::PartitionInfo, 1> partitions =
-          mesh_internal::PartitionTriangles(mesh.RawIndexData(),
-                                            mesh.Format().GetIndexFormat(),
-                                            kMaxVerticesPerPartition);
+          mesh_internal::PartitionTriangles(
+              mesh.RawIndexData(), mesh.Format().GetIndexFormat(),
+              MeshFormat::MaxPackedVertexCount(mesh.Format().GetIndexFormat()));
       absl::flat_hash_map<uint32_t, VertexIndexPair> partition_map;
       partition_map.reserve(mesh.VertexCount());
       for (size_t p_idx = 0; p_idx < partitions.size(); ++p_idx) {
@@ -144,7 +218,7 @@ absl::StatusOr<PartitionedMesh> PartitionedMesh::FromMutableMeshGroups(
           partition_map.insert(
               {vertex_indices[v_idx],
                {.mesh_index = static_cast<uint16_t>(p_idx),
-                .vertex_index = static_cast<uint16_t>(v_idx)}});
+                .vertex_index = static_cast<uint32_t>(v_idx)}});
         }
       }
 
@@ -198,9 +272,13 @@ absl::StatusOr<absl::Nonnull<std::unique_ptr<PartitionedMesh::Data>>>
 PartitionedMesh::Data::FromMeshGroups(absl::Span<const MeshGroup> groups) {
   size_t total_meshes = 0;
   size_t total_outlines = 0;
+  uint64_t total_triangles = 0;
   for (const MeshGroup& group : groups) {
     total_meshes += group.meshes.size();
     total_outlines += group.outlines.size();
+    for (const Mesh& mesh : group.meshes) {
+      total_triangles += mesh.TriangleCount();
+    }
   }
   if (total_meshes > std::numeric_limits<uint16_t>::max()) {
     return absl::InvalidArgumentError(absl::Substitute(
@@ -208,6 +286,14 @@ PartitionedMesh::Data::FromMeshGroups(absl::Span<const MeshGroup> groups) {
         "2^16 (65536) meshes ($0 meshes given)",
         total_meshes));
   }
+  // The spatial index refers to each triangle by its index among all of the
+  // triangles of all of the meshes, which must fit in a `uint32_t`.
+  if (total_triangles > std::numeric_limits<uint32_t>::max()) {
+    return absl::InvalidArgumentError(absl::Substitute(
+        "Too many triangles; PartitionedMesh supports a maximum of "
+        "2^32 - 1 triangles across all meshes ($0 triangles given)",
+        total_triangles));
+  }
 
   absl::InlinedVector<MeshFormat, 1> group_formats;
   group_formats.reserve(groups.size());
@@ -265,6 +351,7 @@ PartitionedMesh::Data::FromMeshGroups(absl::Span<const MeshGroup> groups) {
 
   auto data = std::make_unique<PartitionedMesh::Data>();
   data->meshes_.reserve(total_meshes);
+  data->mesh_first_triangle_indices_.reserve(total_meshes);
   data->outlines_.reserve(total_outlines);
   data->group_first_mesh_indices_.reserve(groups.size());
   data->group_first_outline_indices_.reserve(groups.size());
@@ -273,8 +360,13 @@ PartitionedMesh::Data::FromMeshGroups(absl::Span<const MeshGroup> groups) {
   for (const MeshGroup& group : groups) {
     uint16_t group_first_mesh_index = data->meshes_.size();
     data->group_first_mesh_indices_.push_back(group_first_mesh_index);
-    data->meshes_.insert(data->meshes_.end(), group.meshes.begin(),
-                         group.meshes.end());
+    for (const Mesh& mesh : group.meshes) {
+      data->mesh_first_triangle_indices_.push_back(
+          data->meshes_.empty() ? 0
+                                : data->mesh_first_triangle_indices_.back() +
+                                      data->meshes_.back().TriangleCount());
+      data->meshes_.push_back(mesh);
+    }
     uint32_t group_first_outline_index = data->outlines_.size();
     data->group_first_outline_indices_.push_back(group_first_outline_index);
     for (absl::Span<const VertexIndexPair> outline : group.outlines) {
@@ -286,6 +378,100 @@ PartitionedMesh::Data::FromMeshGroups(absl::Span<const MeshGroup> groups) {
   return std::move(data);
 }
 
+void PartitionedMesh::InitializeSpatialIndices(
+    absl::Span<PartitionedMesh> meshes, ParallelFor parallel_for) {
+  // A single index can make use of `parallel_for` itself. Otherwise, we build
+  // one index per task; the indices are built serially within each task, since
+  // a task must not wait on other tasks.
+  if (meshes.size() == 1) {
+    meshes.front().InitializeSpatialIndex(parallel_for);
+    return;
+  }
+  parallel_for(meshes.size(), [meshes](uint32_t i) {
+    meshes[i].InitializeSpatialIndex();
+  });
+}
+
+std::vector<std::byte> PartitionedMesh::SerializeSpatialIndex() const {
+  if (!data_) return {};
+
+  return data_->SpatialIndex().Serialize();
+}
+
+absl::Status PartitionedMesh::InitializeSpatialIndexFromSerialized(
+    absl::Span<const std::byte> serialized_index,
+    SerializedSpatialIndexCheck check) {
+  if (!data_) {
+    if (serialized_index.empty()) return absl::OkStatus();
+    return absl::InvalidArgumentError(
+        "Non-empty serialized spatial index given for a `PartitionedMesh` "
+        "with no meshes");
+  }
+
+  absl::Span<const Mesh> meshes = data_->Meshes();
+  absl::Span<const uint32_t> mesh_first_triangle_indices =
+      data_->MeshFirstTriangleIndices();
+  uint32_t n_tris = meshes.empty() ? 0
+                                   : mesh_first_triangle_indices.back() +
+                                         meshes.back().TriangleCount();
+  std::vector<bool> is_triangle_present(n_tris, false);
+  bool check_bounds =
+      check == SerializedSpatialIndexCheck::kStructureAndBounds;
+  std::vector<std::vector<Point>> positions;
+  if (check_bounds) positions = DecodeVertexPositions(meshes);
+  auto validate_triangle = [meshes, mesh_first_triangle_indices, n_tris,
+                            &is_triangle_present, check_bounds,
+                            &positions](uint32_t element,
+                                        const Rect& bounds) -> absl::Status {
+    if (element >= n_tris) {
+      return absl::InvalidArgumentError(absl::Substitute(
+          "Serialized spatial index contains a non-existent triangle: index "
+          "$0 (triangles: $1)",
+          element, n_tris));
+    }
+    TriangleIndexPair idx =
+        ToTriangleIndexPair(mesh_first_triangle_indices, element);
+    std::vector<bool>::reference is_present = is_triangle_present[element];
+    if (is_present) {
+      return absl::InvalidArgumentError(absl::Substitute(
+          "Serialized spatial index contains a duplicate triangle: mesh index "
+          "$0, triangle index $1",
+          idx.mesh_index, idx.triangle_index));
+    }
+    is_present = true;
+    if (!check_bounds) return absl::OkStatus();
+    Rect triangle_bounds =
+        *Envelope(GetDecodedTriangle(meshes[idx.mesh_index],
+                                     positions[idx.mesh_index],
+                                     idx.triangle_index))
+             .AsRect();
+    if (bounds.XMin() != triangle_bounds.XMin() ||
+        bounds.YMin() != triangle_bounds.YMin() ||
+        bounds.XMax() != triangle_bounds.XMax() ||
+        bounds.YMax() != triangle_bounds.YMax()) {
+      return absl::InvalidArgumentError(absl::Substitute(
+          "Serialized spatial index has the wrong bounds for triangle: mesh "
+          "index $0, triangle index $1",
+          idx.mesh_index, idx.triangle_index));
+    }
+    return absl::OkStatus();
+  };
+
+  absl::StatusOr<RTree> rtree =
+      RTree::FromSerialized(serialized_index, validate_triangle);
+  if (!rtree.ok()) return rtree.status();
+  // Since every triangle in the index is distinct, this means that every
+  // triangle is present.
+  if (rtree->Elements().size() != n_tris) {
+    return absl::InvalidArgumentError(absl::Substitute(
+        "Serialized spatial index contains $0 triangles, expected $1",
+        rtree->Elements().size(), n_tris));
+  }
+
+  data_->SetSpatialIndexIfUninitialized(*std::move(rtree));
+  return absl::OkStatus();
+}
+
 Envelope PartitionedMesh::Bounds() const {
   if (data_ == nullptr) return {};
   Envelope bounds;
@@ -306,12 +492,15 @@ void VisitIntersectedTrianglesHelper(
         PartitionedMesh::FlowControl(PartitionedMesh::TriangleIndexPair)>
         visitor,
     const AffineTransform& query_to_this, absl::Span<const Mesh> meshes,
+    absl::Span<const uint32_t> mesh_first_triangle_indices,
     const RTree& rtree) {
   // This is an `auto` instead of `QueryType` because the `Rect` overload of
   // `AffineTransform::Apply` returns a `Quad`, not a `Rect`.
   auto transformed_query = query_to_this.Apply(query);
-  auto visitor_wrapper = [transformed_query, visitor,
-                          &meshes](PartitionedMesh::TriangleIndexPair index) {
+  auto visitor_wrapper = [transformed_query, visitor, &meshes,
+                          mesh_first_triangle_indices](uint32_t element) {
+    PartitionedMesh::TriangleIndexPair index =
+        ToTriangleIndexPair(mesh_first_triangle_indices, element);
     if (!geometry_internal::IntersectsInternal(
             transformed_query,
             meshes[index.mesh_index].GetTriangle(index.triangle_index))) {
@@ -331,7 +520,9 @@ void PartitionedMesh::VisitIntersectedTriangles(
   if (!data_) return;
 
   VisitIntersectedTrianglesHelper(query, visitor, query_to_this,
-                                  data_->Meshes(), data_->SpatialIndex());
+                                  data_->Meshes(),
+                                  data_->MeshFirstTriangleIndices(),
+                                  data_->SpatialIndex());
 }
 
 void PartitionedMesh::VisitIntersectedTriangles(
@@ -341,7 +532,9 @@ void PartitionedMesh::VisitIntersectedTriangles(
   if (!data_) return;
 
   VisitIntersectedTrianglesHelper(query, visitor, query_to_this,
-                                  data_->Meshes(), data_->SpatialIndex());
+                                  data_->Meshes(),
+                                  data_->MeshFirstTriangleIndices(),
+                                  data_->SpatialIndex());
 }
 
 void PartitionedMesh::VisitIntersectedTriangles(
@@ -351,7 +544,9 @@ void PartitionedMesh::VisitIntersectedTriangles(
   if (!data_) return;
 
   VisitIntersectedTrianglesHelper(query, visitor, query_to_this,
-                                  data_->Meshes(), data_->SpatialIndex());
+                                  data_->Meshes(),
+                                  data_->MeshFirstTriangleIndices(),
+                                  data_->SpatialIndex());
 }
 
 void PartitionedMesh::VisitIntersectedTriangles(
@@ -361,7 +556,9 @@ void PartitionedMesh::VisitIntersectedTriangles(
   if (!data_) return;
 
   VisitIntersectedTrianglesHelper(query, visitor, query_to_this,
-                                  data_->Meshes(), data_->SpatialIndex());
+                                  data_->Meshes(),
+                                  data_->MeshFirstTriangleIndices(),
+                                  data_->SpatialIndex());
 }
 
 void PartitionedMesh::VisitIntersectedTriangles(
@@ -371,7 +568,70 @@ void PartitionedMesh::VisitIntersectedTriangles(
   if (!data_) return;
 
   VisitIntersectedTrianglesHelper(query, visitor, query_to_this,
-                                  data_->Meshes(), data_->SpatialIndex());
+                                  data_->Meshes(),
+                                  data_->MeshFirstTriangleIndices(),
+                                  data_->SpatialIndex());
+}
+
+namespace {
+
+// This is a helper function for `VisitIntersectedTrianglesBatch` that handles
+// the type-independent logic.
+template <typename QueryType>
+void VisitIntersectedTrianglesBatchHelper(
+    absl::Span<const QueryType> queries,
+    absl::FunctionRef<PartitionedMesh::FlowControl(
+        uint32_t, PartitionedMesh::TriangleIndexPair)>
+        visitor,
+    const AffineTransform& query_to_this, absl::Span<const Mesh> meshes,
+    absl::Span<const uint32_t> mesh_first_triangle_indices,
+    const RTree& rtree) {
+  std::vector<QueryType> transformed_queries;
+  std::vector<Rect> query_bounds;
+  transformed_queries.reserve(queries.size());
+  query_bounds.reserve(queries.size());
+  for (const QueryType& query : queries) {
+    transformed_queries.push_back(query_to_this.Apply(query));
+    query_bounds.push_back(*Envelope(transformed_queries.back()).AsRect());
+  }
+  auto visitor_wrapper = [&transformed_queries, visitor, &meshes,
+                          mesh_first_triangle_indices](uint32_t query_index,
+                                                       uint32_t element) {
+    PartitionedMesh::TriangleIndexPair index =
+        ToTriangleIndexPair(mesh_first_triangle_indices, element);
+    if (!geometry_internal::IntersectsInternal(
+            transformed_queries[query_index],
+            meshes[index.mesh_index].GetTriangle(index.triangle_index))) {
+      return true;
+    }
+    return visitor(query_index, index) ==
+           PartitionedMesh::FlowControl::kContinue;
+  };
+  rtree.VisitIntersectedElementsBatch(query_bounds, visitor_wrapper);
+}
+
+}  // namespace
+
+void PartitionedMesh::VisitIntersectedTrianglesBatch(
+    absl::Span<const Point> queries,
+    absl::FunctionRef<FlowControl(uint32_t, TriangleIndexPair)> visitor,
+    const AffineTransform& query_to_this) const {
+  if (!data_ || queries.empty()) return;
+
+  VisitIntersectedTrianglesBatchHelper(
+      queries, visitor, query_to_this, data_->Meshes(),
+      data_->MeshFirstTriangleIndices(), data_->SpatialIndex());
+}
+
+void PartitionedMesh::VisitIntersectedTrianglesBatch(
+    absl::Span<const Segment> queries,
+    absl::FunctionRef<FlowControl(uint32_t, TriangleIndexPair)> visitor,
+    const AffineTransform& query_to_this) const {
+  if (!data_ || queries.empty()) return;
+
+  VisitIntersectedTrianglesBatchHelper(
+      queries, visitor, query_to_this, data_->Meshes(),
+      data_->MeshFirstTriangleIndices(), data_->SpatialIndex());
 }
 
 namespace {
@@ -380,7 +640,8 @@ namespace {
 // `VisitIntersectedTriangles`, that handles the case in which the given
 // transform is invertible.
 void VisitIntersectedTrianglesWithPartitionedMeshWithInvertibleTransform(
-    absl::Span<const Mesh> meshes, const RTree& rtree,
+    absl::Span<const Mesh> meshes,
+    absl::Span<const uint32_t> mesh_first_triangle_indices, const RTree& rtree,
     const PartitionedMesh& query, const AffineTransform& query_to_target,
     const AffineTransform& target_to_query,
     absl::FunctionRef<
@@ -392,8 +653,10 @@ void VisitIntersectedTrianglesWithPartitionedMeshWithInvertibleTransform(
   Rect query_bounds =
       *Envelope(query_to_target.Apply(*query.Bounds().AsRect())).AsRect();
 
-  auto visitor_wrapper = [&meshes, &query, &target_to_query,
-                          visitor](PartitionedMesh::TriangleIndexPair index) {
+  auto visitor_wrapper = [&meshes, mesh_first_triangle_indices, &query,
+                          &target_to_query, visitor](uint32_t element) {
+    PartitionedMesh::TriangleIndexPair index =
+        ToTriangleIndexPair(mesh_first_triangle_indices, element);
     // This triangle hits the bounding box of `query`, now we need to check
     // that it actually hits `query` itself. Note that we can't call
     // `IntersectsInternal` here, because it would result in a circular
@@ -437,8 +700,8 @@ void PartitionedMesh::VisitIntersectedTriangles(
   std::optional<AffineTransform> this_to_query = query_to_this.Inverse();
   if (this_to_query.has_value()) {
     VisitIntersectedTrianglesWithPartitionedMeshWithInvertibleTransform(
-        data_->Meshes(), data_->SpatialIndex(), query, query_to_this,
-        *this_to_query, visitor);
+        data_->Meshes(), data_->MeshFirstTriangleIndices(),
+        data_->SpatialIndex(), query, query_to_this, *this_to_query, visitor);
   } else {
     // Since `query_to_this` is not invertible, it must collapse `query` to
     // either a segment or a point.
@@ -451,6 +714,114 @@ void PartitionedMesh::VisitIntersectedTriangles(
 
 namespace {
 
+// This is a helper function for `VisitNearestTriangles` that handles the
+// type-independent logic.
+template <typename QueryType>
+void VisitNearestTrianglesHelper(
+    const QueryType& query, uint32_t max_count, float max_distance,
+    absl::FunctionRef<PartitionedMesh::FlowControl(
+        PartitionedMesh::TriangleIndexPair, float)>
+        visitor,
+    const AffineTransform& this_to_query, absl::Span<const Mesh> meshes,
+    absl::Span<const uint32_t> mesh_first_triangle_indices,
+    const RTree& rtree) {
+  if (max_count == 0) return;
+
+  // Since distances are measured in `query`'s coordinate space, we transform
+  // the bounds of the R-Tree nodes, rather than transforming `query` into this
+  // coordinate space. The transformed bounds contain the transformed triangles,
+  // so the distance to them is a lower bound on the distance to the triangles,
+  // even if `this_to_query` is not a similarity transform.
+  auto bounds_distance = [&query, &this_to_query](const Rect& bounds) {
+    return geometry_internal::DistanceInternal(query,
+                                               this_to_query.Apply(bounds));
+  };
+  auto triangle_distance = [&query, &this_to_query, &meshes,
+                            mesh_first_triangle_indices](uint32_t element) {
+    PartitionedMesh::TriangleIndexPair index =
+        ToTriangleIndexPair(mesh_first_triangle_indices, element);
+    return geometry_internal::DistanceInternal(
+        query, this_to_query.Apply(
+                   meshes[index.mesh_index].GetTriangle(index.triangle_index)));
+  };
+  uint32_t n_visited = 0;
+  auto visitor_wrapper = [visitor, max_count, &n_visited,
+                          mesh_first_triangle_indices](uint32_t element,
+                                                       float distance) {
+    ++n_visited;
+    return visitor(ToTriangleIndexPair(mesh_first_triangle_indices, element),
+                   distance) ==
+               PartitionedMesh::FlowControl::kContinue &&
+           n_visited < max_count;
+  };
+  rtree.VisitNearestElements(bounds_distance, triangle_distance, max_distance,
+                             visitor_wrapper);
+}
+
+}  // namespace
+
+void PartitionedMesh::VisitNearestTriangles(
+    Point query, uint32_t max_count, float max_distance,
+    absl::FunctionRef<FlowControl(TriangleIndexPair, float)> visitor,
+    const AffineTransform& this_to_query) const {
+  if (!data_) return;
+
+  VisitNearestTrianglesHelper(query, max_count, max_distance, visitor,
+                              this_to_query, data_->Meshes(),
+                              data_->MeshFirstTriangleIndices(),
+                              data_->SpatialIndex());
+}
+
+void PartitionedMesh::VisitNearestTriangles(
+    const Segment& query, uint32_t max_count, float max_distance,
+    absl::FunctionRef<FlowControl(TriangleIndexPair, float)> visitor,
+    const AffineTransform& this_to_query) const {
+  if (!data_) return;
+
+  VisitNearestTrianglesHelper(query, max_count, max_distance, visitor,
+                              this_to_query, data_->Meshes(),
+                              data_->MeshFirstTriangleIndices(),
+                              data_->SpatialIndex());
+}
+
+void PartitionedMesh::VisitNearestTriangles(
+    const Triangle& query, uint32_t max_count, float max_distance,
+    absl::FunctionRef<FlowControl(TriangleIndexPair, float)> visitor,
+    const AffineTransform& this_to_query) const {
+  if (!data_) return;
+
+  VisitNearestTrianglesHelper(query, max_count, max_distance, visitor,
+                              this_to_query, data_->Meshes(),
+                              data_->MeshFirstTriangleIndices(),
+                              data_->SpatialIndex());
+}
+
+void PartitionedMesh::VisitNearestTriangles(
+    const Rect& query, uint32_t max_count, float max_distance,
+    absl::FunctionRef<FlowControl(TriangleIndexPair, float)> visitor,
+    const AffineTransform& this_to_query) const {
+  if (!data_) return;
+
+  VisitNearestTrianglesHelper(query, max_count, max_distance, visitor,
+                              this_to_query, data_->Meshes(),
+                              data_->MeshFirstTriangleIndices(),
+                              data_->SpatialIndex());
+}
+
+void PartitionedMesh::VisitNearestTriangles(
+    const Quad& query, uint32_t max_count, float max_distance,
+    absl::FunctionRef<FlowControl(TriangleIndexPair, float)> visitor,
+    const AffineTransform& this_to_query) const {
+  if (!data_) return;
+
+  VisitNearestTrianglesHelper(query, max_count, max_distance, visitor,
+                              this_to_query, data_->Meshes(),
+                              data_->MeshFirstTriangleIndices(),
+                              data_->SpatialIndex());
+}
+
+namespace {
+
 // This is a helper function for `Coverage` that contains the type-independent
 // logic for computing the proportion of the area covered by the query.
 template <typename QueryType>
@@ -566,7 +937,14 @@ bool PartitionedMesh::CoverageIsGreaterThan(
                                      data_->TotalAbsoluteArea());
 }
 
-const RTree& PartitionedMesh::Data::SpatialIndex() const {
+void PartitionedMesh::Data::SetSpatialIndexIfUninitialized(RTree rtree) const {
+  absl::MutexLock lock(&cache_mutex_);
+  if (rtree_ != nullptr) return;
+  rtree_ = std::make_unique<RTree>(std::move(rtree));
+}
+
+const RTree& PartitionedMesh::Data::SpatialIndex(
+    ParallelFor parallel_for) const {
   ABSL_CHECK(!meshes_.empty());
 
   absl::MutexLock lock(&cache_mutex_);
@@ -577,36 +955,32 @@ const RTree& PartitionedMesh::Data::SpatialIndex() const {
   // result.
   if (rtree_ != nullptr) return *rtree_;
 
-  uint32_t n_tris = 0;
-  for (const Mesh& mesh : meshes_) n_tris += mesh.TriangleCount();
-
-  // This generates each valid `TriangleIndexPair` for this `PartitionedMesh`,
-  // in order of mesh index, then triangle index.
-  //
-  // We want to start at mesh_index = 0, triangle_index = 0, but since they're
-  // `uint16_t`s, we have to make a copy of the current index, then increment
-  // the current value, then return the copy (analogous to the post-increment
-  // operator).
-  auto triangle_index_pair_generator =
-      [this, current_index = TriangleIndexPair{.mesh_index = 0,
-                                               .triangle_index = 0}]() mutable {
-        TriangleIndexPair value_before_increment = current_index;
-        ++current_index.triangle_index;
-        if (current_index.triangle_index >=
-            meshes_[current_index.mesh_index].TriangleCount()) {
-          ++current_index.mesh_index;
-          current_index.triangle_index = 0;
-        }
-        return value_before_increment;
-      };
-  // This gets the bounds for a `TriangleIndexPair` by looking up the triangle
-  // in this `PartitionedMesh`'s meshes.
-  auto bounds_func = [&meshes = meshes_](TriangleIndexPair idx) {
-    return *Envelope(meshes[idx.mesh_index].GetTriangle(idx.triangle_index))
+  uint32_t n_tris =
+      mesh_first_triangle_indices_.back() + meshes_.back().TriangleCount();
+
+  // This generates each element in order, i.e. the index of each triangle
+  // among all of the triangles of all of the meshes.
+  auto element_generator = [next_element = uint32_t{0}]() mutable {
+    return next_element++;
+  };
+  // This gets the bounds for an element by looking up the triangle in this
+  // `PartitionedMesh`'s meshes. Every triangle is visited, so the vertex
+  // positions are decoded up front, rather than once per triangle that uses
+  // them.
+  std::vector<std::vector<Point>> positions = DecodeVertexPositions(meshes_);
+  auto bounds_func = [&meshes = meshes_,
+                      mesh_first_triangle_indices =
+                          MeshFirstTriangleIndices(),
+                      &positions](uint32_t element) {
+    TriangleIndexPair idx =
+        ToTriangleIndexPair(mesh_first_triangle_indices, element);
+    return *Envelope(GetDecodedTriangle(meshes[idx.mesh_index],
+                                        positions[idx.mesh_index],
+                                        idx.triangle_index))
                 .AsRect();
   };
-  rtree_ = std::make_unique<RTree>(n_tris, triangle_index_pair_generator,
-                                   bounds_func);
+  rtree_ = std::make_unique<RTree>(n_tris, element_generator, bounds_func,
+                                   parallel_for);
 
   return *rtree_;
 }
@@ -617,9 +991,13 @@ float PartitionedMesh::Data::TotalAbsoluteArea() const {
   absl::MutexLock lock(&cache_mutex_);
   if (!cached_total_absolute_area_.has_value()) {
     float total_abs_area = 0;
+    std::vector<Point> positions;
     for (const Mesh& mesh : meshes_) {
+      positions.resize(mesh.VertexCount());
+      mesh.DecodePositions(absl::MakeSpan(positions));
       for (uint32_t i = 0; i < mesh.TriangleCount(); ++i) {
-        total_abs_area += std::abs(mesh.GetTriangle(i).SignedArea());
+        total_abs_area +=
+            std::abs(GetDecodedTriangle(mesh, positions, i).SignedArea());
       }
     }
     cached_total_absolute_area_ = total_abs_area;
@@ -27,6 +27,7 @@
 #include "absl/container/inlined_vector.h"
 #include "absl/functional/function_ref.h"
 #include "absl/log/absl_check.h"
+#include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/synchronization/mutex.h"
 #include "absl/types/span.h"
@@ -42,6 +43,7 @@
 #include "ink/geometry/rect.h"
 #include "ink/geometry/segment.h"
 #include "ink/geometry/triangle.h"
+#include "ink/types/parallel_for.h"
 
 namespace ink {
 
@@ -66,19 +68,28 @@ class PartitionedMesh {
  public:
   // A pair of indices identifying a point in an outline, by referring
   // to a vertex in one of the `Mesh`es.
+  //
+  // There are at most 2^16 meshes, so `mesh_index` is 16 bits wide. The vertex
+  // index is 32 bits wide so that it can refer to any vertex of a mesh that
+  // uses `MeshFormat::IndexFormat::k32BitUnpacked32BitPacked`; this makes the
+  // struct 8 bytes, including 2 bytes of padding after `mesh_index`.
   struct VertexIndexPair {
     // The index of the `Mesh` that the vertex belongs to.
     uint16_t mesh_index;
     // The index of the vertex within the `Mesh`.
-    uint16_t vertex_index;
+    uint32_t vertex_index;
   };
 
   // A pair of indices identifying a triangle in one of the `Mesh`es.
+  //
+  // This has the same layout as `VertexIndexPair`. Note that the spatial index
+  // doesn't store these; it identifies each triangle by a single 32-bit index
+  // into all of the triangles of all of the meshes.
   struct TriangleIndexPair {
     // The index of the `Mesh` that the triangle belongs to.
     uint16_t mesh_index;
     // The index of the triangle within the `Mesh`.
-    uint16_t triangle_index;
+    uint32_t triangle_index;
   };
 
   // One render group for a `PartitionedMesh`, expressed using `MutableMesh`.
@@ -92,6 +103,14 @@ class PartitionedMesh {
     // stripped out during construction of the `PartitionedMesh`.
     absl::Span<const MeshFormat::AttributeId> omit_attributes;
     absl::Span<const std::optional<MeshAttributeCodingParams>> packing_params;
+    // If true, the triangles of `mesh` are reordered before it is converted to
+    // `Mesh`es, so that the GPU's vertex cache is used better when rendering
+    // them, and neighboring triangles' vertices are closer together in memory.
+    // This doesn't change the set of triangles or their winding, but the
+    // triangle and vertex indices of the resulting `Mesh`es will no longer
+    // follow the order of `mesh`. This makes construction slower, so it's best
+    // saved for meshes that will be drawn or queried many times.
+    bool optimize_triangle_order = false;
   };
 
   // One render group for a `PartitionedMesh`, expressed using `Mesh`.
@@ -142,6 +161,7 @@ class PartitionedMesh {
   // given, should contain spans of `VertexIndexPair`s, each describing an
   // outline. Returns an error if:
   // - `meshes` contains more than 65536 (2^16) elements
+  // - `meshes` contain more than 2^32 - 1 triangles in total
   // - any element of `meshes` is empty
   // - any element of `meshes` has a different `MeshFormat` from the others
   // - Any outline is empty.
@@ -156,6 +176,7 @@ class PartitionedMesh {
   // - Any group contains a mesh that is empty.
   // - Any group contains two meshes with different `MeshFormat`s.
   // - The total number of meshes across all groups is more than 65536 (2^16).
+  // - The total number of triangles across all groups is more than 2^32 - 1.
   // - Any outline is empty.
   // - Any outline contains any element that does not correspond to a mesh or
   //   vertex.
@@ -233,7 +254,59 @@ class PartitionedMesh {
   // Forces initialization of the spatial index. This is a no-op if the spatial
   // index has already been initialized, or if the `PartitionedMesh` contains no
   // meshes.
-  void InitializeSpatialIndex();
+  //
+  // If `parallel_for` is given, the construction of a large index is split into
+  // tasks that are run with it; see `ParallelFor` for details.
+  void InitializeSpatialIndex(ParallelFor parallel_for = RunSerially);
+
+  // Forces initialization of the spatial indices of all of `meshes`, building
+  // them concurrently with `parallel_for`. This has the same effect as calling
+  // `InitializeSpatialIndex` on each of them, but e.g. allows the indices for
+  // all of the strokes in a document to be built at once when it is opened.
+  //
+  // Since copies of a `PartitionedMesh` share their spatial index, `meshes` may
+  // contain copies of the `PartitionedMesh`es that need to be initialized
+  // (which are cheap to make), and it is fine for it to contain more than one
+  // copy of the same `PartitionedMesh`; the index will only be built once.
+  static void InitializeSpatialIndices(absl::Span<PartitionedMesh> meshes,
+                                       ParallelFor parallel_for);
+
+  // Returns the spatial index serialized into a flat byte buffer, which can be
+  // stored alongside the meshes and passed to
+  // `InitializeSpatialIndexFromSerialized` when they are loaded again. This
+  // initializes the spatial index if needed. Returns an empty buffer if the
+  // `PartitionedMesh` contains no meshes.
+  //
+  // The buffer uses the host's byte order, and is only meant to be read back on
+  // a host of the same architecture.
+  std::vector<std::byte> SerializeSpatialIndex() const;
+
+  // The amount of validation done by `InitializeSpatialIndexFromSerialized`.
+  enum class SerializedSpatialIndexCheck : uint8_t {
+    // Checks that the index is well-formed, and contains each triangle exactly
+    // once. This guarantees that queries are safe, but if the index was
+    // serialized from a `PartitionedMesh` with different geometry, they may
+    // return incorrect results.
+    kStructure,
+    // Additionally checks that the bounds of each triangle in the index match
+    // the triangle. This requires reading every vertex position, which costs
+    // roughly as much as computing the bounds when building the index.
+    kStructureAndBounds,
+  };
+
+  // Initializes the spatial index from `serialized_index`, the output of
+  // `SerializeSpatialIndex` on a `PartitionedMesh` with the same meshes, rather
+  // than building it. The index structure is adopted as-is, and validated per
+  // `check` in time linear in its size.
+  //
+  // Returns an error if `serialized_index` fails validation, e.g. because it is
+  // malformed, or is for different meshes. If the spatial index has already
+  // been initialized, `serialized_index` is still validated, but the existing
+  // index is kept.
+  absl::Status InitializeSpatialIndexFromSerialized(
+      absl::Span<const std::byte> serialized_index,
+      SerializedSpatialIndexCheck check =
+          SerializedSpatialIndexCheck::kStructureAndBounds);
 
   // Returns true if the spatial index has already been initialized.
   bool IsSpatialIndexInitialized() const;
@@ -277,6 +350,70 @@ class PartitionedMesh {
       absl::FunctionRef<FlowControl(TriangleIndexPair)> visitor,
       const AffineTransform& query_to_this = {}) const;
 
+  // Visits all triangles in the `PartitionedMesh`'s meshes that intersect each
+  // of the `queries`, with the same results as calling
+  // `VisitIntersectedTriangles` once per query. `visitor` is passed the index
+  // of the query in `queries` and the index of the triangle. Returning
+  // `FlowControl::kBreak` stops the visit for that query only; the other
+  // queries continue to be visited. The visitation order is arbitrary, both
+  // across and within queries.
+  //
+  // This is intended for gestures like erasing or lasso selection, which
+  // produce many queries at once. Rather than searching the index from the
+  // root for each query, this descends it once for the whole batch, carrying
+  // along the queries that may hit each branch.
+  //
+  // Optional argument `query_to_this` contains the transform that maps from
+  // the coordinate space of `queries` to this `PartitionedMesh`'s coordinate
+  // space, which defaults to the identity transform. This will initialize the
+  // index if it has not already been done.
+  void VisitIntersectedTrianglesBatch(
+      absl::Span<const Point> queries,
+      absl::FunctionRef<FlowControl(uint32_t, TriangleIndexPair)> visitor,
+      const AffineTransform& query_to_this = {}) const;
+  void VisitIntersectedTrianglesBatch(
+      absl::Span<const Segment> queries,
+      absl::FunctionRef<FlowControl(uint32_t, TriangleIndexPair)> visitor,
+      const AffineTransform& query_to_this = {}) const;
+
+  // Visits the triangles in the `PartitionedMesh`'s meshes in order of
+  // increasing distance from `query` (as per the `Distance` family of
+  // functions), stopping after `max_count` triangles have been visited.
+  // Triangles whose distance from `query` is greater than `max_distance` are
+  // skipped. `visitor` is passed the index of the triangle and its distance
+  // from `query`; its return value indicates whether the visit should continue
+  // or stop early. Triangles that are equidistant from `query` (e.g. because
+  // they all contain it) are visited in an arbitrary order.
+  //
+  // Optional argument `this_to_query` contains the transform that maps from
+  // this `PartitionedMesh`'s coordinate space to `query`'s coordinate space,
+  // which defaults to the identity transform. Distances are measured in
+  // `query`'s coordinate space.
+  //
+  // This uses the spatial index to find the nearest triangles without visiting
+  // every triangle, and will initialize the index if it has not already been
+  // done.
+  void VisitNearestTriangles(
+      Point query, uint32_t max_count, float max_distance,
+      absl::FunctionRef<FlowControl(TriangleIndexPair, float)> visitor,
+      const AffineTransform& this_to_query = {}) const;
+  void VisitNearestTriangles(
+      const Segment& query, uint32_t max_count, float max_distance,
+      absl::FunctionRef<FlowControl(TriangleIndexPair, float)> visitor,
+      const AffineTransform& this_to_query = {}) const;
+  void VisitNearestTriangles(
+      const Triangle& query, uint32_t max_count, float max_distance,
+      absl::FunctionRef<FlowControl(TriangleIndexPair, float)> visitor,
+      const AffineTransform& this_to_query = {}) const;
+  void VisitNearestTriangles(
+      const Rect& query, uint32_t max_count, float max_distance,
+      absl::FunctionRef<FlowControl(TriangleIndexPair, float)> visitor,
+      const AffineTransform& this_to_query = {}) const;
+  void VisitNearestTriangles(
+      const Quad& query, uint32_t max_count, float max_distance,
+      absl::FunctionRef<FlowControl(TriangleIndexPair, float)> visitor,
+      const AffineTransform& this_to_query = {}) const;
+
   // Computes an approximate measure of what portion of the `PartitionedMesh` is
   // covered by or overlaps with `query`. This is calculated by finding the sum
   // of areas of the triangles that intersect the given object, and dividing
@@ -332,8 +469,10 @@ class PartitionedMesh {
                              const AffineTransform& query_to_this = {}) const;
 
  private:
-  // Convenience alias for the R-Tree.
-  using RTree = geometry_internal::StaticRTree<TriangleIndexPair>;
+  // Convenience alias for the R-Tree. Its elements are the indices of the
+  // triangles among all of the triangles of all of the meshes, in order of mesh
+  // index, then triangle index; see `Data::MeshFirstTriangleIndices`.
+  using RTree = geometry_internal::StaticRTree<uint32_t>;
 
   // Contains the data that makes up the `PartitionedMesh`, which is shared
   // between instances in order to enable fast copying.
@@ -355,13 +494,22 @@ class PartitionedMesh {
     absl::Span<const Mesh> Meshes() const;
     absl::Span<const std::vector<VertexIndexPair>> Outlines(
         uint32_t group_index) const;
-
-    // Fetches the spatial index, initializing it if needed. This CHECK-fails
-    // if `Meshes()` is empty; this is expected to be guaranteed by the caller.
+    // Returns, for each mesh, the index of its first triangle among all of the
+    // triangles of all of the meshes. These are the offsets used by the
+    // elements of the spatial index.
+    absl::Span<const uint32_t> MeshFirstTriangleIndices() const;
+
+    // Fetches the spatial index, initializing it if needed, using
+    // `parallel_for` to build it. This CHECK-fails if `Meshes()` is empty; this
+    // is expected to be guaranteed by the caller.
     //
     // The spatial index's structure only depends on the `Mesh`es, which are
     // immutable, so the it never needs to be invalidated.
-    const RTree& SpatialIndex() const;
+    const RTree& SpatialIndex(ParallelFor parallel_for = RunSerially) const;
+
+    // Sets the spatial index to `rtree`, unless it has already been
+    // initialized. `rtree` is expected to have been validated by the caller.
+    void SetSpatialIndexIfUninitialized(RTree rtree) const;
 
     // Returns true if the spatial index has already been initialized.
     bool IsSpatialIndexInitialized() const;
@@ -377,6 +525,9 @@ class PartitionedMesh {
 
    private:
     absl::InlinedVector<Mesh, 1> meshes_;
+    // For each mesh, the index of its first triangle among all of the
+    // triangles of all of the meshes.
+    absl::InlinedVector<uint32_t, 1> mesh_first_triangle_indices_;
     absl::InlinedVector<std::vector<VertexIndexPair>, 1> outlines_;
     // For each render group, the index into `meshes_` for the first mesh in
     // that group.
@@ -473,10 +624,10 @@ inline uint32_t PartitionedMesh::OutlineVertexCount(
   return Outline(group_index, outline_index).size();
 }
 
-inline void PartitionedMesh::InitializeSpatialIndex() {
+inline void PartitionedMesh::InitializeSpatialIndex(ParallelFor parallel_for) {
   if (!data_) return;
 
-  (void)data_->SpatialIndex();
+  (void)data_->SpatialIndex(parallel_for);
 }
 
 inline bool PartitionedMesh::IsSpatialIndexInitialized() const {
@@ -521,6 +672,11 @@ PartitionedMesh::Data::Outlines(uint32_t group_index) const {
   return absl::MakeConstSpan(outlines_).subspan(start, end - start);
 }
 
+inline absl::Span<const uint32_t>
+PartitionedMesh::Data::MeshFirstTriangleIndices() const {
+  return mesh_first_triangle_indices_;
+}
+
 inline bool PartitionedMesh::Data::IsSpatialIndexInitialized() const {
   absl::MutexLock lock(&cache_mutex_);
   return rtree_ != nullptr;
@@ -0,0 +1,319 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "absl/log/absl_check.h"
+#include "absl/status/statusor.h"
+#include "benchmark/benchmark.h"
+#include "ink/geometry/affine_transform.h"
+#include "ink/geometry/angle.h"
+#include "ink/geometry/internal/vertex_cache_optimization.h"
+#include "ink/geometry/mesh.h"
+#include "ink/geometry/mesh_format.h"
+#include "ink/geometry/mesh_test_helpers.h"
+#include "ink/geometry/mutable_mesh.h"
+#include "ink/geometry/partitioned_mesh.h"
+#include "ink/geometry/point.h"
+#include "ink/geometry/rect.h"
+
+namespace ink {
+namespace {
+
+// Returns a `MutableMesh` in the shape of a straight line with `n_triangles`
+// triangles, which is rotated so that its triangles' bounding boxes overlap.
+MutableMesh MakeLineMesh(int n_triangles,
+                         const MeshFormat& format = MeshFormat()) {
+  return MakeStraightLineMutableMesh(
+      n_triangles, format,
+      AffineTransform::Rotate(kQuarterTurn / 3) *
+          AffineTransform::ScaleX(0.1));
+}
+
+// Returns an unpacked-position `MeshFormat` with the given `index_format`.
+MeshFormat MakePositionOnlyFormat(MeshFormat::IndexFormat index_format) {
+  absl::StatusOr<MeshFormat> format =
+      MeshFormat::Create({{MeshFormat::AttributeType::kFloat2Unpacked,
+                           MeshFormat::AttributeId::kPosition}},
+                         index_format);
+  ABSL_CHECK_OK(format);
+  return *format;
+}
+
+// Reports the number of meshes in `shape`, and the size of their vertex and
+// index data, as counters.
+void SetMeshSizeCounters(benchmark::State& state,
+                         const PartitionedMesh& shape) {
+  size_t vertex_bytes = 0;
+  size_t index_bytes = 0;
+  for (const Mesh& mesh : shape.Meshes()) {
+    vertex_bytes += mesh.RawVertexData().size();
+    index_bytes += mesh.RawIndexData().size();
+  }
+  state.counters["meshes"] = shape.Meshes().size();
+  state.counters["vertex_bytes"] = vertex_bytes;
+  state.counters["index_bytes"] = index_bytes;
+  state.counters["total_bytes"] = vertex_bytes + index_bytes;
+}
+
+// Returns the number of triangles in `shape` that intersect `query`.
+int CountIntersectedTriangles(const PartitionedMesh& shape, Point query) {
+  int count = 0;
+  shape.VisitIntersectedTriangles(
+      query, [&count](PartitionedMesh::TriangleIndexPair) {
+        ++count;
+        return PartitionedMesh::FlowControl::kContinue;
+      });
+  return count;
+}
+
+// Measures the "cold-open" latency of a hit test: the meshes are wrapped in a
+// new `PartitionedMesh`, as when loading a stored stroke, and the first query
+// must build the spatial index.
+void BM_FirstHitTestBuildingSpatialIndex(benchmark::State& state) {
+  absl::StatusOr<PartitionedMesh> shape =
+      PartitionedMesh::FromMutableMesh(MakeLineMesh(state.range(0)));
+  ABSL_CHECK_OK(shape);
+  for (auto s : state) {
+    absl::StatusOr<PartitionedMesh> loaded =
+        PartitionedMesh::FromMeshes(shape->Meshes());
+    ABSL_CHECK_OK(loaded);
+    benchmark::DoNotOptimize(CountIntersectedTriangles(*loaded, {1, 1}));
+  }
+}
+BENCHMARK(BM_FirstHitTestBuildingSpatialIndex)->Range(1024, 65000);
+
+// Same as above, except that the spatial index is loaded from the output of
+// `PartitionedMesh::SerializeSpatialIndex`, with the amount of validation
+// given by the second argument.
+void BM_FirstHitTestWithSerializedSpatialIndex(benchmark::State& state) {
+  PartitionedMesh::SerializedSpatialIndexCheck check =
+      static_cast<PartitionedMesh::SerializedSpatialIndexCheck>(
+          state.range(1));
+  absl::StatusOr<PartitionedMesh> shape =
+      PartitionedMesh::FromMutableMesh(MakeLineMesh(state.range(0)));
+  ABSL_CHECK_OK(shape);
+  std::vector<std::byte> serialized_index = shape->SerializeSpatialIndex();
+  state.counters["index_bytes"] = serialized_index.size();
+  for (auto s : state) {
+    absl::StatusOr<PartitionedMesh> loaded =
+        PartitionedMesh::FromMeshes(shape->Meshes());
+    ABSL_CHECK_OK(loaded);
+    ABSL_CHECK_OK(
+        loaded->InitializeSpatialIndexFromSerialized(serialized_index, check));
+    benchmark::DoNotOptimize(CountIntersectedTriangles(*loaded, {1, 1}));
+  }
+}
+BENCHMARK(BM_FirstHitTestWithSerializedSpatialIndex)
+    ->ArgsProduct(
+        {benchmark::CreateRange(1024, 65000, 8),
+         {static_cast<int>(
+              PartitionedMesh::SerializedSpatialIndexCheck::kStructure),
+          static_cast<int>(PartitionedMesh::SerializedSpatialIndexCheck::
+                               kStructureAndBounds)}});
+
+// The sizes and index formats compared by the large-mesh benchmarks below:
+// with 16-bit indices, meshes of more than 2^16 vertices are split into
+// several partitions.
+void LargeMeshArgs(benchmark::internal::Benchmark* benchmark) {
+  for (int64_t n_triangles : {1 << 16, 1 << 18, 1 << 20}) {
+    for (MeshFormat::IndexFormat index_format :
+         {MeshFormat::IndexFormat::k32BitUnpacked16BitPacked,
+          MeshFormat::IndexFormat::k32BitUnpacked32BitPacked}) {
+      benchmark->Args({n_triangles, static_cast<int64_t>(index_format)});
+    }
+  }
+}
+
+// Measures hit tests against a large mesh with an already-built spatial index,
+// with the index format given by the second argument, and reports the size of
+// the packed meshes.
+void BM_HitTestLargeMesh(benchmark::State& state) {
+  MutableMesh mesh = MakeLineMesh(
+      state.range(0),
+      MakePositionOnlyFormat(
+          static_cast<MeshFormat::IndexFormat>(state.range(1))));
+  absl::StatusOr<PartitionedMesh> shape =
+      PartitionedMesh::FromMutableMesh(mesh);
+  ABSL_CHECK_OK(shape);
+  shape->InitializeSpatialIndex();
+  SetMeshSizeCounters(state, *shape);
+  // Query points spread along the line, so that the hits are in every
+  // partition of the 16-bit meshes.
+  std::vector<Point> queries;
+  for (uint32_t i = 0; i < 16; ++i) {
+    queries.push_back(mesh.VertexPosition(i * (mesh.VertexCount() / 16)));
+  }
+  for (auto s : state) {
+    for (Point query : queries) {
+      benchmark::DoNotOptimize(CountIntersectedTriangles(*shape, query));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * queries.size());
+}
+BENCHMARK(BM_HitTestLargeMesh)->Apply(LargeMeshArgs);
+
+// Measures building the spatial index of a large mesh, with the index format
+// given by the second argument.
+void BM_BuildSpatialIndexLargeMesh(benchmark::State& state) {
+  absl::StatusOr<PartitionedMesh> shape =
+      PartitionedMesh::FromMutableMesh(MakeLineMesh(
+          state.range(0),
+          MakePositionOnlyFormat(
+              static_cast<MeshFormat::IndexFormat>(state.range(1)))));
+  ABSL_CHECK_OK(shape);
+  SetMeshSizeCounters(state, *shape);
+  for (auto s : state) {
+    absl::StatusOr<PartitionedMesh> loaded =
+        PartitionedMesh::FromMeshes(shape->Meshes());
+    ABSL_CHECK_OK(loaded);
+    loaded->InitializeSpatialIndex();
+    benchmark::DoNotOptimize(loaded);
+  }
+}
+BENCHMARK(BM_BuildSpatialIndexLargeMesh)->Apply(LargeMeshArgs);
+
+// The shapes of mesh compared by the triangle order benchmarks below.
+enum class TriangleOrderMeshShape {
+  // A strip, as made by `MakeLineMesh`, whose triangles are already in a good
+  // order for the vertex cache.
+  kLine,
+  // A grid of quads with rows of 64 quads, in row-major order. The rows are too
+  // long for the vertices shared with the previous row to still be in the
+  // vertex cache.
+  kGrid,
+};
+
+constexpr uint32_t kGridColumnCount = 64;
+
+// Returns a mesh of the given `shape`, with `size` triangles for `kLine` or
+// `size` rows for `kGrid`.
+MutableMesh MakeTriangleOrderMesh(TriangleOrderMeshShape shape, int size) {
+  if (shape == TriangleOrderMeshShape::kLine) return MakeLineMesh(size);
+
+  MutableMesh mesh;
+  for (int row = 0; row <= size; ++row) {
+    for (uint32_t column = 0; column <= kGridColumnCount; ++column) {
+      mesh.AppendVertex({static_cast<float>(column), static_cast<float>(row)});
+    }
+  }
+  for (uint32_t row = 0; row < static_cast<uint32_t>(size); ++row) {
+    for (uint32_t column = 0; column < kGridColumnCount; ++column) {
+      uint32_t v00 = row * (kGridColumnCount + 1) + column;
+      uint32_t v10 = v00 + 1;
+      uint32_t v01 = v00 + kGridColumnCount + 1;
+      uint32_t v11 = v01 + 1;
+      mesh.AppendTriangleIndices({v00, v10, v11});
+      mesh.AppendTriangleIndices({v00, v11, v01});
+    }
+  }
+  return mesh;
+}
+
+// Reports the average cache miss ratio (ACMR) of drawing all of the meshes of
+// `shape` in order, with FIFO vertex caches of 16 and 32 vertices, as counters.
+void SetCacheMissRatioCounters(benchmark::State& state,
+                               const PartitionedMesh& shape) {
+  std::vector<std::array<uint32_t, 3>> triangles;
+  // Offset each mesh's vertex indices, so that vertices of different meshes
+  // don't share cache entries.
+  uint32_t first_vertex = 0;
+  for (const Mesh& mesh : shape.Meshes()) {
+    for (uint32_t i = 0; i < mesh.TriangleCount(); ++i) {
+      std::array<uint32_t, 3> indices = mesh.TriangleIndices(i);
+      triangles.push_back({first_vertex + indices[0], first_vertex + indices[1],
+                           first_vertex + indices[2]});
+    }
+    first_vertex += mesh.VertexCount();
+  }
+  state.counters["acmr_16"] =
+      mesh_internal::AverageCacheMissRatio(triangles, 16);
+  state.counters["acmr_32"] =
+      mesh_internal::AverageCacheMissRatio(triangles, 32);
+}
+
+// The arguments of the triangle order benchmarks: the mesh shape, its size,
+// and whether `optimize_triangle_order` is set.
+void TriangleOrderArgs(benchmark::internal::Benchmark* benchmark) {
+  for (int optimize : {0, 1}) {
+    for (int64_t n_triangles : {8192, 65536}) {
+      benchmark->Args({static_cast<int64_t>(TriangleOrderMeshShape::kLine),
+                       n_triangles, optimize});
+    }
+    for (int64_t n_rows : {64, 512}) {
+      benchmark->Args({static_cast<int64_t>(TriangleOrderMeshShape::kGrid),
+                       n_rows, optimize});
+    }
+  }
+}
+
+absl::StatusOr<PartitionedMesh> FromMutableMeshWithTriangleOrder(
+    const MutableMesh& mesh, bool optimize_triangle_order) {
+  return PartitionedMesh::FromMutableMeshGroups(
+      {PartitionedMesh::MutableMeshGroup{
+          .mesh = &mesh, .optimize_triangle_order = optimize_triangle_order}});
+}
+
+// Measures rectangle queries against a mesh with an already-built spatial
+// index, with and without `optimize_triangle_order`, and reports the ACMR of
+// the resulting meshes.
+void BM_HitTestWithTriangleOrder(benchmark::State& state) {
+  MutableMesh mesh = MakeTriangleOrderMesh(
+      static_cast<TriangleOrderMeshShape>(state.range(0)), state.range(1));
+  absl::StatusOr<PartitionedMesh> shape =
+      FromMutableMeshWithTriangleOrder(mesh, state.range(2));
+  ABSL_CHECK_OK(shape);
+  shape->InitializeSpatialIndex();
+  SetCacheMissRatioCounters(state, *shape);
+  // Small query rectangles spread over the mesh, each of which intersects a
+  // few dozen triangles.
+  std::vector<Rect> queries;
+  for (uint32_t i = 0; i < 64; ++i) {
+    queries.push_back(Rect::FromCenterAndDimensions(
+        mesh.VertexPosition(i * (mesh.VertexCount() / 64)), 2, 2));
+  }
+  for (auto s : state) {
+    for (const Rect& query : queries) {
+      int count = 0;
+      shape->VisitIntersectedTriangles(
+          query, [&count](PartitionedMesh::TriangleIndexPair) {
+            ++count;
+            return PartitionedMesh::FlowControl::kContinue;
+          });
+      benchmark::DoNotOptimize(count);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * queries.size());
+}
+BENCHMARK(BM_HitTestWithTriangleOrder)->Apply(TriangleOrderArgs);
+
+// Measures the cost of `optimize_triangle_order` when constructing the mesh.
+void BM_FromMutableMeshWithTriangleOrder(benchmark::State& state) {
+  MutableMesh mesh = MakeTriangleOrderMesh(
+      static_cast<TriangleOrderMeshShape>(state.range(0)), state.range(1));
+  for (auto s : state) {
+    absl::StatusOr<PartitionedMesh> shape =
+        FromMutableMeshWithTriangleOrder(mesh, state.range(2));
+    ABSL_CHECK_OK(shape);
+    benchmark::DoNotOptimize(shape);
+  }
+  state.SetItemsProcessed(state.iterations() * mesh.TriangleCount());
+}
+BENCHMARK(BM_FromMutableMeshWithTriangleOrder)->Apply(TriangleOrderArgs);
+
+}  // namespace
+}  // namespace ink
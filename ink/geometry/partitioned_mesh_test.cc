@@ -15,13 +15,17 @@
 #include "ink/geometry/partitioned_mesh.h"
 
 #include <cmath>
+#include <cstddef>
 #include <cstdint>
+#include <limits>
 #include <utility>
 #include <vector>
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include "absl/algorithm/container.h"
 #include "absl/container/inlined_vector.h"
+#include "absl/functional/function_ref.h"
 #include "absl/log/absl_check.h"
 #include "absl/status/status.h"
 #include "absl/status/status_matchers.h"
@@ -31,6 +35,7 @@
 #include "absl/types/span.h"
 #include "ink/geometry/affine_transform.h"
 #include "ink/geometry/angle.h"
+#include "ink/geometry/distance.h"
 #include "ink/geometry/mesh.h"
 #include "ink/geometry/mesh_format.h"
 #include "ink/geometry/mesh_packing_types.h"
@@ -42,23 +47,31 @@
 #include "ink/geometry/segment.h"
 #include "ink/geometry/triangle.h"
 #include "ink/geometry/type_matchers.h"
+#include "ink/geometry/vec.h"
 
 namespace ink {
 namespace {
 
 using ::absl_testing::IsOk;
+using ::absl_testing::StatusIs;
 using ::testing::AllOf;
 using ::testing::AnyOf;
+using ::testing::Each;
 using ::testing::ElementsAre;
+using ::testing::ElementsAreArray;
 using ::testing::Eq;
 using ::testing::ExplainMatchResult;
 using ::testing::Field;
 using ::testing::FloatNear;
+using ::testing::Gt;
 using ::testing::HasSubstr;
 using ::testing::IsEmpty;
 using ::testing::Matcher;
+using ::testing::Not;
+using ::testing::Pair;
 using ::testing::SizeIs;
 using ::testing::UnorderedElementsAre;
+using ::testing::UnorderedElementsAreArray;
 
 MATCHER_P(TriangleIndexPairEqMatcher, expected,
           absl::StrCat(negation ? "doesn't equal" : "equals",
@@ -260,6 +273,31 @@ TEST(PartitionedMeshTest, FromMutableMeshThatRequiresPartitioningWithOutlines) {
   EXPECT_THAT(shape->OutlinePosition(0, 1, 3), PointNear({99996, 0}, 24.5));
 }
 
+TEST(PartitionedMeshTest, FromMutableMeshWith32BitPackedIndicesWithOutlines) {
+  absl::StatusOr<MeshFormat> format =
+      MeshFormat::Create({{MeshFormat::AttributeType::kFloat2Unpacked,
+                           MeshFormat::AttributeId::kPosition}},
+                         MeshFormat::IndexFormat::k32BitUnpacked32BitPacked);
+  ASSERT_EQ(format.status(), absl::OkStatus());
+  MutableMesh mutable_mesh = MakeStraightLineMutableMesh(1e5, *format);
+
+  absl::StatusOr<PartitionedMesh> shape = PartitionedMesh::FromMutableMesh(
+      mutable_mesh, {{0, 1, 99999, 99998}});
+
+  ASSERT_EQ(shape.status(), absl::OkStatus());
+  // Unlike with 16-bit indices, the mesh is not partitioned, so the outline
+  // refers to vertex indices greater than 2^16.
+  ASSERT_THAT(shape->Meshes(), SizeIs(1));
+  EXPECT_EQ(shape->Meshes()[0].VertexCount(), 100002);
+  ASSERT_EQ(shape->OutlineCount(0), 1);
+  EXPECT_THAT(shape->Outline(0, 0),
+              ElementsAre(VertexIndexPairEq({0, 0}), VertexIndexPairEq({0, 1}),
+                          VertexIndexPairEq({0, 99999}),
+                          VertexIndexPairEq({0, 99998})));
+  EXPECT_THAT(shape->OutlinePosition(0, 0, 2), PointEq({99999, -1}));
+  EXPECT_THAT(shape->OutlinePosition(0, 0, 3), PointEq({99998, 0}));
+}
+
 TEST(PartitionedMeshTest, FromMutableMeshOmitAttribute) {
   absl::StatusOr<MeshFormat> original_format =
       MeshFormat::Create({{MeshFormat::AttributeType::kFloat3PackedIn2Floats,
@@ -470,6 +508,30 @@ TEST(PartitionedMeshTest, FromMeshesTooManyMeshes) {
   EXPECT_THAT(has_too_many_meshes.message(), HasSubstr("Too many meshes"));
 }
 
+TEST(PartitionedMeshTest, FromMeshesTooManyTriangles) {
+  // Repeat one triangle 70,000 times, so that 65,535 copies of the mesh (which
+  // share their data) hold more than 2^32 - 1 triangles.
+  std::vector<float> x = {0, 1, 0};
+  std::vector<float> y = {0, 0, 1};
+  std::vector<uint32_t> indices;
+  for (int i = 0; i < 70000; ++i) {
+    indices.insert(indices.end(), {0, 1, 2});
+  }
+  absl::StatusOr<Mesh> mesh = Mesh::Create(MeshFormat(), {x, y}, indices);
+  ASSERT_EQ(mesh.status(), absl::OkStatus());
+  std::vector<Mesh> meshes(65535, *mesh);
+
+  absl::Status too_many_triangles =
+      PartitionedMesh::FromMeshes(absl::MakeSpan(meshes)).status();
+  EXPECT_EQ(too_many_triangles.code(), absl::StatusCode::kInvalidArgument);
+  EXPECT_THAT(too_many_triangles.message(), HasSubstr("Too many triangles"));
+
+  // Just under the limit is fine.
+  meshes.resize(61356);
+  EXPECT_EQ(PartitionedMesh::FromMeshes(absl::MakeSpan(meshes)).status(),
+            absl::OkStatus());
+}
+
 TEST(PartitionedMeshTest, FromMeshesEmptyMesh) {
   Mesh empty;
   absl::Status no_triangles =
@@ -585,6 +647,77 @@ TEST(PartitionedMeshTest, FromMultipleMutableMeshGroups) {
   EXPECT_FALSE(shape->IsSpatialIndexInitialized());
 }
 
+TEST(PartitionedMeshTest, FromMutableMeshGroupsWithOptimizedTriangleOrder) {
+  // Build a strip whose triangles are in the reverse of their usual order, so
+  // that reordering them has an effect.
+  MutableMesh strip = MakeStraightLineMutableMesh(10);
+  MutableMesh mutable_mesh = strip.Clone();
+  for (uint32_t i = 0; i < strip.TriangleCount(); ++i) {
+    mutable_mesh.SetTriangleIndices(
+        i, strip.TriangleIndices(strip.TriangleCount() - 1 - i));
+  }
+  std::vector<Matcher<Triangle>> expected_triangles;
+  for (uint32_t i = 0; i < mutable_mesh.TriangleCount(); ++i) {
+    expected_triangles.push_back(TriangleEq(mutable_mesh.GetTriangle(i)));
+  }
+  std::vector<uint32_t> outline = {0, 1, 11, 10};
+
+  absl::StatusOr<PartitionedMesh> shape =
+      PartitionedMesh::FromMutableMeshGroups({PartitionedMesh::MutableMeshGroup{
+          .mesh = &mutable_mesh,
+          .outlines = {outline},
+          .optimize_triangle_order = true,
+      }});
+  ASSERT_EQ(shape.status(), absl::OkStatus());
+
+  // The same triangles, with the same winding, are still present, and the
+  // outline still refers to the same positions.
+  ASSERT_THAT(shape->Meshes(), SizeIs(1));
+  const Mesh& mesh = shape->Meshes()[0];
+  EXPECT_EQ(mesh.VertexCount(), mutable_mesh.VertexCount());
+  std::vector<Triangle> actual_triangles;
+  for (uint32_t i = 0; i < mesh.TriangleCount(); ++i) {
+    actual_triangles.push_back(mesh.GetTriangle(i));
+  }
+  EXPECT_THAT(actual_triangles, UnorderedElementsAreArray(expected_triangles));
+  ASSERT_EQ(shape->OutlineCount(0), 1u);
+  ASSERT_EQ(shape->Outline(0, 0).size(), outline.size());
+  for (uint32_t i = 0; i < outline.size(); ++i) {
+    EXPECT_THAT(shape->OutlinePosition(0, 0, i),
+                PointEq(mutable_mesh.VertexPosition(outline[i])));
+  }
+
+  // The input mesh is left as-is.
+  EXPECT_THAT(mutable_mesh.GetTriangle(0), TriangleEq(strip.GetTriangle(9)));
+}
+
+TEST(PartitionedMeshTest,
+     FromMutableMeshGroupsWithOptimizedTriangleOrderThatRequiresPartitioning) {
+  MutableMesh mutable_mesh =
+      MakeStraightLineMutableMesh(1e5, MakeSinglePackedPositionFormat());
+  std::vector<uint32_t> outline = {0, 1, 99999, 99998};
+
+  absl::StatusOr<PartitionedMesh> shape =
+      PartitionedMesh::FromMutableMeshGroups({PartitionedMesh::MutableMeshGroup{
+          .mesh = &mutable_mesh,
+          .outlines = {outline},
+          .optimize_triangle_order = true,
+      }});
+  ASSERT_EQ(shape.status(), absl::OkStatus());
+
+  ASSERT_THAT(shape->Meshes(), SizeIs(2));
+  EXPECT_EQ(shape->Meshes()[0].TriangleCount() +
+                shape->Meshes()[1].TriangleCount(),
+            mutable_mesh.TriangleCount());
+  ASSERT_EQ(shape->OutlineCount(0), 1u);
+  // As in `FromMutableMeshThatRequiresPartitioningWithOutlines`, the bounds of
+  // the mesh give a maximum error of ~24.4 in the x-coordinate.
+  EXPECT_THAT(shape->OutlinePosition(0, 0, 0), PointNear({0, 0}, 24.5));
+  EXPECT_THAT(shape->OutlinePosition(0, 0, 1), PointNear({1, -1}, 24.5));
+  EXPECT_THAT(shape->OutlinePosition(0, 0, 2), PointNear({99999, -1}, 24.5));
+  EXPECT_THAT(shape->OutlinePosition(0, 0, 3), PointNear({99998, 0}, 24.5));
+}
+
 TEST(PartitionedMeshTest, FromMultipleMeshGroups) {
   absl::StatusOr<absl::InlinedVector<Mesh, 1>> meshes0 =
       MakeStraightLineMutableMesh(8).AsMeshes();
@@ -677,6 +810,51 @@ TEST(PartitionedMeshTest, InitializeSpatialIndexIsNoOpForEmptyPartitionedMesh) {
   EXPECT_FALSE(shape.IsSpatialIndexInitialized());
 }
 
+TEST(PartitionedMeshTest, InitializeSpatialIndexWithParallelFor) {
+  absl::StatusOr<PartitionedMesh> shape =
+      PartitionedMesh::FromMutableMesh(MakeStraightLineMutableMesh(5000));
+  ASSERT_EQ(shape.status(), absl::OkStatus());
+  std::vector<uint32_t> n_tasks_per_call;
+  auto run_serially = [&n_tasks_per_call](
+                          uint32_t n_tasks,
+                          absl::FunctionRef<void(uint32_t)> task) {
+    n_tasks_per_call.push_back(n_tasks);
+    for (uint32_t i = 0; i < n_tasks; ++i) task(i);
+  };
+
+  shape->InitializeSpatialIndex(run_serially);
+
+  EXPECT_TRUE(shape->IsSpatialIndexInitialized());
+  EXPECT_THAT(n_tasks_per_call, SizeIs(Gt(0)));
+}
+
+TEST(PartitionedMeshTest, InitializeSpatialIndices) {
+  absl::StatusOr<PartitionedMesh> line =
+      PartitionedMesh::FromMutableMesh(MakeStraightLineMutableMesh(100));
+  ASSERT_EQ(line.status(), absl::OkStatus());
+  absl::StatusOr<PartitionedMesh> star =
+      PartitionedMesh::FromMutableMesh(MakeStarMutableMesh(10));
+  ASSERT_EQ(star.status(), absl::OkStatus());
+  std::vector<PartitionedMesh> meshes = {*line, PartitionedMesh(), *star,
+                                         *line};
+  std::vector<uint32_t> n_tasks_per_call;
+  auto run_serially = [&n_tasks_per_call](
+                          uint32_t n_tasks,
+                          absl::FunctionRef<void(uint32_t)> task) {
+    n_tasks_per_call.push_back(n_tasks);
+    for (uint32_t i = 0; i < n_tasks; ++i) task(i);
+  };
+
+  PartitionedMesh::InitializeSpatialIndices(absl::MakeSpan(meshes),
+                                            run_serially);
+
+  // Each mesh is initialized in its own task.
+  EXPECT_THAT(n_tasks_per_call, ElementsAre(4));
+  EXPECT_TRUE(line->IsSpatialIndexInitialized());
+  EXPECT_TRUE(star->IsSpatialIndexInitialized());
+  EXPECT_FALSE(meshes[1].IsSpatialIndexInitialized());
+}
+
 // Helper function, visits all intersected triangles and returns them in a
 // vector.
 template <typename QueryType>
@@ -694,6 +872,83 @@ std::vector<PartitionedMesh::TriangleIndexPair> GetAllIntersectedTriangles(
   return tri_index_pairs;
 }
 
+TEST(PartitionedMeshTest, InitializeSpatialIndexFromSerialized) {
+  absl::StatusOr<PartitionedMesh> original = PartitionedMesh::FromMutableMesh(
+      MakeStraightLineMutableMesh(100, MakeSinglePackedPositionFormat()));
+  ASSERT_EQ(original.status(), absl::OkStatus());
+  std::vector<std::byte> serialized = original->SerializeSpatialIndex();
+  ASSERT_TRUE(original->IsSpatialIndexInitialized());
+  absl::StatusOr<PartitionedMesh> loaded = PartitionedMesh::FromMutableMesh(
+      MakeStraightLineMutableMesh(100, MakeSinglePackedPositionFormat()));
+  ASSERT_EQ(loaded.status(), absl::OkStatus());
+
+  EXPECT_THAT(loaded->InitializeSpatialIndexFromSerialized(serialized),
+              IsOk());
+
+  EXPECT_TRUE(loaded->IsSpatialIndexInitialized());
+  Rect query = Rect::FromTwoPoints({10, -1}, {20, 1});
+  std::vector<Matcher<PartitionedMesh::TriangleIndexPair>> expected;
+  for (PartitionedMesh::TriangleIndexPair idx :
+       GetAllIntersectedTriangles(*original, query)) {
+    expected.push_back(TriangleIndexPairEq(idx));
+  }
+  EXPECT_THAT(expected, Not(IsEmpty()));
+  EXPECT_THAT(GetAllIntersectedTriangles(*loaded, query),
+              UnorderedElementsAreArray(expected));
+}
+
+TEST(PartitionedMeshTest, InitializeSpatialIndexFromSerializedWithNoMeshes) {
+  PartitionedMesh shape;
+
+  EXPECT_THAT(shape.SerializeSpatialIndex(), IsEmpty());
+  EXPECT_THAT(shape.InitializeSpatialIndexFromSerialized({}), IsOk());
+  EXPECT_FALSE(shape.IsSpatialIndexInitialized());
+}
+
+TEST(PartitionedMeshTest,
+     InitializeSpatialIndexFromSerializedRejectsMismatchedIndex) {
+  absl::StatusOr<PartitionedMesh> line =
+      PartitionedMesh::FromMutableMesh(MakeStraightLineMutableMesh(100));
+  ASSERT_EQ(line.status(), absl::OkStatus());
+  absl::StatusOr<PartitionedMesh> shifted_line =
+      PartitionedMesh::FromMutableMesh(MakeStraightLineMutableMesh(
+          100, MeshFormat(), AffineTransform::Translate({0, 5})));
+  ASSERT_EQ(shifted_line.status(), absl::OkStatus());
+  absl::StatusOr<PartitionedMesh> shorter_line =
+      PartitionedMesh::FromMutableMesh(MakeStraightLineMutableMesh(50));
+  ASSERT_EQ(shorter_line.status(), absl::OkStatus());
+  absl::StatusOr<PartitionedMesh> longer_line =
+      PartitionedMesh::FromMutableMesh(MakeStraightLineMutableMesh(150));
+  ASSERT_EQ(longer_line.status(), absl::OkStatus());
+  std::vector<std::byte> serialized = line->SerializeSpatialIndex();
+
+  EXPECT_THAT(
+      shifted_line->InitializeSpatialIndexFromSerialized(serialized),
+      StatusIs(absl::StatusCode::kInvalidArgument, HasSubstr("wrong bounds")));
+  EXPECT_FALSE(shifted_line->IsSpatialIndexInitialized());
+  // Only checking the structure cannot detect the different geometry.
+  EXPECT_THAT(shifted_line->InitializeSpatialIndexFromSerialized(
+                  serialized,
+                  PartitionedMesh::SerializedSpatialIndexCheck::kStructure),
+              IsOk());
+  EXPECT_THAT(shorter_line->InitializeSpatialIndexFromSerialized(serialized),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("non-existent triangle")));
+  EXPECT_THAT(longer_line->InitializeSpatialIndexFromSerialized(serialized),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("contains 100 triangles, expected 150")));
+  EXPECT_THAT(
+      PartitionedMesh().InitializeSpatialIndexFromSerialized(serialized),
+      StatusIs(absl::StatusCode::kInvalidArgument, HasSubstr("no meshes")));
+  EXPECT_THAT(PartitionedMesh::WithEmptyGroups(2)
+                  .InitializeSpatialIndexFromSerialized(serialized),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("non-existent triangle")));
+  serialized.pop_back();
+  EXPECT_THAT(line->InitializeSpatialIndexFromSerialized(serialized),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
 TEST(PartitionedMeshTest, VisitIntersectedTrianglesPointQuery) {
   // This mesh will wrap around and partially overlap itself.
   PartitionedMesh shape = MakeCoiledRingPartitionedMesh(14, 6);
@@ -744,6 +999,28 @@ TEST(PartitionedMeshTest, VisitIntersectedTrianglesPointQueryMultipleMeshes) {
                   TriangleIndexPairEq({.mesh_index = 1, .triangle_index = 0})));
 }
 
+TEST(PartitionedMeshTest, VisitIntersectedTrianglesWith32BitPackedIndices) {
+  absl::StatusOr<MeshFormat> format =
+      MeshFormat::Create({{MeshFormat::AttributeType::kFloat2Unpacked,
+                           MeshFormat::AttributeId::kPosition}},
+                         MeshFormat::IndexFormat::k32BitUnpacked32BitPacked);
+  ASSERT_EQ(format.status(), absl::OkStatus());
+  absl::StatusOr<PartitionedMesh> shape = PartitionedMesh::FromMutableMesh(
+      MakeStraightLineMutableMesh(1e5, *format));
+  ASSERT_EQ(shape.status(), absl::OkStatus());
+  ASSERT_THAT(shape->Meshes(), SizeIs(1));
+
+  std::vector<PartitionedMesh::TriangleIndexPair> triangles =
+      GetAllIntersectedTriangles(*shape, Point{99990.25, -0.5});
+  EXPECT_THAT(triangles, Not(IsEmpty()));
+  EXPECT_THAT(triangles,
+              Each(AllOf(Field(&PartitionedMesh::TriangleIndexPair::mesh_index,
+                               Eq(0)),
+                         Field(&PartitionedMesh::TriangleIndexPair::
+                                   triangle_index,
+                               Gt(65535)))));
+}
+
 TEST(PartitionedMeshTest, VisitIntersectedTrianglesPointQueryEmptyShape) {
   PartitionedMesh shape;
 
@@ -1405,6 +1682,265 @@ TEST(PartitionedMeshTest, VisitIntersectedTrianglesWithReentrantVisitor) {
   shape.VisitIntersectedTriangles(query, visitor);
 }
 
+// Returns the triangles visited by
+// `PartitionedMesh::VisitIntersectedTrianglesBatch`, grouped by query index.
+template <typename QueryType>
+std::vector<std::vector<PartitionedMesh::TriangleIndexPair>>
+GetAllIntersectedTrianglesBatch(const PartitionedMesh& shape,
+                                absl::Span<const QueryType> queries,
+                                const AffineTransform query_to_shape = {}) {
+  std::vector<std::vector<PartitionedMesh::TriangleIndexPair>> tri_index_pairs(
+      queries.size());
+  shape.VisitIntersectedTrianglesBatch(
+      queries,
+      [&tri_index_pairs](uint32_t query_index,
+                         PartitionedMesh::TriangleIndexPair idx) {
+        tri_index_pairs[query_index].push_back(idx);
+        return PartitionedMesh::FlowControl::kContinue;
+      },
+      query_to_shape);
+  return tri_index_pairs;
+}
+
+TEST(PartitionedMeshTest, VisitIntersectedTrianglesBatchMatchesSingleQueries) {
+  // This mesh will wrap around and partially overlap itself.
+  PartitionedMesh shape = MakeCoiledRingPartitionedMesh(14, 6);
+  AffineTransform query_to_shape = AffineTransform::Scale(0.5);
+
+  std::vector<Point> points;
+  std::vector<Segment> segments;
+  for (int i = 0; i < 40; ++i) {
+    Point p = {-2.2f + 0.11f * i, 0.8f * std::sin(0.3f * i)};
+    points.push_back(p);
+    segments.push_back({p, p + Vec{0.3, 0.4}});
+  }
+
+  std::vector<std::vector<PartitionedMesh::TriangleIndexPair>> point_results =
+      GetAllIntersectedTrianglesBatch<Point>(shape, points, query_to_shape);
+  std::vector<std::vector<PartitionedMesh::TriangleIndexPair>>
+      segment_results = GetAllIntersectedTrianglesBatch<Segment>(
+          shape, segments, query_to_shape);
+  ASSERT_EQ(point_results.size(), points.size());
+  ASSERT_EQ(segment_results.size(), segments.size());
+  int n_hits = 0;
+  for (size_t i = 0; i < points.size(); ++i) {
+    std::vector<Matcher<PartitionedMesh::TriangleIndexPair>> expected;
+    for (auto idx : GetAllIntersectedTriangles(shape, points[i],
+                                               query_to_shape)) {
+      expected.push_back(TriangleIndexPairEq(idx));
+    }
+    EXPECT_THAT(point_results[i], UnorderedElementsAreArray(expected))
+        << "point index " << i;
+    n_hits += expected.size();
+
+    expected.clear();
+    for (auto idx : GetAllIntersectedTriangles(shape, segments[i],
+                                               query_to_shape)) {
+      expected.push_back(TriangleIndexPairEq(idx));
+    }
+    EXPECT_THAT(segment_results[i], UnorderedElementsAreArray(expected))
+        << "segment index " << i;
+    n_hits += expected.size();
+  }
+  // Make sure that the test is actually exercising something.
+  EXPECT_GT(n_hits, 0);
+}
+
+TEST(PartitionedMeshTest, VisitIntersectedTrianglesBatchExitEarlyPerQuery) {
+  PartitionedMesh shape = MakeStraightLinePartitionedMesh(3);
+  // Both queries cross all three triangles.
+  std::vector<Segment> queries = {{{-1, -.5}, {5, -.5}}, {{-1, -.5}, {5, -.5}}};
+
+  std::vector<PartitionedMesh::TriangleIndexPair> visited[2];
+  shape.VisitIntersectedTrianglesBatch(
+      absl::MakeConstSpan(queries),
+      [&visited](uint32_t query_index, PartitionedMesh::TriangleIndexPair idx) {
+        visited[query_index].push_back(idx);
+        return query_index == 0 ? PartitionedMesh::FlowControl::kBreak
+                                : PartitionedMesh::FlowControl::kContinue;
+      });
+
+  EXPECT_THAT(visited[0], SizeIs(1));
+  EXPECT_THAT(visited[1], SizeIs(3));
+}
+
+TEST(PartitionedMeshTest, VisitIntersectedTrianglesBatchEmptyShape) {
+  PartitionedMesh shape;
+  std::vector<Point> queries = {{0, 0}, {1, 1}};
+
+  EXPECT_THAT(GetAllIntersectedTrianglesBatch<Point>(shape, queries),
+              ElementsAre(IsEmpty(), IsEmpty()));
+}
+
+// Returns the index and distance of each triangle visited by
+// `PartitionedMesh::VisitNearestTriangles`, in the order in which they were
+// visited.
+template <typename QueryType>
+std::vector<std::pair<PartitionedMesh::TriangleIndexPair, float>>
+GetNearestTriangles(const PartitionedMesh& shape, const QueryType& query,
+                    uint32_t max_count,
+                    float max_distance = std::numeric_limits<float>::infinity(),
+                    const AffineTransform& shape_to_query = {}) {
+  std::vector<std::pair<PartitionedMesh::TriangleIndexPair, float>> result;
+  shape.VisitNearestTriangles(
+      query, max_count, max_distance,
+      [&result](PartitionedMesh::TriangleIndexPair idx, float distance) {
+        result.push_back({idx, distance});
+        return PartitionedMesh::FlowControl::kContinue;
+      },
+      shape_to_query);
+  return result;
+}
+
+Matcher<std::pair<PartitionedMesh::TriangleIndexPair, float>>
+NearestTriangleEq(PartitionedMesh::TriangleIndexPair idx_pair, float distance) {
+  return Pair(TriangleIndexPairEq(idx_pair), FloatNear(distance, 1e-5));
+}
+
+TEST(PartitionedMeshTest, VisitNearestTrianglesPointQuery) {
+  // The triangles of this mesh are (0, 0), (1, -1), (2, 0); (1, -1), (3, -1),
+  // (2, 0); and (2, 0), (3, -1), (4, 0).
+  PartitionedMesh shape = MakeStraightLinePartitionedMesh(3);
+
+  EXPECT_THAT(
+      GetNearestTriangles(shape, Point{6, -1}, 3),
+      ElementsAre(
+          NearestTriangleEq({.mesh_index = 0, .triangle_index = 2},
+                            std::sqrt(5)),
+          NearestTriangleEq({.mesh_index = 0, .triangle_index = 1}, 3),
+          NearestTriangleEq({.mesh_index = 0, .triangle_index = 0},
+                            std::sqrt(17))));
+  // A point inside the mesh has a distance of zero to its triangle.
+  EXPECT_THAT(GetNearestTriangles(shape, Point{1, -.5}, 1),
+              ElementsAre(NearestTriangleEq(
+                  {.mesh_index = 0, .triangle_index = 0}, 0)));
+}
+
+TEST(PartitionedMeshTest, VisitNearestTrianglesRespectsMaxCountAndDistance) {
+  PartitionedMesh shape = MakeStraightLinePartitionedMesh(3);
+
+  EXPECT_THAT(GetNearestTriangles(shape, Point{6, -1}, 2),
+              ElementsAre(NearestTriangleEq(
+                              {.mesh_index = 0, .triangle_index = 2},
+                              std::sqrt(5)),
+                          NearestTriangleEq(
+                              {.mesh_index = 0, .triangle_index = 1}, 3)));
+  EXPECT_THAT(GetNearestTriangles(shape, Point{6, -1}, 3, 2.5),
+              ElementsAre(NearestTriangleEq(
+                  {.mesh_index = 0, .triangle_index = 2}, std::sqrt(5))));
+  EXPECT_THAT(GetNearestTriangles(shape, Point{6, -1}, 3, 2), IsEmpty());
+  EXPECT_THAT(GetNearestTriangles(shape, Point{6, -1}, 0), IsEmpty());
+}
+
+TEST(PartitionedMeshTest, VisitNearestTrianglesWithTransform) {
+  PartitionedMesh shape = MakeStraightLinePartitionedMesh(3);
+
+  // Distances are measured in the query's coordinate space, so scaling the
+  // shape up also scales up the distances.
+  EXPECT_THAT(
+      GetNearestTriangles(shape, Point{12, -2}, 2,
+                          std::numeric_limits<float>::infinity(),
+                          AffineTransform::Scale(2)),
+      ElementsAre(
+          NearestTriangleEq({.mesh_index = 0, .triangle_index = 2},
+                            2 * std::sqrt(5)),
+          NearestTriangleEq({.mesh_index = 0, .triangle_index = 1}, 6)));
+  // This transform collapses the shape to the segment from (1, 4) to (5, 4),
+  // so every triangle is the same distance away.
+  EXPECT_THAT(
+      GetNearestTriangles(shape, Point{3, 6}, 3,
+                          std::numeric_limits<float>::infinity(),
+                          AffineTransform(1, 0, 1, 0, 0, 4)),
+      UnorderedElementsAre(
+          NearestTriangleEq({.mesh_index = 0, .triangle_index = 0}, 2),
+          NearestTriangleEq({.mesh_index = 0, .triangle_index = 1}, 2),
+          NearestTriangleEq({.mesh_index = 0, .triangle_index = 2}, 2)));
+}
+
+TEST(PartitionedMeshTest, VisitNearestTrianglesOtherQueryTypes) {
+  PartitionedMesh shape = MakeStraightLinePartitionedMesh(3);
+  PartitionedMesh::TriangleIndexPair last_triangle = {.mesh_index = 0,
+                                                      .triangle_index = 2};
+
+  EXPECT_THAT(GetNearestTriangles(shape, Segment{{5, -3}, {5, 3}}, 1),
+              ElementsAre(NearestTriangleEq(last_triangle, 1)));
+  EXPECT_THAT(
+      GetNearestTriangles(shape, Triangle{{5, 1}, {6, 1}, {6, 2}}, 1),
+      ElementsAre(NearestTriangleEq(last_triangle, std::sqrt(2))));
+  EXPECT_THAT(
+      GetNearestTriangles(shape, Rect::FromTwoPoints({6, 1}, {7, 2}), 1),
+      ElementsAre(NearestTriangleEq(last_triangle, std::sqrt(5))));
+  EXPECT_THAT(GetNearestTriangles(
+                  shape, Quad::FromCenterAndDimensions({7, 1}, 2, 2), 1),
+              ElementsAre(NearestTriangleEq(last_triangle, std::sqrt(4))));
+}
+
+TEST(PartitionedMeshTest, VisitNearestTrianglesMatchesBruteForce) {
+  // This mesh will wrap around and partially overlap itself, and spans
+  // multiple meshes.
+  absl::StatusOr<absl::InlinedVector<Mesh, 1>> first_mesh =
+      MakeCoiledRingMutableMesh(50, 12).AsMeshes();
+  ASSERT_EQ(first_mesh.status(), absl::OkStatus());
+  absl::StatusOr<absl::InlinedVector<Mesh, 1>> second_mesh =
+      MakeStarMutableMesh(30).AsMeshes();
+  ASSERT_EQ(second_mesh.status(), absl::OkStatus());
+  Mesh meshes[2] = {std::move((*first_mesh)[0]), std::move((*second_mesh)[0])};
+  absl::StatusOr<PartitionedMesh> shape =
+      PartitionedMesh::FromMeshes(absl::MakeSpan(meshes));
+  ASSERT_EQ(shape.status(), absl::OkStatus());
+
+  for (Point query : {Point{0, 0}, Point{3, 1}, Point{-.5, .9}, Point{0, -7}}) {
+    std::vector<float> expected_distances;
+    for (const Mesh& mesh : shape->Meshes()) {
+      for (uint32_t i = 0; i < mesh.TriangleCount(); ++i) {
+        expected_distances.push_back(Distance(query, mesh.GetTriangle(i)));
+      }
+    }
+    absl::c_sort(expected_distances);
+    expected_distances.resize(10);
+
+    std::vector<float> distances;
+    for (const auto& [idx, distance] : GetNearestTriangles(*shape, query, 10)) {
+      EXPECT_FLOAT_EQ(distance,
+                      Distance(query, shape->Meshes()[idx.mesh_index]
+                                          .GetTriangle(idx.triangle_index)));
+      distances.push_back(distance);
+    }
+    EXPECT_THAT(distances, ElementsAreArray(expected_distances));
+  }
+}
+
+TEST(PartitionedMeshTest, VisitNearestTrianglesExitEarly) {
+  PartitionedMesh shape = MakeStraightLinePartitionedMesh(3);
+  std::vector<PartitionedMesh::TriangleIndexPair> visited_tris;
+
+  shape.VisitNearestTriangles(
+      Point{6, -1}, 3, std::numeric_limits<float>::infinity(),
+      [&visited_tris](PartitionedMesh::TriangleIndexPair idx, float) {
+        visited_tris.push_back(idx);
+        return PartitionedMesh::FlowControl::kBreak;
+      });
+
+  EXPECT_THAT(visited_tris, ElementsAre(TriangleIndexPairEq(
+                                {.mesh_index = 0, .triangle_index = 2})));
+}
+
+TEST(PartitionedMeshTest, VisitNearestTrianglesEmptyShape) {
+  PartitionedMesh shape;
+
+  EXPECT_THAT(GetNearestTriangles(shape, Point{0, 0}, 10), IsEmpty());
+  // An empty shape never has a spatial index.
+  EXPECT_FALSE(shape.IsSpatialIndexInitialized());
+}
+
+TEST(PartitionedMeshTest, VisitNearestTrianglesInitializesTheSpatialIndex) {
+  PartitionedMesh shape = MakeCoiledRingPartitionedMesh(14, 6);
+
+  GetNearestTriangles(shape, Point{0, 0}, 1);
+
+  EXPECT_TRUE(shape.IsSpatialIndexInitialized());
+}
+
 // Returns a `PartitionedMesh` with four triangles in a row along the x-axis,
 // each with a base of one unit, and with heights of 1, 2, 3, and 4 units. Each
 // triangle has a different area (to facilitate testing `Coverage` and
@@ -14,7 +14,9 @@
 
 #include "ink/rendering/skia/common_internal/mesh_specification_data.h"
 
+#include <cstdint>
 #include <optional>
+#include <utility>
 
 #include "absl/container/inlined_vector.h"
 #include "absl/log/absl_check.h"
@@ -204,6 +206,83 @@ MeshSpecificationData MeshSpecificationData::CreateForInProgressStroke() {
   };
 }
 
+MeshSpecificationData MeshSpecificationData::CreateForStrokeBatch() {
+  static_assert(kObjectToCanvasLinearComponentName ==
+                "uObjectToCanvasLinearComponent");
+  static_assert(kTextureMappingName == "uTextureMapping");
+  // The brush color varies per vertex, so it is an attribute instead of the
+  // `uBrushColor` uniform. Vertices of strokes without HSL color shift have a
+  // zero shift, for which the color is computed as for a stroke without that
+  // attribute.
+  constexpr absl::string_view kVertexMain = R"(
+      uniform float4 uObjectToCanvasLinearComponent;
+      uniform int uTextureMapping;
+
+      Varyings main(const Attributes attributes) {
+        Varyings varyings;
+        varyings.position = attributes.positionAndOpacityShift.xy;
+
+        varyings.position += calculateAntialiasingAndPositionOutset(
+            attributes.sideDerivativeAndLabel,
+            attributes.forwardDerivativeAndLabel,
+            mat2FromFloat4ColumnMajor(uObjectToCanvasLinearComponent),
+            varyings.pixelsPerDimension,
+            varyings.normalizedToEdgeLRFB,
+            varyings.outsetPixelsLRFB);
+
+        if (attributes.hslShift == float3(0)) {
+          float a = applyOpacityShift(attributes.positionAndOpacityShift.z,
+                                      attributes.brushColor.a);
+          varyings.color = float4(attributes.brushColor.rgb * a, a);
+        } else {
+          varyings.color = applyHSLAndOpacityShift(
+              attributes.hslShift, attributes.positionAndOpacityShift.z,
+              attributes.brushColor);
+          varyings.color.rgb *= varyings.color.a;
+        }
+
+        if (uTextureMapping == 1) {
+          varyings.textureCoords = attributes.surfaceUv;
+        } else {
+          varyings.textureCoords = varyings.position;
+        }
+
+        return varyings;
+      }
+  )";
+  static_assert(static_cast<int>(BrushPaint::TextureMapping::kWinding) == 1);
+
+  // Start from the in-progress stroke attributes, which use the same unpacked
+  // layout, and append the brush color after the `StrokeVertex`.
+  MeshSpecificationData in_progress_data = CreateForInProgressStroke();
+  int32_t stroke_vertex_stride = in_progress_data.vertex_stride;
+  constexpr int kRenderingAttributeCount = 6;
+  SmallArray<Attribute, kMaxAttributes> rendering_attributes(
+      kRenderingAttributeCount);
+  for (int i = 0; i < in_progress_data.attributes.Size(); ++i) {
+    rendering_attributes[i] = in_progress_data.attributes[i];
+  }
+  rendering_attributes[kRenderingAttributeCount - 1] = {
+      .type = AttributeType::kFloat4,
+      .offset = stroke_vertex_stride,
+      .name = "brushColor"};
+
+  return MeshSpecificationData{
+      .attributes = rendering_attributes,
+      .vertex_stride =
+          stroke_vertex_stride + static_cast<int32_t>(4 * sizeof(float)),
+      .varyings = in_progress_data.varyings,
+      .uniforms = {{.type = UniformType::kFloat4,
+                    .id = UniformId::kObjectToCanvasLinearComponent},
+                   {.type = UniformType::kInt,
+                    .id = UniformId::kTextureMapping}},
+      .vertex_shader_source = absl::StrCat(
+          kSkSLCommonShaderHelpers, kSkSLVertexShaderHelpers, kVertexMain),
+      .fragment_shader_source =
+          std::move(in_progress_data.fragment_shader_source),
+  };
+}
+
 namespace {
 
 // Returns the supported `AttributeType` for the combined packed
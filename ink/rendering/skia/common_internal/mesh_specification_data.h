@@ -56,6 +56,7 @@ struct MeshSpecificationData {
   enum class AttributeType {
     kFloat2 = 1,
     kFloat3 = 2,
+    kFloat4 = 3,
     kUByte4 = 4,
   };
   enum class VaryingType {
@@ -160,6 +161,17 @@ struct MeshSpecificationData {
   static absl::StatusOr<MeshSpecificationData> CreateForStroke(
       const MeshFormat& mesh_format);
 
+  // Returns data for rendering the meshes of several strokes in one draw.
+  //
+  // Each vertex holds a `StrokeVertex`, laid out as in a `MutableMesh` with
+  // `StrokeVertex::FullMeshFormat()`, immediately followed by the brush color
+  // of its stroke as four floats, in the same color space as the
+  // `kBrushColor` uniform of the other specifications. The per-stroke
+  // position and unpacking transforms must already be applied to the vertex
+  // values, so the only uniforms are the object-to-canvas linear component and
+  // texture mapping, which are shared by every stroke in the draw.
+  static MeshSpecificationData CreateForStrokeBatch();
+
   SmallArray<Attribute, kMaxAttributes> attributes;
   int32_t vertex_stride;
   SmallArray<Varying, kMaxVaryings> varyings;
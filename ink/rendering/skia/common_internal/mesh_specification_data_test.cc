@@ -45,6 +45,7 @@ bool IsValidAttributeType(MeshSpecificationData::AttributeType type) {
   switch (type) {
     case MeshSpecificationData::AttributeType::kFloat2:
     case MeshSpecificationData::AttributeType::kFloat3:
+    case MeshSpecificationData::AttributeType::kFloat4:
     case MeshSpecificationData::AttributeType::kUByte4:
       return true;
   }
@@ -221,6 +222,38 @@ TEST(MeshSpecificationDataTest, CreateForInProgressStroke) {
                         StrokeVertex::FullMeshFormat()));
 }
 
+TEST(MeshSpecificationDataTest, CreateForStrokeBatch) {
+  auto data = MeshSpecificationData::CreateForStrokeBatch();
+  auto in_progress_data = MeshSpecificationData::CreateForInProgressStroke();
+  int stroke_vertex_stride =
+      StrokeVertex::FullMeshFormat().UnpackedVertexStride();
+
+  // The vertices are in-progress stroke vertices followed by a brush color.
+  ASSERT_EQ(data.attributes.Size(), in_progress_data.attributes.Size() + 1);
+  for (int i = 0; i < in_progress_data.attributes.Size(); ++i) {
+    EXPECT_EQ(data.attributes[i].type, in_progress_data.attributes[i].type);
+    EXPECT_EQ(data.attributes[i].offset, in_progress_data.attributes[i].offset);
+    EXPECT_EQ(data.attributes[i].name, in_progress_data.attributes[i].name);
+  }
+  const MeshSpecificationData::Attribute& color =
+      data.attributes.Values().back();
+  EXPECT_EQ(color.type, MeshSpecificationData::AttributeType::kFloat4);
+  EXPECT_EQ(color.offset, stroke_vertex_stride);
+  EXPECT_EQ(data.vertex_stride, stroke_vertex_stride + 16);
+
+  // Only the uniforms shared by every stroke in a draw remain.
+  ASSERT_EQ(data.uniforms.Size(), 2);
+  EXPECT_EQ(data.uniforms[0].id,
+            MeshSpecificationData::UniformId::kObjectToCanvasLinearComponent);
+  EXPECT_EQ(data.uniforms[1].id,
+            MeshSpecificationData::UniformId::kTextureMapping);
+  EXPECT_THAT(data.vertex_shader_source, Not(HasSubstr("uBrushColor")));
+  EXPECT_EQ(data.fragment_shader_source,
+            in_progress_data.fragment_shader_source);
+  EXPECT_THAT(data, SpecificationDataHasValidShaderVariableValues(
+                        StrokeVertex::FullMeshFormat()));
+}
+
 TEST(MeshSpecificationDataTest, CreateFromFullMeshFormatIsOk) {
   EXPECT_EQ(MeshSpecificationData::CreateForInProgressStroke(
                 StrokeVertex::FullMeshFormat())
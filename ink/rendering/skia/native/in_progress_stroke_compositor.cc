@@ -0,0 +1,204 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ink/rendering/skia/native/in_progress_stroke_compositor.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+
+#include "absl/functional/function_ref.h"
+#include "absl/log/absl_check.h"
+#include "absl/status/status.h"
+#include "ink/geometry/affine_transform.h"
+#include "ink/geometry/envelope.h"
+#include "ink/geometry/rect.h"
+#include "ink/rendering/skia/native/skia_renderer.h"
+#include "ink/strokes/in_progress_stroke.h"
+#include "include/core/SkBitmap.h"
+#include "include/core/SkCanvas.h"
+#include "include/core/SkColor.h"
+#include "include/core/SkRect.h"
+#include "include/core/SkRegion.h"
+
+namespace ink {
+namespace {
+
+// The distance in pixels by which anti-aliasing may extend the drawing of a
+// mesh beyond its bounds.
+constexpr float kAntiAliasingMargin = 1;
+
+bool AreEqual(const AffineTransform& a, const AffineTransform& b) {
+  return a.A() == b.A() && a.B() == b.B() && a.C() == b.C() &&
+         a.D() == b.D() && a.E() == b.E() && a.F() == b.F();
+}
+
+bool Intersects(const Rect& rect, const SkIRect& tile_bounds) {
+  return rect.XMax() >= tile_bounds.left() &&
+         rect.XMin() < tile_bounds.right() &&
+         rect.YMax() >= tile_bounds.top() &&
+         rect.YMin() < tile_bounds.bottom();
+}
+
+std::optional<Rect> StrokeBounds(const InProgressStroke& stroke) {
+  Envelope bounds;
+  for (uint32_t coat_index = 0; coat_index < stroke.BrushCoatCount();
+       ++coat_index) {
+    bounds.Add(stroke.GetMeshBounds(coat_index));
+  }
+  return bounds.AsRect();
+}
+
+}  // namespace
+
+InProgressStrokeCompositor::InProgressStrokeCompositor(int width, int height,
+                                                       int tile_size)
+    : width_(width), height_(height), tile_size_(tile_size) {
+  ABSL_CHECK_GT(width, 0);
+  ABSL_CHECK_GT(height, 0);
+  ABSL_CHECK_GT(tile_size, 0);
+  columns_ = (width + tile_size - 1) / tile_size;
+  rows_ = (height + tile_size - 1) / tile_size;
+  tiles_.resize(columns_ * rows_);
+  frame_.allocN32Pixels(width, height);
+  frame_.eraseColor(SK_ColorTRANSPARENT);
+}
+
+absl::Status InProgressStrokeCompositor::Update(
+    SkiaRenderer& renderer, const InProgressStroke& stroke,
+    const AffineTransform& object_to_canvas, DrawSceneFunction draw_scene) {
+  last_frame_stats_ = {};
+
+  std::optional<Rect> stroke_region =
+      FrameRegion(StrokeBounds(stroke), object_to_canvas);
+  uint64_t stroke_id = stroke.GetMeshVersion().stroke_id;
+  if (stroke_id != last_stroke_id_ || !last_object_to_canvas_.has_value() ||
+      !AreEqual(*last_object_to_canvas_, object_to_canvas)) {
+    // The stroke may have moved anywhere, so erase it from every tile it was
+    // drawn on, and draw it on every tile it now covers.
+    for (Tile& tile : tiles_) {
+      if (tile.has_stroke) tile.is_dirty = true;
+    }
+    ForEachTileIntersecting(stroke_region,
+                            [](Tile& tile) { tile.is_dirty = true; });
+    last_stroke_id_ = stroke_id;
+    last_object_to_canvas_ = object_to_canvas;
+  } else {
+    ForEachTileIntersecting(
+        FrameRegion(stroke.GetUpdatedRegion().AsRect(), object_to_canvas),
+        [](Tile& tile) { tile.is_dirty = true; });
+  }
+
+  // Restore the scene of every dirty tile, then draw the stroke once, clipped
+  // to the dirty tiles that it covers.
+  SkRegion stroke_clip;
+  for (int tile_index = 0; tile_index < static_cast<int>(tiles_.size());
+       ++tile_index) {
+    Tile& tile = tiles_[tile_index];
+    if (!tile.is_dirty) continue;
+    SkIRect tile_bounds = TileBounds(tile_index);
+
+    if (!tile.scene_is_valid) {
+      if (tile.scene.drawsNothing()) {
+        tile.scene.allocN32Pixels(tile_bounds.width(), tile_bounds.height());
+      }
+      tile.scene.eraseColor(SK_ColorTRANSPARENT);
+      SkCanvas scene_canvas(tile.scene);
+      scene_canvas.translate(-tile_bounds.x(), -tile_bounds.y());
+      draw_scene(scene_canvas);
+      tile.scene_is_valid = true;
+    }
+    frame_.writePixels(tile.scene.pixmap(), tile_bounds.x(), tile_bounds.y());
+
+    tile.has_stroke = stroke_region.has_value() &&
+                      Intersects(*stroke_region, tile_bounds);
+    if (tile.has_stroke) stroke_clip.op(tile_bounds, SkRegion::kUnion_Op);
+
+    tile.is_dirty = false;
+    ++last_frame_stats_.tiles_redrawn;
+    last_frame_stats_.pixels_touched +=
+        static_cast<int64_t>(tile_bounds.width()) * tile_bounds.height();
+  }
+
+  if (stroke_clip.isEmpty()) return absl::OkStatus();
+  SkCanvas frame_canvas(frame_);
+  frame_canvas.clipRegion(stroke_clip);
+  absl::Status status =
+      renderer.Draw(nullptr, stroke, object_to_canvas, frame_canvas);
+  if (!status.ok()) {
+    // Redraw the tiles that may be missing the stroke on the next call.
+    for (Tile& tile : tiles_) {
+      if (tile.has_stroke) tile.is_dirty = true;
+    }
+  }
+  return status;
+}
+
+void InProgressStrokeCompositor::InvalidateScene(const Rect& region) {
+  ForEachTileIntersecting(region, [](Tile& tile) {
+    tile.scene_is_valid = false;
+    tile.is_dirty = true;
+  });
+}
+
+void InProgressStrokeCompositor::InvalidateScene() {
+  for (Tile& tile : tiles_) {
+    tile.scene_is_valid = false;
+    tile.is_dirty = true;
+  }
+}
+
+void InProgressStrokeCompositor::ForEachTileIntersecting(
+    const std::optional<Rect>& region, absl::FunctionRef<void(Tile&)> fn) {
+  if (!region.has_value() || region->XMax() < 0 || region->YMax() < 0 ||
+      region->XMin() >= width_ || region->YMin() >= height_) {
+    return;
+  }
+  // Clamp before converting to `int`, since the region may be arbitrarily
+  // large.
+  int first_column =
+      static_cast<int>(std::max(0.f, region->XMin())) / tile_size_;
+  int first_row = static_cast<int>(std::max(0.f, region->YMin())) / tile_size_;
+  int last_column =
+      static_cast<int>(std::min<float>(width_ - 1, region->XMax())) /
+      tile_size_;
+  int last_row =
+      static_cast<int>(std::min<float>(height_ - 1, region->YMax())) /
+      tile_size_;
+  for (int row = first_row; row <= last_row; ++row) {
+    for (int column = first_column; column <= last_column; ++column) {
+      fn(tiles_[row * columns_ + column]);
+    }
+  }
+}
+
+std::optional<Rect> InProgressStrokeCompositor::FrameRegion(
+    const std::optional<Rect>& stroke_region,
+    const AffineTransform& object_to_canvas) {
+  if (!stroke_region.has_value()) return std::nullopt;
+  std::optional<Rect> region =
+      Envelope(object_to_canvas.Apply(*stroke_region)).AsRect();
+  if (!region.has_value()) return std::nullopt;
+  region->Offset(kAntiAliasingMargin);
+  return region;
+}
+
+SkIRect InProgressStrokeCompositor::TileBounds(int tile_index) const {
+  int x = (tile_index % columns_) * tile_size_;
+  int y = (tile_index / columns_) * tile_size_;
+  return SkIRect::MakeLTRB(x, y, std::min(x + tile_size_, width_),
+                           std::min(y + tile_size_, height_));
+}
+
+}  // namespace ink
@@ -0,0 +1,155 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef INK_RENDERING_SKIA_NATIVE_IN_PROGRESS_STROKE_COMPOSITOR_H_
+#define INK_RENDERING_SKIA_NATIVE_IN_PROGRESS_STROKE_COMPOSITOR_H_
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "absl/functional/function_ref.h"
+#include "absl/status/status.h"
+#include "ink/geometry/affine_transform.h"
+#include "ink/geometry/rect.h"
+#include "ink/rendering/skia/native/skia_renderer.h"
+#include "ink/strokes/in_progress_stroke.h"
+#include "include/core/SkBitmap.h"
+#include "include/core/SkCanvas.h"
+#include "include/core/SkRect.h"
+
+namespace ink {
+
+// Composites an `InProgressStroke` over a static scene into a bitmap using
+// Skia's CPU raster backend, redrawing only the tiles that changed.
+//
+// The frame is divided into square tiles. The compositor keeps a raster cache
+// of the scene for each tile, which is drawn once and then reused until it is
+// invalidated. On each call to `Update()`, only the tiles that intersect the
+// region of the stroke that changed, as reported by
+// `InProgressStroke::GetUpdatedRegion()`, are redrawn by copying the cached
+// scene, and the stroke is then drawn once over all of them, clipped to their
+// union. The number of pixels touched by a frame is therefore proportional to
+// the size of the change, rather than the size of the frame.
+//
+// Without a `GrDirectContext`, `SkiaRenderer` draws each coat of the stroke as
+// a single path built from its outlines, so the whole stroke is still
+// converted to a path on every frame. Unlike `SkiaRenderer::Draw()` with a GPU
+// context, the settled start of the stroke is not cached in a raster, since a
+// path cannot be split at a triangle.
+//
+// Typical usage:
+//
+//   compositor.Update(renderer, stroke, object_to_canvas, draw_scene);
+//   stroke.ResetUpdatedRegion();
+//   // Present `compositor.Frame()`.
+//
+// When the stroke is finished and added to the scene, call `InvalidateScene()`
+// with its bounds, so that the tiles it covers are redrawn.
+//
+// This type is thread-compatible.
+class InProgressStrokeCompositor {
+ public:
+  // Counts of the work done by the most recent call to `Update()`.
+  struct FrameStats {
+    int tiles_redrawn = 0;
+    int64_t pixels_touched = 0;
+  };
+
+  // Draws the static scene into the `canvas`, in frame pixel coordinates. The
+  // canvas is clipped to the tile that is being drawn.
+  using DrawSceneFunction = absl::FunctionRef<void(SkCanvas& canvas)>;
+
+  static constexpr int kDefaultTileSize = 256;
+
+  // Constructs a compositor for a frame of `width` by `height` pixels.
+  //
+  // CHECK-fails if either dimension or `tile_size` is not positive.
+  InProgressStrokeCompositor(int width, int height,
+                             int tile_size = kDefaultTileSize);
+  InProgressStrokeCompositor(const InProgressStrokeCompositor&) = delete;
+  InProgressStrokeCompositor(InProgressStrokeCompositor&&) = default;
+  InProgressStrokeCompositor& operator=(const InProgressStrokeCompositor&) =
+      delete;
+  InProgressStrokeCompositor& operator=(InProgressStrokeCompositor&&) = default;
+  ~InProgressStrokeCompositor() = default;
+
+  // Brings the frame up to date with `stroke` drawn with `object_to_canvas`
+  // over the scene drawn by `draw_scene`.
+  //
+  // The tiles that are redrawn are those intersecting the region returned by
+  // `stroke.GetUpdatedRegion()`, the tiles whose scene was invalidated, and,
+  // if `stroke` was restarted or `object_to_canvas` changed since the previous
+  // call, every tile that the stroke was or is drawn on. `draw_scene` is only
+  // called for tiles whose cached scene is invalid.
+  //
+  // Callers should call `stroke.ResetUpdatedRegion()` after each call, so that
+  // the next call does not redraw tiles that have not changed again.
+  //
+  // Returns an error if `renderer` fails to draw the stroke.
+  absl::Status Update(SkiaRenderer& renderer, const InProgressStroke& stroke,
+                      const AffineTransform& object_to_canvas,
+                      DrawSceneFunction draw_scene);
+
+  // Marks the cached scene of the tiles intersecting `region`, in frame pixel
+  // coordinates, or of every tile, as invalid, so that they are redrawn by the
+  // next call to `Update()`.
+  void InvalidateScene(const Rect& region);
+  void InvalidateScene();
+
+  // Returns the composited frame.
+  const SkBitmap& Frame() const { return frame_; }
+
+  // Returns the work done by the most recent call to `Update()`.
+  const FrameStats& LastFrameStats() const { return last_frame_stats_; }
+
+ private:
+  struct Tile {
+    SkBitmap scene;
+    bool scene_is_valid = false;
+    // True if the tile has to be redrawn by the next call to `Update()`.
+    bool is_dirty = true;
+    // True if the stroke may have been drawn on the tile.
+    bool has_stroke = false;
+  };
+
+  // Calls `fn` with each tile intersecting `region`, in frame pixel
+  // coordinates.
+  void ForEachTileIntersecting(const std::optional<Rect>& region,
+                               absl::FunctionRef<void(Tile&)> fn);
+
+  // Returns the region in frame pixel coordinates that may be affected by
+  // drawing the `stroke_region` with `object_to_canvas`.
+  static std::optional<Rect> FrameRegion(
+      const std::optional<Rect>& stroke_region,
+      const AffineTransform& object_to_canvas);
+
+  SkIRect TileBounds(int tile_index) const;
+
+  int width_;
+  int height_;
+  int tile_size_;
+  int columns_;
+  int rows_;
+  std::vector<Tile> tiles_;
+  SkBitmap frame_;
+  // The stroke and transform drawn by the previous call to `Update()`.
+  uint64_t last_stroke_id_ = 0;
+  std::optional<AffineTransform> last_object_to_canvas_;
+  FrameStats last_frame_stats_;
+};
+
+}  // namespace ink
+
+#endif  // INK_RENDERING_SKIA_NATIVE_IN_PROGRESS_STROKE_COMPOSITOR_H_
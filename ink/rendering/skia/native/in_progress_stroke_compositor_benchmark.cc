@@ -0,0 +1,94 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "absl/log/absl_check.h"
+#include "absl/status/statusor.h"
+#include "benchmark/benchmark.h"
+#include "ink/brush/brush.h"
+#include "ink/brush/brush_family.h"
+#include "ink/brush/brush_paint.h"
+#include "ink/brush/brush_tip.h"
+#include "ink/color/color.h"
+#include "ink/geometry/affine_transform.h"
+#include "ink/geometry/rect.h"
+#include "ink/rendering/skia/native/in_progress_stroke_compositor.h"
+#include "ink/rendering/skia/native/skia_renderer.h"
+#include "ink/strokes/in_progress_stroke.h"
+#include "ink/strokes/input/recorded_test_inputs.h"
+#include "ink/strokes/input/stroke_input_batch.h"
+#include "ink/types/duration.h"
+#include "include/core/SkCanvas.h"
+#include "include/core/SkColor.h"
+
+namespace ink {
+namespace {
+
+constexpr int kFrameSize = 1024;
+
+Brush MakeBrush() {
+  absl::StatusOr<BrushFamily> family =
+      BrushFamily::Create(BrushTip{}, BrushPaint{});
+  ABSL_CHECK_OK(family);
+  absl::StatusOr<Brush> brush = Brush::Create(*family, Color::Black(), 5, 0.1);
+  ABSL_CHECK_OK(brush);
+  return *brush;
+}
+
+// Draws the recorded spring-shaped stroke over a `kFrameSize` square frame with
+// tiles of `state.range(0)` pixels, and reports the average number of pixels
+// redrawn per frame, compared to the size of the frame (which is what would be
+// redrawn on every frame without the compositor).
+void BM_InProgressStrokeCompositorPixelsPerFrame(benchmark::State& state) {
+  std::vector<std::pair<StrokeInputBatch, StrokeInputBatch>> inputs =
+      MakeIncrementalSpringShapeInputs(
+          Rect::FromTwoPoints({100, 100}, {900, 900}));
+  Brush brush = MakeBrush();
+  SkiaRenderer renderer;
+  InProgressStroke stroke;
+  auto draw_scene = [](SkCanvas& canvas) { canvas.clear(SK_ColorWHITE); };
+
+  size_t frame_count = 0;
+  int64_t pixels_touched = 0;
+  for (auto s : state) {
+    InProgressStrokeCompositor compositor(kFrameSize, kFrameSize,
+                                          state.range(0));
+    stroke.Start(brush);
+    for (size_t i = 0; i < inputs.size(); ++i) {
+      ABSL_CHECK_OK(stroke.EnqueueInputs(inputs[i].first, inputs[i].second));
+      ABSL_CHECK_OK(stroke.UpdateShape(Duration32::Seconds(i)));
+      ABSL_CHECK_OK(compositor.Update(renderer, stroke,
+                                      AffineTransform::Identity(), draw_scene));
+      stroke.ResetUpdatedRegion();
+      benchmark::DoNotOptimize(compositor.Frame());
+      // The first frame draws every tile, which is not what is being measured.
+      if (i == 0) continue;
+      ++frame_count;
+      pixels_touched += compositor.LastFrameStats().pixels_touched;
+    }
+  }
+  state.counters["pixels_touched_per_frame"] =
+      static_cast<double>(pixels_touched) / frame_count;
+  state.counters["frame_pixels"] = kFrameSize * kFrameSize;
+}
+BENCHMARK(BM_InProgressStrokeCompositorPixelsPerFrame)
+    ->RangeMultiplier(2)
+    ->Range(32, 256);
+
+}  // namespace
+}  // namespace ink
@@ -0,0 +1,214 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ink/rendering/skia/native/in_progress_stroke_compositor.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "absl/log/absl_check.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "ink/brush/brush.h"
+#include "ink/brush/brush_family.h"
+#include "ink/brush/brush_paint.h"
+#include "ink/brush/brush_tip.h"
+#include "ink/color/color.h"
+#include "ink/geometry/affine_transform.h"
+#include "ink/geometry/rect.h"
+#include "ink/rendering/skia/native/skia_renderer.h"
+#include "ink/strokes/in_progress_stroke.h"
+#include "ink/strokes/input/recorded_test_inputs.h"
+#include "ink/strokes/input/stroke_input_batch.h"
+#include "ink/strokes/stroke.h"
+#include "ink/types/duration.h"
+#include "include/core/SkBitmap.h"
+#include "include/core/SkCanvas.h"
+#include "include/core/SkColor.h"
+
+namespace ink {
+namespace {
+
+constexpr int kFrameSize = 200;
+constexpr int kTileSize = 64;
+// The number of tiles in a `kFrameSize` square frame.
+constexpr int kTileCount = 16;
+
+Brush MakeBrush(const Color& color) {
+  absl::StatusOr<BrushFamily> family =
+      BrushFamily::Create(BrushTip{}, BrushPaint{});
+  ABSL_CHECK_OK(family);
+  absl::StatusOr<Brush> brush = Brush::Create(*family, color, 5, 0.1);
+  ABSL_CHECK_OK(brush);
+  return *brush;
+}
+
+absl::Span<const std::byte> Pixels(const SkBitmap& bitmap) {
+  return absl::MakeConstSpan(static_cast<const std::byte*>(bitmap.getPixels()),
+                             bitmap.computeByteSize());
+}
+
+bool SamePixels(const SkBitmap& a, const SkBitmap& b) {
+  absl::Span<const std::byte> a_pixels = Pixels(a);
+  absl::Span<const std::byte> b_pixels = Pixels(b);
+  return std::equal(a_pixels.begin(), a_pixels.end(), b_pixels.begin(),
+                    b_pixels.end());
+}
+
+class InProgressStrokeCompositorTest : public ::testing::Test {
+ protected:
+  InProgressStrokeCompositorTest()
+      : scene_stroke_(MakeBrush(Color::Black()),
+                      MakeCompleteSpringShapeInputs(
+                          Rect::FromTwoPoints({20, 120}, {180, 180}))),
+        inputs_(MakeIncrementalSpringShapeInputs(
+            Rect::FromTwoPoints({10, 10}, {150, 100}))) {
+    stroke_.Start(MakeBrush(Color::GoogleBlue()));
+  }
+
+  void DrawScene(SkCanvas& canvas) {
+    ++draw_scene_count_;
+    canvas.clear(SK_ColorWHITE);
+    ABSL_CHECK_OK(renderer_.Draw(nullptr, scene_stroke_,
+                                 AffineTransform::Identity(), canvas));
+  }
+
+  absl::Status Update(InProgressStrokeCompositor& compositor,
+                      const AffineTransform& object_to_canvas) {
+    absl::Status status =
+        compositor.Update(renderer_, stroke_, object_to_canvas,
+                          [this](SkCanvas& canvas) { DrawScene(canvas); });
+    stroke_.ResetUpdatedRegion();
+    return status;
+  }
+
+  void AddInputs(size_t index) {
+    ABSL_CHECK_OK(
+        stroke_.EnqueueInputs(inputs_[index].first, inputs_[index].second));
+    ABSL_CHECK_OK(stroke_.UpdateShape(Duration32::Seconds(index)));
+  }
+
+  // Returns the scene and the stroke, drawn from scratch.
+  SkBitmap DrawExpectedFrame(const AffineTransform& object_to_canvas) {
+    SkBitmap bitmap;
+    bitmap.allocN32Pixels(kFrameSize, kFrameSize);
+    bitmap.eraseColor(SK_ColorTRANSPARENT);
+    SkCanvas canvas(bitmap);
+    DrawScene(canvas);
+    ABSL_CHECK_OK(renderer_.Draw(nullptr, stroke_, object_to_canvas, canvas));
+    return bitmap;
+  }
+
+  SkiaRenderer renderer_;
+  Stroke scene_stroke_;
+  std::vector<std::pair<StrokeInputBatch, StrokeInputBatch>> inputs_;
+  InProgressStroke stroke_;
+  int draw_scene_count_ = 0;
+};
+
+TEST_F(InProgressStrokeCompositorTest, MatchesFullRedrawAfterEachUpdate) {
+  InProgressStrokeCompositor compositor(kFrameSize, kFrameSize, kTileSize);
+  for (size_t i = 0; i < inputs_.size(); ++i) {
+    AddInputs(i);
+    ASSERT_EQ(Update(compositor, AffineTransform::Identity()),
+              absl::OkStatus());
+    ASSERT_TRUE(SamePixels(compositor.Frame(),
+                           DrawExpectedFrame(AffineTransform::Identity())))
+        << "after update " << i;
+  }
+}
+
+TEST_F(InProgressStrokeCompositorTest, FirstUpdateDrawsEveryTile) {
+  InProgressStrokeCompositor compositor(kFrameSize, kFrameSize, kTileSize);
+  AddInputs(0);
+  ASSERT_EQ(Update(compositor, AffineTransform::Identity()), absl::OkStatus());
+
+  EXPECT_EQ(compositor.LastFrameStats().tiles_redrawn, kTileCount);
+  EXPECT_EQ(compositor.LastFrameStats().pixels_touched,
+            kFrameSize * kFrameSize);
+  EXPECT_EQ(draw_scene_count_, kTileCount);
+}
+
+TEST_F(InProgressStrokeCompositorTest, RedrawsOnlyTilesInUpdatedRegion) {
+  InProgressStrokeCompositor compositor(kFrameSize, kFrameSize, kTileSize);
+  AddInputs(0);
+  ASSERT_EQ(Update(compositor, AffineTransform::Identity()), absl::OkStatus());
+  draw_scene_count_ = 0;
+
+  AddInputs(1);
+  ASSERT_EQ(Update(compositor, AffineTransform::Identity()), absl::OkStatus());
+  EXPECT_GT(compositor.LastFrameStats().tiles_redrawn, 0);
+  EXPECT_LT(compositor.LastFrameStats().tiles_redrawn, kTileCount);
+  EXPECT_LT(compositor.LastFrameStats().pixels_touched,
+            kFrameSize * kFrameSize);
+  // The cached scene is reused.
+  EXPECT_EQ(draw_scene_count_, 0);
+
+  // Nothing changed, so nothing is redrawn.
+  ASSERT_EQ(Update(compositor, AffineTransform::Identity()), absl::OkStatus());
+  EXPECT_EQ(compositor.LastFrameStats().tiles_redrawn, 0);
+  EXPECT_EQ(compositor.LastFrameStats().pixels_touched, 0);
+}
+
+TEST_F(InProgressStrokeCompositorTest, InvalidateSceneRedrawsScene) {
+  InProgressStrokeCompositor compositor(kFrameSize, kFrameSize, kTileSize);
+  AddInputs(0);
+  ASSERT_EQ(Update(compositor, AffineTransform::Identity()), absl::OkStatus());
+  draw_scene_count_ = 0;
+
+  // A region within the first tile.
+  compositor.InvalidateScene(Rect::FromTwoPoints({1, 1}, {10, 10}));
+  ASSERT_EQ(Update(compositor, AffineTransform::Identity()), absl::OkStatus());
+  EXPECT_EQ(draw_scene_count_, 1);
+  EXPECT_EQ(compositor.LastFrameStats().tiles_redrawn, 1);
+
+  draw_scene_count_ = 0;
+  compositor.InvalidateScene();
+  ASSERT_EQ(Update(compositor, AffineTransform::Identity()), absl::OkStatus());
+  EXPECT_EQ(draw_scene_count_, kTileCount);
+  EXPECT_EQ(compositor.LastFrameStats().tiles_redrawn, kTileCount);
+}
+
+TEST_F(InProgressStrokeCompositorTest, MatchesFullRedrawAfterTransformChange) {
+  InProgressStrokeCompositor compositor(kFrameSize, kFrameSize, kTileSize);
+  for (size_t i = 0; i < inputs_.size() / 2; ++i) AddInputs(i);
+  ASSERT_EQ(Update(compositor, AffineTransform::Identity()), absl::OkStatus());
+
+  AffineTransform moved = AffineTransform::Translate({30, 70});
+  ASSERT_EQ(Update(compositor, moved), absl::OkStatus());
+  EXPECT_TRUE(SamePixels(compositor.Frame(), DrawExpectedFrame(moved)));
+}
+
+TEST_F(InProgressStrokeCompositorTest, MatchesFullRedrawAfterRestart) {
+  InProgressStrokeCompositor compositor(kFrameSize, kFrameSize, kTileSize);
+  for (size_t i = 0; i < inputs_.size(); ++i) AddInputs(i);
+  ASSERT_EQ(Update(compositor, AffineTransform::Identity()), absl::OkStatus());
+
+  stroke_.Start(MakeBrush(Color::GoogleBlue()));
+  AddInputs(0);
+  ASSERT_EQ(Update(compositor, AffineTransform::Identity()), absl::OkStatus());
+  EXPECT_TRUE(SamePixels(compositor.Frame(),
+                         DrawExpectedFrame(AffineTransform::Identity())));
+}
+
+TEST(InProgressStrokeCompositorDeathTest, NonPositiveTileSize) {
+  EXPECT_DEATH_IF_SUPPORTED(InProgressStrokeCompositor(100, 100, 0), "");
+}
+
+}  // namespace
+}  // namespace ink
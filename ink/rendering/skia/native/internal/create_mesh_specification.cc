@@ -49,6 +49,8 @@ SkMeshSpecification::Attribute::Type ToSkiaAttributeType(
       return SkMeshSpecification::Attribute::Type::kFloat2;
     case MeshSpecificationData::AttributeType::kFloat3:
       return SkMeshSpecification::Attribute::Type::kFloat3;
+    case MeshSpecificationData::AttributeType::kFloat4:
+      return SkMeshSpecification::Attribute::Type::kFloat4;
     case MeshSpecificationData::AttributeType::kUByte4:
       return SkMeshSpecification::Attribute::Type::kUByte4_unorm;
   }
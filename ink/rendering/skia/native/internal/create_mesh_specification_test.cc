@@ -53,6 +53,13 @@ TEST(CreateMeshSpecificationTest, MakeForStrokeWithFullMeshFormat) {
   EXPECT_THAT(*specification, Pointer(NotNull()));
 }
 
+TEST(CreateMeshSpecificationTest, MakeForStrokeBatch) {
+  absl::StatusOr<sk_sp<SkMeshSpecification>> specification =
+      CreateMeshSpecification(MeshSpecificationData::CreateForStrokeBatch());
+  ASSERT_EQ(specification.status(), absl::OkStatus());
+  EXPECT_THAT(*specification, Pointer(NotNull()));
+}
+
 // Returns a format identical to `starting_format` except that an attribute with
 // `attribute_id_to_skip` will be removed.
 MeshFormat MakeFormatWithSkippedAttribute(
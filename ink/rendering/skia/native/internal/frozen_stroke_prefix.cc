@@ -0,0 +1,177 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ink/rendering/skia/native/internal/frozen_stroke_prefix.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+
+#include "absl/log/absl_check.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "ink/geometry/affine_transform.h"
+#include "ink/geometry/envelope.h"
+#include "ink/geometry/mutable_mesh.h"
+#include "ink/geometry/rect.h"
+#include "ink/geometry/vec.h"
+#include "ink/strokes/in_progress_stroke.h"
+#include "include/core/SkCanvas.h"
+#include "include/core/SkColor.h"
+#include "include/core/SkImage.h"
+#include "include/core/SkImageInfo.h"
+#include "include/core/SkRect.h"
+#include "include/core/SkSurface.h"
+
+namespace ink::skia_native_internal {
+namespace {
+
+bool AreEqual(const AffineTransform& a, const AffineTransform& b) {
+  return a.A() == b.A() && a.B() == b.B() && a.C() == b.C() &&
+         a.D() == b.D() && a.E() == b.E() && a.F() == b.F();
+}
+
+// Returns the device-space bounds of the first coat of `stroke` drawn with
+// `object_to_canvas`, clipped to `canvas_bounds`, or an empty rectangle if the
+// stroke is empty or outside the canvas.
+SkIRect StrokeDeviceBounds(const InProgressStroke& stroke,
+                           const AffineTransform& object_to_canvas,
+                           const SkIRect& canvas_bounds) {
+  const std::optional<Rect>& bounds = stroke.GetMeshBounds(0).AsRect();
+  if (!bounds.has_value()) return SkIRect::MakeEmpty();
+  Rect device_bounds = *Envelope(object_to_canvas.Apply(*bounds)).AsRect();
+  // Outset by a pixel to include the anti-aliased edges of the triangles.
+  SkIRect rect = SkRect::MakeLTRB(device_bounds.XMin(), device_bounds.YMin(),
+                                  device_bounds.XMax(), device_bounds.YMax())
+                     .roundOut()
+                     .makeOutset(1, 1);
+  if (!rect.intersect(canvas_bounds)) return SkIRect::MakeEmpty();
+  return rect;
+}
+
+}  // namespace
+
+absl::StatusOr<uint32_t> FrozenStrokePrefix::Update(
+    const InProgressStroke& stroke, const AffineTransform& object_to_canvas,
+    SkCanvas& canvas, DrawTrianglesFunction draw_triangles) {
+  ABSL_CHECK_GT(stroke.BrushCoatCount(), 0u);
+  SkIRect canvas_bounds = SkIRect::MakeSize(canvas.imageInfo().dimensions());
+  SkIRect stroke_bounds =
+      StrokeDeviceBounds(stroke, object_to_canvas, canvas_bounds);
+  if (!IsValidFor(stroke, object_to_canvas, canvas, stroke_bounds)) {
+    Reset();
+    if (stroke_bounds.isEmpty()) return 0;
+    int32_t outset = std::max(
+        kMinBoundsOutset,
+        std::max(stroke_bounds.width(), stroke_bounds.height()) / 2);
+    bounds_ = stroke_bounds.makeOutset(outset, outset);
+    // This can't fail, since `stroke_bounds` is a non-empty part of
+    // `canvas_bounds`.
+    bounds_.intersect(canvas_bounds);
+    surface_ =
+        canvas.makeSurface(canvas.imageInfo().makeDimensions(bounds_.size()));
+    if (surface_ == nullptr) {
+      Reset();
+      return 0;
+    }
+    surface_->getCanvas()->clear(SK_ColorTRANSPARENT);
+    object_to_canvas_ = object_to_canvas;
+    context_ = canvas.recordingContext();
+    canvas_size_ = canvas.imageInfo().dimensions();
+  }
+
+  uint32_t freeze_end = FreezableTriangleEnd(stroke);
+  if (freeze_end > triangle_end_) {
+    image_.reset();
+    AffineTransform object_to_surface =
+        AffineTransform::Translate(
+            Vec{-static_cast<float>(bounds_.left()),
+                -static_cast<float>(bounds_.top())}) *
+        object_to_canvas_;
+    if (absl::Status status =
+            draw_triangles(*surface_->getCanvas(), object_to_surface,
+                           triangle_end_, freeze_end);
+        !status.ok()) {
+      Reset();
+      return status;
+    }
+    const MutableMesh& mesh = stroke.GetMesh(0);
+    for (uint32_t triangle = triangle_end_; triangle < freeze_end;
+         ++triangle) {
+      for (uint32_t index : mesh.TriangleIndices(triangle)) {
+        vertex_end_ = std::max(vertex_end_, index + 1);
+      }
+    }
+    triangle_end_ = freeze_end;
+    image_ = surface_->makeImageSnapshot();
+  }
+  version_ = stroke.GetMeshVersion();
+  return triangle_end_;
+}
+
+void FrozenStrokePrefix::Draw(SkCanvas& canvas) const {
+  if (image_ == nullptr) return;
+  canvas.save();
+  canvas.resetMatrix();
+  canvas.drawImage(image_, bounds_.left(), bounds_.top());
+  canvas.restore();
+}
+
+void FrozenStrokePrefix::Reset() { *this = FrozenStrokePrefix(); }
+
+bool FrozenStrokePrefix::IsValidFor(const InProgressStroke& stroke,
+                                    const AffineTransform& object_to_canvas,
+                                    const SkCanvas& canvas,
+                                    const SkIRect& stroke_bounds) const {
+  if (surface_ == nullptr ||
+      version_.stroke_id != stroke.GetMeshVersion().stroke_id ||
+      !AreEqual(object_to_canvas_, object_to_canvas) ||
+      context_ != canvas.recordingContext() ||
+      canvas_size_ != canvas.imageInfo().dimensions() ||
+      !bounds_.contains(stroke_bounds)) {
+    return false;
+  }
+  InProgressStroke::MeshChanges changes =
+      stroke.GetMeshChangesSince(0, version_);
+  return changes.first_triangle >= triangle_end_ &&
+         changes.first_vertex >= vertex_end_;
+}
+
+uint32_t FrozenStrokePrefix::FreezableTriangleEnd(
+    const InProgressStroke& stroke) const {
+  // The triangles that have not changed during the last `kSettleUpdateCount`
+  // updates, in addition to the ones that are guaranteed to be stable, can be
+  // frozen, as long as none of their vertices have changed either.
+  InProgressStroke::MeshVersion version = stroke.GetMeshVersion();
+  version.update_count -= std::min(version.update_count, kSettleUpdateCount);
+  InProgressStroke::MeshChanges changes =
+      stroke.GetMeshChangesSince(0, version);
+  const MutableMesh& mesh = stroke.GetMesh(0);
+  // Neither the triangles that are guaranteed to be stable nor the ones that
+  // `IsValidFor()` has just checked to be unchanged in the raster need to be
+  // checked again. The raster may already extend past the stable triangles,
+  // since it also holds settled ones.
+  uint32_t checked_end =
+      std::max(stroke.GetStableTriangleCount(0), triangle_end_);
+  uint32_t candidate_end = std::min(
+      mesh.TriangleCount(), std::max(checked_end, changes.first_triangle));
+  for (uint32_t triangle = checked_end; triangle < candidate_end; ++triangle) {
+    for (uint32_t index : mesh.TriangleIndices(triangle)) {
+      if (index >= changes.first_vertex) return triangle;
+    }
+  }
+  return std::max(checked_end, candidate_end);
+}
+
+}  // namespace ink::skia_native_internal
@@ -0,0 +1,138 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef INK_RENDERING_SKIA_NATIVE_INTERNAL_FROZEN_STROKE_PREFIX_H_
+#define INK_RENDERING_SKIA_NATIVE_INTERNAL_FROZEN_STROKE_PREFIX_H_
+
+#include <cstdint>
+
+#include "absl/functional/function_ref.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "ink/geometry/affine_transform.h"
+#include "ink/strokes/in_progress_stroke.h"
+#include "include/core/SkCanvas.h"
+#include "include/core/SkImage.h"
+#include "include/core/SkRect.h"
+#include "include/core/SkRefCnt.h"
+#include "include/core/SkSize.h"
+#include "include/core/SkSurface.h"
+
+class GrRecordingContext;
+
+namespace ink::skia_native_internal {
+
+// An offscreen raster of the triangles at the start of the mesh of an
+// `InProgressStroke` that have stopped changing.
+//
+// Drawing the raster in place of those triangles makes the cost of drawing a
+// long stroke on each frame proportional to the part of it that is still
+// changing, rather than to its length. Triangles are frozen into the raster if
+// they are counted by `InProgressStroke::GetStableTriangleCount()`, or if they
+// have not changed during the last `kSettleUpdateCount` updates. Settled
+// triangles can still change later, so on each update the raster is checked
+// against `InProgressStroke::GetMeshChangesSince()`, and is redrawn from
+// scratch if any of its triangles or their vertices changed.
+//
+// The raster is in the device space of the canvas, so it is also redrawn when
+// the stroke's transform or the canvas changes. It only covers the device-space
+// bounds of the stroke, outset to leave room for the stroke to grow and
+// clipped to the canvas, and is redrawn with larger bounds when the stroke
+// grows out of it.
+//
+// Only the mesh of the first brush coat is handled, since the coats of a
+// multi-coat stroke are drawn in order, and freezing the start of every coat
+// would draw the start of later coats below the end of earlier ones.
+class FrozenStrokePrefix {
+ public:
+  // Draws the mesh triangles of the stroke in the range [`first_triangle`,
+  // `triangle_end`) into `canvas` with `object_to_canvas`, which maps the
+  // stroke into the raster and replaces the matrix of `canvas`.
+  using DrawTrianglesFunction = absl::FunctionRef<absl::Status(
+      SkCanvas& canvas, const AffineTransform& object_to_canvas,
+      uint32_t first_triangle, uint32_t triangle_end)>;
+
+  // The number of updates during which a triangle must not have changed to be
+  // frozen, if it is not guaranteed to be stable.
+  static constexpr uint32_t kSettleUpdateCount = 4;
+
+  // The minimum number of pixels by which the raster extends past the bounds
+  // of the stroke on each side. The raster is also outset by half the size of
+  // the stroke's bounds, so that a growing stroke only needs to be redrawn
+  // into a larger raster a logarithmic number of times.
+  static constexpr int32_t kMinBoundsOutset = 64;
+
+  FrozenStrokePrefix() = default;
+  FrozenStrokePrefix(const FrozenStrokePrefix&) = delete;
+  FrozenStrokePrefix(FrozenStrokePrefix&&) = default;
+  FrozenStrokePrefix& operator=(const FrozenStrokePrefix&) = delete;
+  FrozenStrokePrefix& operator=(FrozenStrokePrefix&&) = default;
+  ~FrozenStrokePrefix() = default;
+
+  // Brings the raster up to date for drawing the first coat of `stroke` into
+  // `canvas` with `object_to_canvas`, calling `draw_triangles` with the
+  // raster's canvas to draw any newly frozen triangles.
+  //
+  // Returns the number of triangles at the start of the mesh that are drawn by
+  // `Draw()`, which must not also be drawn separately. Returns zero without
+  // calling `draw_triangles` if `canvas` cannot create an offscreen surface
+  // (e.g. if it records draws, rather than executing them). Returns an error if
+  // `draw_triangles` does.
+  absl::StatusOr<uint32_t> Update(const InProgressStroke& stroke,
+                                  const AffineTransform& object_to_canvas,
+                                  SkCanvas& canvas,
+                                  DrawTrianglesFunction draw_triangles);
+
+  // Draws the raster into `canvas`, which must be the one most recently passed
+  // to `Update()`, at its device-space bounds. The matrix of `canvas` is
+  // ignored.
+  void Draw(SkCanvas& canvas) const;
+
+  // Releases the raster.
+  void Reset();
+
+ private:
+  // Returns true if the raster holds frozen triangles of `stroke` drawn with
+  // `object_to_canvas` into a surface compatible with `canvas`, none of which
+  // have changed, and covers `stroke_bounds`, the device-space bounds of the
+  // stroke within `canvas`.
+  bool IsValidFor(const InProgressStroke& stroke,
+                  const AffineTransform& object_to_canvas,
+                  const SkCanvas& canvas, const SkIRect& stroke_bounds) const;
+
+  // Returns one past the last triangle that can be frozen, which is at least
+  // `triangle_end_`.
+  uint32_t FreezableTriangleEnd(const InProgressStroke& stroke) const;
+
+  sk_sp<SkSurface> surface_;
+  // A snapshot of `surface_`, taken after drawing into it rather than on every
+  // call to `Draw()`. It is released before drawing into `surface_` again, so
+  // that the surface does not have to copy its contents to preserve it.
+  sk_sp<SkImage> image_;
+  // What the raster was drawn for.
+  InProgressStroke::MeshVersion version_;
+  AffineTransform object_to_canvas_;
+  GrRecordingContext* context_ = nullptr;
+  SkISize canvas_size_ = SkISize::MakeEmpty();
+  // The device-space bounds of the raster within the canvas.
+  SkIRect bounds_ = SkIRect::MakeEmpty();
+  // One past the last triangle in the raster, and one past the largest index of
+  // a vertex that it uses.
+  uint32_t triangle_end_ = 0;
+  uint32_t vertex_end_ = 0;
+};
+
+}  // namespace ink::skia_native_internal
+
+#endif  // INK_RENDERING_SKIA_NATIVE_INTERNAL_FROZEN_STROKE_PREFIX_H_
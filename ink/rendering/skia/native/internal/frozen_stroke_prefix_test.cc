@@ -0,0 +1,211 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ink/rendering/skia/native/internal/frozen_stroke_prefix.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "absl/log/absl_check.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "ink/brush/brush.h"
+#include "ink/brush/brush_family.h"
+#include "ink/brush/brush_paint.h"
+#include "ink/brush/brush_tip.h"
+#include "ink/color/color.h"
+#include "ink/geometry/affine_transform.h"
+#include "ink/geometry/envelope.h"
+#include "ink/geometry/rect.h"
+#include "ink/strokes/in_progress_stroke.h"
+#include "ink/strokes/input/recorded_test_inputs.h"
+#include "ink/strokes/input/stroke_input_batch.h"
+#include "ink/types/duration.h"
+#include "include/core/SkBitmap.h"
+#include "include/core/SkCanvas.h"
+#include "include/core/SkSize.h"
+
+namespace ink::skia_native_internal {
+namespace {
+
+// A range of triangles passed to the `DrawTrianglesFunction`, with the size of
+// the raster and the device-space bounds of the stroke in the raster.
+struct TriangleRange {
+  uint32_t first;
+  uint32_t end;
+  SkISize raster_size;
+  Rect stroke_bounds;
+};
+
+Brush MakeBrush() {
+  absl::StatusOr<BrushFamily> family =
+      BrushFamily::Create(BrushTip{}, BrushPaint{});
+  ABSL_CHECK_OK(family);
+  absl::StatusOr<Brush> brush = Brush::Create(*family, Color::Black(), 5, 0.1);
+  ABSL_CHECK_OK(brush);
+  return *brush;
+}
+
+class FrozenStrokePrefixTest : public ::testing::Test {
+ protected:
+  FrozenStrokePrefixTest()
+      : inputs_(MakeIncrementalSpringShapeInputs(
+            Rect::FromTwoPoints({10, 10}, {150, 100}))) {
+    bitmap_.allocN32Pixels(200, 200);
+    stroke_.Start(MakeBrush());
+  }
+
+  void AddInputs(size_t index) {
+    ABSL_CHECK_OK(
+        stroke_.EnqueueInputs(inputs_[index].first, inputs_[index].second));
+    ABSL_CHECK_OK(stroke_.UpdateShape(Duration32::Seconds(index)));
+  }
+
+  absl::StatusOr<uint32_t> Update(const AffineTransform& object_to_canvas) {
+    SkCanvas canvas(bitmap_);
+    return prefix_.Update(
+        stroke_, object_to_canvas, canvas,
+        [this](SkCanvas& raster_canvas, const AffineTransform& object_to_raster,
+               uint32_t first, uint32_t end) {
+          drawn_.push_back({
+              .first = first,
+              .end = end,
+              .raster_size = raster_canvas.imageInfo().dimensions(),
+              .stroke_bounds =
+                  *Envelope(object_to_raster.Apply(
+                                *stroke_.GetMeshBounds(0).AsRect()))
+                       .AsRect(),
+          });
+          return absl::OkStatus();
+        });
+  }
+
+  std::vector<std::pair<StrokeInputBatch, StrokeInputBatch>> inputs_;
+  SkBitmap bitmap_;
+  InProgressStroke stroke_;
+  FrozenStrokePrefix prefix_;
+  std::vector<TriangleRange> drawn_;
+};
+
+TEST_F(FrozenStrokePrefixTest, DrawsOnlyNewlyFrozenTriangles) {
+  uint32_t frozen_count = 0;
+  for (size_t i = 0; i < inputs_.size(); ++i) {
+    AddInputs(i);
+    absl::StatusOr<uint32_t> new_frozen_count =
+        Update(AffineTransform::Identity());
+    ASSERT_EQ(new_frozen_count.status(), absl::OkStatus());
+    ASSERT_GE(*new_frozen_count, frozen_count) << "after update " << i;
+    ASSERT_LE(*new_frozen_count, stroke_.GetMesh(0).TriangleCount());
+    frozen_count = *new_frozen_count;
+  }
+  ASSERT_GT(frozen_count, 0u);
+
+  // The triangles are drawn in order, each of them once, except when the
+  // stroke grows out of the raster, which is then redrawn from the start.
+  uint32_t expected_first = 0;
+  int redraw_count = 0;
+  for (const TriangleRange& range : drawn_) {
+    if (range.first == 0 && expected_first != 0) {
+      ++redraw_count;
+      expected_first = 0;
+    }
+    EXPECT_EQ(range.first, expected_first);
+    EXPECT_GT(range.end, range.first);
+    expected_first = range.end;
+  }
+  EXPECT_EQ(expected_first, frozen_count);
+  EXPECT_LE(redraw_count, 3);
+}
+
+TEST_F(FrozenStrokePrefixTest, RasterCoversOnlyTheStroke) {
+  bitmap_.allocN32Pixels(2000, 2000);
+  for (size_t i = 0; i < inputs_.size(); ++i) {
+    AddInputs(i);
+    ASSERT_EQ(Update(AffineTransform::Translate({500, 600})).status(),
+              absl::OkStatus());
+  }
+  ASSERT_FALSE(drawn_.empty());
+
+  // The stroke is drawn in a 200x200 area near the middle of the canvas, so
+  // the raster is much smaller than the canvas, and always holds the whole
+  // stroke when it is drawn.
+  for (const TriangleRange& range : drawn_) {
+    EXPECT_LT(range.raster_size.width(), 1000);
+    EXPECT_LT(range.raster_size.height(), 1000);
+    EXPECT_GE(range.stroke_bounds.XMin(), 0);
+    EXPECT_GE(range.stroke_bounds.YMin(), 0);
+    EXPECT_LE(range.stroke_bounds.XMax(), range.raster_size.width());
+    EXPECT_LE(range.stroke_bounds.YMax(), range.raster_size.height());
+  }
+}
+
+TEST_F(FrozenStrokePrefixTest, DoesNotFreezeTrianglesThatJustChanged) {
+  AddInputs(0);
+  absl::StatusOr<uint32_t> frozen_count = Update(AffineTransform::Identity());
+  ASSERT_EQ(frozen_count.status(), absl::OkStatus());
+  EXPECT_EQ(*frozen_count, stroke_.GetStableTriangleCount(0));
+}
+
+TEST_F(FrozenStrokePrefixTest, RedrawsFromStartAfterTransformChange) {
+  for (size_t i = 0; i < inputs_.size(); ++i) AddInputs(i);
+  ASSERT_EQ(Update(AffineTransform::Identity()).status(), absl::OkStatus());
+  ASSERT_FALSE(drawn_.empty());
+
+  drawn_.clear();
+  absl::StatusOr<uint32_t> frozen_count =
+      Update(AffineTransform::Translate({10, 20}));
+  ASSERT_EQ(frozen_count.status(), absl::OkStatus());
+  ASSERT_EQ(drawn_.size(), 1u);
+  EXPECT_EQ(drawn_[0].first, 0u);
+  EXPECT_EQ(drawn_[0].end, *frozen_count);
+}
+
+TEST_F(FrozenStrokePrefixTest, RedrawsFromStartAfterRestart) {
+  for (size_t i = 0; i < inputs_.size(); ++i) AddInputs(i);
+  ASSERT_EQ(Update(AffineTransform::Identity()).status(), absl::OkStatus());
+
+  stroke_.Start(MakeBrush());
+  AddInputs(0);
+  drawn_.clear();
+  absl::StatusOr<uint32_t> frozen_count = Update(AffineTransform::Identity());
+  ASSERT_EQ(frozen_count.status(), absl::OkStatus());
+  EXPECT_EQ(*frozen_count, stroke_.GetStableTriangleCount(0));
+  for (const TriangleRange& range : drawn_) {
+    EXPECT_EQ(range.first, 0u);
+  }
+}
+
+TEST_F(FrozenStrokePrefixTest, ReturnsErrorFromDrawTrianglesAndStartsOver) {
+  for (size_t i = 0; i < inputs_.size(); ++i) AddInputs(i);
+  SkCanvas canvas(bitmap_);
+  absl::Status error = absl::InternalError("draw failed");
+  EXPECT_EQ(prefix_
+                .Update(stroke_, AffineTransform::Identity(), canvas,
+                        [&error](SkCanvas&, const AffineTransform&, uint32_t,
+                                 uint32_t) { return error; })
+                .status(),
+            error);
+
+  absl::StatusOr<uint32_t> frozen_count = Update(AffineTransform::Identity());
+  ASSERT_EQ(frozen_count.status(), absl::OkStatus());
+  ASSERT_GT(*frozen_count, 0u);
+  ASSERT_EQ(drawn_.size(), 1u);
+  EXPECT_EQ(drawn_[0].first, 0u);
+}
+
+}  // namespace
+}  // namespace ink::skia_native_internal
@@ -0,0 +1,458 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ink/rendering/skia/native/internal/in_progress_stroke_render_cache.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <utility>
+
+#include "absl/algorithm/container.h"
+#include "absl/container/inlined_vector.h"
+#include "absl/log/absl_check.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "ink/geometry/envelope.h"
+#include "ink/geometry/internal/mesh_packing.h"
+#include "ink/geometry/mutable_mesh.h"
+#include "ink/geometry/rect.h"
+#include "ink/rendering/skia/native/internal/mesh_drawable.h"
+#include "ink/strokes/in_progress_stroke.h"
+#include "include/core/SkMesh.h"
+#include "include/core/SkRect.h"
+#include "include/gpu/ganesh/GrDirectContext.h"
+#include "include/gpu/ganesh/SkMeshGanesh.h"
+
+namespace ink::skia_native_internal {
+namespace {
+
+// The maximum number of vertices that can be addressed with 16-bit indices.
+constexpr uint32_t kMaxVerticesPerPartition =
+    uint32_t{std::numeric_limits<uint16_t>::max()} + 1;
+
+// The smallest growable buffers that are allocated, in bytes. This avoids
+// reallocating several times in quick succession at the start of a stroke.
+constexpr size_t kMinBufferCapacity = 16 * 1024;
+
+// `SkMesh` buffer updates must have 4-byte aligned offsets and sizes.
+constexpr size_t kUpdateAlignment = 4;
+
+size_t AlignUp(size_t size) {
+  return (size + kUpdateAlignment - 1) / kUpdateAlignment * kUpdateAlignment;
+}
+
+SkRect ToSkiaRect(const Rect& rect) {
+  return SkRect::MakeLTRB(rect.XMin(), rect.YMin(), rect.XMax(), rect.YMax());
+}
+
+}  // namespace
+
+absl::StatusOr<absl::InlinedVector<MeshDrawable::Partition, 1>>
+InProgressStrokeRenderCache::Update(GrDirectContext* context,
+                                    const InProgressStroke& stroke,
+                                    uint32_t coat_index) {
+  last_upload_stats_ = {};
+
+  const MutableMesh& mesh = stroke.GetMesh(coat_index);
+  std::optional<Rect> bounds = stroke.GetMeshBounds(coat_index).AsRect();
+  if (!bounds.has_value() || mesh.TriangleCount() == 0) {
+    return absl::InvalidArgumentError("Cannot render an empty mesh.");
+  }
+
+  // Buffers belong to the context that created them.
+  if (context != context_) {
+    coat_buffers_.clear();
+    context_ = context;
+  }
+  if (coat_buffers_.size() <= coat_index) {
+    coat_buffers_.resize(coat_index + 1);
+  }
+  CoatBuffers& buffers = coat_buffers_[coat_index];
+
+  InProgressStroke::MeshChanges changes =
+      stroke.GetMeshChangesSince(coat_index, buffers.version);
+  absl::InlinedVector<MeshDrawable::Partition, 1> partitions;
+  buffers.partition_triangle_ends.clear();
+  bool success =
+      mesh.VertexCount() <= kMaxVerticesPerPartition
+          ? UpdateWholeMesh(context, mesh, *bounds, changes, buffers,
+                            partitions)
+          : UpdatePartitions(context, mesh, changes, buffers, partitions);
+  if (!success) {
+    buffers = {};
+    return absl::InternalError(
+        "Failed to create or update an `SkMesh` buffer.");
+  }
+  buffers.version = stroke.GetMeshVersion();
+  buffers.partitions = partitions;
+  return partitions;
+}
+
+absl::InlinedVector<MeshDrawable::Partition, 1>
+InProgressStrokeRenderCache::SelectTriangles(uint32_t coat_index,
+                                             uint32_t first_triangle,
+                                             uint32_t triangle_end) const {
+  ABSL_CHECK_LT(coat_index, coat_buffers_.size());
+  const CoatBuffers& buffers = coat_buffers_[coat_index];
+  ABSL_DCHECK_EQ(buffers.partitions.size(),
+                 buffers.partition_triangle_ends.size());
+  absl::InlinedVector<MeshDrawable::Partition, 1> selected;
+  uint32_t partition_start = 0;
+  for (size_t i = 0; i < buffers.partitions.size(); ++i) {
+    uint32_t partition_end = buffers.partition_triangle_ends[i];
+    uint32_t first = std::max(first_triangle, partition_start);
+    uint32_t end = std::min(triangle_end, partition_end);
+    if (first < end) {
+      MeshDrawable::Partition& partition =
+          selected.emplace_back(buffers.partitions[i]);
+      partition.index_offset +=
+          size_t{3} * sizeof(uint16_t) * (first - partition_start);
+      partition.index_count = static_cast<int32_t>(3 * (end - first));
+    }
+    partition_start = partition_end;
+  }
+  return selected;
+}
+
+bool InProgressStrokeRenderCache::UpdateWholeMesh(
+    GrDirectContext* context, const MutableMesh& mesh, const Rect& bounds,
+    InProgressStroke::MeshChanges changes, CoatBuffers& buffers,
+    absl::InlinedVector<MeshDrawable::Partition, 1>& partitions) {
+  if (buffers.is_partitioned) {
+    // The mesh has shrunk back to a single partition, which has to be uploaded
+    // in full.
+    buffers.frozen_partitions.clear();
+    buffers.is_partitioned = false;
+    changes = {};
+  }
+
+  absl::Span<const std::byte> vertex_data = mesh.RawVertexData();
+  if (!UploadVertices(context, vertex_data,
+                      changes.first_vertex * mesh.VertexStride(),
+                      buffers.vertex_buffer)) {
+    return false;
+  }
+
+  constexpr size_t kTriangleSize = 3 * sizeof(uint16_t);
+  uint32_t triangle_count = mesh.TriangleCount();
+  size_t required_size = AlignUp(triangle_count * kTriangleSize);
+  size_t old_capacity =
+      buffers.index_buffer == nullptr ? 0 : buffers.index_buffer->size();
+  bool reallocate = old_capacity < required_size;
+  // Starting from an even triangle keeps the byte offset of the update 4-byte
+  // aligned.
+  uint32_t start = reallocate ? 0 : changes.first_triangle & ~uint32_t{1};
+  if (reallocate || changes.first_triangle < triangle_count) {
+    index_staging_.clear();
+    for (uint32_t i = start; i < triangle_count; ++i) {
+      for (uint32_t index : mesh.TriangleIndices(i)) {
+        index_staging_.push_back(index);
+      }
+    }
+    // Pad to a 4-byte aligned size; the padding is never drawn.
+    if (index_staging_.size() % 2 != 0) index_staging_.push_back(0);
+    if (!UploadIndices(context, start * kTriangleSize, required_size,
+                       buffers.index_buffer)) {
+      return false;
+    }
+  }
+
+  partitions.push_back({
+      .vertex_buffer = buffers.vertex_buffer,
+      .index_buffer = buffers.index_buffer,
+      .vertex_count = static_cast<int32_t>(mesh.VertexCount()),
+      .index_count = static_cast<int32_t>(3 * triangle_count),
+      .bounds = ToSkiaRect(bounds),
+  });
+  buffers.partition_triangle_ends.push_back(triangle_count);
+  return true;
+}
+
+bool InProgressStrokeRenderCache::UpdatePartitions(
+    GrDirectContext* context, const MutableMesh& mesh,
+    InProgressStroke::MeshChanges changes, CoatBuffers& buffers,
+    absl::InlinedVector<MeshDrawable::Partition, 1>& partitions) {
+  if (!buffers.is_partitioned) {
+    // The buffers hold the whole mesh, rather than the tail of a split one, so
+    // nothing in them can be reused.
+    buffers.is_partitioned = true;
+    changes = {};
+  }
+
+  // Drop the frozen partitions that use changed triangles or vertices, and
+  // every partition after them.
+  absl::InlinedVector<FrozenPartition, 1>& frozen = buffers.frozen_partitions;
+  auto first_stale =
+      absl::c_find_if(frozen, [&changes](const FrozenPartition& partition) {
+        return partition.triangle_end > changes.first_triangle ||
+               partition.vertex_end > changes.first_vertex;
+      });
+  frozen.erase(first_stale, frozen.end());
+
+  // Repartition the rest of the mesh.
+  uint32_t triangle_end = frozen.empty() ? 0 : frozen.back().triangle_end;
+  uint32_t vertex_end = frozen.empty() ? 0 : frozen.back().vertex_end;
+  absl::InlinedVector<mesh_internal::PartitionInfo, 1> new_partitions =
+      mesh_internal::PartitionTriangles(
+          mesh.RawIndexData().subspan(size_t{3} * mesh.IndexStride() *
+                                      triangle_end),
+          mesh.Format().GetIndexFormat(), kMaxVerticesPerPartition);
+
+  // Freeze the new full partitions that end before the first changed triangle
+  // and vertex. A full partition that contains part of the change is likely to
+  // change again on the next update, so it stays in the tail instead of being
+  // uploaded to new buffers that would be dropped again.
+  size_t tail_start = 0;
+  for (; tail_start + 1 < new_partitions.size(); ++tail_start) {
+    const mesh_internal::PartitionInfo& info = new_partitions[tail_start];
+    uint32_t partition_triangle_end = triangle_end + info.triangles.size();
+    uint32_t partition_vertex_end =
+        std::max(vertex_end, *absl::c_max_element(info.vertex_indices) + 1);
+    if (partition_triangle_end > changes.first_triangle ||
+        partition_vertex_end > changes.first_vertex) {
+      break;
+    }
+
+    partition_vertices_.clear();
+    index_staging_.clear();
+    SkRect bounds = StagePartition(mesh, info);
+    sk_sp<SkMesh::VertexBuffer> vertex_buffer = SkMeshes::MakeVertexBuffer(
+        context, partition_vertices_.data(), partition_vertices_.size());
+    sk_sp<SkMesh::IndexBuffer> index_buffer = SkMeshes::MakeIndexBuffer(
+        context, index_staging_.data(),
+        index_staging_.size() * sizeof(uint16_t));
+    if (vertex_buffer == nullptr || index_buffer == nullptr) return false;
+    NotifyUpload(vertex_buffer.get(), 0, partition_vertices_.data(),
+                 partition_vertices_.size());
+    NotifyUpload(index_buffer.get(), 0, index_staging_.data(),
+                 index_staging_.size() * sizeof(uint16_t));
+    last_upload_stats_.vertex_bytes += partition_vertices_.size();
+    last_upload_stats_.index_bytes += index_staging_.size() * sizeof(uint16_t);
+
+    triangle_end = partition_triangle_end;
+    vertex_end = partition_vertex_end;
+    frozen.push_back({
+        .partition = {.vertex_buffer = std::move(vertex_buffer),
+                      .index_buffer = std::move(index_buffer),
+                      .vertex_count =
+                          static_cast<int32_t>(info.vertex_indices.size()),
+                      .index_count =
+                          static_cast<int32_t>(3 * info.triangles.size()),
+                      .bounds = bounds},
+        .triangle_end = triangle_end,
+        .vertex_end = vertex_end,
+    });
+  }
+  for (const FrozenPartition& partition : frozen) {
+    partitions.push_back(partition.partition);
+    buffers.partition_triangle_ends.push_back(partition.triangle_end);
+  }
+
+  // The remaining partitions form the tail of the mesh, which is staged one
+  // after the other into the persistent buffers. If the tail starts at the same
+  // triangle as on the previous update, the staged data only differs from
+  // there onward for the triangles and vertices that changed, since triangles
+  // are assigned to partitions and vertices to partition indices in order.
+  if (triangle_end != buffers.tail_first_triangle) {
+    buffers.tail_first_triangle = triangle_end;
+    changes = {.first_vertex = 0, .first_triangle = triangle_end};
+  }
+  uint32_t first_changed_triangle =
+      std::max(changes.first_triangle, triangle_end);
+  size_t vertex_stride = mesh.VertexStride();
+  size_t vertex_update_offset = std::numeric_limits<size_t>::max();
+  size_t index_update_offset = std::numeric_limits<size_t>::max();
+  partition_vertices_.clear();
+  index_staging_.clear();
+  for (size_t i = tail_start; i < new_partitions.size(); ++i) {
+    const mesh_internal::PartitionInfo& info = new_partitions[i];
+    if (info.triangles.empty()) continue;
+    size_t vertex_offset = partition_vertices_.size();
+    size_t index_offset = index_staging_.size() * sizeof(uint16_t);
+    uint32_t partition_first_triangle = triangle_end;
+    triangle_end += info.triangles.size();
+
+    if (vertex_update_offset == std::numeric_limits<size_t>::max()) {
+      auto changed_vertex = absl::c_find_if(
+          info.vertex_indices, [&changes](uint32_t vertex_index) {
+            return vertex_index >= changes.first_vertex;
+          });
+      if (changed_vertex != info.vertex_indices.end()) {
+        vertex_update_offset =
+            vertex_offset +
+            vertex_stride * (changed_vertex - info.vertex_indices.begin());
+      }
+    }
+    if (index_update_offset == std::numeric_limits<size_t>::max() &&
+        first_changed_triangle < triangle_end) {
+      // Starting from an even triangle keeps the byte offset of the update
+      // 4-byte aligned, as each partition's indices start at an aligned offset.
+      uint32_t unchanged_count =
+          first_changed_triangle - partition_first_triangle;
+      index_update_offset = index_offset + size_t{3} * sizeof(uint16_t) *
+                                               (unchanged_count & ~uint32_t{1});
+      // The partition's vertices that are first used by the changed triangles
+      // may differ too.
+      uint32_t unchanged_vertex_end = 0;
+      for (uint32_t t = 0; t < unchanged_count; ++t) {
+        for (uint32_t index : info.triangles[t]) {
+          unchanged_vertex_end = std::max(unchanged_vertex_end, index + 1);
+        }
+      }
+      vertex_update_offset =
+          std::min(vertex_update_offset,
+                   vertex_offset + vertex_stride * unchanged_vertex_end);
+    }
+
+    SkRect bounds = StagePartition(mesh, info);
+    partitions.push_back({
+        .vertex_count = static_cast<int32_t>(info.vertex_indices.size()),
+        .index_count = static_cast<int32_t>(3 * info.triangles.size()),
+        .bounds = bounds,
+        .vertex_offset = vertex_offset,
+        .index_offset = index_offset,
+    });
+    buffers.partition_triangle_ends.push_back(triangle_end);
+  }
+  if (index_staging_.empty()) return true;
+
+  size_t index_size = index_staging_.size() * sizeof(uint16_t);
+  if (buffers.index_buffer == nullptr ||
+      buffers.index_buffer->size() < index_size) {
+    // The index buffer will be replaced, so it has to be uploaded in full.
+    index_update_offset = 0;
+  }
+  vertex_update_offset =
+      std::min(vertex_update_offset, partition_vertices_.size());
+  if (!UploadVertices(context, partition_vertices_, vertex_update_offset,
+                      buffers.vertex_buffer)) {
+    return false;
+  }
+  if (index_update_offset < index_size) {
+    index_staging_.erase(
+        index_staging_.begin(),
+        index_staging_.begin() + index_update_offset / sizeof(uint16_t));
+    if (!UploadIndices(context, index_update_offset, index_size,
+                       buffers.index_buffer)) {
+      return false;
+    }
+  }
+  for (MeshDrawable::Partition& partition :
+       absl::MakeSpan(partitions).subspan(frozen.size())) {
+    partition.vertex_buffer = buffers.vertex_buffer;
+    partition.index_buffer = buffers.index_buffer;
+  }
+  return true;
+}
+
+SkRect InProgressStrokeRenderCache::StagePartition(
+    const MutableMesh& mesh, const mesh_internal::PartitionInfo& partition) {
+  absl::Span<const std::byte> vertex_data = mesh.RawVertexData();
+  size_t vertex_stride = mesh.VertexStride();
+  Envelope bounds;
+  partition_vertices_.reserve(partition_vertices_.size() +
+                              partition.vertex_indices.size() * vertex_stride);
+  for (uint32_t vertex_index : partition.vertex_indices) {
+    absl::Span<const std::byte> vertex =
+        vertex_data.subspan(vertex_index * vertex_stride, vertex_stride);
+    partition_vertices_.insert(partition_vertices_.end(), vertex.begin(),
+                               vertex.end());
+    bounds.Add(mesh.VertexPosition(vertex_index));
+  }
+
+  index_staging_.reserve(index_staging_.size() +
+                         3 * partition.triangles.size() + 1);
+  for (const std::array<uint32_t, 3>& triangle : partition.triangles) {
+    index_staging_.insert(index_staging_.end(), triangle.begin(),
+                          triangle.end());
+  }
+  // Pad to a 4-byte aligned size; the padding is never drawn.
+  if (index_staging_.size() % 2 != 0) index_staging_.push_back(0);
+
+  return ToSkiaRect(*bounds.AsRect());
+}
+
+bool InProgressStrokeRenderCache::UploadVertices(
+    GrDirectContext* context, absl::Span<const std::byte> vertex_data,
+    size_t offset, sk_sp<SkMesh::VertexBuffer>& buffer) {
+  ABSL_DCHECK_EQ(offset % kUpdateAlignment, 0u);
+  size_t old_capacity = buffer == nullptr ? 0 : buffer->size();
+  if (old_capacity < vertex_data.size()) {
+    size_t capacity = NewCapacity(old_capacity, vertex_data.size());
+    vertex_staging_.assign(vertex_data.begin(), vertex_data.end());
+    vertex_staging_.resize(capacity);
+    buffer = SkMeshes::MakeVertexBuffer(context, vertex_staging_.data(),
+                                        vertex_staging_.size());
+    if (buffer == nullptr) return false;
+    last_upload_stats_.vertex_bytes += capacity;
+    NotifyUpload(buffer.get(), 0, vertex_staging_.data(), capacity);
+    return true;
+  }
+
+  if (offset >= vertex_data.size()) return true;
+  size_t size = vertex_data.size() - offset;
+  last_upload_stats_.vertex_bytes += size;
+  if (!buffer->update(context, vertex_data.data() + offset, offset, size)) {
+    return false;
+  }
+  NotifyUpload(buffer.get(), offset, vertex_data.data() + offset, size);
+  return true;
+}
+
+bool InProgressStrokeRenderCache::UploadIndices(
+    GrDirectContext* context, size_t offset, size_t required_size,
+    sk_sp<SkMesh::IndexBuffer>& buffer) {
+  size_t old_capacity = buffer == nullptr ? 0 : buffer->size();
+  if (old_capacity < required_size) {
+    ABSL_DCHECK_EQ(offset, 0u);
+    size_t capacity = AlignUp(NewCapacity(old_capacity, required_size));
+    index_staging_.resize(capacity / sizeof(uint16_t));
+    buffer = SkMeshes::MakeIndexBuffer(context, index_staging_.data(),
+                                       capacity);
+    if (buffer == nullptr) return false;
+    last_upload_stats_.index_bytes += capacity;
+    NotifyUpload(buffer.get(), 0, index_staging_.data(), capacity);
+    return true;
+  }
+
+  size_t size = index_staging_.size() * sizeof(uint16_t);
+  last_upload_stats_.index_bytes += size;
+  if (!buffer->update(context, index_staging_.data(), offset, size)) {
+    return false;
+  }
+  NotifyUpload(buffer.get(), offset, index_staging_.data(), size);
+  return true;
+}
+
+size_t InProgressStrokeRenderCache::NewCapacity(size_t old_capacity,
+                                                size_t required_size) const {
+  if (sizing_ == BufferSizing::kExact) return required_size;
+  return std::max({required_size, 2 * old_capacity, kMinBufferCapacity});
+}
+
+void InProgressStrokeRenderCache::NotifyUpload(const void* buffer,
+                                               size_t offset, const void* data,
+                                               size_t size) {
+  if (upload_observer_ == nullptr) return;
+  upload_observer_(
+      buffer, offset,
+      absl::MakeConstSpan(static_cast<const std::byte*>(data), size));
+}
+
+}  // namespace ink::skia_native_internal
@@ -0,0 +1,213 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef INK_RENDERING_SKIA_NATIVE_INTERNAL_IN_PROGRESS_STROKE_RENDER_CACHE_H_
+#define INK_RENDERING_SKIA_NATIVE_INTERNAL_IN_PROGRESS_STROKE_RENDER_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "absl/container/inlined_vector.h"
+#include "absl/functional/any_invocable.h"
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "ink/geometry/internal/mesh_packing.h"
+#include "ink/geometry/mutable_mesh.h"
+#include "ink/geometry/rect.h"
+#include "ink/rendering/skia/native/internal/mesh_drawable.h"
+#include "ink/strokes/in_progress_stroke.h"
+#include "include/core/SkMesh.h"
+#include "include/core/SkRect.h"
+#include "include/core/SkRefCnt.h"
+#include "include/gpu/ganesh/GrDirectContext.h"
+
+namespace ink::skia_native_internal {
+
+// Persistent vertex and index buffers for drawing the meshes of an
+// `InProgressStroke` with `SkMesh`.
+//
+// The buffers for each brush coat are kept between frames and, unless the
+// cache is constructed with `BufferSizing::kExact`, grown geometrically as
+// needed. On each update, only the vertices and triangles
+// that `InProgressStroke::GetMeshChangesSince()` reports as changed are
+// uploaded, so the cost of a frame is proportional to the size of the change
+// rather than the length of the stroke.
+//
+// Meshes with more vertices than can be addressed with 16-bit indices are split
+// into partitions as they grow, in the same way as `MutableMesh::AsMeshes()`.
+// A full partition that ends before the changed part of the mesh is frozen in
+// buffers of its own, which are kept as long as none of its triangles and
+// vertices change. The remaining partitions form the tail of the mesh, which
+// is kept in the persistent buffers and, like an unsplit mesh, only has its
+// changed part uploaded on each update.
+//
+// Because the buffers are updated in place, the partitions returned by
+// `Update()` must only be drawn before the next call to `Update()` for the same
+// coat.
+class InProgressStrokeRenderCache {
+ public:
+  // Byte counts of the data uploaded by the most recent call to `Update()`.
+  struct UploadStats {
+    size_t vertex_bytes = 0;
+    size_t index_bytes = 0;
+  };
+
+  // How buffers are sized when they are created.
+  enum class BufferSizing {
+    // With room for the mesh to grow, so that a cache that is updated on every
+    // frame rarely has to replace its buffers.
+    kGrowable,
+    // To fit the mesh exactly, for a cache that is only updated once.
+    kExact,
+  };
+
+  explicit InProgressStrokeRenderCache(
+      BufferSizing sizing = BufferSizing::kGrowable)
+      : sizing_(sizing) {}
+  InProgressStrokeRenderCache(const InProgressStrokeRenderCache&) = delete;
+  InProgressStrokeRenderCache(InProgressStrokeRenderCache&&) = default;
+  InProgressStrokeRenderCache& operator=(const InProgressStrokeRenderCache&) =
+      delete;
+  InProgressStrokeRenderCache& operator=(InProgressStrokeRenderCache&&) =
+      default;
+  ~InProgressStrokeRenderCache() = default;
+
+  // Brings the buffers for `coat_index` up to date with
+  // `stroke.GetMesh(coat_index)`, and returns the partitions that draw them.
+  //
+  // If the buffers were last updated from the same stroke (i.e. since its most
+  // recent call to `Start()`) with the same `context`, only the changed part of
+  // the mesh is uploaded; otherwise, the whole mesh is uploaded.
+  //
+  // Returns an error if the mesh is empty or if a buffer could not be created.
+  absl::StatusOr<absl::InlinedVector<MeshDrawable::Partition, 1>> Update(
+      GrDirectContext* context, const InProgressStroke& stroke,
+      uint32_t coat_index);
+
+  // Returns the partitions returned by the most recent successful call to
+  // `Update()` for `coat_index`, restricted to drawing the mesh triangles in
+  // the range [`first_triangle`, `triangle_end`). Partitions with no triangles
+  // in the range are omitted.
+  //
+  // This allows part of a mesh to be drawn separately from the rest, without
+  // uploading it again.
+  absl::InlinedVector<MeshDrawable::Partition, 1> SelectTriangles(
+      uint32_t coat_index, uint32_t first_triangle,
+      uint32_t triangle_end) const;
+
+  // Returns the amount of data uploaded by the most recent call to `Update()`.
+  const UploadStats& LastUploadStats() const { return last_upload_stats_; }
+
+  // Called with the address of a vertex or index buffer, a byte offset in it,
+  // and the data written there, for every successful upload. When a buffer is
+  // created, the data is its whole contents.
+  using UploadObserver = absl::AnyInvocable<void(
+      const void* buffer, size_t offset, absl::Span<const std::byte> data)>;
+
+  // Sets a function to be called on every upload, or clears it if `observer`
+  // is null. This lets tests check the contents of the buffers, which cannot
+  // be read back from a mock `GrDirectContext`.
+  void SetUploadObserver(UploadObserver observer) {
+    upload_observer_ = std::move(observer);
+  }
+
+ private:
+  // A partition of a mesh that is too large for 16-bit indices, which is full
+  // and will not be rebuilt unless earlier parts of the mesh change.
+  struct FrozenPartition {
+    MeshDrawable::Partition partition;
+    // One past the last mesh triangle in this or an earlier partition.
+    uint32_t triangle_end;
+    // One past the largest mesh vertex index used by this or an earlier
+    // partition.
+    uint32_t vertex_end;
+  };
+
+  struct CoatBuffers {
+    // The version of the stroke mesh that the buffers hold.
+    InProgressStroke::MeshVersion version;
+    // Empty unless the mesh is split into partitions.
+    absl::InlinedVector<FrozenPartition, 1> frozen_partitions;
+    // True if the buffers below hold the partitions after the frozen ones of a
+    // split mesh, rather than the whole mesh.
+    bool is_partitioned = false;
+    // If `is_partitioned`, the first mesh triangle in the buffers below.
+    uint32_t tail_first_triangle = 0;
+    sk_sp<SkMesh::VertexBuffer> vertex_buffer;
+    sk_sp<SkMesh::IndexBuffer> index_buffer;
+    // The partitions returned by the most recent call to `Update()`, and one
+    // past the last mesh triangle drawn by each of them.
+    absl::InlinedVector<MeshDrawable::Partition, 1> partitions;
+    absl::InlinedVector<uint32_t, 1> partition_triangle_ends;
+  };
+
+  // Updates `buffers` to hold the whole of `mesh`, which must fit in a single
+  // partition, and appends the partition that draws it to `partitions`.
+  bool UpdateWholeMesh(
+      GrDirectContext* context, const MutableMesh& mesh, const Rect& bounds,
+      InProgressStroke::MeshChanges changes, CoatBuffers& buffers,
+      absl::InlinedVector<MeshDrawable::Partition, 1>& partitions);
+
+  // Splits `mesh` into partitions, reusing the frozen partitions in `buffers`
+  // that precede `changes`, and freezing new full partitions that precede
+  // them. Updates the buffers to hold the remaining partitions, and appends
+  // them all to `partitions`.
+  bool UpdatePartitions(
+      GrDirectContext* context, const MutableMesh& mesh,
+      InProgressStroke::MeshChanges changes, CoatBuffers& buffers,
+      absl::InlinedVector<MeshDrawable::Partition, 1>& partitions);
+
+  // Appends the vertices and 16-bit triangle indices of `partition` to
+  // `partition_vertices_` and `index_staging_`, padding the indices to a
+  // 4-byte aligned size, and returns the bounds of the vertices.
+  SkRect StagePartition(const MutableMesh& mesh,
+                        const mesh_internal::PartitionInfo& partition);
+
+  // Uploads `vertex_data` from byte `offset` onward to `buffer`. If `buffer` is
+  // too small, it is replaced by a larger one holding all of `vertex_data`.
+  bool UploadVertices(GrDirectContext* context,
+                      absl::Span<const std::byte> vertex_data, size_t offset,
+                      sk_sp<SkMesh::VertexBuffer>& buffer);
+
+  // Uploads `index_staging_` to `buffer` at byte `offset`. If `buffer` is
+  // smaller than `required_size`, it is replaced by a larger one holding
+  // `index_staging_`, in which case `offset` must be 0.
+  bool UploadIndices(GrDirectContext* context, size_t offset,
+                     size_t required_size, sk_sp<SkMesh::IndexBuffer>& buffer);
+
+  // Returns the capacity of a buffer that replaces one with `old_capacity`
+  // bytes when `required_size` bytes are needed.
+  size_t NewCapacity(size_t old_capacity, size_t required_size) const;
+
+  // Calls the upload observer, if any, with `size` bytes of `data` uploaded to
+  // `buffer` at `offset`.
+  void NotifyUpload(const void* buffer, size_t offset, const void* data,
+                    size_t size);
+
+  BufferSizing sizing_;
+  GrDirectContext* context_ = nullptr;
+  absl::InlinedVector<CoatBuffers, 1> coat_buffers_;
+  UploadStats last_upload_stats_;
+  UploadObserver upload_observer_;
+  // Scratch space for the data being uploaded.
+  std::vector<std::byte> vertex_staging_;
+  std::vector<std::byte> partition_vertices_;
+  std::vector<uint16_t> index_staging_;
+};
+
+}  // namespace ink::skia_native_internal
+
+#endif  // INK_RENDERING_SKIA_NATIVE_INTERNAL_IN_PROGRESS_STROKE_RENDER_CACHE_H_
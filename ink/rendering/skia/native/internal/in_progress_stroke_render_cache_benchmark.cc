@@ -0,0 +1,101 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "absl/container/inlined_vector.h"
+#include "absl/log/absl_check.h"
+#include "absl/status/statusor.h"
+#include "benchmark/benchmark.h"
+#include "ink/brush/brush.h"
+#include "ink/brush/brush_family.h"
+#include "ink/brush/brush_paint.h"
+#include "ink/brush/brush_tip.h"
+#include "ink/color/color.h"
+#include "ink/geometry/rect.h"
+#include "ink/rendering/skia/native/internal/in_progress_stroke_render_cache.h"
+#include "ink/rendering/skia/native/internal/mesh_drawable.h"
+#include "ink/strokes/in_progress_stroke.h"
+#include "ink/strokes/input/recorded_test_inputs.h"
+#include "ink/strokes/input/stroke_input_batch.h"
+#include "ink/types/duration.h"
+#include "include/core/SkRefCnt.h"
+#include "include/gpu/ganesh/GrDirectContext.h"
+#include "include/gpu/ganesh/mock/GrMockTypes.h"
+
+namespace ink::skia_native_internal {
+namespace {
+
+Brush MakeBrush() {
+  absl::StatusOr<BrushFamily> family =
+      BrushFamily::Create(BrushTip{}, BrushPaint{});
+  ABSL_CHECK_OK(family);
+  absl::StatusOr<Brush> brush = Brush::Create(*family, Color::Black(), 5, 0.1);
+  ABSL_CHECK_OK(brush);
+  return *brush;
+}
+
+// Draws the recorded spring-shaped stroke scaled by `state.range(0)`, so that
+// larger arguments produce longer strokes with more vertices, and reports the
+// average number of bytes uploaded per frame with the render cache, compared to
+// the size of the mesh (which is what would be uploaded on every frame without
+// the cache).
+void BM_InProgressStrokeUploadPerFrame(benchmark::State& state) {
+  GrMockOptions options;
+  sk_sp<GrDirectContext> context = GrDirectContext::MakeMock(&options);
+  ABSL_CHECK(context != nullptr);
+  float scale = state.range(0);
+  std::vector<std::pair<StrokeInputBatch, StrokeInputBatch>> inputs =
+      MakeIncrementalSpringShapeInputs(
+          Rect::FromTwoPoints({0, 0}, {100 * scale, 100 * scale}));
+  Brush brush = MakeBrush();
+  InProgressStroke stroke;
+  InProgressStrokeRenderCache cache;
+
+  size_t frame_count = 0;
+  size_t upload_bytes = 0;
+  size_t mesh_bytes = 0;
+  for (auto s : state) {
+    stroke.Start(brush);
+    for (size_t i = 0; i < inputs.size(); ++i) {
+      ABSL_CHECK_OK(stroke.EnqueueInputs(inputs[i].first, inputs[i].second));
+      ABSL_CHECK_OK(stroke.UpdateShape(Duration32::Seconds(i)));
+      if (stroke.GetMesh(0).TriangleCount() == 0) continue;
+
+      absl::StatusOr<absl::InlinedVector<MeshDrawable::Partition, 1>>
+          partitions = cache.Update(context.get(), stroke, 0);
+      ABSL_CHECK_OK(partitions);
+      benchmark::DoNotOptimize(partitions);
+      ++frame_count;
+      upload_bytes += cache.LastUploadStats().vertex_bytes +
+                      cache.LastUploadStats().index_bytes;
+      mesh_bytes += stroke.GetMesh(0).RawVertexData().size() +
+                    3 * stroke.GetMesh(0).TriangleCount() * sizeof(uint16_t);
+    }
+    // Keep buffer updates from accumulating in the mock context.
+    context->flushAndSubmit();
+  }
+  state.counters["vertices"] = stroke.GetMesh(0).VertexCount();
+  state.counters["upload_bytes_per_frame"] =
+      static_cast<double>(upload_bytes) / frame_count;
+  state.counters["mesh_bytes_per_frame"] =
+      static_cast<double>(mesh_bytes) / frame_count;
+}
+BENCHMARK(BM_InProgressStrokeUploadPerFrame)->RangeMultiplier(2)->Range(1, 16);
+
+}  // namespace
+}  // namespace ink::skia_native_internal
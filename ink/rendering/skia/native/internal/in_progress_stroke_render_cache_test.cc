@@ -0,0 +1,591 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ink/rendering/skia/native/internal/in_progress_stroke_render_cache.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/algorithm/container.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/container/inlined_vector.h"
+#include "absl/functional/function_ref.h"
+#include "absl/log/absl_check.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "ink/brush/brush.h"
+#include "ink/brush/brush_family.h"
+#include "ink/brush/brush_paint.h"
+#include "ink/brush/brush_tip.h"
+#include "ink/color/color.h"
+#include "ink/geometry/mutable_mesh.h"
+#include "ink/geometry/rect.h"
+#include "ink/rendering/skia/native/internal/mesh_drawable.h"
+#include "ink/strokes/in_progress_stroke.h"
+#include "ink/strokes/input/recorded_test_inputs.h"
+#include "ink/strokes/input/stroke_input_batch.h"
+#include "ink/types/duration.h"
+#include "include/core/SkMesh.h"
+#include "include/core/SkRefCnt.h"
+#include "include/gpu/ganesh/GrDirectContext.h"
+#include "include/gpu/ganesh/mock/GrMockTypes.h"
+
+namespace ink::skia_native_internal {
+namespace {
+
+using ::testing::ElementsAreArray;
+using ::testing::Gt;
+using ::testing::HasSubstr;
+using ::testing::Lt;
+
+Brush MakeBrush() {
+  absl::StatusOr<BrushFamily> family =
+      BrushFamily::Create(BrushTip{}, BrushPaint{});
+  ABSL_CHECK_OK(family);
+  absl::StatusOr<Brush> brush = Brush::Create(*family, Color::Black(), 5, 0.1);
+  ABSL_CHECK_OK(brush);
+  return *brush;
+}
+
+sk_sp<GrDirectContext> MakeMockContext() {
+  GrMockOptions options;
+  sk_sp<GrDirectContext> context = GrDirectContext::MakeMock(&options);
+  ABSL_CHECK(context != nullptr);
+  return context;
+}
+
+size_t TotalUploadBytes(const InProgressStrokeRenderCache& cache) {
+  return cache.LastUploadStats().vertex_bytes +
+         cache.LastUploadStats().index_bytes;
+}
+
+using Partitions = absl::InlinedVector<MeshDrawable::Partition, 1>;
+
+void ExpectPartitionsMatchMesh(const Partitions& partitions,
+                               const MutableMesh& mesh) {
+  ASSERT_EQ(partitions.size(), 1u);
+  const MeshDrawable::Partition& partition = partitions.front();
+  ASSERT_NE(partition.vertex_buffer, nullptr);
+  ASSERT_NE(partition.index_buffer, nullptr);
+  EXPECT_EQ(partition.vertex_count, mesh.VertexCount());
+  EXPECT_EQ(partition.index_count, 3 * mesh.TriangleCount());
+  EXPECT_GE(partition.vertex_buffer->size(), mesh.RawVertexData().size());
+  EXPECT_GE(partition.index_buffer->size(),
+            3 * mesh.TriangleCount() * sizeof(uint16_t));
+}
+
+// Records the contents of the buffers uploaded by an
+// `InProgressStrokeRenderCache`, since those of a mock `GrDirectContext` cannot
+// be read back, along with the uploads made since the last `ClearUploads()`.
+class UploadRecorder {
+ public:
+  struct Upload {
+    const void* buffer;
+    size_t offset;
+    size_t size;
+  };
+
+  InProgressStrokeRenderCache::UploadObserver Observer() {
+    return [this](const void* buffer, size_t offset,
+                  absl::Span<const std::byte> data) {
+      std::vector<std::byte>& contents = contents_[buffer];
+      if (contents.size() < offset + data.size()) {
+        contents.resize(offset + data.size());
+      }
+      std::copy(data.begin(), data.end(), contents.begin() + offset);
+      uploads_.push_back(
+          {.buffer = buffer, .offset = offset, .size = data.size()});
+    };
+  }
+
+  // Returns `size` bytes of the contents of `buffer`, starting at `offset`.
+  absl::Span<const std::byte> Contents(const void* buffer, size_t offset,
+                                       size_t size) const {
+    auto it = contents_.find(buffer);
+    ABSL_CHECK(it != contents_.end());
+    ABSL_CHECK_LE(offset + size, it->second.size());
+    return absl::MakeConstSpan(it->second).subspan(offset, size);
+  }
+
+  const std::vector<Upload>& Uploads() const { return uploads_; }
+  void ClearUploads() { uploads_.clear(); }
+
+ private:
+  absl::flat_hash_map<const void*, std::vector<std::byte>> contents_;
+  std::vector<Upload> uploads_;
+};
+
+// Returns the 16-bit triangle indices of `mesh`, as they are uploaded.
+std::vector<std::byte> IndexBytes(const MutableMesh& mesh) {
+  std::vector<uint16_t> indices;
+  for (uint32_t i = 0; i < mesh.TriangleCount(); ++i) {
+    for (uint32_t index : mesh.TriangleIndices(i)) indices.push_back(index);
+  }
+  const std::byte* data = reinterpret_cast<const std::byte*>(indices.data());
+  return std::vector<std::byte>(data, data + indices.size() * sizeof(uint16_t));
+}
+
+// The maximum number of vertices that can be addressed with 16-bit indices.
+constexpr uint32_t kMaxVerticesPerPartition = 1 << 16;
+
+// Appends a long zig-zag to `stroke` in chunks of `inputs_per_chunk` inputs,
+// updating the shape and `cache` after each one and passing the resulting
+// partitions to `on_update`, until the mesh has more than `min_vertex_count`
+// vertices.
+void GrowStroke(GrDirectContext* context, InProgressStroke& stroke,
+                InProgressStrokeRenderCache& cache, uint32_t min_vertex_count,
+                int inputs_per_chunk,
+                absl::FunctionRef<void(Partitions)> on_update) {
+  int input_count = 0;
+  for (int chunk = 0; chunk < 10000; ++chunk) {
+    StrokeInputBatch inputs;
+    for (int i = 0; i < inputs_per_chunk; ++i, ++input_count) {
+      ASSERT_EQ(
+          inputs.Append({.position = {input_count * 2.0f,
+                                      (input_count % 2) * 50.0f},
+                         .elapsed_time = Duration32::Millis(5 * input_count)}),
+          absl::OkStatus());
+    }
+    ASSERT_EQ(stroke.EnqueueInputs(inputs, {}), absl::OkStatus());
+    ASSERT_EQ(stroke.UpdateShape(Duration32::Millis(5 * input_count)),
+              absl::OkStatus());
+    absl::StatusOr<Partitions> partitions = cache.Update(context, stroke, 0);
+    ASSERT_EQ(partitions.status(), absl::OkStatus());
+    on_update(*std::move(partitions));
+    if (stroke.GetMesh(0).VertexCount() > min_vertex_count) return;
+  }
+  FAIL() << "The stroke did not grow past " << min_vertex_count
+         << " vertices.";
+}
+
+// Grows `stroke` until its mesh no longer fits in a single partition.
+void GrowPastOnePartition(GrDirectContext* context, InProgressStroke& stroke,
+                          InProgressStrokeRenderCache& cache) {
+  GrowStroke(context, stroke, cache, kMaxVerticesPerPartition,
+             /*inputs_per_chunk=*/500, [](Partitions) {});
+}
+
+TEST(InProgressStrokeRenderCacheTest, UploadsOnlyChangedData) {
+  sk_sp<GrDirectContext> context = MakeMockContext();
+  InProgressStroke stroke;
+  stroke.Start(MakeBrush());
+  InProgressStrokeRenderCache cache;
+  size_t uploaded_vertex_bytes = 0;
+  size_t mesh_vertex_bytes = 0;
+  int update_count = 0;
+  // The stroke stays small enough to fit in a single partition.
+  ASSERT_NO_FATAL_FAILURE(GrowStroke(
+      context.get(), stroke, cache, kMaxVerticesPerPartition / 2,
+      /*inputs_per_chunk=*/100, [&](Partitions partitions) {
+        ExpectPartitionsMatchMesh(partitions, stroke.GetMesh(0));
+        uploaded_vertex_bytes += cache.LastUploadStats().vertex_bytes;
+        mesh_vertex_bytes += stroke.GetMesh(0).RawVertexData().size();
+        ++update_count;
+      }));
+  ASSERT_THAT(update_count, Gt(10));
+  // Over the course of the stroke, the amount of uploaded data is much less
+  // than uploading the whole mesh on every update, even though the buffers are
+  // reallocated and fully uploaded a few times as they grow.
+  EXPECT_THAT(uploaded_vertex_bytes, Lt(mesh_vertex_bytes / 2));
+
+  // Updating again without any change to the stroke uploads nothing.
+  ASSERT_EQ(cache.Update(context.get(), stroke, 0).status(), absl::OkStatus());
+  EXPECT_EQ(TotalUploadBytes(cache), 0);
+}
+
+TEST(InProgressStrokeRenderCacheTest, IncrementalUploadsMatchFullUpload) {
+  sk_sp<GrDirectContext> context = MakeMockContext();
+  std::vector<std::pair<StrokeInputBatch, StrokeInputBatch>> inputs =
+      MakeIncrementalStraightLineInputs(
+          Rect::FromTwoPoints({0, 0}, {1000, 100}));
+  ASSERT_THAT(inputs.size(), Gt(10));
+
+  InProgressStroke stroke;
+  stroke.Start(MakeBrush());
+  InProgressStrokeRenderCache cache;
+  UploadRecorder recorder;
+  cache.SetUploadObserver(recorder.Observer());
+  InProgressStroke::MeshVersion version;
+  // The partitions returned by the previous update, which also keep their
+  // buffers alive, so that new buffers cannot reuse their addresses.
+  Partitions previous;
+  int in_place_vertex_uploads = 0;
+  int in_place_index_uploads = 0;
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    ASSERT_EQ(stroke.EnqueueInputs(inputs[i].first, inputs[i].second),
+              absl::OkStatus());
+    ASSERT_EQ(stroke.UpdateShape(Duration32::Seconds(i)), absl::OkStatus());
+    const MutableMesh& mesh = stroke.GetMesh(0);
+    if (mesh.TriangleCount() == 0) continue;
+
+    InProgressStroke::MeshChanges changes =
+        stroke.GetMeshChangesSince(0, version);
+    recorder.ClearUploads();
+    absl::StatusOr<Partitions> partitions =
+        cache.Update(context.get(), stroke, 0);
+    ASSERT_EQ(partitions.status(), absl::OkStatus());
+    ASSERT_EQ(partitions->size(), 1u);
+    version = stroke.GetMeshVersion();
+
+    // Updates of the existing buffers start at the first changed vertex, and
+    // at the even triangle at or before the first changed triangle, so that
+    // they are 4-byte aligned.
+    for (const UploadRecorder::Upload& upload : recorder.Uploads()) {
+      if (previous.empty()) break;
+      if (upload.buffer == previous.front().vertex_buffer.get()) {
+        ++in_place_vertex_uploads;
+        EXPECT_EQ(upload.offset, changes.first_vertex * mesh.VertexStride());
+        EXPECT_EQ(upload.offset + upload.size, mesh.RawVertexData().size());
+      } else if (upload.buffer == previous.front().index_buffer.get()) {
+        ++in_place_index_uploads;
+        EXPECT_EQ(upload.offset, 3 * sizeof(uint16_t) *
+                                     (changes.first_triangle & ~uint32_t{1}));
+        EXPECT_EQ(upload.offset % 4, 0u);
+        EXPECT_EQ(upload.size % 4, 0u);
+      }
+    }
+    previous = *std::move(partitions);
+  }
+  EXPECT_THAT(in_place_vertex_uploads, Gt(0));
+  EXPECT_THAT(in_place_index_uploads, Gt(0));
+
+  // The buffers hold the same data as a full upload of the final mesh.
+  const MutableMesh& mesh = stroke.GetMesh(0);
+  InProgressStrokeRenderCache full_cache;
+  UploadRecorder full_recorder;
+  full_cache.SetUploadObserver(full_recorder.Observer());
+  absl::StatusOr<Partitions> full = full_cache.Update(context.get(), stroke, 0);
+  ASSERT_EQ(full.status(), absl::OkStatus());
+  ASSERT_EQ(full->size(), 1u);
+  size_t vertex_size = mesh.RawVertexData().size();
+  size_t index_size = 3 * mesh.TriangleCount() * sizeof(uint16_t);
+  EXPECT_THAT(
+      recorder.Contents(previous.front().vertex_buffer.get(), 0, vertex_size),
+      ElementsAreArray(full_recorder.Contents(
+          full->front().vertex_buffer.get(), 0, vertex_size)));
+  EXPECT_THAT(
+      recorder.Contents(previous.front().index_buffer.get(), 0, index_size),
+      ElementsAreArray(full_recorder.Contents(full->front().index_buffer.get(),
+                                              0, index_size)));
+  EXPECT_THAT(
+      full_recorder.Contents(full->front().vertex_buffer.get(), 0, vertex_size),
+      ElementsAreArray(mesh.RawVertexData()));
+  EXPECT_THAT(
+      full_recorder.Contents(full->front().index_buffer.get(), 0, index_size),
+      ElementsAreArray(IndexBytes(mesh)));
+}
+
+TEST(InProgressStrokeRenderCacheTest, UploadsEverythingForNewStroke) {
+  sk_sp<GrDirectContext> context = MakeMockContext();
+  StrokeInputBatch inputs = MakeCompleteStraightLineInputs(
+      Rect::FromTwoPoints({0, 0}, {1000, 100}));
+
+  InProgressStroke stroke;
+  stroke.Start(MakeBrush());
+  ASSERT_EQ(stroke.EnqueueInputs(inputs, {}), absl::OkStatus());
+  ASSERT_EQ(stroke.UpdateShape(Duration32::Zero()), absl::OkStatus());
+  InProgressStrokeRenderCache cache;
+  ASSERT_EQ(cache.Update(context.get(), stroke, 0).status(), absl::OkStatus());
+
+  // Restarting the same stroke with the same inputs results in the same mesh,
+  // but it must not be assumed to be unchanged.
+  stroke.Start(MakeBrush());
+  ASSERT_EQ(stroke.EnqueueInputs(inputs, {}), absl::OkStatus());
+  ASSERT_EQ(stroke.UpdateShape(Duration32::Zero()), absl::OkStatus());
+  absl::StatusOr<Partitions> partitions =
+      cache.Update(context.get(), stroke, 0);
+  ASSERT_EQ(partitions.status(), absl::OkStatus());
+  ExpectPartitionsMatchMesh(*partitions, stroke.GetMesh(0));
+  EXPECT_EQ(cache.LastUploadStats().vertex_bytes,
+            stroke.GetMesh(0).RawVertexData().size());
+
+  // The same applies to a different stroke.
+  InProgressStroke other_stroke;
+  other_stroke.Start(MakeBrush());
+  ASSERT_EQ(other_stroke.EnqueueInputs(inputs, {}), absl::OkStatus());
+  ASSERT_EQ(other_stroke.UpdateShape(Duration32::Zero()), absl::OkStatus());
+  ASSERT_EQ(cache.Update(context.get(), other_stroke, 0).status(),
+            absl::OkStatus());
+  EXPECT_EQ(cache.LastUploadStats().vertex_bytes,
+            other_stroke.GetMesh(0).RawVertexData().size());
+}
+
+TEST(InProgressStrokeRenderCacheTest, ExactBufferSizingFitsMesh) {
+  sk_sp<GrDirectContext> context = MakeMockContext();
+  InProgressStroke stroke;
+  stroke.Start(MakeBrush());
+  ASSERT_EQ(stroke.EnqueueInputs(MakeCompleteStraightLineInputs(
+                                     Rect::FromTwoPoints({0, 0}, {100, 10})),
+                                 {}),
+            absl::OkStatus());
+  ASSERT_EQ(stroke.UpdateShape(Duration32::Zero()), absl::OkStatus());
+  const MutableMesh& mesh = stroke.GetMesh(0);
+  size_t vertex_size = mesh.RawVertexData().size();
+  // The index data is padded to a multiple of 4 bytes.
+  size_t index_size = (3 * mesh.TriangleCount() * sizeof(uint16_t) + 3) / 4 * 4;
+
+  InProgressStrokeRenderCache exact_cache(
+      InProgressStrokeRenderCache::BufferSizing::kExact);
+  absl::StatusOr<Partitions> partitions =
+      exact_cache.Update(context.get(), stroke, 0);
+  ASSERT_EQ(partitions.status(), absl::OkStatus());
+  ExpectPartitionsMatchMesh(*partitions, mesh);
+  EXPECT_EQ(partitions->front().vertex_buffer->size(), vertex_size);
+  EXPECT_EQ(partitions->front().index_buffer->size(), index_size);
+  EXPECT_EQ(exact_cache.LastUploadStats().vertex_bytes, vertex_size);
+  EXPECT_EQ(exact_cache.LastUploadStats().index_bytes, index_size);
+
+  // A growable cache leaves room for the mesh to grow.
+  InProgressStrokeRenderCache growable_cache;
+  ASSERT_EQ(growable_cache.Update(context.get(), stroke, 0).status(),
+            absl::OkStatus());
+  EXPECT_THAT(TotalUploadBytes(growable_cache),
+              Gt(TotalUploadBytes(exact_cache)));
+}
+
+TEST(InProgressStrokeRenderCacheTest, EmptyMeshIsAnError) {
+  sk_sp<GrDirectContext> context = MakeMockContext();
+  InProgressStroke stroke;
+  stroke.Start(MakeBrush());
+  InProgressStrokeRenderCache cache;
+
+  absl::StatusOr<Partitions> partitions =
+      cache.Update(context.get(), stroke, 0);
+  EXPECT_EQ(partitions.status().code(), absl::StatusCode::kInvalidArgument);
+  EXPECT_THAT(partitions.status().message(), HasSubstr("empty"));
+}
+
+TEST(InProgressStrokeRenderCacheTest, SplitsLargeMeshIntoPartitions) {
+  sk_sp<GrDirectContext> context = MakeMockContext();
+  InProgressStroke stroke;
+  stroke.Start(MakeBrush());
+  InProgressStrokeRenderCache cache;
+  ASSERT_NO_FATAL_FAILURE(GrowPastOnePartition(context.get(), stroke, cache));
+
+  absl::StatusOr<Partitions> partitions =
+      cache.Update(context.get(), stroke, 0);
+  ASSERT_EQ(partitions.status(), absl::OkStatus());
+  ASSERT_THAT(partitions->size(), Gt(1));
+  const MutableMesh& mesh = stroke.GetMesh(0);
+  int32_t index_count = 0;
+  for (const MeshDrawable::Partition& partition : *partitions) {
+    ASSERT_NE(partition.vertex_buffer, nullptr);
+    ASSERT_NE(partition.index_buffer, nullptr);
+    EXPECT_LE(partition.vertex_count, 1 << 16);
+    index_count += partition.index_count;
+  }
+  EXPECT_EQ(index_count, 3 * mesh.TriangleCount());
+}
+
+TEST(InProgressStrokeRenderCacheTest, ReusesPartitionsOfUnchangedLargeMesh) {
+  sk_sp<GrDirectContext> context = MakeMockContext();
+  InProgressStroke stroke;
+  stroke.Start(MakeBrush());
+  InProgressStrokeRenderCache cache;
+  ASSERT_NO_FATAL_FAILURE(GrowPastOnePartition(context.get(), stroke, cache));
+  absl::StatusOr<Partitions> partitions =
+      cache.Update(context.get(), stroke, 0);
+  ASSERT_EQ(partitions.status(), absl::OkStatus());
+  ASSERT_THAT(partitions->size(), Gt(1));
+
+  // Updating again without any change to the stroke reuses every partition,
+  // and uploads nothing.
+  absl::StatusOr<Partitions> new_partitions =
+      cache.Update(context.get(), stroke, 0);
+  ASSERT_EQ(new_partitions.status(), absl::OkStatus());
+  ASSERT_EQ(new_partitions->size(), partitions->size());
+  for (size_t i = 0; i < partitions->size(); ++i) {
+    EXPECT_EQ((*new_partitions)[i].vertex_buffer,
+              (*partitions)[i].vertex_buffer);
+    EXPECT_EQ((*new_partitions)[i].index_buffer,
+              (*partitions)[i].index_buffer);
+    EXPECT_EQ((*new_partitions)[i].vertex_offset,
+              (*partitions)[i].vertex_offset);
+    EXPECT_EQ((*new_partitions)[i].index_offset,
+              (*partitions)[i].index_offset);
+  }
+  EXPECT_EQ(TotalUploadBytes(cache), 0);
+}
+
+TEST(InProgressStrokeRenderCacheTest, UploadsLongStrokeIncrementally) {
+  sk_sp<GrDirectContext> context = MakeMockContext();
+  InProgressStroke stroke;
+  stroke.Start(MakeBrush());
+  InProgressStrokeRenderCache cache;
+  UploadRecorder recorder;
+  cache.SetUploadObserver(recorder.Observer());
+  // Every returned partition is kept, so that new buffers cannot reuse the
+  // addresses of old ones.
+  std::vector<Partitions> updates;
+  size_t uploaded_bytes = 0;
+  InProgressStroke::MeshVersion version;
+  ASSERT_NO_FATAL_FAILURE(GrowStroke(
+      context.get(), stroke, cache, 3 * kMaxVerticesPerPartition,
+      /*inputs_per_chunk=*/20, [&](Partitions partitions) {
+        // Only the partitions that end before the first changed triangle are
+        // frozen into buffers of their own, rather than kept in the tail.
+        InProgressStroke::MeshChanges changes =
+            stroke.GetMeshChangesSince(0, version);
+        version = stroke.GetMeshVersion();
+        uint32_t triangle_end = 0;
+        for (const MeshDrawable::Partition& partition : partitions) {
+          triangle_end += partition.index_count / 3;
+          if (partition.vertex_buffer != partitions.back().vertex_buffer) {
+            EXPECT_LE(triangle_end, changes.first_triangle);
+          }
+        }
+        uploaded_bytes += TotalUploadBytes(cache);
+        updates.push_back(std::move(partitions));
+      }));
+  const MutableMesh& mesh = stroke.GetMesh(0);
+  const Partitions& partitions = updates.back();
+  ASSERT_THAT(partitions.size(), Gt(3));
+  int32_t index_count = 0;
+  for (const MeshDrawable::Partition& partition : partitions) {
+    EXPECT_LE(partition.vertex_count, kMaxVerticesPerPartition);
+    EXPECT_LE(partition.vertex_offset +
+                  partition.vertex_count * mesh.VertexStride(),
+              partition.vertex_buffer->size());
+    EXPECT_LE(partition.index_offset +
+                  partition.index_count * sizeof(uint16_t),
+              partition.index_buffer->size());
+    EXPECT_EQ(partition.index_offset % 4, 0u);
+    index_count += partition.index_count;
+  }
+  EXPECT_EQ(index_count, 3 * mesh.TriangleCount());
+
+  // As long as the changed part of the mesh does not move backwards, a frozen
+  // partition is never dropped, so its buffers are only created once.
+  absl::flat_hash_set<const SkMesh::VertexBuffer*> frozen_buffers;
+  for (const Partitions& update : updates) {
+    for (const MeshDrawable::Partition& partition : update) {
+      if (partition.vertex_buffer != update.back().vertex_buffer) {
+        frozen_buffers.insert(partition.vertex_buffer.get());
+      }
+    }
+  }
+  size_t frozen_count = absl::c_count_if(
+      partitions, [&partitions](const MeshDrawable::Partition& partition) {
+        return partition.vertex_buffer != partitions.back().vertex_buffer;
+      });
+  EXPECT_THAT(frozen_count, Gt(1));
+  EXPECT_EQ(frozen_buffers.size(), frozen_count);
+
+  // Altogether, the uploads amount to a small multiple of the final mesh data,
+  // rather than growing with the square of the stroke length.
+  size_t mesh_bytes = mesh.RawVertexData().size() +
+                      3 * mesh.TriangleCount() * sizeof(uint16_t);
+  EXPECT_THAT(uploaded_bytes, Lt(4 * mesh_bytes));
+
+  // The buffers hold the same partitions as a full upload of the final mesh.
+  InProgressStrokeRenderCache full_cache;
+  UploadRecorder full_recorder;
+  full_cache.SetUploadObserver(full_recorder.Observer());
+  absl::StatusOr<Partitions> full = full_cache.Update(context.get(), stroke, 0);
+  ASSERT_EQ(full.status(), absl::OkStatus());
+  ASSERT_EQ(full->size(), partitions.size());
+  for (size_t i = 0; i < partitions.size(); ++i) {
+    const MeshDrawable::Partition& partition = partitions[i];
+    const MeshDrawable::Partition& full_partition = (*full)[i];
+    ASSERT_EQ(partition.vertex_count, full_partition.vertex_count);
+    ASSERT_EQ(partition.index_count, full_partition.index_count);
+    size_t vertex_size = partition.vertex_count * mesh.VertexStride();
+    size_t index_size = partition.index_count * sizeof(uint16_t);
+    EXPECT_THAT(recorder.Contents(partition.vertex_buffer.get(),
+                                  partition.vertex_offset, vertex_size),
+                ElementsAreArray(full_recorder.Contents(
+                    full_partition.vertex_buffer.get(),
+                    full_partition.vertex_offset, vertex_size)));
+    EXPECT_THAT(recorder.Contents(partition.index_buffer.get(),
+                                  partition.index_offset, index_size),
+                ElementsAreArray(full_recorder.Contents(
+                    full_partition.index_buffer.get(),
+                    full_partition.index_offset, index_size)));
+  }
+}
+
+TEST(InProgressStrokeRenderCacheTest, SelectTrianglesOfWholeMesh) {
+  sk_sp<GrDirectContext> context = MakeMockContext();
+  InProgressStroke stroke;
+  stroke.Start(MakeBrush());
+  ASSERT_EQ(stroke.EnqueueInputs(MakeCompleteStraightLineInputs(
+                                     Rect::FromTwoPoints({0, 0}, {1000, 100})),
+                                 {}),
+            absl::OkStatus());
+  ASSERT_EQ(stroke.UpdateShape(Duration32::Zero()), absl::OkStatus());
+  uint32_t triangle_count = stroke.GetMesh(0).TriangleCount();
+  ASSERT_THAT(triangle_count, Gt(10));
+  InProgressStrokeRenderCache cache;
+  absl::StatusOr<Partitions> partitions =
+      cache.Update(context.get(), stroke, 0);
+  ASSERT_EQ(partitions.status(), absl::OkStatus());
+  ASSERT_EQ(partitions->size(), 1u);
+
+  Partitions tail = cache.SelectTriangles(0, 5, triangle_count);
+  ASSERT_EQ(tail.size(), 1u);
+  EXPECT_EQ(tail[0].index_buffer, (*partitions)[0].index_buffer);
+  EXPECT_EQ(tail[0].index_offset, 5 * 3 * sizeof(uint16_t));
+  EXPECT_EQ(tail[0].index_count, 3 * (triangle_count - 5));
+
+  Partitions middle = cache.SelectTriangles(0, 2, 7);
+  ASSERT_EQ(middle.size(), 1u);
+  EXPECT_EQ(middle[0].index_offset, 2 * 3 * sizeof(uint16_t));
+  EXPECT_EQ(middle[0].index_count, 3 * 5);
+
+  EXPECT_TRUE(cache.SelectTriangles(0, triangle_count, triangle_count).empty());
+}
+
+TEST(InProgressStrokeRenderCacheTest, SelectTrianglesOfLargeMesh) {
+  sk_sp<GrDirectContext> context = MakeMockContext();
+  InProgressStroke stroke;
+  stroke.Start(MakeBrush());
+  InProgressStrokeRenderCache cache;
+  ASSERT_NO_FATAL_FAILURE(GrowPastOnePartition(context.get(), stroke, cache));
+  absl::StatusOr<Partitions> partitions =
+      cache.Update(context.get(), stroke, 0);
+  ASSERT_EQ(partitions.status(), absl::OkStatus());
+  ASSERT_THAT(partitions->size(), Gt(1));
+  uint32_t triangle_count = stroke.GetMesh(0).TriangleCount();
+
+  // Selecting the first and the rest of the triangles splits one partition
+  // between them, and together they draw every triangle once.
+  uint32_t split = (*partitions)[0].index_count / 3 + 7;
+  Partitions head = cache.SelectTriangles(0, 0, split);
+  Partitions tail = cache.SelectTriangles(0, split, triangle_count);
+  ASSERT_EQ(head.size(), 2u);
+  EXPECT_EQ(head[0].index_count, (*partitions)[0].index_count);
+  EXPECT_EQ(head[1].index_count, 3 * 7);
+  EXPECT_EQ(head[1].index_offset, 0u);
+  ASSERT_EQ(tail.size(), partitions->size() - 1);
+  EXPECT_EQ(tail[0].index_buffer, (*partitions)[1].index_buffer);
+  EXPECT_EQ(tail[0].index_offset, 7 * 3 * sizeof(uint16_t));
+  int32_t index_count = 0;
+  for (const MeshDrawable::Partition& partition : head) {
+    index_count += partition.index_count;
+  }
+  for (const MeshDrawable::Partition& partition : tail) {
+    index_count += partition.index_count;
+  }
+  EXPECT_EQ(index_count, 3 * triangle_count);
+}
+
+}  // namespace
+}  // namespace ink::skia_native_internal
@@ -0,0 +1,236 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ink/rendering/skia/native/internal/mesh_buffer_cache.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "absl/container/inlined_vector.h"
+#include "absl/log/absl_check.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "ink/geometry/internal/mesh_packing.h"
+#include "ink/geometry/mesh.h"
+#include "ink/geometry/mesh_format.h"
+#include "ink/geometry/rect.h"
+#include "ink/rendering/skia/native/internal/mesh_drawable.h"
+#include "include/core/SkMesh.h"
+#include "include/core/SkRect.h"
+#include "include/gpu/ganesh/GrDirectContext.h"
+#include "include/gpu/ganesh/SkMeshGanesh.h"
+
+namespace ink::skia_native_internal {
+namespace {
+
+// The largest number of vertices that can be referred to by `SkMesh`'s 16-bit
+// indices.
+constexpr uint32_t kMaxVerticesPerPartition =
+    uint32_t{std::numeric_limits<uint16_t>::max()} + 1;
+
+SkRect ToSkiaRect(const Rect& rect) {
+  return SkRect::MakeLTRB(rect.XMin(), rect.YMin(), rect.XMax(), rect.YMax());
+}
+
+}  // namespace
+
+std::optional<MeshBufferCache::Partitions> MeshBufferCache::Find(
+    GrDirectContext* context, const Mesh& mesh) {
+  UseContext(context);
+  auto it = entries_by_key_.find(KeyFor(mesh));
+  if (it == entries_by_key_.end()) {
+    ++stats_.misses;
+    return std::nullopt;
+  }
+  ++stats_.hits;
+  entries_.splice(entries_.begin(), entries_, it->second);
+  return it->second->partitions;
+}
+
+void MeshBufferCache::Insert(GrDirectContext* context, const Mesh& mesh,
+                             Partitions partitions) {
+  ABSL_CHECK(!partitions.empty());
+  for (const MeshDrawable::Partition& partition : partitions) {
+    ABSL_CHECK_NE(partition.vertex_buffer, nullptr);
+    ABSL_CHECK_NE(partition.index_buffer, nullptr);
+  }
+  UseContext(context);
+  size_t buffers_size = DistinctBuffersSize(partitions);
+  if (buffers_size > byte_budget_) return;
+
+  Key key = KeyFor(mesh);
+  auto [it, inserted] = entries_by_key_.try_emplace(key);
+  if (inserted) {
+    entries_.push_front({.key = key, .mesh = mesh});
+    it->second = entries_.begin();
+    ++stats_.entry_count;
+  } else {
+    entries_.splice(entries_.begin(), entries_, it->second);
+    stats_.cached_bytes -= it->second->buffers_size;
+  }
+  Entry& entry = *it->second;
+  entry.partitions = std::move(partitions);
+  entry.buffers_size = buffers_size;
+  stats_.cached_bytes += buffers_size;
+  // The new entry is the most recently used, and its buffers fit within the
+  // budget on their own, so it is not evicted.
+  EvictToBudget();
+}
+
+absl::StatusOr<MeshBufferCache::Partitions> MeshBufferCache::GetOrCreate(
+    GrDirectContext* context, const Mesh& mesh) {
+  if (std::optional<Partitions> partitions = Find(context, mesh)) {
+    return *std::move(partitions);
+  }
+
+  absl::StatusOr<Partitions> partitions = Upload(context, mesh);
+  if (!partitions.ok()) return partitions.status();
+  Insert(context, mesh, *partitions);
+  return partitions;
+}
+
+absl::StatusOr<MeshBufferCache::Partitions> MeshBufferCache::Upload(
+    GrDirectContext* context, const Mesh& mesh) {
+  SkRect bounds = ToSkiaRect(*mesh.Bounds().AsRect());
+  if (mesh.IndexStride() == sizeof(uint16_t)) {
+    absl::Span<const std::byte> vertex_data = mesh.RawVertexData();
+    absl::Span<const std::byte> index_data = mesh.RawIndexData();
+    MeshDrawable::Partition partition = {
+        .vertex_buffer = SkMeshes::MakeVertexBuffer(
+            context, vertex_data.data(), vertex_data.size()),
+        .index_buffer = SkMeshes::MakeIndexBuffer(context, index_data.data(),
+                                                  index_data.size()),
+        .vertex_count = static_cast<int32_t>(mesh.VertexCount()),
+        .index_count = static_cast<int32_t>(3 * mesh.TriangleCount()),
+        .bounds = bounds,
+    };
+    if (partition.vertex_buffer == nullptr ||
+        partition.index_buffer == nullptr) {
+      return absl::InternalError("Failed to create an `SkMesh` buffer.");
+    }
+    return Partitions{std::move(partition)};
+  }
+
+  // The mesh's packed indices are 32-bit, which is also their unpacked size,
+  // so they can be partitioned directly. The partitions' vertices and 16-bit
+  // indices are gathered into one pair of buffers.
+  ABSL_DCHECK_EQ(MeshFormat::UnpackedIndexSize(mesh.Format().GetIndexFormat()),
+                 mesh.IndexStride());
+  absl::InlinedVector<mesh_internal::PartitionInfo, 1> partition_infos =
+      mesh_internal::PartitionTriangles(mesh.RawIndexData(),
+                                        mesh.Format().GetIndexFormat(),
+                                        kMaxVerticesPerPartition);
+  uint32_t vertex_stride = mesh.Format().PackedVertexStride();
+  absl::Span<const std::byte> mesh_vertex_data = mesh.RawVertexData();
+  std::vector<std::byte> vertex_data;
+  vertex_data.reserve(mesh_vertex_data.size());
+  std::vector<uint16_t> index_data;
+  index_data.reserve(3 * mesh.TriangleCount() + partition_infos.size());
+  Partitions partitions;
+  partitions.reserve(partition_infos.size());
+  for (const mesh_internal::PartitionInfo& info : partition_infos) {
+    partitions.push_back({
+        .vertex_count = static_cast<int32_t>(info.vertex_indices.size()),
+        .index_count = static_cast<int32_t>(3 * info.triangles.size()),
+        .bounds = bounds,
+        .vertex_offset = vertex_data.size(),
+        .index_offset = index_data.size() * sizeof(uint16_t),
+    });
+    for (uint32_t vertex_index : info.vertex_indices) {
+      absl::Span<const std::byte> vertex = mesh_vertex_data.subspan(
+          size_t{vertex_index} * vertex_stride, vertex_stride);
+      vertex_data.insert(vertex_data.end(), vertex.begin(), vertex.end());
+    }
+    for (const std::array<uint32_t, 3>& triangle : info.triangles) {
+      for (uint32_t index : triangle) {
+        index_data.push_back(static_cast<uint16_t>(index));
+      }
+    }
+    // Keep the offset of the next partition's indices 4-byte aligned.
+    if (index_data.size() % 2 != 0) index_data.push_back(0);
+  }
+
+  sk_sp<SkMesh::VertexBuffer> vertex_buffer = SkMeshes::MakeVertexBuffer(
+      context, vertex_data.data(), vertex_data.size());
+  sk_sp<SkMesh::IndexBuffer> index_buffer = SkMeshes::MakeIndexBuffer(
+      context, index_data.data(), index_data.size() * sizeof(uint16_t));
+  if (vertex_buffer == nullptr || index_buffer == nullptr) {
+    return absl::InternalError("Failed to create an `SkMesh` buffer.");
+  }
+  for (MeshDrawable::Partition& partition : partitions) {
+    partition.vertex_buffer = vertex_buffer;
+    partition.index_buffer = index_buffer;
+  }
+  return partitions;
+}
+
+void MeshBufferCache::SetByteBudget(size_t byte_budget) {
+  byte_budget_ = byte_budget;
+  EvictToBudget();
+}
+
+void MeshBufferCache::Clear() {
+  entries_.clear();
+  entries_by_key_.clear();
+  stats_.entry_count = 0;
+  stats_.cached_bytes = 0;
+}
+
+MeshBufferCache::Key MeshBufferCache::KeyFor(const Mesh& mesh) {
+  return {mesh.RawVertexData().data(), mesh.RawIndexData().data()};
+}
+
+size_t MeshBufferCache::DistinctBuffersSize(const Partitions& partitions) {
+  // The partitions of a mesh with 32-bit indices share one pair of buffers.
+  absl::InlinedVector<const void*, 2> buffers;
+  size_t size = 0;
+  auto add_buffer = [&buffers, &size](const auto& buffer) {
+    for (const void* existing : buffers) {
+      if (existing == buffer.get()) return;
+    }
+    buffers.push_back(buffer.get());
+    size += buffer->size();
+  };
+  for (const MeshDrawable::Partition& partition : partitions) {
+    add_buffer(partition.vertex_buffer);
+    add_buffer(partition.index_buffer);
+  }
+  return size;
+}
+
+void MeshBufferCache::UseContext(GrDirectContext* context) {
+  if (context == context_) return;
+  Clear();
+  context_ = context;
+}
+
+void MeshBufferCache::EvictToBudget() {
+  while (stats_.cached_bytes > byte_budget_) {
+    ABSL_DCHECK(!entries_.empty());
+    const Entry& entry = entries_.back();
+    stats_.cached_bytes -= entry.buffers_size;
+    --stats_.entry_count;
+    ++stats_.evictions;
+    entries_by_key_.erase(entry.key);
+    entries_.pop_back();
+  }
+}
+
+}  // namespace ink::skia_native_internal
@@ -0,0 +1,146 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef INK_RENDERING_SKIA_NATIVE_INTERNAL_MESH_BUFFER_CACHE_H_
+#define INK_RENDERING_SKIA_NATIVE_INTERNAL_MESH_BUFFER_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <optional>
+#include <utility>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/inlined_vector.h"
+#include "absl/status/statusor.h"
+#include "ink/geometry/mesh.h"
+#include "ink/rendering/skia/native/internal/mesh_drawable.h"
+#include "include/gpu/ganesh/GrDirectContext.h"
+
+namespace ink::skia_native_internal {
+
+// A least-recently-used cache of the `SkMesh` vertex and index buffers holding
+// the data of immutable `Mesh`es, with a budget for the total size of the
+// cached buffers.
+//
+// Entries are keyed on the identity of the data that is shared by copies of a
+// `Mesh`, so drawing the same stroke again (e.g. while panning or zooming)
+// reuses the buffers that were uploaded the first time. Each entry holds a copy
+// of its `Mesh`, which keeps the data alive and guarantees that a key is not
+// reused by a different mesh while the entry is cached.
+//
+// Each entry is counted against the budget at the full size of its buffers.
+// Entries are not expected to share buffers with each other, since the buffers
+// of an entry that shares them would stay alive after it is evicted.
+//
+// Buffers belong to the `GrDirectContext` that created them, so the cache is
+// cleared whenever it is used with a different context.
+//
+// `SkMesh` only supports 16-bit indices, so a `Mesh` with 32-bit indices (see
+// `MeshFormat::IndexFormat::k32BitUnpacked32BitPacked`) is drawn with several
+// partitions of at most 2^16 vertices each, which share one pair of buffers.
+class MeshBufferCache {
+ public:
+  // The partitions drawing one `Mesh`; there is exactly one unless the mesh
+  // uses 32-bit indices.
+  using Partitions = absl::InlinedVector<MeshDrawable::Partition, 1>;
+
+  // Counters describing the use of the cache since it was constructed.
+  struct Stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    // The number of currently cached entries, and the total size of their
+    // buffers.
+    size_t entry_count = 0;
+    size_t cached_bytes = 0;
+  };
+
+  static constexpr size_t kDefaultByteBudget = 64 * 1024 * 1024;
+
+  explicit MeshBufferCache(size_t byte_budget = kDefaultByteBudget)
+      : byte_budget_(byte_budget) {}
+  MeshBufferCache(const MeshBufferCache&) = delete;
+  MeshBufferCache(MeshBufferCache&&) = default;
+  MeshBufferCache& operator=(const MeshBufferCache&) = delete;
+  MeshBufferCache& operator=(MeshBufferCache&&) = default;
+  ~MeshBufferCache() = default;
+
+  // Returns the cached partitions drawing `mesh` with `context`, and marks
+  // them as the most recently used. Returns `std::nullopt` if there are none.
+  std::optional<Partitions> Find(GrDirectContext* context, const Mesh& mesh);
+
+  // Adds `partitions`, which must draw `mesh` with buffers created by
+  // `context`, to the cache, evicting the least recently used entries to stay
+  // within the byte budget. If the partitions' buffers are larger than the
+  // whole budget, they are not cached.
+  void Insert(GrDirectContext* context, const Mesh& mesh,
+              Partitions partitions);
+
+  // Returns the cached partitions for `mesh`, or uploads the mesh to new
+  // buffers and caches them. Returns an error if a buffer could not be
+  // created.
+  absl::StatusOr<Partitions> GetOrCreate(GrDirectContext* context,
+                                         const Mesh& mesh);
+
+  // Uploads `mesh` to new buffers created by `context`, without caching them.
+  // A mesh with 32-bit indices is split into partitions of at most 2^16
+  // vertices. Returns an error if a buffer could not be created.
+  static absl::StatusOr<Partitions> Upload(GrDirectContext* context,
+                                           const Mesh& mesh);
+
+  // Sets the budget for the total size of the cached buffers, evicting entries
+  // as needed.
+  void SetByteBudget(size_t byte_budget);
+  size_t ByteBudget() const { return byte_budget_; }
+
+  // Removes all entries.
+  void Clear();
+
+  const Stats& GetStats() const { return stats_; }
+
+ private:
+  // The data pointers of a `Mesh`, which are shared by all of its copies.
+  using Key = std::pair<const std::byte*, const std::byte*>;
+
+  struct Entry {
+    Key key;
+    Mesh mesh;
+    Partitions partitions;
+    // The total size of the distinct buffers used by `partitions`.
+    size_t buffers_size;
+  };
+
+  static Key KeyFor(const Mesh& mesh);
+  // Returns the total size of the distinct buffers used by `partitions`.
+  static size_t DistinctBuffersSize(const Partitions& partitions);
+
+  // Clears the cache if it was last used with a different `context`.
+  void UseContext(GrDirectContext* context);
+
+  // Evicts the least recently used entries until the cached buffers fit within
+  // the byte budget.
+  void EvictToBudget();
+
+  size_t byte_budget_;
+  GrDirectContext* context_ = nullptr;
+  // Entries, most recently used first.
+  std::list<Entry> entries_;
+  absl::flat_hash_map<Key, std::list<Entry>::iterator> entries_by_key_;
+  Stats stats_;
+};
+
+}  // namespace ink::skia_native_internal
+
+#endif  // INK_RENDERING_SKIA_NATIVE_INTERNAL_MESH_BUFFER_CACHE_H_
@@ -0,0 +1,230 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ink/rendering/skia/native/internal/mesh_buffer_cache.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/log/absl_check.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "ink/geometry/mesh.h"
+#include "ink/geometry/mesh_format.h"
+#include "ink/rendering/skia/native/internal/mesh_drawable.h"
+#include "include/core/SkRefCnt.h"
+#include "include/gpu/ganesh/GrDirectContext.h"
+#include "include/gpu/ganesh/mock/GrMockTypes.h"
+
+namespace ink::skia_native_internal {
+namespace {
+
+using ::testing::Eq;
+using ::testing::Ne;
+using ::testing::SizeIs;
+
+using Partitions = MeshBufferCache::Partitions;
+
+sk_sp<GrDirectContext> MakeMockContext() {
+  GrMockOptions options;
+  sk_sp<GrDirectContext> context = GrDirectContext::MakeMock(&options);
+  ABSL_CHECK(context != nullptr);
+  return context;
+}
+
+// Returns a mesh with a single triangle, offset by `x`.
+Mesh MakeTriangleMesh(float x) {
+  absl::StatusOr<Mesh> mesh =
+      Mesh::Create(MeshFormat(), {{x, x + 10, x}, {0, 0, 10}}, {0, 1, 2});
+  ABSL_CHECK_OK(mesh);
+  return *mesh;
+}
+
+size_t DataSize(const Mesh& mesh) {
+  return mesh.RawVertexData().size() + mesh.RawIndexData().size();
+}
+
+size_t BufferSize(const MeshDrawable::Partition& partition) {
+  return partition.vertex_buffer->size() + partition.index_buffer->size();
+}
+
+TEST(MeshBufferCacheTest, ReusesBuffersForCopiesOfMesh) {
+  sk_sp<GrDirectContext> context = MakeMockContext();
+  MeshBufferCache cache;
+  Mesh mesh = MakeTriangleMesh(0);
+
+  absl::StatusOr<Partitions> first = cache.GetOrCreate(context.get(), mesh);
+  ASSERT_EQ(first.status(), absl::OkStatus());
+  ASSERT_THAT(*first, SizeIs(1));
+  ASSERT_NE((*first)[0].vertex_buffer, nullptr);
+  ASSERT_NE((*first)[0].index_buffer, nullptr);
+  EXPECT_EQ((*first)[0].vertex_count, 3);
+  EXPECT_EQ((*first)[0].index_count, 3);
+
+  Mesh copy = mesh;
+  absl::StatusOr<Partitions> second = cache.GetOrCreate(context.get(), copy);
+  ASSERT_EQ(second.status(), absl::OkStatus());
+  ASSERT_THAT(*second, SizeIs(1));
+  EXPECT_EQ((*second)[0].vertex_buffer, (*first)[0].vertex_buffer);
+  EXPECT_EQ((*second)[0].index_buffer, (*first)[0].index_buffer);
+
+  EXPECT_EQ(cache.GetStats().hits, 1);
+  EXPECT_EQ(cache.GetStats().misses, 1);
+  EXPECT_EQ(cache.GetStats().entry_count, 1);
+  EXPECT_EQ(cache.GetStats().cached_bytes, DataSize(mesh));
+}
+
+TEST(MeshBufferCacheTest, DifferentMeshesGetDifferentBuffers) {
+  sk_sp<GrDirectContext> context = MakeMockContext();
+  MeshBufferCache cache;
+
+  absl::StatusOr<Partitions> first =
+      cache.GetOrCreate(context.get(), MakeTriangleMesh(0));
+  absl::StatusOr<Partitions> second =
+      cache.GetOrCreate(context.get(), MakeTriangleMesh(0));
+  ASSERT_EQ(first.status(), absl::OkStatus());
+  ASSERT_EQ(second.status(), absl::OkStatus());
+  EXPECT_NE(second->front().vertex_buffer, first->front().vertex_buffer);
+  EXPECT_EQ(cache.GetStats().misses, 2);
+}
+
+TEST(MeshBufferCacheTest, EvictsLeastRecentlyUsed) {
+  sk_sp<GrDirectContext> context = MakeMockContext();
+  Mesh a = MakeTriangleMesh(0);
+  Mesh b = MakeTriangleMesh(100);
+  Mesh c = MakeTriangleMesh(200);
+  MeshBufferCache cache(DataSize(a) + DataSize(b));
+
+  ASSERT_EQ(cache.GetOrCreate(context.get(), a).status(), absl::OkStatus());
+  ASSERT_EQ(cache.GetOrCreate(context.get(), b).status(), absl::OkStatus());
+  // Using `a` again makes `b` the least recently used.
+  ASSERT_THAT(cache.Find(context.get(), a), Ne(std::nullopt));
+  ASSERT_EQ(cache.GetOrCreate(context.get(), c).status(), absl::OkStatus());
+
+  EXPECT_EQ(cache.GetStats().evictions, 1);
+  EXPECT_EQ(cache.GetStats().entry_count, 2);
+  EXPECT_EQ(cache.GetStats().cached_bytes, DataSize(a) + DataSize(c));
+  EXPECT_THAT(cache.Find(context.get(), b), Eq(std::nullopt));
+  EXPECT_THAT(cache.Find(context.get(), a), Ne(std::nullopt));
+  EXPECT_THAT(cache.Find(context.get(), c), Ne(std::nullopt));
+}
+
+TEST(MeshBufferCacheTest, DoesNotCacheMeshLargerThanBudget) {
+  sk_sp<GrDirectContext> context = MakeMockContext();
+  Mesh mesh = MakeTriangleMesh(0);
+  MeshBufferCache cache(DataSize(mesh) - 1);
+
+  absl::StatusOr<Partitions> partitions =
+      cache.GetOrCreate(context.get(), mesh);
+  ASSERT_EQ(partitions.status(), absl::OkStatus());
+  ASSERT_THAT(*partitions, SizeIs(1));
+  EXPECT_NE(partitions->front().vertex_buffer, nullptr);
+  EXPECT_EQ(cache.GetStats().entry_count, 0);
+  EXPECT_THAT(cache.Find(context.get(), mesh), Eq(std::nullopt));
+}
+
+TEST(MeshBufferCacheTest, SetByteBudgetEvicts) {
+  sk_sp<GrDirectContext> context = MakeMockContext();
+  Mesh a = MakeTriangleMesh(0);
+  Mesh b = MakeTriangleMesh(100);
+  MeshBufferCache cache;
+  ASSERT_EQ(cache.GetOrCreate(context.get(), a).status(), absl::OkStatus());
+  ASSERT_EQ(cache.GetOrCreate(context.get(), b).status(), absl::OkStatus());
+
+  cache.SetByteBudget(DataSize(b));
+  EXPECT_EQ(cache.ByteBudget(), DataSize(b));
+  EXPECT_EQ(cache.GetStats().evictions, 1);
+  EXPECT_THAT(cache.Find(context.get(), a), Eq(std::nullopt));
+  EXPECT_THAT(cache.Find(context.get(), b), Ne(std::nullopt));
+}
+
+TEST(MeshBufferCacheTest, InsertReplacesEntryForSameMesh) {
+  sk_sp<GrDirectContext> context = MakeMockContext();
+  Mesh mesh = MakeTriangleMesh(0);
+  MeshBufferCache cache;
+  ASSERT_EQ(cache.GetOrCreate(context.get(), mesh).status(), absl::OkStatus());
+
+  absl::StatusOr<Partitions> replacement =
+      MeshBufferCache::Upload(context.get(), mesh);
+  ASSERT_EQ(replacement.status(), absl::OkStatus());
+  cache.Insert(context.get(), mesh, *replacement);
+
+  std::optional<Partitions> found = cache.Find(context.get(), mesh);
+  ASSERT_THAT(found, Ne(std::nullopt));
+  ASSERT_THAT(*found, SizeIs(1));
+  EXPECT_EQ(found->front().vertex_buffer, replacement->front().vertex_buffer);
+  // The replaced buffers are no longer counted.
+  EXPECT_EQ(cache.GetStats().entry_count, 1);
+  EXPECT_EQ(cache.GetStats().cached_bytes, BufferSize(replacement->front()));
+}
+
+TEST(MeshBufferCacheTest, SplitsMeshWith32BitIndicesIntoPartitions) {
+  sk_sp<GrDirectContext> context = MakeMockContext();
+  absl::StatusOr<MeshFormat> format = MeshFormat::Create(
+      {{MeshFormat::AttributeType::kFloat2Unpacked,
+        MeshFormat::AttributeId::kPosition}},
+      MeshFormat::IndexFormat::k32BitUnpacked32BitPacked);
+  ASSERT_EQ(format.status(), absl::OkStatus());
+  // A strip of 2 * 50000 vertices, which is more than a 16-bit index can refer
+  // to.
+  constexpr uint32_t kColumnCount = 50000;
+  std::vector<float> x_values;
+  std::vector<float> y_values;
+  std::vector<uint32_t> indices;
+  for (uint32_t i = 0; i < kColumnCount; ++i) {
+    x_values.insert(x_values.end(), {static_cast<float>(i), 0.5f + i});
+    y_values.insert(y_values.end(), {0, 1});
+    if (i == 0) continue;
+    uint32_t v = 2 * i;
+    indices.insert(indices.end(), {v - 2, v, v - 1, v - 1, v, v + 1});
+  }
+  absl::StatusOr<Mesh> mesh =
+      Mesh::Create(*format, {x_values, y_values}, indices);
+  ASSERT_EQ(mesh.status(), absl::OkStatus());
+  MeshBufferCache cache;
+
+  absl::StatusOr<Partitions> partitions =
+      cache.GetOrCreate(context.get(), *mesh);
+  ASSERT_EQ(partitions.status(), absl::OkStatus());
+  ASSERT_THAT(*partitions, SizeIs(2));
+  int32_t total_index_count = 0;
+  for (const MeshDrawable::Partition& partition : *partitions) {
+    EXPECT_LE(partition.vertex_count, 1 << 16);
+    EXPECT_EQ(partition.index_offset % 4, 0);
+    EXPECT_EQ(partition.vertex_buffer, partitions->front().vertex_buffer);
+    EXPECT_EQ(partition.index_buffer, partitions->front().index_buffer);
+    total_index_count += partition.index_count;
+  }
+  EXPECT_EQ(total_index_count, 3 * mesh->TriangleCount());
+  EXPECT_EQ(cache.GetStats().cached_bytes, BufferSize(partitions->front()));
+}
+
+TEST(MeshBufferCacheTest, ChangingContextClearsCache) {
+  sk_sp<GrDirectContext> context = MakeMockContext();
+  sk_sp<GrDirectContext> other_context = MakeMockContext();
+  Mesh mesh = MakeTriangleMesh(0);
+  MeshBufferCache cache;
+  ASSERT_EQ(cache.GetOrCreate(context.get(), mesh).status(), absl::OkStatus());
+
+  EXPECT_THAT(cache.Find(other_context.get(), mesh), Eq(std::nullopt));
+  EXPECT_EQ(cache.GetStats().entry_count, 0);
+  EXPECT_EQ(cache.GetStats().cached_bytes, 0);
+}
+
+}  // namespace
+}  // namespace ink::skia_native_internal
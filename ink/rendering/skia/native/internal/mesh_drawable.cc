@@ -36,7 +36,7 @@
 namespace ink::skia_native_internal {
 namespace {
 
-// Calls `SkMesh::MakeIndexed()` with a default mode and offsets.
+// Calls `SkMesh::MakeIndexed()` with a default mode.
 //
 // This wrapper helps to make it clear that certain parameters are the same for
 // both initial validation and drawing.
@@ -45,9 +45,9 @@ SkMesh::Result MakeSkiaMesh(sk_sp<SkMeshSpecification> specification,
                             sk_sp<const SkData> uniforms) {
   return SkMesh::MakeIndexed(std::move(specification), SkMesh::Mode::kTriangles,
                              partition.vertex_buffer, partition.vertex_count,
-                             /* vertexOffset = */ 0, partition.index_buffer,
-                             partition.index_count,
-                             /* indexOffset = */ 0, std::move(uniforms),
+                             partition.vertex_offset, partition.index_buffer,
+                             partition.index_count, partition.index_offset,
+                             std::move(uniforms),
                              /* children= */ {}, partition.bounds);
 }
 
@@ -15,6 +15,7 @@
 #ifndef INK_RENDERING_SKIA_NATIVE_INTERNAL_MESH_DRAWABLE_H_
 #define INK_RENDERING_SKIA_NATIVE_INTERNAL_MESH_DRAWABLE_H_
 
+#include <cstddef>
 #include <cstdint>
 #include <optional>
 
@@ -45,13 +46,16 @@ class MeshDrawable {
   // A single partition of the mesh.
   //
   // The members correspond to a subset of parameters of `SkMesh::MakeIndexed()`
-  // with implicit `Mode::kTriangles` and vertex and index offsets of 0.
+  // with implicit `Mode::kTriangles`. The offsets are in bytes, and allow
+  // several partitions to share the same buffers.
   struct Partition {
     sk_sp<SkMesh::VertexBuffer> vertex_buffer;
     sk_sp<SkMesh::IndexBuffer> index_buffer;
     int32_t vertex_count;
     int32_t index_count;
     SkRect bounds;
+    size_t vertex_offset = 0;
+    size_t index_offset = 0;
   };
 
   // Creates and returns a new `MeshDrawable` with the given `specification`,
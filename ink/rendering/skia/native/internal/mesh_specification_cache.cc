@@ -85,4 +85,16 @@ absl::StatusOr<sk_sp<SkMeshSpecification>> MeshSpecificationCache::GetForStroke(
   return cached_specification;
 }
 
+sk_sp<SkMeshSpecification> MeshSpecificationCache::GetForStrokeBatch() {
+  if (stroke_batch_specification_ == nullptr) {
+    absl::StatusOr<sk_sp<SkMeshSpecification>> specification =
+        CreateMeshSpecification(MeshSpecificationData::CreateForStrokeBatch());
+    // The specification data does not depend on any input, so creating the
+    // `SkMeshSpecification` should always succeed.
+    ABSL_CHECK_OK(specification);
+    stroke_batch_specification_ = *std::move(specification);
+  }
+  return stroke_batch_specification_;
+}
+
 }  // namespace ink::skia_native_internal
@@ -59,6 +59,10 @@ class MeshSpecificationCache {
   absl::StatusOr<sk_sp<SkMeshSpecification>> GetForStroke(
       const PartitionedMesh& stroke_shape, uint32_t coat_index);
 
+  // Returns the specification for drawing the meshes of several strokes at
+  // once, whose vertices are built by `StrokeMeshBatch`.
+  sk_sp<SkMeshSpecification> GetForStrokeBatch();
+
  private:
   // TODO: b/284117747 - Update the in-progress stroke cache to a hash map if we
   // move to using Skia shader-uniforms in C++, which means the `BrushPaint`
@@ -66,6 +70,7 @@ class MeshSpecificationCache {
   // the stroke hash map would need to be made of both the `MeshFormat` and the
   // `BrushPaint`.
   sk_sp<SkMeshSpecification> in_progress_stroke_specification_;
+  sk_sp<SkMeshSpecification> stroke_batch_specification_;
   absl::flat_hash_map<MeshFormat, sk_sp<SkMeshSpecification>>
       stroke_specifications_;
 };
@@ -190,5 +190,12 @@ TEST(MeshSpecificationCacheTest, GetForProvidedUnsupportedShape) {
   EXPECT_THAT(missing_required_attr.message(), HasSubstr("are required"));
 }
 
+TEST(MeshSpecificationCacheTest, GetForStrokeBatch) {
+  MeshSpecificationCache cache;
+  sk_sp<SkMeshSpecification> spec = cache.GetForStrokeBatch();
+  EXPECT_THAT(spec, Pointer(NotNull()));
+  EXPECT_THAT(cache.GetForStrokeBatch(), Eq(spec));
+}
+
 }  // namespace
 }  // namespace ink::skia_native_internal
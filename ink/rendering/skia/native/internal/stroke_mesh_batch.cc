@@ -0,0 +1,156 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ink/rendering/skia/native/internal/stroke_mesh_batch.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "absl/functional/function_ref.h"
+#include "absl/log/absl_check.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "ink/color/color.h"
+#include "ink/color/color_space.h"
+#include "ink/geometry/mesh.h"
+#include "ink/geometry/point.h"
+#include "ink/geometry/rect.h"
+#include "ink/geometry/vec.h"
+#include "ink/rendering/skia/native/internal/mesh_drawable.h"
+#include "ink/strokes/internal/stroke_vertex.h"
+#include "include/core/SkMesh.h"
+#include "include/core/SkRect.h"
+#include "include/gpu/ganesh/GrDirectContext.h"
+#include "include/gpu/ganesh/SkMeshGanesh.h"
+
+namespace ink::skia_native_internal {
+namespace {
+
+using ::ink::strokes_internal::StrokeVertex;
+
+// The brush color immediately follows the `StrokeVertex`, as expected by
+// `MeshSpecificationData::CreateForStrokeBatch()`.
+static_assert(offsetof(StrokeMeshBatch::Vertex, brush_color) ==
+              sizeof(StrokeVertex));
+static_assert(sizeof(StrokeMeshBatch::Vertex) ==
+              sizeof(StrokeVertex) + 4 * sizeof(float));
+
+SkRect ToSkiaRect(const Rect& rect) {
+  return SkRect::MakeLTRB(rect.XMin(), rect.YMin(), rect.XMax(), rect.YMax());
+}
+
+}  // namespace
+
+void StrokeMeshBatch::Append(const Mesh& mesh, Vec offset,
+                             const Color& brush_color) {
+  ABSL_CHECK(CanAppend(mesh));
+  StrokeVertex::FormatAttributeIndices indices =
+      StrokeVertex::FindAttributeIndices(mesh.Format());
+  ABSL_CHECK(indices.opacity_shift != -1 && indices.side_derivative != -1 &&
+             indices.side_label != -1 && indices.forward_derivative != -1 &&
+             indices.forward_label != -1)
+      << "Unsupported `MeshFormat`: " << mesh.Format();
+
+  uint32_t first_vertex = vertices_.size();
+  uint32_t vertex_count = mesh.VertexCount();
+  if (vertex_count == 0) return;
+  Color::RgbaFloat rgba = brush_color.InColorSpace(ColorSpace::kSrgb)
+                              .AsFloat(Color::Format::kLinear);
+  vertices_.resize(first_vertex + vertex_count, {.brush_color = rgba});
+  absl::Span<Vertex> vertices =
+      absl::MakeSpan(vertices_).subspan(first_vertex, vertex_count);
+
+  // Decode one attribute of every vertex at a time, and scatter its values
+  // into the `StrokeVertex`es with `set_values`, which gets the decoded values
+  // for one vertex.
+  auto decode = [&](int8_t attribute_index, int component_count,
+                    absl::FunctionRef<void(StrokeVertex&, const float*)>
+                        set_values) {
+    if (attribute_index == -1) return;
+    attribute_values_.resize(size_t{component_count} * vertex_count);
+    mesh.DecodeAttribute(attribute_index, absl::MakeSpan(attribute_values_));
+    for (uint32_t i = 0; i < vertex_count; ++i) {
+      set_values(vertices[i].stroke_vertex,
+                 &attribute_values_[size_t{component_count} * i]);
+    }
+  };
+  decode(indices.position, 2, [offset](StrokeVertex& v, const float* values) {
+    v.position = Point{values[0], values[1]} + offset;
+  });
+  decode(indices.opacity_shift, 1, [](StrokeVertex& v, const float* values) {
+    v.non_position_attributes.opacity_shift = values[0];
+  });
+  decode(indices.hsl_shift, 3, [](StrokeVertex& v, const float* values) {
+    v.non_position_attributes.hsl_shift = {values[0], values[1], values[2]};
+  });
+  decode(indices.side_derivative, 2, [](StrokeVertex& v, const float* values) {
+    v.non_position_attributes.side_derivative = {values[0], values[1]};
+  });
+  decode(indices.side_label, 1, [](StrokeVertex& v, const float* values) {
+    v.non_position_attributes.side_label = {values[0]};
+  });
+  decode(indices.forward_derivative, 2,
+         [](StrokeVertex& v, const float* values) {
+           v.non_position_attributes.forward_derivative = {values[0],
+                                                           values[1]};
+         });
+  decode(indices.forward_label, 1, [](StrokeVertex& v, const float* values) {
+    v.non_position_attributes.forward_label = {values[0]};
+  });
+  decode(indices.surface_uv, 2, [](StrokeVertex& v, const float* values) {
+    v.non_position_attributes.surface_uv = {values[0], values[1]};
+  });
+
+  for (const Vertex& vertex : vertices) {
+    bounds_.Add(vertex.stroke_vertex.position);
+  }
+
+  indices_.reserve(indices_.size() + 3 * mesh.TriangleCount());
+  for (uint32_t i = 0; i < mesh.TriangleCount(); ++i) {
+    for (uint32_t index : mesh.TriangleIndices(i)) {
+      indices_.push_back(static_cast<uint16_t>(first_vertex + index));
+    }
+  }
+}
+
+void StrokeMeshBatch::Clear() {
+  vertices_.clear();
+  indices_.clear();
+  bounds_.Reset();
+}
+
+absl::StatusOr<MeshDrawable::Partition> StrokeMeshBatch::Upload(
+    GrDirectContext* context) const {
+  if (IsEmpty()) {
+    return absl::FailedPreconditionError("Cannot upload an empty batch.");
+  }
+  MeshDrawable::Partition partition = {
+      .vertex_buffer = SkMeshes::MakeVertexBuffer(
+          context, vertices_.data(), vertices_.size() * sizeof(Vertex)),
+      .index_buffer = SkMeshes::MakeIndexBuffer(
+          context, indices_.data(), indices_.size() * sizeof(uint16_t)),
+      .vertex_count = static_cast<int32_t>(vertices_.size()),
+      .index_count = static_cast<int32_t>(indices_.size()),
+      .bounds = ToSkiaRect(*bounds_.AsRect()),
+  };
+  if (partition.vertex_buffer == nullptr || partition.index_buffer == nullptr) {
+    return absl::InternalError("Failed to create an `SkMesh` buffer.");
+  }
+  return partition;
+}
+
+}  // namespace ink::skia_native_internal
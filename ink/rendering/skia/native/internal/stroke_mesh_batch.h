@@ -0,0 +1,110 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef INK_RENDERING_SKIA_NATIVE_INTERNAL_STROKE_MESH_BATCH_H_
+#define INK_RENDERING_SKIA_NATIVE_INTERNAL_STROKE_MESH_BATCH_H_
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "ink/color/color.h"
+#include "ink/geometry/envelope.h"
+#include "ink/geometry/mesh.h"
+#include "ink/geometry/vec.h"
+#include "ink/rendering/skia/native/internal/mesh_drawable.h"
+#include "ink/strokes/internal/stroke_vertex.h"
+#include "include/gpu/ganesh/GrDirectContext.h"
+
+namespace ink::skia_native_internal {
+
+// The vertices and triangle indices for drawing the meshes of several strokes
+// with a single `SkMesh`, using the specification created from
+// `MeshSpecificationData::CreateForStrokeBatch()`.
+//
+// The meshes of a `Stroke` are packed, each with its own unpacking transforms,
+// and are drawn with the brush color and object-to-canvas transform of their
+// stroke as uniforms. To draw the meshes of different strokes together, each
+// appended mesh is instead unpacked on the CPU, its positions are moved by an
+// offset, and every one of its vertices is given the brush color of its
+// stroke. The offset lets strokes whose object-to-canvas transforms differ only
+// in their translation be drawn with one transform.
+class StrokeMeshBatch {
+ public:
+  // The layout of one vertex in the batch.
+  struct Vertex {
+    strokes_internal::StrokeVertex stroke_vertex;
+    // The unpremultiplied brush color in linear sRGB, like the value of the
+    // brush-color uniform.
+    Color::RgbaFloat brush_color;
+  };
+
+  // The largest number of vertices that can be referred to by `SkMesh`'s 16-bit
+  // indices.
+  static constexpr uint32_t kMaxVertexCount =
+      uint32_t{std::numeric_limits<uint16_t>::max()} + 1;
+
+  StrokeMeshBatch() = default;
+  StrokeMeshBatch(const StrokeMeshBatch&) = default;
+  StrokeMeshBatch(StrokeMeshBatch&&) = default;
+  StrokeMeshBatch& operator=(const StrokeMeshBatch&) = default;
+  StrokeMeshBatch& operator=(StrokeMeshBatch&&) = default;
+  ~StrokeMeshBatch() = default;
+
+  // Returns true if `mesh` can be appended without the batch going over
+  // `kMaxVertexCount` vertices.
+  bool CanAppend(const Mesh& mesh) const {
+    return vertices_.size() + mesh.VertexCount() <= kMaxVertexCount;
+  }
+
+  // Appends the vertices and triangles of `mesh`, with every position moved by
+  // `offset`, and every vertex given `brush_color`. Attributes that are
+  // missing from the mesh's format, which may only be the HSL color shift and
+  // surface UV, are left at their `StrokeVertex` defaults.
+  //
+  // CHECK-fails if `CanAppend(mesh)` is false, or if the mesh's format is
+  // missing any other attribute of a `StrokeVertex`. A format accepted by
+  // `MeshSpecificationData::CreateForStroke()` has all of them.
+  void Append(const Mesh& mesh, Vec offset, const Color& brush_color);
+
+  bool IsEmpty() const { return vertices_.empty(); }
+
+  // Removes all appended meshes.
+  void Clear();
+
+  absl::Span<const Vertex> Vertices() const { return vertices_; }
+  absl::Span<const uint16_t> Indices() const { return indices_; }
+
+  // Returns the bounds of the appended positions, after they were moved.
+  const Envelope& Bounds() const { return bounds_; }
+
+  // Uploads the batch to new buffers created by `context`, and returns the
+  // partition drawing it. Returns an error if the batch is empty, or if a
+  // buffer could not be created.
+  absl::StatusOr<MeshDrawable::Partition> Upload(
+      GrDirectContext* context) const;
+
+ private:
+  std::vector<Vertex> vertices_;
+  std::vector<uint16_t> indices_;
+  Envelope bounds_;
+  // Scratch space for decoding one attribute of an appended mesh at a time.
+  std::vector<float> attribute_values_;
+};
+
+}  // namespace ink::skia_native_internal
+
+#endif  // INK_RENDERING_SKIA_NATIVE_INTERNAL_STROKE_MESH_BATCH_H_
@@ -0,0 +1,104 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ink/rendering/skia/native/internal/stroke_mesh_batch_cache.h"
+
+#include <utility>
+#include <vector>
+
+#include "absl/log/absl_check.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "ink/color/color.h"
+#include "ink/color/color_space.h"
+#include "ink/rendering/skia/native/internal/mesh_drawable.h"
+#include "include/gpu/ganesh/GrDirectContext.h"
+
+namespace ink::skia_native_internal {
+
+absl::StatusOr<MeshDrawable::Partition> StrokeMeshBatchCache::GetOrUpload(
+    GrDirectContext* context, absl::Span<const Item> items) {
+  if (items.empty()) {
+    return absl::InvalidArgumentError("`items` must not be empty.");
+  }
+  UseContext(context);
+
+  auto [it, inserted] = entries_.try_emplace(KeyFor(items));
+  Entry& entry = it->second;
+  if (!inserted) {
+    ++stats_.hits;
+    entry.used = true;
+    return entry.partition;
+  }
+
+  ++stats_.misses;
+  batch_.Clear();
+  for (const Item& item : items) {
+    batch_.Append(item.mesh, item.offset, item.brush_color);
+  }
+  absl::StatusOr<MeshDrawable::Partition> partition = batch_.Upload(context);
+  if (!partition.ok()) {
+    entries_.erase(it);
+    return partition.status();
+  }
+  entry.items.assign(items.begin(), items.end());
+  entry.partition = *partition;
+  entry.used = true;
+  ++stats_.entry_count;
+  return partition;
+}
+
+void StrokeMeshBatchCache::EvictUnused() {
+  for (auto it = entries_.begin(); it != entries_.end();) {
+    if (it->second.used) {
+      it->second.used = false;
+      ++it;
+      continue;
+    }
+    ++stats_.evictions;
+    --stats_.entry_count;
+    entries_.erase(it++);
+  }
+}
+
+void StrokeMeshBatchCache::Clear() {
+  entries_.clear();
+  stats_.entry_count = 0;
+}
+
+StrokeMeshBatchCache::Key StrokeMeshBatchCache::KeyFor(
+    absl::Span<const Item> items) {
+  Key key;
+  key.reserve(items.size());
+  for (const Item& item : items) {
+    key.push_back({
+        .vertex_data = item.mesh.RawVertexData().data(),
+        .index_data = item.mesh.RawIndexData().data(),
+        .offset_x = item.offset.x,
+        .offset_y = item.offset.y,
+        .brush_color = item.brush_color.InColorSpace(ColorSpace::kSrgb)
+                           .AsFloat(Color::Format::kLinear),
+    });
+  }
+  return key;
+}
+
+void StrokeMeshBatchCache::UseContext(GrDirectContext* context) {
+  if (context == context_) return;
+  Clear();
+  context_ = context;
+}
+
+}  // namespace ink::skia_native_internal
@@ -0,0 +1,141 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef INK_RENDERING_SKIA_NATIVE_INTERNAL_STROKE_MESH_BATCH_CACHE_H_
+#define INK_RENDERING_SKIA_NATIVE_INTERNAL_STROKE_MESH_BATCH_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "ink/color/color.h"
+#include "ink/geometry/mesh.h"
+#include "ink/geometry/vec.h"
+#include "ink/rendering/skia/native/internal/mesh_drawable.h"
+#include "ink/rendering/skia/native/internal/stroke_mesh_batch.h"
+#include "include/gpu/ganesh/GrDirectContext.h"
+
+namespace ink::skia_native_internal {
+
+// A cache of the uploaded buffers of `StrokeMeshBatch`es, so that a batch of
+// strokes that is drawn again (e.g. on every frame, or while panning) is not
+// unpacked and uploaded again.
+//
+// Entries are keyed on the identity of the data of each `Mesh` in the batch
+// (see `MeshBufferCache`), together with its offset and brush color. Each
+// entry holds copies of its meshes, which keeps their data alive.
+//
+// Rather than having a byte budget, the cache only keeps the entries that were
+// used since the last call to `EvictUnused()`, which is meant to be called once
+// per frame, so it holds about as much data as is drawn in one frame.
+//
+// Buffers belong to the `GrDirectContext` that created them, so the cache is
+// cleared whenever it is used with a different context.
+class StrokeMeshBatchCache {
+ public:
+  // One mesh in a batch, with the arguments to `StrokeMeshBatch::Append()`.
+  struct Item {
+    Mesh mesh;
+    Vec offset;
+    Color brush_color;
+  };
+
+  // Counters describing the use of the cache since it was constructed.
+  struct Stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    size_t entry_count = 0;
+  };
+
+  StrokeMeshBatchCache() = default;
+  StrokeMeshBatchCache(const StrokeMeshBatchCache&) = delete;
+  StrokeMeshBatchCache(StrokeMeshBatchCache&&) = default;
+  StrokeMeshBatchCache& operator=(const StrokeMeshBatchCache&) = delete;
+  StrokeMeshBatchCache& operator=(StrokeMeshBatchCache&&) = default;
+  ~StrokeMeshBatchCache() = default;
+
+  // Returns the partition drawing the batch made by appending each of `items`
+  // in order, uploading it to new buffers created by `context` if it is not
+  // cached. Returns an error if `items` is empty, or if a buffer could not be
+  // created.
+  //
+  // CHECK-fails if the items do not fit in one batch; see
+  // `StrokeMeshBatch::CanAppend()`.
+  absl::StatusOr<MeshDrawable::Partition> GetOrUpload(
+      GrDirectContext* context, absl::Span<const Item> items);
+
+  // Removes the entries that were not returned by `GetOrUpload()` since the
+  // previous call to this function.
+  void EvictUnused();
+
+  // Removes all entries.
+  void Clear();
+
+  const Stats& GetStats() const { return stats_; }
+
+ private:
+  // The values identifying one `Item`.
+  struct ItemKey {
+    // The data pointers of the `Mesh`, which are shared by all of its copies.
+    const std::byte* vertex_data;
+    const std::byte* index_data;
+    float offset_x;
+    float offset_y;
+    Color::RgbaFloat brush_color;
+
+    friend bool operator==(const ItemKey& a, const ItemKey& b) {
+      return a.vertex_data == b.vertex_data && a.index_data == b.index_data &&
+             a.offset_x == b.offset_x && a.offset_y == b.offset_y &&
+             a.brush_color.r == b.brush_color.r &&
+             a.brush_color.g == b.brush_color.g &&
+             a.brush_color.b == b.brush_color.b &&
+             a.brush_color.a == b.brush_color.a;
+    }
+
+    template <typename H>
+    friend H AbslHashValue(H h, const ItemKey& key) {
+      return H::combine(std::move(h), key.vertex_data, key.index_data,
+                        key.offset_x, key.offset_y, key.brush_color.r,
+                        key.brush_color.g, key.brush_color.b,
+                        key.brush_color.a);
+    }
+  };
+  using Key = std::vector<ItemKey>;
+
+  struct Entry {
+    std::vector<Item> items;
+    MeshDrawable::Partition partition;
+    bool used = false;
+  };
+
+  static Key KeyFor(absl::Span<const Item> items);
+
+  // Clears the cache if it was last used with a different `context`.
+  void UseContext(GrDirectContext* context);
+
+  GrDirectContext* context_ = nullptr;
+  absl::flat_hash_map<Key, Entry> entries_;
+  // Scratch space for building batches that are not cached.
+  StrokeMeshBatch batch_;
+  Stats stats_;
+};
+
+}  // namespace ink::skia_native_internal
+
+#endif  // INK_RENDERING_SKIA_NATIVE_INTERNAL_STROKE_MESH_BATCH_CACHE_H_
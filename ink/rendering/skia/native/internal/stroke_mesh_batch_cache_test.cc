@@ -0,0 +1,192 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ink/rendering/skia/native/internal/stroke_mesh_batch_cache.h"
+
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/log/absl_check.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "ink/color/color.h"
+#include "ink/geometry/mesh.h"
+#include "ink/geometry/mesh_format.h"
+#include "ink/geometry/vec.h"
+#include "ink/rendering/skia/native/internal/mesh_drawable.h"
+#include "ink/strokes/internal/stroke_vertex.h"
+#include "include/core/SkRefCnt.h"
+#include "include/gpu/ganesh/GrDirectContext.h"
+#include "include/gpu/ganesh/mock/GrMockTypes.h"
+
+namespace ink::skia_native_internal {
+namespace {
+
+using ::ink::strokes_internal::StrokeVertex;
+
+sk_sp<GrDirectContext> MakeMockContext() {
+  GrMockOptions options;
+  sk_sp<GrDirectContext> context = GrDirectContext::MakeMock(&options);
+  ABSL_CHECK(context != nullptr);
+  return context;
+}
+
+// Returns a single-triangle mesh in the full format of a stroke, starting at
+// `x`.
+Mesh MakeStrokeTriangleMesh(float x) {
+  std::vector<std::vector<float>> values = {
+      {x, x + 10, x}, {0, 0, 10}, {0, 0, 0},  {0, 0, 0},  {0, 0, 0},
+      {0, 0, 0},      {1, 1, 1},  {0, 0, 0},  {0, 0, 0},  {0, 0, 0},
+      {1, 1, 1},      {0, 0, 0},  {0, 0, 0},  {0, 0, 0}};
+  std::vector<absl::Span<const float>> spans(values.begin(), values.end());
+  absl::StatusOr<Mesh> mesh =
+      Mesh::Create(StrokeVertex::FullMeshFormat(), spans, {0, 1, 2});
+  ABSL_CHECK_OK(mesh);
+  return *mesh;
+}
+
+TEST(StrokeMeshBatchCacheTest, DefaultConstructed) {
+  StrokeMeshBatchCache cache;
+  EXPECT_EQ(cache.GetStats().hits, 0);
+  EXPECT_EQ(cache.GetStats().misses, 0);
+  EXPECT_EQ(cache.GetStats().evictions, 0);
+  EXPECT_EQ(cache.GetStats().entry_count, 0);
+}
+
+TEST(StrokeMeshBatchCacheTest, ReusesBuffersForSameItems) {
+  sk_sp<GrDirectContext> context = MakeMockContext();
+  StrokeMeshBatchCache cache;
+  std::vector<StrokeMeshBatchCache::Item> items = {
+      {MakeStrokeTriangleMesh(0), Vec{0, 0}, Color::Red()},
+      {MakeStrokeTriangleMesh(20), Vec{5, 5}, Color::Blue()}};
+
+  absl::StatusOr<MeshDrawable::Partition> first =
+      cache.GetOrUpload(context.get(), items);
+  ASSERT_EQ(first.status(), absl::OkStatus());
+  EXPECT_EQ(first->vertex_count, 6);
+  EXPECT_EQ(first->index_count, 6);
+
+  // A copy of a mesh shares its data, so it is found in the cache.
+  std::vector<StrokeMeshBatchCache::Item> copied_items = items;
+  absl::StatusOr<MeshDrawable::Partition> second =
+      cache.GetOrUpload(context.get(), copied_items);
+  ASSERT_EQ(second.status(), absl::OkStatus());
+  EXPECT_EQ(second->vertex_buffer, first->vertex_buffer);
+  EXPECT_EQ(second->index_buffer, first->index_buffer);
+
+  EXPECT_EQ(cache.GetStats().hits, 1);
+  EXPECT_EQ(cache.GetStats().misses, 1);
+  EXPECT_EQ(cache.GetStats().entry_count, 1);
+}
+
+TEST(StrokeMeshBatchCacheTest, DifferentOffsetOrColorIsUploadedAgain) {
+  sk_sp<GrDirectContext> context = MakeMockContext();
+  StrokeMeshBatchCache cache;
+  Mesh mesh = MakeStrokeTriangleMesh(0);
+
+  std::vector<StrokeMeshBatchCache::Item> items = {
+      {mesh, Vec{0, 0}, Color::Red()}};
+  absl::StatusOr<MeshDrawable::Partition> first =
+      cache.GetOrUpload(context.get(), items);
+  ASSERT_EQ(first.status(), absl::OkStatus());
+
+  items[0].offset = Vec{1, 0};
+  absl::StatusOr<MeshDrawable::Partition> moved =
+      cache.GetOrUpload(context.get(), items);
+  ASSERT_EQ(moved.status(), absl::OkStatus());
+  EXPECT_NE(moved->vertex_buffer, first->vertex_buffer);
+
+  items[0].brush_color = Color::Green();
+  absl::StatusOr<MeshDrawable::Partition> recolored =
+      cache.GetOrUpload(context.get(), items);
+  ASSERT_EQ(recolored.status(), absl::OkStatus());
+  EXPECT_NE(recolored->vertex_buffer, moved->vertex_buffer);
+
+  EXPECT_EQ(cache.GetStats().hits, 0);
+  EXPECT_EQ(cache.GetStats().misses, 3);
+  EXPECT_EQ(cache.GetStats().entry_count, 3);
+}
+
+TEST(StrokeMeshBatchCacheTest, EvictUnusedKeepsEntriesUsedSinceLastCall) {
+  sk_sp<GrDirectContext> context = MakeMockContext();
+  StrokeMeshBatchCache cache;
+  std::vector<StrokeMeshBatchCache::Item> kept = {
+      {MakeStrokeTriangleMesh(0), Vec{0, 0}, Color::Red()}};
+  std::vector<StrokeMeshBatchCache::Item> evicted = {
+      {MakeStrokeTriangleMesh(20), Vec{0, 0}, Color::Red()}};
+
+  ASSERT_EQ(cache.GetOrUpload(context.get(), kept).status(), absl::OkStatus());
+  ASSERT_EQ(cache.GetOrUpload(context.get(), evicted).status(),
+            absl::OkStatus());
+  // Both entries were used since they were added.
+  cache.EvictUnused();
+  EXPECT_EQ(cache.GetStats().entry_count, 2);
+  EXPECT_EQ(cache.GetStats().evictions, 0);
+
+  ASSERT_EQ(cache.GetOrUpload(context.get(), kept).status(), absl::OkStatus());
+  cache.EvictUnused();
+  EXPECT_EQ(cache.GetStats().entry_count, 1);
+  EXPECT_EQ(cache.GetStats().evictions, 1);
+
+  ASSERT_EQ(cache.GetOrUpload(context.get(), kept).status(), absl::OkStatus());
+  ASSERT_EQ(cache.GetOrUpload(context.get(), evicted).status(),
+            absl::OkStatus());
+  EXPECT_EQ(cache.GetStats().hits, 2);
+  EXPECT_EQ(cache.GetStats().misses, 3);
+}
+
+TEST(StrokeMeshBatchCacheTest, Clear) {
+  sk_sp<GrDirectContext> context = MakeMockContext();
+  StrokeMeshBatchCache cache;
+  std::vector<StrokeMeshBatchCache::Item> items = {
+      {MakeStrokeTriangleMesh(0), Vec{0, 0}, Color::Red()}};
+  ASSERT_EQ(cache.GetOrUpload(context.get(), items).status(),
+            absl::OkStatus());
+
+  cache.Clear();
+  EXPECT_EQ(cache.GetStats().entry_count, 0);
+  EXPECT_EQ(cache.GetStats().evictions, 0);
+
+  ASSERT_EQ(cache.GetOrUpload(context.get(), items).status(),
+            absl::OkStatus());
+  EXPECT_EQ(cache.GetStats().misses, 2);
+}
+
+TEST(StrokeMeshBatchCacheTest, DifferentContextClearsCache) {
+  sk_sp<GrDirectContext> context = MakeMockContext();
+  sk_sp<GrDirectContext> other_context = MakeMockContext();
+  StrokeMeshBatchCache cache;
+  std::vector<StrokeMeshBatchCache::Item> items = {
+      {MakeStrokeTriangleMesh(0), Vec{0, 0}, Color::Red()}};
+
+  ASSERT_EQ(cache.GetOrUpload(context.get(), items).status(),
+            absl::OkStatus());
+  ASSERT_EQ(cache.GetOrUpload(other_context.get(), items).status(),
+            absl::OkStatus());
+  EXPECT_EQ(cache.GetStats().hits, 0);
+  EXPECT_EQ(cache.GetStats().misses, 2);
+  EXPECT_EQ(cache.GetStats().entry_count, 1);
+}
+
+TEST(StrokeMeshBatchCacheTest, EmptyItemsIsAnError) {
+  sk_sp<GrDirectContext> context = MakeMockContext();
+  StrokeMeshBatchCache cache;
+  EXPECT_EQ(cache.GetOrUpload(context.get(), {}).status().code(),
+            absl::StatusCode::kInvalidArgument);
+}
+
+}  // namespace
+}  // namespace ink::skia_native_internal
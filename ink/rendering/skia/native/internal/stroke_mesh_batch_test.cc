@@ -0,0 +1,278 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ink/rendering/skia/native/internal/stroke_mesh_batch.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/log/absl_check.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "ink/color/color.h"
+#include "ink/color/color_space.h"
+#include "ink/geometry/mesh.h"
+#include "ink/geometry/mesh_format.h"
+#include "ink/geometry/point.h"
+#include "ink/geometry/rect.h"
+#include "ink/geometry/type_matchers.h"
+#include "ink/geometry/vec.h"
+#include "ink/rendering/skia/native/internal/mesh_drawable.h"
+#include "ink/strokes/internal/stroke_vertex.h"
+#include "include/core/SkRect.h"
+#include "include/core/SkRefCnt.h"
+#include "include/gpu/ganesh/GrDirectContext.h"
+#include "include/gpu/ganesh/mock/GrMockTypes.h"
+
+namespace ink::skia_native_internal {
+namespace {
+
+using ::ink::strokes_internal::StrokeVertex;
+using ::testing::ElementsAre;
+using ::testing::ElementsAreArray;
+using ::testing::FloatEq;
+using ::testing::IsEmpty;
+
+sk_sp<GrDirectContext> MakeMockContext() {
+  GrMockOptions options;
+  sk_sp<GrDirectContext> context = GrDirectContext::MakeMock(&options);
+  ABSL_CHECK(context != nullptr);
+  return context;
+}
+
+// Returns the format of a stroke mesh without HSL color shift and surface UV,
+// using unpacked attributes so that the values in tests are exact.
+MeshFormat MakeStrokeFormat() {
+  absl::StatusOr<MeshFormat> format = MeshFormat::Create(
+      {{MeshFormat::AttributeType::kFloat2Unpacked,
+        MeshFormat::AttributeId::kPosition},
+       {MeshFormat::AttributeType::kFloat1Unpacked,
+        MeshFormat::AttributeId::kOpacityShift},
+       {MeshFormat::AttributeType::kFloat2Unpacked,
+        MeshFormat::AttributeId::kSideDerivative},
+       {MeshFormat::AttributeType::kFloat1Unpacked,
+        MeshFormat::AttributeId::kSideLabel},
+       {MeshFormat::AttributeType::kFloat2Unpacked,
+        MeshFormat::AttributeId::kForwardDerivative},
+       {MeshFormat::AttributeType::kFloat1Unpacked,
+        MeshFormat::AttributeId::kForwardLabel}},
+      MeshFormat::IndexFormat::k32BitUnpacked16BitPacked);
+  ABSL_CHECK_OK(format);
+  return *format;
+}
+
+// Returns a mesh in `MakeStrokeFormat()` with a single triangle, in which every
+// attribute value of the vertex at index `i` is `i` plus a different multiple
+// of 10, starting at `x`.
+Mesh MakeStrokeTriangleMesh(float x) {
+  std::vector<std::vector<float>> values;
+  for (int component = 0; component < 9; ++component) {
+    float base = x + 10 * component;
+    values.push_back({base, base + 1, base + 2});
+  }
+  std::vector<absl::Span<const float>> spans(values.begin(), values.end());
+  absl::StatusOr<Mesh> mesh =
+      Mesh::Create(MakeStrokeFormat(), spans, {0, 1, 2});
+  ABSL_CHECK_OK(mesh);
+  return *mesh;
+}
+
+Color::RgbaFloat LinearSrgb(const Color& color) {
+  return color.InColorSpace(ColorSpace::kSrgb).AsFloat(Color::Format::kLinear);
+}
+
+TEST(StrokeMeshBatchTest, VertexLayoutMatchesFullMeshFormat) {
+  EXPECT_EQ(sizeof(StrokeVertex),
+            StrokeVertex::FullMeshFormat().UnpackedVertexStride());
+}
+
+TEST(StrokeMeshBatchTest, DefaultConstructed) {
+  StrokeMeshBatch batch;
+  EXPECT_TRUE(batch.IsEmpty());
+  EXPECT_THAT(batch.Vertices(), IsEmpty());
+  EXPECT_THAT(batch.Indices(), IsEmpty());
+  EXPECT_TRUE(batch.Bounds().IsEmpty());
+}
+
+TEST(StrokeMeshBatchTest, AppendUnpacksVerticesWithOffsetAndColor) {
+  Mesh mesh = MakeStrokeTriangleMesh(0);
+  StrokeMeshBatch batch;
+  batch.Append(mesh, Vec{1000, 2000}, Color::Red());
+
+  ASSERT_EQ(batch.Vertices().size(), 3);
+  for (uint32_t i = 0; i < 3; ++i) {
+    SCOPED_TRACE(i);
+    const StrokeMeshBatch::Vertex& vertex = batch.Vertices()[i];
+    const StrokeVertex::NonPositionAttributes& attributes =
+        vertex.stroke_vertex.non_position_attributes;
+    EXPECT_THAT(vertex.stroke_vertex.position,
+                PointEq({1000.f + i, 2010.f + i}));
+    EXPECT_FLOAT_EQ(attributes.opacity_shift, 20 + i);
+    EXPECT_THAT(attributes.side_derivative, VecEq({30.f + i, 40.f + i}));
+    EXPECT_FLOAT_EQ(attributes.side_label.encoded_value, 50 + i);
+    EXPECT_THAT(attributes.forward_derivative, VecEq({60.f + i, 70.f + i}));
+    EXPECT_FLOAT_EQ(attributes.forward_label.encoded_value, 80 + i);
+    // The attributes that are missing from the format have default values.
+    EXPECT_THAT(attributes.hsl_shift, ElementsAre(0, 0, 0));
+    EXPECT_THAT(attributes.surface_uv, PointEq({0, 0}));
+
+    Color::RgbaFloat expected_color = LinearSrgb(Color::Red());
+    EXPECT_THAT(vertex.brush_color.r, FloatEq(expected_color.r));
+    EXPECT_THAT(vertex.brush_color.g, FloatEq(expected_color.g));
+    EXPECT_THAT(vertex.brush_color.b, FloatEq(expected_color.b));
+    EXPECT_THAT(vertex.brush_color.a, FloatEq(expected_color.a));
+  }
+  EXPECT_THAT(batch.Indices(), ElementsAre(0, 1, 2));
+  EXPECT_THAT(*batch.Bounds().AsRect(),
+              RectEq(Rect::FromTwoPoints({1000, 2010}, {1002, 2012})));
+}
+
+TEST(StrokeMeshBatchTest, AppendOffsetsIndicesOfLaterMeshes) {
+  StrokeMeshBatch batch;
+  batch.Append(MakeStrokeTriangleMesh(0), Vec{0, 0}, Color::Red());
+  batch.Append(MakeStrokeTriangleMesh(100), Vec{0, 0}, Color::Blue());
+
+  ASSERT_EQ(batch.Vertices().size(), 6);
+  EXPECT_THAT(batch.Indices(), ElementsAre(0, 1, 2, 3, 4, 5));
+  EXPECT_THAT(batch.Vertices()[3].stroke_vertex.position,
+              PointEq({100, 110}));
+  EXPECT_THAT(batch.Vertices()[3].brush_color.b,
+              FloatEq(LinearSrgb(Color::Blue()).b));
+  EXPECT_THAT(*batch.Bounds().AsRect(),
+              RectEq(Rect::FromTwoPoints({0, 10}, {102, 112})));
+}
+
+TEST(StrokeMeshBatchTest, AppendDecodesPackedStrokeMesh) {
+  std::vector<std::vector<float>> values(12);
+  for (uint32_t i = 0; i < 3; ++i) {
+    std::vector<float> vertex = {
+        // position, opacity shift
+        10.f * i, 5.f * i, 0.25,
+        // HSL shift
+        -0.5, 0, 0.5,
+        // side derivative and label
+        1, 2, StrokeVertex::kExteriorLeftLabel.encoded_value,
+        // forward derivative and label
+        -2, 1, StrokeVertex::kInteriorLabel.encoded_value};
+    for (int component = 0; component < 12; ++component) {
+      values[component].push_back(vertex[component]);
+    }
+  }
+  // Surface UV
+  values.push_back({0, 0.5, 1});
+  values.push_back({0, 1, 0});
+  std::vector<absl::Span<const float>> spans(values.begin(), values.end());
+  StrokeVertex::CustomPackingArray packing_params =
+      StrokeVertex::MakeCustomPackingArray(StrokeVertex::FullMeshFormat());
+  absl::StatusOr<Mesh> mesh =
+      Mesh::Create(StrokeVertex::FullMeshFormat(), spans, {0, 1, 2},
+                   packing_params.Values());
+  ASSERT_EQ(mesh.status(), absl::OkStatus());
+  StrokeVertex::FormatAttributeIndices indices =
+      StrokeVertex::FindAttributeIndices(mesh->Format());
+
+  StrokeMeshBatch batch;
+  batch.Append(*mesh, Vec{0, 0}, Color::Black());
+
+  // Each vertex holds the values unpacked from the mesh.
+  ASSERT_EQ(batch.Vertices().size(), 3);
+  for (uint32_t i = 0; i < 3; ++i) {
+    SCOPED_TRACE(i);
+    const StrokeVertex& vertex = batch.Vertices()[i].stroke_vertex;
+    const StrokeVertex::NonPositionAttributes& attributes =
+        vertex.non_position_attributes;
+    EXPECT_THAT(vertex.position, PointEq(mesh->VertexPosition(i)));
+    EXPECT_EQ(attributes.opacity_shift,
+              mesh->FloatVertexAttribute(i, indices.opacity_shift)[0]);
+    EXPECT_THAT(attributes.hsl_shift,
+                ElementsAreArray(
+                    mesh->FloatVertexAttribute(i, indices.hsl_shift).Values()));
+    EXPECT_EQ(attributes.side_label.encoded_value,
+              StrokeVertex::kExteriorLeftLabel.encoded_value);
+    EXPECT_EQ(attributes.forward_label.encoded_value,
+              StrokeVertex::kInteriorLabel.encoded_value);
+    EXPECT_THAT(
+        attributes.side_derivative,
+        VecEq({mesh->FloatVertexAttribute(i, indices.side_derivative)[0],
+               mesh->FloatVertexAttribute(i, indices.side_derivative)[1]}));
+    EXPECT_THAT(
+        attributes.surface_uv,
+        PointEq({mesh->FloatVertexAttribute(i, indices.surface_uv)[0],
+                 mesh->FloatVertexAttribute(i, indices.surface_uv)[1]}));
+  }
+}
+
+TEST(StrokeMeshBatchTest, CanAppend) {
+  // A position-only mesh with the largest number of vertices that a batch can
+  // hold.
+  std::vector<float> x(StrokeMeshBatch::kMaxVertexCount, 0);
+  std::vector<float> y(StrokeMeshBatch::kMaxVertexCount, 0);
+  absl::StatusOr<Mesh> large_mesh =
+      Mesh::Create(MeshFormat(), {x, y}, {0, 1, 2});
+  ASSERT_EQ(large_mesh.status(), absl::OkStatus());
+  Mesh small_mesh = MakeStrokeTriangleMesh(0);
+
+  StrokeMeshBatch batch;
+  EXPECT_TRUE(batch.CanAppend(*large_mesh));
+  batch.Append(small_mesh, Vec{0, 0}, Color::Black());
+  EXPECT_FALSE(batch.CanAppend(*large_mesh));
+  EXPECT_TRUE(batch.CanAppend(small_mesh));
+
+  batch.Clear();
+  EXPECT_TRUE(batch.IsEmpty());
+  EXPECT_TRUE(batch.Bounds().IsEmpty());
+  EXPECT_TRUE(batch.CanAppend(*large_mesh));
+}
+
+TEST(StrokeMeshBatchTest, Upload) {
+  sk_sp<GrDirectContext> context = MakeMockContext();
+  StrokeMeshBatch batch;
+  batch.Append(MakeStrokeTriangleMesh(0), Vec{5, 0}, Color::Black());
+  batch.Append(MakeStrokeTriangleMesh(100), Vec{5, 0}, Color::Black());
+
+  absl::StatusOr<MeshDrawable::Partition> partition =
+      batch.Upload(context.get());
+  ASSERT_EQ(partition.status(), absl::OkStatus());
+  ASSERT_NE(partition->vertex_buffer, nullptr);
+  ASSERT_NE(partition->index_buffer, nullptr);
+  EXPECT_EQ(partition->vertex_buffer->size(),
+            6 * sizeof(StrokeMeshBatch::Vertex));
+  EXPECT_EQ(partition->index_buffer->size(), 6 * sizeof(uint16_t));
+  EXPECT_EQ(partition->vertex_count, 6);
+  EXPECT_EQ(partition->index_count, 6);
+  EXPECT_EQ(partition->bounds, SkRect::MakeLTRB(5, 10, 107, 112));
+  EXPECT_EQ(partition->vertex_offset, 0);
+  EXPECT_EQ(partition->index_offset, 0);
+}
+
+TEST(StrokeMeshBatchTest, UploadEmptyBatch) {
+  sk_sp<GrDirectContext> context = MakeMockContext();
+  EXPECT_EQ(StrokeMeshBatch().Upload(context.get()).status().code(),
+            absl::StatusCode::kFailedPrecondition);
+}
+
+TEST(StrokeMeshBatchDeathTest, AppendMeshWithoutStrokeAttributes) {
+  absl::StatusOr<Mesh> mesh =
+      Mesh::Create(MeshFormat(), {{0, 10, 0}, {0, 0, 10}}, {0, 1, 2});
+  ASSERT_EQ(mesh.status(), absl::OkStatus());
+  StrokeMeshBatch batch;
+  EXPECT_DEATH_IF_SUPPORTED(batch.Append(*mesh, Vec{0, 0}, Color::Black()),
+                            "Unsupported `MeshFormat`");
+}
+
+}  // namespace
+}  // namespace ink::skia_native_internal
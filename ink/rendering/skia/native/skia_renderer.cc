@@ -14,9 +14,10 @@
 
 #include "ink/rendering/skia/native/skia_renderer.h"
 
+#include <algorithm>
+#include <cmath>
 #include <cstddef>
 #include <cstdint>
-#include <limits>
 #include <memory>
 #include <optional>
 #include <utility>
@@ -37,45 +38,40 @@
 #include "ink/geometry/affine_transform.h"
 #include "ink/geometry/mesh.h"
 #include "ink/geometry/mesh_packing_types.h"
-#include "ink/geometry/mutable_mesh.h"
 #include "ink/geometry/partitioned_mesh.h"
-#include "ink/geometry/rect.h"
+#include "ink/geometry/point.h"
+#include "ink/geometry/vec.h"
+#include "ink/rendering/skia/native/internal/frozen_stroke_prefix.h"
+#include "ink/rendering/skia/native/internal/in_progress_stroke_render_cache.h"
+#include "ink/rendering/skia/native/internal/mesh_buffer_cache.h"
 #include "ink/rendering/skia/native/internal/mesh_drawable.h"
 #include "ink/rendering/skia/native/internal/mesh_uniform_data.h"
 #include "ink/rendering/skia/native/internal/path_drawable.h"
+#include "ink/rendering/skia/native/internal/stroke_mesh_batch.h"
+#include "ink/rendering/skia/native/internal/stroke_mesh_batch_cache.h"
 #include "ink/rendering/texture_bitmap_store.h"
 #include "ink/strokes/in_progress_stroke.h"
 #include "ink/strokes/stroke.h"
+#include "include/core/SkBlender.h"
 #include "include/core/SkCanvas.h"
 #include "include/core/SkM44.h"
 #include "include/core/SkMesh.h"
 #include "include/core/SkPaint.h"
-#include "include/core/SkRect.h"
 #include "include/core/SkRefCnt.h"
+#include "include/core/SkShader.h"
 #include "include/gpu/ganesh/GrDirectContext.h"
-#include "include/gpu/ganesh/SkMeshGanesh.h"
 
 namespace ink {
 namespace {
 
+using ::ink::skia_native_internal::FrozenStrokePrefix;
+using ::ink::skia_native_internal::InProgressStrokeRenderCache;
+using ::ink::skia_native_internal::MeshBufferCache;
 using ::ink::skia_native_internal::MeshDrawable;
 using ::ink::skia_native_internal::MeshUniformData;
 using ::ink::skia_native_internal::PathDrawable;
-
-void FillTemporaryIndices(const MutableMesh& mesh,
-                          std::vector<uint16_t>& temporary_indices) {
-  temporary_indices.clear();
-  temporary_indices.reserve(3 * mesh.TriangleCount());
-  for (uint32_t i = 0; i < mesh.TriangleCount(); ++i) {
-    for (uint32_t index : mesh.TriangleIndices(i)) {
-      temporary_indices.push_back(index);
-    }
-  }
-}
-
-SkRect ToSkiaRect(const Rect& rect) {
-  return SkRect::MakeLTRB(rect.XMin(), rect.YMin(), rect.XMax(), rect.YMax());
-}
+using ::ink::skia_native_internal::StrokeMeshBatch;
+using ::ink::skia_native_internal::StrokeMeshBatchCache;
 
 // Returns true if the renderer should use `SkPath` instead of `SkMesh` for
 // rendering.
@@ -96,6 +92,20 @@ float OpacityMultiplierForPath(const Brush& brush, uint32_t coat_index) {
   return brush.GetCoats()[coat_index].tips.front().opacity_multiplier;
 }
 
+// Returns the largest factor by which `transform` scales distances, which is
+// the largest singular value of its linear part.
+float MaxScaleFactor(const AffineTransform& transform) {
+  float a = transform.A();
+  float b = transform.B();
+  float d = transform.D();
+  float e = transform.E();
+  float sum_of_squares = a * a + b * b + d * d + e * e;
+  float determinant = a * e - b * d;
+  float discriminant = std::max(
+      0.f, sum_of_squares * sum_of_squares - 4 * determinant * determinant);
+  return std::sqrt((sum_of_squares + std::sqrt(discriminant)) / 2);
+}
+
 // Returns the `TextureMapping` used by the given `BrushPaint`. Right now, we
 // don't support rendering a `BrushPaint` that mixes different `TextureMapping`
 // modes, so this just returns the `TextureMapping` of the first texture layer,
@@ -118,9 +128,28 @@ SkiaRenderer::SkiaRenderer(
     : texture_provider_(std::move(texture_provider)),
       shader_cache_(texture_provider_.get()) {}
 
+void SkiaRenderer::SetBufferCacheByteBudget(size_t byte_budget) {
+  mesh_buffer_cache_.SetByteBudget(byte_budget);
+}
+
+const MeshBufferCache::Stats& SkiaRenderer::GetBufferCacheStats() const {
+  return mesh_buffer_cache_.GetStats();
+}
+
 absl::StatusOr<SkiaRenderer::Drawable> SkiaRenderer::CreateDrawable(
     GrDirectContext* context, const InProgressStroke& stroke,
     const AffineTransform& object_to_canvas) {
+  // A new cache holds buffers that are not shared with any other drawable.
+  // It is only updated once, so its buffers don't need room to grow.
+  InProgressStrokeRenderCache render_cache(
+      InProgressStrokeRenderCache::BufferSizing::kExact);
+  return CreateDrawable(context, stroke, object_to_canvas, render_cache);
+}
+
+absl::StatusOr<SkiaRenderer::Drawable> SkiaRenderer::CreateDrawable(
+    GrDirectContext* context, const InProgressStroke& stroke,
+    const AffineTransform& object_to_canvas,
+    InProgressStrokeRenderCache& render_cache) {
   const Brush* brush = stroke.GetBrush();
   if (brush == nullptr) {
     return Drawable(object_to_canvas, {});
@@ -139,51 +168,48 @@ absl::StatusOr<SkiaRenderer::Drawable> SkiaRenderer::CreateDrawable(
       continue;
     }
 
-    const BrushPaint& brush_paint = brush->GetCoats()[coat_index].paint;
-    absl::StatusOr<sk_sp<SkShader>> shader = shader_cache_.GetShaderForPaint(
-        brush_paint, brush->GetSize(), stroke.GetInputs());
-    if (!shader.ok()) return shader.status();
-
-    absl::StatusOr<sk_sp<SkMeshSpecification>> specification =
-        specification_cache_.GetFor(stroke);
-    if (!specification.ok()) return specification.status();
-
-    const MutableMesh& mesh = stroke.GetMesh(coat_index);
-    if (mesh.VertexCount() >= std::numeric_limits<uint16_t>::max()) {
-      return absl::UnimplementedError(
-          "Strokes requiring at least 2^16 indices are not supported yet.");
-    }
+    absl::StatusOr<absl::InlinedVector<MeshDrawable::Partition, 1>> partitions =
+        render_cache.Update(context, stroke, coat_index);
+    if (!partitions.ok()) return partitions.status();
 
-    absl::Span<const std::byte> vertex_data = mesh.RawVertexData();
-    FillTemporaryIndices(mesh, temporary_indices_);
-
-    absl::StatusOr<MeshDrawable> mesh_drawable = MeshDrawable::Create(
-        *std::move(specification),
-        shader_cache_.GetBlenderForPaint(brush_paint), *std::move(shader),
-        {{
-            .vertex_buffer = SkMeshes::MakeVertexBuffer(
-                context, vertex_data.data(), vertex_data.size()),
-            .index_buffer = SkMeshes::MakeIndexBuffer(
-                context, temporary_indices_.data(),
-                temporary_indices_.size() * sizeof(uint16_t)),
-            .vertex_count = static_cast<int32_t>(mesh.VertexCount()),
-            .index_count = static_cast<int32_t>(3 * mesh.TriangleCount()),
-            .bounds = ToSkiaRect(*stroke.GetMeshBounds(coat_index).AsRect()),
-        }});
+    absl::StatusOr<MeshDrawable> mesh_drawable =
+        CreateMeshDrawable(stroke, coat_index, *std::move(partitions));
     if (!mesh_drawable.ok()) return mesh_drawable.status();
-
-    mesh_drawable->SetBrushColor(brush->GetColor());
-    mesh_drawable->SetTextureMapping(GetBrushPaintTextureMapping(brush_paint));
     drawables.push_back(*std::move(mesh_drawable));
   }
 
   return Drawable(object_to_canvas, std::move(drawables));
 }
 
+absl::StatusOr<MeshDrawable> SkiaRenderer::CreateMeshDrawable(
+    const InProgressStroke& stroke, uint32_t coat_index,
+    absl::InlinedVector<MeshDrawable::Partition, 1> partitions) {
+  const Brush* brush = stroke.GetBrush();
+  ABSL_DCHECK_NE(brush, nullptr);
+  const BrushPaint& brush_paint = brush->GetCoats()[coat_index].paint;
+  absl::StatusOr<sk_sp<SkShader>> shader = shader_cache_.GetShaderForPaint(
+      brush_paint, brush->GetSize(), stroke.GetInputs());
+  if (!shader.ok()) return shader.status();
+
+  absl::StatusOr<sk_sp<SkMeshSpecification>> specification =
+      specification_cache_.GetFor(stroke);
+  if (!specification.ok()) return specification.status();
+
+  absl::StatusOr<MeshDrawable> mesh_drawable = MeshDrawable::Create(
+      *std::move(specification), shader_cache_.GetBlenderForPaint(brush_paint),
+      *std::move(shader), std::move(partitions));
+  if (!mesh_drawable.ok()) return mesh_drawable.status();
+
+  mesh_drawable->SetBrushColor(brush->GetColor());
+  mesh_drawable->SetTextureMapping(GetBrushPaintTextureMapping(brush_paint));
+  return mesh_drawable;
+}
+
 absl::StatusOr<SkiaRenderer::Drawable> SkiaRenderer::CreateDrawable(
     GrDirectContext* context, const Stroke& stroke,
     const AffineTransform& object_to_canvas) {
-  const PartitionedMesh& stroke_shape = stroke.GetShape();
+  const PartitionedMesh& stroke_shape =
+      stroke.GetShapeForScale(MaxScaleFactor(object_to_canvas));
   if (stroke_shape.RenderGroupCount() == 0) {
     return Drawable(object_to_canvas, {});
   }
@@ -206,11 +232,6 @@ absl::StatusOr<SkiaRenderer::Drawable> SkiaRenderer::CreateDrawable(
       continue;
     }
 
-    const BrushPaint& brush_paint = brush.GetCoats()[coat_index].paint;
-    absl::StatusOr<sk_sp<SkShader>> shader = shader_cache_.GetShaderForPaint(
-        brush_paint, brush.GetSize(), stroke.GetInputs());
-    if (!shader.ok()) return shader.status();
-
     // TODO: b/284117747 - Pass `brush.GetCoats()[coat_index].paint` to the
     // `specification_cache_`.
     absl::StatusOr<sk_sp<SkMeshSpecification>> specification =
@@ -220,67 +241,299 @@ absl::StatusOr<SkiaRenderer::Drawable> SkiaRenderer::CreateDrawable(
     absl::InlinedVector<MeshDrawable::Partition, 1> partitions;
     partitions.reserve(meshes.size());
     for (const Mesh& mesh : meshes) {
-      absl::Span<const std::byte> vertex_data = mesh.RawVertexData();
-      absl::Span<const std::byte> index_data = mesh.RawIndexData();
-      partitions.push_back({
-          .vertex_buffer = SkMeshes::MakeVertexBuffer(
-              context, vertex_data.data(), vertex_data.size()),
-          .index_buffer = SkMeshes::MakeIndexBuffer(context, index_data.data(),
-                                                    index_data.size()),
-          .vertex_count = static_cast<int32_t>(mesh.VertexCount()),
-          .index_count = static_cast<int32_t>(3 * mesh.TriangleCount()),
-          .bounds = ToSkiaRect(*mesh.Bounds().AsRect()),
-      });
+      absl::StatusOr<MeshBufferCache::Partitions> mesh_partitions =
+          mesh_buffer_cache_.GetOrCreate(context, mesh);
+      if (!mesh_partitions.ok()) return mesh_partitions.status();
+      partitions.insert(partitions.end(), mesh_partitions->begin(),
+                        mesh_partitions->end());
     }
 
-    const Mesh& first_mesh = meshes.front();
-    auto get_attribute_unpacking_transform =
-        [&first_mesh](int attribute_index) -> const MeshAttributeCodingParams& {
-      return first_mesh.VertexAttributeUnpackingParams(attribute_index);
-    };
-
-    MeshUniformData uniform_data(**specification,
-                                 first_mesh.Format().Attributes(),
-                                 get_attribute_unpacking_transform);
-    absl::StatusOr<MeshDrawable> mesh_drawable = MeshDrawable::Create(
-        *std::move(specification),
-        shader_cache_.GetBlenderForPaint(brush_paint), *std::move(shader),
-        std::move(partitions), std::move(uniform_data));
+    absl::StatusOr<MeshDrawable> mesh_drawable =
+        CreateMeshDrawable(stroke, stroke_shape, coat_index,
+                           *std::move(specification), std::move(partitions));
     if (!mesh_drawable.ok()) return mesh_drawable.status();
-
-    mesh_drawable->SetBrushColor(brush.GetColor());
-    mesh_drawable->SetTextureMapping(GetBrushPaintTextureMapping(brush_paint));
     drawables.push_back(*std::move(mesh_drawable));
   }
 
   return Drawable(object_to_canvas, std::move(drawables));
 }
 
+absl::StatusOr<MeshDrawable> SkiaRenderer::CreateMeshDrawable(
+    const Stroke& stroke, const PartitionedMesh& shape, uint32_t coat_index,
+    sk_sp<SkMeshSpecification> specification,
+    absl::InlinedVector<MeshDrawable::Partition, 1> partitions) {
+  const Brush& brush = stroke.GetBrush();
+  const BrushPaint& brush_paint = brush.GetCoats()[coat_index].paint;
+  absl::StatusOr<sk_sp<SkShader>> shader = shader_cache_.GetShaderForPaint(
+      brush_paint, brush.GetSize(), stroke.GetInputs());
+  if (!shader.ok()) return shader.status();
+
+  const Mesh& first_mesh = shape.RenderGroupMeshes(coat_index).front();
+  auto get_attribute_unpacking_transform =
+      [&first_mesh](int attribute_index) -> const MeshAttributeCodingParams& {
+    return first_mesh.VertexAttributeUnpackingParams(attribute_index);
+  };
+
+  MeshUniformData uniform_data(*specification,
+                               first_mesh.Format().Attributes(),
+                               get_attribute_unpacking_transform);
+  absl::StatusOr<MeshDrawable> mesh_drawable = MeshDrawable::Create(
+      std::move(specification), shader_cache_.GetBlenderForPaint(brush_paint),
+      *std::move(shader), std::move(partitions), std::move(uniform_data));
+  if (!mesh_drawable.ok()) return mesh_drawable.status();
+
+  mesh_drawable->SetBrushColor(brush.GetColor());
+  mesh_drawable->SetTextureMapping(GetBrushPaintTextureMapping(brush_paint));
+  return mesh_drawable;
+}
+
 absl::Status SkiaRenderer::Draw(GrDirectContext* context,
                                 const InProgressStroke& stroke,
                                 const AffineTransform& object_to_canvas,
                                 SkCanvas& canvas) {
-  // TODO: b/286547863 - Implement `RenderCache` to save and update the created
-  // drawable inside the stroke.
+  if (context == nullptr) {
+    auto drawable = CreateDrawable(context, stroke, object_to_canvas);
+    if (!drawable.ok()) return drawable.status();
+    drawable->Draw(canvas);
+    return absl::OkStatus();
+  }
 
-  auto drawable = CreateDrawable(context, stroke, object_to_canvas);
+  InProgressStrokeCacheEntry& entry = GetCacheEntry(stroke);
+  const Brush* brush = stroke.GetBrush();
+  if (brush != nullptr && brush->CoatCount() == 1 &&
+      !UsePathRendering(context, brush->GetCoats()[0].paint) &&
+      stroke.GetMesh(0).TriangleCount() >= kMinFrozenPrefixTriangleCount) {
+    return DrawWithFrozenPrefix(context, stroke, object_to_canvas, entry,
+                                canvas);
+  }
+  entry.frozen_prefix.Reset();
+
+  // The drawable is only used for this draw, so it can share the buffers of the
+  // render cache, which will be updated in place by the next call.
+  auto drawable =
+      CreateDrawable(context, stroke, object_to_canvas, entry.cache);
   if (!drawable.ok()) return drawable.status();
   drawable->Draw(canvas);
   return absl::OkStatus();
 }
 
+absl::Status SkiaRenderer::DrawWithFrozenPrefix(
+    GrDirectContext* context, const InProgressStroke& stroke,
+    const AffineTransform& object_to_canvas, InProgressStrokeCacheEntry& entry,
+    SkCanvas& canvas) {
+  // Bring the buffers up to date; the partitions drawing them are selected
+  // separately for the newly frozen triangles and for the tail of the mesh.
+  if (absl::Status status = entry.cache.Update(context, stroke, 0).status();
+      !status.ok()) {
+    return status;
+  }
+
+  auto draw_triangles = [&](SkCanvas& target_canvas,
+                            const AffineTransform& object_to_target,
+                            uint32_t first_triangle,
+                            uint32_t triangle_end) -> absl::Status {
+    absl::StatusOr<MeshDrawable> mesh_drawable = CreateMeshDrawable(
+        stroke, 0,
+        entry.cache.SelectTriangles(0, first_triangle, triangle_end));
+    if (!mesh_drawable.ok()) return mesh_drawable.status();
+    Drawable(object_to_target, {*std::move(mesh_drawable)}).Draw(target_canvas);
+    return absl::OkStatus();
+  };
+  absl::StatusOr<uint32_t> frozen_triangle_count = entry.frozen_prefix.Update(
+      stroke, object_to_canvas, canvas, draw_triangles);
+  if (!frozen_triangle_count.ok()) return frozen_triangle_count.status();
+
+  entry.frozen_prefix.Draw(canvas);
+  uint32_t triangle_count = stroke.GetMesh(0).TriangleCount();
+  if (*frozen_triangle_count == triangle_count) {
+    // Like a non-empty draw, leave the canvas with the stroke's transform.
+    Drawable(object_to_canvas, {}).Draw(canvas);
+    return absl::OkStatus();
+  }
+  return draw_triangles(canvas, object_to_canvas, *frozen_triangle_count,
+                        triangle_count);
+}
+
+SkiaRenderer::InProgressStrokeCacheEntry& SkiaRenderer::GetCacheEntry(
+    const InProgressStroke& stroke) {
+  auto it = std::find_if(in_progress_stroke_caches_.begin(),
+                         in_progress_stroke_caches_.end(),
+                         [&stroke](const InProgressStrokeCacheEntry& entry) {
+                           return entry.stroke == &stroke;
+                         });
+  if (it == in_progress_stroke_caches_.end()) {
+    if (in_progress_stroke_caches_.size() < kMaxCachedInProgressStrokes) {
+      in_progress_stroke_caches_.push_back({});
+    }
+    // Reuse the least recently used entry, which is now the last one.
+    it = in_progress_stroke_caches_.end() - 1;
+    it->stroke = &stroke;
+    it->frozen_prefix.Reset();
+  }
+  // Move the entry to the front.
+  std::rotate(in_progress_stroke_caches_.begin(), it, it + 1);
+  return in_progress_stroke_caches_.front();
+}
+
 absl::Status SkiaRenderer::Draw(GrDirectContext* context, const Stroke& stroke,
                                 const AffineTransform& object_to_canvas,
                                 SkCanvas& canvas) {
-  // TODO: b/286547863 - Implement `RenderCache` to save and update the created
-  // drawable inside the stroke.
-
   auto drawable = CreateDrawable(context, stroke, object_to_canvas);
   if (!drawable.ok()) return drawable.status();
   drawable->Draw(canvas);
   return absl::OkStatus();
 }
 
+absl::Status SkiaRenderer::DrawBatch(
+    GrDirectContext* context, absl::Span<const Stroke* const> strokes,
+    absl::Span<const AffineTransform> object_to_canvas, SkCanvas& canvas) {
+  if (strokes.size() != object_to_canvas.size()) {
+    return absl::InvalidArgumentError(absl::StrCat(
+        "`strokes` and `object_to_canvas` must have the same size, got ",
+        strokes.size(), " and ", object_to_canvas.size()));
+  }
+  for (const Stroke* stroke : strokes) ABSL_CHECK_NE(stroke, nullptr);
+
+  StrokeBatchRun run;
+  for (size_t i = 0; i < strokes.size(); ++i) {
+    absl::StatusOr<bool> added = false;
+    if (context != nullptr) {
+      added = AddToStrokeBatchRun(context, *strokes[i], object_to_canvas[i],
+                                  run, canvas);
+      if (!added.ok()) return added.status();
+    }
+    if (*added) continue;
+
+    // Paths, and meshes that cannot be merged, are drawn one stroke at a time.
+    if (absl::Status status = FlushStrokeBatchRun(context, run, canvas);
+        !status.ok()) {
+      return status;
+    }
+    if (absl::Status status =
+            Draw(context, *strokes[i], object_to_canvas[i], canvas);
+        !status.ok()) {
+      return status;
+    }
+  }
+  absl::Status status = FlushStrokeBatchRun(context, run, canvas);
+  stroke_batch_cache_.EvictUnused();
+  return status;
+}
+
+namespace {
+
+// Returns true if the two transforms have the same linear component.
+bool HaveSameLinearComponent(const AffineTransform& a,
+                             const AffineTransform& b) {
+  return a.A() == b.A() && a.B() == b.B() && a.D() == b.D() && a.E() == b.E();
+}
+
+}  // namespace
+
+absl::StatusOr<bool> SkiaRenderer::AddToStrokeBatchRun(
+    GrDirectContext* context, const Stroke& stroke,
+    const AffineTransform& object_to_canvas, StrokeBatchRun& run,
+    SkCanvas& canvas) {
+  // The stroke's meshes are drawn with the transform of the first coat in the
+  // run, so the transform must be invertible to find their offset.
+  std::optional<AffineTransform> canvas_to_object = object_to_canvas.Inverse();
+  if (!canvas_to_object.has_value()) return false;
+  const PartitionedMesh& stroke_shape =
+      stroke.GetShapeForScale(MaxScaleFactor(object_to_canvas));
+  for (const Mesh& mesh : stroke_shape.Meshes()) {
+    if (mesh.VertexCount() > StrokeMeshBatch::kMaxVertexCount) return false;
+  }
+
+  const Brush& brush = stroke.GetBrush();
+  for (uint32_t coat_index = 0; coat_index < stroke_shape.RenderGroupCount();
+       ++coat_index) {
+    absl::Span<const Mesh> meshes = stroke_shape.RenderGroupMeshes(coat_index);
+    if (meshes.empty()) continue;
+
+    // The stroke specification is not used for drawing, but checks that the
+    // coat's `MeshFormat` is supported, as it would be by `Draw()`.
+    if (absl::Status status =
+            specification_cache_.GetForStroke(stroke_shape, coat_index)
+                .status();
+        !status.ok()) {
+      return status;
+    }
+    const BrushPaint& brush_paint = brush.GetCoats()[coat_index].paint;
+    absl::StatusOr<sk_sp<SkShader>> shader = shader_cache_.GetShaderForPaint(
+        brush_paint, brush.GetSize(), stroke.GetInputs());
+    if (!shader.ok()) return shader.status();
+    sk_sp<SkBlender> blender = shader_cache_.GetBlenderForPaint(brush_paint);
+    BrushPaint::TextureMapping texture_mapping =
+        GetBrushPaintTextureMapping(brush_paint);
+
+    // A tiling texture is sampled at the positions of the vertices, which are
+    // moved unless the transforms are equal.
+    bool can_merge =
+        !run.batches.empty() && run.shader == *shader &&
+        run.blender == blender && run.texture_mapping == texture_mapping &&
+        HaveSameLinearComponent(run.object_to_canvas, object_to_canvas) &&
+        (*shader == nullptr ||
+         texture_mapping != BrushPaint::TextureMapping::kTiling ||
+         (run.object_to_canvas.C() == object_to_canvas.C() &&
+          run.object_to_canvas.F() == object_to_canvas.F()));
+    if (!can_merge) {
+      if (absl::Status status = FlushStrokeBatchRun(context, run, canvas);
+          !status.ok()) {
+        return status;
+      }
+      run.shader = *std::move(shader);
+      run.blender = std::move(blender);
+      run.texture_mapping = texture_mapping;
+      run.object_to_canvas = object_to_canvas;
+      run.canvas_to_object = *canvas_to_object;
+    }
+
+    // The position that the origin of the stroke's object coordinates is
+    // drawn at, in the object coordinates of the first coat in the run.
+    Vec offset = run.canvas_to_object.Apply(
+                     object_to_canvas.Apply(Point{0, 0})) -
+                 Point{0, 0};
+    for (const Mesh& mesh : meshes) {
+      if (mesh.VertexCount() == 0) continue;
+      if (run.batches.empty() ||
+          run.last_batch_vertex_count + mesh.VertexCount() >
+              StrokeMeshBatch::kMaxVertexCount) {
+        run.batches.emplace_back();
+        run.last_batch_vertex_count = 0;
+      }
+      run.batches.back().push_back(
+          {.mesh = mesh, .offset = offset, .brush_color = brush.GetColor()});
+      run.last_batch_vertex_count += mesh.VertexCount();
+    }
+  }
+  return true;
+}
+
+absl::Status SkiaRenderer::FlushStrokeBatchRun(GrDirectContext* context,
+                                               StrokeBatchRun& run,
+                                               SkCanvas& canvas) {
+  if (run.batches.empty()) return absl::OkStatus();
+
+  absl::InlinedVector<MeshDrawable::Partition, 1> partitions;
+  partitions.reserve(run.batches.size());
+  for (const std::vector<StrokeMeshBatchCache::Item>& batch : run.batches) {
+    absl::StatusOr<MeshDrawable::Partition> partition =
+        stroke_batch_cache_.GetOrUpload(context, batch);
+    if (!partition.ok()) return partition.status();
+    partitions.push_back(*std::move(partition));
+  }
+  run.batches.clear();
+  run.last_batch_vertex_count = 0;
+
+  absl::StatusOr<MeshDrawable> mesh_drawable = MeshDrawable::Create(
+      specification_cache_.GetForStrokeBatch(), std::move(run.blender),
+      std::move(run.shader), std::move(partitions));
+  if (!mesh_drawable.ok()) return mesh_drawable.status();
+  mesh_drawable->SetTextureMapping(run.texture_mapping);
+  Drawable(run.object_to_canvas, {*std::move(mesh_drawable)}).Draw(canvas);
+  return absl::OkStatus();
+}
+
 namespace {
 
 SkM44 ToSkiaM44(const AffineTransform& t) {
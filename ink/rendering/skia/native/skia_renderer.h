@@ -15,6 +15,7 @@
 #ifndef INK_RENDERING_SKIA_NATIVE_SKIA_RENDERER_H_
 #define INK_RENDERING_SKIA_NATIVE_SKIA_RENDERER_H_
 
+#include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <variant>
@@ -24,18 +25,28 @@
 #include "absl/container/inlined_vector.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "ink/brush/brush_paint.h"
 #include "ink/color/color.h"
 #include "ink/geometry/affine_transform.h"
+#include "ink/geometry/partitioned_mesh.h"
+#include "ink/rendering/skia/native/internal/frozen_stroke_prefix.h"
+#include "ink/rendering/skia/native/internal/in_progress_stroke_render_cache.h"
+#include "ink/rendering/skia/native/internal/mesh_buffer_cache.h"
 #include "ink/rendering/skia/native/internal/mesh_drawable.h"
 #include "ink/rendering/skia/native/internal/mesh_specification_cache.h"
 #include "ink/rendering/skia/native/internal/path_drawable.h"
 #include "ink/rendering/skia/native/internal/shader_cache.h"
+#include "ink/rendering/skia/native/internal/stroke_mesh_batch_cache.h"
 #include "ink/rendering/texture_bitmap_store.h"
 #include "ink/strokes/in_progress_stroke.h"
 #include "ink/strokes/stroke.h"
 #include "ink/types/uri.h"
+#include "include/core/SkBlender.h"
 #include "include/core/SkCanvas.h"
 #include "include/core/SkMesh.h"
+#include "include/core/SkRefCnt.h"
+#include "include/core/SkShader.h"
 #include "include/gpu/ganesh/GrDirectContext.h"
 
 namespace ink {
@@ -99,15 +110,66 @@ class SkiaRenderer {
   // should wrap calls to this function with calls to `canvas.save()` and
   // `canvas.restore()`.
   //
-  // TODO: b/286547863 - These functions currently generate temporary drawable
-  // data on every call. This data will get cached on the `stroke` inside a
-  // Skia implementation of a `RenderCache`, which would get initially attached
-  // to the stroke by calling a separate renderer member function.
+  // When drawing an `InProgressStroke` with a non-null `context`, the renderer
+  // keeps GPU buffers for the few most recently drawn in-progress strokes, and
+  // on each call only uploads the parts of the stroke's meshes that changed
+  // since the previous one. Drawing a growing stroke every frame therefore
+  // costs an upload proportional to the new geometry rather than to the length
+  // of the stroke. Meshes too large for 16-bit indices are drawn in several
+  // partitions, of which only the newest is rebuilt on each call.
+  //
+  // For long single-coat in-progress strokes drawn with a non-null `context`,
+  // the renderer also keeps an offscreen raster of the start of the stroke
+  // that has stopped changing (see `FrozenStrokePrefix`), and on each call only
+  // draws the newly settled triangles into it and the changing tail of the
+  // stroke over it.
+  //
+  // The `Stroke` overload reuses the cached GPU buffers of the stroke's meshes
+  // (see `SetBufferCacheByteBudget()`), but still creates the rest of its
+  // drawable, such as the mesh uniforms, on every call.
   absl::Status Draw(GrDirectContext* context, const InProgressStroke& stroke,
                     const AffineTransform& object_to_canvas, SkCanvas& canvas);
   absl::Status Draw(GrDirectContext* context, const Stroke& stroke,
                     const AffineTransform& object_to_canvas, SkCanvas& canvas);
 
+  // Draws each of `strokes` with the transform at the same index in
+  // `object_to_canvas` into the `canvas`, with the same result as calling
+  // `Draw()` for each stroke in order, but with far fewer draw calls.
+  //
+  // With a non-null `context`, brush coats that are drawn one after another
+  // are merged into a single `SkCanvas::drawMesh()` call when they use the
+  // same shader and blender, and their transforms have the same linear
+  // component. The meshes of the merged coats are unpacked into shared vertex
+  // and index buffers, in which every vertex carries the brush color of its
+  // stroke, and the positions of each stroke are moved so that all of them
+  // are drawn with the transform of the first one (see `StrokeMeshBatch`).
+  // A merged draw holds at most 2^16 vertices, so a long run of mergeable
+  // coats still takes one draw per 2^16 vertices. Only consecutive coats are
+  // merged, so overlapping strokes blend in the same order as with `Draw()`.
+  // Coats with a tiling texture are only merged if their whole transforms
+  // are equal, since the texture is sampled at the moved positions.
+  //
+  // A stroke with a mesh of more than 2^16 vertices, or with a non-invertible
+  // transform, is drawn as by `Draw()`, between the merged draws of the
+  // strokes before and after it.
+  //
+  // The merged buffers are kept until a call to `DrawBatch()` that does not
+  // draw them, so drawing the same strokes again, including after applying a
+  // common view transform to all of `object_to_canvas`, reuses them as long as
+  // the strokes choose the same levels of detail.
+  //
+  // With a null `context`, every stroke is drawn as a path, as by `Draw()`.
+  //
+  // Returns an invalid-argument error if `strokes` and `object_to_canvas` have
+  // different sizes, or if rendering would fail due to an unsupported stroke.
+  // CHECK-fails if any element of `strokes` is null.
+  //
+  // NOTE: Like `Draw()`, this function calls `canvas.setMatrix()`.
+  absl::Status DrawBatch(GrDirectContext* context,
+                         absl::Span<const Stroke* const> strokes,
+                         absl::Span<const AffineTransform> object_to_canvas,
+                         SkCanvas& canvas);
+
   // Return a new `Drawable` created from an `InProgressStroke`.
   //
   // The returned drawable will have its transform set to `object_to_canvas` and
@@ -119,7 +181,10 @@ class SkiaRenderer {
   // `Brush`.
   //
   // NOTE: the drawable will not automatically track changes to the `stroke` and
-  // must be manually recreated and/or updated.
+  // must be manually recreated and/or updated. Unlike `Draw()`, this uploads
+  // the whole stroke to new buffers of exactly the size of its meshes, rather
+  // than using the renderer's buffers for in-progress strokes, since the
+  // returned drawable may outlive subsequent updates to them.
   absl::StatusOr<Drawable> CreateDrawable(
       GrDirectContext* context, const InProgressStroke& stroke,
       const AffineTransform& object_to_canvas);
@@ -130,6 +195,12 @@ class SkiaRenderer {
   // its brush-color set to that of the stroke. If the `stroke` is empty, this
   // function returns an "empty" drawable.
   //
+  // If the stroke has levels of detail, the drawable uses the coarsest one that
+  // is accurate enough at the scale of `object_to_canvas`; see
+  // `Stroke::GetShapeForScale()`. It should therefore be recreated rather than
+  // given a transform with a larger scale. `Draw()` and `DrawBatch()` make the
+  // same choice.
+  //
   // An invalid-argument error is returned if rendering would fail due to an
   // unsupported `stroke`.
   // TODO: b/284117747 - This function will be able to return an
@@ -144,15 +215,109 @@ class SkiaRenderer {
 
   // TODO: b/284117747 - Add functions to "update" a `Drawable`.
 
+  // The renderer keeps the GPU buffers holding the meshes of the most recently
+  // drawn `Stroke`s, so that drawing an unchanged stroke again only needs new
+  // uniform values. The following functions set the budget for the total size
+  // of the cached buffers, which defaults to
+  // `MeshBufferCache::kDefaultByteBudget`, and return the cache's statistics.
+  void SetBufferCacheByteBudget(size_t byte_budget);
+  const skia_native_internal::MeshBufferCache::Stats& GetBufferCacheStats()
+      const;
+
  private:
+  // The maximum number of `InProgressStroke`s for which GPU buffers are kept,
+  // which is more than the number that are typically drawn at once.
+  static constexpr size_t kMaxCachedInProgressStrokes = 4;
+
+  // The minimum number of triangles in the mesh of an in-progress stroke for
+  // `Draw()` to keep a raster of its start. Below this, drawing the whole mesh
+  // is cheap enough not to be worth the memory for the raster.
+  static constexpr uint32_t kMinFrozenPrefixTriangleCount = 4096;
+
+  struct InProgressStrokeCacheEntry {
+    const InProgressStroke* stroke;
+    skia_native_internal::InProgressStrokeRenderCache cache;
+    skia_native_internal::FrozenStrokePrefix frozen_prefix;
+  };
+
+  // Consecutive brush coats being merged into one draw by `DrawBatch()`, with
+  // the settings that they share.
+  struct StrokeBatchRun {
+    sk_sp<SkShader> shader;
+    sk_sp<SkBlender> blender;
+    BrushPaint::TextureMapping texture_mapping;
+    // The transform of the first coat in the run, with which all of them are
+    // drawn, and its inverse.
+    AffineTransform object_to_canvas;
+    AffineTransform canvas_to_object;
+    // The meshes of the coats, split into batches of at most
+    // `StrokeMeshBatch::kMaxVertexCount` vertices, and the vertex count of
+    // the last batch.
+    std::vector<std::vector<skia_native_internal::StrokeMeshBatchCache::Item>>
+        batches;
+    uint32_t last_batch_vertex_count = 0;
+  };
+
+  // Adds the coats of `stroke` to `run` for `DrawBatch()`, first drawing and
+  // clearing `run` whenever the next coat cannot be merged with it. Returns
+  // false without changing `run` if the stroke cannot be merged at all.
+  absl::StatusOr<bool> AddToStrokeBatchRun(
+      GrDirectContext* context, const Stroke& stroke,
+      const AffineTransform& object_to_canvas, StrokeBatchRun& run,
+      SkCanvas& canvas);
+
+  // Draws the coats in `run` with one draw per batch, and clears it.
+  absl::Status FlushStrokeBatchRun(GrDirectContext* context,
+                                   StrokeBatchRun& run, SkCanvas& canvas);
+
+  // Implementation of `CreateDrawable()` for an `InProgressStroke`, which
+  // creates the mesh partitions with `render_cache`.
+  absl::StatusOr<Drawable> CreateDrawable(
+      GrDirectContext* context, const InProgressStroke& stroke,
+      const AffineTransform& object_to_canvas,
+      skia_native_internal::InProgressStrokeRenderCache& render_cache);
+
+  // Draws `stroke`, which must have a single brush coat that is drawn as a
+  // mesh, using the frozen prefix in `entry` for the start of its mesh, and
+  // drawing the rest of the mesh from `entry.cache`.
+  absl::Status DrawWithFrozenPrefix(GrDirectContext* context,
+                                    const InProgressStroke& stroke,
+                                    const AffineTransform& object_to_canvas,
+                                    InProgressStrokeCacheEntry& entry,
+                                    SkCanvas& canvas);
+
+  // Returns a `MeshDrawable` for the coat of `stroke` at `coat_index`, which
+  // draws `partitions` of the stroke's mesh.
+  absl::StatusOr<skia_native_internal::MeshDrawable> CreateMeshDrawable(
+      const InProgressStroke& stroke, uint32_t coat_index,
+      absl::InlinedVector<skia_native_internal::MeshDrawable::Partition, 1>
+          partitions);
+
+  // Returns a `MeshDrawable` for the coat of `stroke` at `coat_index`, which
+  // draws `partitions` of `shape` with `specification`. `shape` is the shape of
+  // `stroke` or one of its levels of detail.
+  absl::StatusOr<skia_native_internal::MeshDrawable> CreateMeshDrawable(
+      const Stroke& stroke, const PartitionedMesh& shape, uint32_t coat_index,
+      sk_sp<SkMeshSpecification> specification,
+      absl::InlinedVector<skia_native_internal::MeshDrawable::Partition, 1>
+          partitions);
+
+  // Returns the cache entry for `stroke`, creating it if needed and evicting
+  // the least recently used one if there are too many.
+  InProgressStrokeCacheEntry& GetCacheEntry(const InProgressStroke& stroke);
+
   absl::Nullable<std::shared_ptr<TextureBitmapStore>> texture_provider_;
   skia_native_internal::ShaderCache shader_cache_;
   skia_native_internal::MeshSpecificationCache specification_cache_;
+  skia_native_internal::MeshBufferCache mesh_buffer_cache_;
+  skia_native_internal::StrokeMeshBatchCache stroke_batch_cache_;
 
-  // Buffer of 16-bit integers used during index buffer creation when the
-  // incoming mesh holds 32-bit indices.
-  // TODO: b/294561921 - Remove once `InProgressStroke` uses 16-bit indices.
-  std::vector<uint16_t> temporary_indices_;
+  // Render caches for the `InProgressStroke`s most recently drawn by `Draw()`,
+  // most recently used first. An entry is only found by the address of its
+  // stroke; `InProgressStroke::GetMeshChangesSince()` determines how much of
+  // its contents can be reused, so a different stroke at the same address is
+  // handled correctly.
+  std::vector<InProgressStrokeCacheEntry> in_progress_stroke_caches_;
 };
 
 // Type storing all information needed for drawing an Ink object into an
@@ -14,17 +14,91 @@
 
 #include "ink/rendering/skia/native/skia_renderer.h"
 
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include "absl/log/absl_check.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "ink/brush/brush.h"
+#include "ink/brush/brush_family.h"
+#include "ink/brush/brush_paint.h"
+#include "ink/brush/brush_tip.h"
 #include "ink/color/color.h"
 #include "ink/geometry/affine_transform.h"
 #include "ink/geometry/angle.h"
+#include "ink/geometry/rect.h"
 #include "ink/geometry/type_matchers.h"
+#include "ink/strokes/input/recorded_test_inputs.h"
+#include "ink/strokes/stroke.h"
+#include "include/core/SkBitmap.h"
+#include "include/core/SkBlender.h"
+#include "include/core/SkCanvas.h"
+#include "include/core/SkColor.h"
+#include "include/core/SkMesh.h"
+#include "include/core/SkPaint.h"
+#include "include/core/SkRefCnt.h"
+#include "include/gpu/ganesh/GrDirectContext.h"
+#include "include/gpu/ganesh/mock/GrMockTypes.h"
+#include "include/utils/SkNoDrawCanvas.h"
 
 namespace ink {
 namespace {
 
-// This test contains the cases that do not require a `GrDirectContext`.
+// This test contains the cases that do not require a GPU. A mock
+// `GrDirectContext` creates buffers but does not render anything, so tests
+// using it count the meshes drawn into a canvas that draws nothing.
+
+using ::testing::HasSubstr;
+
+// A canvas that draws nothing, and counts the calls to `drawMesh()`.
+class DrawMeshCountingCanvas : public SkNoDrawCanvas {
+ public:
+  DrawMeshCountingCanvas() : SkNoDrawCanvas(200, 200) {}
+
+  int DrawMeshCount() const { return draw_mesh_count_; }
+
+ protected:
+  void onDrawMesh(const SkMesh& mesh, sk_sp<SkBlender> blender,
+                  const SkPaint& paint) override {
+    ++draw_mesh_count_;
+  }
+
+ private:
+  int draw_mesh_count_ = 0;
+};
+
+Stroke MakeStroke(const Color& color, const Rect& bounds) {
+  absl::StatusOr<BrushFamily> family =
+      BrushFamily::Create(BrushTip{}, BrushPaint{});
+  ABSL_CHECK_OK(family);
+  absl::StatusOr<Brush> brush = Brush::Create(*family, color, 5, 0.1);
+  ABSL_CHECK_OK(brush);
+  return Stroke(*brush, MakeCompleteSpringShapeInputs(bounds));
+}
+
+sk_sp<GrDirectContext> MakeMockContext() {
+  GrMockOptions options;
+  sk_sp<GrDirectContext> context = GrDirectContext::MakeMock(&options);
+  ABSL_CHECK(context != nullptr);
+  return context;
+}
+
+SkBitmap MakeBitmap() {
+  SkBitmap bitmap;
+  bitmap.allocN32Pixels(200, 200);
+  bitmap.eraseColor(SK_ColorWHITE);
+  return bitmap;
+}
+
+absl::Span<const std::byte> Pixels(const SkBitmap& bitmap) {
+  return absl::MakeConstSpan(static_cast<const std::byte*>(bitmap.getPixels()),
+                             bitmap.computeByteSize());
+}
 
 TEST(SkiaRendererDrawableTest, DefaultConstructed) {
   SkiaRenderer::Drawable drawable;
@@ -50,5 +124,117 @@ TEST(SkiaRendererDrawableDeathTest, SetObjectToCanvas) {
   EXPECT_DEATH_IF_SUPPORTED(drawable.SetBrushColor(Color::GoogleBlue()), "");
 }
 
+TEST(SkiaRendererTest, DrawBatchMergesStrokesIntoOneDrawMesh) {
+  sk_sp<GrDirectContext> context = MakeMockContext();
+  std::vector<Stroke> strokes = {
+      MakeStroke(Color::GoogleBlue(), Rect::FromTwoPoints({10, 10}, {120, 90})),
+      MakeStroke(Color::Black(), Rect::FromTwoPoints({50, 40}, {180, 190})),
+      MakeStroke(Color::GoogleBlue(), Rect::FromTwoPoints({0, 80}, {100, 200})),
+  };
+  std::vector<const Stroke*> stroke_pointers = {&strokes[0], &strokes[1],
+                                                &strokes[2]};
+  // The transforms differ only in their translation.
+  std::vector<AffineTransform> transforms = {
+      AffineTransform::Identity(),
+      AffineTransform::Translate({5, -5}),
+      AffineTransform::Translate({-20, 10}),
+  };
+  SkiaRenderer renderer;
+
+  DrawMeshCountingCanvas per_stroke_canvas;
+  for (size_t i = 0; i < strokes.size(); ++i) {
+    ASSERT_EQ(renderer.Draw(context.get(), strokes[i], transforms[i],
+                            per_stroke_canvas),
+              absl::OkStatus());
+  }
+  EXPECT_GE(per_stroke_canvas.DrawMeshCount(), 3);
+
+  DrawMeshCountingCanvas batch_canvas;
+  ASSERT_EQ(renderer.DrawBatch(context.get(), stroke_pointers, transforms,
+                               batch_canvas),
+            absl::OkStatus());
+  EXPECT_EQ(batch_canvas.DrawMeshCount(), 1);
+
+  // Drawing the batch again, e.g. on the next frame, is also one draw.
+  ASSERT_EQ(renderer.DrawBatch(context.get(), stroke_pointers, transforms,
+                               batch_canvas),
+            absl::OkStatus());
+  EXPECT_EQ(batch_canvas.DrawMeshCount(), 2);
+}
+
+TEST(SkiaRendererTest, DrawBatchOnlyMergesConsecutiveStrokes) {
+  sk_sp<GrDirectContext> context = MakeMockContext();
+  Stroke stroke =
+      MakeStroke(Color::Black(), Rect::FromTwoPoints({0, 0}, {100, 100}));
+  std::vector<const Stroke*> strokes = {&stroke, &stroke, &stroke, &stroke};
+  // The third transform has a different linear component, so the strokes
+  // before and after it cannot be merged without changing the draw order.
+  std::vector<AffineTransform> transforms = {
+      AffineTransform::Identity(),
+      AffineTransform::Translate({10, 10}),
+      AffineTransform::Rotate(kFullTurn / 8),
+      AffineTransform::Translate({20, 20}),
+  };
+
+  DrawMeshCountingCanvas canvas;
+  ASSERT_EQ(
+      SkiaRenderer().DrawBatch(context.get(), strokes, transforms, canvas),
+      absl::OkStatus());
+  EXPECT_EQ(canvas.DrawMeshCount(), 3);
+}
+
+TEST(SkiaRendererTest, DrawBatchWithEmptySpans) {
+  sk_sp<GrDirectContext> context = MakeMockContext();
+  DrawMeshCountingCanvas canvas;
+  EXPECT_EQ(SkiaRenderer().DrawBatch(context.get(), {}, {}, canvas),
+            absl::OkStatus());
+  EXPECT_EQ(canvas.DrawMeshCount(), 0);
+}
+
+TEST(SkiaRendererTest, DrawBatchMatchesDrawWithoutContext) {
+  std::vector<Stroke> strokes = {
+      MakeStroke(Color::GoogleBlue(), Rect::FromTwoPoints({10, 10}, {120, 90})),
+      MakeStroke(Color::Black(), Rect::FromTwoPoints({50, 40}, {180, 190})),
+  };
+  std::vector<const Stroke*> stroke_pointers = {&strokes[0], &strokes[1]};
+  std::vector<AffineTransform> transforms = {
+      AffineTransform::Translate({5, -5}),
+      AffineTransform::RotateAboutPoint(kFullTurn / 16, {50, 140}),
+  };
+  SkiaRenderer renderer;
+
+  SkBitmap expected = MakeBitmap();
+  SkCanvas expected_canvas(expected);
+  for (size_t i = 0; i < strokes.size(); ++i) {
+    ASSERT_EQ(
+        renderer.Draw(nullptr, strokes[i], transforms[i], expected_canvas),
+        absl::OkStatus());
+  }
+
+  SkBitmap actual = MakeBitmap();
+  SkCanvas actual_canvas(actual);
+  ASSERT_EQ(renderer.DrawBatch(nullptr, stroke_pointers, transforms,
+                               actual_canvas),
+            absl::OkStatus());
+
+  absl::Span<const std::byte> actual_pixels = Pixels(actual);
+  absl::Span<const std::byte> expected_pixels = Pixels(expected);
+  EXPECT_TRUE(std::equal(actual_pixels.begin(), actual_pixels.end(),
+                         expected_pixels.begin(), expected_pixels.end()));
+}
+
+TEST(SkiaRendererTest, DrawBatchWithMismatchedTransformCount) {
+  Stroke stroke =
+      MakeStroke(Color::Black(), Rect::FromTwoPoints({0, 0}, {100, 100}));
+  std::vector<const Stroke*> strokes = {&stroke, &stroke};
+  std::vector<AffineTransform> transforms = {AffineTransform::Identity()};
+  DrawMeshCountingCanvas canvas;
+
+  absl::Status status =
+      SkiaRenderer().DrawBatch(nullptr, strokes, transforms, canvas);
+  EXPECT_EQ(status.code(), absl::StatusCode::kInvalidArgument);
+  EXPECT_THAT(status.message(), HasSubstr("same size"));
+}
+
 }  // namespace
 }  // namespace ink
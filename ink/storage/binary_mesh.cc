@@ -0,0 +1,452 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ink/storage/binary_mesh.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/strings/substitute.h"
+#include "absl/types/span.h"
+#include "ink/geometry/mesh.h"
+#include "ink/geometry/mesh_format.h"
+#include "ink/geometry/mesh_packing_types.h"
+#include "ink/geometry/partitioned_mesh.h"
+
+namespace ink {
+namespace {
+
+// Encoded data layout (all fields are `uint32_t` unless otherwise noted):
+//
+// Mesh:
+//   magic (`kMeshMagic`), version
+//   index format, number of attributes (N)
+//   N x (attribute type, attribute ID)
+//   for each attribute, one (offset, scale) `float` pair per component
+//   vertex count, triangle count
+//   if vertex count > 0, for each attribute: the minimum `float` of each
+//     component, then the maximum `float` of each component
+//   packed vertex data, padded to a multiple of 4 bytes
+//   packed index data, padded to a multiple of 4 bytes
+//
+// PartitionedMesh:
+//   magic (`kPartitionedMeshMagic`), version
+//   number of render groups (G)
+//   G x (number of meshes, number of outlines, then for each outline: the
+//     number of vertices (V), then V x (`uint32_t` mesh index, `uint32_t`
+//     vertex index))
+//   one encoded Mesh (as above) for each mesh of each group, in order
+//   size in bytes of the serialized spatial index (zero if absent), then the
+//     serialized spatial index, padded to a multiple of 4 bytes
+//
+// Any change to this layout must increment `kVersion`.
+
+// The magic numbers are the ASCII strings "INKM" and "INKP" when written in
+// little-endian byte order.
+constexpr uint32_t kMeshMagic = 0x4d4b4e49;
+constexpr uint32_t kPartitionedMeshMagic = 0x504b4e49;
+constexpr uint32_t kVersion = 1;
+
+class Writer {
+ public:
+  explicit Writer(std::vector<std::byte>& output) : output_(output) {}
+
+  void WriteU32(uint32_t value) { WriteRaw(&value, sizeof(value)); }
+  void WriteFloat(float value) { WriteRaw(&value, sizeof(value)); }
+
+  // Writes `bytes`, followed by zero-padding up to a multiple of 4 bytes.
+  void WritePaddedBytes(absl::Span<const std::byte> bytes) {
+    output_.insert(output_.end(), bytes.begin(), bytes.end());
+    output_.resize(output_.size() + (4 - bytes.size() % 4) % 4, std::byte{0});
+  }
+
+ private:
+  void WriteRaw(const void* value, size_t size) {
+    size_t offset = output_.size();
+    output_.resize(offset + size);
+    std::memcpy(output_.data() + offset, value, size);
+  }
+
+  std::vector<std::byte>& output_;
+};
+
+// Reads values from encoded data. Each method returns false, without consuming
+// anything, if there isn't enough data remaining.
+class Reader {
+ public:
+  explicit Reader(absl::Span<const std::byte> data) : data_(data) {}
+
+  [[nodiscard]] bool ReadU32(uint32_t& value) {
+    return ReadRaw(&value, sizeof(value));
+  }
+  [[nodiscard]] bool ReadFloat(float& value) {
+    return ReadRaw(&value, sizeof(value));
+  }
+
+  // Reads `size` bytes, followed by padding up to a multiple of 4 bytes. The
+  // returned span refers to the underlying data.
+  [[nodiscard]] bool ReadPaddedBytes(uint64_t size,
+                                     absl::Span<const std::byte>& bytes) {
+    uint64_t padded_size = size + (4 - size % 4) % 4;
+    if (padded_size > data_.size() - offset_) return false;
+    bytes = data_.subspan(offset_, size);
+    offset_ += padded_size;
+    return true;
+  }
+
+  size_t RemainingSize() const { return data_.size() - offset_; }
+
+ private:
+  bool ReadRaw(void* value, size_t size) {
+    if (size > data_.size() - offset_) return false;
+    std::memcpy(value, data_.data() + offset_, size);
+    offset_ += size;
+    return true;
+  }
+
+  absl::Span<const std::byte> data_;
+  size_t offset_ = 0;
+};
+
+absl::Status TruncatedError() {
+  return absl::InvalidArgumentError("Encoded data is truncated");
+}
+
+absl::Status ReadHeader(Reader& reader, uint32_t expected_magic,
+                        absl::string_view type_name) {
+  uint32_t magic;
+  if (!reader.ReadU32(magic) || magic != expected_magic) {
+    return absl::InvalidArgumentError(
+        absl::Substitute("Encoded data is not a $0", type_name));
+  }
+  uint32_t version;
+  if (!reader.ReadU32(version)) return TruncatedError();
+  if (version != kVersion) {
+    return absl::InvalidArgumentError(absl::Substitute(
+        "Unsupported $0 encoding version $1", type_name, version));
+  }
+  return absl::OkStatus();
+}
+
+void WriteMesh(const Mesh& mesh, Writer& writer) {
+  const MeshFormat& format = mesh.Format();
+  absl::Span<const MeshFormat::Attribute> attributes = format.Attributes();
+  writer.WriteU32(kMeshMagic);
+  writer.WriteU32(kVersion);
+  writer.WriteU32(static_cast<uint32_t>(format.GetIndexFormat()));
+  writer.WriteU32(attributes.size());
+  for (const MeshFormat::Attribute& attribute : attributes) {
+    writer.WriteU32(static_cast<uint32_t>(attribute.type));
+    writer.WriteU32(static_cast<uint32_t>(attribute.id));
+  }
+  for (size_t i = 0; i < attributes.size(); ++i) {
+    for (const MeshAttributeCodingParams::ComponentCodingParams& component :
+         mesh.VertexAttributeUnpackingParams(i).components.Values()) {
+      writer.WriteFloat(component.offset);
+      writer.WriteFloat(component.scale);
+    }
+  }
+  writer.WriteU32(mesh.VertexCount());
+  writer.WriteU32(mesh.TriangleCount());
+  if (mesh.VertexCount() > 0) {
+    for (size_t i = 0; i < attributes.size(); ++i) {
+      std::optional<MeshAttributeBounds> bounds = mesh.AttributeBounds(i);
+      for (float value : bounds->minimum.Values()) writer.WriteFloat(value);
+      for (float value : bounds->maximum.Values()) writer.WriteFloat(value);
+    }
+  }
+  writer.WritePaddedBytes(mesh.RawVertexData());
+  writer.WritePaddedBytes(mesh.RawIndexData());
+}
+
+absl::StatusOr<Mesh> ReadMesh(Reader& reader,
+                              const std::shared_ptr<const void>& storage) {
+  if (absl::Status status = ReadHeader(reader, kMeshMagic, "Mesh");
+      !status.ok()) {
+    return status;
+  }
+
+  uint32_t index_format;
+  uint32_t n_attributes;
+  if (!reader.ReadU32(index_format) || !reader.ReadU32(n_attributes)) {
+    return TruncatedError();
+  }
+  if (index_format != static_cast<uint32_t>(
+                          MeshFormat::IndexFormat::k16BitUnpacked16BitPacked) &&
+      index_format != static_cast<uint32_t>(
+                          MeshFormat::IndexFormat::k32BitUnpacked16BitPacked) &&
+      index_format != static_cast<uint32_t>(
+                          MeshFormat::IndexFormat::k32BitUnpacked32BitPacked)) {
+    return absl::InvalidArgumentError(
+        absl::Substitute("Unrecognized IndexFormat $0", index_format));
+  }
+  if (n_attributes > MeshFormat::MaxAttributes()) {
+    return absl::InvalidArgumentError(
+        "Maximum number of attributes exceeded");
+  }
+  std::vector<std::pair<MeshFormat::AttributeType, MeshFormat::AttributeId>>
+      attribute_types_and_ids(n_attributes);
+  for (auto& [type, id] : attribute_types_and_ids) {
+    uint32_t encoded_type;
+    uint32_t encoded_id;
+    if (!reader.ReadU32(encoded_type) || !reader.ReadU32(encoded_id)) {
+      return TruncatedError();
+    }
+    // Values that don't fit in the underlying type are mapped to one that is
+    // also not a valid enumerator, so that `MeshFormat::Create` rejects them.
+    type = static_cast<MeshFormat::AttributeType>(
+        encoded_type > UINT8_MAX ? UINT8_MAX : encoded_type);
+    id = static_cast<MeshFormat::AttributeId>(
+        encoded_id > UINT8_MAX ? UINT8_MAX : encoded_id);
+  }
+  absl::StatusOr<MeshFormat> format = MeshFormat::Create(
+      attribute_types_and_ids,
+      static_cast<MeshFormat::IndexFormat>(index_format));
+  if (!format.ok()) return format.status();
+  absl::Span<const MeshFormat::Attribute> attributes = format->Attributes();
+
+  std::vector<MeshAttributeCodingParams> unpacking_params(attributes.size());
+  for (size_t i = 0; i < attributes.size(); ++i) {
+    unpacking_params[i].components.Resize(
+        MeshFormat::ComponentCount(attributes[i].type));
+    for (MeshAttributeCodingParams::ComponentCodingParams& component :
+         unpacking_params[i].components.Values()) {
+      if (!reader.ReadFloat(component.offset) ||
+          !reader.ReadFloat(component.scale)) {
+        return TruncatedError();
+      }
+    }
+  }
+
+  uint32_t vertex_count;
+  uint32_t triangle_count;
+  if (!reader.ReadU32(vertex_count) || !reader.ReadU32(triangle_count)) {
+    return TruncatedError();
+  }
+
+  std::vector<MeshAttributeBounds> attribute_bounds;
+  if (vertex_count > 0) {
+    attribute_bounds.resize(attributes.size());
+    for (size_t i = 0; i < attributes.size(); ++i) {
+      uint8_t n_components = MeshFormat::ComponentCount(attributes[i].type);
+      attribute_bounds[i].minimum.Resize(n_components);
+      attribute_bounds[i].maximum.Resize(n_components);
+      for (float& value : attribute_bounds[i].minimum.Values()) {
+        if (!reader.ReadFloat(value)) return TruncatedError();
+      }
+      for (float& value : attribute_bounds[i].maximum.Values()) {
+        if (!reader.ReadFloat(value)) return TruncatedError();
+      }
+    }
+  }
+
+  absl::Span<const std::byte> vertex_data;
+  absl::Span<const std::byte> index_data;
+  if (!reader.ReadPaddedBytes(
+          uint64_t{vertex_count} * format->PackedVertexStride(),
+          vertex_data) ||
+      !reader.ReadPaddedBytes(
+          uint64_t{triangle_count} * 3 * format->PackedIndexStride(),
+          index_data)) {
+    return TruncatedError();
+  }
+
+  return Mesh::CreateFromPackedData(*format, unpacking_params,
+                                    attribute_bounds, vertex_data, index_data,
+                                    storage);
+}
+
+absl::Status CheckFullyConsumed(const Reader& reader) {
+  if (reader.RemainingSize() != 0) {
+    return absl::InvalidArgumentError(absl::Substitute(
+        "Encoded data has $0 unexpected trailing bytes",
+        reader.RemainingSize()));
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace
+
+std::vector<std::byte> EncodeMesh(const Mesh& mesh) {
+  std::vector<std::byte> encoded;
+  Writer writer(encoded);
+  WriteMesh(mesh, writer);
+  return encoded;
+}
+
+absl::StatusOr<Mesh> DecodeMesh(absl::Span<const std::byte> encoded,
+                                std::shared_ptr<const void> storage) {
+  Reader reader(encoded);
+  absl::StatusOr<Mesh> mesh = ReadMesh(reader, storage);
+  if (!mesh.ok()) return mesh.status();
+  if (absl::Status status = CheckFullyConsumed(reader); !status.ok()) {
+    return status;
+  }
+  return mesh;
+}
+
+std::vector<std::byte> EncodePartitionedMesh(const PartitionedMesh& shape) {
+  std::vector<std::byte> encoded;
+  Writer writer(encoded);
+  writer.WriteU32(kPartitionedMeshMagic);
+  writer.WriteU32(kVersion);
+  uint32_t n_groups = shape.RenderGroupCount();
+  writer.WriteU32(n_groups);
+  for (uint32_t group_index = 0; group_index < n_groups; ++group_index) {
+    writer.WriteU32(shape.RenderGroupMeshes(group_index).size());
+    uint32_t n_outlines = shape.OutlineCount(group_index);
+    writer.WriteU32(n_outlines);
+    for (uint32_t outline_index = 0; outline_index < n_outlines;
+         ++outline_index) {
+      absl::Span<const PartitionedMesh::VertexIndexPair> outline =
+          shape.Outline(group_index, outline_index);
+      writer.WriteU32(outline.size());
+      for (const PartitionedMesh::VertexIndexPair& vertex : outline) {
+        writer.WriteU32(vertex.mesh_index);
+        writer.WriteU32(vertex.vertex_index);
+      }
+    }
+  }
+  for (uint32_t group_index = 0; group_index < n_groups; ++group_index) {
+    for (const Mesh& mesh : shape.RenderGroupMeshes(group_index)) {
+      WriteMesh(mesh, writer);
+    }
+  }
+  std::vector<std::byte> spatial_index;
+  if (shape.IsSpatialIndexInitialized()) {
+    spatial_index = shape.SerializeSpatialIndex();
+  }
+  writer.WriteU32(spatial_index.size());
+  writer.WritePaddedBytes(spatial_index);
+  return encoded;
+}
+
+absl::StatusOr<PartitionedMesh> DecodePartitionedMesh(
+    absl::Span<const std::byte> encoded, std::shared_ptr<const void> storage) {
+  Reader reader(encoded);
+  if (absl::Status status =
+          ReadHeader(reader, kPartitionedMeshMagic, "PartitionedMesh");
+      !status.ok()) {
+    return status;
+  }
+
+  uint32_t n_groups;
+  if (!reader.ReadU32(n_groups)) return TruncatedError();
+  // Each group takes at least 8 bytes to encode, so this bounds the amount of
+  // memory we allocate below for malformed data.
+  if (n_groups > reader.RemainingSize() / 8) return TruncatedError();
+
+  struct GroupData {
+    uint32_t n_meshes = 0;
+    std::vector<std::vector<PartitionedMesh::VertexIndexPair>> outlines;
+  };
+  std::vector<GroupData> group_data(n_groups);
+  uint64_t total_meshes = 0;
+  for (GroupData& group : group_data) {
+    uint32_t n_outlines;
+    if (!reader.ReadU32(group.n_meshes) || !reader.ReadU32(n_outlines)) {
+      return TruncatedError();
+    }
+    total_meshes += group.n_meshes;
+    if (n_outlines > reader.RemainingSize() / 4) return TruncatedError();
+    group.outlines.resize(n_outlines);
+    for (std::vector<PartitionedMesh::VertexIndexPair>& outline :
+         group.outlines) {
+      uint32_t n_vertices;
+      if (!reader.ReadU32(n_vertices)) return TruncatedError();
+      if (n_vertices > reader.RemainingSize() / 8) return TruncatedError();
+      outline.resize(n_vertices);
+      for (PartitionedMesh::VertexIndexPair& vertex : outline) {
+        uint32_t mesh_index;
+        if (!reader.ReadU32(mesh_index) ||
+            !reader.ReadU32(vertex.vertex_index)) {
+          return TruncatedError();
+        }
+        // There are at most 2^16 meshes, so this can't refer to a valid mesh.
+        if (mesh_index > std::numeric_limits<uint16_t>::max()) {
+          return absl::InvalidArgumentError(absl::Substitute(
+              "Outline refers to non-existent mesh $0", mesh_index));
+        }
+        vertex.mesh_index = mesh_index;
+      }
+    }
+  }
+  // Each mesh takes at least 8 bytes to encode.
+  if (total_meshes > reader.RemainingSize() / 8) return TruncatedError();
+
+  std::vector<Mesh> meshes;
+  meshes.reserve(total_meshes);
+  for (uint64_t i = 0; i < total_meshes; ++i) {
+    absl::StatusOr<Mesh> mesh = ReadMesh(reader, storage);
+    if (!mesh.ok()) return mesh.status();
+    meshes.push_back(*std::move(mesh));
+  }
+
+  uint32_t spatial_index_size;
+  absl::Span<const std::byte> spatial_index;
+  if (!reader.ReadU32(spatial_index_size) ||
+      !reader.ReadPaddedBytes(spatial_index_size, spatial_index)) {
+    return TruncatedError();
+  }
+  if (absl::Status status = CheckFullyConsumed(reader); !status.ok()) {
+    return status;
+  }
+
+  if (n_groups == 0) {
+    if (!spatial_index.empty()) {
+      return absl::InvalidArgumentError(
+          "Spatial index given for a PartitionedMesh with no render groups");
+    }
+    return PartitionedMesh();
+  }
+
+  std::vector<std::vector<absl::Span<const PartitionedMesh::VertexIndexPair>>>
+      outline_spans(n_groups);
+  std::vector<PartitionedMesh::MeshGroup> groups(n_groups);
+  absl::Span<const Mesh> remaining_meshes = meshes;
+  for (uint32_t group_index = 0; group_index < n_groups; ++group_index) {
+    const GroupData& group = group_data[group_index];
+    outline_spans[group_index].assign(group.outlines.begin(),
+                                      group.outlines.end());
+    groups[group_index] = {
+        .meshes = remaining_meshes.subspan(0, group.n_meshes),
+        .outlines = outline_spans[group_index],
+    };
+    remaining_meshes.remove_prefix(group.n_meshes);
+  }
+  absl::StatusOr<PartitionedMesh> shape =
+      PartitionedMesh::FromMeshGroups(groups);
+  if (!shape.ok()) return shape.status();
+
+  if (!spatial_index.empty()) {
+    if (absl::Status status = shape->InitializeSpatialIndexFromSerialized(
+            spatial_index,
+            PartitionedMesh::SerializedSpatialIndexCheck::kStructure);
+        !status.ok()) {
+      return status;
+    }
+  }
+  return shape;
+}
+
+}  // namespace ink
@@ -0,0 +1,88 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef INK_STORAGE_BINARY_MESH_H_
+#define INK_STORAGE_BINARY_MESH_H_
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "ink/geometry/mesh.h"
+#include "ink/geometry/partitioned_mesh.h"
+
+namespace ink {
+
+// A compact, versioned binary format for `Mesh` and `PartitionedMesh`, intended
+// for caching meshes on disk (e.g. so that strokes don't need to be regenerated
+// each time a document is opened).
+//
+// The format stores the packed vertex and index data exactly as they are held
+// in memory, so decoding does not need to re-pack anything. If the encoded
+// bytes are kept alive for the lifetime of the decoded meshes (e.g. they are in
+// a memory-mapped file), decoding can also avoid copying the vertex and index
+// data; see the `storage` parameter below.
+//
+// All values are stored in host byte order, and the format begins with a magic
+// number that is used to reject data with the wrong byte order. Each section of
+// the encoded data is padded to a multiple of 4 bytes, so as long as the
+// encoded bytes are 4-byte aligned, so are the vertex and index data.
+//
+// The format is versioned; data written by a newer, incompatible version of
+// this library will be rejected by the decoding functions with an error.
+
+// Encodes `mesh`, including its format, its coding params and attribute bounds,
+// and its packed vertex and index data.
+std::vector<std::byte> EncodeMesh(const Mesh& mesh);
+
+// Decodes a `Mesh` that was encoded by `EncodeMesh`. Returns an error if
+// `encoded` is not a valid encoded `Mesh` (this includes all of the checks done
+// by `Mesh::CreateFromPackedData`), or if it was encoded by an unsupported
+// version of the format.
+//
+// If `storage` is null, the vertex and index data are copied into the returned
+// mesh. Otherwise, the returned mesh refers to the bytes of `encoded` in place,
+// and shares ownership of `storage`, which must keep those bytes valid and
+// unchanged until it is destroyed.
+absl::StatusOr<Mesh> DecodeMesh(absl::Span<const std::byte> encoded,
+                                std::shared_ptr<const void> storage = nullptr);
+
+// Encodes `shape`, including its render groups, meshes, and outlines. If the
+// spatial index of `shape` has been initialized, it is encoded as well, so that
+// it does not need to be rebuilt after decoding; call
+// `shape.InitializeSpatialIndex()` before encoding to ensure that it is
+// included.
+std::vector<std::byte> EncodePartitionedMesh(const PartitionedMesh& shape);
+
+// Decodes a `PartitionedMesh` that was encoded by `EncodePartitionedMesh`.
+// Returns an error if `encoded` is not a valid encoded `PartitionedMesh` (this
+// includes all of the checks done by `PartitionedMesh::FromMeshGroups`), or if
+// it was encoded by an unsupported version of the format.
+//
+// If the encoded data includes a spatial index, the returned `PartitionedMesh`
+// adopts it after checking its structure (see
+// `PartitionedMesh::SerializedSpatialIndexCheck::kStructure`).
+//
+// `storage` has the same meaning as for `DecodeMesh`; if it is non-null, the
+// meshes of the returned `PartitionedMesh` refer to the bytes of `encoded` in
+// place.
+absl::StatusOr<PartitionedMesh> DecodePartitionedMesh(
+    absl::Span<const std::byte> encoded,
+    std::shared_ptr<const void> storage = nullptr);
+
+}  // namespace ink
+
+#endif  // INK_STORAGE_BINARY_MESH_H_
@@ -0,0 +1,302 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ink/storage/binary_mesh.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/log/absl_check.h"
+#include "absl/status/status.h"
+#include "absl/status/status_matchers.h"
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "ink/geometry/mesh.h"
+#include "ink/geometry/mesh_format.h"
+#include "ink/geometry/mesh_test_helpers.h"
+#include "ink/geometry/partitioned_mesh.h"
+#include "ink/geometry/rect.h"
+#include "ink/geometry/type_matchers.h"
+
+namespace ink {
+namespace {
+
+using ::absl_testing::IsOk;
+using ::absl_testing::StatusIs;
+using ::testing::HasSubstr;
+using ::testing::Optional;
+
+MeshFormat MakeFormatWithCustomAttribute() {
+  absl::StatusOr<MeshFormat> format = MeshFormat::Create(
+      {{MeshFormat::AttributeType::kFloat2PackedIn1Float,
+        MeshFormat::AttributeId::kPosition},
+       {MeshFormat::AttributeType::kFloat3Unpacked,
+        MeshFormat::AttributeId::kCustom0}},
+      MeshFormat::IndexFormat::k32BitUnpacked16BitPacked);
+  ABSL_CHECK_OK(format);
+  return *format;
+}
+
+Mesh MakeMeshWithCustomAttribute() {
+  absl::StatusOr<Mesh> mesh =
+      Mesh::Create(MakeFormatWithCustomAttribute(),
+                   {{0, 4, 1, 5}, {0, 0, 3, 2}, {1, 2, 3, 4}, {5, 6, 7, 8},
+                    {-1, -2, -3, -4}},
+                   {0, 1, 2, 1, 3, 2});
+  ABSL_CHECK_OK(mesh);
+  return *mesh;
+}
+
+TEST(BinaryMeshTest, MeshRoundTrip) {
+  Mesh mesh = MakeMeshWithCustomAttribute();
+
+  std::vector<std::byte> encoded = EncodeMesh(mesh);
+  EXPECT_EQ(encoded.size() % 4, 0);
+
+  absl::StatusOr<Mesh> decoded = DecodeMesh(encoded);
+  ASSERT_THAT(decoded, IsOk());
+  EXPECT_THAT(*decoded, MeshEq(mesh));
+  EXPECT_EQ(decoded->RawVertexData(), mesh.RawVertexData());
+  EXPECT_EQ(decoded->RawIndexData(), mesh.RawIndexData());
+  for (uint32_t i = 0; i < mesh.Format().Attributes().size(); ++i) {
+    EXPECT_THAT(
+        decoded->VertexAttributeUnpackingParams(i),
+        MeshAttributeCodingParamsEq(mesh.VertexAttributeUnpackingParams(i)));
+    EXPECT_THAT(decoded->AttributeBounds(i),
+                Optional(MeshAttributeBoundsEq(*mesh.AttributeBounds(i))));
+  }
+}
+
+TEST(BinaryMeshTest, MeshWith32BitPackedIndicesRoundTrip) {
+  absl::StatusOr<MeshFormat> format = MeshFormat::Create(
+      {{MeshFormat::AttributeType::kFloat2Unpacked,
+        MeshFormat::AttributeId::kPosition}},
+      MeshFormat::IndexFormat::k32BitUnpacked32BitPacked);
+  ASSERT_THAT(format, IsOk());
+  // More vertices than a 16-bit index can refer to, with a triangle that uses
+  // the last of them.
+  constexpr uint32_t kVertexCount = 70000;
+  std::vector<float> x_values(kVertexCount);
+  std::vector<float> y_values(kVertexCount);
+  for (uint32_t i = 0; i < kVertexCount; ++i) {
+    x_values[i] = i;
+    y_values[i] = i % 2;
+  }
+  absl::StatusOr<Mesh> mesh =
+      Mesh::Create(*format, {x_values, y_values},
+                   {0, 1, 2, kVertexCount - 3, kVertexCount - 2,
+                    kVertexCount - 1});
+  ASSERT_THAT(mesh, IsOk());
+
+  absl::StatusOr<Mesh> decoded = DecodeMesh(EncodeMesh(*mesh));
+  ASSERT_THAT(decoded, IsOk());
+  EXPECT_THAT(*decoded, MeshEq(*mesh));
+  EXPECT_EQ(decoded->IndexStride(), 4);
+  EXPECT_EQ(decoded->RawIndexData(), mesh->RawIndexData());
+}
+
+TEST(BinaryMeshTest, EmptyMeshRoundTrip) {
+  Mesh mesh;
+
+  absl::StatusOr<Mesh> decoded = DecodeMesh(EncodeMesh(mesh));
+  ASSERT_THAT(decoded, IsOk());
+  EXPECT_THAT(*decoded, MeshEq(mesh));
+  EXPECT_EQ(decoded->VertexCount(), 0);
+  EXPECT_EQ(decoded->TriangleCount(), 0);
+}
+
+TEST(BinaryMeshTest, DecodeMeshWithStorageReferencesEncodedData) {
+  Mesh mesh = MakeMeshWithCustomAttribute();
+  auto storage = std::make_shared<std::vector<std::byte>>(EncodeMesh(mesh));
+  std::weak_ptr<std::vector<std::byte>> weak_storage = storage;
+  absl::Span<const std::byte> encoded = *storage;
+
+  absl::StatusOr<Mesh> decoded = DecodeMesh(encoded, std::move(storage));
+  ASSERT_THAT(decoded, IsOk());
+  EXPECT_THAT(*decoded, MeshEq(mesh));
+
+  // The decoded mesh's data should point into the encoded bytes, which are
+  // kept alive by the mesh.
+  absl::Span<const std::byte> vertex_data = decoded->RawVertexData();
+  EXPECT_GE(vertex_data.data(), encoded.data());
+  EXPECT_LE(vertex_data.data() + vertex_data.size(),
+            encoded.data() + encoded.size());
+  EXPECT_FALSE(weak_storage.expired());
+  decoded = Mesh();
+  EXPECT_TRUE(weak_storage.expired());
+}
+
+TEST(BinaryMeshTest, DecodeMeshWithoutStorageCopiesData) {
+  Mesh mesh = MakeMeshWithCustomAttribute();
+  std::vector<std::byte> encoded = EncodeMesh(mesh);
+
+  absl::StatusOr<Mesh> decoded = DecodeMesh(encoded);
+  ASSERT_THAT(decoded, IsOk());
+  encoded.assign(encoded.size(), std::byte{0});
+
+  EXPECT_THAT(*decoded, MeshEq(mesh));
+}
+
+TEST(BinaryMeshTest, DecodeMeshErrors) {
+  std::vector<std::byte> encoded = EncodeMesh(MakeMeshWithCustomAttribute());
+
+  EXPECT_THAT(DecodeMesh({}), StatusIs(absl::StatusCode::kInvalidArgument,
+                                       HasSubstr("not a Mesh")));
+  EXPECT_THAT(DecodeMesh(EncodePartitionedMesh(PartitionedMesh())),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("not a Mesh")));
+  for (size_t size = 4; size < encoded.size(); size += 4) {
+    EXPECT_THAT(DecodeMesh(absl::MakeConstSpan(encoded).first(size)),
+                StatusIs(absl::StatusCode::kInvalidArgument,
+                         HasSubstr("truncated")))
+        << "with size " << size;
+  }
+
+  {
+    std::vector<std::byte> trailing = encoded;
+    trailing.resize(trailing.size() + 4);
+    EXPECT_THAT(DecodeMesh(trailing),
+                StatusIs(absl::StatusCode::kInvalidArgument,
+                         HasSubstr("trailing bytes")));
+  }
+  {
+    std::vector<std::byte> wrong_version = encoded;
+    wrong_version[4] = std::byte{99};
+    EXPECT_THAT(DecodeMesh(wrong_version),
+                StatusIs(absl::StatusCode::kInvalidArgument,
+                         HasSubstr("Unsupported Mesh encoding version 99")));
+  }
+  {
+    std::vector<std::byte> bad_index_format = encoded;
+    bad_index_format[8] = std::byte{7};
+    EXPECT_THAT(DecodeMesh(bad_index_format),
+                StatusIs(absl::StatusCode::kInvalidArgument,
+                         HasSubstr("IndexFormat")));
+  }
+  {
+    // The ID of the second attribute is at byte offset 28.
+    std::vector<std::byte> duplicate_attribute = encoded;
+    duplicate_attribute[28] = duplicate_attribute[20];
+    EXPECT_THAT(DecodeMesh(duplicate_attribute),
+                StatusIs(absl::StatusCode::kInvalidArgument,
+                         HasSubstr("more than one")));
+  }
+  {
+    // The last encoded value is the padding after the six 16-bit indices;
+    // corrupt the last index instead.
+    std::vector<std::byte> bad_index = encoded;
+    bad_index[bad_index.size() - 2] = std::byte{0xff};
+    EXPECT_THAT(DecodeMesh(bad_index),
+                StatusIs(absl::StatusCode::kInvalidArgument,
+                         HasSubstr("non-existent vertex")));
+  }
+}
+
+TEST(BinaryMeshTest, PartitionedMeshRoundTrip) {
+  Mesh mesh_a = MakeMeshWithCustomAttribute();
+  Mesh mesh_b = MakeStarPartitionedMesh(6).RenderGroupMeshes(0)[0];
+  std::vector<PartitionedMesh::VertexIndexPair> outline_a = {
+      {0, 0}, {0, 1}, {0, 3}, {0, 2}};
+  std::vector<PartitionedMesh::VertexIndexPair> outline_b = {
+      {0, 1}, {0, 3}, {0, 5}};
+  std::vector<PartitionedMesh::VertexIndexPair> outline_c = {{0, 0}, {0, 2}};
+  std::vector<absl::Span<const PartitionedMesh::VertexIndexPair>>
+      outlines_a = {outline_a};
+  std::vector<absl::Span<const PartitionedMesh::VertexIndexPair>>
+      outlines_b = {outline_b, outline_c};
+  absl::StatusOr<PartitionedMesh> shape = PartitionedMesh::FromMeshGroups(
+      {{.meshes = {&mesh_a, 1}, .outlines = outlines_a},
+       {.meshes = {}},
+       {.meshes = {&mesh_b, 1}, .outlines = outlines_b}});
+  ASSERT_THAT(shape, IsOk());
+
+  absl::StatusOr<PartitionedMesh> decoded =
+      DecodePartitionedMesh(EncodePartitionedMesh(*shape));
+  ASSERT_THAT(decoded, IsOk());
+  EXPECT_THAT(*decoded, PartitionedMeshDeepEq(*shape));
+  EXPECT_FALSE(decoded->IsSpatialIndexInitialized());
+}
+
+TEST(BinaryMeshTest, EmptyPartitionedMeshRoundTrip) {
+  absl::StatusOr<PartitionedMesh> decoded =
+      DecodePartitionedMesh(EncodePartitionedMesh(PartitionedMesh()));
+  ASSERT_THAT(decoded, IsOk());
+  EXPECT_EQ(decoded->RenderGroupCount(), 0);
+
+  decoded = DecodePartitionedMesh(
+      EncodePartitionedMesh(PartitionedMesh::WithEmptyGroups(3)));
+  ASSERT_THAT(decoded, IsOk());
+  EXPECT_THAT(*decoded,
+              PartitionedMeshDeepEq(PartitionedMesh::WithEmptyGroups(3)));
+}
+
+TEST(BinaryMeshTest, PartitionedMeshRoundTripIncludesSpatialIndex) {
+  PartitionedMesh shape = MakeCoiledRingPartitionedMesh(200, 12);
+  shape.InitializeSpatialIndex();
+
+  auto storage =
+      std::make_shared<std::vector<std::byte>>(EncodePartitionedMesh(shape));
+  absl::Span<const std::byte> encoded = *storage;
+  absl::StatusOr<PartitionedMesh> decoded =
+      DecodePartitionedMesh(encoded, std::move(storage));
+  ASSERT_THAT(decoded, IsOk());
+  EXPECT_THAT(*decoded, PartitionedMeshDeepEq(shape));
+  EXPECT_TRUE(decoded->IsSpatialIndexInitialized());
+  EXPECT_EQ(decoded->SerializeSpatialIndex(), shape.SerializeSpatialIndex());
+
+  Rect query = Rect::FromCenterAndDimensions({0.5, 0.5}, 0.2, 0.2);
+  EXPECT_EQ(decoded->Coverage(query), shape.Coverage(query));
+}
+
+TEST(BinaryMeshTest, DecodePartitionedMeshErrors) {
+  PartitionedMesh shape = MakeStraightLinePartitionedMesh(4);
+  shape.InitializeSpatialIndex();
+  std::vector<std::byte> encoded = EncodePartitionedMesh(shape);
+
+  EXPECT_THAT(DecodePartitionedMesh({}),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("not a PartitionedMesh")));
+  EXPECT_THAT(DecodePartitionedMesh(EncodeMesh(Mesh())),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("not a PartitionedMesh")));
+  for (size_t size = 4; size < encoded.size(); size += 4) {
+    EXPECT_THAT(DecodePartitionedMesh(absl::MakeConstSpan(encoded).first(size)),
+                StatusIs(absl::StatusCode::kInvalidArgument))
+        << "with size " << size;
+  }
+  {
+    // Claim a huge number of render groups.
+    std::vector<std::byte> bad_group_count = encoded;
+    bad_group_count[11] = std::byte{0x7f};
+    EXPECT_THAT(DecodePartitionedMesh(bad_group_count),
+                StatusIs(absl::StatusCode::kInvalidArgument,
+                         HasSubstr("truncated")));
+  }
+  {
+    // The spatial index is the last thing in the encoded data, and the
+    // triangle index of its last element is in its last four bytes.
+    std::vector<std::byte> bad_spatial_index = encoded;
+    bad_spatial_index[bad_spatial_index.size() - 1] = std::byte{0x7f};
+    EXPECT_THAT(DecodePartitionedMesh(bad_spatial_index),
+                StatusIs(absl::StatusCode::kInvalidArgument));
+  }
+}
+
+}  // namespace
+}  // namespace ink
@@ -0,0 +1,523 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ink/storage/stroke_input_batch_codec.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "absl/base/casts.h"
+#include "absl/container/inlined_vector.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/strings/substitute.h"
+#include "absl/types/span.h"
+#include "ink/geometry/angle.h"
+#include "ink/strokes/input/stroke_input.h"
+#include "ink/strokes/input/stroke_input_batch.h"
+#include "ink/types/physical_distance.h"
+
+namespace ink {
+namespace {
+
+// Encoded data layout:
+//   magic (the 4 bytes of `kMagic`)
+//   version (unsigned varint)
+//   tool type (1 byte)
+//   format flags (1 byte, a bitwise-or of `FormatFlag`s)
+//   stroke unit length in centimeters (float), only if
+//     `kHasStrokeUnitLength`
+//   position step (float)
+//   elapsed time step in seconds (float)
+//   pressure step (float), only if `kHasPressure`
+//   tilt step in radians (float), only if `kHasTilt`
+//   orientation step in radians (float), only if `kHasOrientation`
+//   number of inputs (unsigned varint)
+//   for each input, for each stored value (x, y, elapsed time, and then
+//     pressure, tilt, and orientation if present): the difference between
+//     the quantized value and that of the previous input (or zero, for the
+//     first input), as a zigzag-encoded varint
+//
+// Floats are stored as the 4 bytes of their bit representation, least
+// significant byte first. Any change to this layout must increment
+// `kVersion`.
+
+constexpr char kMagic[4] = {'I', 'N', 'K', 'I'};
+constexpr uint64_t kVersion = 1;
+
+enum FormatFlag : uint8_t {
+  kHasPressure = 1 << 0,
+  kHasTilt = 1 << 1,
+  kHasOrientation = 1 << 2,
+  kHasStrokeUnitLength = 1 << 3,
+};
+constexpr uint8_t kAllFormatFlags =
+    kHasPressure | kHasTilt | kHasOrientation | kHasStrokeUnitLength;
+
+// Quantized values must have a magnitude less than 2^23, so that converting
+// them to and from `float` is exact (see `Dequantize`).
+constexpr int64_t kMaxQuantizedMagnitude = (int64_t{1} << 23) - 1;
+
+// The maximum number of values stored for each input.
+constexpr int kMaxValuesPerInput = 6;
+
+// The number of leading values for each input (position and elapsed time)
+// that must not all repeat from one input to the next.
+constexpr int kPositionAndTimeValueCount = 3;
+
+// Index of the elapsed time among the values stored for each input.
+constexpr int kElapsedTimeIndex = 2;
+
+int64_t Quantize(float value, float step) {
+  // Clamp before converting to an integer, to avoid undefined behavior for huge
+  // values; anything this far out of range is rejected or clamped anyway.
+  constexpr double kLimit = 2.0 * kMaxQuantizedMagnitude;
+  return static_cast<int64_t>(std::clamp(
+      std::round(static_cast<double>(value) / step), -kLimit, kLimit));
+}
+
+// For |`quantized`| <= `kMaxQuantizedMagnitude`, the product below has a
+// relative error of at most 2^-24 after rounding to `float`, which is less than
+// half a step, so quantizing the result returns `quantized` again.
+float Dequantize(int64_t quantized, float step) {
+  return static_cast<float>(static_cast<double>(quantized) * step);
+}
+
+// How one of the values stored for each input is quantized.
+struct Channel {
+  float step;
+  // The range of valid quantized values, inclusive.
+  int64_t min_quantized;
+  int64_t max_quantized;
+  // True if out-of-range values should be clamped to the valid range when
+  // encoding. This is only used for properties with a bounded valid range,
+  // where rounding can take an in-range value just out of range; other values
+  // are reported as errors.
+  bool clamp;
+};
+
+using ChannelArray = absl::InlinedVector<Channel, kMaxValuesPerInput>;
+
+absl::Status ValidateStep(float step, absl::string_view name) {
+  if (!std::isfinite(step) || step <= 0) {
+    return absl::InvalidArgumentError(absl::Substitute(
+        "`$0` must be finite and strictly positive. Got: $1", name, step));
+  }
+  return absl::OkStatus();
+}
+
+absl::StatusOr<Channel> MakeUnboundedChannel(float step, bool allow_negative,
+                                             absl::string_view name) {
+  if (absl::Status status = ValidateStep(step, name); !status.ok()) {
+    return status;
+  }
+  return Channel{.step = step,
+                 .min_quantized = allow_negative ? -kMaxQuantizedMagnitude : 0,
+                 .max_quantized = kMaxQuantizedMagnitude,
+                 .clamp = false};
+}
+
+// Returns the channel for a property whose valid range is [0, `max_value`].
+absl::StatusOr<Channel> MakeBoundedChannel(float step, float max_value,
+                                           absl::string_view name) {
+  if (absl::Status status = ValidateStep(step, name); !status.ok()) {
+    return status;
+  }
+  double max_quantized = std::floor(static_cast<double>(max_value) / step);
+  if (max_quantized > kMaxQuantizedMagnitude) {
+    return absl::InvalidArgumentError(absl::Substitute(
+        "`$0` is too small for the range of the property. Got: $1", name,
+        step));
+  }
+  Channel channel = {.step = step,
+                     .min_quantized = 0,
+                     .max_quantized = static_cast<int64_t>(max_quantized),
+                     .clamp = true};
+  // Make sure that the largest quantized value doesn't dequantize to a value
+  // that is (just) out of range.
+  while (channel.max_quantized > 0 &&
+         Dequantize(channel.max_quantized, step) > max_value) {
+    --channel.max_quantized;
+  }
+  return channel;
+}
+
+// The steps of each quantized property, as stored in the encoded data.
+struct Steps {
+  float position;
+  float elapsed_time;
+  std::optional<float> pressure;
+  std::optional<float> tilt;
+  std::optional<float> orientation;
+};
+
+// Returns the channels for the values stored for each input, in the same order
+// as they are stored in `StrokeInputBatch`.
+absl::StatusOr<ChannelArray> MakeChannels(const Steps& steps) {
+  ChannelArray channels;
+  absl::StatusOr<Channel> position =
+      MakeUnboundedChannel(steps.position, /*allow_negative=*/true,
+                           "StrokeInputBatchQuantization::position_step");
+  if (!position.ok()) return position.status();
+  channels.push_back(*position);
+  channels.push_back(*position);
+
+  absl::StatusOr<Channel> elapsed_time =
+      MakeUnboundedChannel(steps.elapsed_time, /*allow_negative=*/false,
+                           "StrokeInputBatchQuantization::elapsed_time_step");
+  if (!elapsed_time.ok()) return elapsed_time.status();
+  channels.push_back(*elapsed_time);
+
+  struct BoundedProperty {
+    std::optional<float> step;
+    float max_value;
+    absl::string_view name;
+  };
+  for (const BoundedProperty& property : {
+           BoundedProperty{steps.pressure, 1,
+                           "StrokeInputBatchQuantization::pressure_step"},
+           BoundedProperty{steps.tilt, kQuarterTurn.ValueInRadians(),
+                           "StrokeInputBatchQuantization::tilt_step"},
+           BoundedProperty{steps.orientation, kFullTurn.ValueInRadians(),
+                           "StrokeInputBatchQuantization::orientation_step"},
+       }) {
+    if (!property.step.has_value()) continue;
+    absl::StatusOr<Channel> channel =
+        MakeBoundedChannel(*property.step, property.max_value, property.name);
+    if (!channel.ok()) return channel.status();
+    channels.push_back(*channel);
+  }
+  return channels;
+}
+
+uint64_t ZigzagEncode(int64_t value) {
+  return (static_cast<uint64_t>(value) << 1) ^
+         static_cast<uint64_t>(value >> 63);
+}
+
+int64_t ZigzagDecode(uint64_t value) {
+  return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+class Writer {
+ public:
+  explicit Writer(std::vector<std::byte>& output) : output_(output) {}
+
+  void WriteByte(uint8_t value) { output_.push_back(std::byte{value}); }
+
+  void WriteVarint(uint64_t value) {
+    while (value >= 0x80) {
+      WriteByte(static_cast<uint8_t>(value) | 0x80);
+      value >>= 7;
+    }
+    WriteByte(static_cast<uint8_t>(value));
+  }
+
+  void WriteSignedVarint(int64_t value) { WriteVarint(ZigzagEncode(value)); }
+
+  void WriteFloat(float value) {
+    uint32_t bits = absl::bit_cast<uint32_t>(value);
+    for (int i = 0; i < 4; ++i) {
+      WriteByte(static_cast<uint8_t>(bits >> (8 * i)));
+    }
+  }
+
+ private:
+  std::vector<std::byte>& output_;
+};
+
+// Reads values from encoded data. Each method returns false if the data is
+// truncated or malformed.
+class Reader {
+ public:
+  explicit Reader(absl::Span<const std::byte> data) : data_(data) {}
+
+  [[nodiscard]] bool ReadByte(uint8_t& value) {
+    if (offset_ == data_.size()) return false;
+    value = static_cast<uint8_t>(data_[offset_++]);
+    return true;
+  }
+
+  [[nodiscard]] bool ReadVarint(uint64_t& value) {
+    // Most deltas fit in a single byte.
+    if (offset_ < data_.size() &&
+        (static_cast<uint8_t>(data_[offset_]) & 0x80) == 0) {
+      value = static_cast<uint8_t>(data_[offset_++]);
+      return true;
+    }
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      uint8_t byte;
+      if (!ReadByte(byte)) return false;
+      // The tenth byte may only hold the single remaining bit.
+      if (shift == 63 && byte > 1) return false;
+      value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0) return true;
+    }
+    return false;
+  }
+
+  [[nodiscard]] bool ReadSignedVarint(int64_t& value) {
+    uint64_t encoded;
+    if (!ReadVarint(encoded)) return false;
+    value = ZigzagDecode(encoded);
+    return true;
+  }
+
+  [[nodiscard]] bool ReadFloat(float& value) {
+    uint32_t bits = 0;
+    for (int i = 0; i < 4; ++i) {
+      uint8_t byte;
+      if (!ReadByte(byte)) return false;
+      bits |= static_cast<uint32_t>(byte) << (8 * i);
+    }
+    value = absl::bit_cast<float>(bits);
+    return true;
+  }
+
+  [[nodiscard]] bool ReadMagic() {
+    if (data_.size() - offset_ < sizeof(kMagic) ||
+        std::memcmp(data_.data() + offset_, kMagic, sizeof(kMagic)) != 0) {
+      return false;
+    }
+    offset_ += sizeof(kMagic);
+    return true;
+  }
+
+  size_t RemainingSize() const { return data_.size() - offset_; }
+
+ private:
+  absl::Span<const std::byte> data_;
+  size_t offset_ = 0;
+};
+
+absl::Status MalformedError() {
+  return absl::InvalidArgumentError(
+      "Encoded StrokeInputBatch is truncated or malformed");
+}
+
+}  // namespace
+
+absl::StatusOr<std::vector<std::byte>> EncodeStrokeInputBatch(
+    const StrokeInputBatch& batch,
+    const StrokeInputBatchQuantization& quantization) {
+  Steps steps = {
+      .position = quantization.position_step,
+      .elapsed_time = quantization.elapsed_time_step.ToSeconds(),
+  };
+  if (batch.HasPressure()) steps.pressure = quantization.pressure_step;
+  if (batch.HasTilt()) steps.tilt = quantization.tilt_step.ValueInRadians();
+  if (batch.HasOrientation()) {
+    steps.orientation = quantization.orientation_step.ValueInRadians();
+  }
+  absl::StatusOr<ChannelArray> channels = MakeChannels(steps);
+  if (!channels.ok()) return channels.status();
+  size_t n_channels = channels->size();
+
+  // Quantize all of the inputs first, so that we know how many will remain
+  // after omitting any that become duplicates.
+  std::vector<int64_t> quantized;
+  quantized.reserve(batch.Size() * n_channels);
+  size_t n_inputs = 0;
+  for (const StrokeInput& input : batch) {
+    float values[kMaxValuesPerInput] = {input.position.x, input.position.y,
+                                        input.elapsed_time.ToSeconds()};
+    int n_values = kPositionAndTimeValueCount;
+    if (batch.HasPressure()) values[n_values++] = input.pressure;
+    if (batch.HasTilt()) values[n_values++] = input.tilt.ValueInRadians();
+    if (batch.HasOrientation()) {
+      values[n_values++] = input.orientation.ValueInRadians();
+    }
+
+    size_t start = quantized.size();
+    for (size_t i = 0; i < n_channels; ++i) {
+      const Channel& channel = (*channels)[i];
+      int64_t value = Quantize(values[i], channel.step);
+      if (channel.clamp) {
+        value = std::clamp(value, channel.min_quantized, channel.max_quantized);
+      } else if (value < channel.min_quantized ||
+                 value > channel.max_quantized) {
+        return absl::InvalidArgumentError(absl::Substitute(
+            "Input $0 has a value ($1) that is out of range for the "
+            "quantization step ($2)",
+            n_inputs, values[i], channel.step));
+      }
+      quantized.push_back(value);
+    }
+
+    if (n_inputs > 0 &&
+        std::equal(quantized.begin() + start,
+                   quantized.begin() + start + kPositionAndTimeValueCount,
+                   quantized.begin() + start - n_channels)) {
+      quantized.resize(start);
+      continue;
+    }
+    ++n_inputs;
+  }
+
+  std::vector<std::byte> encoded;
+  // Most deltas take one or two bytes.
+  encoded.reserve(32 + quantized.size() * 2);
+  Writer writer(encoded);
+  for (char c : kMagic) writer.WriteByte(static_cast<uint8_t>(c));
+  writer.WriteVarint(kVersion);
+  writer.WriteByte(static_cast<uint8_t>(batch.GetToolType()));
+  uint8_t flags = 0;
+  if (batch.HasPressure()) flags |= kHasPressure;
+  if (batch.HasTilt()) flags |= kHasTilt;
+  if (batch.HasOrientation()) flags |= kHasOrientation;
+  if (batch.HasStrokeUnitLength()) flags |= kHasStrokeUnitLength;
+  writer.WriteByte(flags);
+  if (batch.HasStrokeUnitLength()) {
+    writer.WriteFloat(batch.GetStrokeUnitLength()->ToCentimeters());
+  }
+  writer.WriteFloat(steps.position);
+  writer.WriteFloat(steps.elapsed_time);
+  if (steps.pressure.has_value()) writer.WriteFloat(*steps.pressure);
+  if (steps.tilt.has_value()) writer.WriteFloat(*steps.tilt);
+  if (steps.orientation.has_value()) writer.WriteFloat(*steps.orientation);
+  writer.WriteVarint(n_inputs);
+
+  for (size_t i = 0; i < quantized.size(); ++i) {
+    int64_t previous = i < n_channels ? 0 : quantized[i - n_channels];
+    writer.WriteSignedVarint(quantized[i] - previous);
+  }
+  return encoded;
+}
+
+absl::StatusOr<StrokeInputBatch> DecodeStrokeInputBatch(
+    absl::Span<const std::byte> encoded) {
+  Reader reader(encoded);
+  if (!reader.ReadMagic()) {
+    return absl::InvalidArgumentError(
+        "Encoded data is not a StrokeInputBatch");
+  }
+  uint64_t version;
+  if (!reader.ReadVarint(version)) return MalformedError();
+  if (version != kVersion) {
+    return absl::InvalidArgumentError(absl::Substitute(
+        "Unsupported StrokeInputBatch encoding version $0", version));
+  }
+
+  uint8_t tool_type;
+  uint8_t flags;
+  if (!reader.ReadByte(tool_type) || !reader.ReadByte(flags)) {
+    return MalformedError();
+  }
+  if (tool_type > static_cast<uint8_t>(StrokeInput::ToolType::kStylus)) {
+    return absl::InvalidArgumentError(
+        absl::Substitute("Unrecognized tool type $0", tool_type));
+  }
+  if ((flags & ~kAllFormatFlags) != 0) {
+    return absl::InvalidArgumentError(
+        absl::Substitute("Unrecognized format flags $0", flags));
+  }
+
+  PhysicalDistance stroke_unit_length = StrokeInput::kNoStrokeUnitLength;
+  if (flags & kHasStrokeUnitLength) {
+    float centimeters;
+    if (!reader.ReadFloat(centimeters)) return MalformedError();
+    if (!std::isfinite(centimeters) || centimeters <= 0) {
+      return absl::InvalidArgumentError(absl::Substitute(
+          "Stroke unit length must be finite and strictly positive. Got: $0",
+          centimeters));
+    }
+    stroke_unit_length = PhysicalDistance::Centimeters(centimeters);
+  }
+
+  Steps steps;
+  if (!reader.ReadFloat(steps.position) ||
+      !reader.ReadFloat(steps.elapsed_time)) {
+    return MalformedError();
+  }
+  for (auto [flag, step] :
+       {std::pair{kHasPressure, &steps.pressure},
+        std::pair{kHasTilt, &steps.tilt},
+        std::pair{kHasOrientation, &steps.orientation}}) {
+    if ((flags & flag) == 0) continue;
+    if (!reader.ReadFloat(step->emplace())) return MalformedError();
+  }
+  absl::StatusOr<ChannelArray> channels = MakeChannels(steps);
+  if (!channels.ok()) return channels.status();
+  size_t n_channels = channels->size();
+
+  uint64_t n_inputs;
+  if (!reader.ReadVarint(n_inputs)) return MalformedError();
+  // Each value takes at least one byte, which bounds the amount of memory we
+  // allocate below for malformed data.
+  if (n_inputs > reader.RemainingSize() / n_channels) return MalformedError();
+
+  std::vector<float> data(n_inputs * n_channels);
+  int64_t quantized[kMaxValuesPerInput] = {};
+  for (uint64_t input_index = 0; input_index < n_inputs; ++input_index) {
+    bool position_and_time_repeated = input_index > 0;
+    for (size_t i = 0; i < n_channels; ++i) {
+      const Channel& channel = (*channels)[i];
+      int64_t delta;
+      if (!reader.ReadSignedVarint(delta)) return MalformedError();
+      // The difference between two valid values is at most twice the maximum
+      // magnitude; checking this first also prevents overflow below.
+      if (delta < -2 * kMaxQuantizedMagnitude ||
+          delta > 2 * kMaxQuantizedMagnitude) {
+        return MalformedError();
+      }
+      int64_t value = quantized[i] + delta;
+      if (value < channel.min_quantized || value > channel.max_quantized) {
+        return absl::InvalidArgumentError(absl::Substitute(
+            "Input $0 has an out-of-range quantized value $1", input_index,
+            value));
+      }
+      if (i == kElapsedTimeIndex && delta < 0) {
+        return absl::InvalidArgumentError(absl::Substitute(
+            "Input $0 has decreasing elapsed time", input_index));
+      }
+      if (i < kPositionAndTimeValueCount && delta != 0) {
+        position_and_time_repeated = false;
+      }
+      quantized[i] = value;
+      data[input_index * n_channels + i] = Dequantize(value, channel.step);
+    }
+    if (position_and_time_repeated) {
+      return absl::InvalidArgumentError(absl::Substitute(
+          "Input $0 has the same position and elapsed time as the previous "
+          "input",
+          input_index));
+    }
+  }
+  if (reader.RemainingSize() != 0) {
+    return absl::InvalidArgumentError(absl::Substitute(
+        "Encoded data has $0 unexpected trailing bytes",
+        reader.RemainingSize()));
+  }
+
+  StrokeInputBatch batch;
+  if (n_inputs == 0) return batch;
+  batch.data_.Emplace(std::move(data));
+  batch.size_ = n_inputs;
+  batch.tool_type_ = static_cast<StrokeInput::ToolType>(tool_type);
+  batch.stroke_unit_length_ = stroke_unit_length;
+  batch.has_pressure_ = steps.pressure.has_value();
+  batch.has_tilt_ = steps.tilt.has_value();
+  batch.has_orientation_ = steps.orientation.has_value();
+  return batch;
+}
+
+}  // namespace ink
@@ -0,0 +1,78 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef INK_STORAGE_STROKE_INPUT_BATCH_CODEC_H_
+#define INK_STORAGE_STROKE_INPUT_BATCH_CODEC_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "ink/geometry/angle.h"
+#include "ink/strokes/input/stroke_input_batch.h"
+#include "ink/types/duration.h"
+
+namespace ink {
+
+// The precision with which each property of a `StrokeInput` is stored by
+// `EncodeStrokeInputBatch`. Each value is rounded to the nearest multiple of
+// the corresponding step; all steps must be finite and strictly positive.
+//
+// Because values are stored as integer multiples of the step, the magnitude of
+// each position and elapsed time divided by its step must be less than 2^23, so
+// that the decoded `float` values are exact. For example, with the default
+// `position_step`, positions must be within (-131072, 131072).
+struct StrokeInputBatchQuantization {
+  // The step for `StrokeInput::position` (both x and y), in stroke units.
+  float position_step = 1.0f / 64;
+  Duration32 elapsed_time_step = Duration32::Seconds(1.0f / 8192);
+  float pressure_step = 1.0f / 1024;
+  Angle tilt_step = kQuarterTurn / 1024;
+  Angle orientation_step = kFullTurn / 4096;
+};
+
+// Encodes `batch` into a compact, versioned, byte-order-independent format, in
+// which each property of each input is quantized according to `quantization`
+// and stored as the variable-length, zigzag-encoded difference from the
+// previous input. Returns an error if any step in `quantization` is not finite
+// and strictly positive, or if any position or elapsed time is out of range for
+// its step (see `StrokeInputBatchQuantization`).
+//
+// The quantization steps are stored with the encoded data. Decoding the result
+// and encoding it again with the same `quantization` produces exactly the same
+// bytes, and `DecodeStrokeInputBatch` always produces bit-identical inputs from
+// the same bytes.
+//
+// Quantization can cause two consecutive inputs to have the same position and
+// elapsed time, which `StrokeInputBatch` does not allow; when this happens, the
+// later of the two inputs is omitted from the encoded data.
+absl::StatusOr<std::vector<std::byte>> EncodeStrokeInputBatch(
+    const StrokeInputBatch& batch,
+    const StrokeInputBatchQuantization& quantization = {});
+
+// Decodes a `StrokeInputBatch` that was encoded by `EncodeStrokeInputBatch`.
+// Returns an error if `encoded` is malformed, was encoded by an unsupported
+// version of the format, or would decode to inputs that are not valid for a
+// `StrokeInputBatch`.
+//
+// The inputs are validated as they are decoded, and the batch is then
+// constructed directly, which is considerably faster than appending each
+// decoded input to a `StrokeInputBatch`.
+absl::StatusOr<StrokeInputBatch> DecodeStrokeInputBatch(
+    absl::Span<const std::byte> encoded);
+
+}  // namespace ink
+
+#endif  // INK_STORAGE_STROKE_INPUT_BATCH_CODEC_H_
@@ -0,0 +1,128 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstddef>
+#include <vector>
+
+#include "absl/log/absl_check.h"
+#include "absl/status/statusor.h"
+#include "benchmark/benchmark.h"
+#include "ink/geometry/rect.h"
+#include "ink/storage/stroke_input_batch_codec.h"
+#include "ink/strokes/input/recorded_test_inputs.h"
+#include "ink/strokes/input/stroke_input.h"
+#include "ink/strokes/input/stroke_input_batch.h"
+
+namespace ink {
+namespace {
+
+std::vector<StrokeInputBatch> MakeInputBatches() {
+  Rect bounds = Rect::FromTwoPoints({0, 0}, {1000, 1000});
+  return {
+      MakeCompleteStraightLineInputs(bounds),
+      MakeCompleteSpringShapeInputs(bounds),
+  };
+}
+
+size_t TotalInputCount(const std::vector<StrokeInputBatch>& batches) {
+  size_t count = 0;
+  for (const StrokeInputBatch& batch : batches) count += batch.Size();
+  return count;
+}
+
+// Returns the number of bytes used to store the inputs as raw floats.
+size_t RawSize(const StrokeInputBatch& batch) {
+  size_t floats_per_input = 3 + batch.HasPressure() + batch.HasTilt() +
+                            batch.HasOrientation();
+  return batch.Size() * floats_per_input * sizeof(float);
+}
+
+std::vector<std::vector<std::byte>> EncodeAll(
+    const std::vector<StrokeInputBatch>& batches) {
+  std::vector<std::vector<std::byte>> encoded;
+  for (const StrokeInputBatch& batch : batches) {
+    absl::StatusOr<std::vector<std::byte>> bytes =
+        EncodeStrokeInputBatch(batch);
+    ABSL_CHECK_OK(bytes);
+    encoded.push_back(*bytes);
+  }
+  return encoded;
+}
+
+void SetCompressionCounters(benchmark::State& state,
+                            const std::vector<StrokeInputBatch>& batches) {
+  size_t raw_size = 0;
+  size_t encoded_size = 0;
+  for (const StrokeInputBatch& batch : batches) raw_size += RawSize(batch);
+  for (const std::vector<std::byte>& bytes : EncodeAll(batches)) {
+    encoded_size += bytes.size();
+  }
+  state.counters["compression_ratio"] =
+      static_cast<double>(raw_size) / encoded_size;
+  state.counters["inputs_per_second"] = benchmark::Counter(
+      state.iterations() * TotalInputCount(batches),
+      benchmark::Counter::kIsRate);
+}
+
+void BM_EncodeStrokeInputBatch(benchmark::State& state) {
+  std::vector<StrokeInputBatch> batches = MakeInputBatches();
+  for (auto s : state) {
+    for (const StrokeInputBatch& batch : batches) {
+      absl::StatusOr<std::vector<std::byte>> encoded =
+          EncodeStrokeInputBatch(batch);
+      benchmark::DoNotOptimize(encoded);
+    }
+  }
+  SetCompressionCounters(state, batches);
+}
+BENCHMARK(BM_EncodeStrokeInputBatch);
+
+void BM_DecodeStrokeInputBatch(benchmark::State& state) {
+  std::vector<StrokeInputBatch> batches = MakeInputBatches();
+  std::vector<std::vector<std::byte>> encoded = EncodeAll(batches);
+  for (auto s : state) {
+    for (const std::vector<std::byte>& bytes : encoded) {
+      absl::StatusOr<StrokeInputBatch> decoded = DecodeStrokeInputBatch(bytes);
+      benchmark::DoNotOptimize(decoded);
+    }
+  }
+  SetCompressionCounters(state, batches);
+}
+BENCHMARK(BM_DecodeStrokeInputBatch);
+
+// For comparison with `BM_DecodeStrokeInputBatch`: the cost of constructing the
+// same batches by validating and appending each input.
+void BM_AppendStrokeInputs(benchmark::State& state) {
+  std::vector<StrokeInputBatch> batches = MakeInputBatches();
+  std::vector<std::vector<StrokeInput>> inputs;
+  for (const StrokeInputBatch& batch : batches) {
+    inputs.emplace_back(batch.begin(), batch.end());
+  }
+  for (auto s : state) {
+    for (const std::vector<StrokeInput>& batch_inputs : inputs) {
+      StrokeInputBatch batch;
+      for (const StrokeInput& input : batch_inputs) {
+        ABSL_CHECK_OK(batch.Append(input));
+      }
+      benchmark::DoNotOptimize(batch);
+    }
+  }
+  state.counters["inputs_per_second"] = benchmark::Counter(
+      state.iterations() * TotalInputCount(batches),
+      benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_AppendStrokeInputs);
+
+}  // namespace
+}  // namespace ink
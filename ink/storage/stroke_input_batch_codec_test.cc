@@ -0,0 +1,331 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ink/storage/stroke_input_batch_codec.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/log/absl_check.h"
+#include "absl/status/status.h"
+#include "absl/status/status_matchers.h"
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "ink/geometry/angle.h"
+#include "ink/geometry/rect.h"
+#include "ink/strokes/input/recorded_test_inputs.h"
+#include "ink/strokes/input/stroke_input.h"
+#include "ink/strokes/input/stroke_input_batch.h"
+#include "ink/strokes/input/type_matchers.h"
+#include "ink/types/duration.h"
+#include "ink/types/physical_distance.h"
+
+namespace ink {
+namespace {
+
+using ::absl_testing::IsOk;
+using ::absl_testing::StatusIs;
+using ::testing::FloatNear;
+using ::testing::HasSubstr;
+using ::testing::Le;
+
+StrokeInputBatch MakeBatch(absl::Span<const StrokeInput> inputs) {
+  absl::StatusOr<StrokeInputBatch> batch = StrokeInputBatch::Create(inputs);
+  ABSL_CHECK_OK(batch);
+  return *batch;
+}
+
+std::vector<std::byte> Encode(const StrokeInputBatch& batch,
+                              const StrokeInputBatchQuantization& quantization =
+                                  {}) {
+  absl::StatusOr<std::vector<std::byte>> encoded =
+      EncodeStrokeInputBatch(batch, quantization);
+  ABSL_CHECK_OK(encoded);
+  return *encoded;
+}
+
+TEST(StrokeInputBatchCodecTest, RoundTripIsExactForValuesOnTheGrid) {
+  StrokeInputBatchQuantization quantization = {
+      .position_step = 0.25,
+      .elapsed_time_step = Duration32::Seconds(0.125),
+      .pressure_step = 0.5,
+      .tilt_step = kQuarterTurn / 2,
+      .orientation_step = kHalfTurn / 2,
+  };
+  StrokeInputBatch batch = MakeBatch({
+      {.tool_type = StrokeInput::ToolType::kStylus,
+       .position = {-10.25, 3.5},
+       .elapsed_time = Duration32::Seconds(0),
+       .stroke_unit_length = PhysicalDistance::Centimeters(0.1),
+       .pressure = 0,
+       .tilt = kQuarterTurn,
+       .orientation = kFullTurn * 0.75},
+      {.tool_type = StrokeInput::ToolType::kStylus,
+       .position = {-9, 1000.75},
+       .elapsed_time = Duration32::Seconds(0.125),
+       .stroke_unit_length = PhysicalDistance::Centimeters(0.1),
+       .pressure = 1,
+       .tilt = kQuarterTurn / 2,
+       .orientation = Angle()},
+      {.tool_type = StrokeInput::ToolType::kStylus,
+       .position = {-9, 1000.75},
+       .elapsed_time = Duration32::Seconds(2.5),
+       .stroke_unit_length = PhysicalDistance::Centimeters(0.1),
+       .pressure = 0.5,
+       .tilt = Angle(),
+       .orientation = kHalfTurn},
+  });
+
+  std::vector<std::byte> encoded = Encode(batch, quantization);
+  absl::StatusOr<StrokeInputBatch> decoded = DecodeStrokeInputBatch(encoded);
+  ASSERT_THAT(decoded, IsOk());
+  EXPECT_THAT(*decoded, StrokeInputBatchEq(batch));
+  EXPECT_EQ(decoded->GetToolType(), StrokeInput::ToolType::kStylus);
+  EXPECT_EQ(decoded->GetStrokeUnitLength(), PhysicalDistance::Centimeters(0.1));
+}
+
+TEST(StrokeInputBatchCodecTest, RoundTripWithoutOptionalProperties) {
+  StrokeInputBatch batch = MakeBatch({
+      {.tool_type = StrokeInput::ToolType::kMouse,
+       .position = {1, 2},
+       .elapsed_time = Duration32::Seconds(0)},
+      {.tool_type = StrokeInput::ToolType::kMouse,
+       .position = {3, 4},
+       .elapsed_time = Duration32::Seconds(0.5)},
+  });
+
+  absl::StatusOr<StrokeInputBatch> decoded =
+      DecodeStrokeInputBatch(Encode(batch));
+  ASSERT_THAT(decoded, IsOk());
+  EXPECT_THAT(*decoded, StrokeInputBatchEq(batch));
+  EXPECT_FALSE(decoded->HasStrokeUnitLength());
+  EXPECT_FALSE(decoded->HasPressure());
+  EXPECT_FALSE(decoded->HasTilt());
+  EXPECT_FALSE(decoded->HasOrientation());
+}
+
+TEST(StrokeInputBatchCodecTest, EmptyBatchRoundTrip) {
+  absl::StatusOr<StrokeInputBatch> decoded =
+      DecodeStrokeInputBatch(Encode(StrokeInputBatch()));
+  ASSERT_THAT(decoded, IsOk());
+  EXPECT_TRUE(decoded->IsEmpty());
+}
+
+TEST(StrokeInputBatchCodecTest, RecordedInputsRoundTripWithinPrecision) {
+  StrokeInputBatchQuantization quantization;
+  for (const StrokeInputBatch& batch :
+       {MakeCompleteStraightLineInputs(Rect::FromTwoPoints({0, 0}, {500, 300})),
+        MakeCompleteSpringShapeInputs(
+            Rect::FromTwoPoints({-20, -20}, {400, 600}))}) {
+    std::vector<std::byte> encoded = Encode(batch, quantization);
+    size_t floats_per_input = 3 + batch.HasPressure() + batch.HasTilt() +
+                              batch.HasOrientation();
+    EXPECT_LT(encoded.size(), batch.Size() * floats_per_input * sizeof(float) /
+                                  2);
+
+    absl::StatusOr<StrokeInputBatch> decoded = DecodeStrokeInputBatch(encoded);
+    ASSERT_THAT(decoded, IsOk());
+    ASSERT_EQ(decoded->Size(), batch.Size());
+    EXPECT_EQ(decoded->HasPressure(), batch.HasPressure());
+    EXPECT_EQ(decoded->HasTilt(), batch.HasTilt());
+    EXPECT_EQ(decoded->HasOrientation(), batch.HasOrientation());
+    for (size_t i = 0; i < batch.Size(); ++i) {
+      StrokeInput expected = batch.Get(i);
+      StrokeInput actual = decoded->Get(i);
+      EXPECT_THAT(actual.position.x,
+                  FloatNear(expected.position.x,
+                            quantization.position_step / 2));
+      EXPECT_THAT(actual.position.y,
+                  FloatNear(expected.position.y,
+                            quantization.position_step / 2));
+      EXPECT_THAT(actual.elapsed_time.ToSeconds(),
+                  FloatNear(expected.elapsed_time.ToSeconds(),
+                            quantization.elapsed_time_step.ToSeconds() / 2));
+      EXPECT_THAT(actual.pressure, FloatNear(expected.pressure,
+                                             quantization.pressure_step / 2));
+      EXPECT_THAT(actual.tilt.ValueInRadians(),
+                  FloatNear(expected.tilt.ValueInRadians(),
+                            quantization.tilt_step.ValueInRadians() / 2));
+      EXPECT_THAT(
+          actual.orientation.ValueInRadians(),
+          FloatNear(expected.orientation.ValueInRadians(),
+                    quantization.orientation_step.ValueInRadians() / 2));
+    }
+
+    // Encoding the decoded batch again must reproduce the same bytes.
+    EXPECT_EQ(Encode(*decoded, quantization), encoded);
+  }
+}
+
+TEST(StrokeInputBatchCodecTest, OmitsInputsThatBecomeDuplicates) {
+  StrokeInputBatch batch = MakeBatch({
+      {.position = {1, 1}, .elapsed_time = Duration32::Seconds(0)},
+      {.position = {1.001, 1}, .elapsed_time = Duration32::Seconds(0)},
+      {.position = {1, 1}, .elapsed_time = Duration32::Seconds(0.00001)},
+      {.position = {2, 1}, .elapsed_time = Duration32::Seconds(0.00001)},
+  });
+
+  absl::StatusOr<StrokeInputBatch> decoded =
+      DecodeStrokeInputBatch(Encode(batch));
+  ASSERT_THAT(decoded, IsOk());
+  EXPECT_THAT(*decoded, StrokeInputBatchIsArray({
+                            {.position = {1, 1},
+                             .elapsed_time = Duration32::Seconds(0)},
+                            {.position = {2, 1},
+                             .elapsed_time = Duration32::Seconds(0)},
+                        }));
+}
+
+TEST(StrokeInputBatchCodecTest, BoundedPropertiesStayInRange) {
+  // With these steps, rounding the maximum values to the nearest step would
+  // take them out of range.
+  StrokeInputBatchQuantization quantization = {
+      .pressure_step = 0.4,
+      .tilt_step = kQuarterTurn * 0.4,
+      .orientation_step = kFullTurn * 0.4,
+  };
+  StrokeInputBatch batch = MakeBatch({
+      {.position = {0, 0},
+       .elapsed_time = Duration32::Zero(),
+       .pressure = 1,
+       .tilt = kQuarterTurn,
+       .orientation = kFullTurn},
+  });
+
+  absl::StatusOr<StrokeInputBatch> decoded =
+      DecodeStrokeInputBatch(Encode(batch, quantization));
+  ASSERT_THAT(decoded, IsOk());
+  StrokeInput input = decoded->Get(0);
+  EXPECT_THAT(input.pressure, Le(1));
+  EXPECT_LE(input.tilt, kQuarterTurn);
+  EXPECT_LE(input.orientation, kFullTurn);
+}
+
+TEST(StrokeInputBatchCodecTest, EncodeErrors) {
+  StrokeInputBatch batch = MakeBatch({
+      {.position = {0, 0}, .elapsed_time = Duration32::Zero(), .pressure = 1},
+  });
+
+  EXPECT_THAT(EncodeStrokeInputBatch(batch, {.position_step = 0}),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("position_step")));
+  EXPECT_THAT(EncodeStrokeInputBatch(
+                  batch, {.elapsed_time_step = Duration32::Infinite()}),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("elapsed_time_step")));
+  EXPECT_THAT(EncodeStrokeInputBatch(batch, {.pressure_step = -1}),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("pressure_step")));
+  EXPECT_THAT(EncodeStrokeInputBatch(batch, {.pressure_step = 1e-9}),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("too small")));
+  // The step of a property that the batch doesn't have is ignored.
+  EXPECT_THAT(EncodeStrokeInputBatch(batch, {.tilt_step = Angle()}), IsOk());
+
+  StrokeInputBatch far_away = MakeBatch({
+      {.position = {1e6, 0}, .elapsed_time = Duration32::Zero()},
+  });
+  EXPECT_THAT(EncodeStrokeInputBatch(far_away),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("out of range")));
+  EXPECT_THAT(EncodeStrokeInputBatch(far_away, {.position_step = 1}), IsOk());
+}
+
+TEST(StrokeInputBatchCodecTest, DecodeErrors) {
+  std::vector<std::byte> encoded = Encode(
+      MakeCompleteSpringShapeInputs(Rect::FromTwoPoints({0, 0}, {100, 100})));
+
+  EXPECT_THAT(DecodeStrokeInputBatch({}),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("not a StrokeInputBatch")));
+  for (size_t size = 4; size < encoded.size(); ++size) {
+    EXPECT_THAT(
+        DecodeStrokeInputBatch(absl::MakeConstSpan(encoded).first(size)),
+        StatusIs(absl::StatusCode::kInvalidArgument, HasSubstr("truncated")))
+        << "with size " << size;
+  }
+  {
+    std::vector<std::byte> trailing = encoded;
+    trailing.push_back(std::byte{0});
+    EXPECT_THAT(DecodeStrokeInputBatch(trailing),
+                StatusIs(absl::StatusCode::kInvalidArgument,
+                         HasSubstr("trailing bytes")));
+  }
+  {
+    std::vector<std::byte> wrong_version = encoded;
+    wrong_version[4] = std::byte{2};
+    EXPECT_THAT(DecodeStrokeInputBatch(wrong_version),
+                StatusIs(absl::StatusCode::kInvalidArgument,
+                         HasSubstr("version 2")));
+  }
+  {
+    std::vector<std::byte> bad_tool_type = encoded;
+    bad_tool_type[5] = std::byte{9};
+    EXPECT_THAT(DecodeStrokeInputBatch(bad_tool_type),
+                StatusIs(absl::StatusCode::kInvalidArgument,
+                         HasSubstr("tool type")));
+  }
+  {
+    std::vector<std::byte> bad_flags = encoded;
+    bad_flags[6] |= std::byte{0x80};
+    EXPECT_THAT(DecodeStrokeInputBatch(bad_flags),
+                StatusIs(absl::StatusCode::kInvalidArgument,
+                         HasSubstr("format flags")));
+  }
+}
+
+TEST(StrokeInputBatchCodecTest, DecodeRejectsInvalidInputs) {
+  StrokeInputBatch batch = MakeBatch({
+      {.position = {0, 0}, .elapsed_time = Duration32::Seconds(2)},
+      {.position = {1, 0}, .elapsed_time = Duration32::Seconds(3)},
+  });
+  std::vector<std::byte> encoded =
+      Encode(batch, {.position_step = 1,
+                     .elapsed_time_step = Duration32::Seconds(1)});
+  // With no optional properties and these steps, each delta takes one byte,
+  // and the last three bytes are the x, y, and elapsed time deltas of the
+  // second input.
+  ASSERT_EQ(encoded.size(), 22);
+
+  {
+    std::vector<std::byte> duplicate = encoded;
+    duplicate[19] = std::byte{0};
+    duplicate[21] = std::byte{0};
+    EXPECT_THAT(DecodeStrokeInputBatch(duplicate),
+                StatusIs(absl::StatusCode::kInvalidArgument,
+                         HasSubstr("same position and elapsed time")));
+  }
+  {
+    // A delta of -1 zigzag-encodes as 1.
+    std::vector<std::byte> decreasing_time = encoded;
+    decreasing_time[21] = std::byte{1};
+    EXPECT_THAT(DecodeStrokeInputBatch(decreasing_time),
+                StatusIs(absl::StatusCode::kInvalidArgument,
+                         HasSubstr("decreasing elapsed time")));
+  }
+  {
+    // A delta of -3 takes the elapsed time below zero.
+    std::vector<std::byte> negative_time = encoded;
+    negative_time[21] = std::byte{5};
+    EXPECT_THAT(DecodeStrokeInputBatch(negative_time),
+                StatusIs(absl::StatusCode::kInvalidArgument,
+                         HasSubstr("out-of-range")));
+  }
+}
+
+}  // namespace
+}  // namespace ink
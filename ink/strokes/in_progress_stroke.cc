@@ -14,6 +14,8 @@
 
 #include "ink/strokes/in_progress_stroke.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cstdint>
 #include <optional>
 #include <vector>
@@ -45,6 +47,17 @@ using ::ink::stroke_input_internal::ValidateConsecutiveInputs;
 using ::ink::strokes_internal::StrokeShapeUpdate;
 using ::ink::strokes_internal::StrokeVertex;
 
+namespace {
+
+// Returns a new `InProgressStroke::MeshVersion::stroke_id`. IDs start at 1, so
+// that a value-initialized `MeshVersion` never matches a stroke.
+uint64_t NextStrokeId() {
+  static std::atomic<uint64_t> next_stroke_id = 1;
+  return next_stroke_id.fetch_add(1, std::memory_order_relaxed);
+}
+
+}  // namespace
+
 void InProgressStroke::Clear() {
   brush_.reset();
   queued_real_inputs_.Clear();
@@ -53,6 +66,11 @@ void InProgressStroke::Clear() {
   real_input_count_ = 0;
   current_elapsed_time_ = Duration32::Zero();
   updated_region_.Reset();
+  stroke_id_ = NextStrokeId();
+  update_count_ = 0;
+  for (std::vector<MeshChanges>& coat_changes : mesh_change_history_) {
+    coat_changes.clear();
+  }
   inputs_are_finished_ = true;
 }
 
@@ -68,6 +86,9 @@ void InProgressStroke::Start(const Brush& brush) {
   if (shape_builders_.size() < num_coats) {
     shape_builders_.resize(num_coats);
   }
+  if (mesh_change_history_.size() < num_coats) {
+    mesh_change_history_.resize(num_coats);
+  }
 
   for (uint32_t i = 0; i < num_coats; ++i) {
     shape_builders_[i].StartStroke(brush_->GetFamily().GetInputModel(),
@@ -155,15 +176,41 @@ absl::Status InProgressStroke::UpdateShape(Duration32 current_elapsed_time) {
         queued_real_inputs_, queued_predicted_inputs_, current_elapsed_time);
 
     updated_region_.Add(update.region);
-    // TODO: b/286547863 - Pass `update.first_vertex_offset` and
-    // `update.first_index_offset` to a `RenderCache` member once implemented.
+    const MutableMesh& mesh = shape_builders_[i].GetMesh();
+    mesh_change_history_[i].push_back({
+        .first_vertex =
+            update.first_vertex_offset.value_or(mesh.VertexCount()),
+        .first_triangle = update.first_index_offset.has_value()
+                              ? *update.first_index_offset / 3
+                              : mesh.TriangleCount(),
+    });
   }
+  ++update_count_;
 
   queued_real_inputs_.Clear();
   queued_predicted_inputs_.Clear();
   return absl::OkStatus();
 }
 
+InProgressStroke::MeshChanges InProgressStroke::GetMeshChangesSince(
+    uint32_t coat_index, const MeshVersion& version) const {
+  if (version.stroke_id != stroke_id_ || version.update_count > update_count_) {
+    return {};
+  }
+  const MutableMesh& mesh = GetMesh(coat_index);
+  MeshChanges changes = {.first_vertex = mesh.VertexCount(),
+                         .first_triangle = mesh.TriangleCount()};
+  absl::Span<const MeshChanges> history = mesh_change_history_[coat_index];
+  for (const MeshChanges& update_changes :
+       history.subspan(version.update_count)) {
+    changes.first_vertex =
+        std::min(changes.first_vertex, update_changes.first_vertex);
+    changes.first_triangle =
+        std::min(changes.first_triangle, update_changes.first_triangle);
+  }
+  return changes;
+}
+
 bool InProgressStroke::NeedsUpdate() const {
   if (!queued_real_inputs_.IsEmpty() || !queued_predicted_inputs_.IsEmpty()) {
     return true;
@@ -18,6 +18,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <optional>
+#include <vector>
 
 #include "absl/base/nullability.h"
 #include "absl/container/inlined_vector.h"
@@ -228,6 +229,51 @@ class InProgressStroke {
   const Envelope& GetUpdatedRegion() const;
   void ResetUpdatedRegion();
 
+  // Identifies the contents of the meshes returned by `GetMesh()` at some point
+  // in time, for use with `GetMeshChangesSince()`. A value-initialized
+  // `MeshVersion` does not identify any contents.
+  struct MeshVersion {
+    // An ID that is unique to each call to `Start()` or `Clear()`, across all
+    // `InProgressStroke` objects.
+    uint64_t stroke_id = 0;
+    // The number of calls to `UpdateShape()` since then.
+    uint32_t update_count = 0;
+  };
+
+  // The parts of a mesh that may have changed since some `MeshVersion`. Every
+  // vertex and triangle before these offsets is unchanged; every one at or
+  // after them may have been added or modified.
+  struct MeshChanges {
+    uint32_t first_vertex = 0;
+    uint32_t first_triangle = 0;
+  };
+
+  // Returns the current `MeshVersion`, which changes with every call to
+  // `Start()`, `Clear()`, and `UpdateShape()`.
+  MeshVersion GetMeshVersion() const;
+
+  // Returns the parts of `GetMesh(coat_index)` that may have changed since
+  // `GetMeshVersion()` returned `version`. If `version` was returned before the
+  // most recent call to `Start()` or `Clear()`, or by a different
+  // `InProgressStroke`, the whole mesh is reported as changed.
+  //
+  // This allows a renderer to keep a copy of the mesh (e.g. in GPU buffers) up
+  // to date by only copying the parts that changed, which for a growing stroke
+  // are typically a small number of vertices and triangles at the end.
+  MeshChanges GetMeshChangesSince(uint32_t coat_index,
+                                  const MeshVersion& version) const;
+
+  // Returns the number of triangles at the start of `GetMesh(coat_index)` that
+  // are guaranteed to not change with further calls to `UpdateShape()`, until
+  // the next call to `Start()` or `Clear()`. The count never decreases before
+  // then.
+  //
+  // This is a conservative count, which may be zero even when most of the mesh
+  // has not changed for many updates. In particular, handling
+  // self-intersections of the stroke can modify any of its triangles, so the
+  // count stays zero while they are handled, which is currently always.
+  uint32_t GetStableTriangleCount(uint32_t coat_index) const;
+
   // Copies the current input, brush, and geometry as of the last call to
   // `Start()` or `UpdateShape()` to a new `Stroke`.
   //
@@ -267,6 +313,14 @@ class InProgressStroke {
   // The region updated by `UpdateShape()` since the last call to `Start()` or
   // `ResetUpdatedRegion()`.
   Envelope updated_region_;
+  // The current `MeshVersion`; `stroke_id_` is zero until the first call to
+  // `Start()` or `Clear()`.
+  uint64_t stroke_id_ = 0;
+  uint32_t update_count_ = 0;
+  // For each brush coat, the changes made to its mesh by each call to
+  // `UpdateShape()` since the last call to `Start()`. As with
+  // `shape_builders_`, this may have additional elements, which are ignored.
+  absl::InlinedVector<std::vector<MeshChanges>, 1> mesh_change_history_;
   // True if `FinishInputs()` has been called since the last call to `Start()`,
   // or if `Start()` hasn't been called yet.
   bool inputs_are_finished_ = true;
@@ -313,12 +367,22 @@ InProgressStroke::GetCoatOutlines(uint32_t coat_index) const {
   return shape_builders_[coat_index].GetOutlines();
 }
 
+inline uint32_t InProgressStroke::GetStableTriangleCount(
+    uint32_t coat_index) const {
+  ABSL_CHECK_LT(coat_index, BrushCoatCount());
+  return shape_builders_[coat_index].GetStableTriangleCount();
+}
+
 inline const Envelope& InProgressStroke::GetUpdatedRegion() const {
   return updated_region_;
 }
 
 inline void InProgressStroke::ResetUpdatedRegion() { updated_region_.Reset(); }
 
+inline InProgressStroke::MeshVersion InProgressStroke::GetMeshVersion() const {
+  return {.stroke_id = stroke_id_, .update_count = update_count_};
+}
+
 }  // namespace ink
 
 #endif  // INK_STROKES_IN_PROGRESS_STROKE_H_
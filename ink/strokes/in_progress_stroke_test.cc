@@ -703,6 +703,30 @@ TEST(InProgressStrokeTest, ResetUpdatedRegionAfterExtendingStroke) {
   EXPECT_TRUE(stroke.GetUpdatedRegion().IsEmpty());
 }
 
+TEST(InProgressStrokeTest, StableTriangleCountIsZeroWithIntersectionHandling) {
+  InProgressStroke stroke;
+  stroke.Start(CreateRectangularTestBrush());
+  EXPECT_EQ(stroke.GetStableTriangleCount(0), 0);
+
+  absl::StatusOr<StrokeInputBatch> real_inputs = StrokeInputBatch::Create({
+      {.position = {1, 2}, .elapsed_time = Duration32::Seconds(0.0)},
+      {.position = {3, 2}, .elapsed_time = Duration32::Seconds(0.1)},
+      {.position = {5, 4}, .elapsed_time = Duration32::Seconds(0.2)},
+  });
+  ASSERT_EQ(real_inputs.status(), absl::OkStatus());
+  ASSERT_EQ(absl::OkStatus(), stroke.EnqueueInputs(*real_inputs, {}));
+  ASSERT_EQ(absl::OkStatus(), stroke.UpdateShape(Duration32::Seconds(0.2)));
+
+  // The brush coat handles self-intersections, which can modify any triangle
+  // of the mesh. See the `NStableTriangles` tests in `GeometryTest` for the
+  // count of a mesh that does not handle them.
+  ASSERT_GT(stroke.GetMesh(0).TriangleCount(), 0);
+  EXPECT_EQ(stroke.GetStableTriangleCount(0), 0);
+
+  stroke.Start(CreateRectangularTestBrush());
+  EXPECT_EQ(stroke.GetStableTriangleCount(0), 0);
+}
+
 TEST(InProgressStrokeTest, StartAfterExtendingStroke) {
   Brush starting_brush = CreateRectangularTestBrush();
   Brush replacement_brush = CreateCircularTestBrush();
@@ -172,6 +172,11 @@ class StrokeInputBatch {
   }
 
  private:
+  // Decoding constructs the batch directly from its already-validated data,
+  // rather than validating and appending each input individually.
+  friend absl::StatusOr<StrokeInputBatch> DecodeStrokeInputBatch(
+      absl::Span<const std::byte> encoded);
+
   void DebugCheckSizeAndFormatAreConsistent() const {
     ABSL_DCHECK_EQ(size_ * FloatsPerInput(),
                    data_.HasValue() ? data_->size() : 0);
@@ -102,6 +102,11 @@ class BrushTipExtruder {
   // that is empty if the stroke is empty.)
   absl::Span<const StrokeOutline> GetOutlines() const;
 
+  // Returns the number of triangles at the start of the current mesh that are
+  // guaranteed to not change with future extrusions. See
+  // `Geometry::NStableTriangles()`.
+  uint32_t GetStableTriangleCount() const;
+
  private:
   // Data used to incrementally update the bounds of geometry extruded into the
   // current mesh.
@@ -233,6 +238,10 @@ inline absl::Span<const StrokeOutline> BrushTipExtruder::GetOutlines() const {
   return outlines_;
 }
 
+inline uint32_t BrushTipExtruder::GetStableTriangleCount() const {
+  return geometry_.NStableTriangles();
+}
+
 }  // namespace ink::strokes_internal
 
 #endif  // INK_STROKES_INTERNAL_BRUSH_TIP_EXTRUDER_H_
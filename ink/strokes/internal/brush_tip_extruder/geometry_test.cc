@@ -1635,6 +1635,65 @@ TEST(GeometryTest, FirstMutatedIndexOffsets) {
   EXPECT_EQ(geometry.FirstMutatedRightIndexOffsetInCurrentPartition(), 1);
 }
 
+TEST(GeometryTest, NStableTrianglesIsZeroWithIntersectionHandling) {
+  MeshData mesh_data;
+  Geometry geometry(MakeView(mesh_data));
+  auto extrude = [&geometry](float x) {
+    geometry.AppendLeftVertex(Point{x, 1});
+    geometry.AppendRightVertex(Point{x, 0});
+    geometry.ProcessNewVertices(0, PositionAndSizeToTipState({x, 0.5}, 1));
+  };
+
+  // Intersection handling can go on to modify any triangle of the mesh, even
+  // one before an extrusion break, because disconnecting the sides of a later
+  // partition moves its start back to the start of the mesh.
+  for (int i = 0; i < 50; ++i) {
+    extrude(i);
+    EXPECT_EQ(geometry.NStableTriangles(), 0) << "i = " << i;
+  }
+  geometry.AddExtrusionBreak();
+  for (int i = 60; i < 80; ++i) {
+    extrude(i);
+    EXPECT_EQ(geometry.NStableTriangles(), 0) << "i = " << i;
+  }
+}
+
+TEST(GeometryTest, NStableTrianglesGrowsWithIntersectionHandlingDisabled) {
+  MeshData mesh_data;
+  Geometry geometry(MakeView(mesh_data));
+  geometry.SetIntersectionHandling(Geometry::IntersectionHandling::kDisabled);
+  EXPECT_EQ(geometry.NStableTriangles(), 0);
+
+  // Extend a wavy line, so that simplification doesn't remove most vertices,
+  // and mimic predicted inputs by appending a few more vertices after a save
+  // point and then reverting them on every step.
+  uint32_t previous_n_stable = 0;
+  for (int i = 0; i < 50; ++i) {
+    float x = i;
+    float y = (i % 2 == 0) ? 0 : 0.5f;
+    geometry.AppendLeftVertex(Point{x, y + 1});
+    geometry.AppendRightVertex(Point{x, y});
+    geometry.ProcessNewVertices(0, PositionAndSizeToTipState({x, y + 0.5f}, 1));
+
+    uint32_t n_stable = geometry.NStableTriangles();
+    EXPECT_GE(n_stable, previous_n_stable) << "i = " << i;
+    EXPECT_LE(n_stable, geometry.GetMeshView().TriangleCount()) << "i = " << i;
+
+    geometry.SetSavePoint();
+    geometry.AppendLeftVertex(Point{x + 0.5f, 2});
+    geometry.AppendRightVertex(Point{x + 0.5f, -1});
+    geometry.ProcessNewVertices(0,
+                                PositionAndSizeToTipState({x + 0.5f, 0.5}, 1));
+    // Triangles added after the save point may still be reverted.
+    EXPECT_EQ(geometry.NStableTriangles(), n_stable) << "i = " << i;
+    geometry.RevertToSavePoint();
+    EXPECT_EQ(geometry.NStableTriangles(), n_stable) << "i = " << i;
+
+    previous_n_stable = n_stable;
+  }
+  EXPECT_GT(previous_n_stable, 0);
+}
+
 }  // namespace
 }  // namespace brush_tip_extruder_internal
 }  // namespace ink
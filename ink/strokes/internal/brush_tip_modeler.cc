@@ -294,7 +294,7 @@ void BrushTipModeler::StartStroke(absl::Nonnull<const BrushTip*> brush_tip,
   time_remaining_behavior_upper_bound_ = Duration32::Zero();
   behaviors_depend_on_next_input_ = false;
 
-  behavior_nodes_.clear();
+  behavior_program_.Clear();
   current_damped_values_.clear();
   fixed_damped_values_.clear();
   behavior_targets_.clear();
@@ -307,6 +307,7 @@ void BrushTipModeler::StartStroke(absl::Nonnull<const BrushTip*> brush_tip,
                  node);
     }
   }
+  behavior_stack_.resize(behavior_program_.RegisterCount());
 }
 
 void BrushTipModeler::AppendBehaviorNode(
@@ -316,7 +317,7 @@ void BrushTipModeler::AppendBehaviorNode(
                DistanceRemainingUpperBound(node, brush_size_));
   time_remaining_behavior_upper_bound_ = std::max(
       time_remaining_behavior_upper_bound_, TimeRemainingUpperBound(node));
-  behavior_nodes_.push_back(node);
+  behavior_program_.Append(node);
   if (SourceDependsOnNextModeledInput(node.source)) {
     behaviors_depend_on_next_input_ = true;
   }
@@ -324,22 +325,22 @@ void BrushTipModeler::AppendBehaviorNode(
 
 void BrushTipModeler::AppendBehaviorNode(
     const BrushBehavior::ConstantNode& node) {
-  behavior_nodes_.push_back(node);
+  behavior_program_.Append(node);
 }
 
 void BrushTipModeler::AppendBehaviorNode(
     const BrushBehavior::FallbackFilterNode& node) {
-  behavior_nodes_.push_back(node);
+  behavior_program_.Append(node);
 }
 
 void BrushTipModeler::AppendBehaviorNode(
     const BrushBehavior::ToolTypeFilterNode& node) {
-  behavior_nodes_.push_back(node);
+  behavior_program_.Append(node);
 }
 
 void BrushTipModeler::AppendBehaviorNode(
     const BrushBehavior::DampingNode& node) {
-  behavior_nodes_.push_back(DampingNodeImplementation{
+  behavior_program_.Append(DampingNodeImplementation{
       .damping_index = current_damped_values_.size(),
       .damping_source = node.damping_source,
       .damping_gap = node.damping_gap,
@@ -350,22 +351,22 @@ void BrushTipModeler::AppendBehaviorNode(
 
 void BrushTipModeler::AppendBehaviorNode(
     const BrushBehavior::ResponseNode& node) {
-  behavior_nodes_.push_back(EasingImplementation(node.response_curve));
+  behavior_program_.Append(EasingImplementation(node.response_curve));
 }
 
 void BrushTipModeler::AppendBehaviorNode(
     const BrushBehavior::BinaryOpNode& node) {
-  behavior_nodes_.push_back(node);
+  behavior_program_.Append(node);
 }
 
 void BrushTipModeler::AppendBehaviorNode(
     const BrushBehavior::InterpolationNode& node) {
-  behavior_nodes_.push_back(node);
+  behavior_program_.Append(node);
 }
 
 void BrushTipModeler::AppendBehaviorNode(
     const BrushBehavior::TargetNode& node) {
-  behavior_nodes_.push_back(TargetNodeImplementation{
+  behavior_program_.Append(TargetNodeImplementation{
       .target_index = behavior_targets_.size(),
       .target_modifier_range = node.target_modifier_range,
   });
@@ -404,10 +405,6 @@ void BrushTipModeler::UpdateStroke(
                  current_target_modifiers_.size());
   absl::c_copy(fixed_target_modifiers_, current_target_modifiers_.begin());
 
-  absl::Nullable<const ModeledStrokeInput*> previous_input =
-      input_index_for_next_fixed_state_ > 0
-          ? &inputs[input_index_for_next_fixed_state_ - 1]
-          : nullptr;
   std::optional<InputMetrics> last_modeled_tip_state_metrics =
       last_fixed_modeled_tip_state_metrics_;
 
@@ -415,10 +412,10 @@ void BrushTipModeler::UpdateStroke(
   // reserving the last stable input if any behaviors would actually depend on
   // the first unstable input.
   int reserved_stable_input = behaviors_depend_on_next_input_ ? 1 : 0;
-  while (input_index_for_next_fixed_state_ + reserved_stable_input <
+  size_t fixed_input_end = input_index_for_next_fixed_state_;
+  while (fixed_input_end + reserved_stable_input <
          input_modeler_state.stable_input_count) {
-    const ModeledStrokeInput& current_input =
-        inputs[input_index_for_next_fixed_state_];
+    const ModeledStrokeInput& current_input = inputs[fixed_input_end];
 
     // If the current `brush_tip_` has behaviors targeting distance or time
     // remaining, not all "stable" `ModeledStrokeInput` can be used to make
@@ -428,14 +425,11 @@ void BrushTipModeler::UpdateStroke(
         current_input.elapsed_time > max_fixed_metrics.elapsed_time) {
       break;
     }
-
-    ProcessSingleInput(
-        input_modeler_state, current_input,
-        GetTravelDirection(inputs, input_index_for_next_fixed_state_),
-        previous_input, last_modeled_tip_state_metrics);
-    previous_input = &current_input;
-    ++input_index_for_next_fixed_state_;
+    ++fixed_input_end;
   }
+  ProcessInputs(input_modeler_state, inputs, input_index_for_next_fixed_state_,
+                fixed_input_end, last_modeled_tip_state_metrics);
+  input_index_for_next_fixed_state_ = fixed_input_end;
 
   // Save the necessary fixed properties:
   last_fixed_modeled_tip_state_metrics_ = last_modeled_tip_state_metrics;
@@ -447,14 +441,8 @@ void BrushTipModeler::UpdateStroke(
   absl::c_copy(current_target_modifiers_, fixed_target_modifiers_.begin());
 
   // Generate the remaining tip states, which are volatile:
-  for (size_t i = input_index_for_next_fixed_state_; i < inputs.size(); ++i) {
-    const ModeledStrokeInput& current_input = inputs[i];
-
-    ProcessSingleInput(input_modeler_state, current_input,
-                       GetTravelDirection(inputs, i), previous_input,
-                       last_modeled_tip_state_metrics);
-    previous_input = &current_input;
-  }
+  ProcessInputs(input_modeler_state, inputs, input_index_for_next_fixed_state_,
+                inputs.size(), last_modeled_tip_state_metrics);
 }
 
 bool BrushTipModeler::HasUnfinishedTimeBehaviors(
@@ -483,6 +471,70 @@ InputMetrics BrushTipModeler::CalculateMaxFixedInputMetrics(
   };
 }
 
+void BrushTipModeler::ProcessInputs(
+    const StrokeInputModeler::State& input_modeler_state,
+    absl::Span<const ModeledStrokeInput> inputs, size_t begin, size_t end,
+    std::optional<InputMetrics>& last_modeled_tip_state_metrics) {
+  if (begin == end) return;
+  absl::Nullable<const ModeledStrokeInput*> previous_input =
+      begin > 0 ? &inputs[begin - 1] : nullptr;
+
+  bool do_continuous_extrusion =
+      particle_gap_metrics_.traveled_distance == 0 &&
+      particle_gap_metrics_.elapsed_time == Duration32::Zero();
+  if (!do_continuous_extrusion) {
+    // When emitting particles, the number of tip states generated for each
+    // input, and the inputs that the behaviors are run on, depend on the
+    // metrics of the previous tip state, so the inputs are processed one at a
+    // time.
+    for (size_t i = begin; i < end; ++i) {
+      ProcessSingleInput(input_modeler_state, inputs[i],
+                         GetTravelDirection(inputs, i), previous_input,
+                         last_modeled_tip_state_metrics);
+      previous_input = &inputs[i];
+    }
+    return;
+  }
+
+  // Otherwise, each input generates one tip state, so the behaviors can be run
+  // on all of the inputs at once.
+  travel_directions_.clear();
+  for (size_t i = begin; i < end; ++i) {
+    travel_directions_.push_back(GetTravelDirection(inputs, i));
+  }
+  BehaviorBatchContext context = {
+      .input_modeler_state = input_modeler_state,
+      .inputs = inputs.subspan(begin, end - begin),
+      .travel_directions = travel_directions_,
+      .brush_size = brush_size_,
+      .previous_input_metrics =
+          previous_input == nullptr
+              ? std::nullopt
+              : std::optional<InputMetrics>({
+                    .traveled_distance = previous_input->traveled_distance,
+                    .elapsed_time = previous_input->elapsed_time,
+                }),
+      .registers = behavior_stack_,
+      .damped_values = absl::MakeSpan(current_damped_values_),
+      .target_modifiers = absl::MakeSpan(current_target_modifiers_),
+      .target_modifiers_per_input = target_modifiers_per_input_,
+  };
+  behavior_program_.RunBatch(context);
+
+  size_t target_count = behavior_targets_.size();
+  for (size_t i = 0; i < context.inputs.size(); ++i) {
+    saved_tip_states_.push_back(CreateTipState(
+        context.inputs[i].position, travel_directions_[i], *brush_tip_,
+        brush_size_, behavior_targets_,
+        absl::MakeConstSpan(target_modifiers_per_input_)
+            .subspan(i * target_count, target_count)));
+  }
+  last_modeled_tip_state_metrics = {
+      .traveled_distance = inputs[end - 1].traveled_distance,
+      .elapsed_time = inputs[end - 1].elapsed_time,
+  };
+}
+
 void BrushTipModeler::ProcessSingleInput(
     const StrokeInputModeler::State& input_modeler_state,
     const ModeledStrokeInput& current_input,
@@ -582,11 +634,7 @@ void BrushTipModeler::AddNewTipState(
       .damped_values = absl::MakeSpan(current_damped_values_),
       .target_modifiers = absl::MakeSpan(current_target_modifiers_),
   };
-  ABSL_DCHECK(behavior_stack_.empty());
-  for (const BehaviorNodeImplementation& node : behavior_nodes_) {
-    ProcessBehaviorNode(node, context);
-  }
-  ABSL_DCHECK(behavior_stack_.empty());
+  behavior_program_.Run(context);
 
   saved_tip_states_.push_back(
       CreateTipState(input.position, travel_direction, *brush_tip_, brush_size_,
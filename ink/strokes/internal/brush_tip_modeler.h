@@ -129,6 +129,14 @@ class BrushTipModeler {
       const StrokeInputModeler::State& input_modeler_state,
       absl::Span<const ModeledStrokeInput> inputs) const;
 
+  // Processes the elements of `inputs` in the range [`begin`, `end`), either
+  // all at once with `BehaviorProgram::RunBatch()`, or one at a time with
+  // `ProcessSingleInput()` if emitting particles.
+  void ProcessInputs(
+      const StrokeInputModeler::State& input_modeler_state,
+      absl::Span<const ModeledStrokeInput> inputs, size_t begin, size_t end,
+      std::optional<InputMetrics>& last_modeled_tip_state_metrics);
+
   // Processes a single `ModeledStrokeInput` and sets up particle emission if
   // enabled.
   void ProcessSingleInput(
@@ -184,8 +192,12 @@ class BrushTipModeler {
   // properties of subsequent modeled inputs, like the travel direction.
   bool behaviors_depend_on_next_input_ = false;
 
-  std::vector<BehaviorNodeImplementation> behavior_nodes_;
+  // The behavior nodes of `brush_tip_`, and the registers for running them.
+  BehaviorProgram behavior_program_;
   std::vector<float> behavior_stack_;
+  // Scratch space for `ProcessInputs()`.
+  std::vector<std::optional<Angle>> travel_directions_;
+  std::vector<float> target_modifiers_per_input_;
   // These next two vectors must always be the same size:
   std::vector<float> current_damped_values_;
   std::vector<float> fixed_damped_values_;
@@ -18,10 +18,14 @@
 #include <array>
 #include <cmath>
 #include <cstddef>
+#include <cstdint>
+#include <limits>
 #include <optional>
 #include <variant>
 #include <vector>
 
+#include "absl/algorithm/container.h"
+#include "absl/functional/overload.h"
 #include "absl/log/absl_check.h"
 #include "absl/types/span.h"
 #include "ink/brush/brush_behavior.h"
@@ -281,36 +285,163 @@ float DampOffsetTransition(float target_offset, float previous_offset,
   return Lerp(target_offset, previous_offset, std::exp(-delta / response_gap));
 }
 
-inline float DampOffsetTransition(float target_offset, float previous_offset,
-                                  Duration32 time_delta,
-                                  Duration32 response_time) {
-  return DampOffsetTransition(target_offset, previous_offset,
-                              time_delta.ToSeconds(),
-                              response_time.ToSeconds());
+// Returns true if a damping node snaps its damped value to each non-null
+// input, rather than moving the damped value towards it.
+bool DampingNodeSnapsToInput(
+    const DampingNodeImplementation& node,
+    const StrokeInputModeler::State& input_modeler_state) {
+  // If no mapping from stroke units to physical units is available, then don't
+  // perform any damping for physical distances.
+  return node.damping_gap == 0.0f ||
+         (node.damping_source ==
+              BrushBehavior::DampingSource::kDistanceInCentimeters &&
+          !input_modeler_state.stroke_unit_length.has_value());
 }
 
-inline float DampOffsetTransition(float target_offset, float previous_offset,
-                                  PhysicalDistance distance_delta,
-                                  PhysicalDistance response_distance) {
-  return DampOffsetTransition(target_offset, previous_offset,
-                              distance_delta.ToCentimeters(),
-                              response_distance.ToCentimeters());
+// Returns the `response_gap` to pass to `DampOffsetTransition()` for a damping
+// node, in the units of `DampingDelta()`.
+float DampingResponseGap(const DampingNodeImplementation& node,
+                         float brush_size) {
+  switch (node.damping_source) {
+    case BrushBehavior::DampingSource::kDistanceInCentimeters:
+      return PhysicalDistance::Centimeters(node.damping_gap).ToCentimeters();
+    case BrushBehavior::DampingSource::kDistanceInMultiplesOfBrushSize:
+      return brush_size * node.damping_gap;
+    case BrushBehavior::DampingSource::kTimeInSeconds:
+      return Duration32::Seconds(node.damping_gap).ToSeconds();
+  }
+  return 0;
 }
 
-void ProcessBehaviorNodeImpl(const BrushBehavior::SourceNode& node,
-                             const BehaviorNodeContext& context) {
-  std::optional<float> source_value = GetSourceValue(
-      context.current_input, context.current_travel_direction,
-      context.brush_size, context.input_modeler_state, node.source);
-  if (!source_value.has_value()) {
-    context.stack.push_back(kNullBehaviorNodeValue);
-    return;
+// Returns the `delta` to pass to `DampOffsetTransition()` for a damping node
+// between the inputs with the given metrics. Must not be called if
+// `DampingNodeSnapsToInput()` is true.
+float DampingDelta(const DampingNodeImplementation& node,
+                   const StrokeInputModeler::State& input_modeler_state,
+                   const InputMetrics& current, const InputMetrics& previous) {
+  switch (node.damping_source) {
+    case BrushBehavior::DampingSource::kDistanceInCentimeters:
+      return (*input_modeler_state.stroke_unit_length *
+              (current.traveled_distance - previous.traveled_distance))
+          .ToCentimeters();
+    case BrushBehavior::DampingSource::kDistanceInMultiplesOfBrushSize:
+      return current.traveled_distance - previous.traveled_distance;
+    case BrushBehavior::DampingSource::kTimeInSeconds:
+      return (current.elapsed_time - previous.elapsed_time).ToSeconds();
   }
+  return 0;
+}
 
-  context.stack.push_back(ApplyOutOfRangeBehavior(
+// Returns the output of a source node for `input`.
+float SourceNodeValue(const BrushBehavior::SourceNode& node,
+                      const ModeledStrokeInput& input,
+                      std::optional<Angle> travel_direction, float brush_size,
+                      const StrokeInputModeler::State& input_modeler_state) {
+  std::optional<float> source_value = GetSourceValue(
+      input, travel_direction, brush_size, input_modeler_state, node.source);
+  if (!source_value.has_value()) return kNullBehaviorNodeValue;
+  return ApplyOutOfRangeBehavior(
       node.source_out_of_range_behavior,
       InverseLerp(node.source_value_range[0], node.source_value_range[1],
-                  *source_value)));
+                  *source_value));
+}
+
+// Returns the output of a source node for the current input of `context`.
+float SourceNodeValue(const BrushBehavior::SourceNode& node,
+                      const BehaviorNodeContext& context) {
+  return SourceNodeValue(node, context.current_input,
+                         context.current_travel_direction, context.brush_size,
+                         context.input_modeler_state);
+}
+
+// Updates the damped value of a damping node with its `input`, and returns the
+// new damped value, which is the output of the node.
+float DampingNodeValue(const DampingNodeImplementation& node, float input,
+                       const BehaviorNodeContext& context) {
+  float& damped_value = context.damped_values[node.damping_index];
+  if (IsNullBehaviorNodeValue(input)) {
+    // Input is null, so use previous damped value unchanged.
+  } else if (IsNullBehaviorNodeValue(damped_value) ||
+             DampingNodeSnapsToInput(node, context.input_modeler_state)) {
+    // Input is non-null.  If previous damped value is null, then this is the
+    // first non-null input, so snap the damped value to the input.  Or, if
+    // there's no damping to be done, then also snap the damped value to the
+    // input.
+    damped_value = input;
+  } else {
+    // Input and previous damped value are both non-null, so move the damped
+    // value towards the input according to the damping settings.  Note that a
+    // non-null previous damped value implies that there was at least one
+    // previous input, and thus `context.previous_input_metrics` is present.
+    ABSL_DCHECK(context.previous_input_metrics.has_value());
+    damped_value = DampOffsetTransition(
+        input, damped_value,
+        DampingDelta(node, context.input_modeler_state,
+                     {.traveled_distance =
+                          context.current_input.traveled_distance,
+                      .elapsed_time = context.current_input.elapsed_time},
+                     *context.previous_input_metrics),
+        DampingResponseGap(node, context.brush_size));
+  }
+  return damped_value;
+}
+
+// Returns the output of a binary op node with the given inputs.
+float BinaryOpNodeValue(BrushBehavior::BinaryOp operation, float first_input,
+                        float second_input) {
+  float result = kNullBehaviorNodeValue;
+  switch (operation) {
+    case BrushBehavior::BinaryOp::kProduct:
+      // kNullBehaviorNodeValue is NaN, so if either input value is null (NaN),
+      // the result will be null (NaN).
+      result = first_input * second_input;
+      break;
+    case BrushBehavior::BinaryOp::kSum:
+      // kNullBehaviorNodeValue is NaN, so if either input value is null (NaN),
+      // the result will be null (NaN).
+      result = first_input + second_input;
+      break;
+  }
+  // If any of the above operations resulted in a non-finite value
+  // (e.g. overflow to infinity), treat the result as null.
+  if (!std::isfinite(result)) return kNullBehaviorNodeValue;
+  return result;
+}
+
+// Returns the output of an interpolation node with the given inputs.
+float InterpolationNodeValue(BrushBehavior::Interpolation interpolation,
+                             float param, float range_start, float range_end) {
+  if (IsNullBehaviorNodeValue(range_start) ||
+      IsNullBehaviorNodeValue(range_end) || IsNullBehaviorNodeValue(param)) {
+    return kNullBehaviorNodeValue;
+  }
+  float result = kNullBehaviorNodeValue;
+  switch (interpolation) {
+    case BrushBehavior::Interpolation::kLerp:
+      result = Lerp(range_start, range_end, param);
+      break;
+    case BrushBehavior::Interpolation::kInverseLerp:
+      if (range_start == range_end) return kNullBehaviorNodeValue;
+      result = InverseLerp(range_start, range_end, param);
+      break;
+  }
+  // If any of the above resulted in a non-finite value (e.g. overflow to
+  // infinity), treat the result as null.
+  if (!std::isfinite(result)) return kNullBehaviorNodeValue;
+  return result;
+}
+
+// Updates the target modifier of a target node with its `input`.
+void ApplyTargetNode(const TargetNodeImplementation& node, float input,
+                     const BehaviorNodeContext& context) {
+  if (IsNullBehaviorNodeValue(input)) return;
+  context.target_modifiers[node.target_index] =
+      Lerp(node.target_modifier_range[0], node.target_modifier_range[1], input);
+}
+
+void ProcessBehaviorNodeImpl(const BrushBehavior::SourceNode& node,
+                             const BehaviorNodeContext& context) {
+  context.stack.push_back(SourceNodeValue(node, context));
 }
 
 void ProcessBehaviorNodeImpl(const BrushBehavior::ConstantNode& node,
@@ -339,59 +470,7 @@ void ProcessBehaviorNodeImpl(const BrushBehavior::ToolTypeFilterNode& node,
 void ProcessBehaviorNodeImpl(const DampingNodeImplementation& node,
                              const BehaviorNodeContext& context) {
   ABSL_DCHECK(!context.stack.empty());
-  float& damped_value = context.damped_values[node.damping_index];
-  float input = context.stack.back();
-  if (IsNullBehaviorNodeValue(input)) {
-    // Input is null, so use previous damped value unchanged.
-  } else if (IsNullBehaviorNodeValue(damped_value) ||
-             node.damping_gap == 0.0f) {
-    // Input is non-null.  If previous damped value is null, then this is the
-    // first non-null input, so snap the damped value to the input.  Or, if the
-    // damping_gap is zero, then there's no damping to be done, so also snap the
-    // damped value to the input.
-    damped_value = input;
-  } else {
-    // Input and previous damped value are both non-null, so move the damped
-    // value towards the input according to the damping settings.  Note that a
-    // non-null previous damped value implies that there was at least one
-    // previous input, and thus `context.previous_input_metrics` is present.
-    ABSL_DCHECK(context.previous_input_metrics.has_value());
-    switch (node.damping_source) {
-      case BrushBehavior::DampingSource::kDistanceInCentimeters: {
-        // If no mapping from stroke units to physical units is available, then
-        // don't perform any damping (i.e. snap damped value to input).
-        if (!context.input_modeler_state.stroke_unit_length.has_value()) {
-          damped_value = input;
-          break;
-        }
-        PhysicalDistance damping_distance =
-            PhysicalDistance::Centimeters(node.damping_gap);
-        PhysicalDistance traveled_distance_delta =
-            *context.input_modeler_state.stroke_unit_length *
-            (context.current_input.traveled_distance -
-             context.previous_input_metrics->traveled_distance);
-        damped_value = DampOffsetTransition(
-            input, damped_value, traveled_distance_delta, damping_distance);
-      } break;
-      case BrushBehavior::DampingSource::kDistanceInMultiplesOfBrushSize: {
-        float damping_distance = context.brush_size * node.damping_gap;
-        float traveled_distance_delta =
-            context.current_input.traveled_distance -
-            context.previous_input_metrics->traveled_distance;
-        damped_value = DampOffsetTransition(
-            input, damped_value, traveled_distance_delta, damping_distance);
-      } break;
-      case BrushBehavior::DampingSource::kTimeInSeconds: {
-        Duration32 damping_time = Duration32::Seconds(node.damping_gap);
-        Duration32 elapsed_time_delta =
-            context.current_input.elapsed_time -
-            context.previous_input_metrics->elapsed_time;
-        damped_value = DampOffsetTransition(input, damped_value,
-                                            elapsed_time_delta, damping_time);
-      } break;
-    }
-  }
-  context.stack.back() = damped_value;
+  context.stack.back() = DampingNodeValue(node, context.stack.back(), context);
 }
 
 void ProcessBehaviorNodeImpl(const EasingImplementation& node,
@@ -405,25 +484,8 @@ void ProcessBehaviorNodeImpl(const BrushBehavior::BinaryOpNode& node,
   ABSL_DCHECK_GE(context.stack.size(), 2);
   float second_input = context.stack.back();
   context.stack.pop_back();
-  float first_input = context.stack.back();
-  float* result = &context.stack.back();
-  switch (node.operation) {
-    case BrushBehavior::BinaryOp::kProduct:
-      // kNullBehaviorNodeValue is NaN, so if either input value is null (NaN),
-      // the result will be null (NaN).
-      *result = first_input * second_input;
-      break;
-    case BrushBehavior::BinaryOp::kSum:
-      // kNullBehaviorNodeValue is NaN, so if either input value is null (NaN),
-      // the result will be null (NaN).
-      *result = first_input + second_input;
-      break;
-  }
-  // If any of the above operations resulted in a non-finite value
-  // (e.g. overflow to infinity), treat the result as null.
-  if (!std::isfinite(*result)) {
-    *result = kNullBehaviorNodeValue;
-  }
+  context.stack.back() =
+      BinaryOpNodeValue(node.operation, context.stack.back(), second_input);
 }
 
 void ProcessBehaviorNodeImpl(const BrushBehavior::InterpolationNode& node,
@@ -433,30 +495,8 @@ void ProcessBehaviorNodeImpl(const BrushBehavior::InterpolationNode& node,
   context.stack.pop_back();
   float range_start = context.stack.back();
   context.stack.pop_back();
-  float param = context.stack.back();
-  float* result = &context.stack.back();
-  if (IsNullBehaviorNodeValue(range_start) ||
-      IsNullBehaviorNodeValue(range_end) || IsNullBehaviorNodeValue(param)) {
-    *result = kNullBehaviorNodeValue;
-    return;
-  }
-  switch (node.interpolation) {
-    case BrushBehavior::Interpolation::kLerp:
-      *result = Lerp(range_start, range_end, param);
-      break;
-    case BrushBehavior::Interpolation::kInverseLerp:
-      if (range_start == range_end) {
-        *result = kNullBehaviorNodeValue;
-        return;
-      }
-      *result = InverseLerp(range_start, range_end, param);
-      break;
-  }
-  // If any of the above resulted in a non-finite value (e.g. overflow to
-  // infinity), treat the result as null.
-  if (!std::isfinite(*result)) {
-    *result = kNullBehaviorNodeValue;
-  }
+  context.stack.back() = InterpolationNodeValue(
+      node.interpolation, context.stack.back(), range_start, range_end);
 }
 
 void ProcessBehaviorNodeImpl(const TargetNodeImplementation& node,
@@ -464,9 +504,129 @@ void ProcessBehaviorNodeImpl(const TargetNodeImplementation& node,
   ABSL_DCHECK(!context.stack.empty());
   float input = context.stack.back();
   context.stack.pop_back();
-  if (IsNullBehaviorNodeValue(input)) return;
-  context.target_modifiers[node.target_index] =
-      Lerp(node.target_modifier_range[0], node.target_modifier_range[1], input);
+  ApplyTargetNode(node, input, context);
+}
+
+// Returns a mask with the bit `1 << tool_type` set for each tool type that is
+// enabled in `enabled_tool_types`.
+uint32_t ToolTypeMask(BrushBehavior::EnabledToolTypes enabled_tool_types) {
+  uint32_t mask = 0;
+  for (StrokeInput::ToolType tool_type :
+       {StrokeInput::ToolType::kUnknown, StrokeInput::ToolType::kMouse,
+        StrokeInput::ToolType::kTouch, StrokeInput::ToolType::kStylus}) {
+    if (IsToolTypeEnabled(enabled_tool_types, tool_type)) {
+      mask |= 1u << static_cast<int>(tool_type);
+    }
+  }
+  return mask;
+}
+
+// The functions below run a single node for a span of inputs, on rows that hold
+// one value per input. Where possible, they are plain loops over contiguous
+// rows, so that they can be vectorized.
+
+// Returns `value` if it is finite, and null otherwise. This is equivalent to
+// checking `std::isfinite()`, but is a plain comparison that can be vectorized.
+inline float NullIfNotFinite(float value) {
+  return std::abs(value) <= std::numeric_limits<float>::max()
+             ? value
+             : kNullBehaviorNodeValue;
+}
+
+void ProductOfRows(absl::Span<float> first_inputs,
+                   absl::Span<const float> second_inputs) {
+  for (size_t i = 0; i < first_inputs.size(); ++i) {
+    first_inputs[i] = NullIfNotFinite(first_inputs[i] * second_inputs[i]);
+  }
+}
+
+void SumOfRows(absl::Span<float> first_inputs,
+               absl::Span<const float> second_inputs) {
+  for (size_t i = 0; i < first_inputs.size(); ++i) {
+    first_inputs[i] = NullIfNotFinite(first_inputs[i] + second_inputs[i]);
+  }
+}
+
+// Null inputs need no special handling in the two functions below, since they
+// are NaN, which the arithmetic carries through to the result.
+void LerpOfRows(absl::Span<float> params, absl::Span<const float> range_starts,
+                absl::Span<const float> range_ends) {
+  for (size_t i = 0; i < params.size(); ++i) {
+    params[i] = NullIfNotFinite(range_starts[i] +
+                                (range_ends[i] - range_starts[i]) * params[i]);
+  }
+}
+
+// When the start and end of the range are equal, the division gives an
+// infinity or NaN, so the result is null as for `InterpolationNodeValue()`.
+void InverseLerpOfRows(absl::Span<float> params,
+                       absl::Span<const float> range_starts,
+                       absl::Span<const float> range_ends) {
+  for (size_t i = 0; i < params.size(); ++i) {
+    params[i] = NullIfNotFinite((params[i] - range_starts[i]) /
+                                (range_ends[i] - range_starts[i]));
+  }
+}
+
+InputMetrics GetInputMetrics(const ModeledStrokeInput& input) {
+  return {.traveled_distance = input.traveled_distance,
+          .elapsed_time = input.elapsed_time};
+}
+
+// Runs a damping node on `row` as a scan, which is the only part of a batch
+// that has to be processed one input at a time. The `DampingDelta()` values
+// that it needs are computed beforehand into `deltas`.
+void DampRow(const DampingNodeImplementation& node,
+             const BehaviorBatchContext& context, absl::Span<float> row,
+             absl::Span<float> deltas) {
+  bool snaps_to_input =
+      DampingNodeSnapsToInput(node, context.input_modeler_state);
+  if (!snaps_to_input) {
+    for (size_t i = 0; i < row.size(); ++i) {
+      std::optional<InputMetrics> previous_input_metrics =
+          i == 0 ? context.previous_input_metrics
+                 : GetInputMetrics(context.inputs[i - 1]);
+      // Without a previous input, the damped value must still be null, so the
+      // delta is not used.
+      deltas[i] = previous_input_metrics.has_value()
+                      ? DampingDelta(node, context.input_modeler_state,
+                                     GetInputMetrics(context.inputs[i]),
+                                     *previous_input_metrics)
+                      : 0;
+    }
+  }
+
+  float response_gap = DampingResponseGap(node, context.brush_size);
+  float& damped_value = context.damped_values[node.damping_index];
+  for (size_t i = 0; i < row.size(); ++i) {
+    float input = row[i];
+    if (IsNullBehaviorNodeValue(input)) {
+      // Input is null, so use previous damped value unchanged.
+    } else if (IsNullBehaviorNodeValue(damped_value) || snaps_to_input) {
+      damped_value = input;
+    } else {
+      damped_value =
+          DampOffsetTransition(input, damped_value, deltas[i], response_gap);
+    }
+    row[i] = damped_value;
+  }
+}
+
+// Runs a target node on `row`, writing the target modifier after each input
+// into its column of `context.target_modifiers_per_input`.
+void ApplyTargetNodeToRow(const TargetNodeImplementation& node,
+                          const BehaviorBatchContext& context,
+                          absl::Span<const float> row) {
+  size_t target_count = context.target_modifiers.size();
+  float& target_modifier = context.target_modifiers[node.target_index];
+  for (size_t i = 0; i < row.size(); ++i) {
+    if (!IsNullBehaviorNodeValue(row[i])) {
+      target_modifier = Lerp(node.target_modifier_range[0],
+                             node.target_modifier_range[1], row[i]);
+    }
+    context.target_modifiers_per_input[i * target_count + node.target_index] =
+        target_modifier;
+  }
 }
 
 }  // namespace
@@ -478,6 +638,241 @@ void ProcessBehaviorNode(const BehaviorNodeImplementation& node,
       node);
 }
 
+void BehaviorProgram::Clear() {
+  instructions_.clear();
+  source_nodes_.clear();
+  damping_nodes_.clear();
+  easings_.clear();
+  target_nodes_.clear();
+  stack_depth_ = 0;
+  register_count_ = 0;
+}
+
+void BehaviorProgram::Append(const BehaviorNodeImplementation& node) {
+  // The stack depth before and after the node, and the number of inputs that
+  // it pops off of the stack, determine the registers that it uses.
+  uint32_t input_count = 0;
+  uint32_t output_count = 1;
+  Instruction instruction;
+  std::visit(
+      absl::Overload(
+          [&](const BrushBehavior::SourceNode& node) {
+            instruction.opcode = Opcode::kSource;
+            instruction.operand = source_nodes_.size();
+            source_nodes_.push_back(node);
+          },
+          [&](const BrushBehavior::ConstantNode& node) {
+            instruction.opcode = Opcode::kConstant;
+            instruction.value = node.value;
+          },
+          [&](const BrushBehavior::FallbackFilterNode& node) {
+            instruction.opcode = Opcode::kFallbackFilter;
+            instruction.operand = static_cast<uint32_t>(node.is_fallback_for);
+            input_count = 1;
+          },
+          [&](const BrushBehavior::ToolTypeFilterNode& node) {
+            instruction.opcode = Opcode::kToolTypeFilter;
+            instruction.operand = ToolTypeMask(node.enabled_tool_types);
+            input_count = 1;
+          },
+          [&](const DampingNodeImplementation& node) {
+            instruction.opcode = Opcode::kDamping;
+            instruction.operand = damping_nodes_.size();
+            damping_nodes_.push_back(node);
+            input_count = 1;
+          },
+          [&](const EasingImplementation& node) {
+            instruction.opcode = Opcode::kResponse;
+            instruction.operand = easings_.size();
+            easings_.push_back(node);
+            input_count = 1;
+          },
+          [&](const BrushBehavior::BinaryOpNode& node) {
+            switch (node.operation) {
+              case BrushBehavior::BinaryOp::kProduct:
+                instruction.opcode = Opcode::kProduct;
+                break;
+              case BrushBehavior::BinaryOp::kSum:
+                instruction.opcode = Opcode::kSum;
+                break;
+            }
+            input_count = 2;
+          },
+          [&](const BrushBehavior::InterpolationNode& node) {
+            switch (node.interpolation) {
+              case BrushBehavior::Interpolation::kLerp:
+                instruction.opcode = Opcode::kLerp;
+                break;
+              case BrushBehavior::Interpolation::kInverseLerp:
+                instruction.opcode = Opcode::kInverseLerp;
+                break;
+            }
+            input_count = 3;
+          },
+          [&](const TargetNodeImplementation& node) {
+            instruction.opcode = Opcode::kTarget;
+            instruction.operand = target_nodes_.size();
+            target_nodes_.push_back(node);
+            input_count = 1;
+            output_count = 0;
+          }),
+      node);
+
+  ABSL_CHECK_GE(stack_depth_, input_count);
+  stack_depth_ -= input_count;
+  instruction.register_index = stack_depth_;
+  stack_depth_ += output_count;
+  register_count_ = std::max(register_count_, stack_depth_);
+  instructions_.push_back(instruction);
+}
+
+void BehaviorProgram::Run(const BehaviorNodeContext& context) const {
+  ABSL_DCHECK_GE(context.stack.size(), register_count_);
+  float* registers = context.stack.data();
+  for (const Instruction& instruction : instructions_) {
+    // The registers holding the inputs of the node, if any, the first of which
+    // also receives its output, if any.
+    float* values = registers + instruction.register_index;
+    switch (instruction.opcode) {
+      case Opcode::kSource:
+        values[0] =
+            SourceNodeValue(source_nodes_[instruction.operand], context);
+        break;
+      case Opcode::kConstant:
+        values[0] = instruction.value;
+        break;
+      case Opcode::kFallbackFilter:
+        if (IsOptionalInputPropertyPresent(
+                static_cast<BrushBehavior::OptionalInputProperty>(
+                    instruction.operand),
+                context.current_input)) {
+          values[0] = kNullBehaviorNodeValue;
+        }
+        break;
+      case Opcode::kToolTypeFilter: {
+        uint32_t tool_type_bit =
+            1u << static_cast<int>(context.input_modeler_state.tool_type);
+        if ((instruction.operand & tool_type_bit) == 0) {
+          values[0] = kNullBehaviorNodeValue;
+        }
+      } break;
+      case Opcode::kDamping:
+        values[0] = DampingNodeValue(damping_nodes_[instruction.operand],
+                                     values[0], context);
+        break;
+      case Opcode::kResponse:
+        values[0] = easings_[instruction.operand].GetY(values[0]);
+        break;
+      case Opcode::kProduct:
+        values[0] = BinaryOpNodeValue(BrushBehavior::BinaryOp::kProduct,
+                                      values[0], values[1]);
+        break;
+      case Opcode::kSum:
+        values[0] = BinaryOpNodeValue(BrushBehavior::BinaryOp::kSum, values[0],
+                                      values[1]);
+        break;
+      case Opcode::kLerp:
+        values[0] = InterpolationNodeValue(BrushBehavior::Interpolation::kLerp,
+                                           values[0], values[1], values[2]);
+        break;
+      case Opcode::kInverseLerp:
+        values[0] = InterpolationNodeValue(
+            BrushBehavior::Interpolation::kInverseLerp, values[0], values[1],
+            values[2]);
+        break;
+      case Opcode::kTarget:
+        ApplyTargetNode(target_nodes_[instruction.operand], values[0], context);
+        break;
+    }
+  }
+}
+
+void BehaviorProgram::RunBatch(const BehaviorBatchContext& context) const {
+  size_t input_count = context.inputs.size();
+  ABSL_DCHECK_EQ(context.travel_directions.size(), input_count);
+  // Target nodes only write the target modifiers for the inputs for which they
+  // are run, so start each row from the current ones.
+  size_t target_count = context.target_modifiers.size();
+  context.target_modifiers_per_input.resize(input_count * target_count);
+  for (size_t i = 0; i < input_count; ++i) {
+    absl::c_copy(context.target_modifiers,
+                 context.target_modifiers_per_input.begin() + i * target_count);
+  }
+  if (input_count == 0) return;
+
+  // Each register holds one row of values, and one more row is used as scratch
+  // space for damping nodes.
+  context.registers.resize((register_count_ + 1) * input_count);
+  auto row = [&context, input_count](uint32_t register_index) {
+    return absl::MakeSpan(context.registers)
+        .subspan(register_index * input_count, input_count);
+  };
+  absl::Span<float> scratch = row(register_count_);
+  for (const Instruction& instruction : instructions_) {
+    // The rows of the register holding the first input of the node, if any,
+    // which also receives its output, if any.
+    absl::Span<float> values = row(instruction.register_index);
+    switch (instruction.opcode) {
+      case Opcode::kSource: {
+        const BrushBehavior::SourceNode& node =
+            source_nodes_[instruction.operand];
+        for (size_t i = 0; i < input_count; ++i) {
+          values[i] = SourceNodeValue(node, context.inputs[i],
+                                      context.travel_directions[i],
+                                      context.brush_size,
+                                      context.input_modeler_state);
+        }
+      } break;
+      case Opcode::kConstant:
+        absl::c_fill(values, instruction.value);
+        break;
+      case Opcode::kFallbackFilter:
+        for (size_t i = 0; i < input_count; ++i) {
+          if (IsOptionalInputPropertyPresent(
+                  static_cast<BrushBehavior::OptionalInputProperty>(
+                      instruction.operand),
+                  context.inputs[i])) {
+            values[i] = kNullBehaviorNodeValue;
+          }
+        }
+        break;
+      case Opcode::kToolTypeFilter: {
+        // The tool type is the same for every input of the stroke.
+        uint32_t tool_type_bit =
+            1u << static_cast<int>(context.input_modeler_state.tool_type);
+        if ((instruction.operand & tool_type_bit) == 0) {
+          absl::c_fill(values, kNullBehaviorNodeValue);
+        }
+      } break;
+      case Opcode::kDamping:
+        DampRow(damping_nodes_[instruction.operand], context, values, scratch);
+        break;
+      case Opcode::kResponse: {
+        const EasingImplementation& easing = easings_[instruction.operand];
+        for (float& value : values) value = easing.GetY(value);
+      } break;
+      case Opcode::kProduct:
+        ProductOfRows(values, row(instruction.register_index + 1));
+        break;
+      case Opcode::kSum:
+        SumOfRows(values, row(instruction.register_index + 1));
+        break;
+      case Opcode::kLerp:
+        LerpOfRows(values, row(instruction.register_index + 1),
+                   row(instruction.register_index + 2));
+        break;
+      case Opcode::kInverseLerp:
+        InverseLerpOfRows(values, row(instruction.register_index + 1),
+                          row(instruction.register_index + 2));
+        break;
+      case Opcode::kTarget:
+        ApplyTargetNodeToRow(target_nodes_[instruction.operand], context,
+                             values);
+        break;
+    }
+  }
+}
+
 namespace {
 
 // Percentage shifts for each `BrushBehavior::Target` of a `BrushTipState`.
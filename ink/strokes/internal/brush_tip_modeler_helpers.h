@@ -18,6 +18,7 @@
 #include <array>
 #include <cmath>
 #include <cstddef>
+#include <cstdint>
 #include <limits>
 #include <optional>
 #include <variant>
@@ -86,6 +87,29 @@ struct BehaviorNodeContext {
   absl::Span<float> target_modifiers;
 };
 
+// Holds references to stroke data needed by `BehaviorProgram::RunBatch()` to
+// process a span of consecutive inputs at once, as well as references to
+// mutable state that that function will need to update.
+struct BehaviorBatchContext {
+  const StrokeInputModeler::State& input_modeler_state;
+  absl::Span<const ModeledStrokeInput> inputs;
+  // The travel direction at each element of `inputs`.
+  absl::Span<const std::optional<Angle>> travel_directions;
+  float brush_size;
+  // Distance/time from the start of the stroke up to the input before the first
+  // element of `inputs` (if any).
+  std::optional<InputMetrics> previous_input_metrics;
+  // Scratch space, which is resized as needed.
+  std::vector<float>& registers;
+  // The latest damped values and target modifiers, which are read before the
+  // first input and written after the last.
+  absl::Span<float> damped_values;
+  absl::Span<float> target_modifiers;
+  // Receives the target modifiers after each input, as one row of
+  // `target_modifiers.size()` values per input. It is resized as needed.
+  std::vector<float>& target_modifiers_per_input;
+};
+
 // Executes the specified node on the specified context. Note that although
 // `context` is a const reference, the mutable objects that `context` references
 // (`stack`, `damped_values`, and `target_modifiers`) will in general be
@@ -93,6 +117,91 @@ struct BehaviorNodeContext {
 void ProcessBehaviorNode(const BehaviorNodeImplementation& node,
                          const BehaviorNodeContext& context);
 
+// A sequence of behavior nodes lowered into a flat program, which gives the
+// same results as calling `ProcessBehaviorNode()` on each of the nodes in
+// order, starting with an empty stack.
+//
+// Since the depth of the stack before each node is known when the nodes are
+// appended, each element of the stack becomes a fixed register, and each node
+// becomes an instruction that reads its inputs from and writes its output to
+// fixed registers. Running the program therefore never resizes the stack, and
+// its instructions are plain structs dispatched by a single `switch`, rather
+// than `std::variant`s dispatched by `std::visit`.
+class BehaviorProgram {
+ public:
+  BehaviorProgram() = default;
+  BehaviorProgram(const BehaviorProgram&) = default;
+  BehaviorProgram(BehaviorProgram&&) = default;
+  BehaviorProgram& operator=(const BehaviorProgram&) = default;
+  BehaviorProgram& operator=(BehaviorProgram&&) = default;
+  ~BehaviorProgram() = default;
+
+  // Removes all nodes from the program.
+  void Clear();
+
+  // Appends `node` to the program. CHECK-fails if the nodes appended so far do
+  // not provide the inputs of `node`.
+  void Append(const BehaviorNodeImplementation& node);
+
+  // Returns the number of registers needed to run the program, which is the
+  // maximum depth of the stack when processing the nodes one at a time.
+  uint32_t RegisterCount() const { return register_count_; }
+
+  // Runs the program on `context`, using the first `RegisterCount()` elements
+  // of `context.stack` as registers. `context.stack` must have at least that
+  // many elements, and is not resized.
+  void Run(const BehaviorNodeContext& context) const;
+
+  // Runs the program on each of `context.inputs` in order, giving the same
+  // results as calling `Run()` once per input.
+  //
+  // Rather than running every instruction for one input before moving on to
+  // the next input, each instruction is run for every input before moving on
+  // to the next instruction. Each register then holds one value per input in a
+  // contiguous row, so that most instructions become simple loops over rows
+  // that the compiler can vectorize. Damping nodes, which are the only ones
+  // that carry state from one input to the next, become a scan over their row.
+  void RunBatch(const BehaviorBatchContext& context) const;
+
+ private:
+  enum class Opcode : uint8_t {
+    kSource,
+    kConstant,
+    kFallbackFilter,
+    kToolTypeFilter,
+    kDamping,
+    kResponse,
+    kProduct,
+    kSum,
+    kLerp,
+    kInverseLerp,
+    kTarget,
+  };
+
+  struct Instruction {
+    Opcode opcode = Opcode::kConstant;
+    // The register holding the first input of the node, if any, and receiving
+    // its output, if any. Further inputs are in the following registers.
+    uint32_t register_index = 0;
+    // For source, damping, response, and target nodes, the index of the node
+    // in the corresponding vector below. For fallback filter nodes, the
+    // `OptionalInputProperty`, and for tool type filter nodes, a mask with the
+    // bit `1 << tool_type` set for each enabled tool type.
+    uint32_t operand = 0;
+    // For constant nodes, the value.
+    float value = 0;
+  };
+
+  std::vector<Instruction> instructions_;
+  std::vector<BrushBehavior::SourceNode> source_nodes_;
+  std::vector<DampingNodeImplementation> damping_nodes_;
+  std::vector<EasingImplementation> easings_;
+  std::vector<TargetNodeImplementation> target_nodes_;
+  // The depth of the stack after the nodes appended so far, and its maximum.
+  uint32_t stack_depth_ = 0;
+  uint32_t register_count_ = 0;
+};
+
 // Constructs a `BrushTipState` at the given `position` using the non-behavior
 // parameters of `brush_tip` with `brush_size`, and then applies
 // `behavior_modifiers`.
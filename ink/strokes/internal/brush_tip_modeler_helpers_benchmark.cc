@@ -0,0 +1,205 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "benchmark/benchmark.h"
+#include "ink/brush/brush_behavior.h"
+#include "ink/brush/easing_function.h"
+#include "ink/geometry/angle.h"
+#include "ink/strokes/input/stroke_input.h"
+#include "ink/strokes/internal/brush_tip_modeler_helpers.h"
+#include "ink/strokes/internal/easing_implementation.h"
+#include "ink/strokes/internal/stroke_input_modeler.h"
+#include "ink/types/duration.h"
+
+namespace ink::strokes_internal {
+namespace {
+
+constexpr int kInputCount = 1000;
+
+// Returns the implementation of `behavior_count` behaviors, cycling through
+// the three behaviors of the multi-behavior brush in
+// `stroke_shape_builder_benchmark.cc`, as `BrushTipModeler` would lower them.
+// Each behavior has a damping node and a target node of its own.
+std::vector<BehaviorNodeImplementation> MakeBehaviorNodes(
+    int behavior_count) {
+  std::vector<EasingFunction> response_curves = {
+      {EasingFunction::Linear{{{0.2, 0.5}, {0.5, 0.5}}}},
+      {EasingFunction::Steps{
+          .step_count = 2,
+          .step_position = EasingFunction::StepPosition::kJumpNone,
+      }},
+      {EasingFunction::CubicBezier{.x1 = 0.3, .y1 = 0.2, .x2 = 0.2, .y2 = 1.4}},
+  };
+  std::vector<BehaviorNodeImplementation> nodes;
+  for (int i = 0; i < behavior_count; ++i) {
+    nodes.push_back(BrushBehavior::SourceNode{
+        .source =
+            BrushBehavior::Source::kDistanceTraveledInMultiplesOfBrushSize,
+        .source_out_of_range_behavior = BrushBehavior::OutOfRange::kRepeat,
+        .source_value_range = {0, 3.f + i},
+    });
+    nodes.push_back(DampingNodeImplementation{
+        .damping_index = static_cast<size_t>(i),
+        .damping_source =
+            BrushBehavior::DampingSource::kDistanceInMultiplesOfBrushSize,
+        .damping_gap = 0.5,
+    });
+    nodes.push_back(
+        EasingImplementation(response_curves[i % response_curves.size()]));
+    nodes.push_back(BrushBehavior::ConstantNode{.value = 0.5});
+    nodes.push_back(BrushBehavior::BinaryOpNode{
+        .operation = BrushBehavior::BinaryOp::kProduct,
+    });
+    nodes.push_back(TargetNodeImplementation{
+        .target_index = static_cast<size_t>(i),
+        .target_modifier_range = {0, 2},
+    });
+  }
+  return nodes;
+}
+
+std::vector<ModeledStrokeInput> MakeInputs() {
+  std::vector<ModeledStrokeInput> inputs;
+  inputs.reserve(kInputCount);
+  for (int i = 0; i < kInputCount; ++i) {
+    inputs.push_back({
+        .position = {0.5f * i, 0},
+        .velocity = {50, 0},
+        .traveled_distance = 0.5f * i,
+        .elapsed_time = Duration32::Millis(10 * i),
+        .pressure = 0.5,
+    });
+  }
+  return inputs;
+}
+
+// Evaluates `state.range(0)` behaviors for each of `kInputCount` inputs, one
+// node at a time with `ProcessBehaviorNode()`.
+void BM_ProcessBehaviorNodes(benchmark::State& state) {
+  std::vector<BehaviorNodeImplementation> nodes =
+      MakeBehaviorNodes(state.range(0));
+  std::vector<ModeledStrokeInput> inputs = MakeInputs();
+  StrokeInputModeler::State input_modeler_state = {
+      .tool_type = StrokeInput::ToolType::kStylus,
+  };
+  std::vector<float> stack;
+  std::vector<float> damped_values;
+  std::vector<float> target_modifiers(state.range(0));
+  for (auto s : state) {
+    damped_values.assign(state.range(0), kNullBehaviorNodeValue);
+    std::optional<InputMetrics> previous_input_metrics;
+    for (const ModeledStrokeInput& input : inputs) {
+      BehaviorNodeContext context = {
+          .input_modeler_state = input_modeler_state,
+          .current_input = input,
+          .brush_size = 1,
+          .previous_input_metrics = previous_input_metrics,
+          .stack = stack,
+          .damped_values = absl::MakeSpan(damped_values),
+          .target_modifiers = absl::MakeSpan(target_modifiers),
+      };
+      for (const BehaviorNodeImplementation& node : nodes) {
+        ProcessBehaviorNode(node, context);
+      }
+      benchmark::DoNotOptimize(target_modifiers);
+      previous_input_metrics = {.traveled_distance = input.traveled_distance,
+                                .elapsed_time = input.elapsed_time};
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kInputCount);
+}
+BENCHMARK(BM_ProcessBehaviorNodes)->Arg(1)->Arg(3)->Arg(12);
+
+// Evaluates the same behaviors as `BM_ProcessBehaviorNodes` with a
+// `BehaviorProgram`.
+void BM_BehaviorProgramRun(benchmark::State& state) {
+  BehaviorProgram program;
+  for (const BehaviorNodeImplementation& node :
+       MakeBehaviorNodes(state.range(0))) {
+    program.Append(node);
+  }
+  std::vector<ModeledStrokeInput> inputs = MakeInputs();
+  StrokeInputModeler::State input_modeler_state = {
+      .tool_type = StrokeInput::ToolType::kStylus,
+  };
+  std::vector<float> registers(program.RegisterCount());
+  std::vector<float> damped_values;
+  std::vector<float> target_modifiers(state.range(0));
+  for (auto s : state) {
+    damped_values.assign(state.range(0), kNullBehaviorNodeValue);
+    std::optional<InputMetrics> previous_input_metrics;
+    for (const ModeledStrokeInput& input : inputs) {
+      BehaviorNodeContext context = {
+          .input_modeler_state = input_modeler_state,
+          .current_input = input,
+          .brush_size = 1,
+          .previous_input_metrics = previous_input_metrics,
+          .stack = registers,
+          .damped_values = absl::MakeSpan(damped_values),
+          .target_modifiers = absl::MakeSpan(target_modifiers),
+      };
+      program.Run(context);
+      benchmark::DoNotOptimize(target_modifiers);
+      previous_input_metrics = {.traveled_distance = input.traveled_distance,
+                                .elapsed_time = input.elapsed_time};
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kInputCount);
+}
+BENCHMARK(BM_BehaviorProgramRun)->Arg(1)->Arg(3)->Arg(12);
+
+// Evaluates the same behaviors as `BM_ProcessBehaviorNodes` for all of the
+// inputs at once with `BehaviorProgram::RunBatch()`.
+void BM_BehaviorProgramRunBatch(benchmark::State& state) {
+  BehaviorProgram program;
+  for (const BehaviorNodeImplementation& node :
+       MakeBehaviorNodes(state.range(0))) {
+    program.Append(node);
+  }
+  std::vector<ModeledStrokeInput> inputs = MakeInputs();
+  std::vector<std::optional<Angle>> travel_directions(inputs.size());
+  StrokeInputModeler::State input_modeler_state = {
+      .tool_type = StrokeInput::ToolType::kStylus,
+  };
+  std::vector<float> registers;
+  std::vector<float> damped_values;
+  std::vector<float> target_modifiers(state.range(0));
+  std::vector<float> target_modifiers_per_input;
+  for (auto s : state) {
+    damped_values.assign(state.range(0), kNullBehaviorNodeValue);
+    BehaviorBatchContext context = {
+        .input_modeler_state = input_modeler_state,
+        .inputs = inputs,
+        .travel_directions = travel_directions,
+        .brush_size = 1,
+        .registers = registers,
+        .damped_values = absl::MakeSpan(damped_values),
+        .target_modifiers = absl::MakeSpan(target_modifiers),
+        .target_modifiers_per_input = target_modifiers_per_input,
+    };
+    program.RunBatch(context);
+    benchmark::DoNotOptimize(target_modifiers_per_input);
+  }
+  state.SetItemsProcessed(state.iterations() * kInputCount);
+}
+BENCHMARK(BM_BehaviorProgramRunBatch)->Arg(1)->Arg(3)->Arg(12);
+
+}  // namespace
+}  // namespace ink::strokes_internal
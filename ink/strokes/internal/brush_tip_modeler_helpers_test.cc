@@ -15,7 +15,9 @@
 #include "ink/strokes/internal/brush_tip_modeler_helpers.h"
 
 #include <cmath>
+#include <cstddef>
 #include <optional>
+#include <utility>
 #include <vector>
 
 #include "gmock/gmock.h"
@@ -42,6 +44,8 @@ namespace {
 using ::testing::ElementsAre;
 using ::testing::FloatNear;
 using ::testing::IsEmpty;
+using ::testing::NanSensitiveFloatEq;
+using ::testing::Pointwise;
 
 MATCHER(NullNodeValueMatcher, "") { return IsNullBehaviorNodeValue(arg); }
 
@@ -1217,6 +1221,289 @@ TEST_F(ProcessBehaviorNodeTest, TargetNode) {
   EXPECT_THAT(target_modifiers, ElementsAre(1.25f));
 }
 
+// Returns the nodes of behaviors that use every kind of node, with two damping
+// nodes and three target nodes.
+std::vector<BehaviorNodeImplementation> MakeBehaviorNodesOfEveryKind() {
+  return {
+      // Damped and eased pressure, with a fallback for when it is missing.
+      BrushBehavior::SourceNode{
+          .source = BrushBehavior::Source::kNormalizedPressure,
+          .source_value_range = {0, 1},
+      },
+      BrushBehavior::FallbackFilterNode{
+          .is_fallback_for = BrushBehavior::OptionalInputProperty::kTilt,
+      },
+      DampingNodeImplementation{
+          .damping_index = 0,
+          .damping_source = BrushBehavior::DampingSource::kTimeInSeconds,
+          .damping_gap = 0.5f,
+      },
+      EasingImplementation({EasingFunction::Predefined::kEaseInOut}),
+      TargetNodeImplementation{
+          .target_index = 0,
+          .target_modifier_range = {0.5f, 1.5f},
+      },
+      // Speed scaled by a constant, for styluses only.
+      BrushBehavior::SourceNode{
+          .source =
+              BrushBehavior::Source::kSpeedInMultiplesOfBrushSizePerSecond,
+          .source_value_range = {0, 10},
+      },
+      BrushBehavior::ConstantNode{.value = 2},
+      BrushBehavior::BinaryOpNode{
+          .operation = BrushBehavior::BinaryOp::kProduct,
+      },
+      BrushBehavior::ToolTypeFilterNode{
+          .enabled_tool_types = {.stylus = true},
+      },
+      TargetNodeImplementation{
+          .target_index = 1,
+          .target_modifier_range = {0, 1},
+      },
+      // Distance traveled, interpolated between sums of constants and the
+      // damped inverse interpolation of the time of input.
+      BrushBehavior::SourceNode{
+          .source =
+              BrushBehavior::Source::kDistanceTraveledInMultiplesOfBrushSize,
+          .source_out_of_range_behavior = BrushBehavior::OutOfRange::kMirror,
+          .source_value_range = {0, 4},
+      },
+      BrushBehavior::ConstantNode{.value = 0.25},
+      BrushBehavior::ConstantNode{.value = 0.5},
+      BrushBehavior::BinaryOpNode{.operation = BrushBehavior::BinaryOp::kSum},
+      BrushBehavior::SourceNode{
+          .source = BrushBehavior::Source::kTimeOfInputInSeconds,
+          .source_out_of_range_behavior = BrushBehavior::OutOfRange::kRepeat,
+          .source_value_range = {0, 1},
+      },
+      BrushBehavior::ConstantNode{.value = 0},
+      BrushBehavior::ConstantNode{.value = 2},
+      BrushBehavior::InterpolationNode{
+          .interpolation = BrushBehavior::Interpolation::kInverseLerp,
+      },
+      DampingNodeImplementation{
+          .damping_index = 1,
+          .damping_source =
+              BrushBehavior::DampingSource::kDistanceInMultiplesOfBrushSize,
+          .damping_gap = 1,
+      },
+      BrushBehavior::InterpolationNode{
+          .interpolation = BrushBehavior::Interpolation::kLerp,
+      },
+      TargetNodeImplementation{
+          .target_index = 2,
+          .target_modifier_range = {-1, 1},
+      },
+  };
+}
+
+TEST(BehaviorProgramTest, RegisterCountIsMaxStackDepth) {
+  BehaviorProgram program;
+  EXPECT_EQ(program.RegisterCount(), 0);
+
+  for (const BehaviorNodeImplementation& node :
+       MakeBehaviorNodesOfEveryKind()) {
+    program.Append(node);
+  }
+  // The last behavior has five values on the stack when its inverse
+  // interpolation node is reached.
+  EXPECT_EQ(program.RegisterCount(), 5);
+
+  program.Clear();
+  EXPECT_EQ(program.RegisterCount(), 0);
+}
+
+TEST(BehaviorProgramTest, MatchesProcessBehaviorNode) {
+  std::vector<BehaviorNodeImplementation> nodes =
+      MakeBehaviorNodesOfEveryKind();
+  BehaviorProgram program;
+  for (const BehaviorNodeImplementation& node : nodes) program.Append(node);
+
+  for (StrokeInput::ToolType tool_type :
+       {StrokeInput::ToolType::kStylus, StrokeInput::ToolType::kTouch}) {
+    StrokeInputModeler::State input_modeler_state = {.tool_type = tool_type};
+    std::vector<float> stack;
+    std::vector<float> damped_values(2, kNullBehaviorNodeValue);
+    std::vector<float> target_modifiers = {1, 0, 0};
+    std::vector<float> registers(program.RegisterCount());
+    std::vector<float> program_damped_values = damped_values;
+    std::vector<float> program_target_modifiers = target_modifiers;
+
+    std::optional<InputMetrics> previous_input_metrics;
+    for (int i = 0; i < 20; ++i) {
+      ModeledStrokeInput input = {
+          .velocity = {3.f * i, 4},
+          .traveled_distance = 0.7f * i,
+          .elapsed_time = Duration32::Seconds(0.15f * i),
+          // Pressure is missing for some inputs, and tilt is present for
+          // others, so that the fallback filter sometimes hides it.
+          .pressure = i % 5 == 0 ? StrokeInput::kNoPressure : 0.05f * i,
+          .tilt = i % 3 == 0 ? Angle::Degrees(10) : StrokeInput::kNoTilt,
+      };
+
+      BehaviorNodeContext context = {
+          .input_modeler_state = input_modeler_state,
+          .current_input = input,
+          .brush_size = 2,
+          .previous_input_metrics = previous_input_metrics,
+          .stack = stack,
+          .damped_values = absl::MakeSpan(damped_values),
+          .target_modifiers = absl::MakeSpan(target_modifiers),
+      };
+      for (const BehaviorNodeImplementation& node : nodes) {
+        ProcessBehaviorNode(node, context);
+      }
+      EXPECT_THAT(stack, IsEmpty());
+
+      BehaviorNodeContext program_context = {
+          .input_modeler_state = input_modeler_state,
+          .current_input = input,
+          .brush_size = 2,
+          .previous_input_metrics = previous_input_metrics,
+          .stack = registers,
+          .damped_values = absl::MakeSpan(program_damped_values),
+          .target_modifiers = absl::MakeSpan(program_target_modifiers),
+      };
+      program.Run(program_context);
+      EXPECT_EQ(registers.size(), program.RegisterCount());
+
+      EXPECT_THAT(program_damped_values,
+                  Pointwise(NanSensitiveFloatEq(), damped_values))
+          << "at input " << i;
+      EXPECT_THAT(program_target_modifiers,
+                  Pointwise(NanSensitiveFloatEq(), target_modifiers))
+          << "at input " << i;
+      previous_input_metrics = {
+          .traveled_distance = input.traveled_distance,
+          .elapsed_time = input.elapsed_time,
+      };
+    }
+  }
+}
+
+TEST(BehaviorProgramTest, RunBatchMatchesRun) {
+  BehaviorProgram program;
+  for (const BehaviorNodeImplementation& node :
+       MakeBehaviorNodesOfEveryKind()) {
+    program.Append(node);
+  }
+  std::vector<ModeledStrokeInput> inputs;
+  for (int i = 0; i < 20; ++i) {
+    inputs.push_back({
+        .velocity = {3.f * i, 4},
+        .traveled_distance = 0.7f * i,
+        .elapsed_time = Duration32::Seconds(0.15f * i),
+        .pressure = i % 5 == 0 ? StrokeInput::kNoPressure : 0.05f * i,
+        .tilt = i % 3 == 0 ? Angle::Degrees(10) : StrokeInput::kNoTilt,
+    });
+  }
+  std::vector<std::optional<Angle>> travel_directions(inputs.size());
+
+  for (StrokeInput::ToolType tool_type :
+       {StrokeInput::ToolType::kStylus, StrokeInput::ToolType::kTouch}) {
+    StrokeInputModeler::State input_modeler_state = {.tool_type = tool_type};
+
+    // Run the program on one input at a time.
+    std::vector<float> registers(program.RegisterCount());
+    std::vector<float> damped_values(2, kNullBehaviorNodeValue);
+    std::vector<float> target_modifiers = {1, 0, 0};
+    std::vector<float> expected_target_modifiers_per_input;
+    std::optional<InputMetrics> previous_input_metrics;
+    for (const ModeledStrokeInput& input : inputs) {
+      program.Run({
+          .input_modeler_state = input_modeler_state,
+          .current_input = input,
+          .brush_size = 2,
+          .previous_input_metrics = previous_input_metrics,
+          .stack = registers,
+          .damped_values = absl::MakeSpan(damped_values),
+          .target_modifiers = absl::MakeSpan(target_modifiers),
+      });
+      expected_target_modifiers_per_input.insert(
+          expected_target_modifiers_per_input.end(), target_modifiers.begin(),
+          target_modifiers.end());
+      previous_input_metrics = {
+          .traveled_distance = input.traveled_distance,
+          .elapsed_time = input.elapsed_time,
+      };
+    }
+
+    // Run the program on two batches of inputs, the second of which continues
+    // from where the first left off.
+    std::vector<float> batch_registers;
+    std::vector<float> batch_damped_values(2, kNullBehaviorNodeValue);
+    std::vector<float> batch_target_modifiers = {1, 0, 0};
+    std::vector<float> target_modifiers_per_input;
+    std::vector<float> all_target_modifiers_per_input;
+    for (auto [begin, end] : {std::pair<size_t, size_t>{0, 7}, {7, 20}}) {
+      program.RunBatch({
+          .input_modeler_state = input_modeler_state,
+          .inputs = absl::MakeConstSpan(inputs).subspan(begin, end - begin),
+          .travel_directions = absl::MakeConstSpan(travel_directions)
+                                   .subspan(begin, end - begin),
+          .brush_size = 2,
+          .previous_input_metrics =
+              begin == 0 ? std::nullopt
+                         : std::optional<InputMetrics>({
+                               .traveled_distance =
+                                   inputs[begin - 1].traveled_distance,
+                               .elapsed_time = inputs[begin - 1].elapsed_time,
+                           }),
+          .registers = batch_registers,
+          .damped_values = absl::MakeSpan(batch_damped_values),
+          .target_modifiers = absl::MakeSpan(batch_target_modifiers),
+          .target_modifiers_per_input = target_modifiers_per_input,
+      });
+      EXPECT_EQ(target_modifiers_per_input.size(), (end - begin) * 3);
+      all_target_modifiers_per_input.insert(
+          all_target_modifiers_per_input.end(),
+          target_modifiers_per_input.begin(), target_modifiers_per_input.end());
+    }
+
+    EXPECT_THAT(all_target_modifiers_per_input,
+                Pointwise(NanSensitiveFloatEq(),
+                          expected_target_modifiers_per_input));
+    EXPECT_THAT(batch_damped_values,
+                Pointwise(NanSensitiveFloatEq(), damped_values));
+    EXPECT_THAT(batch_target_modifiers,
+                Pointwise(NanSensitiveFloatEq(), target_modifiers));
+  }
+}
+
+TEST(BehaviorProgramTest, RunBatchWithNoInputs) {
+  BehaviorProgram program;
+  for (const BehaviorNodeImplementation& node :
+       MakeBehaviorNodesOfEveryKind()) {
+    program.Append(node);
+  }
+  StrokeInputModeler::State input_modeler_state;
+  std::vector<float> registers;
+  std::vector<float> damped_values = {0.5, kNullBehaviorNodeValue};
+  std::vector<float> target_modifiers = {1, 0, 0.25};
+  std::vector<float> target_modifiers_per_input = {1, 2, 3};
+  program.RunBatch({
+      .input_modeler_state = input_modeler_state,
+      .brush_size = 2,
+      .registers = registers,
+      .damped_values = absl::MakeSpan(damped_values),
+      .target_modifiers = absl::MakeSpan(target_modifiers),
+      .target_modifiers_per_input = target_modifiers_per_input,
+  });
+  EXPECT_THAT(target_modifiers_per_input, IsEmpty());
+  EXPECT_THAT(damped_values, Pointwise(NanSensitiveFloatEq(),
+                                       {0.5f, kNullBehaviorNodeValue}));
+  EXPECT_THAT(target_modifiers, ElementsAre(1, 0, 0.25));
+}
+
+TEST(BehaviorProgramDeathTest, NodeWithoutInputs) {
+  BehaviorProgram program;
+  program.Append(BrushBehavior::ConstantNode{.value = 1});
+  EXPECT_DEATH_IF_SUPPORTED(
+      program.Append(BrushBehavior::BinaryOpNode{
+          .operation = BrushBehavior::BinaryOp::kSum}),
+      "");
+}
+
 TEST(CreateTipStateTest, HasPassedInPosition) {
   EXPECT_THAT(CreateTipState({0, 0}, Angle(), BrushTip{}, 1.f, {}, {}).position,
               PointEq({0, 0}));
@@ -40,6 +40,8 @@ Vec CubicBezierValue(Vec v1, Vec v2, float t) {
   return c1 * v1 + c2 * v2 + Vec({c3, c3});
 }
 
+}  // namespace
+
 EasingFunction::CubicBezier GetAsCubicBezierParameters(
     const EasingFunction::Predefined predefined) {
   switch (predefined) {
@@ -62,8 +64,6 @@ EasingFunction::CubicBezier GetAsCubicBezierParameters(
       << absl::StrCat(predefined);
 }
 
-}  // namespace
-
 EasingImplementation::EasingImplementation(const EasingFunction& ease) {
   std::visit([this](const auto& arg) { SetUpImplementationType(arg); },
              ease.parameters);
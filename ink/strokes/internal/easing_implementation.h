@@ -24,6 +24,12 @@
 
 namespace ink::strokes_internal {
 
+// Returns the control points of `predefined`, which must be one of the
+// predefined cubic Bezier easing functions, i.e. not `kLinear`, `kStepStart`,
+// or `kStepEnd`.
+EasingFunction::CubicBezier GetAsCubicBezierParameters(
+    EasingFunction::Predefined predefined);
+
 // Implementation for an `EasingFunction` based on a constant-sized inline
 // look-up table for constant-time x->y mapping.
 class EasingImplementation {
@@ -0,0 +1,90 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "ink/brush/easing_function.h"
+#include "ink/strokes/internal/easing_implementation.h"
+#include "ink/strokes/internal/easing_test_helpers.h"
+
+namespace ink::strokes_internal {
+namespace {
+
+constexpr int kSampleCount = 1000;
+
+// Returns the easing function selected by `index`: two cubic Beziers, a
+// piecewise linear function, and a step function.
+EasingFunction MakeEasingFunction(int index) {
+  switch (index) {
+    case 0:
+      return {EasingFunction::Predefined::kEaseInOut};
+    case 1:
+      return {EasingFunction::CubicBezier{
+          .x1 = 0.3, .y1 = 0.2, .x2 = 0.2, .y2 = 1.4}};
+    case 2:
+      return {EasingFunction::Linear{{{0.125, 0.3},
+                                      {0.25, 0.5},
+                                      {0.5, 0.5},
+                                      {0.625, 0.9},
+                                      {0.875, 0.2}}}};
+    default:
+      return {EasingFunction::Steps{
+          .step_count = 4,
+          .step_position = EasingFunction::StepPosition::kJumpNone,
+      }};
+  }
+}
+
+// Returns `kSampleCount` x values spread over the unit interval, in an order
+// that does not favor the branch predictor.
+std::vector<float> MakeSamples() {
+  std::vector<float> samples;
+  samples.reserve(kSampleCount);
+  for (int i = 0; i < kSampleCount; ++i) {
+    samples.push_back(static_cast<float>((i * 617) % kSampleCount) /
+                      (kSampleCount - 1));
+  }
+  return samples;
+}
+
+// Measures the throughput of `GetY()`, and reports the maximum error against
+// `ExactEasingY()` over the unit interval as a counter.
+void BM_GetY(benchmark::State& state) {
+  EasingFunction easing_function = MakeEasingFunction(state.range(0));
+  EasingImplementation easing_implementation(easing_function);
+  std::vector<float> samples = MakeSamples();
+  for (auto s : state) {
+    for (float x : samples) {
+      benchmark::DoNotOptimize(easing_implementation.GetY(x));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kSampleCount);
+
+  float max_error = 0;
+  for (int i = 0; i <= 10 * kSampleCount; ++i) {
+    float x = static_cast<float>(i) / (10 * kSampleCount);
+    max_error = std::max(
+        max_error,
+        std::abs(easing_implementation.GetY(x) -
+                 ExactEasingY(easing_function, x)));
+  }
+  state.counters["max_error"] = max_error;
+}
+BENCHMARK(BM_GetY)->DenseRange(0, 3);
+
+}  // namespace
+}  // namespace ink::strokes_internal
@@ -14,6 +14,8 @@
 
 #include "ink/strokes/internal/easing_implementation.h"
 
+#include <algorithm>
+#include <cmath>
 #include <limits>
 
 #include "gmock/gmock.h"
@@ -22,6 +24,7 @@
 #include "absl/container/inlined_vector.h"
 #include "ink/brush/easing_function.h"
 #include "ink/brush/fuzz_domains.h"
+#include "ink/strokes/internal/easing_test_helpers.h"
 
 namespace ink::strokes_internal {
 namespace {
@@ -482,6 +485,69 @@ TEST(EasingImplementationTest, CriticalPointsStepsMoreThanOneStep) {
                           FloatNear(1.f, 0.01)));
 }
 
+// Returns the maximum difference between `GetY()` and `ExactEasingY()` for x in
+// [0, 1].
+float MaxErrorInUnitInterval(const EasingFunction& easing_function) {
+  EasingImplementation easing_implementation(easing_function);
+  float max_error = 0;
+  for (int i = 0; i <= 1000; ++i) {
+    float x = i / 1000.f;
+    max_error =
+        std::max(max_error, std::abs(easing_implementation.GetY(x) -
+                                     ExactEasingY(easing_function, x)));
+  }
+  return max_error;
+}
+
+TEST(EasingImplementationTest, GetExactYForCubicBezier) {
+  EasingFunction ease = {EasingFunction::Predefined::kEase};
+  EXPECT_FLOAT_EQ(ExactEasingY(ease, -0.1f), 0);
+  EXPECT_FLOAT_EQ(ExactEasingY(ease, 0), 0);
+  EXPECT_THAT(ExactEasingY(ease, 0.1f), FloatNear(0.09480f, 0.00001f));
+  EXPECT_THAT(ExactEasingY(ease, 0.6f), FloatNear(0.88523f, 0.00001f));
+  EXPECT_FLOAT_EQ(ExactEasingY(ease, 1), 1);
+  EXPECT_FLOAT_EQ(ExactEasingY(ease, 1.2f), 1);
+  EXPECT_THAT(ExactEasingY(ease, kNan), IsNan());
+}
+
+TEST(EasingImplementationTest, GetExactYForSteps) {
+  EasingFunction steps = {EasingFunction::Steps{
+      .step_count = 3,
+      .step_position = EasingFunction::StepPosition::kJumpEnd,
+  }};
+  EXPECT_FLOAT_EQ(ExactEasingY(steps, -0.5f), 0);
+  EXPECT_FLOAT_EQ(ExactEasingY(steps, 0.2f), 0);
+  EXPECT_FLOAT_EQ(ExactEasingY(steps, 0.5f), 1.f / 3);
+  EXPECT_FLOAT_EQ(ExactEasingY(steps, 0.9f), 2.f / 3);
+  EXPECT_FLOAT_EQ(ExactEasingY(steps, 1), 1);
+  EXPECT_FLOAT_EQ(ExactEasingY(steps, 1.5f), 1);
+}
+
+TEST(EasingImplementationTest, GetExactYForLinear) {
+  EasingFunction linear = {EasingFunction::Linear{{{0.25, 0.5}}}};
+  EXPECT_FLOAT_EQ(ExactEasingY(linear, 0), 0);
+  EXPECT_FLOAT_EQ(ExactEasingY(linear, 0.2f), 0.4f);
+  EXPECT_FLOAT_EQ(ExactEasingY(linear, 0.25f), 0.5f);
+  EXPECT_FLOAT_EQ(ExactEasingY(linear, 0.55f), 0.7f);
+  EXPECT_FLOAT_EQ(ExactEasingY(linear, 1), 1);
+  EXPECT_THAT(ExactEasingY(linear, kNan), IsNan());
+}
+
+TEST(EasingImplementationTest, CubicBezierApproximationIsCloseToExactCurve) {
+  EXPECT_LT(MaxErrorInUnitInterval({EasingFunction::Predefined::kEase}), 0.01f);
+  EXPECT_LT(MaxErrorInUnitInterval({EasingFunction::Predefined::kEaseIn}),
+            0.01f);
+  EXPECT_LT(MaxErrorInUnitInterval({EasingFunction::Predefined::kEaseOut}),
+            0.01f);
+  EXPECT_LT(MaxErrorInUnitInterval({EasingFunction::Predefined::kEaseInOut}),
+            0.01f);
+  // Curves that overshoot bend more sharply, so the error of the linear
+  // interpolation between table entries is larger.
+  EXPECT_LT(MaxErrorInUnitInterval({EasingFunction::CubicBezier{
+                .x1 = 0.3, .y1 = 0.2, .x2 = 0.2, .y2 = 1.4}}),
+            0.02f);
+}
+
 void EasingImplementationDoesNotCrash(const EasingFunction& easing_function,
                                       float x) {
   EasingImplementation easing_implementation(easing_function);
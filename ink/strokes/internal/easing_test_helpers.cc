@@ -0,0 +1,93 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ink/strokes/internal/easing_test_helpers.h"
+
+#include <cmath>
+#include <optional>
+#include <variant>
+
+#include "ink/brush/easing_function.h"
+#include "ink/strokes/internal/easing_implementation.h"
+
+namespace ink::strokes_internal {
+namespace {
+
+// Returns the cubic Bezier parameters of `ease`, if it is a cubic Bezier.
+std::optional<EasingFunction::CubicBezier> GetCubicBezierParameters(
+    const EasingFunction& ease) {
+  if (const auto* cubic_bezier =
+          std::get_if<EasingFunction::CubicBezier>(&ease.parameters)) {
+    return *cubic_bezier;
+  }
+  if (const auto* predefined =
+          std::get_if<EasingFunction::Predefined>(&ease.parameters)) {
+    switch (*predefined) {
+      case EasingFunction::Predefined::kLinear:
+      case EasingFunction::Predefined::kStepStart:
+      case EasingFunction::Predefined::kStepEnd:
+        return std::nullopt;
+      case EasingFunction::Predefined::kEase:
+      case EasingFunction::Predefined::kEaseIn:
+      case EasingFunction::Predefined::kEaseOut:
+      case EasingFunction::Predefined::kEaseInOut:
+        return GetAsCubicBezierParameters(*predefined);
+    }
+  }
+  return std::nullopt;
+}
+
+// Returns one component of the cubic Bezier with control values 0, `p1`, `p2`,
+// and 1 at parameter `t`.
+double CubicBezierComponent(double p1, double p2, double t) {
+  return 3 * (1 - t) * (1 - t) * t * p1 + 3 * (1 - t) * t * t * p2 + t * t * t;
+}
+
+// Returns the y value of the cubic Bezier easing function at `x`, which is
+// clamped to [0, 1], by solving for the parameter at which the curve has that
+// x value.
+float SolveCubicBezierY(const EasingFunction::CubicBezier& cubic_bezier,
+                        float x) {
+  if (std::isnan(x)) return x;
+  if (x <= 0) return 0;
+  if (x >= 1) return 1;
+  // Since the x values of the control points are in [0, 1], the x component of
+  // the curve is non-decreasing, so the parameter can be found by bisection.
+  // Each iteration halves the interval, so this is well below float precision.
+  constexpr int kIterationCount = 40;
+  double t_min = 0;
+  double t_max = 1;
+  for (int i = 0; i < kIterationCount; ++i) {
+    double t = 0.5 * (t_min + t_max);
+    if (CubicBezierComponent(cubic_bezier.x1, cubic_bezier.x2, t) < x) {
+      t_min = t;
+    } else {
+      t_max = t;
+    }
+  }
+  return CubicBezierComponent(cubic_bezier.y1, cubic_bezier.y2,
+                              0.5 * (t_min + t_max));
+}
+
+}  // namespace
+
+float ExactEasingY(const EasingFunction& ease, float x) {
+  if (std::optional<EasingFunction::CubicBezier> cubic_bezier =
+          GetCubicBezierParameters(ease)) {
+    return SolveCubicBezierY(*cubic_bezier, x);
+  }
+  return EasingImplementation(ease).GetY(x);
+}
+
+}  // namespace ink::strokes_internal
@@ -0,0 +1,30 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef INK_STROKES_INTERNAL_EASING_TEST_HELPERS_H_
+#define INK_STROKES_INTERNAL_EASING_TEST_HELPERS_H_
+
+#include "ink/brush/easing_function.h"
+
+namespace ink::strokes_internal {
+
+// Returns the value of `ease` at `x`. Unlike `EasingImplementation::GetY()`,
+// this solves for the exact value of cubic Bezier functions, rather than
+// interpolating in the approximation's table, so it is much slower. It is meant
+// as a reference for measuring the error of `GetY()`.
+float ExactEasingY(const EasingFunction& ease, float x);
+
+}  // namespace ink::strokes_internal
+
+#endif  // INK_STROKES_INTERNAL_EASING_TEST_HELPERS_H_
@@ -16,6 +16,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <vector>
 
 #include "absl/log/absl_check.h"
 #include "absl/types/span.h"
@@ -25,6 +26,8 @@
 #include "ink/strokes/input/stroke_input_batch.h"
 #include "ink/strokes/internal/brush_tip_extruder.h"
 #include "ink/strokes/internal/brush_tip_modeler.h"
+#include "ink/strokes/internal/brush_tip_state.h"
+#include "ink/strokes/internal/stroke_input_modeler.h"
 #include "ink/strokes/internal/stroke_outline.h"
 #include "ink/strokes/internal/stroke_shape_update.h"
 #include "ink/types/duration.h"
@@ -88,6 +91,19 @@ StrokeShapeUpdate StrokeShapeBuilder::ExtendStroke(
     const StrokeInputBatch& predicted_inputs, Duration32 current_elapsed_time) {
   input_modeler_.ExtendStroke(real_inputs, predicted_inputs,
                               current_elapsed_time);
+  return UpdateTips(input_modeler_.GetState(),
+                    input_modeler_.GetModeledInputs());
+}
+
+StrokeShapeUpdate StrokeShapeBuilder::ExtendStrokeWithModeledInputs(
+    const StrokeInputModeler::State& input_modeler_state,
+    absl::Span<const ModeledStrokeInput> modeled_inputs) {
+  return UpdateTips(input_modeler_state, modeled_inputs);
+}
+
+StrokeShapeUpdate StrokeShapeBuilder::UpdateTips(
+    const StrokeInputModeler::State& input_modeler_state,
+    absl::Span<const ModeledStrokeInput> modeled_inputs) {
   StrokeShapeUpdate update;
   mesh_bounds_.Reset();
 
@@ -99,22 +115,57 @@ StrokeShapeUpdate StrokeShapeBuilder::ExtendStroke(
   for (uint32_t i = 0; i < tip_count_; ++i) {
     BrushTipModeler& tip_modeler = tips_[i].modeler;
     BrushTipExtruder& tip_extruder = tips_[i].extruder;
-    tip_modeler.UpdateStroke(input_modeler_.GetState(),
-                             input_modeler_.GetModeledInputs());
+    tip_modeler.UpdateStroke(input_modeler_state, modeled_inputs);
     update.Add(tip_extruder.ExtendStroke(tip_modeler.NewFixedTipStates(),
                                          tip_modeler.VolatileTipStates()));
-    mesh_bounds_.Add(tip_extruder.GetBounds());
-    for (const StrokeOutline& outline : tip_extruder.GetOutlines()) {
-      const absl::Span<const uint32_t>& indices = outline.GetIndices();
-      if (!indices.empty()) {
-        outlines_.push_back(indices);
-      }
-    }
+    AddTipBoundsAndOutlines(tip_extruder);
+  }
+
+  return update;
+}
+
+void StrokeShapeBuilder::GetTipStates(
+    std::vector<TipStates>& tip_states) const {
+  tip_states.resize(tip_count_);
+  for (uint32_t i = 0; i < tip_count_; ++i) {
+    // The stroke was built with a single update, so all of its fixed tip states
+    // are new.
+    absl::Span<const BrushTipState> fixed =
+        tips_[i].modeler.NewFixedTipStates();
+    absl::Span<const BrushTipState> volatile_states =
+        tips_[i].modeler.VolatileTipStates();
+    tip_states[i].fixed.assign(fixed.begin(), fixed.end());
+    tip_states[i].volatile_states.assign(volatile_states.begin(),
+                                         volatile_states.end());
   }
+}
 
+StrokeShapeUpdate StrokeShapeBuilder::ExtendStrokeWithTipStates(
+    absl::Span<const TipStates> tip_states) {
+  ABSL_CHECK_EQ(tip_states.size(), tip_count_);
+  StrokeShapeUpdate update;
+  mesh_bounds_.Reset();
+  outlines_.clear();
+  for (uint32_t i = 0; i < tip_count_; ++i) {
+    BrushTipExtruder& tip_extruder = tips_[i].extruder;
+    update.Add(tip_extruder.ExtendStroke(tip_states[i].fixed,
+                                         tip_states[i].volatile_states));
+    AddTipBoundsAndOutlines(tip_extruder);
+  }
   return update;
 }
 
+void StrokeShapeBuilder::AddTipBoundsAndOutlines(
+    const BrushTipExtruder& tip_extruder) {
+  mesh_bounds_.Add(tip_extruder.GetBounds());
+  for (const StrokeOutline& outline : tip_extruder.GetOutlines()) {
+    const absl::Span<const uint32_t>& indices = outline.GetIndices();
+    if (!indices.empty()) {
+      outlines_.push_back(indices);
+    }
+  }
+}
+
 bool StrokeShapeBuilder::HasUnfinishedTimeBehaviors() const {
   // `tips_` may have additional elements (for allocation caching reasons),
   // which should be ignored for this brush.
@@ -17,6 +17,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <vector>
 
 #include "absl/container/inlined_vector.h"
 #include "absl/types/span.h"
@@ -27,6 +28,7 @@
 #include "ink/strokes/input/stroke_input_batch.h"
 #include "ink/strokes/internal/brush_tip_extruder.h"
 #include "ink/strokes/internal/brush_tip_modeler.h"
+#include "ink/strokes/internal/brush_tip_state.h"
 #include "ink/strokes/internal/stroke_input_modeler.h"
 #include "ink/strokes/internal/stroke_outline.h"
 #include "ink/strokes/internal/stroke_shape_update.h"
@@ -86,6 +88,44 @@ class StrokeShapeBuilder {
                                  const StrokeInputBatch& predicted_inputs,
                                  Duration32 current_elapsed_time);
 
+  // Builds the complete shape of the current stroke from inputs that have
+  // already been modeled, skipping input modeling.
+  //
+  // `input_modeler_state` and `modeled_inputs` must be the complete result of
+  // modeling all of the inputs of the stroke with no predicted inputs, using
+  // the `input_model` and `brush_epsilon` that were passed to `StartStroke()`.
+  // This allows the same modeled inputs to be reused for each brush coat, and
+  // when regenerating a stroke with a different brush size or brush tips. This
+  // must be called at most once per stroke, instead of `ExtendStroke()`, and
+  // `HasUnfinishedTimeBehaviors()` must not be called for such a stroke.
+  StrokeShapeUpdate ExtendStrokeWithModeledInputs(
+      const StrokeInputModeler::State& input_modeler_state,
+      absl::Span<const ModeledStrokeInput> modeled_inputs);
+
+  // The brush tip states modeled for one brush tip over all of the inputs of a
+  // stroke; see `GetTipStates()`.
+  struct TipStates {
+    std::vector<BrushTipState> fixed;
+    std::vector<BrushTipState> volatile_states;
+  };
+
+  // Replaces the contents of `tip_states` with the tip states of each brush tip
+  // of the current stroke, which must have been built with a single call to
+  // `ExtendStrokeWithModeledInputs()`.
+  void GetTipStates(std::vector<TipStates>& tip_states) const;
+
+  // Builds the complete shape of the current stroke from brush tip states that
+  // have already been modeled, skipping both input and brush tip modeling.
+  //
+  // `tip_states` must be the result of `GetTipStates()` for a stroke started
+  // with the same `input_model`, brush tips and `brush_size`, and built from
+  // the same modeled inputs. Brush tip modeling doesn't depend on
+  // `brush_epsilon`, so only that may differ, e.g. to extrude a coarser version
+  // of the same shape. The same restrictions as for
+  // `ExtendStrokeWithModeledInputs()` apply.
+  StrokeShapeUpdate ExtendStrokeWithTipStates(
+      absl::Span<const TipStates> tip_states);
+
   // Returns true if any of the brush tips for this builder have any behaviors
   // whose source values could continue to change with the further passage of
   // time (even in the absence of any new inputs).
@@ -102,10 +142,25 @@ class StrokeShapeBuilder {
   // public `InProgressStroke::GetCoatOutlines()` for more details.
   absl::Span<const absl::Span<const uint32_t>> GetOutlines() const;
 
+  // Returns the number of triangles at the start of the mesh that are
+  // guaranteed to not change with further calls to `ExtendStroke()`. See
+  // `Geometry::NStableTriangles()`.
+  uint32_t GetStableTriangleCount() const;
+
  private:
   // Returns the number of brush tips being used to extrude the current shape.
   uint32_t BrushTipCount() const;
 
+  // Updates the tip modelers and extruders with the modeled inputs for the
+  // current stroke.
+  StrokeShapeUpdate UpdateTips(
+      const StrokeInputModeler::State& input_modeler_state,
+      absl::Span<const ModeledStrokeInput> modeled_inputs);
+
+  // Adds the bounds and outlines of the tip extruded by `tip_extruder` to
+  // `mesh_bounds_` and `outlines_`.
+  void AddTipBoundsAndOutlines(const BrushTipExtruder& tip_extruder);
+
   StrokeInputModeler input_modeler_;
   MutableMesh mesh_;
   Envelope mesh_bounds_;
@@ -147,6 +202,11 @@ StrokeShapeBuilder::GetOutlines() const {
   return outlines_;
 }
 
+inline uint32_t StrokeShapeBuilder::GetStableTriangleCount() const {
+  // Only the first tip's triangles are at the start of the mesh.
+  return tip_count_ == 0 ? 0 : tips_[0].extruder.GetStableTriangleCount();
+}
+
 inline uint32_t StrokeShapeBuilder::BrushTipCount() const { return tip_count_; }
 
 }  // namespace ink::strokes_internal
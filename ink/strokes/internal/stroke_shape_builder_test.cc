@@ -16,6 +16,7 @@
 
 #include <cstdint>
 #include <optional>
+#include <vector>
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
@@ -30,6 +31,7 @@
 #include "ink/geometry/mutable_mesh.h"
 #include "ink/geometry/type_matchers.h"
 #include "ink/strokes/input/stroke_input_batch.h"
+#include "ink/strokes/internal/stroke_input_modeler.h"
 #include "ink/strokes/internal/stroke_shape_update.h"
 #include "ink/strokes/internal/stroke_vertex.h"
 #include "ink/types/duration.h"
@@ -39,6 +41,7 @@ namespace {
 
 using ::ink::geometry_internal::CalculateEnvelope;
 using ::testing::ElementsAre;
+using ::testing::ElementsAreArray;
 using ::testing::Eq;
 using ::testing::Gt;
 using ::testing::IsEmpty;
@@ -156,6 +159,50 @@ TEST(StrokeShapeBuilderTest, StartAfterExtendEmptiesMeshAndOutline) {
   EXPECT_THAT(builder.GetOutlines(), IsEmpty());
 }
 
+TEST(StrokeShapeBuilderTest,
+     ExtendWithTipStatesMatchesExtendWithModeledInputs) {
+  BrushCoat brush_coat{.tips = {BrushTip{.scale = {1, 0.5}}}, .paint = {}};
+  absl::StatusOr<StrokeInputBatch> inputs = StrokeInputBatch::Create({
+      {.position = {5, 7}, .elapsed_time = Duration32::Zero()},
+      {.position = {6, 8}, .elapsed_time = Duration32::Seconds(1. / 60)},
+      {.position = {8, 8}, .elapsed_time = Duration32::Seconds(2. / 60)},
+      {.position = {9, 6}, .elapsed_time = Duration32::Seconds(3. / 60)},
+  });
+  ASSERT_EQ(inputs.status(), absl::OkStatus());
+  StrokeInputModeler input_modeler;
+  input_modeler.StartStroke(BrushFamily::DefaultInputModel(), 0.1);
+  input_modeler.ExtendStroke(*inputs, {}, inputs->GetDuration());
+
+  // Tip modeling doesn't depend on the epsilon, so the tip states can be
+  // extruded with a different one.
+  StrokeShapeBuilder builder;
+  builder.StartStroke(BrushFamily::DefaultInputModel(), brush_coat, 10, 0.4);
+  builder.ExtendStrokeWithModeledInputs(input_modeler.GetState(),
+                                        input_modeler.GetModeledInputs());
+  std::vector<StrokeShapeBuilder::TipStates> tip_states;
+  builder.GetTipStates(tip_states);
+  ASSERT_EQ(tip_states.size(), 1u);
+  EXPECT_THAT(tip_states[0].fixed, Not(IsEmpty()));
+
+  StrokeShapeBuilder tip_states_builder;
+  tip_states_builder.StartStroke(BrushFamily::DefaultInputModel(), brush_coat,
+                                 10, 0.4);
+  StrokeShapeUpdate update =
+      tip_states_builder.ExtendStrokeWithTipStates(tip_states);
+
+  EXPECT_FALSE(update.region.IsEmpty());
+  EXPECT_THAT(tip_states_builder.GetMesh().RawVertexData(),
+              ElementsAreArray(builder.GetMesh().RawVertexData()));
+  EXPECT_THAT(tip_states_builder.GetMesh().RawIndexData(),
+              ElementsAreArray(builder.GetMesh().RawIndexData()));
+  EXPECT_THAT(tip_states_builder.GetMeshBounds().AsRect(),
+              Optional(RectNear(*builder.GetMeshBounds().AsRect(), 0.0001)));
+  ASSERT_EQ(tip_states_builder.GetOutlines().size(),
+            builder.GetOutlines().size());
+  EXPECT_THAT(tip_states_builder.GetOutlines()[0],
+              ElementsAreArray(builder.GetOutlines()[0]));
+}
+
 TEST(StrokeShapeBuilderTest, NonTexturedNonParticleBrushDoesNotHaveSurfaceUvs) {
   StrokeShapeBuilder builder;
   BrushCoat brush_coat{.tips = {BrushTip{}}, .paint = {}};
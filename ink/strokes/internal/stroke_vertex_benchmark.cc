@@ -0,0 +1,127 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+#include "absl/log/absl_check.h"
+#include "absl/status/statusor.h"
+#include "benchmark/benchmark.h"
+#include "ink/geometry/internal/mesh_packing.h"
+#include "ink/geometry/mesh.h"
+#include "ink/geometry/mesh_format.h"
+#include "ink/geometry/mutable_mesh.h"
+#include "ink/geometry/point.h"
+#include "ink/geometry/vec.h"
+#include "ink/strokes/internal/stroke_vertex.h"
+#include "ink/types/small_array.h"
+
+namespace ink::strokes_internal {
+namespace {
+
+// Returns a mesh in `StrokeVertex::FullMeshFormat()` with `vertex_count`
+// vertices along a wavy ribbon, with every attribute varying from vertex to
+// vertex and within the range of its custom packing params.
+MutableMesh MakeStrokeMesh(uint32_t vertex_count) {
+  MutableMesh mesh(StrokeVertex::FullMeshFormat());
+  for (uint32_t i = 0; i < vertex_count; ++i) {
+    float t = 0.01f * i;
+    float side = i % 2 == 0 ? 1 : -1;
+    StrokeVertex::AppendToMesh(
+        mesh,
+        {.position = {10 * t, 5 * std::sin(t) + side},
+         .non_position_attributes = {
+             .opacity_shift = 0.5f * std::sin(3 * t),
+             .hsl_shift = {0.5f * std::cos(t), 0.25f * std::sin(t), 0},
+             .side_derivative = {std::cos(t), side},
+             .side_label = side > 0 ? StrokeVertex::kExteriorRightLabel
+                                    : StrokeVertex::kExteriorLeftLabel,
+             .forward_derivative = {1, std::cos(t)},
+             .forward_label = StrokeVertex::kInteriorLabel,
+             .surface_uv = {0.5f + 0.5f * side, std::fmod(t, 1.f)},
+         }});
+    if (i >= 2) {
+      mesh.AppendTriangleIndices(
+          i % 2 == 0 ? std::array<uint32_t, 3>{i - 2, i - 1, i}
+                     : std::array<uint32_t, 3>{i - 1, i - 2, i});
+    }
+  }
+  return mesh;
+}
+
+// Returns the packing params that `MutableMesh::AsMeshes()` would use for
+// `mesh`.
+mesh_internal::CodingParamsArray MakePackingParams(const MutableMesh& mesh) {
+  const MeshFormat& format = mesh.Format();
+  mesh_internal::AttributeBoundsArray bounds(format.Attributes().size());
+  for (uint32_t attr_idx = 0; attr_idx < format.Attributes().size();
+       ++attr_idx) {
+    bounds[attr_idx].minimum = mesh.FloatVertexAttribute(0, attr_idx);
+    bounds[attr_idx].maximum = bounds[attr_idx].minimum;
+    for (uint32_t vertex_idx = 1; vertex_idx < mesh.VertexCount();
+         ++vertex_idx) {
+      SmallArray<float, 4> value =
+          mesh.FloatVertexAttribute(vertex_idx, attr_idx);
+      for (int i = 0; i < value.Size(); ++i) {
+        bounds[attr_idx].minimum[i] =
+            std::min(bounds[attr_idx].minimum[i], value[i]);
+        bounds[attr_idx].maximum[i] =
+            std::max(bounds[attr_idx].maximum[i], value[i]);
+      }
+    }
+  }
+  StrokeVertex::CustomPackingArray custom_packing_array =
+      StrokeVertex::MakeCustomPackingArray(format);
+  absl::StatusOr<mesh_internal::CodingParamsArray> packing_params =
+      mesh_internal::ComputeCodingParamsArray(format, bounds,
+                                              custom_packing_array.Values());
+  ABSL_CHECK_OK(packing_params);
+  return *packing_params;
+}
+
+// Packs all of the vertices of a stroke mesh of `state.range(0)` vertices in
+// one partition, which is the core of `MutableMesh::AsMeshes()`.
+void BM_CopyAndPackPartitionVertices(benchmark::State& state) {
+  MutableMesh mesh = MakeStrokeMesh(state.range(0));
+  mesh_internal::VertexPackingPlan plan = mesh_internal::MakeVertexPackingPlan(
+      mesh.Format(), {}, MakePackingParams(mesh));
+  std::vector<uint32_t> vertex_indices(mesh.VertexCount());
+  std::iota(vertex_indices.begin(), vertex_indices.end(), 0);
+  for (auto s : state) {
+    benchmark::DoNotOptimize(mesh_internal::CopyAndPackPartitionVertices(
+        mesh.RawVertexData(), vertex_indices, plan, {}));
+  }
+  state.SetItemsProcessed(state.iterations() * mesh.VertexCount());
+}
+BENCHMARK(BM_CopyAndPackPartitionVertices)->Arg(1000)->Arg(10000)->Arg(65536);
+
+// Converts a stroke mesh of `state.range(0)` vertices to packed meshes the same
+// way as `InProgressStroke::CopyToStroke()`, including partitioning, bounds and
+// flipped triangle correction.
+void BM_MutableMeshAsMeshes(benchmark::State& state) {
+  MutableMesh mesh = MakeStrokeMesh(state.range(0));
+  StrokeVertex::CustomPackingArray custom_packing_array =
+      StrokeVertex::MakeCustomPackingArray(mesh.Format());
+  for (auto s : state) {
+    benchmark::DoNotOptimize(mesh.AsMeshes(custom_packing_array.Values()));
+  }
+  state.SetItemsProcessed(state.iterations() * mesh.VertexCount());
+}
+BENCHMARK(BM_MutableMeshAsMeshes)->Arg(1000)->Arg(10000)->Arg(100000);
+
+}  // namespace
+}  // namespace ink::strokes_internal
@@ -14,6 +14,8 @@
 
 #include "ink/strokes/internal/stroke_vertex.h"
 
+#include <algorithm>
+#include <cmath>
 #include <cstddef>
 #include <cstdint>
 #include <limits>
@@ -24,6 +26,8 @@
 #include "gtest/gtest.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "ink/geometry/internal/mesh_packing.h"
 #include "ink/geometry/mesh_format.h"
 #include "ink/geometry/mutable_mesh.h"
 #include "ink/geometry/point.h"
@@ -918,6 +922,75 @@ TEST(StrokeVertexTest, SetSurfaceUvInMesh) {
       PointEq({0.75, 0.125}));
 }
 
+TEST(StrokeVertexTest, PackingPlanWithCustomPackingMatchesPackAttribute) {
+  // Packs the vertices of a mesh in the full format, with the custom packing
+  // params, and compares the result with packing each attribute on its own.
+  MutableMesh mesh(StrokeVertex::FullMeshFormat());
+  constexpr uint32_t kVertexCount = 300;
+  for (uint32_t i = 0; i < kVertexCount; ++i) {
+    float t = 0.1f * i;
+    float side = i % 2 == 0 ? 1 : -1;
+    StrokeVertex::AppendToMesh(
+        mesh,
+        {.position = {t, std::sin(t) + side},
+         .non_position_attributes = {
+             .opacity_shift = 0.5f * std::sin(3 * t),
+             .hsl_shift = {0.5f * std::cos(t), 0.25f * std::sin(t), 0},
+             .side_derivative = {std::cos(t), side},
+             .side_label = side > 0 ? StrokeVertex::kExteriorRightLabel
+                                    : StrokeVertex::kExteriorLeftLabel,
+             .forward_derivative = {1, std::cos(t)},
+             .forward_label = StrokeVertex::kInteriorLabel,
+             .surface_uv = {0.5f + 0.5f * side, std::fmod(t, 1.f)},
+         }});
+  }
+  const MeshFormat& format = mesh.Format();
+
+  mesh_internal::AttributeBoundsArray bounds(format.Attributes().size());
+  for (uint32_t a = 0; a < format.Attributes().size(); ++a) {
+    bounds[a].minimum = mesh.FloatVertexAttribute(0, a);
+    bounds[a].maximum = bounds[a].minimum;
+    for (uint32_t v = 1; v < kVertexCount; ++v) {
+      SmallArray<float, 4> value = mesh.FloatVertexAttribute(v, a);
+      for (int c = 0; c < value.Size(); ++c) {
+        bounds[a].minimum[c] = std::min(bounds[a].minimum[c], value[c]);
+        bounds[a].maximum[c] = std::max(bounds[a].maximum[c], value[c]);
+      }
+    }
+  }
+  StrokeVertex::CustomPackingArray custom_packing_array =
+      StrokeVertex::MakeCustomPackingArray(format);
+  absl::StatusOr<mesh_internal::CodingParamsArray> packing_params =
+      mesh_internal::ComputeCodingParamsArray(format, bounds,
+                                              custom_packing_array.Values());
+  ASSERT_EQ(packing_params.status(), absl::OkStatus());
+
+  std::vector<uint32_t> partition_vertex_indices(kVertexCount);
+  for (uint32_t i = 0; i < kVertexCount; ++i) {
+    partition_vertex_indices[i] = kVertexCount - 1 - i;
+  }
+  std::vector<std::byte> expected(kVertexCount * format.PackedVertexStride());
+  size_t packed_offset = 0;
+  for (uint32_t vertex_index : partition_vertex_indices) {
+    for (uint32_t a = 0; a < format.Attributes().size(); ++a) {
+      MeshFormat::AttributeType type = format.Attributes()[a].type;
+      uint8_t packed_size = MeshFormat::PackedAttributeSize(type);
+      mesh_internal::PackAttribute(
+          type, (*packing_params)[a],
+          mesh.FloatVertexAttribute(vertex_index, a),
+          absl::MakeSpan(expected).subspan(packed_offset, packed_size));
+      packed_offset += packed_size;
+    }
+  }
+
+  EXPECT_EQ(mesh_internal::CopyAndPackPartitionVertices(
+                mesh.RawVertexData(), partition_vertex_indices,
+                mesh_internal::MakeVertexPackingPlan(format, {},
+                                                     *packing_params),
+                {}),
+            expected);
+}
+
 TEST(StrokeVertexDeathTest, MakeCustomPackingArrayWithTooManyAttributes) {
   auto format =
       MeshFormat::Create({{MeshFormat::AttributeType::kFloat2Unpacked,
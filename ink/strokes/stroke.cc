@@ -15,9 +15,13 @@
 #include "ink/strokes/stroke.h"
 
 #include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
+#include "absl/algorithm/container.h"
 #include "absl/log/absl_check.h"
 #include "absl/log/absl_log.h"
 #include "absl/status/status.h"
@@ -30,12 +34,16 @@
 #include "ink/geometry/mutable_mesh.h"
 #include "ink/geometry/partitioned_mesh.h"
 #include "ink/strokes/input/stroke_input_batch.h"
+#include "ink/strokes/internal/stroke_input_modeler.h"
 #include "ink/strokes/internal/stroke_shape_builder.h"
 #include "ink/strokes/internal/stroke_vertex.h"
+#include "ink/types/parallel_for.h"
 
 namespace ink {
 namespace {
 
+using ::ink::strokes_internal::ModeledStrokeInput;
+using ::ink::strokes_internal::StrokeInputModeler;
 using ::ink::strokes_internal::StrokeShapeBuilder;
 using ::ink::strokes_internal::StrokeVertex;
 
@@ -52,8 +60,36 @@ bool BrushCoatTipsAreEqual(absl::Span<const BrushCoat> coats1,
   return true;
 }
 
+// The input model types currently have no parameters, so two input models are
+// equal if they hold the same alternative.
+static_assert(std::is_empty_v<BrushFamily::SpringModelV1> &&
+              std::is_empty_v<BrushFamily::SpringModelV2>);
+bool InputModelsAreEqual(const BrushFamily::InputModel& model1,
+                         const BrushFamily::InputModel& model2) {
+  return model1.index() == model2.index();
+}
+
 }  // namespace
 
+struct Stroke::ModeledInputs {
+  // The input model and brush epsilon that were used for modeling.
+  BrushFamily::InputModel input_model;
+  float brush_epsilon;
+
+  StrokeInputModeler::State state;
+  std::vector<ModeledStrokeInput> inputs;
+};
+
+struct Stroke::ModeledTipStates {
+  // The brush coats and brush size that the tip states were modeled for. Only
+  // the tips of the coats affect tip modeling.
+  std::vector<BrushCoat> coats;
+  float brush_size;
+
+  // The tip states of each brush tip of each coat.
+  std::vector<std::vector<StrokeShapeBuilder::TipStates>> coat_tip_states;
+};
+
 Stroke::Stroke(const Brush& brush)
     : brush_(brush),
       shape_(PartitionedMesh::WithEmptyGroups(brush_.CoatCount())) {}
@@ -74,6 +110,7 @@ void Stroke::SetBrushAndInputs(const Brush& brush,
                                const StrokeInputBatch& inputs) {
   brush_ = brush;
   inputs_ = inputs;
+  ReleaseModeledInputs();
   RegenerateShape();
 }
 
@@ -127,20 +164,71 @@ absl::Status Stroke::SetBrushEpsilon(float epsilon) {
 void Stroke::SetInputs(const StrokeInputBatch& inputs) {
   inputs_.Clear();
   ABSL_CHECK_OK(inputs_.Append(inputs));
+  ReleaseModeledInputs();
   RegenerateShape();
 }
 
-namespace {
+void Stroke::RegenerateShapes(absl::Span<Stroke* const> strokes,
+                              ParallelFor parallel_for) {
+  // The cost of regenerating a shape is roughly proportional to the number of
+  // inputs, so starting with the largest strokes keeps a single large stroke
+  // from being left running on its own at the end.
+  std::vector<Stroke*> sorted_strokes(strokes.begin(), strokes.end());
+  absl::c_stable_sort(sorted_strokes, [](const Stroke* a, const Stroke* b) {
+    return a->inputs_.Size() > b->inputs_.Size();
+  });
+  parallel_for(sorted_strokes.size(), [&sorted_strokes](uint32_t i) {
+    sorted_strokes[i]->RegenerateShape();
+  });
+}
 
 // Resources for stroke shape generation grouped into a struct for simpler
 // `thread_local` variable creation in `RegenerateShape()` below.
-struct ShapeGenerationResources {
+struct Stroke::ShapeGenerationResources {
+  StrokeInputModeler input_modeler;
   std::vector<StrokeShapeBuilder> builders;
   std::vector<StrokeVertex::CustomPackingArray> custom_packing_arrays;
   std::vector<PartitionedMesh::MutableMeshGroup> mesh_groups;
 };
 
-}  // namespace
+void Stroke::SetMaxLevelOfDetailCount(uint32_t max_level_count) {
+  max_level_of_detail_count_ = max_level_count;
+  // This is only called when opting in to levels of detail, so unlike
+  // `RegenerateShape()`, it doesn't keep its buffers around.
+  ShapeGenerationResources shape_gen;
+  RegenerateLevelsOfDetail(shape_gen);
+  ReleaseModeledInputsUnlessKept();
+}
+
+void Stroke::SetKeepsModeledInputs(bool keeps_modeled_inputs) {
+  keeps_modeled_inputs_ = keeps_modeled_inputs;
+  ReleaseModeledInputsUnlessKept();
+}
+
+void Stroke::ReleaseModeledInputs() {
+  modeled_inputs_ = nullptr;
+  modeled_tip_states_ = nullptr;
+}
+
+void Stroke::ReleaseModeledInputsUnlessKept() {
+  if (!keeps_modeled_inputs_) {
+    ReleaseModeledInputs();
+  }
+}
+
+const PartitionedMesh& Stroke::GetShapeForScale(
+    float object_to_canvas_scale) const {
+  // Level `i` can be used up to a scale of `kLevelOfDetailEpsilonFactor` to the
+  // power of `-i`. NaN scales use the full shape.
+  const PartitionedMesh* shape = &shape_;
+  float max_scale = 1 / kLevelOfDetailEpsilonFactor;
+  for (const PartitionedMesh& level_shape : level_of_detail_shapes_) {
+    if (!(object_to_canvas_scale <= max_scale)) break;
+    shape = &level_shape;
+    max_scale /= kLevelOfDetailEpsilonFactor;
+  }
+  return *shape;
+}
 
 void Stroke::RegenerateShape() {
   // Create thread local stroke shape resources to save allocations if
@@ -151,13 +239,87 @@ void Stroke::RegenerateShape() {
 #endif
       ShapeGenerationResources shape_gen;
 
-  absl::Span<const BrushCoat> coats = brush_.GetCoats();
-  size_t num_coats = coats.size();
-  if (num_coats == 0 || inputs_.IsEmpty()) {
+  if (brush_.CoatCount() == 0 || inputs_.IsEmpty()) {
     shape_ = PartitionedMesh::WithEmptyGroups(brush_.CoatCount());
+    level_of_detail_shapes_.clear();
     return;
   }
 
+  UpdateModeledInputs(shape_gen);
+  shape_ = GenerateShape(brush_.GetEpsilon(), shape_gen);
+  RegenerateLevelsOfDetail(shape_gen);
+  ReleaseModeledInputsUnlessKept();
+}
+
+void Stroke::RegenerateLevelsOfDetail(ShapeGenerationResources& shape_gen) {
+  level_of_detail_shapes_.clear();
+  if (max_level_of_detail_count_ == 0 || brush_.CoatCount() == 0 ||
+      inputs_.IsEmpty()) {
+    return;
+  }
+
+  // Every level is extruded from the inputs and tip states modeled for the full
+  // shape, so only the extrusion is repeated per level.
+  UpdateModeledInputs(shape_gen);
+  float epsilon = brush_.GetEpsilon();
+  for (uint32_t level = 1; level <= max_level_of_detail_count_; ++level) {
+    epsilon *= kLevelOfDetailEpsilonFactor;
+    if (epsilon > brush_.GetSize()) break;
+    level_of_detail_shapes_.push_back(GenerateShape(epsilon, shape_gen));
+  }
+}
+
+void Stroke::UpdateModeledInputs(ShapeGenerationResources& shape_gen) {
+  // The inputs are modeled once for all of the brush coats and levels of
+  // detail, and only if the previously modeled inputs were modeled
+  // differently.
+  const BrushFamily::InputModel& input_model =
+      brush_.GetFamily().GetInputModel();
+  if (modeled_inputs_ == nullptr ||
+      !InputModelsAreEqual(modeled_inputs_->input_model, input_model) ||
+      modeled_inputs_->brush_epsilon != brush_.GetEpsilon()) {
+    modeled_inputs_ = std::make_shared<const ModeledInputs>(
+        ModelInputs(input_model, brush_.GetEpsilon(), inputs_, shape_gen));
+    modeled_tip_states_ = nullptr;
+  }
+}
+
+Stroke::ModeledInputs Stroke::ModelInputs(
+    const BrushFamily::InputModel& input_model, float epsilon,
+    const StrokeInputBatch& inputs, ShapeGenerationResources& shape_gen) {
+  StrokeInputModeler& input_modeler = shape_gen.input_modeler;
+  input_modeler.StartStroke(input_model, epsilon);
+  input_modeler.ExtendStroke(inputs, StrokeInputBatch(), inputs.GetDuration());
+  absl::Span<const ModeledStrokeInput> modeled_inputs =
+      input_modeler.GetModeledInputs();
+  return {
+      .input_model = input_model,
+      .brush_epsilon = epsilon,
+      .state = input_modeler.GetState(),
+      .inputs = {modeled_inputs.begin(), modeled_inputs.end()},
+  };
+}
+
+PartitionedMesh Stroke::GenerateShape(float epsilon,
+                                      ShapeGenerationResources& shape_gen) {
+  ABSL_DCHECK(modeled_inputs_ != nullptr);
+  absl::Span<const BrushCoat> coats = brush_.GetCoats();
+  size_t num_coats = coats.size();
+
+  // The tip states only depend on the modeled inputs, the brush tips and the
+  // brush size, so they can be reused for a different epsilon.
+  bool reuse_tip_states =
+      modeled_tip_states_ != nullptr &&
+      modeled_tip_states_->brush_size == brush_.GetSize() &&
+      BrushCoatTipsAreEqual(modeled_tip_states_->coats, coats);
+  std::shared_ptr<ModeledTipStates> new_tip_states;
+  if (!reuse_tip_states) {
+    new_tip_states = std::make_shared<ModeledTipStates>();
+    new_tip_states->coats.assign(coats.begin(), coats.end());
+    new_tip_states->brush_size = brush_.GetSize();
+    new_tip_states->coat_tip_states.resize(num_coats);
+  }
+
   // If necessary, expand the thread-local builders vector to the number of
   // brush coats. In order to cache all the allocations within, we never shrink
   // this vector.
@@ -172,8 +334,15 @@ void Stroke::RegenerateShape() {
   for (size_t i = 0; i < num_coats; ++i) {
     StrokeShapeBuilder& builder = shape_gen.builders[i];
     builder.StartStroke(brush_.GetFamily().GetInputModel(), coats[i],
-                        brush_.GetSize(), brush_.GetEpsilon());
-    builder.ExtendStroke(inputs_, StrokeInputBatch(), inputs_.GetDuration());
+                        brush_.GetSize(), epsilon);
+    if (reuse_tip_states) {
+      builder.ExtendStrokeWithTipStates(
+          modeled_tip_states_->coat_tip_states[i]);
+    } else {
+      builder.ExtendStrokeWithModeledInputs(modeled_inputs_->state,
+                                            modeled_inputs_->inputs);
+      builder.GetTipStates(new_tip_states->coat_tip_states[i]);
+    }
 
     const MutableMesh& mesh = builder.GetMesh();
     shape_gen.custom_packing_arrays.push_back(
@@ -186,17 +355,19 @@ void Stroke::RegenerateShape() {
     });
   }
 
+  if (new_tip_states != nullptr) {
+    modeled_tip_states_ = std::move(new_tip_states);
+  }
+
   absl::StatusOr<PartitionedMesh> partitioned_mesh =
       PartitionedMesh::FromMutableMeshGroups(shape_gen.mesh_groups);
-  if (partitioned_mesh.ok()) {
-    shape_ = *std::move(partitioned_mesh);
-  } else {
+  if (!partitioned_mesh.ok()) {
     ABSL_LOG(WARNING) << "Failed to create PartitionedMesh: "
                       << partitioned_mesh.status();
-    shape_ = PartitionedMesh::WithEmptyGroups(brush_.CoatCount());
+    return PartitionedMesh::WithEmptyGroups(brush_.CoatCount());
   }
-
-  ABSL_DCHECK_EQ(shape_.RenderGroupCount(), brush_.CoatCount());
+  ABSL_DCHECK_EQ(partitioned_mesh->RenderGroupCount(), brush_.CoatCount());
+  return *std::move(partitioned_mesh);
 }
 
 }  // namespace ink
@@ -15,13 +15,19 @@
 #ifndef INK_STROKES_STROKE_H_
 #define INK_STROKES_STROKE_H_
 
+#include <cstdint>
+#include <memory>
+#include <vector>
+
 #include "absl/status/status.h"
+#include "absl/types/span.h"
 #include "ink/brush/brush.h"
 #include "ink/brush/brush_family.h"
 #include "ink/color/color.h"
 #include "ink/geometry/partitioned_mesh.h"
 #include "ink/strokes/input/stroke_input_batch.h"
 #include "ink/types/duration.h"
+#include "ink/types/parallel_for.h"
 
 namespace ink {
 
@@ -70,6 +76,57 @@ class Stroke {
   // one render group per brush coat in `GetBrush()`.
   const PartitionedMesh& GetShape() const { return shape_; }
 
+  // The factor by which the epsilon of each level of detail is larger than
+  // that of the previous one; see `SetMaxLevelOfDetailCount()`.
+  static constexpr float kLevelOfDetailEpsilonFactor = 4;
+
+  // Sets the maximum number of coarser versions of the shape that are kept for
+  // drawing the stroke at small scales, and regenerates them. This is zero by
+  // default.
+  //
+  // Level `i` (starting at 1) is extruded from the same modeled inputs as
+  // `GetShape()`, with the brush epsilon multiplied by
+  // `kLevelOfDetailEpsilonFactor` to the power of `i`, so that it is as
+  // accurate when drawn at a scale of `kLevelOfDetailEpsilonFactor` to the
+  // power of `-i` as `GetShape()` is when drawn at a scale of 1. Levels whose
+  // epsilon would exceed the brush size are not generated. Once set, the levels
+  // are regenerated along with the shape.
+  void SetMaxLevelOfDetailCount(uint32_t max_level_count);
+
+  // Returns the coarser versions of the shape that were generated, from finest
+  // to coarsest. Each has one render group per brush coat in `GetBrush()`.
+  absl::Span<const PartitionedMesh> GetLevelOfDetailShapes() const {
+    return level_of_detail_shapes_;
+  }
+
+  // Returns the coarsest shape that is as accurate as `GetShape()` when drawn
+  // with an object-to-canvas transform that scales distances by at most
+  // `object_to_canvas_scale`, which is `GetShape()` unless levels of detail
+  // were generated and `object_to_canvas_scale` is small enough.
+  const PartitionedMesh& GetShapeForScale(float object_to_canvas_scale) const;
+
+  // Sets whether the stroke keeps the intermediate results of generating its
+  // shape, so that regenerating the shape after some changes can skip part of
+  // the work. This is disabled by default, and disabling it releases them; see
+  // also `ReleaseModeledInputs()`.
+  //
+  // The stroke keeps its modeled inputs and, for each brush tip, its brush tip
+  // states. Changing only the brush tips or size then skips input modeling, and
+  // regenerating the levels of detail (see `SetMaxLevelOfDetailCount()`) or
+  // the shape with an unchanged brush also skips brush tip modeling. This costs
+  // about 44 bytes per modeled input plus 48 bytes per tip state, with at least
+  // one tip state per modeled input and brush tip, which is typically a few
+  // times the memory of `GetInputs()`. It is meant for strokes that are being
+  // edited, not for every stroke in a document. Copies of the stroke share the
+  // kept results until either of them regenerates its shape.
+  void SetKeepsModeledInputs(bool keeps_modeled_inputs);
+  bool KeepsModeledInputs() const { return keeps_modeled_inputs_; }
+
+  // Releases the intermediate results kept since the shape was last generated,
+  // if any, without changing `KeepsModeledInputs()`. If it is enabled, they are
+  // kept again the next time the shape is regenerated.
+  void ReleaseModeledInputs();
+
   // Returns the total input duration for this stroke.
   Duration32 GetInputDuration() const { return inputs_.GetDuration(); }
 
@@ -80,7 +137,10 @@ class Stroke {
   // Sets the `brush`, regenerating the mesh if needed.
   //
   // The mesh is regenerated if this call results in a change of the
-  // `BrushTip`s, brush size, or brush epsilon.
+  // `BrushTip`s, brush size, or brush epsilon. If `KeepsModeledInputs()`, the
+  // inputs are only modeled again if the brush epsilon or the input model of
+  // the brush family changed, which makes e.g. changing only the brush size
+  // considerably cheaper.
   void SetBrush(const Brush& brush);
 
   // Sets the brush `family`, regenerating the mesh if the new family has a
@@ -108,13 +168,77 @@ class Stroke {
   // shape if `inputs` is empty.
   void SetInputs(const StrokeInputBatch& inputs);
 
+  // Regenerates the shape of each of `strokes` from its current brush and
+  // inputs, using `parallel_for` to regenerate them concurrently; see
+  // `ParallelFor` for details. Each stroke is regenerated in its own task, and
+  // the tasks are ordered by decreasing input count, so that the most expensive
+  // strokes are started first and the remaining ones can fill in around them.
+  // Each thread reuses its own shape generation buffers across tasks.
+  //
+  // This is meant for re-meshing many strokes at once, e.g. all of the strokes
+  // in a document after deserializing them with shapes that are out of date.
+  // To give many strokes a new brush, construct them with the new brush, their
+  // inputs, and a shape from `PartitionedMesh::WithEmptyGroups`, and then pass
+  // them to this function.
+  //
+  // `strokes` must not contain null pointers or the same `Stroke` more than
+  // once.
+  static void RegenerateShapes(absl::Span<Stroke* const> strokes,
+                               ParallelFor parallel_for = RunSerially);
+
  private:
-  // Regenerates the PartitionedMesh.
+  struct ModeledInputs;
+  struct ModeledTipStates;
+  struct ShapeGenerationResources;
+
+  // Regenerates the PartitionedMesh, and the levels of detail.
   void RegenerateShape();
 
+  // Regenerates `level_of_detail_shapes_`, using `shape_gen` for shape
+  // generation.
+  void RegenerateLevelsOfDetail(ShapeGenerationResources& shape_gen);
+
+  // Models `inputs_` into `modeled_inputs_`, using `shape_gen` for input
+  // modeling, unless it already holds them modeled for the current brush.
+  void UpdateModeledInputs(ShapeGenerationResources& shape_gen);
+
+  // Returns the result of modeling `inputs` with `input_model` and `epsilon`,
+  // using `shape_gen` for input modeling.
+  static ModeledInputs ModelInputs(const BrushFamily::InputModel& input_model,
+                                   float epsilon,
+                                   const StrokeInputBatch& inputs,
+                                   ShapeGenerationResources& shape_gen);
+
+  // Returns the shape of each brush coat of `brush_` for `modeled_inputs_`,
+  // with the tolerance `epsilon`, using `shape_gen` for shape generation.
+  // Reuses `modeled_tip_states_` if they were modeled for the current brush
+  // tips and size, and otherwise replaces them.
+  PartitionedMesh GenerateShape(float epsilon,
+                                ShapeGenerationResources& shape_gen);
+
+  // Releases the intermediate results of shape generation unless
+  // `keeps_modeled_inputs_`.
+  void ReleaseModeledInputsUnlessKept();
+
   Brush brush_;
   StrokeInputBatch inputs_;
   PartitionedMesh shape_;
+  // See `SetMaxLevelOfDetailCount()`. The shapes are shared between copies of
+  // the stroke, like `shape_`.
+  uint32_t max_level_of_detail_count_ = 0;
+  std::vector<PartitionedMesh> level_of_detail_shapes_;
+
+  // See `SetKeepsModeledInputs()`.
+  bool keeps_modeled_inputs_ = false;
+  // The result of modeling `inputs_`, and of modeling the brush tips from it.
+  // During shape generation, these are shared between the brush coats and the
+  // levels of detail. Afterwards, they are only kept if
+  // `keeps_modeled_inputs_`, so that regenerating the shape after a change that
+  // doesn't affect input or brush tip modeling can skip it. These are null when
+  // not kept. They are never modified once created, so they are shared between
+  // copies of the stroke.
+  std::shared_ptr<const ModeledInputs> modeled_inputs_;
+  std::shared_ptr<const ModeledTipStates> modeled_tip_states_;
 };
 
 }  // namespace ink
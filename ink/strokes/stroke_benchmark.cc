@@ -12,10 +12,16 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>  // NOLINT(build/c++11)
 #include <utility>
 #include <vector>
 
+#include "absl/functional/function_ref.h"
 #include "absl/log/absl_check.h"
+#include "absl/synchronization/mutex.h"
 #include "benchmark/benchmark.h"
 #include "ink/brush/brush.h"
 #include "ink/brush/brush_behavior.h"
@@ -25,6 +31,7 @@
 #include "ink/brush/easing_function.h"
 #include "ink/color/color.h"
 #include "ink/geometry/angle.h"
+#include "ink/geometry/partitioned_mesh.h"
 #include "ink/geometry/rect.h"
 #include "ink/strokes/input/recorded_test_inputs.h"
 #include "ink/strokes/input/stroke_input_batch.h"
@@ -194,5 +201,149 @@ BENCHMARK(BM_RoundedRectangleBrushWithSizeMultipleBehavior)
     ->RangeMultiplier(4)
     ->Range(1, 32);
 
+// A pool of `num_threads - 1` worker threads that run the tasks of each call to
+// `Run()` together with the calling thread. Each thread repeatedly claims the
+// next unclaimed task, so that threads that finish their tasks early keep
+// taking on more work. The workers are started once, rather than on every
+// call, like the thread pools that callers of `ParallelFor` are expected to
+// provide.
+class ThreadPool {
+ public:
+  explicit ThreadPool(int num_threads) {
+    for (int i = 1; i < num_threads; ++i) {
+      workers_.emplace_back([this]() { RunWorker(); });
+    }
+  }
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+  ~ThreadPool() {
+    {
+      absl::MutexLock lock(&mutex_);
+      shutting_down_ = true;
+    }
+    for (std::thread& worker : workers_) worker.join();
+  }
+
+  void Run(uint32_t n_tasks, absl::FunctionRef<void(uint32_t)> task) {
+    Job job = {.n_tasks = n_tasks, .task = task};
+    {
+      absl::MutexLock lock(&mutex_);
+      job_ = &job;
+      finished_worker_count_ = 0;
+      ++generation_;
+    }
+    RunTasks(job);
+    // Every worker takes part in every job, so `job` must outlive all of them.
+    absl::MutexLock lock(&mutex_);
+    mutex_.Await(absl::Condition(this, &ThreadPool::AllWorkersFinished));
+    job_ = nullptr;
+  }
+
+ private:
+  struct Job {
+    uint32_t n_tasks;
+    absl::FunctionRef<void(uint32_t)> task;
+    std::atomic<uint32_t> next_task = 0;
+  };
+
+  static void RunTasks(Job& job) {
+    for (uint32_t i = job.next_task++; i < job.n_tasks; i = job.next_task++) {
+      job.task(i);
+    }
+  }
+
+  void RunWorker() {
+    uint64_t last_generation = 0;
+    while (true) {
+      Job* job;
+      {
+        auto has_new_job = [this, &last_generation]() {
+          return shutting_down_ || generation_ != last_generation;
+        };
+        absl::MutexLock lock(&mutex_);
+        mutex_.Await(absl::Condition(&has_new_job));
+        if (shutting_down_) return;
+        last_generation = generation_;
+        job = job_;
+      }
+      RunTasks(*job);
+      absl::MutexLock lock(&mutex_);
+      ++finished_worker_count_;
+    }
+  }
+
+  bool AllWorkersFinished() const {
+    return finished_worker_count_ == workers_.size();
+  }
+
+  std::vector<std::thread> workers_;
+  absl::Mutex mutex_;
+  bool shutting_down_ = false;
+  // The job of the current call to `Run()`, which is numbered `generation_`,
+  // and how many workers have finished their part of it.
+  Job* job_ = nullptr;
+  uint64_t generation_ = 0;
+  size_t finished_worker_count_ = 0;
+};
+
+// Returns a "document" of strokes of varying lengths and brush sizes, whose
+// shapes have not been generated yet.
+std::vector<Stroke> MakeUnshapedStrokes(
+    const std::vector<StrokeInputBatch>& inputs,
+    const std::vector<Brush>& brushes) {
+  std::vector<Stroke> strokes;
+  strokes.reserve(inputs.size());
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    strokes.emplace_back(
+        brushes[i], inputs[i],
+        PartitionedMesh::WithEmptyGroups(brushes[i].CoatCount()));
+  }
+  return strokes;
+}
+
+void BM_RegenerateShapesWithThreads(benchmark::State& state) {
+  constexpr int kStrokeCount = 64;
+  std::vector<StrokeInputBatch> inputs;
+  std::vector<Brush> brushes;
+  int64_t input_count = 0;
+  for (int i = 0; i < kStrokeCount; ++i) {
+    float scale = 1 + i % 4;
+    Rect bounds = Rect::FromTwoPoints(
+        {0, 0}, {kInputBoundsWidth * scale, kInputBoundsHeight * scale});
+    inputs.push_back(i % 2 == 0 ? MakeCompleteStraightLineInputs(bounds)
+                                : MakeCompleteSpringShapeInputs(bounds));
+    brushes.push_back(MakeBrush(
+        BrushTip{.scale = {1, 1}, .corner_rounding = 1}, 2 + i % 8));
+    input_count += inputs.back().Size();
+  }
+  ThreadPool pool(state.range(0));
+  auto parallel_for = [&pool](uint32_t n_tasks,
+                              absl::FunctionRef<void(uint32_t)> task) {
+    pool.Run(n_tasks, task);
+  };
+
+  std::vector<Stroke> strokes;
+  std::vector<Stroke*> stroke_ptrs;
+  while (state.KeepRunningBatch(kStrokeCount)) {
+    // Regenerating the shape of a stroke reuses its modeled inputs, so each
+    // iteration starts from new strokes, which have to model them again.
+    state.PauseTiming();
+    strokes = MakeUnshapedStrokes(inputs, brushes);
+    stroke_ptrs.clear();
+    for (Stroke& stroke : strokes) stroke_ptrs.push_back(&stroke);
+    state.ResumeTiming();
+
+    Stroke::RegenerateShapes(stroke_ptrs, parallel_for);
+    benchmark::DoNotOptimize(strokes);
+  }
+  state.counters["inputs_per_second"] = benchmark::Counter(
+      static_cast<double>(state.iterations()) / kStrokeCount * input_count,
+      benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_RegenerateShapesWithThreads)
+    ->RangeMultiplier(2)
+    ->Range(1, 8)
+    ->UseRealTime();
+
 }  // namespace
 }  // namespace ink
@@ -14,12 +14,16 @@
 
 #include "ink/strokes/stroke.h"
 
+#include <cmath>
+#include <cstdint>
 #include <optional>
 #include <utility>
+#include <vector>
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "fuzztest/fuzztest.h"
+#include "absl/functional/function_ref.h"
 #include "absl/log/absl_check.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
@@ -35,11 +39,13 @@
 #include "ink/geometry/affine_transform.h"
 #include "ink/geometry/angle.h"
 #include "ink/geometry/envelope.h"
+#include "ink/geometry/mesh.h"
 #include "ink/geometry/mesh_test_helpers.h"
 #include "ink/geometry/partitioned_mesh.h"
 #include "ink/geometry/rect.h"
 #include "ink/geometry/type_matchers.h"
 #include "ink/strokes/input/fuzz_domains.h"
+#include "ink/strokes/input/recorded_test_inputs.h"
 #include "ink/strokes/input/stroke_input.h"
 #include "ink/strokes/input/stroke_input_batch.h"
 #include "ink/strokes/input/type_matchers.h"
@@ -49,6 +55,7 @@
 namespace ink {
 namespace {
 
+using ::testing::ElementsAre;
 using ::testing::Ge;
 using ::testing::IsEmpty;
 using ::testing::Not;
@@ -498,6 +505,80 @@ TEST(StrokeTest, SetBrushDifferentEpsilon) {
   EXPECT_THAT(stroke.GetShape(), Not(PartitionedMeshDeepEq(shape)));
 }
 
+TEST(StrokeTest, RegeneratedShapeMatchesNewStrokeWithSameBrush) {
+  // The modeled inputs and tip states may be reused when regenerating the
+  // shape, which must not change the result compared to generating it from
+  // scratch.
+  Brush brush = CreateBrush();
+  StrokeInputBatch inputs = CreateFilledInputs();
+  Stroke stroke(brush, inputs);
+  EXPECT_FALSE(stroke.KeepsModeledInputs());
+  stroke.SetKeepsModeledInputs(true);
+  EXPECT_TRUE(stroke.KeepsModeledInputs());
+
+  ASSERT_EQ(absl::OkStatus(), stroke.SetBrushSize(25));
+  EXPECT_THAT(stroke.GetShape(),
+              PartitionedMeshDeepEq(Stroke(stroke.GetBrush(), inputs)
+                                        .GetShape()));
+
+  ASSERT_EQ(absl::OkStatus(), stroke.SetBrushEpsilon(0.1));
+  EXPECT_THAT(stroke.GetShape(),
+              PartitionedMeshDeepEq(Stroke(stroke.GetBrush(), inputs)
+                                        .GetShape()));
+
+  absl::StatusOr<BrushFamily> new_family =
+      BrushFamily::Create({.scale = {0.3, 1}}, {});
+  ASSERT_EQ(new_family.status(), absl::OkStatus());
+  stroke.SetBrushFamily(*new_family);
+  EXPECT_THAT(stroke.GetShape(),
+              PartitionedMeshDeepEq(Stroke(stroke.GetBrush(), inputs)
+                                        .GetShape()));
+
+  Stroke copy = stroke;
+  ASSERT_EQ(absl::OkStatus(), copy.SetBrushSize(10));
+  EXPECT_THAT(copy.GetShape(),
+              PartitionedMeshDeepEq(Stroke(copy.GetBrush(), inputs)
+                                        .GetShape()));
+
+  // Regenerating with an unchanged brush reuses the tip states too.
+  Stroke::RegenerateShapes({&copy});
+  EXPECT_THAT(copy.GetShape(),
+              PartitionedMeshDeepEq(Stroke(copy.GetBrush(), inputs)
+                                        .GetShape()));
+
+  stroke.ReleaseModeledInputs();
+  EXPECT_TRUE(stroke.KeepsModeledInputs());
+  ASSERT_EQ(absl::OkStatus(), stroke.SetBrushSize(15));
+  EXPECT_THAT(stroke.GetShape(),
+              PartitionedMeshDeepEq(Stroke(stroke.GetBrush(), inputs)
+                                        .GetShape()));
+}
+
+TEST(StrokeTest, LevelsOfDetailMatchWhetherOrNotModeledInputsAreKept) {
+  Brush brush = CreateBrush();
+  StrokeInputBatch inputs = CreateFilledInputs();
+  Stroke stroke(brush, inputs);
+  Stroke keeping_stroke(brush, inputs);
+  keeping_stroke.SetKeepsModeledInputs(true);
+
+  stroke.SetMaxLevelOfDetailCount(2);
+  keeping_stroke.SetMaxLevelOfDetailCount(2);
+  ASSERT_THAT(stroke.GetLevelOfDetailShapes(), SizeIs(2));
+  ASSERT_THAT(keeping_stroke.GetLevelOfDetailShapes(), SizeIs(2));
+  for (size_t i = 0; i < stroke.GetLevelOfDetailShapes().size(); ++i) {
+    EXPECT_THAT(keeping_stroke.GetLevelOfDetailShapes()[i],
+                PartitionedMeshDeepEq(stroke.GetLevelOfDetailShapes()[i]));
+  }
+
+  // Disabling the cache releases the kept results, and regenerating the shape
+  // afterwards models everything again.
+  keeping_stroke.SetKeepsModeledInputs(false);
+  ASSERT_EQ(absl::OkStatus(), keeping_stroke.SetBrushSize(25));
+  ASSERT_EQ(absl::OkStatus(), stroke.SetBrushSize(25));
+  EXPECT_THAT(keeping_stroke.GetShape(),
+              PartitionedMeshDeepEq(stroke.GetShape()));
+}
+
 TEST(StrokeTest, SetBrushWithDifferentTipRegeneratesShape) {
   absl::StatusOr<BrushFamily> brush_family =
       BrushFamily::Create({.scale = {1, 0.5}}, {});
@@ -570,6 +651,38 @@ TEST(StrokeTest, SetBrushFamilyWithDifferentTipRegeneratesShape) {
   EXPECT_THAT(stroke.GetShape(), Not(PartitionedMeshDeepEq(shape)));
 }
 
+TEST(StrokeTest, RegenerateShapes) {
+  Brush brush = CreateBrush();
+  StrokeInputBatch inputs = CreateFilledInputs();
+  StrokeInputBatch fewer_inputs = inputs;
+  fewer_inputs.Erase(2);
+  // Strokes whose shapes don't match their inputs, as if deserialized from an
+  // older version.
+  std::vector<Stroke> strokes = {
+      Stroke(brush, fewer_inputs, CreateFilledShape()),
+      Stroke(brush, CreateEmptyInputs(), CreateFilledShape()),
+      Stroke(brush, inputs, CreateFilledShape()),
+  };
+  std::vector<Stroke*> stroke_ptrs = {&strokes[0], &strokes[1], &strokes[2]};
+  std::vector<uint32_t> n_tasks_per_call;
+  auto run_serially = [&n_tasks_per_call](
+                          uint32_t n_tasks,
+                          absl::FunctionRef<void(uint32_t)> task) {
+    n_tasks_per_call.push_back(n_tasks);
+    for (uint32_t i = 0; i < n_tasks; ++i) task(i);
+  };
+
+  Stroke::RegenerateShapes(stroke_ptrs, run_serially);
+
+  // Each stroke is regenerated in its own task.
+  EXPECT_THAT(n_tasks_per_call, ElementsAre(3));
+  EXPECT_THAT(strokes[0].GetShape(),
+              PartitionedMeshDeepEq(Stroke(brush, fewer_inputs).GetShape()));
+  EXPECT_THAT(strokes[1].GetShape().Meshes(), IsEmpty());
+  EXPECT_THAT(strokes[2].GetShape(),
+              PartitionedMeshDeepEq(Stroke(brush, inputs).GetShape()));
+}
+
 TEST(StrokeTest, GetInputDurationEmptyStroke) {
   Brush brush = CreateBrush();
   Stroke stroke(brush);
@@ -584,6 +697,85 @@ TEST(StrokeTest, GetInputDuration) {
   EXPECT_EQ(stroke.GetInputDuration(), Duration32::Seconds(2));
 }
 
+uint32_t TriangleCount(const PartitionedMesh& shape) {
+  uint32_t count = 0;
+  for (const Mesh& mesh : shape.Meshes()) count += mesh.TriangleCount();
+  return count;
+}
+
+TEST(StrokeTest, NoLevelsOfDetailByDefault) {
+  Stroke stroke(CreateBrush(), CreateFilledInputs());
+
+  EXPECT_THAT(stroke.GetLevelOfDetailShapes(), IsEmpty());
+  EXPECT_THAT(stroke.GetShapeForScale(0.001),
+              PartitionedMeshShallowEq(stroke.GetShape()));
+}
+
+TEST(StrokeTest, LevelsOfDetailHaveFewerTriangles) {
+  absl::StatusOr<Brush> brush = Brush::Create({}, Color::Red(), 10, 0.01);
+  ASSERT_EQ(brush.status(), absl::OkStatus());
+  Stroke stroke(*brush, MakeCompleteSpringShapeInputs(
+                            Rect::FromTwoPoints({0, 0}, {400, 200})));
+  stroke.SetMaxLevelOfDetailCount(3);
+
+  ASSERT_THAT(stroke.GetLevelOfDetailShapes(), SizeIs(3));
+  uint32_t previous_count = TriangleCount(stroke.GetShape());
+  for (const PartitionedMesh& shape : stroke.GetLevelOfDetailShapes()) {
+    EXPECT_EQ(shape.RenderGroupCount(), stroke.GetBrush().CoatCount());
+    uint32_t count = TriangleCount(shape);
+    EXPECT_GT(count, 0u);
+    EXPECT_LT(count, previous_count);
+    previous_count = count;
+  }
+}
+
+TEST(StrokeTest, LevelsOfDetailStopAtBrushSize) {
+  absl::StatusOr<Brush> brush = Brush::Create({}, Color::Red(), 10, 0.1);
+  ASSERT_EQ(brush.status(), absl::OkStatus());
+  Stroke stroke(*brush, CreateFilledInputs());
+  stroke.SetMaxLevelOfDetailCount(10);
+
+  // Epsilons of 0.4, 1.6 and 6.4 are at most the brush size; 25.6 is not.
+  EXPECT_THAT(stroke.GetLevelOfDetailShapes(), SizeIs(3));
+}
+
+TEST(StrokeTest, GetShapeForScale) {
+  Stroke stroke(CreateBrush(), CreateFilledInputs());
+  stroke.SetMaxLevelOfDetailCount(2);
+  ASSERT_THAT(stroke.GetLevelOfDetailShapes(), SizeIs(2));
+  absl::Span<const PartitionedMesh> levels = stroke.GetLevelOfDetailShapes();
+
+  EXPECT_THAT(stroke.GetShapeForScale(2),
+              PartitionedMeshShallowEq(stroke.GetShape()));
+  EXPECT_THAT(stroke.GetShapeForScale(0.5),
+              PartitionedMeshShallowEq(stroke.GetShape()));
+  EXPECT_THAT(stroke.GetShapeForScale(0.25),
+              PartitionedMeshShallowEq(levels[0]));
+  EXPECT_THAT(stroke.GetShapeForScale(0.1),
+              PartitionedMeshShallowEq(levels[0]));
+  EXPECT_THAT(stroke.GetShapeForScale(0.0625),
+              PartitionedMeshShallowEq(levels[1]));
+  EXPECT_THAT(stroke.GetShapeForScale(0),
+              PartitionedMeshShallowEq(levels[1]));
+  EXPECT_THAT(stroke.GetShapeForScale(std::nanf("")),
+              PartitionedMeshShallowEq(stroke.GetShape()));
+}
+
+TEST(StrokeTest, LevelsOfDetailAreRegeneratedWithShape) {
+  Stroke stroke(CreateBrush(), CreateFilledInputs());
+  stroke.SetMaxLevelOfDetailCount(1);
+  ASSERT_THAT(stroke.GetLevelOfDetailShapes(), SizeIs(1));
+  PartitionedMesh level_shape = stroke.GetLevelOfDetailShapes()[0];
+
+  ASSERT_EQ(stroke.SetBrushSize(20), absl::OkStatus());
+  ASSERT_THAT(stroke.GetLevelOfDetailShapes(), SizeIs(1));
+  EXPECT_THAT(stroke.GetLevelOfDetailShapes()[0],
+              Not(PartitionedMeshDeepEq(level_shape)));
+
+  stroke.SetInputs(CreateEmptyInputs());
+  EXPECT_THAT(stroke.GetLevelOfDetailShapes(), IsEmpty());
+}
+
 TEST(StrokeDeathTest, ConstructFromMismatchedShapeAndBrush) {
   BrushCoat coat = BrushCoat{.tips = {BrushTip()}};
   absl::StatusOr<BrushFamily> family = BrushFamily::Create({coat, coat});
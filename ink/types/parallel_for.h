@@ -0,0 +1,45 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef INK_TYPES_PARALLEL_FOR_H_
+#define INK_TYPES_PARALLEL_FOR_H_
+
+#include <cstdint>
+
+#include "absl/functional/function_ref.h"
+
+namespace ink {
+
+// A function that calls `task(i)` exactly once for each `i` in [0, `n_tasks`),
+// possibly concurrently on other threads, and returns only once every call has
+// completed.
+//
+// Ink does not create or manage threads itself; operations that can be split
+// into independent pieces of work take a `ParallelFor`, through which the
+// caller can distribute that work over a thread pool of their choosing. The
+// tasks given to a `ParallelFor` never wait on each other, so it is safe for an
+// implementation to run some or all of them on the calling thread.
+using ParallelFor = absl::FunctionRef<void(
+    uint32_t n_tasks, absl::FunctionRef<void(uint32_t)> task)>;
+
+// A `ParallelFor` that runs every task in order on the calling thread. This is
+// the default for operations that accept a `ParallelFor`.
+inline void RunSerially(uint32_t n_tasks,
+                        absl::FunctionRef<void(uint32_t)> task) {
+  for (uint32_t i = 0; i < n_tasks; ++i) task(i);
+}
+
+}  // namespace ink
+
+#endif  // INK_TYPES_PARALLEL_FOR_H_